@@ -0,0 +1,708 @@
+/*
+ * Unity tests for the camera HTTP endpoint (main/streaming/camera_http_endpoint.c).
+ *
+ * The endpoint runs on a real esp_http_server instance and serves a synthetic
+ * frame source injected through camera_http_frame_source_t. A client on the
+ * loopback interface fetches snapshots and parses the multipart stream. The
+ * source counts acquires, releases and viewer calls, so the tests can check
+ * that every reference is returned and that all clients share one frame
+ * instead of a copy.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#include "connectivity/http_server.h"
+#include "streaming/camera_http_endpoint.h"
+
+#define TEST_SERVER_PORT          (8080)
+#define TEST_CTRL_PORT            (32780)
+#define TEST_SLOT_COUNT           (4)
+#define TEST_FRAME_MAX_BYTES      (4096)
+#define TEST_FRAME_MIN_BYTES      (600)
+#define TEST_FRAME_SIDE           (800)
+#define TEST_PRODUCER_PERIOD_MS   (40)
+#define TEST_PRODUCER_STACK_BYTES (3072)
+#define TEST_RECV_TIMEOUT_S       (15)
+#define TEST_STREAM_PARTS         (10)
+#define TEST_HEADER_MAX_LEN       (512)
+#define TEST_SETTLE_TIMEOUT_MS    (3000)
+#define TEST_MAX_STREAMS          (CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS)
+
+typedef struct {
+  uint8_t data[TEST_FRAME_MAX_BYTES];
+  size_t size;
+  uint32_t seq;
+  uint32_t refs;
+} test_slot_t;
+
+typedef struct {
+  int fd;
+  uint8_t buf[512];
+  size_t pos;
+  size_t len;
+} test_reader_t;
+
+typedef struct {
+  test_reader_t *reader;
+  size_t chunk_left;
+  bool done;
+} test_chunked_t;
+
+typedef struct {
+  int status;
+  int content_length;
+  char content_type[64];
+  char cache_control[32];
+  char retry_after[8];
+  bool chunked;
+} test_response_t;
+
+static bool test_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out);
+static void test_release(camera_snapshot_ref_t *ref);
+static void test_viewer_attach(void);
+static void test_viewer_detach(void);
+
+static const camera_http_frame_source_t s_test_source = {
+  .acquire_latest = test_acquire_latest,
+  .release = test_release,
+  .viewer_attach = test_viewer_attach,
+  .viewer_detach = test_viewer_detach,
+};
+
+static portMUX_TYPE s_source_lock = portMUX_INITIALIZER_UNLOCKED;
+static test_slot_t s_slots[TEST_SLOT_COUNT];
+static test_slot_t *s_latest;
+static uint32_t s_seq;
+static uint32_t s_acquired;
+static uint32_t s_released;
+static uint32_t s_attached;
+static uint32_t s_detached;
+static uint32_t s_publish_skipped;
+static httpd_handle_t s_httpd;
+static TaskHandle_t s_producer;
+static volatile bool s_producer_run;
+
+// Stands in for connectivity/http_server.c, which needs the Wi-Fi stack.
+esp_err_t http_server_register_uri_handler(const httpd_uri_t *uri)
+{
+  if (!s_httpd || uri == NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return httpd_register_uri_handler(s_httpd, uri);
+}
+
+httpd_handle_t http_server_get_handle(void)
+{
+  return s_httpd;
+}
+
+/* ---------------------------------------------------------------------------
+ * Synthetic frame source
+ * ------------------------------------------------------------------------- */
+
+// Frame contents are a function of seq, so a client can check what it got:
+// SOI, the seq in four bytes, a seq-seeded pattern, EOI.
+static size_t test_frame_size(uint32_t seq)
+{
+  return TEST_FRAME_MIN_BYTES + ((seq * 733U) % (TEST_FRAME_MAX_BYTES - TEST_FRAME_MIN_BYTES));
+}
+
+static void test_frame_fill(uint32_t seq, uint8_t *data, size_t size)
+{
+  data[0] = 0xFF;
+  data[1] = 0xD8;
+  data[2] = (uint8_t)(seq >> 24);
+  data[3] = (uint8_t)(seq >> 16);
+  data[4] = (uint8_t)(seq >> 8);
+  data[5] = (uint8_t)seq;
+  for (size_t i = 6; i < size - 2U; ++i) {
+    data[i] = (uint8_t)(seq * 31U + i * 7U);
+  }
+  data[size - 2U] = 0xFF;
+  data[size - 1U] = 0xD9;
+}
+
+static bool test_frame_valid(const uint8_t *data, size_t size, uint32_t *seq_out)
+{
+  if (size < TEST_FRAME_MIN_BYTES || size > TEST_FRAME_MAX_BYTES) {
+    return false;
+  }
+  const uint32_t seq = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
+  if (seq == 0 || size != test_frame_size(seq)) {
+    return false;
+  }
+  static uint8_t want[TEST_FRAME_MAX_BYTES];
+  test_frame_fill(seq, want, size);
+  *seq_out = seq;
+  return memcmp(want, data, size) == 0;
+}
+
+// Like the publisher, a slot with readers is never rewritten; the next
+// free slot that is not the latest one takes the new frame.
+static bool test_publish_frame(void)
+{
+  test_slot_t *slot = NULL;
+  taskENTER_CRITICAL(&s_source_lock);
+  for (size_t i = 0; i < TEST_SLOT_COUNT; ++i) {
+    if (s_slots[i].refs == 0 && &s_slots[i] != s_latest) {
+      slot = &s_slots[i];
+      slot->refs = UINT32_MAX; // held by the writer
+      break;
+    }
+  }
+  const uint32_t seq = s_seq + 1U;
+  if (slot == NULL) {
+    s_publish_skipped++;
+  }
+  taskEXIT_CRITICAL(&s_source_lock);
+  if (slot == NULL) {
+    return false;
+  }
+
+  slot->size = test_frame_size(seq);
+  slot->seq = seq;
+  test_frame_fill(seq, slot->data, slot->size);
+
+  taskENTER_CRITICAL(&s_source_lock);
+  slot->refs = 0;
+  s_latest = slot;
+  s_seq = seq;
+  taskEXIT_CRITICAL(&s_source_lock);
+  return true;
+}
+
+static bool test_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out)
+{
+  bool ok = false;
+  taskENTER_CRITICAL(&s_source_lock);
+  if (s_latest != NULL && s_latest->seq != after_seq) {
+    s_latest->refs++;
+    s_acquired++;
+    *out = (camera_snapshot_ref_t){
+      .jpeg = s_latest->data,
+      .jpeg_size = s_latest->size,
+      .seq = s_latest->seq,
+      .width = TEST_FRAME_SIDE,
+      .height = TEST_FRAME_SIDE,
+      .captured_at_us = esp_timer_get_time(),
+      .token = s_latest,
+    };
+    ok = true;
+  }
+  taskEXIT_CRITICAL(&s_source_lock);
+  return ok;
+}
+
+static void test_release(camera_snapshot_ref_t *ref)
+{
+  test_slot_t *slot = ref->token;
+  taskENTER_CRITICAL(&s_source_lock);
+  if (slot != NULL && slot->refs > 0) {
+    slot->refs--;
+  }
+  s_released++;
+  taskEXIT_CRITICAL(&s_source_lock);
+  ref->token = NULL;
+}
+
+static void test_viewer_attach(void)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  s_attached++;
+  taskEXIT_CRITICAL(&s_source_lock);
+}
+
+static void test_viewer_detach(void)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  s_detached++;
+  taskEXIT_CRITICAL(&s_source_lock);
+}
+
+static uint32_t test_outstanding_refs(void)
+{
+  uint32_t refs = 0;
+  taskENTER_CRITICAL(&s_source_lock);
+  for (size_t i = 0; i < TEST_SLOT_COUNT; ++i) {
+    refs += s_slots[i].refs;
+  }
+  taskEXIT_CRITICAL(&s_source_lock);
+  return refs;
+}
+
+static uint32_t test_detached(void)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  const uint32_t detached = s_detached;
+  taskEXIT_CRITICAL(&s_source_lock);
+  return detached;
+}
+
+static void test_producer_task(void *arg)
+{
+  (void)arg;
+  while (s_producer_run) {
+    (void)test_publish_frame();
+    vTaskDelay(pdMS_TO_TICKS(TEST_PRODUCER_PERIOD_MS));
+  }
+  s_producer = NULL;
+  vTaskDelete(NULL);
+}
+
+static void test_producer_start(void)
+{
+  s_producer_run = true;
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(test_producer_task, "cam_test_src", TEST_PRODUCER_STACK_BYTES, NULL, 4,
+                                        &s_producer));
+}
+
+static void test_producer_stop(void)
+{
+  s_producer_run = false;
+  while (s_producer != NULL) {
+    vTaskDelay(pdMS_TO_TICKS(TEST_PRODUCER_PERIOD_MS));
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Server and loopback client
+ * ------------------------------------------------------------------------- */
+
+static void test_setup(void)
+{
+  test_case_uses_tcpip();
+
+  memset(s_slots, 0, sizeof(s_slots));
+  s_latest = NULL;
+  s_seq = 0;
+  s_acquired = 0;
+  s_released = 0;
+  s_attached = 0;
+  s_detached = 0;
+  s_publish_skipped = 0;
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = TEST_SERVER_PORT;
+  config.ctrl_port = TEST_CTRL_PORT;
+  TEST_ASSERT_EQUAL(ESP_OK, httpd_start(&s_httpd, &config));
+  TEST_ASSERT_EQUAL(ESP_OK, camera_http_endpoint_register(&s_test_source));
+}
+
+static void test_teardown(void)
+{
+  // Every stream task must be gone and every reference back.
+  TEST_ASSERT_EQUAL_UINT32(s_attached, test_detached());
+  TEST_ASSERT_EQUAL_UINT32(s_acquired, s_released);
+  TEST_ASSERT_EQUAL_UINT32(0, test_outstanding_refs());
+  TEST_ASSERT_EQUAL(ESP_OK, httpd_stop(s_httpd));
+  s_httpd = NULL;
+}
+
+static int test_connect(void)
+{
+  const int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+  const struct timeval timeout = {.tv_sec = TEST_RECV_TIMEOUT_S, .tv_usec = 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  struct sockaddr_in addr = {
+    .sin_family = AF_INET,
+    .sin_port = htons(TEST_SERVER_PORT),
+    .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+  return fd;
+}
+
+static int test_get(const char *uri)
+{
+  const int fd = test_connect();
+  char request[128];
+  const int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", uri);
+  TEST_ASSERT_EQUAL(len, send(fd, request, len, 0));
+  return fd;
+}
+
+static int test_reader_getc(test_reader_t *reader)
+{
+  if (reader->pos == reader->len) {
+    const int got = recv(reader->fd, reader->buf, sizeof(reader->buf), 0);
+    if (got <= 0) {
+      return -1;
+    }
+    reader->pos = 0;
+    reader->len = (size_t)got;
+  }
+  return reader->buf[reader->pos++];
+}
+
+// Reads one CRLF-terminated line without the CRLF.
+static bool test_reader_line(test_reader_t *reader, char *line, size_t len)
+{
+  size_t n = 0;
+  while (true) {
+    const int c = test_reader_getc(reader);
+    if (c < 0 || n + 1U >= len) {
+      return false;
+    }
+    if (c == '\n') {
+      if (n > 0 && line[n - 1U] == '\r') {
+        n--;
+      }
+      line[n] = '\0';
+      return true;
+    }
+    line[n++] = (char)c;
+  }
+}
+
+static void test_copy_header_value(const char *line, const char *name, char *out, size_t len)
+{
+  const size_t name_len = strlen(name);
+  if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+    const char *value = line + name_len + 1;
+    while (*value == ' ') {
+      value++;
+    }
+    snprintf(out, len, "%s", value);
+  }
+}
+
+static void test_read_response_head(test_reader_t *reader, test_response_t *resp)
+{
+  char line[TEST_HEADER_MAX_LEN];
+  memset(resp, 0, sizeof(*resp));
+  resp->content_length = -1;
+  TEST_ASSERT_TRUE(test_reader_line(reader, line, sizeof(line)));
+  TEST_ASSERT_EQUAL(1, sscanf(line, "HTTP/1.1 %d", &resp->status));
+  while (true) {
+    TEST_ASSERT_TRUE(test_reader_line(reader, line, sizeof(line)));
+    if (line[0] == '\0') {
+      return;
+    }
+    char length[16] = {0};
+    char encoding[16] = {0};
+    test_copy_header_value(line, "Content-Length", length, sizeof(length));
+    test_copy_header_value(line, "Transfer-Encoding", encoding, sizeof(encoding));
+    test_copy_header_value(line, "Content-Type", resp->content_type, sizeof(resp->content_type));
+    test_copy_header_value(line, "Cache-Control", resp->cache_control, sizeof(resp->cache_control));
+    test_copy_header_value(line, "Retry-After", resp->retry_after, sizeof(resp->retry_after));
+    if (length[0] != '\0') {
+      resp->content_length = atoi(length);
+    }
+    if (strcasecmp(encoding, "chunked") == 0) {
+      resp->chunked = true;
+    }
+  }
+}
+
+static void test_read_body(test_reader_t *reader, const test_response_t *resp, uint8_t *body)
+{
+  TEST_ASSERT_GREATER_OR_EQUAL(0, resp->content_length);
+  for (int i = 0; i < resp->content_length; ++i) {
+    const int c = test_reader_getc(reader);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, c);
+    body[i] = (uint8_t)c;
+  }
+}
+
+// Returns the next byte of a chunked body, or -1 at its end or on error;
+// done tells the two apart.
+static int test_chunked_getc(test_chunked_t *chunked)
+{
+  if (chunked->done) {
+    return -1;
+  }
+  if (chunked->chunk_left == 0) {
+    char line[32];
+    if (!test_reader_line(chunked->reader, line, sizeof(line))) {
+      return -1;
+    }
+    chunked->chunk_left = strtoul(line, NULL, 16);
+    if (chunked->chunk_left == 0) {
+      chunked->done = test_reader_line(chunked->reader, line, sizeof(line)) && line[0] == '\0';
+      return -1;
+    }
+  }
+  const int c = test_reader_getc(chunked->reader);
+  if (c >= 0 && --chunked->chunk_left == 0) {
+    char crlf[4];
+    if (!test_reader_line(chunked->reader, crlf, sizeof(crlf)) || crlf[0] != '\0') {
+      return -1;
+    }
+  }
+  return c;
+}
+
+static bool test_chunked_line(test_chunked_t *chunked, char *line, size_t len)
+{
+  size_t n = 0;
+  while (true) {
+    const int c = test_chunked_getc(chunked);
+    if (c < 0 || n + 1U >= len) {
+      return false;
+    }
+    if (c == '\n') {
+      if (n > 0 && line[n - 1U] == '\r') {
+        n--;
+      }
+      line[n] = '\0';
+      return true;
+    }
+    line[n++] = (char)c;
+  }
+}
+
+// Reads one multipart part and checks its framing and payload. Returns the
+// frame seq, or 0 if the stream ended or the part was malformed.
+static uint32_t test_read_stream_part(test_chunked_t *chunked)
+{
+  static uint8_t body[TEST_FRAME_MAX_BYTES];
+  char line[TEST_HEADER_MAX_LEN];
+  if (!test_chunked_line(chunked, line, sizeof(line))) {
+    return 0;
+  }
+  TEST_ASSERT_EQUAL_STRING("--theoframe", line);
+  int content_length = -1;
+  char content_type[64] = {0};
+  while (true) {
+    TEST_ASSERT_TRUE(test_chunked_line(chunked, line, sizeof(line)));
+    if (line[0] == '\0') {
+      break;
+    }
+    char length[16] = {0};
+    test_copy_header_value(line, "Content-Length", length, sizeof(length));
+    test_copy_header_value(line, "Content-Type", content_type, sizeof(content_type));
+    if (length[0] != '\0') {
+      content_length = atoi(length);
+    }
+  }
+  TEST_ASSERT_EQUAL_STRING("image/jpeg", content_type);
+  TEST_ASSERT_GREATER_THAN(0, content_length);
+  TEST_ASSERT_LESS_OR_EQUAL(TEST_FRAME_MAX_BYTES, content_length);
+  for (int i = 0; i < content_length; ++i) {
+    const int c = test_chunked_getc(chunked);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, c);
+    body[i] = (uint8_t)c;
+  }
+  TEST_ASSERT_TRUE(test_chunked_line(chunked, line, sizeof(line)));
+  TEST_ASSERT_EQUAL_STRING("", line);
+
+  uint32_t seq = 0;
+  TEST_ASSERT_TRUE(test_frame_valid(body, (size_t)content_length, &seq));
+  return seq;
+}
+
+static void test_open_stream(test_reader_t *reader, test_chunked_t *chunked)
+{
+  memset(reader, 0, sizeof(*reader));
+  reader->fd = test_get("/camera/stream.mjpeg");
+  test_response_t resp;
+  test_read_response_head(reader, &resp);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_EQUAL_STRING("multipart/x-mixed-replace;boundary=theoframe", resp.content_type);
+  TEST_ASSERT_EQUAL_STRING("no-store", resp.cache_control);
+  TEST_ASSERT_TRUE(resp.chunked);
+  *chunked = (test_chunked_t){.reader = reader};
+}
+
+// A closed viewer is noticed on the next send, so this needs the producer
+// running.
+static void test_wait_detached(uint32_t want)
+{
+  const int64_t deadline_us = esp_timer_get_time() + TEST_SETTLE_TIMEOUT_MS * 1000LL;
+  while (test_detached() < want && esp_timer_get_time() < deadline_us) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  TEST_ASSERT_EQUAL_UINT32(want, test_detached());
+}
+
+/* ---------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+TEST_CASE("camera_http rejects an incomplete frame source", "[camera_http]")
+{
+  const camera_http_frame_source_t no_release = {.acquire_latest = test_acquire_latest};
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, camera_http_endpoint_register(NULL));
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, camera_http_endpoint_register(&no_release));
+  // Without a running service, registering the URIs fails.
+  TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, camera_http_endpoint_register(&s_test_source));
+}
+
+TEST_CASE("camera_http snapshot serves the latest frame", "[camera_http]")
+{
+  static uint8_t body[TEST_FRAME_MAX_BYTES];
+  test_setup();
+  TEST_ASSERT_TRUE(test_publish_frame());
+  TEST_ASSERT_TRUE(test_publish_frame());
+
+  test_reader_t reader = {.fd = test_get("/camera/snapshot.jpg")};
+  test_response_t resp;
+  test_read_response_head(&reader, &resp);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_EQUAL_STRING("image/jpeg", resp.content_type);
+  TEST_ASSERT_EQUAL_STRING("no-store", resp.cache_control);
+  TEST_ASSERT_EQUAL((int)test_frame_size(2), resp.content_length);
+  test_read_body(&reader, &resp, body);
+  close(reader.fd);
+
+  uint32_t seq = 0;
+  TEST_ASSERT_TRUE(test_frame_valid(body, (size_t)resp.content_length, &seq));
+  TEST_ASSERT_EQUAL_UINT32(2, seq);
+  TEST_ASSERT_EQUAL_UINT32(1, s_acquired);
+  test_teardown();
+}
+
+TEST_CASE("camera_http snapshot clients share one frame", "[camera_http]")
+{
+  static uint8_t body[TEST_FRAME_MAX_BYTES];
+  test_setup();
+  TEST_ASSERT_TRUE(test_publish_frame());
+
+  // Three clients, one encode: each is served the same slot in place.
+  const uint32_t clients = 3;
+  for (uint32_t i = 0; i < clients; ++i) {
+    test_reader_t reader = {.fd = test_get("/camera/snapshot.jpg")};
+    test_response_t resp;
+    test_read_response_head(&reader, &resp);
+    TEST_ASSERT_EQUAL(200, resp.status);
+    test_read_body(&reader, &resp, body);
+    close(reader.fd);
+    uint32_t seq = 0;
+    TEST_ASSERT_TRUE(test_frame_valid(body, (size_t)resp.content_length, &seq));
+    TEST_ASSERT_EQUAL_UINT32(1, seq);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, s_seq);
+  TEST_ASSERT_EQUAL_UINT32(clients, s_acquired);
+  test_teardown();
+}
+
+TEST_CASE("camera_http snapshot returns 503 without a frame", "[camera_http]")
+{
+  test_setup();
+
+  const int64_t start_us = esp_timer_get_time();
+  test_reader_t reader = {.fd = test_get("/camera/snapshot.jpg")};
+  test_response_t resp;
+  test_read_response_head(&reader, &resp);
+  const int64_t waited_ms = (esp_timer_get_time() - start_us) / 1000;
+  TEST_ASSERT_EQUAL(503, resp.status);
+  TEST_ASSERT_EQUAL_STRING("1", resp.retry_after);
+  char body[32] = {0};
+  TEST_ASSERT_LESS_THAN((int)sizeof(body), resp.content_length);
+  test_read_body(&reader, &resp, (uint8_t *)body);
+  close(reader.fd);
+  TEST_ASSERT_EQUAL_STRING("camera unavailable\n", body);
+
+  // The handler waits about two seconds for a first frame before giving up.
+  TEST_ASSERT_GREATER_OR_EQUAL(1900, waited_ms);
+  TEST_ASSERT_EQUAL_UINT32(0, s_acquired);
+  test_teardown();
+}
+
+TEST_CASE("camera_http stream sends each new frame once", "[camera_http]")
+{
+  test_setup();
+  test_producer_start();
+
+  test_reader_t reader;
+  test_chunked_t chunked;
+  test_open_stream(&reader, &chunked);
+  uint32_t last_seq = 0;
+  for (int i = 0; i < TEST_STREAM_PARTS; ++i) {
+    const uint32_t seq = test_read_stream_part(&chunked);
+    TEST_ASSERT_GREATER_THAN_UINT32(last_seq, seq);
+    last_seq = seq;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, s_attached);
+  close(reader.fd);
+  test_wait_detached(1);
+
+  test_producer_stop();
+  TEST_ASSERT_EQUAL_UINT32(0, s_publish_skipped);
+  test_teardown();
+}
+
+TEST_CASE("camera_http limits concurrent streams", "[camera_http]")
+{
+  test_setup();
+  test_producer_start();
+
+  test_reader_t readers[TEST_MAX_STREAMS];
+  test_chunked_t chunked[TEST_MAX_STREAMS];
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    test_open_stream(&readers[i], &chunked[i]);
+    TEST_ASSERT_NOT_EQUAL(0, test_read_stream_part(&chunked[i]));
+  }
+
+  test_reader_t extra = {.fd = test_get("/camera/stream.mjpeg")};
+  test_response_t resp;
+  test_read_response_head(&extra, &resp);
+  TEST_ASSERT_EQUAL(503, resp.status);
+  char body[32] = {0};
+  TEST_ASSERT_LESS_THAN((int)sizeof(body), resp.content_length);
+  test_read_body(&extra, &resp, (uint8_t *)body);
+  close(extra.fd);
+  TEST_ASSERT_EQUAL_STRING("too many camera streams\n", body);
+
+  // The rejected request leaves both streams running.
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    TEST_ASSERT_NOT_EQUAL(0, test_read_stream_part(&chunked[i]));
+    close(readers[i].fd);
+  }
+  test_wait_detached(TEST_MAX_STREAMS);
+
+  // A closed stream frees its slot.
+  test_reader_t again;
+  test_chunked_t again_chunked;
+  test_open_stream(&again, &again_chunked);
+  TEST_ASSERT_NOT_EQUAL(0, test_read_stream_part(&again_chunked));
+  close(again.fd);
+  test_wait_detached(TEST_MAX_STREAMS + 1);
+
+  test_producer_stop();
+  test_teardown();
+}
+
+TEST_CASE("camera_http stream ends when the camera stops", "[camera_http]")
+{
+  test_setup();
+  test_producer_start();
+
+  test_reader_t reader;
+  test_chunked_t chunked;
+  test_open_stream(&reader, &chunked);
+  TEST_ASSERT_NOT_EQUAL(0, test_read_stream_part(&chunked));
+  test_producer_stop();
+
+  // Drain whatever was in flight, then expect the terminating chunk once the
+  // idle timeout (10 s) passes with no new frame.
+  const int64_t stop_us = esp_timer_get_time();
+  while (test_read_stream_part(&chunked) != 0) {
+  }
+  const int64_t ended_ms = (esp_timer_get_time() - stop_us) / 1000;
+  TEST_ASSERT_TRUE(chunked.done);
+  TEST_ASSERT_GREATER_OR_EQUAL(9000, ended_ms);
+  TEST_ASSERT_LESS_THAN(TEST_RECV_TIMEOUT_S * 1000, ended_ms);
+  close(reader.fd);
+  test_wait_detached(1);
+
+  test_teardown();
+}
+
+void app_main(void)
+{
+  unity_run_menu();
+}
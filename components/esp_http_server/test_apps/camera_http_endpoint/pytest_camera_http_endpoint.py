@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: CC0-1.0
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+
+@pytest.mark.generic
+@idf_parametrize('target', ['esp32p4'], indirect=['target'])
+def test_camera_http_endpoint(dut: Dut) -> None:
+    dut.run_all_single_board_cases(group='camera_http', timeout=120)
@@ -20,6 +20,7 @@
 #include "thermostat/backlight_manager.h"
 #include "thermostat/audio_boot.h"
 #include "thermostat/thermostat_led_status.h"
+#include "thermostat/led_program_store.h"
 #include "thermostat/ui_animation_timing.h"
 #include "thermostat/ui_ota_modal.h"
 #include "thermostat/ui_splash.h"
@@ -29,6 +30,8 @@
 #include "connectivity/wifi_remote_manager.h"
 #include "connectivity/time_sync.h"
 #include "connectivity/mqtt_manager.h"
+#include "connectivity/mqtt_publisher.h"
+#include "connectivity/ha_discovery.h"
 #include "connectivity/mqtt_dataplane.h"
 #include "connectivity/device_identity.h"
 #include "connectivity/mqtt_log_mirror.h"
@@ -41,8 +44,19 @@
 #if CONFIG_THEO_CAMERA_ENABLE
 #include "streaming/camera_snapshot_publisher.h"
 #endif
+#if CONFIG_THEO_CAMERA_HTTP_ENDPOINT
+#include "streaming/camera_http_endpoint.h"
+#endif
 
 static const char *TAG = "theo";
+#if CONFIG_THEO_CAMERA_HTTP_ENDPOINT
+static const camera_http_frame_source_t s_camera_http_source = {
+    .acquire_latest = camera_snapshot_publisher_acquire_latest,
+    .release = camera_snapshot_publisher_release,
+    .viewer_attach = camera_snapshot_publisher_viewer_attach,
+    .viewer_detach = camera_snapshot_publisher_viewer_detach,
+};
+#endif
 static void splash_post_fade_boot_continuation(void *ctx);
 static void dataplane_status_cb(const char *status, void *ctx);
 static void splash_status_printf(thermostat_splash_t *splash, const char *fmt, ...);
@@ -427,6 +441,14 @@ void app_main(void)
     ESP_LOGE(TAG, "OTA server start failed: %s", esp_err_to_name(err));
   }
 
+#if CONFIG_THEO_LED_ENABLE
+  err = led_program_store_register_http();
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "LED program endpoint registration failed: %s", esp_err_to_name(err));
+  }
+#endif
+
 
   stage_start_us = boot_stage_start(splash, "Syncing time…");
   err = time_sync_start();
@@ -459,6 +481,18 @@ void app_main(void)
   }
   boot_stage_done("Connecting to broker…", stage_start_us);
 
+  err = mqtt_publisher_start();
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "MQTT state publisher startup failed: %s", esp_err_to_name(err));
+  }
+
+  err = ha_discovery_cache_start();
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Discovery cache startup failed: %s", esp_err_to_name(err));
+  }
+
   stage_start_us = boot_stage_start(splash, "Starting log mirror…");
   err = mqtt_log_mirror_start();
   if (err != ESP_OK)
@@ -537,6 +571,13 @@ void app_main(void)
   {
     ESP_LOGW(TAG, "Camera snapshot startup failed: %s", esp_err_to_name(err));
   }
+#if CONFIG_THEO_CAMERA_HTTP_ENDPOINT
+  err = camera_http_endpoint_register(&s_camera_http_source);
+  if (err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "Camera HTTP endpoint registration failed: %s", esp_err_to_name(err));
+  }
+#endif
   boot_stage_done("Starting camera snapshots…", stage_start_us);
 #endif
 
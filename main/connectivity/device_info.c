@@ -20,7 +20,6 @@ static const char *TAG = "device_info";
 
 #define DEVICE_INFO_TOPIC_MAX_LEN   (160)
 #define DEVICE_INFO_DEVICE_TOPIC_MAX_LEN (256)
-#define DEVICE_INFO_PAYLOAD_MAX_LEN (768)
 #define DEVICE_INFO_TIME_LEN        (40)
 
 typedef struct {
@@ -32,7 +31,9 @@ typedef struct {
   const char *entity_category;
 } device_info_sensor_t;
 
-static const device_info_sensor_t s_sensors[] = {
+#define DEVICE_INFO_SENSOR_COUNT (2)
+
+static const device_info_sensor_t s_sensors[DEVICE_INFO_SENSOR_COUNT] = {
     {.object_id = "boot_time",
      .name = "Boot Time",
      .device_class = "timestamp",
@@ -42,11 +43,15 @@ static const device_info_sensor_t s_sensors[] = {
 
 static bool s_started;
 static bool s_published;
+static ha_discovery_handle_t s_discovery[DEVICE_INFO_SENSOR_COUNT] = {
+    HA_DISCOVERY_HANDLE_INVALID,
+    HA_DISCOVERY_HANDLE_INVALID,
+};
 
 static void device_info_publish(void);
 static void device_info_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void build_state_topic(char *buffer, size_t buffer_len, const char *object_id);
-static bool publish_discovery(const device_info_sensor_t *sensor);
+static esp_err_t cache_discovery_configs(void);
 static void publish_state(const char *object_id, const char *payload);
 static const char *reset_reason_to_string(esp_reset_reason_t reason);
 static void format_boot_time(char *buffer, size_t buffer_len);
@@ -64,6 +69,8 @@ esp_err_t device_info_start(void)
   esp_mqtt_client_handle_t client = mqtt_manager_get_client();
   ESP_RETURN_ON_FALSE(client != NULL, ESP_ERR_INVALID_STATE, TAG, "MQTT client missing");
 
+  ESP_RETURN_ON_ERROR(cache_discovery_configs(), TAG, "discovery cache failed");
+
   esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_CONNECTED, device_info_event_handler, NULL);
   ESP_RETURN_ON_ERROR(err, TAG, "register event failed");
 
@@ -99,16 +106,6 @@ static void device_info_publish(void)
     return;
   }
 
-  bool discovery_ok = true;
-  for (size_t i = 0; i < sizeof(s_sensors) / sizeof(s_sensors[0]); ++i) {
-    if (!publish_discovery(&s_sensors[i])) {
-      discovery_ok = false;
-    }
-  }
-  if (!discovery_ok) {
-    return;
-  }
-
   char boot_time[DEVICE_INFO_TIME_LEN];
   format_boot_time(boot_time, sizeof(boot_time));
   publish_state("boot_time", boot_time);
@@ -129,55 +126,37 @@ static void build_state_topic(char *buffer, size_t buffer_len, const char *objec
   }
 }
 
-static bool publish_discovery(const device_info_sensor_t *sensor)
+static esp_err_t cache_discovery_configs(void)
 {
-  if (!mqtt_manager_is_ready() || sensor == NULL) {
-    return false;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return false;
-  }
-
-  const char *slug = device_identity_get_slug();
-  const char *friendly = device_identity_get_friendly_name();
-  char discovery_topic[DEVICE_INFO_TOPIC_MAX_LEN];
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), "sensor", slug,
-                           sensor->object_id);
-
-  char state_topic[DEVICE_INFO_TOPIC_MAX_LEN];
-  build_state_topic(state_topic, sizeof(state_topic), sensor->object_id);
-
   char device_avail_topic[DEVICE_INFO_DEVICE_TOPIC_MAX_LEN];
   snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
            device_identity_get_theo_device_topic_root());
 
-  ha_discovery_entity_t entity = {
-      .component = "sensor",
-      .object_id = sensor->object_id,
-      .name = sensor->name,
-      .device_class = sensor->device_class,
-      .state_class = sensor->state_class,
-      .unit = sensor->unit,
-      .entity_category = sensor->entity_category,
-      .state_topic = state_topic,
-      .availability_topic = device_avail_topic,
-  };
-
-  char payload[DEVICE_INFO_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, slug, friendly) < 0) {
-    return false;
-  }
+  for (size_t i = 0; i < DEVICE_INFO_SENSOR_COUNT; ++i) {
+    if (s_discovery[i] != HA_DISCOVERY_HANDLE_INVALID) {
+      continue;
+    }
 
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for %s", sensor->object_id);
-    return false;
+    const device_info_sensor_t *sensor = &s_sensors[i];
+    char state_topic[DEVICE_INFO_TOPIC_MAX_LEN];
+    build_state_topic(state_topic, sizeof(state_topic), sensor->object_id);
+
+    ha_discovery_entity_t entity = {
+        .component = "sensor",
+        .object_id = sensor->object_id,
+        .name = sensor->name,
+        .device_class = sensor->device_class,
+        .state_class = sensor->state_class,
+        .unit = sensor->unit,
+        .entity_category = sensor->entity_category,
+        .state_topic = state_topic,
+        .availability_topic = device_avail_topic,
+    };
+
+    ESP_RETURN_ON_ERROR(ha_discovery_cache_add(&entity, NULL, &s_discovery[i]), TAG,
+                        "cache discovery for %s failed", sensor->object_id);
   }
-
-  ESP_LOGI(TAG, "Published discovery config for %s (msg_id=%d)", sensor->object_id, msg_id);
-  return true;
+  return ESP_OK;
 }
 
 static void publish_state(const char *object_id, const char *payload)
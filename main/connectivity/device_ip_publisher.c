@@ -19,15 +19,14 @@ static const char *TAG = "device_ip";
 
 #define DEVICE_IP_TOPIC_MAX_LEN   (160)
 #define DEVICE_IP_DEVICE_TOPIC_MAX_LEN (256)
-#define DEVICE_IP_PAYLOAD_MAX_LEN (640)
 #define DEVICE_IP_ADDR_LEN        (16)
 
 static bool s_started;
-static bool s_discovery_published;
+static ha_discovery_handle_t s_discovery = HA_DISCOVERY_HANDLE_INVALID;
 
 static void device_ip_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void device_ip_publish(void);
-static bool publish_discovery(void);
+static esp_err_t cache_discovery_config(void);
 static void publish_state(const char *ip_address);
 static void build_state_topic(char *buffer, size_t buffer_len);
 
@@ -44,6 +43,8 @@ esp_err_t device_ip_publisher_start(void)
   esp_mqtt_client_handle_t client = mqtt_manager_get_client();
   ESP_RETURN_ON_FALSE(client != NULL, ESP_ERR_INVALID_STATE, TAG, "MQTT client missing");
 
+  ESP_RETURN_ON_ERROR(cache_discovery_config(), TAG, "discovery cache failed");
+
   esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_CONNECTED, device_ip_event_handler, NULL);
   ESP_RETURN_ON_ERROR(err, TAG, "register event failed");
 
@@ -74,12 +75,6 @@ static void device_ip_publish(void)
     return;
   }
 
-  if (!s_discovery_published) {
-    if (!publish_discovery()) {
-      return;
-    }
-  }
-
   esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
   if (netif == NULL) {
     ESP_LOGW(TAG, "Wi-Fi STA netif not ready");
@@ -107,22 +102,12 @@ static void build_state_topic(char *buffer, size_t buffer_len)
   }
 }
 
-static bool publish_discovery(void)
+static esp_err_t cache_discovery_config(void)
 {
-  if (!mqtt_manager_is_ready()) {
-    return false;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return false;
+  if (s_discovery != HA_DISCOVERY_HANDLE_INVALID) {
+    return ESP_OK;
   }
 
-  const char *slug = device_identity_get_slug();
-  const char *friendly = device_identity_get_friendly_name();
-  char discovery_topic[DEVICE_IP_TOPIC_MAX_LEN];
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), "sensor", slug, "ip_address");
-
   char state_topic[DEVICE_IP_TOPIC_MAX_LEN];
   build_state_topic(state_topic, sizeof(state_topic));
 
@@ -140,20 +125,7 @@ static bool publish_discovery(void)
       .availability_topic = device_avail_topic,
   };
 
-  char payload[DEVICE_IP_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, slug, friendly) < 0) {
-    return false;
-  }
-
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for ip_address");
-    return false;
-  }
-
-  s_discovery_published = true;
-  ESP_LOGI(TAG, "Published discovery config for ip_address (msg_id=%d)", msg_id);
-  return true;
+  return ha_discovery_cache_add(&entity, NULL, &s_discovery);
 }
 
 static void publish_state(const char *ip_address)
@@ -17,6 +17,7 @@
 #include "sdkconfig.h"
 
 #include "connectivity/mqtt_manager.h"
+#include "connectivity/mqtt_publisher.h"
 #include "connectivity/ha_discovery.h"
 #include "connectivity/device_identity.h"
 
@@ -26,9 +27,9 @@ static const char *TAG = "device_telemetry";
 #define DEVICE_TELEMETRY_TASK_PRIO    (4)
 #define DEVICE_TELEMETRY_TOPIC_MAX_LEN (160)
 #define DEVICE_TELEMETRY_DEVICE_TOPIC_MAX_LEN (256)
-#define DEVICE_TELEMETRY_PAYLOAD_MAX_LEN (768)
 #define DEVICE_TELEMETRY_TEMP_MIN_C   (-10.0f)
 #define DEVICE_TELEMETRY_TEMP_MAX_C   (80.0f)
+#define DEVICE_TELEMETRY_MAX_STALE_MS (300U * 1000U)
 
 typedef enum {
   DEVICE_TELEM_TEMP = 0,
@@ -44,7 +45,10 @@ typedef struct {
   const char *state_class;
   const char *unit;
   const char *entity_category;
-  bool discovery_published;
+  float deadband;
+  uint8_t decimals;
+  mqtt_publisher_entity_t entity;
+  ha_discovery_handle_t discovery;
 } device_telemetry_sensor_t;
 
 static device_telemetry_sensor_t s_sensors[DEVICE_TELEM_COUNT] = {
@@ -55,7 +59,10 @@ static device_telemetry_sensor_t s_sensors[DEVICE_TELEM_COUNT] = {
         .state_class = "measurement",
         .unit = "°C",
         .entity_category = "diagnostic",
-        .discovery_published = false,
+        .deadband = 0.5f,
+        .decimals = 2,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [DEVICE_TELEM_RSSI] = {
         .object_id = "wifi_rssi",
@@ -64,7 +71,10 @@ static device_telemetry_sensor_t s_sensors[DEVICE_TELEM_COUNT] = {
         .state_class = "measurement",
         .unit = "dBm",
         .entity_category = "diagnostic",
-        .discovery_published = false,
+        .deadband = 3.0f,
+        .decimals = 0,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [DEVICE_TELEM_HEAP] = {
         .object_id = "free_heap",
@@ -72,7 +82,10 @@ static device_telemetry_sensor_t s_sensors[DEVICE_TELEM_COUNT] = {
         .state_class = "measurement",
         .unit = "B",
         .entity_category = "diagnostic",
-        .discovery_published = false,
+        .deadband = 4096.0f,
+        .decimals = 0,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
 };
 
@@ -83,8 +96,9 @@ static bool s_temp_sensor_available;
 
 static void device_telemetry_task(void *arg);
 static void build_state_topic(char *buffer, size_t buffer_len, const char *object_id);
-static bool publish_discovery(device_telemetry_sensor_t *sensor);
-static void publish_state(device_telemetry_sensor_t *sensor, const char *payload);
+static void cache_discovery_configs(void);
+static void register_state_entities(void);
+static void publish_state(device_telemetry_sensor_t *sensor, float value);
 static bool read_chip_temperature(float *out_value);
 
 esp_err_t device_telemetry_start(void)
@@ -109,6 +123,9 @@ esp_err_t device_telemetry_start(void)
     s_temp_sensor_available = true;
   }
 
+  cache_discovery_configs();
+  register_state_entities();
+
   BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(
       device_telemetry_task,
       "device_diag",
@@ -142,25 +159,19 @@ static void device_telemetry_task(void *arg)
     if (mqtt_manager_is_ready()) {
       float temp_c = 0.0f;
       if (read_chip_temperature(&temp_c)) {
-        char payload[16];
-        snprintf(payload, sizeof(payload), "%.2f", temp_c);
-        publish_state(&s_sensors[DEVICE_TELEM_TEMP], payload);
+        publish_state(&s_sensors[DEVICE_TELEM_TEMP], temp_c);
       }
 
       int rssi = 0;
       esp_err_t rssi_err = esp_wifi_sta_get_rssi(&rssi);
       if (rssi_err == ESP_OK) {
-        char payload[12];
-        snprintf(payload, sizeof(payload), "%d", rssi);
-        publish_state(&s_sensors[DEVICE_TELEM_RSSI], payload);
+        publish_state(&s_sensors[DEVICE_TELEM_RSSI], (float)rssi);
       } else {
         ESP_LOGW(TAG, "RSSI read skipped: %s", esp_err_to_name(rssi_err));
       }
 
       uint32_t free_heap = esp_get_free_heap_size();
-      char payload[16];
-      snprintf(payload, sizeof(payload), "%u", (unsigned)free_heap);
-      publish_state(&s_sensors[DEVICE_TELEM_HEAP], payload);
+      publish_state(&s_sensors[DEVICE_TELEM_HEAP], (float)free_heap);
     }
 
     vTaskDelay(poll_interval);
@@ -204,80 +215,73 @@ static void build_state_topic(char *buffer, size_t buffer_len, const char *objec
   }
 }
 
-static bool publish_discovery(device_telemetry_sensor_t *sensor)
+static void cache_discovery_configs(void)
 {
-  if (!mqtt_manager_is_ready() || sensor == NULL) {
-    return false;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return false;
-  }
-
-  const char *slug = device_identity_get_slug();
-  const char *friendly = device_identity_get_friendly_name();
-  char discovery_topic[DEVICE_TELEMETRY_TOPIC_MAX_LEN];
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), "sensor", slug,
-                           sensor->object_id);
-
-  char state_topic[DEVICE_TELEMETRY_TOPIC_MAX_LEN];
-  build_state_topic(state_topic, sizeof(state_topic), sensor->object_id);
-
   char device_avail_topic[DEVICE_TELEMETRY_DEVICE_TOPIC_MAX_LEN];
   snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
            device_identity_get_theo_device_topic_root());
 
-  ha_discovery_entity_t entity = {
-      .component = "sensor",
-      .object_id = sensor->object_id,
-      .name = sensor->name,
-      .device_class = sensor->device_class,
-      .state_class = sensor->state_class,
-      .unit = sensor->unit,
-      .entity_category = sensor->entity_category,
-      .state_topic = state_topic,
-      .availability_topic = device_avail_topic,
-  };
-
-  char payload[DEVICE_TELEMETRY_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, slug, friendly) < 0) {
-    return false;
-  }
+  for (int i = 0; i < DEVICE_TELEM_COUNT; ++i) {
+    device_telemetry_sensor_t *sensor = &s_sensors[i];
+    if (sensor->discovery != HA_DISCOVERY_HANDLE_INVALID) {
+      continue;
+    }
 
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for %s", sensor->object_id);
-    return false;
+    char state_topic[DEVICE_TELEMETRY_TOPIC_MAX_LEN];
+    build_state_topic(state_topic, sizeof(state_topic), sensor->object_id);
+
+    ha_discovery_entity_t entity = {
+        .component = "sensor",
+        .object_id = sensor->object_id,
+        .name = sensor->name,
+        .device_class = sensor->device_class,
+        .state_class = sensor->state_class,
+        .unit = sensor->unit,
+        .entity_category = sensor->entity_category,
+        .state_topic = state_topic,
+        .availability_topic = device_avail_topic,
+    };
+
+    esp_err_t err = ha_discovery_cache_add(&entity, NULL, &sensor->discovery);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to cache discovery for %s: %s", sensor->object_id, esp_err_to_name(err));
+    }
   }
-
-  ESP_LOGI(TAG, "Published discovery config for %s (msg_id=%d)", sensor->object_id, msg_id);
-  sensor->discovery_published = true;
-  return true;
 }
 
-static void publish_state(device_telemetry_sensor_t *sensor, const char *payload)
+static void register_state_entities(void)
 {
-  if (!mqtt_manager_is_ready() || sensor == NULL) {
-    return;
-  }
+  for (int i = 0; i < DEVICE_TELEM_COUNT; ++i) {
+    device_telemetry_sensor_t *sensor = &s_sensors[i];
+    if (sensor->entity != MQTT_PUBLISHER_ENTITY_INVALID) {
+      continue;
+    }
 
-  if (!sensor->discovery_published) {
-    if (!publish_discovery(sensor)) {
-      return;
+    char topic[DEVICE_TELEMETRY_TOPIC_MAX_LEN];
+    build_state_topic(topic, sizeof(topic), sensor->object_id);
+
+    const mqtt_publisher_entity_config_t config = {
+        .name = sensor->object_id,
+        .topic = topic,
+        .deadband = sensor->deadband,
+        .decimals = sensor->decimals,
+        .min_interval_ms = 0,
+        .max_stale_ms = DEVICE_TELEMETRY_MAX_STALE_MS,
+        .qos = 0,
+        .retain = true,
+    };
+    esp_err_t err = mqtt_publisher_register(&config, &sensor->entity);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to register state entity for %s: %s", sensor->object_id, esp_err_to_name(err));
     }
   }
+}
 
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
+static void publish_state(device_telemetry_sensor_t *sensor, float value)
+{
+  if (sensor == NULL) {
     return;
   }
 
-  char topic[DEVICE_TELEMETRY_TOPIC_MAX_LEN];
-  build_state_topic(topic, sizeof(topic), sensor->object_id);
-
-  int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGW(TAG, "Failed to publish state for %s", sensor->object_id);
-  }
+  mqtt_publisher_submit_number(sensor->entity, value);
 }
@@ -0,0 +1,156 @@
+#include "connectivity/fragment_reassembly.h"
+
+#include <string.h>
+
+static void end_flow(fragment_reassembly_t *reassembly, size_t idx, fragment_end_reason_t reason);
+static size_t find_slot(const fragment_reassembly_t *reassembly, int msg_id);
+static size_t claim_slot(fragment_reassembly_t *reassembly);
+static fragment_result_t start_flow(fragment_reassembly_t *reassembly, const fragment_t *fragment, size_t *slot_idx);
+
+void fragment_reassembly_init(fragment_reassembly_t *reassembly,
+                              fragment_slot_t *slots,
+                              size_t slot_count,
+                              size_t capacity,
+                              int64_t timeout_us,
+                              fragment_end_cb_t on_end,
+                              void *ctx)
+{
+  reassembly->slots = slots;
+  reassembly->slot_count = slot_count;
+  reassembly->capacity = capacity;
+  reassembly->timeout_us = timeout_us;
+  reassembly->on_end = on_end;
+  reassembly->ctx = ctx;
+  memset(slots, 0, slot_count * sizeof(slots[0]));
+  for (size_t i = 0; i < slot_count; ++i) {
+    slots[i].buffer = FRAGMENT_BUFFER_NONE;
+  }
+}
+
+fragment_result_t fragment_reassembly_push(fragment_reassembly_t *reassembly,
+                                           const fragment_t *fragment,
+                                           size_t *slot_idx)
+{
+  size_t unused;
+  if (slot_idx == NULL) {
+    slot_idx = &unused;
+  }
+  *slot_idx = reassembly->slot_count;
+  if (fragment->total_len > reassembly->capacity || fragment->len > reassembly->capacity ||
+      fragment->offset > fragment->total_len || fragment->len > fragment->total_len - fragment->offset) {
+    return FRAGMENT_RESULT_OVERSIZE;
+  }
+
+  fragment_reassembly_expire(reassembly, fragment->now_us);
+
+  if (fragment->head && fragment->offset == 0) {
+    return start_flow(reassembly, fragment, slot_idx);
+  }
+
+  const size_t idx = find_slot(reassembly, fragment->msg_id);
+  if (idx >= reassembly->slot_count) {
+    return FRAGMENT_RESULT_NONZERO_FIRST;
+  }
+  *slot_idx = idx;
+  fragment_slot_t *slot = &reassembly->slots[idx];
+
+  if (fragment->total_len != slot->total_len || fragment->offset < slot->filled) {
+    end_flow(reassembly, idx, FRAGMENT_END_DROPPED);
+    return FRAGMENT_RESULT_OVERLAP;
+  }
+  if (fragment->offset != slot->filled) {
+    end_flow(reassembly, idx, FRAGMENT_END_DROPPED);
+    return FRAGMENT_RESULT_OUT_OF_ORDER;
+  }
+
+  memcpy(slot->data + fragment->offset, fragment->data, fragment->len);
+  slot->filled += fragment->len;
+  slot->last_activity_us = fragment->now_us;
+  if (slot->filled < slot->total_len) {
+    return FRAGMENT_RESULT_APPENDED;
+  }
+  slot->data[slot->total_len] = '\0';
+  end_flow(reassembly, idx, FRAGMENT_END_COMPLETE);
+  return FRAGMENT_RESULT_COMPLETE;
+}
+
+void fragment_reassembly_expire(fragment_reassembly_t *reassembly, int64_t now_us)
+{
+  for (size_t i = 0; i < reassembly->slot_count; ++i) {
+    const fragment_slot_t *slot = &reassembly->slots[i];
+    if (slot->active && (now_us - slot->last_activity_us) >= reassembly->timeout_us) {
+      end_flow(reassembly, i, FRAGMENT_END_EXPIRED);
+    }
+  }
+}
+
+void fragment_reassembly_reset(fragment_reassembly_t *reassembly)
+{
+  for (size_t i = 0; i < reassembly->slot_count; ++i) {
+    if (reassembly->slots[i].active) {
+      end_flow(reassembly, i, FRAGMENT_END_RESET);
+    }
+  }
+}
+
+static fragment_result_t start_flow(fragment_reassembly_t *reassembly, const fragment_t *fragment, size_t *slot_idx)
+{
+  size_t idx = find_slot(reassembly, fragment->msg_id);
+  if (idx < reassembly->slot_count) {
+    // Same msg_id restarting before the old flow finished.
+    end_flow(reassembly, idx, FRAGMENT_END_PREEMPTED);
+  } else {
+    idx = claim_slot(reassembly);
+  }
+  *slot_idx = idx;
+
+  fragment_slot_t *slot = &reassembly->slots[idx];
+  slot->active = true;
+  slot->msg_id = fragment->msg_id;
+  slot->total_len = fragment->total_len;
+  slot->filled = fragment->len;
+  slot->last_activity_us = fragment->now_us;
+  slot->buffer = fragment->buffer;
+  slot->data = fragment->buffer_data;
+  if (slot->filled < slot->total_len) {
+    return FRAGMENT_RESULT_STARTED;
+  }
+  slot->data[slot->total_len] = '\0';
+  end_flow(reassembly, idx, FRAGMENT_END_COMPLETE);
+  return FRAGMENT_RESULT_COMPLETE;
+}
+
+static void end_flow(fragment_reassembly_t *reassembly, size_t idx, fragment_end_reason_t reason)
+{
+  fragment_slot_t *slot = &reassembly->slots[idx];
+  if (reassembly->on_end != NULL) {
+    reassembly->on_end(reassembly->ctx, idx, slot, reason);
+  }
+  memset(slot, 0, sizeof(*slot));
+  slot->buffer = FRAGMENT_BUFFER_NONE;
+}
+
+static size_t find_slot(const fragment_reassembly_t *reassembly, int msg_id)
+{
+  for (size_t i = 0; i < reassembly->slot_count; ++i) {
+    if (reassembly->slots[i].active && reassembly->slots[i].msg_id == msg_id) {
+      return i;
+    }
+  }
+  return reassembly->slot_count;
+}
+
+static size_t claim_slot(fragment_reassembly_t *reassembly)
+{
+  size_t lru = 0;
+  for (size_t i = 0; i < reassembly->slot_count; ++i) {
+    if (!reassembly->slots[i].active) {
+      return i;
+    }
+    if (reassembly->slots[i].last_activity_us < reassembly->slots[lru].last_activity_us) {
+      lru = i;
+    }
+  }
+  end_flow(reassembly, lru, FRAGMENT_END_EVICTED);
+  return lru;
+}
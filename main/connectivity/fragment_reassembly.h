@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reassembly of fragmented MQTT messages over a small table of flows.
+ *
+ * Flows are keyed by msg_id alone, since continuations carry no topic. A
+ * head fragment (offset 0, carrying the topic) claims a slot and lends it its
+ * buffer, and the payload is assembled in place there. Each continuation
+ * must start exactly where the flow has filled up to, so a fragment is
+ * copied once and never reordered. When the table is full, a new head evicts
+ * the least recently active flow. A head whose msg_id is already in flight
+ * preempts that flow. Flows idle past the timeout expire.
+ *
+ * Every QoS 0 PUBLISH has msg_id 0, so QoS 0 flows share one key and a QoS 0
+ * head preempts any open QoS 0 flow. Only QoS >= 1 flows, with distinct
+ * msg_ids, can be held apart. On a single esp-mqtt connection the fragments
+ * of one PUBLISH arrive back to back and are never interleaved with
+ * another's. So a preempted or evicted flow there means its tail was lost,
+ * not that two messages were in flight.
+ *
+ * Buffers belong to the caller and are identified by a small id (the
+ * dataplane's slab index). Whenever a flow ends, for whatever reason, the
+ * on_end callback gets the slot, so it can consume a complete payload and
+ * release the buffer.
+ *
+ * The module has no IDF dependencies; scripts/fragment_reassembly_fuzz.c
+ * exercises it on a host.
+ */
+
+#define FRAGMENT_BUFFER_NONE (UINT8_MAX)
+
+typedef enum {
+  FRAGMENT_END_COMPLETE = 0, // payload is data[0..total_len), NUL-terminated
+  FRAGMENT_END_DROPPED,      // overlapping or out-of-order continuation
+  FRAGMENT_END_PREEMPTED,    // a new head reused the flow's msg_id
+  FRAGMENT_END_EVICTED,      // least recently active flow, for a new head
+  FRAGMENT_END_EXPIRED,      // idle past the timeout
+  FRAGMENT_END_RESET,        // fragment_reassembly_reset()
+} fragment_end_reason_t;
+
+typedef enum {
+  FRAGMENT_RESULT_STARTED = 0,   // head claimed a slot and adopted its buffer
+  FRAGMENT_RESULT_APPENDED,      // continuation copied; flow still open
+  FRAGMENT_RESULT_COMPLETE,      // flow finished and was handed to on_end
+  FRAGMENT_RESULT_NONZERO_FIRST, // continuation without an open flow
+  FRAGMENT_RESULT_OVERLAP,       // offset behind the fill point or total changed; flow dropped
+  FRAGMENT_RESULT_OUT_OF_ORDER,  // offset past the fill point; flow dropped
+  FRAGMENT_RESULT_OVERSIZE,      // lengths exceed the capacity or each other
+} fragment_result_t;
+
+typedef struct {
+  bool active;
+  int msg_id;
+  size_t total_len;
+  size_t filled;
+  int64_t last_activity_us;
+  uint8_t buffer; // caller's id for data, FRAGMENT_BUFFER_NONE when idle
+  uint8_t *data;  // at least capacity + 1 bytes
+} fragment_slot_t;
+
+typedef void (*fragment_end_cb_t)(void *ctx, size_t slot_idx, const fragment_slot_t *slot,
+                                  fragment_end_reason_t reason);
+
+typedef struct {
+  int msg_id;
+  size_t offset;
+  size_t len;
+  size_t total_len;
+  int64_t now_us;
+  bool head;                 // offset 0 with a topic; starts a flow
+  const uint8_t *data;       // len bytes; for a head, already in buffer_data
+  uint8_t buffer;            // head only: buffer the flow adopts
+  uint8_t *buffer_data;      // head only
+} fragment_t;
+
+typedef struct {
+  fragment_slot_t *slots;
+  size_t slot_count;
+  size_t capacity;
+  int64_t timeout_us;
+  fragment_end_cb_t on_end;
+  void *ctx;
+} fragment_reassembly_t;
+
+/**
+ * @param capacity Largest total_len accepted.
+ * @param on_end   Called for every flow that ends, before its slot is cleared.
+ */
+void fragment_reassembly_init(fragment_reassembly_t *reassembly,
+                              fragment_slot_t *slots,
+                              size_t slot_count,
+                              size_t capacity,
+                              int64_t timeout_us,
+                              fragment_end_cb_t on_end,
+                              void *ctx);
+
+/**
+ * @brief Expires idle flows, then starts, extends or finishes the fragment's
+ *        flow.
+ *
+ * A head's buffer belongs to the reassembly once the result is STARTED or
+ * COMPLETE and comes back through on_end; for any other result it stays
+ * with the caller.
+ *
+ * @param slot_idx Optional; the slot the fragment landed in or dropped, or
+ *                 slot_count when none.
+ */
+fragment_result_t fragment_reassembly_push(fragment_reassembly_t *reassembly,
+                                           const fragment_t *fragment,
+                                           size_t *slot_idx);
+
+void fragment_reassembly_expire(fragment_reassembly_t *reassembly, int64_t now_us);
+
+/**
+ * @brief Ends every open flow with FRAGMENT_END_RESET.
+ */
+void fragment_reassembly_reset(fragment_reassembly_t *reassembly);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,12 +1,66 @@
 #include "connectivity/ha_discovery.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "mqtt_client.h"
 #include "sdkconfig.h"
 
+#include "connectivity/device_identity.h"
+#include "connectivity/mqtt_manager.h"
+
 static const char *TAG = "ha_discovery";
 
+#define HA_DISCOVERY_CACHE_MAX_ENTRIES (16)
+#define HA_DISCOVERY_CACHE_ARENA_LEN   (16 * 1024)
+#define HA_DISCOVERY_TOPIC_MAX_LEN     (160)
+#define HA_DISCOVERY_PAYLOAD_MAX_LEN   (1024)
+#define HA_DISCOVERY_SUBSCRIBE_BATCH   (8)
+#define HA_DISCOVERY_SETTLE_US         (2000LL * 1000LL)
+#define HA_DISCOVERY_FNV_OFFSET        (2166136261u)
+#define HA_DISCOVERY_FNV_PRIME         (16777619u)
+
+typedef struct {
+  uint16_t topic_off;
+  uint16_t payload_off;
+  uint16_t payload_len;
+  uint32_t hash;
+  uint32_t broker_hash;
+  bool broker_seen;
+  bool pending; // awaiting the next settle decision
+} ha_discovery_cache_entry_t;
+
+// Topics and payloads are rendered once into the arena and never freed; the
+// entry table only holds offsets into it.
+static EXT_RAM_BSS_ATTR char s_arena[HA_DISCOVERY_CACHE_ARENA_LEN];
+static size_t s_arena_used;
+static ha_discovery_cache_entry_t s_entries[HA_DISCOVERY_CACHE_MAX_ENTRIES];
+static size_t s_entry_count;
+static portMUX_TYPE s_cache_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_settle_timer;
+static bool s_cache_started;
+static bool s_syncing;
+static int s_rx_entry = -1;
+static uint32_t s_rx_hash;
+
+static uint32_t fnv1a_update(uint32_t hash, const char *data, size_t len);
+static void cache_begin_sync(esp_mqtt_client_handle_t client);
+static void cache_check_entry(esp_mqtt_client_handle_t client, size_t index);
+static void cache_arm_settle(void);
+static void cache_handle_data(const esp_mqtt_event_t *event);
+static void cache_settle_timer_cb(void *arg);
+static bool cache_publish_entry(esp_mqtt_client_handle_t client, size_t index);
+static void cache_mqtt_event_handler(void *handler_args,
+                                     esp_event_base_t base,
+                                     int32_t event_id,
+                                     void *event_data);
+
 static void build_ha_topic(char *buf,
                            size_t buf_len,
                            const char *component,
@@ -124,3 +178,309 @@ int ha_discovery_build_payload(char *buf, size_t buf_len, const ha_discovery_ent
 
   return written;
 }
+
+esp_err_t ha_discovery_cache_add(const ha_discovery_entity_t *entity, const char *node_id,
+                                 ha_discovery_handle_t *out_handle)
+{
+  ESP_RETURN_ON_FALSE(entity != NULL && out_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid entity");
+  *out_handle = HA_DISCOVERY_HANDLE_INVALID;
+
+  const char *slug = device_identity_get_slug();
+  const char *friendly_name = device_identity_get_friendly_name();
+  ESP_RETURN_ON_FALSE(slug != NULL && slug[0] != '\0' && friendly_name != NULL, ESP_ERR_INVALID_STATE, TAG,
+                      "device identity not ready");
+
+  char topic[HA_DISCOVERY_TOPIC_MAX_LEN];
+  build_ha_topic(topic, sizeof(topic), entity->component, node_id != NULL ? node_id : slug,
+                 entity->object_id);
+  const size_t topic_len = strlen(topic);
+
+  // Rendered once per boot; a heap scratch buffer keeps this off the caller's stack.
+  char *payload = heap_caps_malloc(HA_DISCOVERY_PAYLOAD_MAX_LEN, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  ESP_RETURN_ON_FALSE(payload != NULL, ESP_ERR_NO_MEM, TAG, "render buffer alloc failed");
+  int payload_len = ha_discovery_build_payload(payload, HA_DISCOVERY_PAYLOAD_MAX_LEN, entity, slug,
+                                               friendly_name);
+  if (payload_len < 0) {
+    free(payload);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  const size_t needed = topic_len + 1 + (size_t)payload_len + 1;
+  portENTER_CRITICAL(&s_cache_lock);
+  if (s_entry_count >= HA_DISCOVERY_CACHE_MAX_ENTRIES || s_arena_used + needed > sizeof(s_arena)) {
+    portEXIT_CRITICAL(&s_cache_lock);
+    free(payload);
+    ESP_LOGE(TAG, "Discovery cache full (entries=%u arena_used=%u) for %s", (unsigned)s_entry_count,
+             (unsigned)s_arena_used, entity->object_id);
+    return ESP_ERR_NO_MEM;
+  }
+  const size_t index = s_entry_count;
+  ha_discovery_cache_entry_t *entry = &s_entries[index];
+  entry->topic_off = (uint16_t)s_arena_used;
+  entry->payload_off = (uint16_t)(s_arena_used + topic_len + 1);
+  entry->payload_len = (uint16_t)payload_len;
+  entry->hash = fnv1a_update(HA_DISCOVERY_FNV_OFFSET, payload, (size_t)payload_len);
+  entry->broker_hash = 0;
+  entry->broker_seen = false;
+  entry->pending = true;
+  memcpy(&s_arena[entry->topic_off], topic, topic_len + 1);
+  memcpy(&s_arena[entry->payload_off], payload, (size_t)payload_len + 1);
+  s_arena_used += needed;
+  s_entry_count++;
+  const bool check_now = s_cache_started;
+  portEXIT_CRITICAL(&s_cache_lock);
+  free(payload);
+
+  *out_handle = (ha_discovery_handle_t)index;
+  ESP_LOGI(TAG, "Cached discovery for %s (bytes=%d hash=%08x arena_used=%u)", entity->object_id, payload_len,
+           (unsigned)entry->hash, (unsigned)s_arena_used);
+
+  // Entities added mid-session get the same echo check; adds in quick
+  // succession during boot share one settle window and one burst.
+  if (check_now && mqtt_manager_is_ready()) {
+    cache_check_entry(mqtt_manager_get_client(), index);
+  }
+  return ESP_OK;
+}
+
+esp_err_t ha_discovery_cache_start(void)
+{
+  if (s_cache_started) {
+    return ESP_OK;
+  }
+
+  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+  ESP_RETURN_ON_FALSE(client != NULL, ESP_ERR_INVALID_STATE, TAG, "MQTT client missing");
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = cache_settle_timer_cb,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "ha_disc_sync",
+  };
+  ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &s_settle_timer), TAG, "settle timer create failed");
+
+  esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, cache_mqtt_event_handler, NULL);
+  if (err != ESP_OK) {
+    esp_timer_delete(s_settle_timer);
+    s_settle_timer = NULL;
+    ESP_LOGE(TAG, "register MQTT event failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  s_cache_started = true;
+
+  if (mqtt_manager_is_ready()) {
+    cache_begin_sync(client);
+  }
+  return ESP_OK;
+}
+
+static uint32_t fnv1a_update(uint32_t hash, const char *data, size_t len)
+{
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)data[i];
+    hash *= HA_DISCOVERY_FNV_PRIME;
+  }
+  return hash;
+}
+
+static void cache_mqtt_event_handler(void *handler_args,
+                                     esp_event_base_t base,
+                                     int32_t event_id,
+                                     void *event_data)
+{
+  (void)handler_args;
+  (void)base;
+  esp_mqtt_event_handle_t event = event_data;
+
+  switch (event_id) {
+  case MQTT_EVENT_CONNECTED:
+    cache_begin_sync(mqtt_manager_get_client());
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    portENTER_CRITICAL(&s_cache_lock);
+    s_syncing = false;
+    s_rx_entry = -1;
+    portEXIT_CRITICAL(&s_cache_lock);
+    break;
+  case MQTT_EVENT_DATA:
+    if (event != NULL) {
+      cache_handle_data(event);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static void cache_begin_sync(esp_mqtt_client_handle_t client)
+{
+  if (client == NULL) {
+    return;
+  }
+
+  portENTER_CRITICAL(&s_cache_lock);
+  const size_t count = s_entry_count;
+  for (size_t i = 0; i < count; ++i) {
+    s_entries[i].broker_seen = false;
+    s_entries[i].broker_hash = 0;
+    s_entries[i].pending = true;
+  }
+  s_syncing = true;
+  s_rx_entry = -1;
+  portEXIT_CRITICAL(&s_cache_lock);
+
+  // Subscribing to our own config topics makes the broker echo whatever it
+  // retains for them; matching echoes are left alone in the settle callback,
+  // which also drops these subscriptions once it has decided.
+  esp_mqtt_topic_t topics[HA_DISCOVERY_SUBSCRIBE_BATCH];
+  for (size_t start = 0; start < count; start += HA_DISCOVERY_SUBSCRIBE_BATCH) {
+    size_t batch = count - start;
+    if (batch > HA_DISCOVERY_SUBSCRIBE_BATCH) {
+      batch = HA_DISCOVERY_SUBSCRIBE_BATCH;
+    }
+    for (size_t i = 0; i < batch; ++i) {
+      topics[i].filter = &s_arena[s_entries[start + i].topic_off];
+      topics[i].qos = 0;
+    }
+    if (esp_mqtt_client_subscribe_multiple(client, topics, (int)batch) < 0) {
+      ESP_LOGW(TAG, "Discovery echo subscribe failed; entries %u-%u will republish", (unsigned)start,
+               (unsigned)(start + batch - 1));
+    }
+  }
+
+  cache_arm_settle();
+}
+
+static void cache_check_entry(esp_mqtt_client_handle_t client, size_t index)
+{
+  portENTER_CRITICAL(&s_cache_lock);
+  s_syncing = true;
+  portEXIT_CRITICAL(&s_cache_lock);
+
+  if (esp_mqtt_client_subscribe(client, &s_arena[s_entries[index].topic_off], 0) < 0) {
+    ESP_LOGW(TAG, "Discovery echo subscribe failed; entry %u will republish", (unsigned)index);
+  }
+  cache_arm_settle();
+}
+
+static void cache_arm_settle(void)
+{
+  if (s_settle_timer == NULL) {
+    return;
+  }
+  esp_timer_stop(s_settle_timer);
+  esp_timer_start_once(s_settle_timer, HA_DISCOVERY_SETTLE_US);
+}
+
+static void cache_handle_data(const esp_mqtt_event_t *event)
+{
+  if (!s_syncing) {
+    return;
+  }
+
+  // esp-mqtt delivers the fragments of one message back to back, so a single
+  // in-progress hash is enough.
+  if (event->current_data_offset == 0) {
+    s_rx_entry = -1;
+    if (event->topic == NULL || event->topic_len <= 0) {
+      return;
+    }
+    for (size_t i = 0; i < s_entry_count; ++i) {
+      const char *topic = &s_arena[s_entries[i].topic_off];
+      if (strncmp(topic, event->topic, (size_t)event->topic_len) == 0 && topic[event->topic_len] == '\0') {
+        s_rx_entry = (int)i;
+        s_rx_hash = HA_DISCOVERY_FNV_OFFSET;
+        break;
+      }
+    }
+  }
+  if (s_rx_entry < 0) {
+    return;
+  }
+
+  if (event->data != NULL && event->data_len > 0) {
+    s_rx_hash = fnv1a_update(s_rx_hash, event->data, (size_t)event->data_len);
+  }
+  const int total_len = event->total_data_len > 0 ? event->total_data_len : event->data_len;
+  if (event->current_data_offset + event->data_len >= total_len) {
+    portENTER_CRITICAL(&s_cache_lock);
+    s_entries[s_rx_entry].broker_hash = s_rx_hash;
+    // An empty retained payload means the config was deleted.
+    s_entries[s_rx_entry].broker_seen = total_len > 0;
+    portEXIT_CRITICAL(&s_cache_lock);
+    s_rx_entry = -1;
+  }
+}
+
+static void cache_settle_timer_cb(void *arg)
+{
+  (void)arg;
+  const int64_t start_us = esp_timer_get_time();
+
+  portENTER_CRITICAL(&s_cache_lock);
+  const bool syncing = s_syncing;
+  const size_t count = s_entry_count;
+  s_syncing = false;
+  portEXIT_CRITICAL(&s_cache_lock);
+  if (!syncing || !mqtt_manager_is_ready()) {
+    return;
+  }
+
+  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+  unsigned published = 0;
+  unsigned skipped = 0;
+  unsigned failed = 0;
+  unsigned unsubscribe_failed = 0;
+  for (size_t i = 0; i < count; ++i) {
+    portENTER_CRITICAL(&s_cache_lock);
+    const bool pending = s_entries[i].pending;
+    const bool current = s_entries[i].broker_seen && s_entries[i].broker_hash == s_entries[i].hash;
+    s_entries[i].pending = false;
+    portEXIT_CRITICAL(&s_cache_lock);
+    if (!pending) {
+      continue;
+    }
+    // The echo has been read, so the subscription only costs broker state
+    // and would echo the republish below straight back. Dropping it before
+    // publishing avoids both. A later sync subscribes again. Unlike the
+    // enqueued publish this writes to the socket, but only a short packet.
+    if (esp_mqtt_client_unsubscribe(client, &s_arena[s_entries[i].topic_off]) < 0) {
+      unsubscribe_failed++;
+    }
+    if (current) {
+      skipped++;
+    } else if (cache_publish_entry(client, i)) {
+      published++;
+    } else {
+      failed++;
+      portENTER_CRITICAL(&s_cache_lock);
+      s_entries[i].pending = true;
+      portEXIT_CRITICAL(&s_cache_lock);
+    }
+  }
+
+  ESP_LOGI(TAG,
+           "discovery_sync entries=%u published=%u skipped=%u failed=%u unsubscribe_failed=%u arena_used=%u "
+           "elapsed_us=%lld",
+           (unsigned)count, published, skipped, failed, unsubscribe_failed, (unsigned)s_arena_used,
+           (long long)(esp_timer_get_time() - start_us));
+}
+
+static bool cache_publish_entry(esp_mqtt_client_handle_t client, size_t index)
+{
+  if (client == NULL || index >= s_entry_count) {
+    return false;
+  }
+
+  const ha_discovery_cache_entry_t *entry = &s_entries[index];
+  // Enqueue rather than publish: the burst runs on the esp_timer task and
+  // must not block on the socket.
+  int msg_id = esp_mqtt_client_enqueue(client, &s_arena[entry->topic_off], &s_arena[entry->payload_off],
+                                       entry->payload_len, 0, 1, true);
+  if (msg_id < 0) {
+    ESP_LOGE(TAG, "Failed to enqueue discovery %s", &s_arena[entry->topic_off]);
+    return false;
+  }
+  return true;
+}
@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +45,32 @@ void ha_discovery_build_topic(char *buf, size_t buf_len, const char *component,
 int ha_discovery_build_payload(char *buf, size_t buf_len, const ha_discovery_entity_t *entity,
                                const char *slug, const char *friendly_name);
 
+typedef int8_t ha_discovery_handle_t;
+
+#define HA_DISCOVERY_HANDLE_INVALID ((ha_discovery_handle_t)-1)
+
+/**
+ * @brief Renders an entity's discovery topic and payload once into the PSRAM
+ *        discovery cache.
+ *
+ * Call after device_identity_init(). The cache owns republishing: entities
+ * added while connected are published immediately, and every later connect
+ * republishes the whole cache in one burst.
+ *
+ * @param node_id Discovery node id; NULL uses the device slug.
+ */
+esp_err_t ha_discovery_cache_add(const ha_discovery_entity_t *entity, const char *node_id,
+                                 ha_discovery_handle_t *out_handle);
+
+/**
+ * @brief Hooks the cache to the MQTT client.
+ *
+ * On every MQTT_EVENT_CONNECTED the cache subscribes to its own config topics.
+ * The broker echoes the retained copies, and only entries whose content hash
+ * differs from the echo (or that have no retained copy) are republished.
+ */
+esp_err_t ha_discovery_cache_start(void);
+
 #ifdef __cplusplus
 }
 #endif
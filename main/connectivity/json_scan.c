@@ -0,0 +1,563 @@
+#include "connectivity/json_scan.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_SCAN_NUMBER_MAX_LEN (31)
+
+typedef enum {
+  EXPECT_VALUE = 0,
+  EXPECT_VALUE_OR_END,
+  EXPECT_KEY,
+  EXPECT_KEY_OR_END,
+  EXPECT_COLON,
+  EXPECT_COMMA_OR_END,
+  EXPECT_DONE,
+  EXPECT_FAILED,
+} json_expect_t;
+
+static bool is_ws(char c);
+static bool in_array(const json_scanner_t *scanner);
+static bool fail(json_scanner_t *scanner, json_tok_t *tok);
+static bool scan_string(json_scanner_t *scanner, json_tok_t *tok, json_tok_type_t type);
+static bool scan_number(json_scanner_t *scanner, json_tok_t *tok);
+static bool scan_literal(json_scanner_t *scanner, json_tok_t *tok, const char *literal, json_tok_type_t type);
+static bool scan_value(json_scanner_t *scanner, json_tok_t *tok);
+static bool close_container(json_scanner_t *scanner, json_tok_t *tok, bool array);
+static void after_value(json_scanner_t *scanner);
+static int hex_value(char c);
+static bool store_field(const json_field_t *field, const json_tok_t *tok, void *out, esp_err_t *err);
+
+void json_scanner_init(json_scanner_t *scanner, const char *json, size_t len)
+{
+  scanner->cur = json;
+  scanner->end = (json != NULL) ? json + len : json;
+  scanner->depth = 0;
+  scanner->expect = EXPECT_VALUE;
+  scanner->array_bits = 0;
+}
+
+bool json_scanner_next(json_scanner_t *scanner, json_tok_t *tok)
+{
+  tok->type = JSON_TOK_NONE;
+  tok->start = NULL;
+  tok->len = 0;
+  tok->depth = scanner->depth;
+
+  while (true) {
+    if (scanner->expect == EXPECT_FAILED) {
+      tok->type = JSON_TOK_ERROR;
+      return false;
+    }
+    while (scanner->cur < scanner->end && is_ws(*scanner->cur)) {
+      scanner->cur++;
+    }
+    if (scanner->cur >= scanner->end) {
+      if (scanner->expect == EXPECT_DONE) {
+        tok->type = JSON_TOK_END;
+        return false;
+      }
+      return fail(scanner, tok);
+    }
+
+    const char c = *scanner->cur;
+    switch (scanner->expect) {
+    case EXPECT_DONE:
+      return fail(scanner, tok);
+    case EXPECT_COLON:
+      if (c != ':') {
+        return fail(scanner, tok);
+      }
+      scanner->cur++;
+      scanner->expect = EXPECT_VALUE;
+      continue;
+    case EXPECT_COMMA_OR_END:
+      if (c == ',') {
+        scanner->cur++;
+        scanner->expect = in_array(scanner) ? EXPECT_VALUE : EXPECT_KEY;
+        continue;
+      }
+      if (c == '}' || c == ']') {
+        return close_container(scanner, tok, c == ']');
+      }
+      return fail(scanner, tok);
+    case EXPECT_KEY_OR_END:
+      if (c == '}') {
+        return close_container(scanner, tok, false);
+      }
+      // fall through
+    case EXPECT_KEY:
+      if (c != '"') {
+        return fail(scanner, tok);
+      }
+      if (!scan_string(scanner, tok, JSON_TOK_KEY)) {
+        return false;
+      }
+      scanner->expect = EXPECT_COLON;
+      return true;
+    case EXPECT_VALUE_OR_END:
+      if (c == ']') {
+        return close_container(scanner, tok, true);
+      }
+      return scan_value(scanner, tok);
+    case EXPECT_VALUE:
+    default:
+      return scan_value(scanner, tok);
+    }
+  }
+}
+
+bool json_scanner_skip(json_scanner_t *scanner, const json_tok_t *tok)
+{
+  if (tok->type != JSON_TOK_OBJECT_BEGIN && tok->type != JSON_TOK_ARRAY_BEGIN) {
+    return tok->type != JSON_TOK_ERROR;
+  }
+  json_tok_t inner;
+  while (json_scanner_next(scanner, &inner)) {
+    if ((inner.type == JSON_TOK_OBJECT_END || inner.type == JSON_TOK_ARRAY_END) &&
+        inner.depth == tok->depth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool json_tok_equals(const json_tok_t *tok, const char *literal)
+{
+  // Raw comparison: keys containing escapes never match a plain literal.
+  const size_t len = strlen(literal);
+  return tok->len == len && memcmp(tok->start, literal, len) == 0;
+}
+
+bool json_tok_to_float(const json_tok_t *tok, float *out_value)
+{
+  if (tok->type != JSON_TOK_NUMBER || tok->len > JSON_SCAN_NUMBER_MAX_LEN) {
+    return false;
+  }
+  // strtof needs a terminated string and the token sits inside a larger buffer.
+  char number[JSON_SCAN_NUMBER_MAX_LEN + 1];
+  memcpy(number, tok->start, tok->len);
+  number[tok->len] = '\0';
+  const float value = strtof(number, NULL);
+  if (!isfinite(value)) {
+    return false;
+  }
+  *out_value = value;
+  return true;
+}
+
+bool json_tok_to_int32(const json_tok_t *tok, int32_t *out_value)
+{
+  if (tok->type != JSON_TOK_NUMBER || tok->len > JSON_SCAN_NUMBER_MAX_LEN) {
+    return false;
+  }
+  char number[JSON_SCAN_NUMBER_MAX_LEN + 1];
+  memcpy(number, tok->start, tok->len);
+  number[tok->len] = '\0';
+  if (strpbrk(number, ".eE") != NULL) {
+    return false;
+  }
+  errno = 0;
+  const long long value = strtoll(number, NULL, 10);
+  if (errno != 0 || value < INT32_MIN || value > INT32_MAX) {
+    return false;
+  }
+  *out_value = (int32_t)value;
+  return true;
+}
+
+bool json_tok_copy_string(const json_tok_t *tok, char *dst, size_t dst_len)
+{
+  if ((tok->type != JSON_TOK_STRING && tok->type != JSON_TOK_KEY) || dst == NULL || dst_len == 0) {
+    return false;
+  }
+  size_t out = 0;
+  for (size_t i = 0; i < tok->len; ++i) {
+    char c = tok->start[i];
+    if (c == '\\') {
+      // The tokenizer already validated escape syntax.
+      c = tok->start[++i];
+      switch (c) {
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case 'u': {
+        int code = 0;
+        for (size_t h = 1; h <= 4; ++h) {
+          code = (code << 4) | hex_value(tok->start[i + h]);
+        }
+        i += 4;
+        c = (code > 0 && code < 0x80) ? (char)code : '?';
+        break;
+      }
+      default:
+        break; // '"', '\\' and '/' stand for themselves
+      }
+    }
+    if (out + 1 >= dst_len) {
+      dst[out] = '\0';
+      return false;
+    }
+    dst[out++] = c;
+  }
+  dst[out] = '\0';
+  return true;
+}
+
+bool json_parse_number(const char *json, size_t len, float *out_value)
+{
+  if (json == NULL || out_value == NULL) {
+    return false;
+  }
+  // State payloads are plain text rather than JSON documents, so this takes
+  // what strtof() takes, as the dataplane's parser did before the scanner.
+  while (len > 0 && isspace((unsigned char)json[0])) {
+    json++;
+    len--;
+  }
+  while (len > 0 && isspace((unsigned char)json[len - 1])) {
+    len--;
+  }
+  if (len == 0 || len > JSON_SCAN_NUMBER_MAX_LEN) {
+    return false;
+  }
+  char number[JSON_SCAN_NUMBER_MAX_LEN + 1];
+  memcpy(number, json, len);
+  number[len] = '\0';
+  char *end = NULL;
+  const float value = strtof(number, &end);
+  if (end != number + len || !isfinite(value)) {
+    return false;
+  }
+  *out_value = value;
+  return true;
+}
+
+esp_err_t json_scan_fields(const char *json,
+                           size_t len,
+                           const json_field_t *fields,
+                           size_t field_count,
+                           void *out,
+                           uint32_t *found_mask)
+{
+  if (json == NULL || out == NULL || (fields == NULL && field_count > 0) ||
+      field_count > JSON_SCAN_MAX_FIELDS) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  uint32_t found = 0;
+  if (found_mask != NULL) {
+    *found_mask = 0;
+  }
+
+  json_scanner_t scanner;
+  json_tok_t tok;
+  json_scanner_init(&scanner, json, len);
+  if (!json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_OBJECT_BEGIN) {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  esp_err_t err = ESP_OK;
+  while (json_scanner_next(&scanner, &tok)) {
+    if (tok.type == JSON_TOK_OBJECT_END && tok.depth == 0) {
+      break;
+    }
+    if (tok.type != JSON_TOK_KEY) {
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+    const json_field_t *field = NULL;
+    size_t index = 0;
+    for (; index < field_count; ++index) {
+      if (json_tok_equals(&tok, fields[index].key)) {
+        field = &fields[index];
+        break;
+      }
+    }
+
+    json_tok_t value;
+    if (!json_scanner_next(&scanner, &value)) {
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (field != NULL && store_field(field, &value, out, &err)) {
+      found |= (1u << index);
+    } else if (!json_scanner_skip(&scanner, &value)) {
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+  }
+  if (tok.type != JSON_TOK_OBJECT_END) {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+  json_scanner_next(&scanner, &tok);
+  if (tok.type != JSON_TOK_END) {
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+
+  if (found_mask != NULL) {
+    *found_mask = found;
+  }
+  return err;
+}
+
+static bool store_field(const json_field_t *field, const json_tok_t *tok, void *out, esp_err_t *err)
+{
+  uint8_t *member = (uint8_t *)out + field->offset;
+  switch (field->type) {
+  case JSON_FIELD_STRING:
+    if (tok->type != JSON_TOK_STRING) {
+      return false;
+    }
+    if (!json_tok_copy_string(tok, (char *)member, field->size)) {
+      *err = ESP_ERR_INVALID_SIZE;
+      return false;
+    }
+    return true;
+  case JSON_FIELD_FLOAT: {
+    float value = 0.0f;
+    if (field->size != sizeof(float) || !json_tok_to_float(tok, &value)) {
+      return false;
+    }
+    memcpy(member, &value, sizeof(value));
+    return true;
+  }
+  case JSON_FIELD_INT: {
+    int32_t value = 0;
+    if (field->size != sizeof(int32_t) || !json_tok_to_int32(tok, &value)) {
+      return false;
+    }
+    memcpy(member, &value, sizeof(value));
+    return true;
+  }
+  case JSON_FIELD_BOOL: {
+    if (field->size != sizeof(bool) || (tok->type != JSON_TOK_TRUE && tok->type != JSON_TOK_FALSE)) {
+      return false;
+    }
+    const bool value = (tok->type == JSON_TOK_TRUE);
+    memcpy(member, &value, sizeof(value));
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+static bool is_ws(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool in_array(const json_scanner_t *scanner)
+{
+  return scanner->depth > 0 && (scanner->array_bits & (1u << (scanner->depth - 1))) != 0;
+}
+
+static bool fail(json_scanner_t *scanner, json_tok_t *tok)
+{
+  scanner->expect = EXPECT_FAILED;
+  tok->type = JSON_TOK_ERROR;
+  tok->start = scanner->cur;
+  tok->len = 0;
+  return false;
+}
+
+static void after_value(json_scanner_t *scanner)
+{
+  scanner->expect = (scanner->depth == 0) ? EXPECT_DONE : EXPECT_COMMA_OR_END;
+}
+
+static bool close_container(json_scanner_t *scanner, json_tok_t *tok, bool array)
+{
+  if (scanner->depth == 0 || in_array(scanner) != array) {
+    return fail(scanner, tok);
+  }
+  scanner->depth--;
+  tok->type = array ? JSON_TOK_ARRAY_END : JSON_TOK_OBJECT_END;
+  tok->start = scanner->cur;
+  tok->len = 1;
+  tok->depth = scanner->depth;
+  scanner->cur++;
+  after_value(scanner);
+  return true;
+}
+
+static bool scan_value(json_scanner_t *scanner, json_tok_t *tok)
+{
+  const char c = *scanner->cur;
+  switch (c) {
+  case '{':
+  case '[': {
+    if (scanner->depth >= JSON_SCAN_MAX_DEPTH) {
+      return fail(scanner, tok);
+    }
+    const bool array = (c == '[');
+    tok->type = array ? JSON_TOK_ARRAY_BEGIN : JSON_TOK_OBJECT_BEGIN;
+    tok->start = scanner->cur;
+    tok->len = 1;
+    tok->depth = scanner->depth;
+    if (array) {
+      scanner->array_bits |= (1u << scanner->depth);
+    } else {
+      scanner->array_bits &= ~(1u << scanner->depth);
+    }
+    scanner->depth++;
+    scanner->cur++;
+    scanner->expect = array ? EXPECT_VALUE_OR_END : EXPECT_KEY_OR_END;
+    return true;
+  }
+  case '"':
+    if (!scan_string(scanner, tok, JSON_TOK_STRING)) {
+      return false;
+    }
+    after_value(scanner);
+    return true;
+  case 't':
+    return scan_literal(scanner, tok, "true", JSON_TOK_TRUE);
+  case 'f':
+    return scan_literal(scanner, tok, "false", JSON_TOK_FALSE);
+  case 'n':
+    return scan_literal(scanner, tok, "null", JSON_TOK_NULL);
+  default:
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      return scan_number(scanner, tok);
+    }
+    return fail(scanner, tok);
+  }
+}
+
+static bool scan_string(json_scanner_t *scanner, json_tok_t *tok, json_tok_type_t type)
+{
+  const char *p = scanner->cur + 1;
+  const char *start = p;
+  while (p < scanner->end) {
+    const unsigned char c = (unsigned char)*p;
+    if (c == '"') {
+      tok->type = type;
+      tok->start = start;
+      tok->len = (size_t)(p - start);
+      tok->depth = scanner->depth;
+      scanner->cur = p + 1;
+      return true;
+    }
+    if (c < 0x20) {
+      break;
+    }
+    if (c == '\\') {
+      if (p + 1 >= scanner->end) {
+        break;
+      }
+      const char esc = p[1];
+      if (esc == 'u') {
+        if (p + 6 > scanner->end) {
+          break;
+        }
+        for (size_t h = 2; h < 6; ++h) {
+          if (hex_value(p[h]) < 0) {
+            scanner->cur = p;
+            return fail(scanner, tok);
+          }
+        }
+        p += 6;
+        continue;
+      }
+      if (strchr("\"\\/bfnrt", esc) == NULL || esc == '\0') {
+        break;
+      }
+      p += 2;
+      continue;
+    }
+    p++;
+  }
+  scanner->cur = p;
+  return fail(scanner, tok);
+}
+
+static bool scan_number(json_scanner_t *scanner, json_tok_t *tok)
+{
+  const char *p = scanner->cur;
+  const char *end = scanner->end;
+  if (*p == '-') {
+    p++;
+  }
+  if (p >= end) {
+    return fail(scanner, tok);
+  }
+  if (*p == '0') {
+    p++;
+  } else if (*p >= '1' && *p <= '9') {
+    while (p < end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+  } else {
+    return fail(scanner, tok);
+  }
+  if (p < end && *p == '.') {
+    p++;
+    if (p >= end || *p < '0' || *p > '9') {
+      return fail(scanner, tok);
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < end && (*p == '+' || *p == '-')) {
+      p++;
+    }
+    if (p >= end || *p < '0' || *p > '9') {
+      return fail(scanner, tok);
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+  }
+  tok->type = JSON_TOK_NUMBER;
+  tok->start = scanner->cur;
+  tok->len = (size_t)(p - scanner->cur);
+  tok->depth = scanner->depth;
+  scanner->cur = p;
+  after_value(scanner);
+  return true;
+}
+
+static bool scan_literal(json_scanner_t *scanner, json_tok_t *tok, const char *literal, json_tok_type_t type)
+{
+  const size_t len = strlen(literal);
+  if ((size_t)(scanner->end - scanner->cur) < len || memcmp(scanner->cur, literal, len) != 0) {
+    return fail(scanner, tok);
+  }
+  tok->type = type;
+  tok->start = scanner->cur;
+  tok->len = len;
+  tok->depth = scanner->depth;
+  scanner->cur += len;
+  after_value(scanner);
+  return true;
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
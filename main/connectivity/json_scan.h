@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocation-free JSON tokenizer for MQTT payloads.
+ *
+ * Tokens point straight into the caller's buffer (typically a dataplane slab),
+ * which does not need to be NUL-terminated. String and key tokens exclude the
+ * surrounding quotes and keep escapes encoded; use json_tok_copy_string() to
+ * decode them.
+ *
+ * The module has no IDF dependencies beyond esp_err_t;
+ * scripts/json_scan_test.c tests, fuzzes and times it on a host.
+ */
+
+#define JSON_SCAN_MAX_DEPTH (8)
+#define JSON_SCAN_MAX_FIELDS (32)
+
+typedef enum {
+  JSON_TOK_NONE = 0,
+  JSON_TOK_OBJECT_BEGIN,
+  JSON_TOK_OBJECT_END,
+  JSON_TOK_ARRAY_BEGIN,
+  JSON_TOK_ARRAY_END,
+  JSON_TOK_KEY,
+  JSON_TOK_STRING,
+  JSON_TOK_NUMBER,
+  JSON_TOK_TRUE,
+  JSON_TOK_FALSE,
+  JSON_TOK_NULL,
+  JSON_TOK_END,
+  JSON_TOK_ERROR,
+} json_tok_type_t;
+
+typedef struct {
+  json_tok_type_t type;
+  const char *start;
+  size_t len;
+  uint8_t depth; // container depth the token belongs to; 0 = top level
+} json_tok_t;
+
+typedef struct {
+  const char *cur;
+  const char *end;
+  uint8_t depth;
+  uint8_t expect;
+  uint32_t array_bits; // bit N set when the container at depth N+1 is an array
+} json_scanner_t;
+
+typedef enum {
+  JSON_FIELD_STRING = 0, // char[] member, decoded and NUL-terminated
+  JSON_FIELD_FLOAT,      // float member
+  JSON_FIELD_INT,        // int32_t member, rejects fractions and overflow
+  JSON_FIELD_BOOL,       // bool member
+} json_field_type_t;
+
+/**
+ * Descriptor for one top-level key extracted by json_scan_fields(). Build
+ * tables with JSON_FIELD() so offsets and sizes follow the target struct.
+ */
+typedef struct {
+  const char *key;
+  json_field_type_t type;
+  size_t offset;
+  size_t size;
+} json_field_t;
+
+#define JSON_FIELD(struct_type, json_key, field_type, member)                    \
+  {                                                                              \
+    .key = (json_key), .type = (field_type), .offset = offsetof(struct_type, member), \
+    .size = sizeof(((struct_type *)0)->member),                                  \
+  }
+
+void json_scanner_init(json_scanner_t *scanner, const char *json, size_t len);
+
+/**
+ * @brief Advances to the next token.
+ *
+ * @return true while tokens remain; false once tok->type is JSON_TOK_END
+ *         (complete document) or JSON_TOK_ERROR (malformed input).
+ */
+bool json_scanner_next(json_scanner_t *scanner, json_tok_t *tok);
+
+/**
+ * @brief Skips the value that starts with tok (a scalar, or a whole object or
+ *        array when tok opens one).
+ */
+bool json_scanner_skip(json_scanner_t *scanner, const json_tok_t *tok);
+
+bool json_tok_equals(const json_tok_t *tok, const char *literal);
+bool json_tok_to_float(const json_tok_t *tok, float *out_value);
+bool json_tok_to_int32(const json_tok_t *tok, int32_t *out_value);
+
+/**
+ * @brief Decodes a string or key token into dst.
+ *
+ * \uXXXX escapes outside ASCII are replaced with '?'.
+ *
+ * @return false on a malformed escape or if dst is too small.
+ */
+bool json_tok_copy_string(const json_tok_t *tok, char *dst, size_t dst_len);
+
+/**
+ * @brief Parses a Home Assistant state payload that must be exactly one
+ *        number, surrounding whitespace allowed.
+ *
+ * Accepts whatever strtof() does, not just JSON numbers: "+21", ".5", "21."
+ * and hex floats parse as they always have. Infinities, NaN and numbers
+ * longer than 31 characters are rejected.
+ */
+bool json_parse_number(const char *json, size_t len, float *out_value);
+
+/**
+ * @brief Extracts top-level object keys into out using a descriptor table.
+ *
+ * Unknown keys and nested values are skipped. A key whose value has the wrong
+ * type (or is null) is left untouched and not reported as found.
+ *
+ * @param found_mask Optional; bit i is set when fields[i] was extracted.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for bad arguments or too many fields,
+ *         ESP_ERR_INVALID_RESPONSE for malformed JSON or a non-object root,
+ *         ESP_ERR_INVALID_SIZE if a string does not fit its member.
+ */
+esp_err_t json_scan_fields(const char *json,
+                           size_t len,
+                           const json_field_t *fields,
+                           size_t field_count,
+                           void *out,
+                           uint32_t *found_mask);
+
+#ifdef __cplusplus
+}
+#endif
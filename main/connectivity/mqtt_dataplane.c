@@ -1,8 +1,5 @@
 #include "connectivity/mqtt_dataplane.h"
 
-#include <ctype.h>
-#include <math.h>
-#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -21,12 +18,17 @@
 
 #include "connectivity/mqtt_manager.h"
 #include "connectivity/device_identity.h"
+#include "connectivity/fragment_reassembly.h"
+#include "connectivity/json_scan.h"
+#include "connectivity/topic_router.h"
 #include "sensors/radar_presence.h"
+#include "streaming/camera_snapshot_publisher.h"
 #include "thermostat/ui_actions.h"
 #include "thermostat/ui_setpoint_view.h"
 #include "thermostat/ui_state.h"
 #include "thermostat/ui_top_bar.h"
 #include "thermostat/remote_setpoint_controller.h"
+#include "thermostat/led_program_store.h"
 #include "thermostat/thermostat_led_status.h"
 #include "thermostat/thermostat_personal_presence.h"
 
@@ -102,16 +104,56 @@ LV_IMG_DECLARE(room_default);
 #define MQTT_DP_MAX_SETPOINT_C         (35.0f)
 #define MQTT_DP_VALUE_EPSILON          (0.05f)
 #define MQTT_DP_STATUS_BUFFER_LEN      (96)
+#define MQTT_DP_COMMAND_NAME_LEN       (32)
 #define MQTT_DP_DIGEST_INTERVAL_US     (60LL * 1000LL * 1000LL)
+#define MQTT_DP_REASSEMBLY_SLOTS       (3)
+#define MQTT_DP_REASSEMBLY_TIMEOUT_US  (2LL * 1000LL * 1000LL)
+// One slab per queue slot, plus one being processed by the task and one held
+// as the head of each in-progress reassembly.
+#define MQTT_DP_SLAB_COUNT             (MQTT_DP_QUEUE_DEPTH + 1 + MQTT_DP_REASSEMBLY_SLOTS)
+#define MQTT_DP_SLAB_NONE              (UINT8_MAX)
+// The low lane keeps the tuned queue depth. The high lane is sized past the
+// slab pool (plus control messages) so it only ever runs short of slabs, and
+// those are reclaimed by shedding low-lane entries.
+#define MQTT_DP_LOW_LANE_DEPTH         (MQTT_DP_QUEUE_DEPTH)
+#define MQTT_DP_HIGH_LANE_DEPTH        (MQTT_DP_SLAB_COUNT + 2)
+#define MQTT_DP_TOPIC_NONE             (UINT8_MAX)
+// Up to this many routes, dispatch scans the full topics, rejecting on length
+// first; that beats hashing a long HA suffix (scripts/topic_router_bench.c
+// puts the crossover just under 32 routes on a host). Past it the seeded
+// topic router takes over.
+#define MQTT_DP_SCAN_MAX_ROUTES        (24)
+// Router slots must stay a power of two and at least twice the routed topic
+// count so the seed search reliably finds a collision-free placement.
+#define MQTT_DP_ROUTER_SLOTS           (32)
+#define MQTT_DP_ROUTER_SEED_ATTEMPTS   (256)
+// Upper bound on messages drained per LVGL commit so a flood cannot starve
+// the UI of staged updates indefinitely.
+#define MQTT_DP_BATCH_MAX              (MQTT_DP_QUEUE_DEPTH * 2)
+// Latency histograms use power-of-two buckets: bucket 0 holds samples below
+// 128 us, bucket N holds [2^(N+6), 2^(N+7)) us and the last one everything
+// from ~2 s up.
+#define MQTT_DP_LAT_BUCKETS            (16)
+#define MQTT_DP_LAT_BUCKET0_SHIFT      (7)
+#define MQTT_DP_DIAG_PAYLOAD_LEN       (1536)
 
 static const char *TAG = "mqtt_dp";
 
 typedef enum {
     DP_MSG_CONNECTED = 0,
-    DP_MSG_DISCONNECTED,
     DP_MSG_FRAGMENT,
+    DP_MSG_LATEST,
 } dp_msg_type_t;
 
+// Setpoint, HVAC, command and control traffic rides the high lane and is
+// never dropped while the low lane still holds entries to shed. Low-lane
+// single-fragment messages coalesce per topic, so only the latest survives.
+typedef enum {
+    DP_LANE_HIGH = 0,
+    DP_LANE_LOW,
+    DP_LANE_COUNT,
+} dp_lane_t;
+
 typedef enum {
     TOPIC_WEATHER_TEMP = 0,
     TOPIC_WEATHER_ICON,
@@ -125,6 +167,7 @@ typedef enum {
     TOPIC_PERSONAL_FACE,
     TOPIC_PERSONAL_COUNT,
     TOPIC_COMMAND,
+    TOPIC_LED_PROGRAM,
 } topic_id_t;
 
 typedef struct {
@@ -132,21 +175,27 @@ typedef struct {
     topic_id_t id;
     bool subscribe;
     int qos;
+    dp_lane_t lane;
     bool seen;
     char topic[MQTT_DP_MAX_TOPIC_LEN];
     size_t topic_len;
 } topic_desc_t;
 
+typedef enum {
+    ROUTE_NS_HA = 0,
+    ROUTE_NS_THEO,
+} route_ns_t;
+
+// What a routed topic dispatches to. The scan matches the full topic; the
+// router keys each one on the suffix after either the HA base (`<HABase>/`)
+// or the Theo device root (`<TheoBase>/<slug>/`) and returns its index in
+// s_routes.
 typedef struct {
-    bool active;
-    int msg_id;
-    size_t total_len;
-    size_t filled;
-    char topic[MQTT_DP_MAX_TOPIC_LEN + 1];
+    topic_id_t id;
+    topic_desc_t *desc;
+    const char *topic;
     size_t topic_len;
-    int64_t timestamp_us;
-    bool retain_flag;
-} reassembly_state_t;
+} topic_route_t;
 
 typedef enum {
     DP_DROP_OVERSIZE = 0,
@@ -154,80 +203,278 @@ typedef enum {
     DP_DROP_NONZERO_FIRST,
     DP_DROP_OVERLAP,
     DP_DROP_QUEUE_FULL,
+    DP_DROP_NO_SLAB,
     DP_DROP_REASON_COUNT,
 } dp_drop_reason_t;
 
+typedef struct {
+    uint32_t completed;
+    uint32_t drops;
+    uint32_t preempted;
+    uint32_t evicted;
+    uint32_t expired;
+} dp_slot_stats_t;
+
+typedef enum {
+    DP_LAT_CLASS_WEATHER = 0,
+    DP_LAT_CLASS_ROOM,
+    DP_LAT_CLASS_SETPOINT,
+    DP_LAT_CLASS_HVAC,
+    DP_LAT_CLASS_PRESENCE,
+    DP_LAT_CLASS_COUNT,
+} dp_lat_class_t;
+
+// Stages of a message's trip: event handler receipt -> task dequeue ->
+// LVGL lock acquired -> widgets updated, plus receipt -> updated end to end.
+typedef enum {
+    DP_LAT_STAGE_QUEUE = 0,
+    DP_LAT_STAGE_LOCK,
+    DP_LAT_STAGE_WIDGET,
+    DP_LAT_STAGE_E2E,
+    DP_LAT_STAGE_COUNT,
+} dp_lat_stage_t;
+
+typedef struct {
+    uint32_t buckets[DP_LAT_CLASS_COUNT][DP_LAT_STAGE_COUNT][MQTT_DP_LAT_BUCKETS];
+} dp_latency_hist_t;
+
+// Oldest message per class still waiting for the next staged commit. Later
+// messages of the same class coalesce into that commit, so the oldest one
+// carries the worst-case latency for the batch.
+typedef struct {
+    bool pending;
+    int64_t receipt_us;
+    int64_t dequeue_us;
+} dp_latency_pending_t;
+
+typedef struct {
+    uint32_t enqueued;
+    uint32_t drops;
+    uint32_t coalesced;
+    uint32_t shed;
+} dp_lane_stats_t;
+
 typedef struct {
     uint32_t drops[DP_DROP_REASON_COUNT];
     uint32_t preempted_flows;
     uint32_t accepted_fragments;
     uint32_t completed_messages;
+    uint32_t payload_copies;
+    uint32_t staged_updates;
+    uint32_t commit_batches;
+    uint32_t lvgl_locks;
+    uint32_t widget_updates;
+    dp_slot_stats_t slots[MQTT_DP_REASSEMBLY_SLOTS];
+    dp_lane_stats_t lanes[DP_LANE_COUNT];
 } dp_stats_snapshot_t;
 
+enum {
+    DP_DIRTY_WEATHER_TEMP = (1u << 0),
+    DP_DIRTY_WEATHER_ICON = (1u << 1),
+    DP_DIRTY_ROOM_TEMP = (1u << 2),
+    DP_DIRTY_ROOM_NAME = (1u << 3),
+    DP_DIRTY_FAN = (1u << 4),
+    DP_DIRTY_HEAT = (1u << 5),
+    DP_DIRTY_COOL = (1u << 6),
+    DP_DIRTY_HVAC_STATUS = (1u << 7),
+    DP_DIRTY_SETPOINT_LOW = (1u << 8),
+    DP_DIRTY_SETPOINT_HIGH = (1u << 9),
+};
+
+enum {
+    DP_WIDGET_WEATHER = (1u << 0),
+    DP_WIDGET_ROOM = (1u << 1),
+    DP_WIDGET_ACTION_BAR = (1u << 2),
+    DP_WIDGET_HVAC_STATUS = (1u << 3),
+    DP_WIDGET_SETPOINT_LABELS = (1u << 4),
+};
+
+// Parsed values waiting for the next batched commit into g_view_model. Only
+// the dataplane task touches this, so it needs no lock of its own.
 typedef struct {
-    dp_msg_type_t type;
-    union {
-        struct {
-            int msg_id;
-            size_t total_len;
-            size_t fragment_len;
-            size_t offset;
-            int64_t timestamp_us;
-            char topic[MQTT_DP_MAX_TOPIC_LEN + 1];
-            size_t topic_len;
-            uint8_t data[MQTT_DP_REASSEMBLY_PAYLOAD_CAP];
-            bool retained;
-            bool has_topic;
-        } fragment;
-    } payload;
+    uint32_t dirty;
+    bool weather_temp_ok;
+    float weather_temp_c;
+    const lv_img_dsc_t *weather_icon;
+    bool room_temp_ok;
+    float room_temp_c;
+    const lv_img_dsc_t *room_icon;
+    bool room_icon_error;
+    bool fan_ok;
+    bool fan_on;
+    bool heat_on;
+    bool cool_on;
+    bool hvac_error;
+    bool setpoint_ok[2];
+    float setpoint_c[2];
+} dp_staged_view_t;
+
+// Fragment buffers live in a fixed PSRAM slab pool. The event handler copies
+// a single-fragment message or the head of a fragmented one into a free slab,
+// and each continuation straight into its head's slab, so every fragment is
+// copied exactly once. Only the slab index of a whole message travels through
+// the FreeRTOS queue.
+typedef struct {
+    int msg_id;
+    size_t total_len;
+    size_t fragment_len;
+    size_t offset;
+    int64_t timestamp_us;
+    const topic_route_t *route;
+    char topic[MQTT_DP_MAX_TOPIC_LEN + 1];
+    size_t topic_len;
+    bool retained;
+    bool has_topic;
+    bool reassembled; // fragment_len covers the whole payload, assembled in place
+    uint8_t data[MQTT_DP_REASSEMBLY_PAYLOAD_CAP + 1];
+} dp_fragment_t;
+
+// DP_MSG_LATEST carries only a topic index; its slab is looked up in
+// s_latest_slab at dequeue time so newer values can replace it in place.
+typedef struct {
+    uint8_t type;
+    uint8_t slab;
+    uint8_t topic;
 } dp_queue_msg_t;
 
 
 static topic_desc_t s_topics[] = {
-    {"sensor/pirateweather_temperature/state", TOPIC_WEATHER_TEMP, true, 0, false, "", 0},
-    {"sensor/pirateweather_icon/state", TOPIC_WEATHER_ICON, true, 0, false, "", 0},
-    {"sensor/theoretical_thermostat_target_room_temperature/state", TOPIC_ROOM_TEMP, true, 0, false, "", 0},
-    {"climate/theoretical_thermostat_climate_control/target_temp_low", TOPIC_SETPOINT_LOW, true, 0, false, "", 0},
-    {"climate/theoretical_thermostat_climate_control/target_temp_high", TOPIC_SETPOINT_HIGH, true, 0, false, "", 0},
-    {"sensor/theoretical_thermostat_target_room_name/state", TOPIC_ROOM_NAME, true, 0, false, "", 0},
-    {"binary_sensor/theoretical_thermostat_computed_fan/state", TOPIC_FAN_STATE, true, 0, false, "", 0},
-    {"binary_sensor/theoretical_thermostat_computed_heat/state", TOPIC_HEAT_STATE, true, 0, false, "", 0},
-    {"binary_sensor/theoretical_thermostat_computed_a_c/state", TOPIC_COOL_STATE, true, 0, false, "", 0},
-    {"sensor/hallway_camera_last_recognized_face/state", TOPIC_PERSONAL_FACE, true, 0, false, "", 0},
-    {"sensor/hallway_camera_person_count/state", TOPIC_PERSONAL_COUNT, true, 0, false, "", 0},
+    {"sensor/pirateweather_temperature/state", TOPIC_WEATHER_TEMP, true, 0, DP_LANE_LOW, false, "", 0},
+    {"sensor/pirateweather_icon/state", TOPIC_WEATHER_ICON, true, 0, DP_LANE_LOW, false, "", 0},
+    {"sensor/theoretical_thermostat_target_room_temperature/state", TOPIC_ROOM_TEMP, true, 0, DP_LANE_LOW, false, "", 0},
+    {"climate/theoretical_thermostat_climate_control/target_temp_low", TOPIC_SETPOINT_LOW, true, 0, DP_LANE_HIGH, false, "", 0},
+    {"climate/theoretical_thermostat_climate_control/target_temp_high", TOPIC_SETPOINT_HIGH, true, 0, DP_LANE_HIGH, false, "", 0},
+    {"sensor/theoretical_thermostat_target_room_name/state", TOPIC_ROOM_NAME, true, 0, DP_LANE_LOW, false, "", 0},
+    {"binary_sensor/theoretical_thermostat_computed_fan/state", TOPIC_FAN_STATE, true, 0, DP_LANE_HIGH, false, "", 0},
+    {"binary_sensor/theoretical_thermostat_computed_heat/state", TOPIC_HEAT_STATE, true, 0, DP_LANE_HIGH, false, "", 0},
+    {"binary_sensor/theoretical_thermostat_computed_a_c/state", TOPIC_COOL_STATE, true, 0, DP_LANE_HIGH, false, "", 0},
+    {"sensor/hallway_camera_last_recognized_face/state", TOPIC_PERSONAL_FACE, true, 0, DP_LANE_LOW, false, "", 0},
+    {"sensor/hallway_camera_person_count/state", TOPIC_PERSONAL_COUNT, true, 0, DP_LANE_LOW, false, "", 0},
 };
 
-static QueueHandle_t s_msg_queue;
+_Static_assert(MQTT_DP_ROUTER_SLOTS >= 2 * (sizeof(s_topics) / sizeof(s_topics[0]) + 1),
+               "grow MQTT_DP_ROUTER_SLOTS with s_topics");
+_Static_assert((MQTT_DP_ROUTER_SLOTS & (MQTT_DP_ROUTER_SLOTS - 1)) == 0,
+               "MQTT_DP_ROUTER_SLOTS must be a power of two");
+
+#define MQTT_DP_TOPIC_COUNT            (sizeof(s_topics) / sizeof(s_topics[0]))
+
+static QueueHandle_t s_lane_queues[DP_LANE_COUNT];
+static uint32_t s_lane_hwm[DP_LANE_COUNT];
+static uint8_t s_latest_slab[MQTT_DP_TOPIC_COUNT];
+static portMUX_TYPE s_latest_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t s_slab_free_queue;
 static TaskHandle_t s_task_handle;
 static bool s_started;
 static bool s_topics_initialized;
-static reassembly_state_t s_reassembly;
-static EXT_RAM_BSS_ATTR uint8_t s_reassembly_payload[MQTT_DP_REASSEMBLY_PAYLOAD_CAP + 1];
+// Fragmented flows are tracked in a small table keyed by msg_id (all QoS 0
+// flows share id 0; see fragment_reassembly.h), owned by the event handler
+// (the MQTT task). The head fragment's slab doubles as the
+// reassembly buffer, so topic, retain flag and receipt timestamp are read from
+// it rather than duplicated.
+static fragment_slot_t s_reassembly_slots[MQTT_DP_REASSEMBLY_SLOTS];
+static fragment_reassembly_t s_reassembly;
+static EXT_RAM_BSS_ATTR dp_fragment_t s_slabs[MQTT_DP_SLAB_COUNT];
+static uint32_t s_slab_in_use_hwm;
+static dp_staged_view_t s_staged;
 static dp_stats_snapshot_t s_stats_total;
 static dp_stats_snapshot_t s_stats_prev;
 static int64_t s_digest_last_emit_us;
+static volatile bool s_digest_forced;
+static EXT_RAM_BSS_ATTR dp_latency_hist_t s_latency_total;
+static EXT_RAM_BSS_ATTR dp_latency_hist_t s_latency_prev;
+static dp_latency_pending_t s_latency_pending[DP_LAT_CLASS_COUNT];
+static int64_t s_latency_dequeue_us;
+static EXT_RAM_BSS_ATTR char s_diag_topic[MQTT_DP_MAX_TOPIC_LEN];
+static EXT_RAM_BSS_ATTR char s_diag_payload[MQTT_DP_DIAG_PAYLOAD_LEN];
+// Outbound command publish timing. esp_mqtt_client_publish holds the client
+// lock for the whole message, so this is what a setpoint change waits behind
+// while another task (the camera) is writing a large payload.
+static portMUX_TYPE s_publish_lat_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_publish_lat_count;
+static uint32_t s_publish_lat_max_us;
+static uint64_t s_publish_lat_sum_us;
 
 // Theo-owned device command topic is cached separately from HA subscriptions.
 static EXT_RAM_BSS_ATTR char s_command_topic[MQTT_DP_MAX_TOPIC_LEN];
 static size_t s_command_topic_len;
+static const char *const s_command_suffix = "command";
+// Binary LED programs (see thermostat/led_program.h) share the Theo root.
+static EXT_RAM_BSS_ATTR char s_led_program_topic[MQTT_DP_MAX_TOPIC_LEN];
+static size_t s_led_program_topic_len;
+static const char *const s_led_program_suffix = "led_program";
+
+// Routed topics, in match order. Past MQTT_DP_SCAN_MAX_ROUTES the router's
+// open-addressed table, seeded so every routed suffix lands in its own slot,
+// replaces the scan with one hash plus one compare.
+static topic_router_slot_t s_router_slots[MQTT_DP_ROUTER_SLOTS];
+static topic_router_t s_router;
+static bool s_router_enabled;
+static topic_route_t s_routes[MQTT_DP_TOPIC_COUNT + 2];
+static size_t s_route_count;
+static char s_ha_prefix[MQTT_DP_MAX_TOPIC_LEN + 1];
+static size_t s_ha_prefix_len;
+static char s_theo_prefix[MQTT_DP_MAX_TOPIC_LEN + 1];
+static size_t s_theo_prefix_len;
 
 static void mqtt_dataplane_task(void *arg);
 static void mqtt_dataplane_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void handle_connected_event(void);
 static void handle_fragment_message(dp_queue_msg_t *msg);
+static void fill_slab(uint8_t slab,
+                      esp_mqtt_event_handle_t event,
+                      const topic_route_t *route,
+                      bool has_topic,
+                      size_t total_len);
+static void ingest_fragment(esp_mqtt_event_handle_t event,
+                            const topic_route_t *route,
+                            bool has_topic,
+                            size_t total_len);
 static void init_topic_strings(void);
-static topic_desc_t *match_topic(const char *topic, size_t topic_len);
+static void init_command_topic(void);
+static void build_topic_routes(void);
+static const topic_route_t *route_topic(const char *topic, size_t topic_len);
+static void dispatch_message(const topic_route_t *route,
+                             char *payload,
+                             size_t payload_len,
+                             bool retained,
+                             int64_t timestamp_us);
 static void process_payload(topic_desc_t *desc, char *payload, size_t payload_len, bool retained, int64_t timestamp_us);
+static void stage_dirty(uint32_t bits);
+static void commit_staged_view(void);
 static void free_queue_message(dp_queue_msg_t *msg);
+static bool lane_queues_init(void);
+static void lane_queues_delete(void);
+static dp_lane_t lane_for_route(const topic_route_t *route, bool fragmented);
+static bool lane_send(dp_lane_t lane, const dp_queue_msg_t *msg);
+static bool lane_send_latest(uint8_t topic, uint8_t slab);
+static uint8_t take_latest_slab(uint8_t topic);
+static bool shed_low_lane(void);
+static size_t drain_lanes(size_t max_messages);
+static void emit_lane_digest(void);
+static bool slab_pool_init(void);
+static uint8_t slab_acquire(void);
+static void slab_release(uint8_t slab);
 static const char *drop_reason_to_str(dp_drop_reason_t reason);
 static void record_drop(dp_drop_reason_t reason,
                         int msg_id,
                         size_t offset,
                         size_t len,
                         size_t total_len);
-static void reset_reassembly_state(void);
-static void start_reassembly(dp_queue_msg_t *msg);
+static void on_reassembly_end(void *ctx, size_t idx, const fragment_slot_t *slot, fragment_end_reason_t reason);
+static void emit_reassembly_digest(void);
 static bool maybe_emit_digest(int64_t now_us);
+static dp_lat_class_t latency_class_for_topic(topic_id_t id);
+static const char *latency_class_to_str(dp_lat_class_t cls);
+static void latency_record(dp_lat_class_t cls, dp_lat_stage_t stage, int64_t elapsed_us);
+static void latency_mark_staged(topic_id_t id, int64_t receipt_us);
+static void latency_record_commit(int64_t lock_us, int64_t updated_us);
+static uint32_t latency_percentile_us(const uint32_t *delta, uint32_t count, uint32_t pct);
+static uint32_t latency_window(dp_lat_class_t cls, dp_lat_stage_t stage, uint32_t delta[MQTT_DP_LAT_BUCKETS]);
+static void emit_latency_digest(void);
+static void record_command_publish(int64_t elapsed_us);
+static void emit_publish_latency_digest(void);
+static void publish_diag_digest(int64_t elapsed_us);
 static bool clamp_setpoint(float *value);
 static const lv_img_dsc_t *icon_for_weather_icon_name(const char *summary);
 static const lv_img_dsc_t *icon_for_room_name(const char *name, bool *is_error);
@@ -246,7 +493,7 @@ esp_err_t mqtt_dataplane_start(mqtt_dataplane_status_cb_t status_cb, void *ctx)
 
     ESP_LOGI(TAG,
              "mqtt_dataplane_start begin (queue=%p task=%p started=%d topics_init=%d)",
-             (void *)s_msg_queue,
+             (void *)s_lane_queues[DP_LANE_HIGH],
              (void *)s_task_handle,
              s_started,
              s_topics_initialized);
@@ -261,29 +508,54 @@ esp_err_t mqtt_dataplane_start(mqtt_dataplane_status_cb_t status_cb, void *ctx)
     esp_mqtt_client_handle_t client = mqtt_manager_get_client();
     ESP_RETURN_ON_FALSE(client != NULL, ESP_ERR_INVALID_STATE, TAG, "MQTT client not ready");
 
-    memset(&s_reassembly, 0, sizeof(s_reassembly));
-    memset(s_reassembly_payload, 0, sizeof(s_reassembly_payload));
+    fragment_reassembly_init(&s_reassembly,
+                             s_reassembly_slots,
+                             MQTT_DP_REASSEMBLY_SLOTS,
+                             MQTT_DP_REASSEMBLY_PAYLOAD_CAP,
+                             MQTT_DP_REASSEMBLY_TIMEOUT_US,
+                             on_reassembly_end,
+                             NULL);
+    memset(&s_staged, 0, sizeof(s_staged));
     memset(&s_stats_total, 0, sizeof(s_stats_total));
     memset(&s_stats_prev, 0, sizeof(s_stats_prev));
+    memset(&s_latency_total, 0, sizeof(s_latency_total));
+    memset(&s_latency_prev, 0, sizeof(s_latency_prev));
+    memset(s_latency_pending, 0, sizeof(s_latency_pending));
     s_digest_last_emit_us = esp_timer_get_time();
 
-    s_msg_queue = xQueueCreate(MQTT_DP_QUEUE_DEPTH, sizeof(dp_queue_msg_t));
-    ESP_RETURN_ON_FALSE(s_msg_queue != NULL, ESP_ERR_NO_MEM, TAG, "queue alloc failed");
+    ESP_RETURN_ON_FALSE(slab_pool_init(), ESP_ERR_NO_MEM, TAG, "slab free list alloc failed");
+
+    if (!lane_queues_init()) {
+        lane_queues_delete();
+        vQueueDelete(s_slab_free_queue);
+        s_slab_free_queue = NULL;
+        ESP_LOGE(TAG, "queue alloc failed");
+        return ESP_ERR_NO_MEM;
+    }
     ESP_LOGI(TAG,
-             "dataplane queue created depth=%d item_size=%zu handle=%p",
-             MQTT_DP_QUEUE_DEPTH,
+             "dataplane lanes created high_depth=%d low_depth=%d item_size=%zu slabs=%d slab_size=%zu pool_b=%zu",
+             MQTT_DP_HIGH_LANE_DEPTH,
+             MQTT_DP_LOW_LANE_DEPTH,
              sizeof(dp_queue_msg_t),
-             (void *)s_msg_queue);
+             MQTT_DP_SLAB_COUNT,
+             sizeof(dp_fragment_t),
+             sizeof(s_slabs));
 
     thermostat_personal_presence_init();
 
     init_topic_strings();
     ESP_LOGI(TAG, "topic strings initialized (count=%zu)", sizeof(s_topics) / sizeof(s_topics[0]));
+    // Routing happens at ingress on the MQTT task, so the routes are built
+    // once, complete, before the event handler is registered and are never
+    // written again. Device identity is initialized before this point.
+    init_command_topic();
+    build_topic_routes();
 
     esp_err_t err = esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, mqtt_dataplane_event_handler, NULL);
     if (err != ESP_OK) {
-        vQueueDelete(s_msg_queue);
-        s_msg_queue = NULL;
+        lane_queues_delete();
+        vQueueDelete(s_slab_free_queue);
+        s_slab_free_queue = NULL;
         return err;
     }
     ESP_LOGI(TAG, "mqtt_dataplane_event_handler registered (client=%p)", (void *)client);
@@ -298,8 +570,9 @@ esp_err_t mqtt_dataplane_start(mqtt_dataplane_status_cb_t status_cb, void *ctx)
                                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (task_ok != pdPASS) {
         esp_mqtt_client_unregister_event(client, MQTT_EVENT_ANY, mqtt_dataplane_event_handler);
-        vQueueDelete(s_msg_queue);
-        s_msg_queue = NULL;
+        lane_queues_delete();
+        vQueueDelete(s_slab_free_queue);
+        s_slab_free_queue = NULL;
         ESP_LOGE(TAG, "failed to create dataplane task");
         return ESP_ERR_NO_MEM;
     }
@@ -316,8 +589,10 @@ esp_err_t mqtt_dataplane_start(mqtt_dataplane_status_cb_t status_cb, void *ctx)
     if (mqtt_manager_is_ready()) {
         dp_queue_msg_t ready_msg = {
             .type = DP_MSG_CONNECTED,
+            .slab = MQTT_DP_SLAB_NONE,
+            .topic = MQTT_DP_TOPIC_NONE,
         };
-        if (xQueueSend(s_msg_queue, &ready_msg, 0) == pdTRUE) {
+        if (lane_send(DP_LANE_HIGH, &ready_msg)) {
             ESP_LOGI(TAG, "mqtt manager already connected; injected DP_MSG_CONNECTED for subscriptions");
         } else {
             ESP_LOGW(TAG, "mqtt manager connected but queue full; subscriptions will wait for next event");
@@ -365,13 +640,17 @@ esp_err_t mqtt_dataplane_publish_temperature_command(float cooling_setpoint_c, f
                            low);
     ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(payload), ESP_ERR_INVALID_SIZE, TAG, "payload overflow");
 
+    const int64_t publish_start_us = esp_timer_get_time();
     int msg_id = esp_mqtt_client_publish(client, command_topic, payload, 0, 1, 0);
+    const int64_t publish_us = esp_timer_get_time() - publish_start_us;
     if (msg_id < 0) {
         ESP_LOGE(TAG, "temperature_command publish failed (err=%d)", msg_id);
         return ESP_FAIL;
     }
+    record_command_publish(publish_us);
 
-    ESP_LOGI(TAG, "temperature_command msg_id=%d topic=%s payload=%s", msg_id, command_topic, payload);
+    ESP_LOGI(TAG, "temperature_command msg_id=%d publish_us=%lld topic=%s payload=%s",
+             msg_id, (long long)publish_us, command_topic, payload);
     return ESP_OK;
 }
 
@@ -490,7 +769,7 @@ size_t mqtt_dataplane_get_task_stack_size_bytes(void)
 
 size_t mqtt_dataplane_get_queue_depth(void)
 {
-    return MQTT_DP_QUEUE_DEPTH;
+    return MQTT_DP_HIGH_LANE_DEPTH + MQTT_DP_LOW_LANE_DEPTH;
 }
 
 size_t mqtt_dataplane_get_queue_item_size_bytes(void)
@@ -509,112 +788,245 @@ bool mqtt_dataplane_wave2_queue_tuning_enabled(void)
 
 static void mqtt_dataplane_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
-    if (!s_started || s_msg_queue == NULL) {
+    if (!s_started || s_lane_queues[DP_LANE_HIGH] == NULL) {
         return;
     }
     esp_mqtt_event_handle_t event = event_data;
-    dp_queue_msg_t msg = {0};
+    dp_queue_msg_t msg = {
+        .slab = MQTT_DP_SLAB_NONE,
+        .topic = MQTT_DP_TOPIC_NONE,
+    };
 
     switch (event_id) {
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED msg_id=%d", event ? event->msg_id : -1);
         msg.type = DP_MSG_CONNECTED;
-        if (xQueueSend(s_msg_queue, &msg, 0) != pdTRUE) {
+        if (!lane_send(DP_LANE_HIGH, &msg)) {
             ESP_LOGW(TAG, "queue send failed (MQTT_EVENT_CONNECTED)");
         }
         break;
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "MQTT_EVENT_DISCONNECTED msg_id=%d", event ? event->msg_id : -1);
-        msg.type = DP_MSG_DISCONNECTED;
-        if (xQueueSend(s_msg_queue, &msg, 0) != pdTRUE) {
-            ESP_LOGW(TAG, "queue send failed (MQTT_EVENT_DISCONNECTED)");
-        }
+        // Fragments of in-flight messages will never arrive after a drop.
+        fragment_reassembly_reset(&s_reassembly);
         break;
-    case MQTT_EVENT_DATA:
-        msg.type = DP_MSG_FRAGMENT;
-        msg.payload.fragment.msg_id = event->msg_id;
-        msg.payload.fragment.total_len = (event->total_data_len > 0) ? event->total_data_len : event->data_len;
-        msg.payload.fragment.fragment_len = event->data_len;
-        msg.payload.fragment.offset = event->current_data_offset;
-        msg.payload.fragment.timestamp_us = esp_timer_get_time();
-        msg.payload.fragment.topic_len = 0;
-        msg.payload.fragment.topic[0] = '\0';
-        msg.payload.fragment.retained = event->retain;
-        msg.payload.fragment.has_topic = false;
-
-        if (msg.payload.fragment.total_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP ||
-            msg.payload.fragment.fragment_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP) {
-            record_drop(DP_DROP_OVERSIZE,
-                        msg.payload.fragment.msg_id,
-                        msg.payload.fragment.offset,
-                        msg.payload.fragment.fragment_len,
-                        msg.payload.fragment.total_len);
+    case MQTT_EVENT_DATA: {
+        const int msg_id = event->msg_id;
+        const size_t total_len = (event->total_data_len > 0) ? event->total_data_len : event->data_len;
+        const size_t fragment_len = event->data_len;
+        const size_t offset = event->current_data_offset;
+        const bool has_topic = event->topic && event->topic_len > 0 && event->current_data_offset == 0;
+
+        if (total_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP || fragment_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP) {
+            record_drop(DP_DROP_OVERSIZE, msg_id, offset, fragment_len, total_len);
+            break;
+        }
+        if (has_topic && event->topic_len > MQTT_DP_MAX_TOPIC_LEN) {
+            record_drop(DP_DROP_OVERSIZE, msg_id, offset, fragment_len, total_len);
+            break;
+        }
+        if (offset + fragment_len > total_len) {
+            record_drop(DP_DROP_OVERSIZE, msg_id, offset, fragment_len, total_len);
             break;
         }
 
-        if (event->topic && event->topic_len > 0 && event->current_data_offset == 0) {
-            if (event->topic_len > MQTT_DP_MAX_TOPIC_LEN) {
-                record_drop(DP_DROP_OVERSIZE,
-                            msg.payload.fragment.msg_id,
-                            msg.payload.fragment.offset,
-                            msg.payload.fragment.fragment_len,
-                            msg.payload.fragment.total_len);
-                break;
-            }
-
-            memcpy(msg.payload.fragment.topic, event->topic, event->topic_len);
-            msg.payload.fragment.topic[event->topic_len] = '\0';
-            msg.payload.fragment.topic_len = (size_t)event->topic_len;
-            msg.payload.fragment.has_topic = true;
+        const topic_route_t *route = has_topic ? route_topic(event->topic, (size_t)event->topic_len) : NULL;
+        const bool fragmented = total_len > fragment_len;
+        if (has_topic && route == NULL && !fragmented) {
+            // Not ours (e.g. retained discovery echoes for ha_discovery's
+            // cache check); dispatch would discard it, so skip the slab.
+            break;
         }
+        if (fragmented) {
+            ingest_fragment(event, route, has_topic, total_len);
+            break;
+        }
+        const dp_lane_t lane = lane_for_route(route, false);
 
-        if (msg.payload.fragment.offset + msg.payload.fragment.fragment_len > msg.payload.fragment.total_len) {
-            record_drop(DP_DROP_OVERSIZE,
-                        msg.payload.fragment.msg_id,
-                        msg.payload.fragment.offset,
-                        msg.payload.fragment.fragment_len,
-                        msg.payload.fragment.total_len);
+        uint8_t slab = slab_acquire();
+        while (slab == MQTT_DP_SLAB_NONE && lane == DP_LANE_HIGH && shed_low_lane()) {
+            slab = slab_acquire();
+        }
+        if (slab == MQTT_DP_SLAB_NONE) {
+            s_stats_total.lanes[lane].drops++;
+            record_drop(DP_DROP_NO_SLAB, msg_id, offset, fragment_len, total_len);
             break;
         }
 
-        if (event->data_len > 0 && event->data != NULL) {
-            memcpy(msg.payload.fragment.data, event->data, event->data_len);
+        fill_slab(slab, event, route, has_topic, total_len);
+
+        bool queued = false;
+        if (lane == DP_LANE_LOW && route != NULL && route->desc != NULL) {
+            queued = lane_send_latest((uint8_t)(route->desc - s_topics), slab);
+        } else {
+            msg.type = DP_MSG_FRAGMENT;
+            msg.slab = slab;
+            queued = lane_send(lane, &msg);
+            if (!queued) {
+                slab_release(slab);
+            }
         }
+        if (!queued) {
+            s_stats_total.lanes[lane].drops++;
+            record_drop(DP_DROP_QUEUE_FULL, msg_id, offset, fragment_len, total_len);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Copies a single-fragment message, or the head of a fragmented one, into a
+// free slab along with its topic and receipt metadata.
+static void fill_slab(uint8_t slab,
+                      esp_mqtt_event_handle_t event,
+                      const topic_route_t *route,
+                      bool has_topic,
+                      size_t total_len)
+{
+    const size_t fragment_len = event->data_len;
+    dp_fragment_t *frag = &s_slabs[slab];
+    frag->msg_id = event->msg_id;
+    frag->total_len = total_len;
+    frag->fragment_len = fragment_len;
+    frag->offset = event->current_data_offset;
+    frag->timestamp_us = esp_timer_get_time();
+    frag->route = route;
+    frag->retained = event->retain;
+    frag->has_topic = has_topic;
+    frag->reassembled = false;
+    frag->topic_len = 0;
+    frag->topic[0] = '\0';
+    if (has_topic) {
+        memcpy(frag->topic, event->topic, event->topic_len);
+        frag->topic[event->topic_len] = '\0';
+        frag->topic_len = (size_t)event->topic_len;
+    }
+    if (fragment_len > 0 && event->data != NULL) {
+        memcpy(frag->data, event->data, fragment_len);
+        s_stats_total.payload_copies++;
+    }
+    frag->data[fragment_len] = '\0';
+}
 
-        if (xQueueSend(s_msg_queue, &msg, 0) != pdTRUE) {
-            record_drop(DP_DROP_QUEUE_FULL,
-                        msg.payload.fragment.msg_id,
-                        msg.payload.fragment.offset,
-                        msg.payload.fragment.fragment_len,
-                        msg.payload.fragment.total_len);
+// Reassembly runs here on the MQTT task rather than in the dataplane task, so
+// a continuation is copied once, straight from the event into its head's
+// slab at its offset. The finished payload is queued from on_reassembly_end.
+static void ingest_fragment(esp_mqtt_event_handle_t event,
+                            const topic_route_t *route,
+                            bool has_topic,
+                            size_t total_len)
+{
+    const size_t fragment_len = event->data_len;
+    fragment_t fragment = {
+        .msg_id = event->msg_id,
+        .offset = event->current_data_offset,
+        .len = fragment_len,
+        .total_len = total_len,
+        .now_us = esp_timer_get_time(),
+        .head = has_topic,
+        .data = (event->data != NULL) ? (const uint8_t *)event->data : (const uint8_t *)"",
+        .buffer = MQTT_DP_SLAB_NONE,
+    };
+    if (fragment.head) {
+        // Fragmented messages take the low lane, so there is nothing to shed.
+        const uint8_t slab = slab_acquire();
+        if (slab == MQTT_DP_SLAB_NONE) {
+            s_stats_total.lanes[DP_LANE_LOW].drops++;
+            record_drop(DP_DROP_NO_SLAB, fragment.msg_id, fragment.offset, fragment_len, total_len);
+            return;
+        }
+        fill_slab(slab, event, route, has_topic, total_len);
+        fragment.buffer = slab;
+        fragment.buffer_data = s_slabs[slab].data;
+        fragment.data = s_slabs[slab].data;
+    }
+
+    switch (fragment_reassembly_push(&s_reassembly, &fragment, NULL)) {
+    case FRAGMENT_RESULT_STARTED:
+        // The flow adopted the head fragment's slab.
+        s_stats_total.accepted_fragments++;
+        return;
+    case FRAGMENT_RESULT_APPENDED:
+    case FRAGMENT_RESULT_COMPLETE:
+        s_stats_total.accepted_fragments++;
+        if (!fragment.head && fragment_len > 0) {
+            s_stats_total.payload_copies++;
+        }
+        return;
+    case FRAGMENT_RESULT_NONZERO_FIRST:
+        record_drop(DP_DROP_NONZERO_FIRST, fragment.msg_id, fragment.offset, fragment_len, total_len);
+        break;
+    case FRAGMENT_RESULT_OVERLAP:
+        record_drop(DP_DROP_OVERLAP, fragment.msg_id, fragment.offset, fragment_len, total_len);
+        break;
+    case FRAGMENT_RESULT_OUT_OF_ORDER:
+        record_drop(DP_DROP_OUT_OF_ORDER, fragment.msg_id, fragment.offset, fragment_len, total_len);
+        break;
+    case FRAGMENT_RESULT_OVERSIZE:
+        record_drop(DP_DROP_OVERSIZE, fragment.msg_id, fragment.offset, fragment_len, total_len);
+        break;
+    }
+    // A rejected head keeps its slab.
+    slab_release(fragment.buffer);
+}
+
+static void handle_queue_message(dp_queue_msg_t *msg)
+{
+    switch (msg->type) {
+    case DP_MSG_CONNECTED:
+        handle_connected_event();
+        break;
+    case DP_MSG_FRAGMENT:
+        s_latency_dequeue_us = esp_timer_get_time();
+        handle_fragment_message(msg);
+        break;
+    case DP_MSG_LATEST:
+        msg->slab = take_latest_slab(msg->topic);
+        if (msg->slab != MQTT_DP_SLAB_NONE) {
+            s_latency_dequeue_us = esp_timer_get_time();
+            handle_fragment_message(msg);
         }
         break;
     default:
+        ESP_LOGW(TAG, "Unhandled queue msg type=%d", msg->type);
         break;
     }
+    free_queue_message(msg);
 }
 
-static void mqtt_dataplane_task(void *arg)
+static size_t drain_lanes(size_t max_messages)
 {
     dp_queue_msg_t msg = {0};
-    while (true) {
-        if (xQueueReceive(s_msg_queue, &msg, portMAX_DELAY) != pdTRUE) {
-            ESP_LOGW(TAG, "dataplane queue receive failed");
-            continue;
-        }
-        switch (msg.type) {
-        case DP_MSG_CONNECTED:
-            handle_connected_event();
-            break;
-        case DP_MSG_FRAGMENT:
-            handle_fragment_message(&msg);
-            break;
-        default:
-            ESP_LOGW(TAG, "Unhandled queue msg type=%d", msg.type);
+    size_t handled = 0;
+    while (handled < max_messages) {
+        // Re-check the high lane before every low-lane message so a setpoint
+        // that lands mid-burst is handled next rather than behind the burst.
+        if (xQueueReceive(s_lane_queues[DP_LANE_HIGH], &msg, 0) != pdTRUE &&
+            xQueueReceive(s_lane_queues[DP_LANE_LOW], &msg, 0) != pdTRUE) {
             break;
         }
-        free_queue_message(&msg);
-        memset(&msg, 0, sizeof(msg));
+        handle_queue_message(&msg);
+        handled++;
+    }
+    return handled;
+}
+
+static void mqtt_dataplane_task(void *arg)
+{
+    while (true) {
+        // Ingress notifies once per enqueued message; the count is consumed
+        // here and the lanes drained until empty.
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Drain whatever else is already queued (e.g. a retained-topic replay
+        // after reconnect) before touching LVGL, so the burst costs one lock.
+        size_t handled = 0;
+        do {
+            handled = drain_lanes(MQTT_DP_BATCH_MAX);
+            commit_staged_view();
+        } while (handled == MQTT_DP_BATCH_MAX);
     }
 }
 
@@ -628,10 +1040,22 @@ static void init_command_topic(void)
         ESP_LOGW(TAG, "Theo device topic root not available; command topic disabled");
         return;
     }
-    int written = snprintf(s_command_topic, sizeof(s_command_topic), "%s/command", device_root);
+    int written = snprintf(s_command_topic, sizeof(s_command_topic), "%s/%s", device_root, s_command_suffix);
     if (written > 0 && written < (int)sizeof(s_command_topic)) {
         s_command_topic_len = (size_t)written;
+        s_theo_prefix_len = s_command_topic_len - strlen(s_command_suffix);
+        memcpy(s_theo_prefix, s_command_topic, s_theo_prefix_len);
+        s_theo_prefix[s_theo_prefix_len] = '\0';
         ESP_LOGI(TAG, "command topic: %s", s_command_topic);
+        // Longer than the command topic, so it can overflow on its own.
+        written = snprintf(s_led_program_topic, sizeof(s_led_program_topic), "%s%s", s_theo_prefix, s_led_program_suffix);
+        if (written > 0 && written < (int)sizeof(s_led_program_topic)) {
+            s_led_program_topic_len = (size_t)written;
+        } else {
+            ESP_LOGW(TAG, "led_program topic overflow; LED programs over MQTT disabled");
+            s_led_program_topic[0] = '\0';
+            s_led_program_topic_len = 0;
+        }
     } else {
         ESP_LOGW(TAG, "command topic overflow");
         s_command_topic[0] = '\0';
@@ -660,8 +1084,7 @@ static void handle_connected_event(void)
         }
     }
 
-    // Initialize and subscribe to the Theo-owned device command topic.
-    init_command_topic();
+    // Subscribe to the Theo-owned device command topics, if the router has them.
     if (s_command_topic_len > 0) {
         int msg_id = esp_mqtt_client_subscribe(client, s_command_topic, 0);
         if (msg_id < 0) {
@@ -670,6 +1093,14 @@ static void handle_connected_event(void)
             ESP_LOGI(TAG, "subscribed topic=%s msg_id=%d", s_command_topic, msg_id);
         }
     }
+    if (s_led_program_topic_len > 0) {
+        int msg_id = esp_mqtt_client_subscribe(client, s_led_program_topic, 1);
+        if (msg_id < 0) {
+            ESP_LOGW(TAG, "subscribe failed topic=%s", s_led_program_topic);
+        } else {
+            ESP_LOGI(TAG, "subscribed topic=%s msg_id=%d", s_led_program_topic, msg_id);
+        }
+    }
 }
 
 static void format_missing_state(char *buffer,
@@ -712,185 +1143,415 @@ static void format_missing_state(char *buffer,
     }
 }
 
-static void process_command(const char *payload, size_t payload_len)
+static void run_radar_dump_thresholds(void)
 {
-    char buffer[64];
-    size_t copy_len = (payload_len < sizeof(buffer) - 1) ? payload_len : (sizeof(buffer) - 1);
-    memcpy(buffer, payload, copy_len);
-    buffer[copy_len] = '\0';
-
-    if (strcmp(buffer, "rainbow") == 0) {
-        ESP_LOGI(TAG, "Received rainbow command");
-        thermostat_led_status_trigger_rainbow();
-    } else if (strcmp(buffer, "heatwave") == 0) {
-        ESP_LOGI(TAG, "Received heatwave command");
-        thermostat_led_status_trigger_heatwave();
-    } else if (strcmp(buffer, "coolwave") == 0) {
-        ESP_LOGI(TAG, "Received coolwave command");
-        thermostat_led_status_trigger_coolwave();
-    } else if (strcmp(buffer, "sparkle") == 0) {
-        ESP_LOGI(TAG, "Received sparkle command");
-        thermostat_led_status_trigger_sparkle();
-    } else if (strcmp(buffer, "restart") == 0) {
-        ESP_LOGI(TAG, "Received restart command");
-        esp_restart();
-    } else if (strcmp(buffer, "radar_dump_thresholds") == 0) {
-        ESP_LOGI(TAG, "Received radar_dump_thresholds command");
-        esp_err_t err = radar_presence_dump_thresholds();
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "radar_dump_thresholds failed: %s", esp_err_to_name(err));
-        }
-    } else if (strcmp(buffer, "radar_calibrate") == 0) {
-        ESP_LOGI(TAG, "Received radar_calibrate command");
-        esp_err_t err = radar_presence_start_calibration();
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "radar_calibrate failed: %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGW(TAG, "Unknown command: %s", buffer);
+    esp_err_t err = radar_presence_dump_thresholds();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "radar_dump_thresholds failed: %s", esp_err_to_name(err));
     }
 }
 
-static bool is_command_topic(const char *topic, size_t topic_len)
+static void run_radar_calibrate(void)
 {
-    return s_command_topic_len > 0 &&
-           topic_len == s_command_topic_len &&
-           strncmp(topic, s_command_topic, topic_len) == 0;
+    esp_err_t err = radar_presence_start_calibration();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "radar_calibrate failed: %s", esp_err_to_name(err));
+    }
 }
 
-static void handle_fragment_message(dp_queue_msg_t *msg)
+static void run_dataplane_digest(void)
 {
-    dp_queue_msg_t *m = msg;
-    if (m->payload.fragment.total_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP ||
-        m->payload.fragment.fragment_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP ||
-        m->payload.fragment.offset + m->payload.fragment.fragment_len > m->payload.fragment.total_len) {
-        record_drop(DP_DROP_OVERSIZE,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
+    // Close the current digest window on the next periodic tick instead of
+    // waiting out the full interval; replay runs use this to bracket a capture.
+    // The digest itself still runs from the tick so only one context reads
+    // and rolls the window.
+    s_digest_forced = true;
+}
+
+static void run_command_probe(void)
+{
+    // Publishes the same shape of message as a setpoint change (small, QoS 1)
+    // so command-path latency can be sampled on demand, e.g. while snapshots
+    // are streaming, without touching the HVAC.
+    esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+    const char *device_root = device_identity_get_theo_device_topic_root();
+    if (client == NULL || !mqtt_manager_is_ready() || device_root == NULL || device_root[0] == '\0') {
+        ESP_LOGW(TAG, "command_probe skipped: MQTT client unavailable");
+        return;
+    }
+
+    char topic[MQTT_DP_MAX_TOPIC_LEN];
+    int topic_len = snprintf(topic, sizeof(topic), "%s/command_probe", device_root);
+    if (topic_len <= 0 || topic_len >= (int)sizeof(topic)) {
+        ESP_LOGW(TAG, "command_probe topic overflow");
         return;
     }
+    char payload[48];
+    const int64_t publish_start_us = esp_timer_get_time();
+    int written = snprintf(payload, sizeof(payload), "{\"sent_us\":%lld}", (long long)publish_start_us);
+    int msg_id = esp_mqtt_client_publish(client, topic, payload, written, 1, 0);
+    const int64_t publish_us = esp_timer_get_time() - publish_start_us;
+    if (msg_id < 0) {
+        ESP_LOGW(TAG, "command_probe publish failed (err=%d)", msg_id);
+        return;
+    }
+    record_command_publish(publish_us);
+    ESP_LOGI(TAG, "command_probe msg_id=%d publish_us=%lld", msg_id, (long long)publish_us);
+}
 
-    if (m->payload.fragment.total_len <= m->payload.fragment.fragment_len) {
-        if (!m->payload.fragment.has_topic || m->payload.fragment.topic_len == 0) {
-            record_drop(DP_DROP_NONZERO_FIRST,
-                        m->payload.fragment.msg_id,
-                        m->payload.fragment.offset,
-                        m->payload.fragment.fragment_len,
-                        m->payload.fragment.total_len);
+static void run_camera_benchmark(void)
+{
+    esp_err_t err = camera_snapshot_publisher_request_benchmark();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "camera_benchmark unavailable: %s", esp_err_to_name(err));
+    }
+}
+
+typedef struct {
+    char name[MQTT_DP_COMMAND_NAME_LEN];
+} dp_command_t;
+
+static const json_field_t s_command_fields[] = {
+    JSON_FIELD(dp_command_t, "command", JSON_FIELD_STRING, name),
+};
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_commands[] = {
+    {"rainbow", thermostat_led_status_trigger_rainbow},
+    {"heatwave", thermostat_led_status_trigger_heatwave},
+    {"coolwave", thermostat_led_status_trigger_coolwave},
+    {"sparkle", thermostat_led_status_trigger_sparkle},
+    {"led_program", thermostat_led_status_trigger_program},
+    {"hearth", thermostat_led_status_trigger_hearth},
+    {"restart", esp_restart},
+    {"radar_dump_thresholds", run_radar_dump_thresholds},
+    {"radar_calibrate", run_radar_calibrate},
+    {"dataplane_digest", run_dataplane_digest},
+    {"command_probe", run_command_probe},
+    {"camera_benchmark", run_camera_benchmark},
+};
+
+static void process_command(const char *payload, size_t payload_len)
+{
+    // Commands arrive either as a bare name ("rainbow") or as a JSON object
+    // ({"command":"rainbow"}); both are matched straight out of the slab.
+    const char *name = payload;
+    size_t name_len = payload_len;
+    dp_command_t command = {0};
+    if (payload_len > 0 && payload[0] == '{') {
+        uint32_t found = 0;
+        esp_err_t err = json_scan_fields(payload,
+                                         payload_len,
+                                         s_command_fields,
+                                         sizeof(s_command_fields) / sizeof(s_command_fields[0]),
+                                         &command,
+                                         &found);
+        if (err != ESP_OK || (found & 1u) == 0) {
+            ESP_LOGW(TAG, "Invalid command payload (%s)", esp_err_to_name(err));
             return;
         }
+        name = command.name;
+        name_len = strlen(command.name);
+    }
 
-        s_stats_total.accepted_fragments++;
-        if (is_command_topic(m->payload.fragment.topic, m->payload.fragment.topic_len)) {
-            process_command((const char *)m->payload.fragment.data, m->payload.fragment.fragment_len);
-        } else {
-            process_payload(match_topic(m->payload.fragment.topic, m->payload.fragment.topic_len),
-                            (char *)m->payload.fragment.data,
-                            m->payload.fragment.fragment_len,
-                            m->payload.fragment.retained,
-                            m->payload.fragment.timestamp_us);
+    for (size_t i = 0; i < sizeof(s_commands) / sizeof(s_commands[0]); ++i) {
+        if (strlen(s_commands[i].name) == name_len && memcmp(s_commands[i].name, name, name_len) == 0) {
+            ESP_LOGI(TAG, "Received %s command", s_commands[i].name);
+            s_commands[i].run();
+            return;
         }
-        s_stats_total.completed_messages++;
+    }
+    ESP_LOGW(TAG, "Unknown command: %.*s", (int)(name_len < 64 ? name_len : 64), name);
+}
+
+static void process_led_program(const uint8_t *payload, size_t payload_len, bool retained)
+{
+    bool changed = false;
+    const char *reason = NULL;
+    if (led_program_store_install(payload, payload_len, &changed, &reason) != ESP_OK) {
+        ESP_LOGW(TAG, "LED program rejected: %s", reason != NULL ? reason : "unknown");
         return;
     }
+    // A retained program is redelivered on every reconnect; only preview it
+    // when it is new.
+    if (!retained || changed) {
+        thermostat_led_status_trigger_program();
+    }
+}
 
-    if (!s_reassembly.active) {
-        if (m->payload.fragment.offset != 0 || !m->payload.fragment.has_topic) {
-            record_drop(DP_DROP_NONZERO_FIRST,
-                        m->payload.fragment.msg_id,
-                        m->payload.fragment.offset,
-                        m->payload.fragment.fragment_len,
-                        m->payload.fragment.total_len);
+static void handle_fragment_message(dp_queue_msg_t *msg)
+{
+    if (msg->slab >= MQTT_DP_SLAB_COUNT) {
+        ESP_LOGW(TAG, "fragment message without slab (slab=%u)", (unsigned)msg->slab);
+        return;
+    }
+    // Every queued slab holds a whole message: a single fragment, or a
+    // payload the event handler reassembled in place.
+    const dp_fragment_t *frag = &s_slabs[msg->slab];
+    if (frag->total_len > MQTT_DP_REASSEMBLY_PAYLOAD_CAP || frag->fragment_len != frag->total_len) {
+        record_drop(DP_DROP_OVERSIZE, frag->msg_id, frag->offset, frag->fragment_len, frag->total_len);
+        return;
+    }
+    if (!frag->has_topic || frag->topic_len == 0) {
+        record_drop(DP_DROP_NONZERO_FIRST, frag->msg_id, frag->offset, frag->fragment_len, frag->total_len);
+        return;
+    }
+
+    if (!frag->reassembled) {
+        s_stats_total.accepted_fragments++;
+    }
+    dispatch_message(frag->route,
+                     (char *)frag->data,
+                     frag->fragment_len,
+                     frag->retained,
+                     frag->timestamp_us);
+    s_stats_total.completed_messages++;
+}
+
+static void on_reassembly_end(void *ctx, size_t idx, const fragment_slot_t *slot, fragment_end_reason_t reason)
+{
+    (void)ctx;
+    dp_slot_stats_t *stats = &s_stats_total.slots[idx];
+    switch (reason) {
+    case FRAGMENT_END_COMPLETE: {
+        // The payload is whole in the head's slab; hand that slab to the task
+        // like a single-fragment message.
+        dp_fragment_t *head = &s_slabs[slot->buffer];
+        head->fragment_len = slot->total_len;
+        head->reassembled = true;
+        stats->completed++;
+        const dp_queue_msg_t msg = {
+            .type = DP_MSG_FRAGMENT,
+            .slab = slot->buffer,
+            .topic = MQTT_DP_TOPIC_NONE,
+        };
+        if (lane_send(lane_for_route(head->route, true), &msg)) {
             return;
         }
-        start_reassembly(m);
-    } else {
-        if (m->payload.fragment.offset == 0 && m->payload.fragment.has_topic) {
-            s_stats_total.preempted_flows++;
-            ESP_LOGI(TAG,
-                     "preempt active flow old_msg_id=%d new_msg_id=%d",
-                     s_reassembly.msg_id,
-                     m->payload.fragment.msg_id);
-            reset_reassembly_state();
-            start_reassembly(m);
-        }
+        s_stats_total.lanes[DP_LANE_LOW].drops++;
+        record_drop(DP_DROP_QUEUE_FULL, slot->msg_id, 0, slot->total_len, slot->total_len);
+        break;
+    }
+    case FRAGMENT_END_DROPPED:
+        stats->drops++;
+        break;
+    case FRAGMENT_END_PREEMPTED:
+        s_stats_total.preempted_flows++;
+        stats->preempted++;
+        ESP_LOGI(TAG, "preempt active flow slot=%u msg_id=%d", (unsigned)idx, slot->msg_id);
+        break;
+    case FRAGMENT_END_EVICTED:
+        s_stats_total.preempted_flows++;
+        stats->evicted++;
+        ESP_LOGI(TAG, "evict lru flow slot=%u old_msg_id=%d", (unsigned)idx, slot->msg_id);
+        break;
+    case FRAGMENT_END_EXPIRED:
+        stats->expired++;
+        ESP_LOGW(TAG,
+                 "reassembly timeout slot=%u msg_id=%d filled=%u total=%u",
+                 (unsigned)idx,
+                 slot->msg_id,
+                 (unsigned)slot->filled,
+                 (unsigned)slot->total_len);
+        break;
+    case FRAGMENT_END_RESET:
+        break;
     }
+    slab_release(slot->buffer);
+}
 
-    if (!s_reassembly.active) {
-        record_drop(DP_DROP_OUT_OF_ORDER,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
+static void dispatch_message(const topic_route_t *route,
+                             char *payload,
+                             size_t payload_len,
+                             bool retained,
+                             int64_t timestamp_us)
+{
+    if (route != NULL && route->id == TOPIC_COMMAND) {
+        process_command(payload, payload_len);
         return;
     }
-
-    if (m->payload.fragment.msg_id != s_reassembly.msg_id) {
-        record_drop(DP_DROP_OVERLAP,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
+    if (route != NULL && route->id == TOPIC_LED_PROGRAM) {
+        process_led_program((const uint8_t *)payload, payload_len, retained);
         return;
     }
+    process_payload(route != NULL ? route->desc : NULL, payload, payload_len, retained, timestamp_us);
+}
 
-    if (m->payload.fragment.total_len != s_reassembly.total_len) {
-        record_drop(DP_DROP_OVERLAP,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
-        reset_reassembly_state();
-        return;
+static void free_queue_message(dp_queue_msg_t *msg)
+{
+    if (msg->slab != MQTT_DP_SLAB_NONE) {
+        slab_release(msg->slab);
+        msg->slab = MQTT_DP_SLAB_NONE;
     }
+}
 
-    if (m->payload.fragment.offset < s_reassembly.filled) {
-        record_drop(DP_DROP_OVERLAP,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
-        reset_reassembly_state();
-        return;
+static bool lane_queues_init(void)
+{
+    s_lane_queues[DP_LANE_HIGH] = xQueueCreate(MQTT_DP_HIGH_LANE_DEPTH, sizeof(dp_queue_msg_t));
+    s_lane_queues[DP_LANE_LOW] = xQueueCreate(MQTT_DP_LOW_LANE_DEPTH, sizeof(dp_queue_msg_t));
+    memset(s_lane_hwm, 0, sizeof(s_lane_hwm));
+    memset(s_latest_slab, MQTT_DP_SLAB_NONE, sizeof(s_latest_slab));
+    return s_lane_queues[DP_LANE_HIGH] != NULL && s_lane_queues[DP_LANE_LOW] != NULL;
+}
+
+static void lane_queues_delete(void)
+{
+    for (size_t i = 0; i < DP_LANE_COUNT; ++i) {
+        if (s_lane_queues[i] != NULL) {
+            vQueueDelete(s_lane_queues[i]);
+            s_lane_queues[i] = NULL;
+        }
     }
+}
 
-    if (m->payload.fragment.offset != s_reassembly.filled) {
-        record_drop(DP_DROP_OUT_OF_ORDER,
-                    m->payload.fragment.msg_id,
-                    m->payload.fragment.offset,
-                    m->payload.fragment.fragment_len,
-                    m->payload.fragment.total_len);
-        reset_reassembly_state();
-        return;
+static dp_lane_t lane_for_route(const topic_route_t *route, bool fragmented)
+{
+    // Fragmented messages are queued whole once reassembled. They take the low
+    // lane without coalescing, like any message too large for one event.
+    if (fragmented || route == NULL) {
+        return DP_LANE_LOW;
+    }
+    if (route->desc == NULL) {
+        return DP_LANE_HIGH;
+    }
+    return route->desc->lane;
+}
+
+static bool lane_send(dp_lane_t lane, const dp_queue_msg_t *msg)
+{
+    QueueHandle_t queue = s_lane_queues[lane];
+    if (queue == NULL || xQueueSend(queue, msg, 0) != pdTRUE) {
+        return false;
     }
+    s_stats_total.lanes[lane].enqueued++;
+    const uint32_t depth = (uint32_t)uxQueueMessagesWaiting(queue);
+    if (depth > s_lane_hwm[lane]) {
+        s_lane_hwm[lane] = depth;
+    }
+    if (s_task_handle != NULL) {
+        xTaskNotifyGive(s_task_handle);
+    }
+    return true;
+}
 
-    memcpy(s_reassembly_payload + m->payload.fragment.offset,
-           m->payload.fragment.data,
-           m->payload.fragment.fragment_len);
-    s_reassembly.filled += m->payload.fragment.fragment_len;
-    s_stats_total.accepted_fragments++;
+static bool lane_send_latest(uint8_t topic, uint8_t slab)
+{
+    portENTER_CRITICAL(&s_latest_lock);
+    const uint8_t superseded = s_latest_slab[topic];
+    s_latest_slab[topic] = slab;
+    portEXIT_CRITICAL(&s_latest_lock);
+
+    if (superseded != MQTT_DP_SLAB_NONE) {
+        // A queued entry already points at this topic; it now picks up the
+        // newer slab when dequeued.
+        slab_release(superseded);
+        s_stats_total.lanes[DP_LANE_LOW].coalesced++;
+        return true;
+    }
 
-    if (s_reassembly.filled >= s_reassembly.total_len && s_reassembly.topic_len > 0) {
-        s_reassembly_payload[s_reassembly.total_len] = '\0';
-        if (is_command_topic(s_reassembly.topic, s_reassembly.topic_len)) {
-            process_command((const char *)s_reassembly_payload, s_reassembly.total_len);
-        } else {
-            process_payload(match_topic(s_reassembly.topic, s_reassembly.topic_len),
-                            (char *)s_reassembly_payload,
-                            s_reassembly.total_len,
-                            s_reassembly.retain_flag,
-                            s_reassembly.timestamp_us);
+    const dp_queue_msg_t msg = {
+        .type = DP_MSG_LATEST,
+        .slab = MQTT_DP_SLAB_NONE,
+        .topic = topic,
+    };
+    if (lane_send(DP_LANE_LOW, &msg)) {
+        return true;
+    }
+    slab_release(take_latest_slab(topic));
+    return false;
+}
+
+static uint8_t take_latest_slab(uint8_t topic)
+{
+    if (topic >= MQTT_DP_TOPIC_COUNT) {
+        return MQTT_DP_SLAB_NONE;
+    }
+    portENTER_CRITICAL(&s_latest_lock);
+    const uint8_t slab = s_latest_slab[topic];
+    s_latest_slab[topic] = MQTT_DP_SLAB_NONE;
+    portEXIT_CRITICAL(&s_latest_lock);
+    return slab;
+}
+
+static bool shed_low_lane(void)
+{
+    dp_queue_msg_t victim = {0};
+    if (s_lane_queues[DP_LANE_LOW] == NULL ||
+        xQueueReceive(s_lane_queues[DP_LANE_LOW], &victim, 0) != pdTRUE) {
+        return false;
+    }
+    if (victim.type == DP_MSG_LATEST) {
+        victim.slab = take_latest_slab(victim.topic);
+    }
+    free_queue_message(&victim);
+    s_stats_total.lanes[DP_LANE_LOW].shed++;
+    return true;
+}
+
+static void emit_lane_digest(void)
+{
+    static const char *const lane_names[DP_LANE_COUNT] = {"high", "low"};
+    for (size_t i = 0; i < DP_LANE_COUNT; ++i) {
+        const dp_lane_stats_t *total = &s_stats_total.lanes[i];
+        const dp_lane_stats_t *prev = &s_stats_prev.lanes[i];
+        ESP_LOGI(TAG,
+                 "mqtt_lane_digest lane=%s depth=%u hwm=%u/%d enqueued_total=%u enqueued_delta=%u "
+                 "drop_total=%u drop_delta=%u coalesced_total=%u coalesced_delta=%u "
+                 "shed_total=%u shed_delta=%u",
+                 lane_names[i],
+                 s_lane_queues[i] != NULL ? (unsigned)uxQueueMessagesWaiting(s_lane_queues[i]) : 0u,
+                 (unsigned)s_lane_hwm[i],
+                 (i == DP_LANE_HIGH) ? MQTT_DP_HIGH_LANE_DEPTH : MQTT_DP_LOW_LANE_DEPTH,
+                 total->enqueued,
+                 total->enqueued - prev->enqueued,
+                 total->drops,
+                 total->drops - prev->drops,
+                 total->coalesced,
+                 total->coalesced - prev->coalesced,
+                 total->shed,
+                 total->shed - prev->shed);
+    }
+}
+
+static bool slab_pool_init(void)
+{
+    if (s_slab_free_queue == NULL) {
+        s_slab_free_queue = xQueueCreate(MQTT_DP_SLAB_COUNT, sizeof(uint8_t));
+        if (s_slab_free_queue == NULL) {
+            return false;
         }
-        s_stats_total.completed_messages++;
-        reset_reassembly_state();
     }
+    xQueueReset(s_slab_free_queue);
+    for (uint8_t i = 0; i < MQTT_DP_SLAB_COUNT; ++i) {
+        xQueueSend(s_slab_free_queue, &i, 0);
+    }
+    s_slab_in_use_hwm = 0;
+    return true;
 }
 
-static void free_queue_message(dp_queue_msg_t *msg)
+static uint8_t slab_acquire(void)
 {
-    (void)msg;
+    uint8_t slab = MQTT_DP_SLAB_NONE;
+    if (xQueueReceive(s_slab_free_queue, &slab, 0) != pdTRUE) {
+        return MQTT_DP_SLAB_NONE;
+    }
+    const uint32_t in_use = MQTT_DP_SLAB_COUNT - (uint32_t)uxQueueMessagesWaiting(s_slab_free_queue);
+    if (in_use > s_slab_in_use_hwm) {
+        s_slab_in_use_hwm = in_use;
+    }
+    return slab;
+}
+
+static void slab_release(uint8_t slab)
+{
+    if (slab >= MQTT_DP_SLAB_COUNT) {
+        return;
+    }
+    if (xQueueSend(s_slab_free_queue, &slab, 0) != pdTRUE) {
+        ESP_LOGE(TAG, "slab free list overflow (slab=%u)", (unsigned)slab);
+    }
 }
 
 static const char *drop_reason_to_str(dp_drop_reason_t reason)
@@ -906,6 +1567,8 @@ static const char *drop_reason_to_str(dp_drop_reason_t reason)
         return "overlap";
     case DP_DROP_QUEUE_FULL:
         return "queue_full";
+    case DP_DROP_NO_SLAB:
+        return "no_slab";
     default:
         return "unknown";
     }
@@ -930,23 +1593,30 @@ static void record_drop(dp_drop_reason_t reason,
              (unsigned)total_len);
 }
 
-static void reset_reassembly_state(void)
+static void emit_reassembly_digest(void)
 {
-    memset(&s_reassembly, 0, sizeof(s_reassembly));
-    s_reassembly_payload[0] = '\0';
-}
-
-static void start_reassembly(dp_queue_msg_t *msg)
-{
-    s_reassembly.active = true;
-    s_reassembly.msg_id = msg->payload.fragment.msg_id;
-    s_reassembly.total_len = msg->payload.fragment.total_len;
-    s_reassembly.filled = 0;
-    s_reassembly.retain_flag = msg->payload.fragment.retained;
-    s_reassembly.timestamp_us = msg->payload.fragment.timestamp_us;
-    s_reassembly.topic_len = msg->payload.fragment.topic_len;
-    memcpy(s_reassembly.topic, msg->payload.fragment.topic, msg->payload.fragment.topic_len);
-    s_reassembly.topic[msg->payload.fragment.topic_len] = '\0';
+    for (size_t i = 0; i < MQTT_DP_REASSEMBLY_SLOTS; ++i) {
+        const dp_slot_stats_t *total = &s_stats_total.slots[i];
+        const dp_slot_stats_t *prev = &s_stats_prev.slots[i];
+        ESP_LOGI(TAG,
+                 "mqtt_reassembly_digest slot=%u active=%d msg_id=%d "
+                 "complete_total=%u complete_delta=%u drop_total=%u drop_delta=%u "
+                 "preempted_total=%u preempted_delta=%u evicted_total=%u evicted_delta=%u "
+                 "expired_total=%u expired_delta=%u",
+                 (unsigned)i,
+                 s_reassembly_slots[i].active,
+                 s_reassembly_slots[i].active ? s_reassembly_slots[i].msg_id : -1,
+                 total->completed,
+                 total->completed - prev->completed,
+                 total->drops,
+                 total->drops - prev->drops,
+                 total->preempted,
+                 total->preempted - prev->preempted,
+                 total->evicted,
+                 total->evicted - prev->evicted,
+                 total->expired,
+                 total->expired - prev->expired);
+    }
 }
 
 static bool maybe_emit_digest(int64_t now_us)
@@ -958,30 +1628,43 @@ static bool maybe_emit_digest(int64_t now_us)
         s_digest_last_emit_us = now_us;
         return false;
     }
-    if ((now_us - s_digest_last_emit_us) < MQTT_DP_DIGEST_INTERVAL_US) {
+    if (!s_digest_forced && (now_us - s_digest_last_emit_us) < MQTT_DP_DIGEST_INTERVAL_US) {
         return false;
     }
+    s_digest_forced = false;
 
     const uint32_t oversize_total = s_stats_total.drops[DP_DROP_OVERSIZE];
     const uint32_t out_of_order_total = s_stats_total.drops[DP_DROP_OUT_OF_ORDER];
     const uint32_t nonzero_first_total = s_stats_total.drops[DP_DROP_NONZERO_FIRST];
     const uint32_t overlap_total = s_stats_total.drops[DP_DROP_OVERLAP];
     const uint32_t queue_full_total = s_stats_total.drops[DP_DROP_QUEUE_FULL];
+    const uint32_t no_slab_total = s_stats_total.drops[DP_DROP_NO_SLAB];
     const uint32_t preempted_total = s_stats_total.preempted_flows;
+    const uint32_t complete_delta = s_stats_total.completed_messages - s_stats_prev.completed_messages;
+    const uint32_t copies_delta = s_stats_total.payload_copies - s_stats_prev.payload_copies;
+    const float copies_per_msg = (complete_delta > 0) ? ((float)copies_delta / (float)complete_delta) : 0.0f;
 
     const int64_t elapsed_us = now_us - s_digest_last_emit_us;
+    const float elapsed_s = (float)elapsed_us / 1000000.0f;
+    const uint32_t staged_delta = s_stats_total.staged_updates - s_stats_prev.staged_updates;
+    const uint32_t batch_delta = s_stats_total.commit_batches - s_stats_prev.commit_batches;
+    const uint32_t lock_delta = s_stats_total.lvgl_locks - s_stats_prev.lvgl_locks;
+    const uint32_t widget_delta = s_stats_total.widget_updates - s_stats_prev.widget_updates;
 
     ESP_LOGI(TAG,
              "mqtt_digest interval_s=60 window_us=%lld now_us=%lld accepted_total=%u accepted_delta=%u complete_total=%u complete_delta=%u "
              "drop_oversize_total=%u drop_oversize_delta=%u drop_out_of_order_total=%u drop_out_of_order_delta=%u "
              "drop_nonzero_first_total=%u drop_nonzero_first_delta=%u drop_overlap_total=%u drop_overlap_delta=%u "
-             "drop_queue_full_total=%u drop_queue_full_delta=%u preempted_total=%u preempted_delta=%u",
+             "drop_queue_full_total=%u drop_queue_full_delta=%u drop_no_slab_total=%u drop_no_slab_delta=%u "
+             "preempted_total=%u preempted_delta=%u copies_delta=%u copies_per_msg=%.2f slab_hwm=%u/%d "
+             "staged_delta=%u batch_delta=%u lvgl_lock_delta=%u lvgl_lock_per_s=%.2f "
+             "widget_update_delta=%u widget_update_per_s=%.2f",
              (long long)elapsed_us,
              (long long)now_us,
              s_stats_total.accepted_fragments,
              s_stats_total.accepted_fragments - s_stats_prev.accepted_fragments,
              s_stats_total.completed_messages,
-             s_stats_total.completed_messages - s_stats_prev.completed_messages,
+             complete_delta,
              oversize_total,
              oversize_total - s_stats_prev.drops[DP_DROP_OVERSIZE],
              out_of_order_total,
@@ -992,10 +1675,29 @@ static bool maybe_emit_digest(int64_t now_us)
              overlap_total - s_stats_prev.drops[DP_DROP_OVERLAP],
              queue_full_total,
              queue_full_total - s_stats_prev.drops[DP_DROP_QUEUE_FULL],
+             no_slab_total,
+             no_slab_total - s_stats_prev.drops[DP_DROP_NO_SLAB],
              preempted_total,
-             preempted_total - s_stats_prev.preempted_flows);
+             preempted_total - s_stats_prev.preempted_flows,
+             copies_delta,
+             copies_per_msg,
+             (unsigned)s_slab_in_use_hwm,
+             MQTT_DP_SLAB_COUNT,
+             staged_delta,
+             batch_delta,
+             lock_delta,
+             (elapsed_s > 0.0f) ? ((float)lock_delta / elapsed_s) : 0.0f,
+             widget_delta,
+             (elapsed_s > 0.0f) ? ((float)widget_delta / elapsed_s) : 0.0f);
+
+    emit_reassembly_digest();
+    emit_lane_digest();
+    emit_latency_digest();
+    emit_publish_latency_digest();
+    publish_diag_digest(elapsed_us);
 
     s_stats_prev = s_stats_total;
+    s_latency_prev = s_latency_total;
     s_digest_last_emit_us = now_us;
     return true;
 }
@@ -1042,17 +1744,83 @@ static void init_topic_strings(void)
         s_topics[i].topic_len = strlen(s_topics[i].topic);
     }
 
+    int written = snprintf(s_ha_prefix, sizeof(s_ha_prefix), "%s/", base);
+    s_ha_prefix_len = (written > 0 && written < (int)sizeof(s_ha_prefix)) ? (size_t)written : 0;
+
     s_topics_initialized = true;
 }
 
-static topic_desc_t *match_topic(const char *topic, size_t topic_len)
+static void build_topic_routes(void)
 {
-    if (topic == NULL) {
-        return NULL;
+    topic_router_key_t keys[sizeof(s_routes) / sizeof(s_routes[0])];
+    size_t count = 0;
+
+    for (size_t i = 0; i < MQTT_DP_TOPIC_COUNT; ++i) {
+        if (s_topics[i].topic_len == 0 || s_topics[i].suffix == NULL) {
+            continue;
+        }
+        keys[count] = (topic_router_key_t){.suffix = s_topics[i].suffix, .ns = ROUTE_NS_HA};
+        s_routes[count++] = (topic_route_t){
+            .id = s_topics[i].id,
+            .desc = &s_topics[i],
+            .topic = s_topics[i].topic,
+            .topic_len = s_topics[i].topic_len,
+        };
     }
-    for (size_t i = 0; i < sizeof(s_topics) / sizeof(s_topics[0]); ++i) {
-        if (topic_len == s_topics[i].topic_len && strncmp(topic, s_topics[i].topic, topic_len) == 0) {
-            return &s_topics[i];
+    if (s_command_topic_len > 0) {
+        keys[count] = (topic_router_key_t){.suffix = s_command_suffix, .ns = ROUTE_NS_THEO};
+        s_routes[count++] = (topic_route_t){
+            .id = TOPIC_COMMAND,
+            .desc = NULL,
+            .topic = s_command_topic,
+            .topic_len = s_command_topic_len,
+        };
+    }
+    if (s_led_program_topic_len > 0) {
+        keys[count] = (topic_router_key_t){.suffix = s_led_program_suffix, .ns = ROUTE_NS_THEO};
+        s_routes[count++] = (topic_route_t){
+            .id = TOPIC_LED_PROGRAM,
+            .desc = NULL,
+            .topic = s_led_program_topic,
+            .topic_len = s_led_program_topic_len,
+        };
+    }
+    s_route_count = count;
+
+    if (count <= MQTT_DP_SCAN_MAX_ROUTES) {
+        ESP_LOGI(TAG, "topic routes built routes=%zu mode=scan", count);
+        return;
+    }
+    topic_router_init(&s_router, s_router_slots, MQTT_DP_ROUTER_SLOTS);
+    topic_router_set_prefix(&s_router, ROUTE_NS_HA, s_ha_prefix, s_ha_prefix_len);
+    topic_router_set_prefix(&s_router, ROUTE_NS_THEO, s_theo_prefix, s_theo_prefix_len);
+    esp_err_t err = topic_router_build(&s_router, keys, count, MQTT_DP_ROUTER_SEED_ATTEMPTS);
+    if (err != ESP_OK) {
+        // The scan still routes every topic, just more slowly.
+        ESP_LOGE(TAG, "topic router build failed routes=%zu: %s", count, esp_err_to_name(err));
+        return;
+    }
+    if (s_router.max_probe != 0) {
+        ESP_LOGW(TAG, "topic router not perfect seed=%u max_probe=%u", (unsigned)s_router.seed, s_router.max_probe);
+    }
+    s_router_enabled = true;
+    ESP_LOGI(TAG,
+             "topic routes built routes=%zu mode=router slots=%d seed=%u max_probe=%u",
+             count,
+             MQTT_DP_ROUTER_SLOTS,
+             (unsigned)s_router.seed,
+             s_router.max_probe);
+}
+
+static const topic_route_t *route_topic(const char *topic, size_t topic_len)
+{
+    if (s_router_enabled) {
+        uint8_t index = topic_router_route(&s_router, topic, topic_len);
+        return (index != TOPIC_ROUTER_NONE) ? &s_routes[index] : NULL;
+    }
+    for (size_t i = 0; i < s_route_count; ++i) {
+        if (topic_len == s_routes[i].topic_len && memcmp(topic, s_routes[i].topic, topic_len) == 0) {
+            return &s_routes[i];
         }
     }
     return NULL;
@@ -1171,60 +1939,36 @@ static const lv_img_dsc_t *icon_for_room_name(const char *name, bool *is_error)
     return &room_default;
 }
 
-static bool parse_number_payload(const char *payload, float *out_value)
+static bool parse_number_payload(const char *payload, size_t payload_len, float *out_value)
 {
     if (payload == NULL || out_value == NULL) {
         return false;
     }
-    char *end = NULL;
-    float value = strtof(payload, &end);
-    if (end == payload) {
-        return false;
-    }
-    while (end && *end != '\0' && isspace((unsigned char)*end)) {
-        end++;
-    }
-    if (end && *end != '\0') {
-        return false;
-    }
-    if (!isfinite(value)) {
-        return false;
-    }
-    *out_value = value;
-    return true;
+    return json_parse_number(payload, payload_len, out_value);
 }
 
 static void process_payload(topic_desc_t *desc, char *payload, size_t payload_len, bool retained, int64_t timestamp_us)
 {
-    (void)timestamp_us;
     if (desc == NULL || payload == NULL) {
         return;
     }
-    char buffer[192];
-    size_t copy_len = (payload_len < (sizeof(buffer) - 1)) ? payload_len : (sizeof(buffer) - 1);
-    memcpy(buffer, payload, copy_len);
-    buffer[copy_len] = '\0';
+    // Payloads are parsed in place; the slab keeps them NUL-terminated.
+    const char *buffer = payload;
 
+    // View-model topics only stage their parsed value here; the task commits
+    // the whole batch under a single LVGL lock once its queue is drained.
     switch (desc->id) {
     case TOPIC_WEATHER_TEMP: {
         float value = 0.0f;
-        bool ok = parse_number_payload(buffer, &value);
+        bool ok = parse_number_payload(buffer, payload_len, &value);
         if (!desc->seen) {
             ESP_LOGI(TAG, "initial weather temperature payload=%s", buffer);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            g_view_model.weather_ready = true;
-            g_view_model.weather_temp_valid = ok;
-            if (ok) {
-                g_view_model.weather_temp_c = value;
-            }
-            if (g_ui_initialized) {
-                thermostat_update_weather_group();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating weather temp");
+        s_staged.weather_temp_ok = ok;
+        if (ok) {
+            s_staged.weather_temp_c = value;
         }
+        stage_dirty(DP_DIRTY_WEATHER_TEMP);
         if (!ok) {
             ESP_LOGW(TAG, "invalid weather temperature payload");
         }
@@ -1235,16 +1979,8 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
         if (!desc->seen) {
             ESP_LOGI(TAG, "initial weather icon payload=%s", buffer);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            g_view_model.weather_ready = true;
-            g_view_model.weather_icon = icon;
-            if (g_ui_initialized) {
-                thermostat_update_weather_group();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating weather summary");
-        }
+        s_staged.weather_icon = icon;
+        stage_dirty(DP_DIRTY_WEATHER_ICON);
         if (icon == NULL && buffer[0] != '\0') {
             ESP_LOGW(TAG, "invalid weather summary payload");
         }
@@ -1252,23 +1988,15 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
     }
     case TOPIC_ROOM_TEMP: {
         float value = 0.0f;
-        bool ok = parse_number_payload(buffer, &value);
+        bool ok = parse_number_payload(buffer, payload_len, &value);
         if (!desc->seen) {
             ESP_LOGI(TAG, "initial room temperature payload=%s", buffer);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            g_view_model.room_ready = true;
-            g_view_model.room_temp_valid = ok;
-            if (ok) {
-                g_view_model.room_temp_c = value;
-            }
-            if (g_ui_initialized) {
-                thermostat_update_room_group();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating room temp");
+        s_staged.room_temp_ok = ok;
+        if (ok) {
+            s_staged.room_temp_c = value;
         }
+        stage_dirty(DP_DIRTY_ROOM_TEMP);
         if (!ok) {
             ESP_LOGW(TAG, "invalid room temperature payload");
         }
@@ -1280,17 +2008,9 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
         if (!desc->seen) {
             ESP_LOGI(TAG, "initial room name payload=%s", buffer[0] ? buffer : "(empty)");
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            g_view_model.room_ready = true;
-            g_view_model.room_icon = icon;
-            g_view_model.room_icon_error = error;
-            if (g_ui_initialized) {
-                thermostat_update_room_group();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating room icon");
-        }
+        s_staged.room_icon = icon;
+        s_staged.room_icon_error = error;
+        stage_dirty(DP_DIRTY_ROOM_NAME);
         if (!buffer[0]) {
             ESP_LOGW(TAG, "invalid room name payload");
         }
@@ -1302,20 +2022,11 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
         if (!desc->seen) {
             ESP_LOGI(TAG, "initial fan state payload=%s", buffer);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            if (ok) {
-                g_view_model.fan_running = on;
-                g_view_model.fan_payload_error = false;
-            } else {
-                g_view_model.fan_payload_error = true;
-            }
-            if (g_ui_initialized) {
-                thermostat_update_action_bar_visuals();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating fan state");
+        s_staged.fan_ok = ok;
+        if (ok) {
+            s_staged.fan_on = on;
         }
+        stage_dirty(DP_DIRTY_FAN);
         if (!ok) {
             ESP_LOGW(TAG, "invalid fan payload");
         }
@@ -1325,46 +2036,32 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
     case TOPIC_COOL_STATE: {
         bool on = false;
         bool ok = parse_on_off(buffer, &on);
-        bool reported = false;
-        bool heating = false;
-        bool cooling = false;
         if (!desc->seen) {
             const char *label = (desc->id == TOPIC_HEAT_STATE) ? "heat" : "cool";
             ESP_LOGI(TAG, "initial %s state payload=%s", label, buffer);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            g_view_model.hvac_ready = true;
-            if (ok) {
-                if (desc->id == TOPIC_HEAT_STATE) {
-                    g_view_model.hvac_heating_active = on;
-                } else {
-                    g_view_model.hvac_cooling_active = on;
-                }
-                g_view_model.hvac_status_error = false;
-                heating = g_view_model.hvac_heating_active;
-                cooling = g_view_model.hvac_cooling_active;
-                reported = true;
+        uint32_t bits = DP_DIRTY_HVAC_STATUS;
+        if (ok) {
+            if (desc->id == TOPIC_HEAT_STATE) {
+                s_staged.heat_on = on;
+                bits |= DP_DIRTY_HEAT;
             } else {
-                g_view_model.hvac_status_error = true;
+                s_staged.cool_on = on;
+                bits |= DP_DIRTY_COOL;
             }
-            if (g_ui_initialized) {
-                thermostat_update_hvac_status_group();
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout updating HVAC state");
         }
+        // The error flag follows whichever HVAC payload arrived last.
+        s_staged.hvac_error = !ok;
+        stage_dirty(bits);
         if (!ok) {
             ESP_LOGW(TAG, "invalid HVAC payload (%s)", desc->topic);
-        } else if (reported) {
-            thermostat_led_status_set_hvac(heating, cooling);
         }
         break;
     }
     case TOPIC_SETPOINT_LOW:
     case TOPIC_SETPOINT_HIGH: {
         float value = 0.0f;
-        bool ok = parse_number_payload(buffer, &value);
+        bool ok = parse_number_payload(buffer, payload_len, &value);
         bool clamped = false;
         if (!desc->seen) {
             const char *label = (desc->id == TOPIC_SETPOINT_HIGH) ? "cooling" : "heating";
@@ -1375,41 +2072,16 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
         }
         thermostat_target_t target = (desc->id == TOPIC_SETPOINT_HIGH) ? THERMOSTAT_TARGET_COOL
                                                                       : THERMOSTAT_TARGET_HEAT;
+        s_staged.setpoint_ok[target] = ok;
+        if (ok) {
+            s_staged.setpoint_c[target] = value;
+        }
+        stage_dirty(target == THERMOSTAT_TARGET_COOL ? DP_DIRTY_SETPOINT_HIGH : DP_DIRTY_SETPOINT_LOW);
         if (!ok) {
             ESP_LOGW(TAG, "invalid %s payload", desc->topic);
-            if (esp_lv_adapter_lock(-1) == ESP_OK) {
-                if (target == THERMOSTAT_TARGET_COOL) {
-                    g_view_model.cooling_setpoint_valid = false;
-                } else {
-                    g_view_model.heating_setpoint_valid = false;
-                }
-                if (g_ui_initialized) {
-                    thermostat_update_setpoint_labels();
-                }
-                esp_lv_adapter_unlock();
-            }
-            break;
-        }
-        if (clamped) {
+        } else if (clamped) {
             ESP_LOGW(TAG, "%s clamped to %.2f", desc->topic, value);
         }
-        if (esp_lv_adapter_lock(-1) == ESP_OK) {
-            if (g_ui_initialized) {
-                thermostat_remote_setpoint_controller_submit(target, value);
-            } else {
-                // Store setpoint directly if UI not ready
-                if (target == THERMOSTAT_TARGET_COOL) {
-                    g_view_model.cooling_setpoint_c = value;
-                    g_view_model.cooling_setpoint_valid = true;
-                } else {
-                    g_view_model.heating_setpoint_c = value;
-                    g_view_model.heating_setpoint_valid = true;
-                }
-            }
-            esp_lv_adapter_unlock();
-        } else {
-            ESP_LOGW(TAG, "LVGL lock timeout applying remote setpoint");
-        }
         break;
     }
     case TOPIC_PERSONAL_FACE:
@@ -1429,6 +2101,402 @@ static void process_payload(topic_desc_t *desc, char *payload, size_t payload_le
         break;
     }
 
+    latency_mark_staged(desc->id, timestamp_us);
     desc->seen = true;
     return;
 }
+
+static void stage_dirty(uint32_t bits)
+{
+    s_staged.dirty |= bits;
+    s_stats_total.staged_updates++;
+}
+
+static void apply_staged_setpoint(thermostat_target_t target, uint32_t *widgets)
+{
+    const bool ok = s_staged.setpoint_ok[target];
+    const float value = s_staged.setpoint_c[target];
+    if (!ok) {
+        if (target == THERMOSTAT_TARGET_COOL) {
+            g_view_model.cooling_setpoint_valid = false;
+        } else {
+            g_view_model.heating_setpoint_valid = false;
+        }
+        *widgets |= DP_WIDGET_SETPOINT_LABELS;
+        return;
+    }
+    if (g_ui_initialized) {
+        thermostat_remote_setpoint_controller_submit(target, value);
+    } else if (target == THERMOSTAT_TARGET_COOL) {
+        // Store setpoint directly if UI not ready
+        g_view_model.cooling_setpoint_c = value;
+        g_view_model.cooling_setpoint_valid = true;
+    } else {
+        g_view_model.heating_setpoint_c = value;
+        g_view_model.heating_setpoint_valid = true;
+    }
+}
+
+static void commit_staged_view(void)
+{
+    const uint32_t dirty = s_staged.dirty;
+    if (dirty == 0) {
+        return;
+    }
+    s_staged.dirty = 0;
+
+    uint32_t widgets = 0;
+    bool hvac_reported = false;
+    bool heating = false;
+    bool cooling = false;
+
+    if (esp_lv_adapter_lock(-1) != ESP_OK) {
+        ESP_LOGW(TAG, "LVGL lock timeout committing staged view (dirty=0x%03x)", (unsigned)dirty);
+        memset(s_latency_pending, 0, sizeof(s_latency_pending));
+        return;
+    }
+    const int64_t lock_us = esp_timer_get_time();
+    s_stats_total.lvgl_locks++;
+    s_stats_total.commit_batches++;
+
+    if (dirty & DP_DIRTY_WEATHER_TEMP) {
+        g_view_model.weather_ready = true;
+        g_view_model.weather_temp_valid = s_staged.weather_temp_ok;
+        if (s_staged.weather_temp_ok) {
+            g_view_model.weather_temp_c = s_staged.weather_temp_c;
+        }
+        widgets |= DP_WIDGET_WEATHER;
+    }
+    if (dirty & DP_DIRTY_WEATHER_ICON) {
+        g_view_model.weather_ready = true;
+        g_view_model.weather_icon = s_staged.weather_icon;
+        widgets |= DP_WIDGET_WEATHER;
+    }
+    if (dirty & DP_DIRTY_ROOM_TEMP) {
+        g_view_model.room_ready = true;
+        g_view_model.room_temp_valid = s_staged.room_temp_ok;
+        if (s_staged.room_temp_ok) {
+            g_view_model.room_temp_c = s_staged.room_temp_c;
+        }
+        widgets |= DP_WIDGET_ROOM;
+    }
+    if (dirty & DP_DIRTY_ROOM_NAME) {
+        g_view_model.room_ready = true;
+        g_view_model.room_icon = s_staged.room_icon;
+        g_view_model.room_icon_error = s_staged.room_icon_error;
+        widgets |= DP_WIDGET_ROOM;
+    }
+    if (dirty & DP_DIRTY_FAN) {
+        if (s_staged.fan_ok) {
+            g_view_model.fan_running = s_staged.fan_on;
+        }
+        g_view_model.fan_payload_error = !s_staged.fan_ok;
+        widgets |= DP_WIDGET_ACTION_BAR;
+    }
+    if (dirty & (DP_DIRTY_HEAT | DP_DIRTY_COOL | DP_DIRTY_HVAC_STATUS)) {
+        g_view_model.hvac_ready = true;
+        if (dirty & DP_DIRTY_HEAT) {
+            g_view_model.hvac_heating_active = s_staged.heat_on;
+        }
+        if (dirty & DP_DIRTY_COOL) {
+            g_view_model.hvac_cooling_active = s_staged.cool_on;
+        }
+        g_view_model.hvac_status_error = s_staged.hvac_error;
+        hvac_reported = (dirty & (DP_DIRTY_HEAT | DP_DIRTY_COOL)) != 0;
+        heating = g_view_model.hvac_heating_active;
+        cooling = g_view_model.hvac_cooling_active;
+        widgets |= DP_WIDGET_HVAC_STATUS;
+    }
+    if (dirty & DP_DIRTY_SETPOINT_LOW) {
+        apply_staged_setpoint(THERMOSTAT_TARGET_HEAT, &widgets);
+    }
+    if (dirty & DP_DIRTY_SETPOINT_HIGH) {
+        apply_staged_setpoint(THERMOSTAT_TARGET_COOL, &widgets);
+    }
+
+    if (g_ui_initialized) {
+        if (widgets & DP_WIDGET_WEATHER) {
+            thermostat_update_weather_group();
+            s_stats_total.widget_updates++;
+        }
+        if (widgets & DP_WIDGET_ROOM) {
+            thermostat_update_room_group();
+            s_stats_total.widget_updates++;
+        }
+        if (widgets & DP_WIDGET_ACTION_BAR) {
+            thermostat_update_action_bar_visuals();
+            s_stats_total.widget_updates++;
+        }
+        if (widgets & DP_WIDGET_HVAC_STATUS) {
+            thermostat_update_hvac_status_group();
+            s_stats_total.widget_updates++;
+        }
+        if (widgets & DP_WIDGET_SETPOINT_LABELS) {
+            thermostat_update_setpoint_labels();
+            s_stats_total.widget_updates++;
+        }
+    }
+    latency_record_commit(lock_us, esp_timer_get_time());
+    esp_lv_adapter_unlock();
+
+    if (hvac_reported) {
+        thermostat_led_status_set_hvac(heating, cooling);
+    }
+}
+
+static dp_lat_class_t latency_class_for_topic(topic_id_t id)
+{
+    switch (id) {
+    case TOPIC_WEATHER_TEMP:
+    case TOPIC_WEATHER_ICON:
+        return DP_LAT_CLASS_WEATHER;
+    case TOPIC_ROOM_TEMP:
+    case TOPIC_ROOM_NAME:
+        return DP_LAT_CLASS_ROOM;
+    case TOPIC_SETPOINT_LOW:
+    case TOPIC_SETPOINT_HIGH:
+        return DP_LAT_CLASS_SETPOINT;
+    case TOPIC_FAN_STATE:
+    case TOPIC_HEAT_STATE:
+    case TOPIC_COOL_STATE:
+        return DP_LAT_CLASS_HVAC;
+    case TOPIC_PERSONAL_FACE:
+    case TOPIC_PERSONAL_COUNT:
+        return DP_LAT_CLASS_PRESENCE;
+    default:
+        return DP_LAT_CLASS_COUNT;
+    }
+}
+
+static const char *latency_class_to_str(dp_lat_class_t cls)
+{
+    switch (cls) {
+    case DP_LAT_CLASS_WEATHER:
+        return "weather";
+    case DP_LAT_CLASS_ROOM:
+        return "room";
+    case DP_LAT_CLASS_SETPOINT:
+        return "setpoint";
+    case DP_LAT_CLASS_HVAC:
+        return "hvac";
+    case DP_LAT_CLASS_PRESENCE:
+        return "presence";
+    default:
+        return "unknown";
+    }
+}
+
+static void latency_record(dp_lat_class_t cls, dp_lat_stage_t stage, int64_t elapsed_us)
+{
+    if (cls >= DP_LAT_CLASS_COUNT || stage >= DP_LAT_STAGE_COUNT) {
+        return;
+    }
+    size_t bucket = 0;
+    if (elapsed_us >= (1LL << MQTT_DP_LAT_BUCKET0_SHIFT)) {
+        const uint64_t us = (uint64_t)elapsed_us;
+        bucket = (size_t)(63 - __builtin_clzll(us)) - (MQTT_DP_LAT_BUCKET0_SHIFT - 1);
+        if (bucket >= MQTT_DP_LAT_BUCKETS) {
+            bucket = MQTT_DP_LAT_BUCKETS - 1;
+        }
+    }
+    s_latency_total.buckets[cls][stage][bucket]++;
+}
+
+static void latency_mark_staged(topic_id_t id, int64_t receipt_us)
+{
+    const dp_lat_class_t cls = latency_class_for_topic(id);
+    if (cls >= DP_LAT_CLASS_COUNT || receipt_us <= 0) {
+        return;
+    }
+    if (cls == DP_LAT_CLASS_PRESENCE) {
+        // Presence handlers act immediately without the LVGL lock, so the
+        // handler return is the "updated" point and the lock stage is empty.
+        const int64_t done_us = esp_timer_get_time();
+        latency_record(cls, DP_LAT_STAGE_QUEUE, s_latency_dequeue_us - receipt_us);
+        latency_record(cls, DP_LAT_STAGE_WIDGET, done_us - s_latency_dequeue_us);
+        latency_record(cls, DP_LAT_STAGE_E2E, done_us - receipt_us);
+        return;
+    }
+    dp_latency_pending_t *pending = &s_latency_pending[cls];
+    if (!pending->pending) {
+        pending->pending = true;
+        pending->receipt_us = receipt_us;
+        pending->dequeue_us = s_latency_dequeue_us;
+    }
+}
+
+static void latency_record_commit(int64_t lock_us, int64_t updated_us)
+{
+    for (size_t i = 0; i < DP_LAT_CLASS_COUNT; ++i) {
+        dp_latency_pending_t *pending = &s_latency_pending[i];
+        if (!pending->pending) {
+            continue;
+        }
+        latency_record((dp_lat_class_t)i, DP_LAT_STAGE_QUEUE, pending->dequeue_us - pending->receipt_us);
+        latency_record((dp_lat_class_t)i, DP_LAT_STAGE_LOCK, lock_us - pending->dequeue_us);
+        latency_record((dp_lat_class_t)i, DP_LAT_STAGE_WIDGET, updated_us - lock_us);
+        latency_record((dp_lat_class_t)i, DP_LAT_STAGE_E2E, updated_us - pending->receipt_us);
+        pending->pending = false;
+    }
+}
+
+static uint32_t latency_percentile_us(const uint32_t *delta, uint32_t count, uint32_t pct)
+{
+    // Reports the upper edge of the bucket holding the requested rank, so
+    // values are conservative to within a factor of two.
+    if (count == 0) {
+        return 0;
+    }
+    const uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99u) / 100u);
+    uint32_t seen = 0;
+    for (size_t i = 0; i < MQTT_DP_LAT_BUCKETS; ++i) {
+        seen += delta[i];
+        if (seen >= rank) {
+            return 1u << (MQTT_DP_LAT_BUCKET0_SHIFT + i);
+        }
+    }
+    return 1u << (MQTT_DP_LAT_BUCKET0_SHIFT + MQTT_DP_LAT_BUCKETS - 1);
+}
+
+static uint32_t latency_window(dp_lat_class_t cls, dp_lat_stage_t stage, uint32_t delta[MQTT_DP_LAT_BUCKETS])
+{
+    uint32_t count = 0;
+    for (size_t i = 0; i < MQTT_DP_LAT_BUCKETS; ++i) {
+        delta[i] = s_latency_total.buckets[cls][stage][i] - s_latency_prev.buckets[cls][stage][i];
+        count += delta[i];
+    }
+    return count;
+}
+
+static void emit_latency_digest(void)
+{
+    for (size_t cls = 0; cls < DP_LAT_CLASS_COUNT; ++cls) {
+        uint32_t p[DP_LAT_STAGE_COUNT][3] = {0};
+        uint32_t samples = 0;
+        for (size_t stage = 0; stage < DP_LAT_STAGE_COUNT; ++stage) {
+            uint32_t delta[MQTT_DP_LAT_BUCKETS];
+            const uint32_t count = latency_window((dp_lat_class_t)cls, (dp_lat_stage_t)stage, delta);
+            p[stage][0] = latency_percentile_us(delta, count, 50);
+            p[stage][1] = latency_percentile_us(delta, count, 95);
+            p[stage][2] = latency_percentile_us(delta, count, 99);
+            if (stage == DP_LAT_STAGE_E2E) {
+                samples = count;
+            }
+        }
+        ESP_LOGI(TAG,
+                 "mqtt_latency_digest class=%s samples=%u "
+                 "queue_p50_us=%u queue_p95_us=%u queue_p99_us=%u "
+                 "lock_p50_us=%u lock_p95_us=%u lock_p99_us=%u "
+                 "widget_p50_us=%u widget_p95_us=%u widget_p99_us=%u "
+                 "e2e_p50_us=%u e2e_p95_us=%u e2e_p99_us=%u",
+                 latency_class_to_str((dp_lat_class_t)cls),
+                 samples,
+                 p[DP_LAT_STAGE_QUEUE][0], p[DP_LAT_STAGE_QUEUE][1], p[DP_LAT_STAGE_QUEUE][2],
+                 p[DP_LAT_STAGE_LOCK][0], p[DP_LAT_STAGE_LOCK][1], p[DP_LAT_STAGE_LOCK][2],
+                 p[DP_LAT_STAGE_WIDGET][0], p[DP_LAT_STAGE_WIDGET][1], p[DP_LAT_STAGE_WIDGET][2],
+                 p[DP_LAT_STAGE_E2E][0], p[DP_LAT_STAGE_E2E][1], p[DP_LAT_STAGE_E2E][2]);
+    }
+}
+
+static void record_command_publish(int64_t elapsed_us)
+{
+    const uint32_t us = elapsed_us < 0 ? 0 : (elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us);
+    taskENTER_CRITICAL(&s_publish_lat_lock);
+    s_publish_lat_count++;
+    s_publish_lat_sum_us += us;
+    if (us > s_publish_lat_max_us) {
+        s_publish_lat_max_us = us;
+    }
+    taskEXIT_CRITICAL(&s_publish_lat_lock);
+}
+
+static void emit_publish_latency_digest(void)
+{
+    taskENTER_CRITICAL(&s_publish_lat_lock);
+    const uint32_t count = s_publish_lat_count;
+    const uint32_t max_us = s_publish_lat_max_us;
+    const uint64_t sum_us = s_publish_lat_sum_us;
+    s_publish_lat_count = 0;
+    s_publish_lat_max_us = 0;
+    s_publish_lat_sum_us = 0;
+    taskEXIT_CRITICAL(&s_publish_lat_lock);
+
+    if (count == 0) {
+        return;
+    }
+    ESP_LOGI(TAG,
+             "mqtt_command_publish_digest samples=%u max_us=%u avg_us=%u",
+             count,
+             max_us,
+             (uint32_t)(sum_us / count));
+}
+
+static void publish_diag_digest(int64_t elapsed_us)
+{
+    if (!mqtt_manager_is_ready()) {
+        return;
+    }
+    esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+    if (client == NULL) {
+        return;
+    }
+    if (s_diag_topic[0] == '\0') {
+        const char *device_root = device_identity_get_theo_device_topic_root();
+        if (device_root == NULL || device_root[0] == '\0') {
+            return;
+        }
+        int written = snprintf(s_diag_topic, sizeof(s_diag_topic), "%s/diagnostics/mqtt_dataplane", device_root);
+        if (written <= 0 || written >= (int)sizeof(s_diag_topic)) {
+            s_diag_topic[0] = '\0';
+            return;
+        }
+    }
+
+    static const char *const stage_names[DP_LAT_STAGE_COUNT] = {"queue", "lock", "widget", "e2e"};
+    char *out = s_diag_payload;
+    size_t cap = sizeof(s_diag_payload);
+    size_t len = 0;
+    len += snprintf(out + len, cap - len,
+                    "{\"window_us\":%lld,\"complete\":%u,\"drops\":{",
+                    (long long)elapsed_us,
+                    s_stats_total.completed_messages - s_stats_prev.completed_messages);
+    for (size_t r = 0; r < DP_DROP_REASON_COUNT && len < cap; ++r) {
+        len += snprintf(out + len, cap - len, "%s\"%s\":%u",
+                        r ? "," : "",
+                        drop_reason_to_str((dp_drop_reason_t)r),
+                        s_stats_total.drops[r] - s_stats_prev.drops[r]);
+    }
+    if (len < cap) {
+        len += snprintf(out + len, cap - len, "},\"latency_us\":{");
+    }
+    for (size_t cls = 0; cls < DP_LAT_CLASS_COUNT && len < cap; ++cls) {
+        len += snprintf(out + len, cap - len, "%s\"%s\":{", cls ? "," : "", latency_class_to_str((dp_lat_class_t)cls));
+        for (size_t stage = 0; stage < DP_LAT_STAGE_COUNT && len < cap; ++stage) {
+            uint32_t delta[MQTT_DP_LAT_BUCKETS];
+            const uint32_t count = latency_window((dp_lat_class_t)cls, (dp_lat_stage_t)stage, delta);
+            len += snprintf(out + len, cap - len, "%s\"%s\":[%u,%u,%u,%u]",
+                            stage ? "," : "",
+                            stage_names[stage],
+                            count,
+                            latency_percentile_us(delta, count, 50),
+                            latency_percentile_us(delta, count, 95),
+                            latency_percentile_us(delta, count, 99));
+        }
+        if (len < cap) {
+            len += snprintf(out + len, cap - len, "}");
+        }
+    }
+    if (len < cap) {
+        len += snprintf(out + len, cap - len, "}}");
+    }
+    if (len >= cap) {
+        ESP_LOGW(TAG, "diag digest truncated (len=%u cap=%u)", (unsigned)len, (unsigned)cap);
+        return;
+    }
+
+    // Enqueue rather than publish: this runs on the esp_timer task and must
+    // not block on the network.
+    if (esp_mqtt_client_enqueue(client, s_diag_topic, s_diag_payload, (int)len, 0, 0, true) < 0) {
+        ESP_LOGW(TAG, "diag digest enqueue failed topic=%s", s_diag_topic);
+    }
+}
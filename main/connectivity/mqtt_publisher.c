@@ -0,0 +1,349 @@
+#include "connectivity/mqtt_publisher.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "mqtt_client.h"
+
+#include "connectivity/mqtt_manager.h"
+
+#define MQTT_PUBLISHER_MAX_ENTITIES  (16)
+#define MQTT_PUBLISHER_NAME_LEN      (32)
+#define MQTT_PUBLISHER_TOPIC_LEN     (160)
+#define MQTT_PUBLISHER_PAYLOAD_LEN   (32)
+#define MQTT_PUBLISHER_TICK_US       (1000LL * 1000LL)
+#define MQTT_PUBLISHER_DIGEST_US     (60LL * 1000LL * 1000LL)
+
+static const char *TAG = "mqtt_pub";
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t coalesced;
+    uint32_t heartbeats;
+    uint32_t failed;
+} mqtt_publisher_stats_t;
+
+typedef struct {
+    bool used;
+    bool numeric;
+    bool has_value;
+    bool has_sent;
+    bool pending;
+    uint8_t decimals;
+    int qos;
+    bool retain;
+    float deadband;
+    int64_t min_interval_us;
+    int64_t max_stale_us;
+    int64_t last_sent_us;
+    float value;
+    float sent_value;
+    char name[MQTT_PUBLISHER_NAME_LEN];
+    char topic[MQTT_PUBLISHER_TOPIC_LEN];
+    char payload[MQTT_PUBLISHER_PAYLOAD_LEN];
+    char sent_payload[MQTT_PUBLISHER_PAYLOAD_LEN];
+    mqtt_publisher_stats_t stats;
+    mqtt_publisher_stats_t stats_prev;
+} mqtt_publisher_slot_t;
+
+// Snapshot taken under the lock so the network call happens outside it.
+typedef struct {
+    char topic[MQTT_PUBLISHER_TOPIC_LEN];
+    char payload[MQTT_PUBLISHER_PAYLOAD_LEN];
+    int qos;
+    bool retain;
+} mqtt_publisher_send_t;
+
+static EXT_RAM_BSS_ATTR mqtt_publisher_slot_t s_slots[MQTT_PUBLISHER_MAX_ENTITIES];
+static size_t s_slot_count;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer;
+static int64_t s_digest_last_emit_us;
+
+static void publisher_timer_cb(void *arg);
+static mqtt_publisher_slot_t *slot_for(mqtt_publisher_entity_t entity);
+static void submit_locked(mqtt_publisher_slot_t *slot, int64_t now_us, mqtt_publisher_send_t *send, bool *do_send);
+static void mark_sent_locked(mqtt_publisher_slot_t *slot, int64_t now_us, mqtt_publisher_send_t *send);
+static void send_now(mqtt_publisher_entity_t entity, const mqtt_publisher_send_t *send, bool from_timer);
+static void emit_digest(int64_t now_us);
+
+esp_err_t mqtt_publisher_start(void)
+{
+    if (s_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = publisher_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "mqtt_pub",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_timer), TAG, "timer create failed");
+
+    esp_err_t err = esp_timer_start_periodic(s_timer, MQTT_PUBLISHER_TICK_US);
+    if (err != ESP_OK) {
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+        ESP_LOGE(TAG, "timer start failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_digest_last_emit_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "publisher started entities=%u", (unsigned)s_slot_count);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_publisher_register(const mqtt_publisher_entity_config_t *config,
+                                  mqtt_publisher_entity_t *out_entity)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && out_entity != NULL && config->topic != NULL,
+                        ESP_ERR_INVALID_ARG, TAG, "invalid entity config");
+    ESP_RETURN_ON_FALSE(strlen(config->topic) < MQTT_PUBLISHER_TOPIC_LEN, ESP_ERR_INVALID_SIZE, TAG,
+                        "topic too long: %s", config->topic);
+    *out_entity = MQTT_PUBLISHER_ENTITY_INVALID;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_slot_count >= MQTT_PUBLISHER_MAX_ENTITIES) {
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGE(TAG, "entity table full (%d)", MQTT_PUBLISHER_MAX_ENTITIES);
+        return ESP_ERR_NO_MEM;
+    }
+    const size_t index = s_slot_count++;
+    mqtt_publisher_slot_t *slot = &s_slots[index];
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->decimals = config->decimals;
+    slot->qos = config->qos;
+    slot->retain = config->retain;
+    slot->deadband = config->deadband;
+    slot->min_interval_us = (int64_t)config->min_interval_ms * 1000LL;
+    slot->max_stale_us = (int64_t)config->max_stale_ms * 1000LL;
+    strlcpy(slot->name, config->name != NULL ? config->name : config->topic, sizeof(slot->name));
+    strlcpy(slot->topic, config->topic, sizeof(slot->topic));
+    portEXIT_CRITICAL(&s_lock);
+
+    *out_entity = (mqtt_publisher_entity_t)index;
+    ESP_LOGI(TAG,
+             "registered entity=%s deadband=%.2f min_interval_ms=%u max_stale_ms=%u",
+             slot->name,
+             config->deadband,
+             (unsigned)config->min_interval_ms,
+             (unsigned)config->max_stale_ms);
+    return ESP_OK;
+}
+
+void mqtt_publisher_submit_number(mqtt_publisher_entity_t entity, float value)
+{
+    mqtt_publisher_slot_t *slot = slot_for(entity);
+    if (slot == NULL || !isfinite(value)) {
+        return;
+    }
+    char payload[MQTT_PUBLISHER_PAYLOAD_LEN];
+    snprintf(payload, sizeof(payload), "%.*f", (int)slot->decimals, value);
+
+    const int64_t now_us = esp_timer_get_time();
+    mqtt_publisher_send_t send;
+    bool do_send = false;
+
+    portENTER_CRITICAL(&s_lock);
+    slot->numeric = true;
+    slot->value = value;
+    memcpy(slot->payload, payload, sizeof(slot->payload));
+    submit_locked(slot, now_us, &send, &do_send);
+    portEXIT_CRITICAL(&s_lock);
+
+    if (do_send) {
+        send_now(entity, &send, false);
+    }
+}
+
+void mqtt_publisher_submit_text(mqtt_publisher_entity_t entity, const char *payload)
+{
+    mqtt_publisher_slot_t *slot = slot_for(entity);
+    if (slot == NULL || payload == NULL) {
+        return;
+    }
+    const int64_t now_us = esp_timer_get_time();
+    mqtt_publisher_send_t send;
+    bool do_send = false;
+
+    portENTER_CRITICAL(&s_lock);
+    slot->numeric = false;
+    strlcpy(slot->payload, payload, sizeof(slot->payload));
+    submit_locked(slot, now_us, &send, &do_send);
+    portEXIT_CRITICAL(&s_lock);
+
+    if (do_send) {
+        send_now(entity, &send, false);
+    }
+}
+
+void mqtt_publisher_republish(mqtt_publisher_entity_t entity)
+{
+    mqtt_publisher_slot_t *slot = slot_for(entity);
+    if (slot == NULL || !mqtt_manager_is_ready()) {
+        return;
+    }
+    mqtt_publisher_send_t send;
+    bool do_send = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (slot->has_value) {
+        mark_sent_locked(slot, esp_timer_get_time(), &send);
+        do_send = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (do_send) {
+        send_now(entity, &send, false);
+    }
+}
+
+static mqtt_publisher_slot_t *slot_for(mqtt_publisher_entity_t entity)
+{
+    if (entity < 0 || (size_t)entity >= s_slot_count || !s_slots[entity].used) {
+        return NULL;
+    }
+    return &s_slots[entity];
+}
+
+static void submit_locked(mqtt_publisher_slot_t *slot, int64_t now_us, mqtt_publisher_send_t *send, bool *do_send)
+{
+    slot->has_value = true;
+    slot->stats.submitted++;
+
+    bool changed = !slot->has_sent || strcmp(slot->payload, slot->sent_payload) != 0;
+    if (changed && slot->numeric && slot->has_sent && slot->deadband > 0.0f) {
+        changed = fabsf(slot->value - slot->sent_value) > slot->deadband;
+    }
+    if (!changed) {
+        // Back inside the deadband of what the broker already holds; any
+        // pending out-of-band value is now moot.
+        slot->pending = false;
+        slot->stats.suppressed++;
+        return;
+    }
+
+    const bool rate_limited = slot->has_sent && (now_us - slot->last_sent_us) < slot->min_interval_us;
+    if (rate_limited || !mqtt_manager_is_ready()) {
+        if (slot->pending) {
+            slot->stats.coalesced++;
+        }
+        slot->pending = true;
+        return;
+    }
+
+    mark_sent_locked(slot, now_us, send);
+    *do_send = true;
+}
+
+static void mark_sent_locked(mqtt_publisher_slot_t *slot, int64_t now_us, mqtt_publisher_send_t *send)
+{
+    // Optimistic: a failed publish re-arms pending in send_now().
+    slot->has_sent = true;
+    slot->pending = false;
+    slot->last_sent_us = now_us;
+    slot->sent_value = slot->value;
+    strlcpy(slot->sent_payload, slot->payload, sizeof(slot->sent_payload));
+    slot->stats.sent++;
+
+    strlcpy(send->topic, slot->topic, sizeof(send->topic));
+    strlcpy(send->payload, slot->payload, sizeof(send->payload));
+    send->qos = slot->qos;
+    send->retain = slot->retain;
+}
+
+static void send_now(mqtt_publisher_entity_t entity, const mqtt_publisher_send_t *send, bool from_timer)
+{
+    esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+    int msg_id = -1;
+    if (client != NULL) {
+        // The timer path runs on the esp_timer task and must not block on the
+        // network, so it goes through the outbox instead.
+        msg_id = from_timer
+                     ? esp_mqtt_client_enqueue(client, send->topic, send->payload, 0, send->qos, send->retain, true)
+                     : esp_mqtt_client_publish(client, send->topic, send->payload, 0, send->qos, send->retain);
+    }
+    if (msg_id >= 0) {
+        return;
+    }
+
+    mqtt_publisher_slot_t *slot = &s_slots[entity];
+    portENTER_CRITICAL(&s_lock);
+    slot->stats.sent--;
+    slot->stats.failed++;
+    slot->has_sent = false;
+    slot->pending = true;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGW(TAG, "publish failed entity=%s", slot->name);
+}
+
+static void publisher_timer_cb(void *arg)
+{
+    (void)arg;
+    const int64_t now_us = esp_timer_get_time();
+    const bool ready = mqtt_manager_is_ready();
+
+    for (size_t i = 0; ready && i < s_slot_count; ++i) {
+        mqtt_publisher_slot_t *slot = &s_slots[i];
+        mqtt_publisher_send_t send;
+        bool do_send = false;
+
+        portENTER_CRITICAL(&s_lock);
+        if (slot->used && slot->has_value) {
+            const int64_t since_sent_us = now_us - slot->last_sent_us;
+            if (slot->pending && (!slot->has_sent || since_sent_us >= slot->min_interval_us)) {
+                do_send = true;
+            } else if (slot->max_stale_us > 0 && slot->has_sent && since_sent_us >= slot->max_stale_us) {
+                slot->stats.heartbeats++;
+                do_send = true;
+            }
+            if (do_send) {
+                mark_sent_locked(slot, now_us, &send);
+            }
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (do_send) {
+            send_now((mqtt_publisher_entity_t)i, &send, true);
+        }
+    }
+
+    if ((now_us - s_digest_last_emit_us) >= MQTT_PUBLISHER_DIGEST_US) {
+        emit_digest(now_us);
+    }
+}
+
+static void emit_digest(int64_t now_us)
+{
+    for (size_t i = 0; i < s_slot_count; ++i) {
+        mqtt_publisher_slot_t *slot = &s_slots[i];
+        portENTER_CRITICAL(&s_lock);
+        const mqtt_publisher_stats_t total = slot->stats;
+        const mqtt_publisher_stats_t prev = slot->stats_prev;
+        slot->stats_prev = total;
+        portEXIT_CRITICAL(&s_lock);
+
+        ESP_LOGI(TAG,
+                 "mqtt_pub_digest entity=%s submitted_delta=%u sent_total=%u sent_delta=%u "
+                 "suppressed_total=%u suppressed_delta=%u coalesced_delta=%u heartbeat_delta=%u failed_delta=%u",
+                 slot->name,
+                 total.submitted - prev.submitted,
+                 total.sent,
+                 total.sent - prev.sent,
+                 total.suppressed,
+                 total.suppressed - prev.suppressed,
+                 total.coalesced - prev.coalesced,
+                 total.heartbeats - prev.heartbeats,
+                 total.failed - prev.failed);
+    }
+    s_digest_last_emit_us = now_us;
+}
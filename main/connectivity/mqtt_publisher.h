@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Shared state publisher for sensor and telemetry entities.
+ *
+ * Modules register each state topic once, then submit every reading. The
+ * publisher suppresses values inside the entity's deadband, rate-limits to
+ * min_interval_ms while coalescing to the newest pending value, and re-sends
+ * the latest value once it is max_stale_ms old so retained state never goes
+ * quiet. Per-entity sent/suppressed/coalesced counts are logged every minute.
+ */
+
+typedef int8_t mqtt_publisher_entity_t;
+
+#define MQTT_PUBLISHER_ENTITY_INVALID ((mqtt_publisher_entity_t)-1)
+
+typedef struct {
+    const char *name;          // short id for logs, usually the object_id
+    const char *topic;         // full state topic; copied at registration
+    float deadband;            // numeric only: publish when |delta| > deadband
+    uint8_t decimals;          // numeric payload precision
+    uint32_t min_interval_ms;  // 0 = publish every accepted change at once
+    uint32_t max_stale_ms;     // heartbeat period; 0 = never re-send
+    int qos;
+    bool retain;
+} mqtt_publisher_entity_config_t;
+
+/**
+ * @brief Starts the flush/heartbeat timer. Entities may be registered and
+ *        submitted to before this; pending values flush once it runs.
+ */
+esp_err_t mqtt_publisher_start(void);
+
+esp_err_t mqtt_publisher_register(const mqtt_publisher_entity_config_t *config,
+                                  mqtt_publisher_entity_t *out_entity);
+
+void mqtt_publisher_submit_number(mqtt_publisher_entity_t entity, float value);
+
+/**
+ * @brief Submits a text state (e.g. "ON"/"OFF"); identical payloads are
+ *        suppressed and deadband does not apply.
+ */
+void mqtt_publisher_submit_text(mqtt_publisher_entity_t entity, const char *payload);
+
+/**
+ * @brief Re-sends the latest submitted value now, ignoring deadband and rate
+ *        limit. Used after (re)connect to restore retained state.
+ */
+void mqtt_publisher_republish(mqtt_publisher_entity_t entity);
+
+#ifdef __cplusplus
+}
+#endif
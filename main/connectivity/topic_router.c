@@ -0,0 +1,173 @@
+#include "connectivity/topic_router.h"
+
+#include <string.h>
+
+static uint32_t route_hash(uint32_t seed, uint8_t ns, const char *suffix, size_t suffix_len);
+static bool try_seed(topic_router_t *router, const topic_router_key_t *keys, size_t count, uint32_t seed);
+static uint32_t rotl32(uint32_t value, unsigned shift);
+
+void topic_router_init(topic_router_t *router, topic_router_slot_t *slots, size_t slot_count)
+{
+  memset(router, 0, sizeof(*router));
+  router->slots = slots;
+  router->slot_count = slot_count;
+  if (slots != NULL) {
+    memset(slots, 0, slot_count * sizeof(slots[0]));
+  }
+}
+
+void topic_router_set_prefix(topic_router_t *router, uint8_t ns, const char *prefix, size_t prefix_len)
+{
+  if (router == NULL || ns >= TOPIC_ROUTER_MAX_NAMESPACES) {
+    return;
+  }
+  router->prefix[ns] = prefix;
+  router->prefix_len[ns] = (prefix != NULL) ? prefix_len : 0;
+}
+
+esp_err_t topic_router_build(topic_router_t *router,
+                             const topic_router_key_t *keys,
+                             size_t count,
+                             uint32_t seed_attempts)
+{
+  if (router == NULL || router->slots == NULL || (keys == NULL && count > 0) || seed_attempts == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (router->slot_count == 0 || (router->slot_count & (router->slot_count - 1)) != 0 ||
+      count >= router->slot_count || count >= TOPIC_ROUTER_NONE) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (keys[i].suffix == NULL || keys[i].ns >= TOPIC_ROUTER_MAX_NAMESPACES) {
+      return ESP_ERR_INVALID_ARG;
+    }
+  }
+
+  uint32_t best_seed = 0;
+  uint8_t best_probe = UINT8_MAX;
+  for (uint32_t seed = 0; seed < seed_attempts; ++seed) {
+    if (try_seed(router, keys, count, seed)) {
+      best_seed = seed;
+      best_probe = 0;
+      break;
+    }
+    if (router->max_probe < best_probe) {
+      best_seed = seed;
+      best_probe = router->max_probe;
+    }
+  }
+  if (best_probe != 0) {
+    // No collision-free seed; fall back to linear probing with the shortest
+    // worst-case chain found.
+    try_seed(router, keys, count, best_seed);
+  }
+  router->seed = best_seed;
+  router->route_count = count;
+  return ESP_OK;
+}
+
+uint8_t topic_router_lookup(const topic_router_t *router, uint8_t ns, const char *suffix, size_t suffix_len)
+{
+  if (router->route_count == 0) {
+    return TOPIC_ROUTER_NONE;
+  }
+  const size_t mask = router->slot_count - 1;
+  size_t slot = route_hash(router->seed, ns, suffix, suffix_len) & mask;
+  for (uint8_t probe = 0; probe <= router->max_probe; ++probe) {
+    const topic_router_slot_t *entry = &router->slots[slot];
+    if (entry->suffix == NULL) {
+      return TOPIC_ROUTER_NONE;
+    }
+    if (entry->ns == ns && entry->suffix_len == suffix_len && memcmp(entry->suffix, suffix, suffix_len) == 0) {
+      return entry->route;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return TOPIC_ROUTER_NONE;
+}
+
+uint8_t topic_router_route(const topic_router_t *router, const char *topic, size_t topic_len)
+{
+  if (router == NULL || topic == NULL) {
+    return TOPIC_ROUTER_NONE;
+  }
+  for (uint8_t ns = 0; ns < TOPIC_ROUTER_MAX_NAMESPACES; ++ns) {
+    const size_t prefix_len = router->prefix_len[ns];
+    if (prefix_len == 0 || topic_len <= prefix_len || memcmp(topic, router->prefix[ns], prefix_len) != 0) {
+      continue;
+    }
+    uint8_t route = topic_router_lookup(router, ns, topic + prefix_len, topic_len - prefix_len);
+    if (route != TOPIC_ROUTER_NONE) {
+      return route;
+    }
+  }
+  return TOPIC_ROUTER_NONE;
+}
+
+static uint32_t route_hash(uint32_t seed, uint8_t ns, const char *suffix, size_t suffix_len)
+{
+  // MurmurHash3 (x86_32), seeded per router build and salted with the
+  // namespace. It takes a word at a time, which roughly halves the cost of
+  // byte-wise FNV-1a on long HA topics.
+  uint32_t hash = seed ^ ((uint32_t)ns * 0x9e3779b9u);
+  size_t i = 0;
+  for (; i + 4 <= suffix_len; i += 4) {
+    uint32_t k;
+    memcpy(&k, suffix + i, sizeof(k));
+    k *= 0xcc9e2d51u;
+    k = rotl32(k, 15);
+    k *= 0x1b873593u;
+    hash ^= k;
+    hash = rotl32(hash, 13);
+    hash = hash * 5u + 0xe6546b64u;
+  }
+  uint32_t tail = 0;
+  for (size_t shift = 0; i < suffix_len; ++i, shift += 8) {
+    tail |= (uint32_t)(uint8_t)suffix[i] << shift;
+  }
+  if (tail != 0) {
+    tail *= 0xcc9e2d51u;
+    tail = rotl32(tail, 15);
+    tail *= 0x1b873593u;
+    hash ^= tail;
+  }
+  hash ^= (uint32_t)suffix_len;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static uint32_t rotl32(uint32_t value, unsigned shift)
+{
+  return (value << shift) | (value >> (32 - shift));
+}
+
+static bool try_seed(topic_router_t *router, const topic_router_key_t *keys, size_t count, uint32_t seed)
+{
+  const size_t mask = router->slot_count - 1;
+  memset(router->slots, 0, router->slot_count * sizeof(router->slots[0]));
+  uint8_t worst = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t suffix_len = strlen(keys[i].suffix);
+    size_t slot = route_hash(seed, keys[i].ns, keys[i].suffix, suffix_len) & mask;
+    uint8_t probe = 0;
+    while (router->slots[slot].suffix != NULL) {
+      slot = (slot + 1) & mask;
+      probe++;
+    }
+    router->slots[slot] = (topic_router_slot_t){
+        .suffix = keys[i].suffix,
+        .suffix_len = suffix_len,
+        .ns = keys[i].ns,
+        .route = (uint8_t)i,
+    };
+    if (probe > worst) {
+      worst = probe;
+    }
+  }
+  router->max_probe = worst;
+  return worst == 0;
+}
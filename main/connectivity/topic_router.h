@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Exact-match MQTT topic router.
+ *
+ * Topics are keyed on the suffix after one of a few namespace prefixes (for
+ * the dataplane, `<HABase>/` and `<TheoBase>/<slug>/`). The table is open
+ * addressed over caller-provided power-of-two slots. At build time the
+ * router searches for a hash seed that gives every key its own slot, so a
+ * lookup costs one hash and one compare. If no such seed turns up, lookups
+ * fall back to linear probing bounded by the worst chain found.
+ *
+ * The table is built once and then only read, so lookups need no lock. The
+ * module has no IDF dependencies beyond esp_err_t;
+ * scripts/topic_router_bench.c checks and times it on a host.
+ */
+
+#define TOPIC_ROUTER_MAX_NAMESPACES (4)
+#define TOPIC_ROUTER_NONE (UINT8_MAX)
+
+typedef struct {
+  const char *suffix;
+  size_t suffix_len;
+  uint8_t ns;
+  uint8_t route; // caller's index, returned by lookups
+} topic_router_slot_t;
+
+typedef struct {
+  const char *suffix; // must outlive the router
+  uint8_t ns;
+} topic_router_key_t;
+
+typedef struct {
+  topic_router_slot_t *slots;
+  size_t slot_count;
+  size_t route_count;
+  uint32_t seed;
+  uint8_t max_probe;
+  const char *prefix[TOPIC_ROUTER_MAX_NAMESPACES];
+  size_t prefix_len[TOPIC_ROUTER_MAX_NAMESPACES];
+} topic_router_t;
+
+/**
+ * @brief Binds the router to its slot storage and clears it.
+ *
+ * @param slot_count A power of two. Keep it at least twice the key count so
+ *                   the seed search reliably finds a collision-free layout.
+ */
+void topic_router_init(topic_router_t *router, topic_router_slot_t *slots, size_t slot_count);
+
+/**
+ * @brief Sets the topic prefix for namespace ns, trailing separator included.
+ *
+ * The string is not copied. A zero-length prefix disables the namespace in
+ * topic_router_route().
+ */
+void topic_router_set_prefix(topic_router_t *router, uint8_t ns, const char *prefix, size_t prefix_len);
+
+/**
+ * @brief Places keys[0..count) in the table; key i routes to index i.
+ *
+ * Tries seeds 0..seed_attempts-1 and keeps the first collision-free one, or
+ * else the one with the shortest worst-case probe chain (router->max_probe).
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for bad arguments, a slot count
+ *         that is not a power of two, or more keys than slots.
+ */
+esp_err_t topic_router_build(topic_router_t *router,
+                             const topic_router_key_t *keys,
+                             size_t count,
+                             uint32_t seed_attempts);
+
+/**
+ * @return The route index for suffix in namespace ns, or TOPIC_ROUTER_NONE.
+ */
+uint8_t topic_router_lookup(const topic_router_t *router, uint8_t ns, const char *suffix, size_t suffix_len);
+
+/**
+ * @brief Routes a full topic, trying each namespace whose prefix it starts
+ *        with in namespace order.
+ *
+ * @return The route index, or TOPIC_ROUTER_NONE.
+ */
+uint8_t topic_router_route(const topic_router_t *router, const char *topic, size_t topic_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,7 @@
 #include "ahtxx.h"
 #include "bmp280.h"
 #include "connectivity/mqtt_manager.h"
+#include "connectivity/mqtt_publisher.h"
 #include "connectivity/ha_discovery.h"
 #include "connectivity/device_identity.h"
 
@@ -37,8 +38,8 @@ static const char *TAG = "env_sensors";
 #define ENV_SENSORS_I2C_FREQ_HZ   (100000)
 #define ENV_SENSORS_TOPIC_MAX_LEN (160)
 #define ENV_SENSORS_DEVICE_TOPIC_MAX_LEN (256)
-#define ENV_SENSORS_PAYLOAD_MAX_LEN (896)
 #define ENV_SENSORS_US_PER_S      (1000000LL)
+#define ENV_SENSORS_MAX_STALE_MS  (300U * 1000U)
 
 typedef enum {
   SENSOR_ID_TEMPERATURE_BMP = 0,
@@ -53,9 +54,11 @@ typedef struct {
   const char *name;
   const char *device_class;
   const char *unit;
+  float deadband;
+  mqtt_publisher_entity_t entity;
   uint8_t consecutive_failures;
   bool online;
-  bool discovery_published;
+  ha_discovery_handle_t discovery;
 } sensor_meta_t;
 
 static sensor_meta_t s_sensor_meta[SENSOR_ID_COUNT] = {
@@ -64,32 +67,40 @@ static sensor_meta_t s_sensor_meta[SENSOR_ID_COUNT] = {
         .name = "Temperature (BMP280)",
         .device_class = "temperature",
         .unit = "°C",
+        .deadband = 0.1f,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [SENSOR_ID_TEMPERATURE_AHT] = {
         .object_id = "temperature_aht",
         .name = "Temperature (AHT20)",
         .device_class = "temperature",
         .unit = "°C",
+        .deadband = 0.1f,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [SENSOR_ID_RELATIVE_HUMIDITY] = {
         .object_id = "relative_humidity",
         .name = "Humidity",
         .device_class = "humidity",
         .unit = "%",
+        .deadband = 0.5f,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [SENSOR_ID_AIR_PRESSURE] = {
         .object_id = "air_pressure",
         .name = "Pressure",
         .device_class = "atmospheric_pressure",
         .unit = "kPa",
+        .deadband = 0.05f,
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
 };
 
@@ -105,8 +116,9 @@ static void env_sensors_task(void *arg);
 static esp_err_t init_i2c_bus(void);
 static esp_err_t init_ahtxx(void);
 static esp_err_t init_bmp280(void);
-static void publish_discovery_config(sensor_id_t sensor_id);
+static void cache_discovery_configs(void);
 static void publish_availability(sensor_id_t sensor_id, bool online);
+static void register_state_entities(void);
 static void publish_state(sensor_id_t sensor_id, float value);
 static void build_topic(char *buf, size_t buf_len, sensor_id_t sensor_id, const char *suffix);
 static void handle_sensor_success(sensor_id_t sensor_id, float value);
@@ -164,6 +176,9 @@ esp_err_t env_sensors_start(void)
     return err;
   }
 
+  cache_discovery_configs();
+  register_state_entities();
+
   // Create sampling task
   BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(
       env_sensors_task,
@@ -318,57 +333,40 @@ static void build_topic(char *buf, size_t buf_len, sensor_id_t sensor_id, const
   }
 }
 
-static void publish_discovery_config(sensor_id_t sensor_id)
+static void cache_discovery_configs(void)
 {
-  if (!mqtt_manager_is_ready()) {
-    return;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
-  }
-
-  sensor_meta_t *meta = &s_sensor_meta[sensor_id];
-
-  // Build discovery topic
-  char discovery_topic[ENV_SENSORS_TOPIC_MAX_LEN];
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), "sensor", device_identity_get_slug(),
-                           meta->object_id);
-
-  // Build state and availability topics
-  char state_topic[ENV_SENSORS_TOPIC_MAX_LEN];
-  char avail_topic[ENV_SENSORS_TOPIC_MAX_LEN];
-  char device_avail_topic[ENV_SENSORS_DEVICE_TOPIC_MAX_LEN];
-  build_topic(state_topic, sizeof(state_topic), sensor_id, "state");
-  build_topic(avail_topic, sizeof(avail_topic), sensor_id, "availability");
-  snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
-           device_identity_get_theo_device_topic_root());
-
-  ha_discovery_entity_t entity = {
-      .component = "sensor",
-      .object_id = meta->object_id,
-      .name = meta->name,
-      .device_class = meta->device_class,
-      .state_class = "measurement",
-      .unit = meta->unit,
-      .state_topic = state_topic,
-      .availability_topic = device_avail_topic,
-      .sensor_availability_topic = avail_topic,
-  };
-
-  char payload[ENV_SENSORS_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, device_identity_get_slug(),
-                                 device_identity_get_friendly_name()) < 0) {
-    return;
-  }
+  for (sensor_id_t sensor_id = 0; sensor_id < SENSOR_ID_COUNT; ++sensor_id) {
+    sensor_meta_t *meta = &s_sensor_meta[sensor_id];
+    if (meta->discovery != HA_DISCOVERY_HANDLE_INVALID) {
+      continue;
+    }
 
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);  // QoS0, retained
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for %s", meta->object_id);
-  } else {
-    ESP_LOGI(TAG, "Published discovery config for %s (msg_id=%d)", meta->object_id, msg_id);
-    meta->discovery_published = true;
+    // Build state and availability topics
+    char state_topic[ENV_SENSORS_TOPIC_MAX_LEN];
+    char avail_topic[ENV_SENSORS_TOPIC_MAX_LEN];
+    char device_avail_topic[ENV_SENSORS_DEVICE_TOPIC_MAX_LEN];
+    build_topic(state_topic, sizeof(state_topic), sensor_id, "state");
+    build_topic(avail_topic, sizeof(avail_topic), sensor_id, "availability");
+    snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
+             device_identity_get_theo_device_topic_root());
+
+    ha_discovery_entity_t entity = {
+        .component = "sensor",
+        .object_id = meta->object_id,
+        .name = meta->name,
+        .device_class = meta->device_class,
+        .state_class = "measurement",
+        .unit = meta->unit,
+        .state_topic = state_topic,
+        .availability_topic = device_avail_topic,
+        .sensor_availability_topic = avail_topic,
+    };
+
+    // The discovery cache publishes it now if connected and after every reconnect
+    esp_err_t err = ha_discovery_cache_add(&entity, NULL, &meta->discovery);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to cache discovery for %s: %s", meta->object_id, esp_err_to_name(err));
+    }
   }
 }
 
@@ -395,28 +393,38 @@ static void publish_availability(sensor_id_t sensor_id, bool online)
   }
 }
 
-static void publish_state(sensor_id_t sensor_id, float value)
+static void register_state_entities(void)
 {
-  if (!mqtt_manager_is_ready()) {
-    ESP_LOGW(TAG, "MQTT not ready, skipping state publish for %s", s_sensor_meta[sensor_id].object_id);
-    return;
-  }
+  for (sensor_id_t sensor_id = 0; sensor_id < SENSOR_ID_COUNT; ++sensor_id) {
+    sensor_meta_t *meta = &s_sensor_meta[sensor_id];
+    if (meta->entity != MQTT_PUBLISHER_ENTITY_INVALID) {
+      continue;
+    }
 
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
+    char topic[ENV_SENSORS_TOPIC_MAX_LEN];
+    build_topic(topic, sizeof(topic), sensor_id, "state");
+
+    const mqtt_publisher_entity_config_t config = {
+        .name = meta->object_id,
+        .topic = topic,
+        .deadband = meta->deadband,
+        .decimals = 2,
+        .min_interval_ms = 0,
+        .max_stale_ms = ENV_SENSORS_MAX_STALE_MS,
+        .qos = 0,
+        .retain = true,
+    };
+    esp_err_t err = mqtt_publisher_register(&config, &meta->entity);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to register state entity for %s: %s", meta->object_id, esp_err_to_name(err));
+    }
   }
+}
 
-  char topic[ENV_SENSORS_TOPIC_MAX_LEN];
-  build_topic(topic, sizeof(topic), sensor_id, "state");
-
-  char payload[16];
-  snprintf(payload, sizeof(payload), "%.2f", value);
-
-  int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 0, 1);  // QoS0, retained
-  if (msg_id < 0) {
-    ESP_LOGW(TAG, "Failed to publish state for %s", s_sensor_meta[sensor_id].object_id);
-  }
+static void publish_state(sensor_id_t sensor_id, float value)
+{
+  // Deadband, rate limit and heartbeat are handled by the shared publisher.
+  mqtt_publisher_submit_number(s_sensor_meta[sensor_id].entity, value);
 }
 
 static void env_sensors_mqtt_event_handler(void *handler_args,
@@ -443,11 +451,11 @@ static void republish_entities_on_connect(void)
     float value = 0.0f;
     bool has_cached_state = get_cached_state(sensor_id, &value);
 
-    publish_discovery_config(sensor_id);
     publish_availability(sensor_id, s_sensor_meta[sensor_id].online);
 
     if (has_cached_state) {
-      publish_state(sensor_id, value);
+      // The publisher already holds this value; force it past the deadband.
+      mqtt_publisher_republish(s_sensor_meta[sensor_id].entity);
     }
   }
 }
@@ -496,11 +504,6 @@ static void handle_sensor_success(sensor_id_t sensor_id, float value)
 
   meta->consecutive_failures = 0;
 
-  // Publish discovery config if not yet done
-  if (!meta->discovery_published) {
-    publish_discovery_config(sensor_id);
-  }
-
   // Transition to online if needed
   if (was_offline) {
     meta->online = true;
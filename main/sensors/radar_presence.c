@@ -19,6 +19,7 @@
 
 #include "ld2410.h"
 #include "connectivity/mqtt_manager.h"
+#include "connectivity/mqtt_publisher.h"
 #include "connectivity/ha_discovery.h"
 #include "connectivity/device_identity.h"
 
@@ -37,12 +38,14 @@ static const char *TAG = "radar_presence";
 #define RADAR_TASK_PRIO       (4)
 #define RADAR_TOPIC_MAX_LEN   (160)
 #define RADAR_DEVICE_TOPIC_MAX_LEN (256)
-#define RADAR_PAYLOAD_MAX_LEN (896)
 #define RADAR_POLL_MS         (100)
 #define RADAR_FRAME_TIMEOUT_US (1000000LL)  // 1 second
 #define RADAR_STATE_MUTEX_TIMEOUT_MS (50)
 #define RADAR_GATE_COUNT      (9)
 #define RADAR_ENERGY_UNAVAILABLE (-1)
+#define RADAR_DISTANCE_DEADBAND_CM (5.0f)
+#define RADAR_DISTANCE_MIN_INTERVAL_MS (1000U)
+#define RADAR_MAX_STALE_MS    (600U * 1000U)
 
 typedef enum {
   RADAR_SENSOR_PRESENCE = 0,
@@ -56,8 +59,9 @@ typedef struct {
   const char *device_class;
   const char *unit;
   const char *sensor_type;  // "sensor" or "binary_sensor"
+  mqtt_publisher_entity_t entity;
   bool online;
-  bool discovery_published;
+  ha_discovery_handle_t discovery;
 } radar_sensor_meta_t;
 
 static radar_sensor_meta_t s_sensor_meta[RADAR_SENSOR_COUNT] = {
@@ -67,8 +71,9 @@ static radar_sensor_meta_t s_sensor_meta[RADAR_SENSOR_COUNT] = {
         .device_class = "occupancy",
         .unit = NULL,
         .sensor_type = "binary_sensor",
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
     [RADAR_SENSOR_DISTANCE] = {
         .object_id = "radar_distance",
@@ -76,8 +81,9 @@ static radar_sensor_meta_t s_sensor_meta[RADAR_SENSOR_COUNT] = {
         .device_class = "distance",
         .unit = "cm",
         .sensor_type = "sensor",
+        .entity = MQTT_PUBLISHER_ENTITY_INVALID,
         .online = false,
-        .discovery_published = false,
+        .discovery = HA_DISCOVERY_HANDLE_INVALID,
     },
 };
 
@@ -89,14 +95,13 @@ static bool s_started;
 static bool s_mqtt_event_registered;
 static bool s_online;
 static uint8_t s_consecutive_failures;
-static bool s_last_presence_published;
-static uint16_t s_last_distance_published;
 
 static void radar_task(void *arg);
 static void radar_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void build_topic(char *buf, size_t buf_len, radar_sensor_id_t sensor_id, const char *suffix);
 static void republish_mqtt_state(void);
-static void publish_discovery_config(radar_sensor_id_t sensor_id);
+static void register_state_entities(void);
+static void cache_discovery_configs(void);
 static void publish_availability(radar_sensor_id_t sensor_id, bool online);
 static void publish_presence_state(bool presence);
 static void publish_distance_state(uint16_t distance_cm);
@@ -162,6 +167,9 @@ esp_err_t radar_presence_start(void)
   }
   s_mqtt_event_registered = true;
 
+  cache_discovery_configs();
+  register_state_entities();
+
   if (mqtt_manager_is_ready()) {
     republish_mqtt_state();
   }
@@ -373,19 +381,13 @@ static void radar_mqtt_event_handler(void *handler_args,
 
 static void republish_mqtt_state(void)
 {
-  radar_presence_state_t cached_state = {0};
   bool has_cached_state = false;
 
   if (s_state_mutex != NULL && xSemaphoreTake(s_state_mutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-    cached_state = s_cached_state;
-    has_cached_state = s_online && cached_state.last_update_us > 0;
+    has_cached_state = s_online && s_cached_state.last_update_us > 0;
     xSemaphoreGive(s_state_mutex);
   }
 
-  for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
-    publish_discovery_config((radar_sensor_id_t)i);
-  }
-
   for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
     publish_availability((radar_sensor_id_t)i, s_sensor_meta[i].online);
   }
@@ -394,8 +396,41 @@ static void republish_mqtt_state(void)
     return;
   }
 
-  publish_presence_state(cached_state.presence_detected);
-  publish_distance_state(cached_state.detection_distance_cm);
+  // The publisher holds the last submitted values; force them out again.
+  for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
+    mqtt_publisher_republish(s_sensor_meta[i].entity);
+  }
+}
+
+static void register_state_entities(void)
+{
+  for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
+    radar_sensor_meta_t *meta = &s_sensor_meta[i];
+    if (meta->entity != MQTT_PUBLISHER_ENTITY_INVALID) {
+      continue;
+    }
+
+    char topic[RADAR_TOPIC_MAX_LEN];
+    build_topic(topic, sizeof(topic), (radar_sensor_id_t)i, "state");
+
+    // Presence edges go out immediately; distance is the ~10 Hz stream, so it
+    // is held to one publish per second with the newest value winning.
+    const bool is_distance = (i == RADAR_SENSOR_DISTANCE);
+    const mqtt_publisher_entity_config_t config = {
+        .name = meta->object_id,
+        .topic = topic,
+        .deadband = is_distance ? RADAR_DISTANCE_DEADBAND_CM : 0.0f,
+        .decimals = 0,
+        .min_interval_ms = is_distance ? RADAR_DISTANCE_MIN_INTERVAL_MS : 0,
+        .max_stale_ms = RADAR_MAX_STALE_MS,
+        .qos = 0,
+        .retain = true,
+    };
+    esp_err_t err = mqtt_publisher_register(&config, &meta->entity);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to register state entity for %s: %s", meta->object_id, esp_err_to_name(err));
+    }
+  }
 }
 
 static void radar_task(void *arg)
@@ -485,66 +520,49 @@ static void build_topic(char *buf, size_t buf_len, radar_sensor_id_t sensor_id,
   }
 }
 
-static void publish_discovery_config(radar_sensor_id_t sensor_id)
+static void cache_discovery_configs(void)
 {
-  if (!mqtt_manager_is_ready()) {
-    return;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
-  }
-
-  const char *slug = device_identity_get_slug();
-  radar_sensor_meta_t *meta = &s_sensor_meta[sensor_id];
-
-  // Build discovery topic
-  char discovery_topic[RADAR_TOPIC_MAX_LEN];
   char node_id[64];
-  snprintf(node_id, sizeof(node_id), "%s-theostat", slug);
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), meta->sensor_type, node_id,
-                           meta->object_id);
-
-  // Build state and availability topics
-  char state_topic[RADAR_TOPIC_MAX_LEN];
-  char avail_topic[RADAR_TOPIC_MAX_LEN];
-  char device_avail_topic[RADAR_DEVICE_TOPIC_MAX_LEN];
-  build_topic(state_topic, sizeof(state_topic), sensor_id, "state");
-  build_topic(avail_topic, sizeof(avail_topic), sensor_id, "availability");
-  snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
-           device_identity_get_theo_device_topic_root());
-
-  ha_discovery_entity_t entity = {
-      .component = meta->sensor_type,
-      .object_id = meta->object_id,
-      .name = meta->name,
-      .device_class = meta->device_class,
-      .unit = meta->unit,
-      .state_topic = state_topic,
-      .availability_topic = device_avail_topic,
-      .sensor_availability_topic = avail_topic,
-  };
-
-  if (sensor_id == RADAR_SENSOR_PRESENCE) {
-    entity.payload_on = "ON";
-    entity.payload_off = "OFF";
-  } else {
-    entity.state_class = "measurement";
-  }
+  snprintf(node_id, sizeof(node_id), "%s-theostat", device_identity_get_slug());
 
-  char payload[RADAR_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, slug,
-                                 device_identity_get_friendly_name()) < 0) {
-    return;
-  }
+  for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
+    radar_sensor_meta_t *meta = &s_sensor_meta[i];
+    if (meta->discovery != HA_DISCOVERY_HANDLE_INVALID) {
+      continue;
+    }
 
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for %s", meta->object_id);
-  } else {
-    ESP_LOGI(TAG, "Published discovery config for %s (msg_id=%d)", meta->object_id, msg_id);
-    meta->discovery_published = true;
+    // Build state and availability topics
+    char state_topic[RADAR_TOPIC_MAX_LEN];
+    char avail_topic[RADAR_TOPIC_MAX_LEN];
+    char device_avail_topic[RADAR_DEVICE_TOPIC_MAX_LEN];
+    build_topic(state_topic, sizeof(state_topic), (radar_sensor_id_t)i, "state");
+    build_topic(avail_topic, sizeof(avail_topic), (radar_sensor_id_t)i, "availability");
+    snprintf(device_avail_topic, sizeof(device_avail_topic), "%s/availability",
+             device_identity_get_theo_device_topic_root());
+
+    ha_discovery_entity_t entity = {
+        .component = meta->sensor_type,
+        .object_id = meta->object_id,
+        .name = meta->name,
+        .device_class = meta->device_class,
+        .unit = meta->unit,
+        .state_topic = state_topic,
+        .availability_topic = device_avail_topic,
+        .sensor_availability_topic = avail_topic,
+    };
+
+    if (i == RADAR_SENSOR_PRESENCE) {
+      entity.payload_on = "ON";
+      entity.payload_off = "OFF";
+    } else {
+      entity.state_class = "measurement";
+    }
+
+    // The discovery cache publishes it now if connected and after every reconnect
+    esp_err_t err = ha_discovery_cache_add(&entity, node_id, &meta->discovery);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to cache discovery for %s: %s", meta->object_id, esp_err_to_name(err));
+    }
   }
 }
 
@@ -573,46 +591,12 @@ static void publish_availability(radar_sensor_id_t sensor_id, bool online)
 
 static void publish_presence_state(bool presence)
 {
-  if (!mqtt_manager_is_ready()) {
-    return;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
-  }
-
-  char topic[RADAR_TOPIC_MAX_LEN];
-  build_topic(topic, sizeof(topic), RADAR_SENSOR_PRESENCE, "state");
-
-  const char *payload = presence ? "ON" : "OFF";
-  int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGW(TAG, "Failed to publish presence state");
-  }
+  mqtt_publisher_submit_text(s_sensor_meta[RADAR_SENSOR_PRESENCE].entity, presence ? "ON" : "OFF");
 }
 
 static void publish_distance_state(uint16_t distance_cm)
 {
-  if (!mqtt_manager_is_ready()) {
-    return;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
-  }
-
-  char topic[RADAR_TOPIC_MAX_LEN];
-  build_topic(topic, sizeof(topic), RADAR_SENSOR_DISTANCE, "state");
-
-  char payload[16];
-  snprintf(payload, sizeof(payload), "%u", distance_cm);
-
-  int msg_id = esp_mqtt_client_publish(client, topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGW(TAG, "Failed to publish distance state");
-  }
+  mqtt_publisher_submit_number(s_sensor_meta[RADAR_SENSOR_DISTANCE].entity, (float)distance_cm);
 }
 
 static void handle_frame_success(bool presence, uint16_t distance_cm)
@@ -621,13 +605,6 @@ static void handle_frame_success(bool presence, uint16_t distance_cm)
 
   s_consecutive_failures = 0;
 
-  // Publish discovery configs if not yet done
-  for (int i = 0; i < RADAR_SENSOR_COUNT; ++i) {
-    if (!s_sensor_meta[i].discovery_published) {
-      publish_discovery_config((radar_sensor_id_t)i);
-    }
-  }
-
   // Transition to online if needed
   if (was_offline) {
     s_online = true;
@@ -638,19 +615,13 @@ static void handle_frame_success(bool presence, uint16_t distance_cm)
     ESP_LOGI(TAG, "Radar now online");
   }
 
-  // Publish state if changed (avoid flooding MQTT)
-  if (presence != s_last_presence_published) {
-    publish_presence_state(presence);
-    s_last_presence_published = presence;
-  }
+  // Every frame is submitted; the shared publisher drops repeats, applies the
+  // distance deadband and rate limit, and keeps retained state fresh.
+  publish_presence_state(presence);
 
-  // Publish distance if presence detected and distance changed significantly (>5cm)
+  // Distance is only meaningful while a target is present
   if (presence) {
-    int16_t delta = (int16_t)distance_cm - (int16_t)s_last_distance_published;
-    if (delta < -5 || delta > 5 || s_last_distance_published == 0) {
-      publish_distance_state(distance_cm);
-      s_last_distance_published = distance_cm;
-    }
+    publish_distance_state(distance_cm);
   }
 }
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Where the snapshot pipeline gets its raw frames from.
+ *
+ * A source owns its capture buffers and hands them out one at a time:
+ * dequeue() blocks until a frame is ready, requeue() gives the buffer back.
+ * open() negotiates the format and allocates buffers; start() begins
+ * producing frames and discards the first few, which on a real sensor are
+ * still settling.
+ *
+ * The V4L2 backend drives the MIPI-CSI sensor through esp_video. The synthetic
+ * backend renders a moving test pattern into PSRAM at the same size and
+ * format, so the staging/encode/publish path can be measured and exercised
+ * without a sensor attached.
+ */
+
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  size_t buffer_count;
+} camera_source_config_t;
+
+typedef struct {
+  uint32_t pixfmt; // V4L2 fourcc, RGB565 or RGB24
+  size_t stride;   // bytes per row, may include padding
+  size_t buffer_count;
+  size_t buffer_bytes; // total capture buffer memory held by the source
+  bool upright;        // image already has the mounting rotation removed
+  bool zero_copy;      // upright, packed and aligned: the encoder may read buffers in place
+} camera_source_format_t;
+
+typedef struct {
+  const uint8_t *data;
+  size_t bytesused;
+  uint32_t index;
+} camera_source_buffer_t;
+
+typedef struct {
+  const char *name;
+  esp_err_t (*open)(const camera_source_config_t *config, camera_source_format_t *out);
+  void (*close)(void);
+  esp_err_t (*start)(void);
+  void (*stop)(void);
+  esp_err_t (*dequeue)(camera_source_buffer_t *buf);
+  esp_err_t (*requeue)(const camera_source_buffer_t *buf);
+} camera_frame_source_t;
+
+const camera_frame_source_t *camera_frame_source_v4l2(void);
+const camera_frame_source_t *camera_frame_source_synthetic(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,239 @@
+#include "streaming/camera_http_endpoint.h"
+
+#include <stdio.h>
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "connectivity/http_server.h"
+
+#define TAG "camera_http"
+
+#define CAMERA_HTTP_SNAPSHOT_URI "/camera/snapshot.jpg"
+#define CAMERA_HTTP_STREAM_URI "/camera/stream.mjpeg"
+#define CAMERA_HTTP_BOUNDARY "theoframe"
+#define CAMERA_HTTP_PART_HEADER_MAX_LEN 96
+#define CAMERA_HTTP_FRAME_POLL_MS 20
+#define CAMERA_HTTP_SNAPSHOT_WAIT_MS 2000
+#define CAMERA_HTTP_STREAM_IDLE_TIMEOUT_MS 10000
+#define CAMERA_HTTP_STREAM_TASK_STACK_BYTES 4096
+#define CAMERA_HTTP_STREAM_TASK_PRIORITY 3
+
+static const camera_http_frame_source_t *s_source;
+static uint32_t s_active_streams;
+static portMUX_TYPE s_stream_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t snapshot_get_handler(httpd_req_t *req);
+static esp_err_t stream_get_handler(httpd_req_t *req);
+static void stream_task(void *arg);
+static bool wait_for_frame(uint32_t after_seq, uint32_t timeout_ms, camera_snapshot_ref_t *out);
+static esp_err_t send_stream_part(httpd_req_t *req, const camera_snapshot_ref_t *ref);
+static bool reserve_stream(void);
+static void release_stream(void);
+
+esp_err_t camera_http_endpoint_register(const camera_http_frame_source_t *source)
+{
+  ESP_RETURN_ON_FALSE(source != NULL && source->acquire_latest != NULL && source->release != NULL,
+                      ESP_ERR_INVALID_ARG,
+                      TAG,
+                      "Frame source required");
+  s_source = source;
+
+  const httpd_uri_t snapshot_uri = {
+    .uri = CAMERA_HTTP_SNAPSHOT_URI,
+    .method = HTTP_GET,
+    .handler = snapshot_get_handler,
+    .user_ctx = NULL,
+  };
+  ESP_RETURN_ON_ERROR(http_server_register_uri_handler(&snapshot_uri), TAG, "Failed to register snapshot URI");
+
+  const httpd_uri_t stream_uri = {
+    .uri = CAMERA_HTTP_STREAM_URI,
+    .method = HTTP_GET,
+    .handler = stream_get_handler,
+    .user_ctx = NULL,
+  };
+  ESP_RETURN_ON_ERROR(http_server_register_uri_handler(&stream_uri), TAG, "Failed to register stream URI");
+
+  ESP_LOGI(TAG,
+           "Camera HTTP endpoints ready (%s %s max_streams=%d)",
+           CAMERA_HTTP_SNAPSHOT_URI,
+           CAMERA_HTTP_STREAM_URI,
+           CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS);
+  return ESP_OK;
+}
+
+static esp_err_t snapshot_get_handler(httpd_req_t *req)
+{
+  camera_snapshot_ref_t ref;
+  // Right after boot or a camera restart there may be no frame yet; wait about
+  // one startup's worth rather than failing the first request.
+  if (!wait_for_frame(0, CAMERA_HTTP_SNAPSHOT_WAIT_MS, &ref)) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    return httpd_resp_send(req, "camera unavailable\n", HTTPD_RESP_USE_STRLEN);
+  }
+
+  httpd_resp_set_type(req, "image/jpeg");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  const int64_t send_start_us = esp_timer_get_time();
+  esp_err_t err = httpd_resp_send(req, (const char *)ref.jpeg, (ssize_t)ref.jpeg_size);
+  const int64_t send_us = esp_timer_get_time() - send_start_us;
+  const uint32_t seq = ref.seq;
+  const size_t bytes = ref.jpeg_size;
+  s_source->release(&ref);
+
+  ESP_LOGI(TAG,
+           "camera_http_snapshot seq=%u bytes=%u send_us=%lld err=%s",
+           seq,
+           (unsigned)bytes,
+           (long long)send_us,
+           esp_err_to_name(err));
+  return err;
+}
+
+static esp_err_t stream_get_handler(httpd_req_t *req)
+{
+  if (!reserve_stream()) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_send(req, "too many camera streams\n", HTTPD_RESP_USE_STRLEN);
+  }
+
+  httpd_req_t *async_req = NULL;
+  esp_err_t err = httpd_req_async_handler_begin(req, &async_req);
+  if (err != ESP_OK) {
+    release_stream();
+    ESP_LOGW(TAG, "Stream async begin failed: %s", esp_err_to_name(err));
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "stream unavailable");
+  }
+
+  BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(stream_task,
+                                                       "cam_mjpeg",
+                                                       CAMERA_HTTP_STREAM_TASK_STACK_BYTES,
+                                                       async_req,
+                                                       CAMERA_HTTP_STREAM_TASK_PRIORITY,
+                                                       NULL,
+                                                       tskNO_AFFINITY,
+                                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (task_ok != pdPASS) {
+    release_stream();
+    ESP_LOGE(TAG, "Failed to create stream task");
+    httpd_resp_send_err(async_req, HTTPD_500_INTERNAL_SERVER_ERROR, "stream unavailable");
+    httpd_req_async_handler_complete(async_req);
+    return ESP_OK;
+  }
+  return ESP_OK;
+}
+
+static void stream_task(void *arg)
+{
+  httpd_req_t *req = arg;
+  const int64_t start_us = esp_timer_get_time();
+  uint32_t frames = 0;
+  uint64_t bytes = 0;
+  uint32_t last_seq = 0;
+  esp_err_t err = ESP_OK;
+
+  if (s_source->viewer_attach != NULL) {
+    s_source->viewer_attach();
+  }
+  httpd_resp_set_type(req, "multipart/x-mixed-replace;boundary=" CAMERA_HTTP_BOUNDARY);
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+  while (true) {
+    camera_snapshot_ref_t ref;
+    // Only frames newer than the last one sent; a stopped camera ends the
+    // stream after the idle timeout rather than holding the socket forever.
+    if (!wait_for_frame(last_seq, CAMERA_HTTP_STREAM_IDLE_TIMEOUT_MS, &ref)) {
+      err = ESP_ERR_TIMEOUT;
+      break;
+    }
+    err = send_stream_part(req, &ref);
+    last_seq = ref.seq;
+    const size_t frame_bytes = ref.jpeg_size;
+    s_source->release(&ref);
+    if (err != ESP_OK) {
+      break;
+    }
+    frames++;
+    bytes += frame_bytes;
+  }
+
+  if (err == ESP_ERR_TIMEOUT) {
+    (void)httpd_resp_send_chunk(req, NULL, 0);
+  }
+  httpd_req_async_handler_complete(req);
+  if (s_source->viewer_detach != NULL) {
+    s_source->viewer_detach();
+  }
+  release_stream();
+
+  const int64_t duration_us = esp_timer_get_time() - start_us;
+  ESP_LOGI(TAG,
+           "camera_http_stream_end frames=%u bytes=%llu duration_ms=%lld reason=%s",
+           frames,
+           (unsigned long long)bytes,
+           (long long)(duration_us / 1000),
+           esp_err_to_name(err));
+  vTaskDelete(NULL);
+}
+
+static bool wait_for_frame(uint32_t after_seq, uint32_t timeout_ms, camera_snapshot_ref_t *out)
+{
+  const int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000LL;
+  while (!s_source->acquire_latest(after_seq, out)) {
+    if (esp_timer_get_time() >= deadline_us) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(CAMERA_HTTP_FRAME_POLL_MS));
+  }
+  return true;
+}
+
+static esp_err_t send_stream_part(httpd_req_t *req, const camera_snapshot_ref_t *ref)
+{
+  char header[CAMERA_HTTP_PART_HEADER_MAX_LEN];
+  int written = snprintf(header,
+                         sizeof(header),
+                         "--" CAMERA_HTTP_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+                         (unsigned)ref->jpeg_size);
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(header), ESP_ERR_INVALID_SIZE, TAG, "Part header overflow");
+
+  // A failed send is normally just the viewer going away; the caller logs the
+  // stream summary, so no per-call error logging here.
+  esp_err_t err = httpd_resp_send_chunk(req, header, written);
+  if (err == ESP_OK) {
+    err = httpd_resp_send_chunk(req, (const char *)ref->jpeg, (ssize_t)ref->jpeg_size);
+  }
+  if (err == ESP_OK) {
+    err = httpd_resp_send_chunk(req, "\r\n", 2);
+  }
+  return err;
+}
+
+static bool reserve_stream(void)
+{
+  bool ok = false;
+  taskENTER_CRITICAL(&s_stream_lock);
+  if (s_active_streams < CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS) {
+    s_active_streams++;
+    ok = true;
+  }
+  taskEXIT_CRITICAL(&s_stream_lock);
+  return ok;
+}
+
+static void release_stream(void)
+{
+  taskENTER_CRITICAL(&s_stream_lock);
+  if (s_active_streams > 0) {
+    s_active_streams--;
+  }
+  taskEXIT_CRITICAL(&s_stream_lock);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "streaming/camera_snapshot_publisher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * HTTP access to camera snapshots on the shared HTTP service:
+ *
+ *   GET /camera/snapshot.jpg   latest encoded frame
+ *   GET /camera/stream.mjpeg   multipart/x-mixed-replace stream of new frames
+ *
+ * Frames are sent straight out of the encoder's buffer through a reference,
+ * so any number of clients share one encode and nothing is copied. Streams
+ * run on their own tasks (async requests) so a long-lived viewer does not
+ * block the HTTP service for OTA or single snapshots.
+ *
+ * The frame source is injected so the handlers can run against a synthetic
+ * source; on the device it is the snapshot publisher.
+ */
+typedef struct {
+  bool (*acquire_latest)(uint32_t after_seq, camera_snapshot_ref_t *out);
+  void (*release)(camera_snapshot_ref_t *ref);
+  void (*viewer_attach)(void);
+  void (*viewer_detach)(void);
+} camera_http_frame_source_t;
+
+/**
+ * @brief Registers both URIs. http_server_start() must have succeeded.
+ *        source must outlive the HTTP service.
+ */
+esp_err_t camera_http_endpoint_register(const camera_http_frame_source_t *source);
+
+#ifdef __cplusplus
+}
+#endif
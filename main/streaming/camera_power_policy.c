@@ -0,0 +1,51 @@
+#include "streaming/camera_power_policy.h"
+
+#include <string.h>
+
+void camera_power_policy_init(camera_power_policy_t *policy,
+                              const camera_power_policy_config_t *config,
+                              int64_t now_us)
+{
+  memset(policy, 0, sizeof(*policy));
+  policy->config = *config;
+  if (policy->config.off_after_ms < policy->config.idle_after_ms) {
+    policy->config.off_after_ms = policy->config.idle_after_ms;
+  }
+  policy->state = CAMERA_POWER_ACTIVE;
+  policy->last_presence_us = now_us;
+}
+
+bool camera_power_policy_update(camera_power_policy_t *policy, bool present, int64_t now_us)
+{
+  if (present) {
+    policy->last_presence_us = now_us;
+  }
+
+  const int64_t vacant_us = now_us - policy->last_presence_us;
+  camera_power_state_t next = CAMERA_POWER_ACTIVE;
+  if (vacant_us >= (int64_t)policy->config.off_after_ms * 1000LL) {
+    next = CAMERA_POWER_OFF;
+  } else if (vacant_us >= (int64_t)policy->config.idle_after_ms * 1000LL) {
+    next = CAMERA_POWER_IDLE;
+  }
+
+  if (next == policy->state) {
+    return false;
+  }
+  policy->state = next;
+  return true;
+}
+
+const char *camera_power_state_to_str(camera_power_state_t state)
+{
+  switch (state) {
+  case CAMERA_POWER_ACTIVE:
+    return "active";
+  case CAMERA_POWER_IDLE:
+    return "idle";
+  case CAMERA_POWER_OFF:
+    return "off";
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Presence-driven power state for the camera pipeline.
+ *
+ * ACTIVE captures at the configured snapshot interval, IDLE keeps the sensor
+ * streaming but captures only a slow heartbeat, and OFF releases the sensor,
+ * MIPI PHY LDO, JPEG encoder and IR LED entirely. The state follows time since
+ * presence was last seen: any presence returns to ACTIVE at once, vacancy
+ * steps down after idle_after_ms and then off_after_ms.
+ *
+ * Callers report "present" whenever presence cannot be ruled out (radar
+ * offline, a live viewer attached), so a missing sensor degrades to the old
+ * always-on behaviour. Pure logic; runs unchanged on a host.
+ */
+
+typedef enum {
+  CAMERA_POWER_ACTIVE = 0,
+  CAMERA_POWER_IDLE,
+  CAMERA_POWER_OFF,
+} camera_power_state_t;
+
+typedef struct {
+  uint32_t idle_after_ms; // vacancy before dropping to the heartbeat rate
+  uint32_t off_after_ms;  // vacancy before releasing the hardware; >= idle_after_ms
+} camera_power_policy_config_t;
+
+typedef struct {
+  camera_power_policy_config_t config;
+  camera_power_state_t state;
+  int64_t last_presence_us;
+} camera_power_policy_t;
+
+/**
+ * @brief Starts ACTIVE, as if presence was seen at now_us.
+ */
+void camera_power_policy_init(camera_power_policy_t *policy,
+                              const camera_power_policy_config_t *config,
+                              int64_t now_us);
+
+/**
+ * @brief Feeds one presence sample.
+ * @return true if the state changed.
+ */
+bool camera_power_policy_update(camera_power_policy_t *policy, bool present, int64_t now_us);
+
+const char *camera_power_state_to_str(camera_power_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
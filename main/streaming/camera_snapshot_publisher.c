@@ -2,35 +2,37 @@
 
 #if CONFIG_THEO_CAMERA_ENABLE
 
-#include <errno.h>
-#include <fcntl.h>
 #include <linux/videodev2.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
-#include <unistd.h>
 
-#include "driver/i2c_master.h"
 #include "driver/jpeg_encode.h"
+#include "esp_attr.h"
 #include "esp_check.h"
 #include "esp_heap_caps.h"
-#include "esp_ldo_regulator.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "esp_video_device.h"
-#include "esp_video_init.h"
 #include "mqtt_client.h"
 #include "sdkconfig.h"
 
-#include "bsp/esp32_p4_nano.h"
 #include "connectivity/device_identity.h"
 #include "connectivity/ha_discovery.h"
 #include "connectivity/mqtt_manager.h"
+#include "sensors/radar_presence.h"
+#include "streaming/camera_frame_source.h"
+#include "streaming/camera_power_policy.h"
+#include "streaming/frame_transform.h"
+#include "streaming/motion_detector.h"
+#include "streaming/snapshot_rate_controller.h"
 #include "thermostat/ir_led.h"
 
+#if CONFIG_THEO_TRANSPORT_MONITOR
+#include "connectivity/transport_monitor.h"
+#endif
+
 #define TAG "camera_snapshot"
 
 #define CAMERA_SNAPSHOT_WIDTH 800
@@ -38,53 +40,240 @@
 #define CAMERA_SNAPSHOT_BUFFER_COUNT 2
 #define CAMERA_SNAPSHOT_CAPTURE_TIMEOUT_MS 1000
 #define CAMERA_SNAPSHOT_JPEG_BUFFER_BYTES (512 * 1024)
-#define CAMERA_SNAPSHOT_JPEG_QUALITY 80
+#define CAMERA_SNAPSHOT_THUMB_JPEG_BUFFER_BYTES (64 * 1024)
+#define CAMERA_SNAPSHOT_BUFFER_ALIGN 128
 #define CAMERA_SNAPSHOT_METRICS_BATCH_SIZE 30
-#define CAMERA_SNAPSHOT_STARTUP_SKIP_FRAMES 3
 #define CAMERA_SNAPSHOT_TASK_PRIORITY 4
 #define CAMERA_SNAPSHOT_TASK_STACK_BYTES 8192
+#define CAMERA_SNAPSHOT_PUBLISH_TASK_STACK_BYTES 4096
+#if CONFIG_THEO_CAMERA_HTTP_ENDPOINT
+// HTTP readers can pin one slot per MJPEG stream plus one for the snapshot
+// handler (it runs on the single httpd task), on top of the slot being
+// published and the one being encoded. Any fewer and slow viewers can leave
+// the encoder nothing to write into.
+#define CAMERA_SNAPSHOT_JPEG_SLOTS (2 + CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS + 1)
+#else
+#define CAMERA_SNAPSHOT_JPEG_SLOTS 2
+#endif
+#define CAMERA_SNAPSHOT_READER_DRAIN_TIMEOUT_US (15LL * 1000LL * 1000LL)
+// Presence is sampled at least this often, so a slow heartbeat or a powered
+// down camera still reacts to someone walking in within a fraction of a second.
+#define CAMERA_SNAPSHOT_POWER_POLL_MS 250
+#define CAMERA_SNAPSHOT_POWER_RETRY_US (10LL * 1000LL * 1000LL)
 #define CAMERA_SNAPSHOT_TOPIC_MAX_LEN 160
-#define CAMERA_SNAPSHOT_DISCOVERY_TOPIC_MAX_LEN 192
-#define CAMERA_SNAPSHOT_DISCOVERY_PAYLOAD_MAX_LEN 768
 #define CAMERA_SNAPSHOT_TOPIC_SUFFIX "/camera/snapshot"
+#define CAMERA_SNAPSHOT_THUMB_TOPIC_SUFFIX "/camera/thumbnail"
+#define CAMERA_SNAPSHOT_CHUNK_TOPIC_SUFFIX "/camera/snapshot/chunk"
+#define CAMERA_SNAPSHOT_CHUNK_MAGIC "TCH1"
+#define CAMERA_SNAPSHOT_CHUNK_HEADER_BYTES 16
 #define CAMERA_SNAPSHOT_AVAILABILITY_TOPIC_SUFFIX "/camera/availability"
+#define CAMERA_SNAPSHOT_BENCHMARK_TOPIC_SUFFIX "/diagnostics/camera_benchmark"
+#define CAMERA_SNAPSHOT_BENCHMARK_FRAME_TOPIC_SUFFIX "/diagnostics/camera_benchmark/frame"
+#define CAMERA_SNAPSHOT_BENCHMARK_FRAMES 10
+#define CAMERA_SNAPSHOT_BENCHMARK_JSON_BYTES 3072
 #define CAMERA_SNAPSHOT_OBJECT_ID "camera_snapshot"
 #define CAMERA_SNAPSHOT_NAME "Camera"
-#define CAMERA_SNAPSHOT_AE_TARGET 64
-#define CAMERA_SNAPSHOT_RED_BALANCE 800
-#define CAMERA_SNAPSHOT_BLUE_BALANCE 1600
 
 typedef struct {
-  void *start;
-  size_t length;
-} camera_mmap_buffer_t;
+  uint32_t publish_count;
+  uint32_t publish_failures;
+  uint64_t total_publish_time_us;
+  uint64_t max_publish_time_us;
+  uint64_t total_publish_bytes;
+  uint32_t frame_count;
+  uint32_t ppa_frames;
+  uint32_t dropped_frames;
+  uint64_t total_capture_time_us;
+  uint64_t max_capture_time_us;
+  uint64_t total_stage_time_us;
+  uint64_t max_stage_time_us;
+  uint64_t total_encode_time_us;
+  uint64_t max_encode_time_us;
+  uint64_t total_frame_age_us;
+  uint64_t max_frame_age_us;
+  uint32_t thumb_count;
+  uint64_t total_thumb_bytes;
+  uint64_t total_quality;
+  uint8_t quality;
+  uint8_t backoff_pct;
+  uint16_t frame_width;
+  uint16_t frame_height;
+  size_t target_bytes;
+  uint32_t gate_motion;
+  uint32_t gate_heartbeat;
+  uint32_t gate_suppressed;
+  uint16_t gate_last_permille;
+  uint32_t gate_viewer;
+  uint32_t chunk_count;
+  uint64_t max_chunk_time_us;
+  uint32_t wake_count;
+  uint32_t last_wake_ms;
+  uint32_t max_wake_ms;
+} snapshot_metrics_t;
+
+// Publish-side signals for the rate controller, accumulated between frames.
+typedef struct {
+  uint32_t publish_us;
+  bool publish_failed;
+  bool frame_dropped;
+} rate_feedback_t;
+
+typedef struct {
+  camera_source_buffer_t buf;
+  const uint8_t *data;
+  size_t stride;
+  uint32_t capture_us;
+  int64_t captured_at_us;
+} captured_frame_t;
+
+typedef struct {
+  size_t jpeg_size;
+  size_t thumb_size;
+  uint32_t capture_us;
+  uint32_t stage_us;
+  uint32_t encode_us;
+  uint16_t width;
+  uint16_t height;
+  uint8_t quality;
+  bool stage_ppa;
+} snapshot_frame_t;
+
+// One resolution/quality point of the pipeline benchmark.
+typedef struct {
+  uint8_t scale_16ths;
+  uint8_t quality;
+  uint16_t width;
+  uint16_t height;
+  uint32_t frames;
+  uint32_t failures;
+  uint64_t total_capture_us;
+  uint64_t total_stage_us;
+  uint64_t total_encode_us;
+  uint64_t total_publish_us;
+  uint32_t max_capture_us;
+  uint32_t max_stage_us;
+  uint32_t max_encode_us;
+  uint32_t max_publish_us;
+  uint64_t total_bytes;
+  size_t max_bytes;
+} benchmark_case_t;
+
+// Encoded frames move capture task -> publish task through a pair of slots.
+// The capture task owns a slot while ENCODING; the publish task while
+// PUBLISHING. A READY slot that is not picked up before the next frame is
+// encoded is stale and gets overwritten instead of queued.
+//
+// Independently of that state, the most recently committed slot stays
+// readable as the "latest" frame. External readers (the HTTP endpoint) take a
+// reference on it and send straight from the slot buffer; the encoder never
+// reuses a slot with readers, and avoids reusing the latest one while any
+// other slot is available. CAMERA_SNAPSHOT_JPEG_SLOTS covers the most slots
+// readers can pin, so they never stall the encoder. If it still finds no
+// slot, the frame counts as dropped.
+typedef enum {
+  JPEG_SLOT_FREE = 0,
+  JPEG_SLOT_ENCODING,
+  JPEG_SLOT_READY,
+  JPEG_SLOT_PUBLISHING,
+} jpeg_slot_state_t;
+
+typedef struct {
+  uint8_t *jpeg;
+  size_t jpeg_capacity;
+  uint8_t *thumb;
+  size_t thumb_capacity;
+  snapshot_frame_t frame;
+  int64_t captured_at_us;
+  jpeg_slot_state_t state;
+  uint32_t seq;
+  uint8_t readers;
+} jpeg_slot_t;
 
 static TaskHandle_t s_task_handle;
+static TaskHandle_t s_publish_task_handle;
 static bool s_started;
 static bool s_stop_requested;
-static esp_ldo_channel_handle_t s_ldo_mipi_phy;
-static bool s_video_initialized;
-static int s_camera_fd = -1;
-static bool s_camera_streaming;
+static const camera_frame_source_t *s_source;
+static bool s_source_open;
+static bool s_source_streaming;
 static uint32_t s_camera_pixfmt;
 static size_t s_camera_row_stride;
-static size_t s_frame_size_bytes;
 static size_t s_camera_buffer_count;
-static camera_mmap_buffer_t s_camera_buffers[CAMERA_SNAPSHOT_BUFFER_COUNT];
+static size_t s_camera_buffer_bytes;
+static bool s_sensor_flipped;
+static bool s_zero_copy;
 static jpeg_encoder_handle_t s_jpeg_encoder;
-static uint8_t *s_jpeg_buffer;
-static size_t s_jpeg_buffer_size;
+static jpeg_slot_t s_jpeg_slots[CAMERA_SNAPSHOT_JPEG_SLOTS];
+static jpeg_slot_t *s_latest_slot;
+static uint32_t s_frame_seq;
+static uint32_t s_live_viewers;
+static bool s_camera_powered;
+static camera_power_policy_t s_power_policy;
+static int64_t s_wake_started_us;
+static snapshot_metrics_t s_metrics;
+static rate_feedback_t s_rate_feedback;
+static snapshot_rate_controller_t s_rate_controller;
+#if CONFIG_THEO_CAMERA_MOTION_GATE
+static EXT_RAM_BSS_ATTR motion_detector_t s_motion_detector;
+static int64_t s_last_gate_pass_us;
+#endif
 static uint8_t *s_raw_buffer;
 static size_t s_raw_buffer_size;
+static uint8_t *s_thumb_raw_buffer;
+static size_t s_thumb_raw_buffer_size;
+static frame_transform_op_t s_thumb_op;
+static uint16_t s_thumb_width;
+static uint16_t s_thumb_height;
 static char s_snapshot_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static char s_thumbnail_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static char s_chunk_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static uint8_t *s_chunk_buffer;
+static uint32_t s_chunk_frame_id;
 static char s_availability_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static char s_benchmark_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static char s_benchmark_frame_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
+static bool s_benchmark_requested;
+static EXT_RAM_BSS_ATTR char s_benchmark_json[CAMERA_SNAPSHOT_BENCHMARK_JSON_BYTES];
 static bool s_camera_online;
-static bool s_discovery_published;
+static ha_discovery_handle_t s_discovery = HA_DISCOVERY_HANDLE_INVALID;
 static bool s_mqtt_event_registered;
 static bool s_ir_led_enabled;
 static portMUX_TYPE s_state_lock = portMUX_INITIALIZER_UNLOCKED;
+static portMUX_TYPE s_pipeline_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static void camera_snapshot_task(void *arg);
+static void camera_publish_task(void *arg);
+static esp_err_t start_publish_task(void);
+static void stop_publish_task(void);
+static jpeg_slot_t *acquire_encode_slot(void);
+static void commit_ready_slot(jpeg_slot_t *slot);
+static jpeg_slot_t *take_ready_slot(void);
+static void release_slot(jpeg_slot_t *slot);
+static void drain_slot_readers(void);
+static void publish_slot(jpeg_slot_t *slot);
+static int publish_chunked(esp_mqtt_client_handle_t client,
+                           const uint8_t *data,
+                           size_t len,
+                           uint32_t *out_chunks,
+                           uint64_t *out_max_chunk_us);
+static void put_le16(uint8_t *p, uint16_t v);
+static void put_le32(uint8_t *p, uint32_t v);
+static void record_encode_metrics(const snapshot_frame_t *frame);
+static void update_rate_controller(const snapshot_frame_t *frame);
+static bool transport_congested(void);
+static bool adaptive_downscale_available(void);
+static void reset_motion_gate(void);
+static esp_err_t power_up_camera(void);
+static void power_down_camera(void);
+static camera_power_state_t update_power_state(int64_t now_us);
+static bool presence_possible(void);
+static uint32_t capture_interval_ms(camera_power_state_t state);
+static void record_wake_latency(void);
+static bool motion_gate_allows(const captured_frame_t *cap);
+static bool take_benchmark_request(void);
+static void run_pipeline_benchmark(void);
+static esp_err_t run_benchmark_frame(esp_mqtt_client_handle_t client, benchmark_case_t *bench);
+static int append_benchmark_case(char *json, size_t size, const benchmark_case_t *bench);
 static esp_err_t build_mqtt_topics(void);
 static esp_err_t register_mqtt_event_handler(void);
 static void unregister_mqtt_event_handler(void);
@@ -92,48 +281,37 @@ static void camera_snapshot_mqtt_event_handler(void *handler_args,
                                                esp_event_base_t base,
                                                int32_t event_id,
                                                void *event_data);
-static void publish_discovery_config(bool force);
+static esp_err_t cache_discovery_config(void);
 static void publish_availability(bool online);
-static void republish_camera_entity(bool force_discovery);
-static esp_err_t acquire_mipi_phy_ldo(void);
-static void release_mipi_phy_ldo(void);
-static esp_err_t init_video_framework(void);
-static void deinit_video_framework(void);
-static esp_err_t open_camera_device(void);
-static void close_camera_device(void);
-static esp_err_t select_camera_format(void);
-static esp_err_t apply_camera_tuning_controls(void);
-static esp_err_t apply_isp_balance_controls(void);
-static esp_err_t set_video_control(int fd, uint32_t ctrl_class, uint32_t id, int32_t value, const char *name);
-static esp_err_t allocate_camera_buffers(void);
-static esp_err_t start_camera_stream(void);
-static void stop_camera_stream(void);
-static esp_err_t skip_startup_frames(void);
+static void republish_camera_entity(void);
+static esp_err_t open_frame_source(void);
+static void close_frame_source(void);
+static esp_err_t start_frame_source(void);
+static void stop_frame_source(void);
+static esp_err_t skip_frames(size_t count);
 static esp_err_t ensure_jpeg_encoder(void);
 static void release_jpeg_encoder(void);
-static esp_err_t ensure_jpeg_buffer(void);
-static void release_jpeg_buffer(void);
+static esp_err_t ensure_jpeg_slots(void);
+static void release_jpeg_slots(void);
 static esp_err_t ensure_raw_buffer(void);
 static void release_raw_buffer(void);
+static esp_err_t ensure_thumbnail_buffers(void);
+static void release_thumbnail_buffers(void);
+static uint8_t *alloc_frame_buffer(size_t size);
 static size_t packed_frame_bytes(uint32_t pixfmt);
+static frame_pixfmt_t frame_pixfmt_for_v4l2(uint32_t pixfmt);
 static jpeg_enc_input_format_t jpeg_src_type_for_pixfmt(uint32_t pixfmt);
 static jpeg_down_sampling_type_t jpeg_subsample_for_pixfmt(uint32_t pixfmt);
-static void copy_frame_to_jpeg_input(const uint8_t *frame,
-                                     size_t source_stride,
-                                     size_t bytes_per_pixel);
-static esp_err_t encode_snapshot_frame(size_t *jpeg_size);
+static esp_err_t stage_frame(const uint8_t *frame, size_t source_stride, uint8_t scale_16ths, snapshot_frame_t *out);
+static esp_err_t dequeue_camera_frame(captured_frame_t *cap);
+static esp_err_t encode_snapshot_frame(captured_frame_t *cap, jpeg_slot_t *slot, uint8_t scale_16ths, uint8_t quality);
+static esp_err_t requeue_camera_buffer(const camera_source_buffer_t *buf);
 static void release_resources(void);
 static bool stop_requested(void);
 static bool camera_online(void);
 static void set_camera_online(bool online);
-static bool discovery_published(void);
-static void set_discovery_published(bool published);
 static void set_started_state(bool started);
-static void log_publish_metrics(uint32_t publish_count,
-                                uint32_t publish_failures,
-                                uint64_t total_publish_time_us,
-                                uint64_t max_publish_time_us,
-                                uint64_t total_publish_bytes);
+static void log_publish_metrics(const snapshot_metrics_t *metrics);
 static const char *pixfmt_name(uint32_t pixfmt);
 
 esp_err_t camera_snapshot_publisher_start(void)
@@ -146,7 +324,6 @@ esp_err_t camera_snapshot_publisher_start(void)
   s_started = true;
   s_stop_requested = false;
   s_camera_online = false;
-  s_discovery_published = false;
   taskEXIT_CRITICAL(&s_state_lock);
 
   esp_err_t err = build_mqtt_topics();
@@ -155,13 +332,19 @@ esp_err_t camera_snapshot_publisher_start(void)
     return err;
   }
 
+  err = cache_discovery_config();
+  if (err != ESP_OK) {
+    set_started_state(false);
+    return err;
+  }
+
   err = register_mqtt_event_handler();
   if (err != ESP_OK) {
     set_started_state(false);
     return err;
   }
 
-  republish_camera_entity(true);
+  republish_camera_entity();
 
   BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(camera_snapshot_task,
                                                        "cam_snapshot",
@@ -194,7 +377,6 @@ esp_err_t camera_snapshot_publisher_stop(void)
     s_started = false;
     s_stop_requested = false;
     s_camera_online = false;
-    s_discovery_published = false;
     taskEXIT_CRITICAL(&s_state_lock);
     unregister_mqtt_event_handler();
     return ESP_OK;
@@ -231,37 +413,88 @@ size_t camera_snapshot_publisher_get_task_stack_size_bytes(void)
   return CAMERA_SNAPSHOT_TASK_STACK_BYTES;
 }
 
-static void camera_snapshot_task(void *arg)
+bool camera_snapshot_publisher_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out)
 {
-  (void)arg;
+  jpeg_slot_t *slot = NULL;
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  if (s_latest_slot != NULL && s_latest_slot->seq != after_seq && s_latest_slot->readers < UINT8_MAX) {
+    slot = s_latest_slot;
+    slot->readers++;
+  }
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  if (slot == NULL) {
+    return false;
+  }
+  out->jpeg = slot->jpeg;
+  out->jpeg_size = slot->frame.jpeg_size;
+  out->seq = slot->seq;
+  out->width = slot->frame.width;
+  out->height = slot->frame.height;
+  out->captured_at_us = slot->captured_at_us;
+  out->token = slot;
+  return true;
+}
 
-  esp_err_t err = acquire_mipi_phy_ldo();
-  if (err == ESP_OK) {
-    err = init_video_framework();
+void camera_snapshot_publisher_release(camera_snapshot_ref_t *ref)
+{
+  jpeg_slot_t *slot = ref->token;
+  if (slot == NULL) {
+    return;
   }
-  if (err == ESP_OK) {
-    err = open_camera_device();
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  if (slot->readers > 0) {
+    slot->readers--;
   }
-  if (err == ESP_OK) {
-    err = ensure_jpeg_encoder();
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+  memset(ref, 0, sizeof(*ref));
+}
+
+void camera_snapshot_publisher_viewer_attach(void)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_live_viewers++;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+}
+
+void camera_snapshot_publisher_viewer_detach(void)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  if (s_live_viewers > 0) {
+    s_live_viewers--;
   }
-  if (err == ESP_OK) {
-    err = ensure_jpeg_buffer();
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+}
+
+esp_err_t camera_snapshot_publisher_request_benchmark(void)
+{
+  taskENTER_CRITICAL(&s_state_lock);
+  TaskHandle_t task = s_task_handle;
+  if (task != NULL) {
+    s_benchmark_requested = true;
   }
-  if (err == ESP_OK) {
-    err = ensure_raw_buffer();
+  taskEXIT_CRITICAL(&s_state_lock);
+
+  if (task == NULL) {
+    return ESP_ERR_INVALID_STATE;
   }
+  xTaskNotifyGive(task);
+  return ESP_OK;
+}
+
+static void camera_snapshot_task(void *arg)
+{
+  (void)arg;
+
+  esp_err_t err = power_up_camera();
   if (err == ESP_OK) {
-    err = start_camera_stream();
-  }
-  if (err == ESP_OK && thermostat_ir_led_init() == ESP_OK) {
-    thermostat_ir_led_set(true);
-    s_ir_led_enabled = true;
+    err = start_publish_task();
   }
 
   if (err != ESP_OK) {
     set_camera_online(false);
-    republish_camera_entity(false);
+    republish_camera_entity();
     ESP_LOGW(TAG, "Snapshot publisher unavailable: %s", esp_err_to_name(err));
     release_resources();
     unregister_mqtt_event_handler();
@@ -274,76 +507,99 @@ static void camera_snapshot_task(void *arg)
     return;
   }
 
-  const TickType_t interval_ticks = pdMS_TO_TICKS(CONFIG_THEO_CAMERA_SNAPSHOT_INTERVAL_MS);
-  uint32_t publish_count = 0;
-  uint32_t publish_failures = 0;
-  uint64_t total_publish_time_us = 0;
-  uint64_t max_publish_time_us = 0;
-  uint64_t total_publish_bytes = 0;
+  snapshot_rate_controller_init(&s_rate_controller,
+                                CONFIG_THEO_CAMERA_JPEG_BUDGET_BPS,
+                                CONFIG_THEO_CAMERA_SNAPSHOT_INTERVAL_MS,
+                                adaptive_downscale_available());
+  if (s_rate_controller.enabled) {
+    ESP_LOGI(TAG,
+             "Adaptive JPEG enabled (budget_bps=%u target_bytes=%zu downscale=%d)",
+             (unsigned)CONFIG_THEO_CAMERA_JPEG_BUDGET_BPS,
+             snapshot_rate_controller_target_bytes(&s_rate_controller),
+             s_rate_controller.allow_downscale ? 1 : 0);
+  }
+  reset_motion_gate();
+
+#if CONFIG_THEO_CAMERA_PRESENCE_POWER
+  const camera_power_policy_config_t power_config = {
+    .idle_after_ms = CONFIG_THEO_CAMERA_VACANT_IDLE_AFTER_S * 1000U,
+    .off_after_ms = CONFIG_THEO_CAMERA_VACANT_OFF_AFTER_S * 1000U,
+  };
+  ESP_LOGI(TAG,
+           "Presence power policy enabled (idle_after_s=%d off_after_s=%d idle_interval_ms=%d)",
+           CONFIG_THEO_CAMERA_VACANT_IDLE_AFTER_S,
+           CONFIG_THEO_CAMERA_VACANT_OFF_AFTER_S,
+           CONFIG_THEO_CAMERA_VACANT_INTERVAL_MS);
+#else
+  // Without presence control the policy never sees vacancy and stays ACTIVE.
+  const camera_power_policy_config_t power_config = {
+    .idle_after_ms = UINT32_MAX,
+    .off_after_ms = UINT32_MAX,
+  };
+#endif
+  camera_power_policy_init(&s_power_policy, &power_config, esp_timer_get_time());
 
   set_camera_online(true);
-  republish_camera_entity(false);
+  republish_camera_entity();
 
+  int64_t next_capture_us = esp_timer_get_time() + (int64_t)CONFIG_THEO_CAMERA_SNAPSHOT_INTERVAL_MS * 1000LL;
   while (!stop_requested()) {
-    if (ulTaskNotifyTake(pdTRUE, interval_ticks) > 0 && stop_requested()) {
-      break;
-    }
-    if (stop_requested()) {
-      break;
+    const int64_t now_us = esp_timer_get_time();
+    const camera_power_state_t power_state = update_power_state(now_us);
+    if (take_benchmark_request()) {
+      run_pipeline_benchmark();
+      continue;
     }
-
-    size_t jpeg_size = 0;
-    err = encode_snapshot_frame(&jpeg_size);
-    if (err != ESP_OK) {
-      ESP_LOGW(TAG, "JPEG encode failed: %s", esp_err_to_name(err));
+    if (!s_camera_powered || now_us < next_capture_us) {
+      int64_t wait_us = (int64_t)CAMERA_SNAPSHOT_POWER_POLL_MS * 1000LL;
+      if (s_camera_powered && next_capture_us - now_us < wait_us) {
+        wait_us = next_capture_us - now_us;
+      }
+      TickType_t wait_ticks = pdMS_TO_TICKS((uint32_t)(wait_us / 1000LL));
+      (void)ulTaskNotifyTake(pdTRUE, wait_ticks > 0 ? wait_ticks : 1);
       continue;
     }
+    next_capture_us = now_us + (int64_t)capture_interval_ms(power_state) * 1000LL;
 
-    if (!mqtt_manager_is_ready()) {
-      continue;
+    if (power_state == CAMERA_POWER_IDLE) {
+      // At the heartbeat rate the queued buffers are tens of seconds old.
+      (void)skip_frames(s_camera_buffer_count);
     }
 
-    esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-    if (client == NULL) {
+    captured_frame_t cap;
+    err = dequeue_camera_frame(&cap);
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Frame capture failed: %s", esp_err_to_name(err));
       continue;
     }
-
-    publish_discovery_config(false);
-
-    const int64_t publish_start_us = esp_timer_get_time();
-    int msg_id = esp_mqtt_client_publish(client,
-                                         s_snapshot_topic,
-                                         (const char *)s_jpeg_buffer,
-                                         (int)jpeg_size,
-                                         0,
-                                         1);
-    uint64_t publish_time_us = (uint64_t)(esp_timer_get_time() - publish_start_us);
-    publish_count++;
-    total_publish_time_us += publish_time_us;
-    total_publish_bytes += jpeg_size;
-    if (publish_time_us > max_publish_time_us) {
-      max_publish_time_us = publish_time_us;
+    // Gate before claiming a slot, so a suppressed frame never evicts a
+    // pending one.
+    if (!motion_gate_allows(&cap)) {
+      (void)requeue_camera_buffer(&cap.buf);
+      continue;
     }
-
-    if (msg_id < 0) {
-      publish_failures++;
-      ESP_LOGW(TAG, "Snapshot publish failed (bytes=%zu)", jpeg_size);
+    jpeg_slot_t *slot = acquire_encode_slot();
+    if (slot == NULL) {
+      (void)requeue_camera_buffer(&cap.buf);
+      continue;
     }
-
-    if (publish_count >= CAMERA_SNAPSHOT_METRICS_BATCH_SIZE) {
-      log_publish_metrics(publish_count,
-                          publish_failures,
-                          total_publish_time_us,
-                          max_publish_time_us,
-                          total_publish_bytes);
-      publish_count = 0;
-      publish_failures = 0;
-      total_publish_time_us = 0;
-      max_publish_time_us = 0;
-      total_publish_bytes = 0;
+    err = encode_snapshot_frame(&cap,
+                                slot,
+                                snapshot_rate_controller_scale_16ths(&s_rate_controller),
+                                s_rate_controller.quality);
+    if (err != ESP_OK) {
+      release_slot(slot);
+      ESP_LOGW(TAG, "JPEG encode failed: %s", esp_err_to_name(err));
+      continue;
     }
+    update_rate_controller(&slot->frame);
+    record_encode_metrics(&slot->frame);
+    commit_ready_slot(slot);
+    record_wake_latency();
   }
 
+  stop_publish_task();
+  drain_slot_readers();
   set_camera_online(false);
   release_resources();
   unregister_mqtt_event_handler();
@@ -352,12 +608,828 @@ static void camera_snapshot_task(void *arg)
   s_task_handle = NULL;
   s_started = false;
   s_stop_requested = false;
-  s_discovery_published = false;
   taskEXIT_CRITICAL(&s_state_lock);
 
   vTaskDelete(NULL);
 }
 
+// Brings up everything the capture path needs. Buffer allocations are
+// idempotent and survive power_down_camera(), so a warm restart only pays for
+// the hardware.
+static esp_err_t power_up_camera(void)
+{
+  esp_err_t err = open_frame_source();
+  if (err == ESP_OK) {
+    err = ensure_jpeg_encoder();
+  }
+  if (err == ESP_OK) {
+    err = ensure_jpeg_slots();
+  }
+  if (err == ESP_OK) {
+    err = ensure_raw_buffer();
+  }
+  if (err == ESP_OK) {
+    err = ensure_thumbnail_buffers();
+  }
+  if (err == ESP_OK) {
+    err = frame_transform_init();
+  }
+  if (err == ESP_OK) {
+    err = start_frame_source();
+  }
+  if (err == ESP_OK && thermostat_ir_led_init() == ESP_OK) {
+    thermostat_ir_led_set(true);
+    s_ir_led_enabled = true;
+  }
+  s_camera_powered = err == ESP_OK;
+  return err;
+}
+
+// Releases the frame source (sensor and PHY LDO), JPEG engine, PPA client and IR LED. JPEG slots
+// stay allocated so the last frame remains available to HTTP readers.
+static void power_down_camera(void)
+{
+  if (s_ir_led_enabled) {
+    thermostat_ir_led_set(false);
+    s_ir_led_enabled = false;
+  }
+  stop_frame_source();
+  frame_transform_deinit();
+  release_jpeg_encoder();
+  close_frame_source();
+  s_camera_powered = false;
+}
+
+static camera_power_state_t update_power_state(int64_t now_us)
+{
+  const camera_power_state_t previous = s_power_policy.state;
+  if (camera_power_policy_update(&s_power_policy, presence_possible(), now_us)) {
+    ESP_LOGI(TAG,
+             "camera_power_state from=%s to=%s vacant_ms=%lld",
+             camera_power_state_to_str(previous),
+             camera_power_state_to_str(s_power_policy.state),
+             (long long)((now_us - s_power_policy.last_presence_us) / 1000LL));
+  }
+
+  const camera_power_state_t state = s_power_policy.state;
+  if (state == CAMERA_POWER_OFF) {
+    if (s_camera_powered) {
+      power_down_camera();
+    }
+    s_wake_started_us = 0;
+  } else if (!s_camera_powered) {
+    if (s_wake_started_us == 0 || now_us - s_wake_started_us >= CAMERA_SNAPSHOT_POWER_RETRY_US) {
+      s_wake_started_us = now_us;
+      esp_err_t err = power_up_camera();
+      if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Camera warm restart failed: %s", esp_err_to_name(err));
+        power_down_camera();
+      } else {
+        ESP_LOGI(TAG,
+                 "camera_power_up powerup_ms=%lld",
+                 (long long)((esp_timer_get_time() - s_wake_started_us) / 1000LL));
+        // The reference grid predates the power-down; start over.
+        reset_motion_gate();
+      }
+    }
+  }
+  return state;
+}
+
+static bool presence_possible(void)
+{
+#if CONFIG_THEO_CAMERA_PRESENCE_POWER
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  const bool viewer = s_live_viewers > 0;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+  if (viewer) {
+    return true;
+  }
+  radar_presence_state_t radar;
+  if (!radar_presence_get_state(&radar)) {
+    // Unknown is treated as occupied; never power down on a sensor fault.
+    return true;
+  }
+  return radar.presence_detected;
+#else
+  return true;
+#endif
+}
+
+static uint32_t capture_interval_ms(camera_power_state_t state)
+{
+#if CONFIG_THEO_CAMERA_PRESENCE_POWER
+  if (state == CAMERA_POWER_IDLE) {
+    return CONFIG_THEO_CAMERA_VACANT_INTERVAL_MS;
+  }
+#else
+  (void)state;
+#endif
+  return CONFIG_THEO_CAMERA_SNAPSHOT_INTERVAL_MS;
+}
+
+// Warm-restart latency: presence (or a viewer) seen while powered down, to the
+// first encoded frame being available to publishers.
+static void record_wake_latency(void)
+{
+  if (s_wake_started_us == 0) {
+    return;
+  }
+  const uint32_t wake_ms = (uint32_t)((esp_timer_get_time() - s_wake_started_us) / 1000LL);
+  s_wake_started_us = 0;
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_metrics.wake_count++;
+  s_metrics.last_wake_ms = wake_ms;
+  if (wake_ms > s_metrics.max_wake_ms) {
+    s_metrics.max_wake_ms = wake_ms;
+  }
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  ESP_LOGI(TAG, "camera_power_wake first_frame_ms=%u", wake_ms);
+}
+
+static void camera_publish_task(void *arg)
+{
+  (void)arg;
+
+  while (!stop_requested()) {
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    jpeg_slot_t *slot = take_ready_slot();
+    if (slot == NULL) {
+      continue;
+    }
+    publish_slot(slot);
+    release_slot(slot);
+  }
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_publish_task_handle = NULL;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  vTaskDelete(NULL);
+}
+
+static esp_err_t start_publish_task(void)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  memset(&s_metrics, 0, sizeof(s_metrics));
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  if (CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES > 0 && s_chunk_buffer == NULL) {
+    s_chunk_buffer = heap_caps_malloc(CAMERA_SNAPSHOT_CHUNK_HEADER_BYTES + CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES,
+                                      MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_chunk_buffer == NULL) {
+      return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG,
+             "Chunked snapshot publish enabled (topic=%s chunk_bytes=%d)",
+             s_chunk_topic,
+             CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES);
+  }
+
+  TaskHandle_t task = NULL;
+  BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(camera_publish_task,
+                                                       "cam_publish",
+                                                       CAMERA_SNAPSHOT_PUBLISH_TASK_STACK_BYTES,
+                                                       NULL,
+                                                       CAMERA_SNAPSHOT_TASK_PRIORITY,
+                                                       &task,
+                                                       tskNO_AFFINITY,
+                                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (task_ok != pdPASS) {
+    heap_caps_free(s_chunk_buffer);
+    s_chunk_buffer = NULL;
+    ESP_LOGE(TAG, "Failed to create snapshot publish task");
+    return ESP_ERR_NO_MEM;
+  }
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_publish_task_handle = task;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+  return ESP_OK;
+}
+
+static void stop_publish_task(void)
+{
+  // The publish task may be inside esp_mqtt_client_publish on a slot, so the
+  // slots are only released once it has exited.
+  while (true) {
+    taskENTER_CRITICAL(&s_pipeline_lock);
+    TaskHandle_t task = s_publish_task_handle;
+    taskEXIT_CRITICAL(&s_pipeline_lock);
+    if (task == NULL) {
+      break;
+    }
+    xTaskNotifyGive(task);
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+
+  heap_caps_free(s_chunk_buffer);
+  s_chunk_buffer = NULL;
+}
+
+static jpeg_slot_t *acquire_encode_slot(void)
+{
+  jpeg_slot_t *slot = NULL;
+  bool dropped = false;
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS && slot == NULL; ++i) {
+    if (s_jpeg_slots[i].state == JPEG_SLOT_FREE && s_jpeg_slots[i].readers == 0 &&
+        &s_jpeg_slots[i] != s_latest_slot) {
+      slot = &s_jpeg_slots[i];
+    }
+  }
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS && slot == NULL; ++i) {
+    if (s_jpeg_slots[i].state == JPEG_SLOT_FREE && s_jpeg_slots[i].readers == 0) {
+      slot = &s_jpeg_slots[i];
+    }
+  }
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS && slot == NULL; ++i) {
+    if (s_jpeg_slots[i].state == JPEG_SLOT_READY && s_jpeg_slots[i].readers == 0) {
+      // The publisher is still busy with the other slot; this frame would be
+      // stale by the time it got there.
+      slot = &s_jpeg_slots[i];
+      dropped = true;
+    }
+  }
+  if (slot != NULL) {
+    if (slot == s_latest_slot) {
+      s_latest_slot = NULL;
+    }
+    slot->state = JPEG_SLOT_ENCODING;
+  } else {
+    // Every slot is pinned by readers or being published; the captured frame
+    // is requeued unencoded.
+    dropped = true;
+  }
+  if (dropped) {
+    s_metrics.dropped_frames++;
+    s_rate_feedback.frame_dropped = true;
+  }
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  return slot;
+}
+
+static void commit_ready_slot(jpeg_slot_t *slot)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    if (&s_jpeg_slots[i] != slot && s_jpeg_slots[i].state == JPEG_SLOT_READY) {
+      s_jpeg_slots[i].state = JPEG_SLOT_FREE;
+      s_metrics.dropped_frames++;
+      s_rate_feedback.frame_dropped = true;
+    }
+  }
+  slot->state = JPEG_SLOT_READY;
+  slot->seq = ++s_frame_seq;
+  if (slot->seq == 0) {
+    // 0 is the "any frame" sentinel for readers.
+    slot->seq = ++s_frame_seq;
+  }
+  s_latest_slot = slot;
+  TaskHandle_t task = s_publish_task_handle;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  if (task != NULL) {
+    xTaskNotifyGive(task);
+  }
+}
+
+static jpeg_slot_t *take_ready_slot(void)
+{
+  jpeg_slot_t *slot = NULL;
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    if (s_jpeg_slots[i].state == JPEG_SLOT_READY) {
+      slot = &s_jpeg_slots[i];
+      slot->state = JPEG_SLOT_PUBLISHING;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  return slot;
+}
+
+static void release_slot(jpeg_slot_t *slot)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  slot->state = JPEG_SLOT_FREE;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+}
+
+static void drain_slot_readers(void)
+{
+  // Readers may be part-way through sending a frame to a slow HTTP client;
+  // the slot buffers are only freed once every reference is back.
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_latest_slot = NULL;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  const int64_t deadline_us = esp_timer_get_time() + CAMERA_SNAPSHOT_READER_DRAIN_TIMEOUT_US;
+  while (true) {
+    uint32_t readers = 0;
+    taskENTER_CRITICAL(&s_pipeline_lock);
+    for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+      readers += s_jpeg_slots[i].readers;
+    }
+    taskEXIT_CRITICAL(&s_pipeline_lock);
+    if (readers == 0) {
+      return;
+    }
+    if (esp_timer_get_time() >= deadline_us) {
+      // Freeing under a reader would be a use-after-free; leak instead.
+      ESP_LOGE(TAG, "Snapshot readers did not drain (readers=%u); keeping JPEG slots", readers);
+      for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+        if (s_jpeg_slots[i].readers > 0) {
+          s_jpeg_slots[i].jpeg = NULL;
+          s_jpeg_slots[i].thumb = NULL;
+        }
+      }
+      return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+
+static void publish_slot(jpeg_slot_t *slot)
+{
+  if (!mqtt_manager_is_ready()) {
+    return;
+  }
+
+  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+  if (client == NULL) {
+    return;
+  }
+
+  const size_t jpeg_size = slot->frame.jpeg_size;
+  const int64_t publish_start_us = esp_timer_get_time();
+  const uint64_t frame_age_us = (uint64_t)(publish_start_us - slot->captured_at_us);
+  uint32_t chunks = 0;
+  uint64_t max_chunk_us = 0;
+  int msg_id;
+  if (s_chunk_buffer != NULL) {
+    msg_id = publish_chunked(client, slot->jpeg, jpeg_size, &chunks, &max_chunk_us);
+  } else {
+    msg_id = esp_mqtt_client_publish(client,
+                                     s_snapshot_topic,
+                                     (const char *)slot->jpeg,
+                                     (int)jpeg_size,
+                                     0,
+                                     1);
+    chunks = 1;
+  }
+  uint64_t publish_time_us = (uint64_t)(esp_timer_get_time() - publish_start_us);
+  if (s_chunk_buffer == NULL) {
+    max_chunk_us = publish_time_us;
+  }
+  if (msg_id < 0) {
+    ESP_LOGW(TAG, "Snapshot publish failed (bytes=%zu)", jpeg_size);
+  }
+
+  bool thumb_published = false;
+  if (slot->frame.thumb_size > 0) {
+    int thumb_msg_id = esp_mqtt_client_publish(client,
+                                               s_thumbnail_topic,
+                                               (const char *)slot->thumb,
+                                               (int)slot->frame.thumb_size,
+                                               0,
+                                               1);
+    if (thumb_msg_id < 0) {
+      ESP_LOGW(TAG, "Thumbnail publish failed (bytes=%zu)", slot->frame.thumb_size);
+    } else {
+      thumb_published = true;
+    }
+  }
+
+  snapshot_metrics_t batch = {0};
+  bool batch_ready = false;
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  if (publish_time_us > s_rate_feedback.publish_us) {
+    s_rate_feedback.publish_us = (uint32_t)publish_time_us;
+  }
+  s_rate_feedback.publish_failed |= (msg_id < 0);
+  s_metrics.publish_count++;
+  s_metrics.total_publish_time_us += publish_time_us;
+  s_metrics.total_publish_bytes += jpeg_size;
+  if (publish_time_us > s_metrics.max_publish_time_us) {
+    s_metrics.max_publish_time_us = publish_time_us;
+  }
+  s_metrics.total_frame_age_us += frame_age_us;
+  if (frame_age_us > s_metrics.max_frame_age_us) {
+    s_metrics.max_frame_age_us = frame_age_us;
+  }
+  if (msg_id < 0) {
+    s_metrics.publish_failures++;
+  }
+  s_metrics.chunk_count += chunks;
+  if (max_chunk_us > s_metrics.max_chunk_time_us) {
+    s_metrics.max_chunk_time_us = max_chunk_us;
+  }
+  if (thumb_published) {
+    s_metrics.thumb_count++;
+    s_metrics.total_thumb_bytes += slot->frame.thumb_size;
+  }
+  if (s_metrics.publish_count >= CAMERA_SNAPSHOT_METRICS_BATCH_SIZE) {
+    batch = s_metrics;
+    batch_ready = true;
+    memset(&s_metrics, 0, sizeof(s_metrics));
+  }
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  if (batch_ready) {
+    log_publish_metrics(&batch);
+  }
+}
+
+// Sends data as a run of bounded messages on the chunk topic, each prefixed
+// with a 16-byte little-endian header: "TCH1", frame id (u32), chunk index
+// (u16), chunk count (u16), total JPEG length (u32). The MQTT client holds its
+// API lock for a whole publish, so bounding each message bounds how long any
+// other publisher (setpoint commands included) can wait behind the camera.
+static int publish_chunked(esp_mqtt_client_handle_t client,
+                           const uint8_t *data,
+                           size_t len,
+                           uint32_t *out_chunks,
+                           uint64_t *out_max_chunk_us)
+{
+  const size_t chunk_bytes = CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES;
+  const size_t count = (len + chunk_bytes - 1U) / chunk_bytes;
+  if (count == 0 || count > UINT16_MAX) {
+    return -1;
+  }
+
+  const uint32_t frame_id = ++s_chunk_frame_id;
+  memcpy(s_chunk_buffer, CAMERA_SNAPSHOT_CHUNK_MAGIC, 4);
+  put_le32(s_chunk_buffer + 4, frame_id);
+  put_le16(s_chunk_buffer + 10, (uint16_t)count);
+  put_le32(s_chunk_buffer + 12, (uint32_t)len);
+
+  int msg_id = -1;
+  for (size_t seq = 0; seq < count; ++seq) {
+    if (seq > 0) {
+      // Let any publisher queued on the client lock go between chunks.
+      vTaskDelay(1);
+      if (!mqtt_manager_is_ready()) {
+        return -1;
+      }
+    }
+    const size_t offset = seq * chunk_bytes;
+    const size_t part = (len - offset) < chunk_bytes ? (len - offset) : chunk_bytes;
+    put_le16(s_chunk_buffer + 8, (uint16_t)seq);
+    memcpy(s_chunk_buffer + CAMERA_SNAPSHOT_CHUNK_HEADER_BYTES, data + offset, part);
+
+    const int64_t chunk_start_us = esp_timer_get_time();
+    msg_id = esp_mqtt_client_publish(client,
+                                     s_chunk_topic,
+                                     (const char *)s_chunk_buffer,
+                                     (int)(CAMERA_SNAPSHOT_CHUNK_HEADER_BYTES + part),
+                                     0,
+                                     0);
+    const uint64_t chunk_us = (uint64_t)(esp_timer_get_time() - chunk_start_us);
+    if (chunk_us > *out_max_chunk_us) {
+      *out_max_chunk_us = chunk_us;
+    }
+    if (msg_id < 0) {
+      return msg_id;
+    }
+    (*out_chunks)++;
+  }
+  return msg_id;
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void record_encode_metrics(const snapshot_frame_t *frame)
+{
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  s_metrics.frame_count++;
+  s_metrics.ppa_frames += frame->stage_ppa ? 1U : 0U;
+  s_metrics.total_capture_time_us += frame->capture_us;
+  if (frame->capture_us > s_metrics.max_capture_time_us) {
+    s_metrics.max_capture_time_us = frame->capture_us;
+  }
+  s_metrics.total_stage_time_us += frame->stage_us;
+  if (frame->stage_us > s_metrics.max_stage_time_us) {
+    s_metrics.max_stage_time_us = frame->stage_us;
+  }
+  s_metrics.total_encode_time_us += frame->encode_us;
+  if (frame->encode_us > s_metrics.max_encode_time_us) {
+    s_metrics.max_encode_time_us = frame->encode_us;
+  }
+  s_metrics.total_quality += frame->quality;
+  s_metrics.quality = frame->quality;
+  s_metrics.frame_width = frame->width;
+  s_metrics.frame_height = frame->height;
+  s_metrics.backoff_pct = s_rate_controller.backoff_pct;
+  s_metrics.target_bytes = snapshot_rate_controller_target_bytes(&s_rate_controller);
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+}
+
+static void update_rate_controller(const snapshot_frame_t *frame)
+{
+  if (!s_rate_controller.enabled) {
+    return;
+  }
+
+  snapshot_rate_input_t in = {
+    .frame_bytes = frame->jpeg_size,
+    .transport_congested = transport_congested(),
+    .now_us = esp_timer_get_time(),
+  };
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  in.publish_us = s_rate_feedback.publish_us;
+  in.publish_failed = s_rate_feedback.publish_failed;
+  in.frame_dropped = s_rate_feedback.frame_dropped;
+  memset(&s_rate_feedback, 0, sizeof(s_rate_feedback));
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+
+  const snapshot_rate_tier_t previous_tier = s_rate_controller.tier;
+  snapshot_rate_controller_update(&s_rate_controller, &in);
+  if (s_rate_controller.tier != previous_tier) {
+    ESP_LOGI(TAG,
+             "snapshot_rate_tier tier=%s quality=%u target_bytes=%zu backoff_pct=%u last_bytes=%zu",
+             s_rate_controller.tier == SNAPSHOT_RATE_TIER_HALF ? "half" : "full",
+             s_rate_controller.quality,
+             snapshot_rate_controller_target_bytes(&s_rate_controller),
+             s_rate_controller.backoff_pct,
+             frame->jpeg_size);
+  }
+}
+
+static bool transport_congested(void)
+{
+#if CONFIG_THEO_TRANSPORT_MONITOR
+  transport_stats_t stats;
+  if (transport_monitor_get_latest(&stats)) {
+    return stats.drop_pps > 0 || stats.flowctl_on > 0 || stats.throttling;
+  }
+#endif
+  return false;
+}
+
+static void reset_motion_gate(void)
+{
+#if CONFIG_THEO_CAMERA_MOTION_GATE
+  const motion_detector_config_t config = {
+    .cell_threshold = CONFIG_THEO_CAMERA_MOTION_CELL_THRESHOLD,
+    .area_permille = CONFIG_THEO_CAMERA_MOTION_AREA_PERMILLE,
+  };
+  motion_detector_init(&s_motion_detector, &config);
+  s_last_gate_pass_us = 0;
+#endif
+}
+
+static bool motion_gate_allows(const captured_frame_t *cap)
+{
+#if CONFIG_THEO_CAMERA_MOTION_GATE
+  const frame_src_t src = {
+    .data = cap->data,
+    .stride = cap->stride,
+    .width = CAMERA_SNAPSHOT_WIDTH,
+    .height = CAMERA_SNAPSHOT_HEIGHT,
+    .format = frame_pixfmt_for_v4l2(s_camera_pixfmt),
+  };
+  uint16_t changed_permille = 0;
+  const bool motion = motion_detector_update(&s_motion_detector, &src, &changed_permille);
+  const int64_t heartbeat_us = (int64_t)CONFIG_THEO_CAMERA_MOTION_HEARTBEAT_MS * 1000LL;
+  const bool heartbeat = (cap->captured_at_us - s_last_gate_pass_us) >= heartbeat_us;
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  const bool viewer = s_live_viewers > 0;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+  // A live stream viewer expects every interval, not just scene changes.
+  const bool pass = motion || heartbeat || viewer;
+  if (pass) {
+    // Compare later frames against the one actually published, so a slow
+    // change still triggers once it adds up.
+    motion_detector_accept(&s_motion_detector);
+    s_last_gate_pass_us = cap->captured_at_us;
+  }
+
+  taskENTER_CRITICAL(&s_pipeline_lock);
+  if (motion) {
+    s_metrics.gate_motion++;
+  } else if (heartbeat) {
+    s_metrics.gate_heartbeat++;
+  } else if (viewer) {
+    s_metrics.gate_viewer++;
+  } else {
+    s_metrics.gate_suppressed++;
+  }
+  s_metrics.gate_last_permille = changed_permille;
+  taskEXIT_CRITICAL(&s_pipeline_lock);
+  return pass;
+#else
+  (void)cap;
+  return true;
+#endif
+}
+
+static bool take_benchmark_request(void)
+{
+  taskENTER_CRITICAL(&s_state_lock);
+  const bool requested = s_benchmark_requested;
+  s_benchmark_requested = false;
+  taskEXIT_CRITICAL(&s_state_lock);
+  return requested;
+}
+
+// Runs the capture -> stage -> encode -> publish path synchronously over a
+// small grid of resolutions and qualities, bypassing the motion gate, rate
+// controller and metrics, and publishes one JSON report. Frames go to a
+// diagnostics topic so snapshot consumers never see them. Useful with the
+// synthetic source to compare builds without a sensor or scene variation.
+static void run_pipeline_benchmark(void)
+{
+  static const uint8_t qualities[] = {50, 70, 90};
+  static const uint8_t scales[] = {FRAME_TRANSFORM_SCALE_ONE, FRAME_TRANSFORM_SCALE_ONE / 2};
+
+  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
+  if (!s_camera_powered || client == NULL || !mqtt_manager_is_ready()) {
+    ESP_LOGW(TAG,
+             "camera_benchmark skipped reason=%s",
+             s_camera_powered ? "mqtt_unavailable" : "camera_off");
+    return;
+  }
+
+  size_t jpeg_bytes = 0;
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    jpeg_bytes += s_jpeg_slots[i].jpeg_capacity + s_jpeg_slots[i].thumb_capacity;
+  }
+  const size_t chunk_bytes = s_chunk_buffer != NULL ? (size_t)CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES : 0U;
+  const size_t buffer_total =
+      s_camera_buffer_bytes + s_raw_buffer_size + s_thumb_raw_buffer_size + jpeg_bytes + chunk_bytes;
+  size_t psram_free_min = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  size_t internal_free_min = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+  char *json = s_benchmark_json;
+  const size_t size = sizeof(s_benchmark_json);
+  int len = snprintf(json,
+                     size,
+                     "{\"source\":\"%s\",\"width\":%d,\"height\":%d,\"pixfmt\":\"%s\",\"zero_copy\":%s,"
+                     "\"frames_per_case\":%d,\"buffers\":{\"capture\":%zu,\"staging\":%zu,\"thumb_staging\":%zu,"
+                     "\"jpeg\":%zu,\"chunk\":%zu,\"total\":%zu},\"cases\":[",
+                     s_source->name,
+                     CAMERA_SNAPSHOT_WIDTH,
+                     CAMERA_SNAPSHOT_HEIGHT,
+                     pixfmt_name(s_camera_pixfmt),
+                     s_zero_copy ? "true" : "false",
+                     CAMERA_SNAPSHOT_BENCHMARK_FRAMES,
+                     s_camera_buffer_bytes,
+                     s_raw_buffer_size,
+                     s_thumb_raw_buffer_size,
+                     jpeg_bytes,
+                     chunk_bytes,
+                     buffer_total);
+
+  const int64_t started_us = esp_timer_get_time();
+  bool first_case = true;
+  for (size_t si = 0; si < sizeof(scales) / sizeof(scales[0]); ++si) {
+    // Downscaled frames are staged; without a staging buffer (zero-copy and
+    // no adaptive downscale) only full size can be measured.
+    if (scales[si] != FRAME_TRANSFORM_SCALE_ONE && s_raw_buffer == NULL) {
+      continue;
+    }
+    for (size_t qi = 0; qi < sizeof(qualities) / sizeof(qualities[0]); ++qi) {
+      benchmark_case_t bench = {
+        .scale_16ths = scales[si],
+        .quality = qualities[qi],
+      };
+      for (int frame = 0; frame < CAMERA_SNAPSHOT_BENCHMARK_FRAMES && !stop_requested(); ++frame) {
+        if (run_benchmark_frame(client, &bench) != ESP_OK) {
+          bench.failures++;
+        }
+        const size_t psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+        const size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        psram_free_min = psram_free < psram_free_min ? psram_free : psram_free_min;
+        internal_free_min = internal_free < internal_free_min ? internal_free : internal_free_min;
+      }
+      if (len > 0 && len < (int)size) {
+        if (!first_case) {
+          len += snprintf(json + len, size - (size_t)len, ",");
+        }
+        if (len < (int)size) {
+          len += append_benchmark_case(json + len, size - (size_t)len, &bench);
+        }
+      }
+      first_case = false;
+    }
+  }
+  if (len > 0 && len < (int)size) {
+    len += snprintf(json + len,
+                    size - (size_t)len,
+                    "],\"heap\":{\"psram_free_min\":%zu,\"internal_free_min\":%zu},\"duration_ms\":%lld}",
+                    psram_free_min,
+                    internal_free_min,
+                    (long long)((esp_timer_get_time() - started_us) / 1000LL));
+  }
+  if (len <= 0 || len >= (int)size) {
+    ESP_LOGW(TAG, "camera_benchmark report overflow (len=%d)", len);
+    return;
+  }
+
+  ESP_LOGI(TAG, "camera_benchmark %s", json);
+  if (esp_mqtt_client_publish(client, s_benchmark_topic, json, len, 1, 0) < 0) {
+    ESP_LOGW(TAG, "camera_benchmark report publish failed");
+  }
+}
+
+static esp_err_t run_benchmark_frame(esp_mqtt_client_handle_t client, benchmark_case_t *bench)
+{
+  captured_frame_t cap;
+  ESP_RETURN_ON_ERROR(dequeue_camera_frame(&cap), TAG, "benchmark capture failed");
+  jpeg_slot_t *slot = acquire_encode_slot();
+  if (slot == NULL) {
+    (void)requeue_camera_buffer(&cap.buf);
+    return ESP_ERR_NO_MEM;
+  }
+  esp_err_t err = encode_snapshot_frame(&cap, slot, bench->scale_16ths, bench->quality);
+  if (err != ESP_OK) {
+    release_slot(slot);
+    return err;
+  }
+
+  const snapshot_frame_t *frame = &slot->frame;
+  const int64_t publish_start_us = esp_timer_get_time();
+  const int msg_id = esp_mqtt_client_publish(client,
+                                             s_benchmark_frame_topic,
+                                             (const char *)slot->jpeg,
+                                             (int)frame->jpeg_size,
+                                             0,
+                                             0);
+  const uint32_t publish_us = (uint32_t)(esp_timer_get_time() - publish_start_us);
+
+  bench->width = frame->width;
+  bench->height = frame->height;
+  bench->frames++;
+  bench->total_capture_us += frame->capture_us;
+  bench->total_stage_us += frame->stage_us;
+  bench->total_encode_us += frame->encode_us;
+  bench->total_publish_us += publish_us;
+  bench->max_capture_us = frame->capture_us > bench->max_capture_us ? frame->capture_us : bench->max_capture_us;
+  bench->max_stage_us = frame->stage_us > bench->max_stage_us ? frame->stage_us : bench->max_stage_us;
+  bench->max_encode_us = frame->encode_us > bench->max_encode_us ? frame->encode_us : bench->max_encode_us;
+  bench->max_publish_us = publish_us > bench->max_publish_us ? publish_us : bench->max_publish_us;
+  bench->total_bytes += frame->jpeg_size;
+  bench->max_bytes = frame->jpeg_size > bench->max_bytes ? frame->jpeg_size : bench->max_bytes;
+  release_slot(slot);
+
+  return msg_id < 0 ? ESP_FAIL : ESP_OK;
+}
+
+static int append_benchmark_case(char *json, size_t size, const benchmark_case_t *bench)
+{
+  const uint32_t n = bench->frames > 0 ? bench->frames : 1U;
+  return snprintf(json,
+                  size,
+                  "{\"width\":%u,\"height\":%u,\"quality\":%u,\"frames\":%u,\"failures\":%u,"
+                  "\"capture_us\":{\"avg\":%u,\"max\":%u},\"stage_us\":{\"avg\":%u,\"max\":%u},"
+                  "\"encode_us\":{\"avg\":%u,\"max\":%u},\"publish_us\":{\"avg\":%u,\"max\":%u},"
+                  "\"bytes\":{\"avg\":%u,\"max\":%zu}}",
+                  bench->width,
+                  bench->height,
+                  bench->quality,
+                  bench->frames,
+                  bench->failures,
+                  (unsigned)(bench->total_capture_us / n),
+                  bench->max_capture_us,
+                  (unsigned)(bench->total_stage_us / n),
+                  bench->max_stage_us,
+                  (unsigned)(bench->total_encode_us / n),
+                  bench->max_encode_us,
+                  (unsigned)(bench->total_publish_us / n),
+                  bench->max_publish_us,
+                  (unsigned)(bench->total_bytes / n),
+                  bench->max_bytes);
+}
+
+static bool adaptive_downscale_available(void)
+{
+#if CONFIG_THEO_CAMERA_ADAPTIVE_DOWNSCALE
+  return s_raw_buffer != NULL;
+#else
+  return false;
+#endif
+}
+
 static esp_err_t build_mqtt_topics(void)
 {
   const char *device_root = device_identity_get_theo_device_topic_root();
@@ -379,6 +1451,38 @@ static esp_err_t build_mqtt_topics(void)
                      CAMERA_SNAPSHOT_AVAILABILITY_TOPIC_SUFFIX);
   ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(s_availability_topic), ESP_ERR_INVALID_SIZE, TAG,
                       "Snapshot availability topic overflow");
+
+  written = snprintf(s_thumbnail_topic,
+                     sizeof(s_thumbnail_topic),
+                     "%s%s",
+                     device_root,
+                     CAMERA_SNAPSHOT_THUMB_TOPIC_SUFFIX);
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(s_thumbnail_topic), ESP_ERR_INVALID_SIZE, TAG,
+                      "Snapshot thumbnail topic overflow");
+
+  written = snprintf(s_benchmark_topic,
+                     sizeof(s_benchmark_topic),
+                     "%s%s",
+                     device_root,
+                     CAMERA_SNAPSHOT_BENCHMARK_TOPIC_SUFFIX);
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(s_benchmark_topic), ESP_ERR_INVALID_SIZE, TAG,
+                      "Benchmark topic overflow");
+
+  written = snprintf(s_benchmark_frame_topic,
+                     sizeof(s_benchmark_frame_topic),
+                     "%s%s",
+                     device_root,
+                     CAMERA_SNAPSHOT_BENCHMARK_FRAME_TOPIC_SUFFIX);
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(s_benchmark_frame_topic), ESP_ERR_INVALID_SIZE, TAG,
+                      "Benchmark frame topic overflow");
+
+  written = snprintf(s_chunk_topic,
+                     sizeof(s_chunk_topic),
+                     "%s%s",
+                     device_root,
+                     CAMERA_SNAPSHOT_CHUNK_TOPIC_SUFFIX);
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(s_chunk_topic), ESP_ERR_INVALID_SIZE, TAG,
+                      "Snapshot chunk topic overflow");
   return ESP_OK;
 }
 
@@ -436,44 +1540,27 @@ static void camera_snapshot_mqtt_event_handler(void *handler_args,
   (void)event_data;
 
   if (event_id == MQTT_EVENT_CONNECTED) {
-    set_discovery_published(false);
-    republish_camera_entity(true);
+    republish_camera_entity();
   }
 }
 
-static void publish_discovery_config(bool force)
+static esp_err_t cache_discovery_config(void)
 {
-  if (!force && discovery_published()) {
-    return;
-  }
-  if (!mqtt_manager_is_ready()) {
-    return;
-  }
-
-  esp_mqtt_client_handle_t client = mqtt_manager_get_client();
-  if (client == NULL) {
-    return;
+  // The entry outlives stop/start cycles; the cache republishes it on reconnect.
+  if (s_discovery != HA_DISCOVERY_HANDLE_INVALID) {
+    return ESP_OK;
   }
 
-  const char *slug = device_identity_get_slug();
-  const char *friendly_name = device_identity_get_friendly_name();
   const char *device_root = device_identity_get_theo_device_topic_root();
-  if (slug == NULL || friendly_name == NULL || device_root == NULL) {
-    return;
-  }
+  ESP_RETURN_ON_FALSE(device_root != NULL, ESP_ERR_INVALID_STATE, TAG, "Device topic root unavailable");
 
-  char discovery_topic[CAMERA_SNAPSHOT_DISCOVERY_TOPIC_MAX_LEN];
   char device_availability_topic[CAMERA_SNAPSHOT_TOPIC_MAX_LEN];
-  ha_discovery_build_topic(discovery_topic, sizeof(discovery_topic), "camera", slug, CAMERA_SNAPSHOT_OBJECT_ID);
-
   int written = snprintf(device_availability_topic,
                          sizeof(device_availability_topic),
                          "%s/availability",
                          device_root);
-  if (written <= 0 || written >= (int)sizeof(device_availability_topic)) {
-    ESP_LOGW(TAG, "Device availability topic overflow for camera discovery");
-    return;
-  }
+  ESP_RETURN_ON_FALSE(written > 0 && written < (int)sizeof(device_availability_topic), ESP_ERR_INVALID_SIZE, TAG,
+                      "Device availability topic overflow for camera discovery");
 
   ha_discovery_entity_t entity = {
       .component = "camera",
@@ -485,19 +1572,7 @@ static void publish_discovery_config(bool force)
       .sensor_availability_topic = s_availability_topic,
   };
 
-  char payload[CAMERA_SNAPSHOT_DISCOVERY_PAYLOAD_MAX_LEN];
-  if (ha_discovery_build_payload(payload, sizeof(payload), &entity, slug, friendly_name) < 0) {
-    return;
-  }
-
-  int msg_id = esp_mqtt_client_publish(client, discovery_topic, payload, 0, 0, 1);
-  if (msg_id < 0) {
-    ESP_LOGE(TAG, "Failed to publish discovery for %s", CAMERA_SNAPSHOT_OBJECT_ID);
-    return;
-  }
-
-  set_discovery_published(true);
-  ESP_LOGI(TAG, "Published discovery config for %s (msg_id=%d)", CAMERA_SNAPSHOT_OBJECT_ID, msg_id);
+  return ha_discovery_cache_add(&entity, NULL, &s_discovery);
 }
 
 static void publish_availability(bool online)
@@ -521,376 +1596,92 @@ static void publish_availability(bool online)
   ESP_LOGI(TAG, "Published camera availability: %s", payload);
 }
 
-static void republish_camera_entity(bool force_discovery)
+static void republish_camera_entity(void)
 {
-  publish_discovery_config(force_discovery);
   publish_availability(camera_online());
 }
 
-static esp_err_t acquire_mipi_phy_ldo(void)
+static esp_err_t open_frame_source(void)
 {
-  if (s_ldo_mipi_phy != NULL) {
-    return ESP_OK;
-  }
-
-  esp_ldo_channel_config_t cfg = {
-    .chan_id = 3,
-    .voltage_mv = 2500,
-  };
-  esp_err_t err = esp_ldo_acquire_channel(&cfg, &s_ldo_mipi_phy);
-  if (err == ESP_ERR_INVALID_STATE) {
-    s_ldo_mipi_phy = NULL;
+  if (s_source_open) {
     return ESP_OK;
   }
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to acquire MIPI LDO: %s", esp_err_to_name(err));
-  }
-  return err;
-}
-
-static void release_mipi_phy_ldo(void)
-{
-  if (s_ldo_mipi_phy != NULL) {
-    esp_ldo_release_channel(s_ldo_mipi_phy);
-    s_ldo_mipi_phy = NULL;
-  }
-}
-
-static esp_err_t init_video_framework(void)
-{
-  if (s_video_initialized) {
-    return ESP_OK;
+  if (s_source == NULL) {
+#if CONFIG_THEO_CAMERA_SOURCE_SYNTHETIC
+    s_source = camera_frame_source_synthetic();
+#else
+    s_source = camera_frame_source_v4l2();
+#endif
   }
 
-  i2c_master_bus_handle_t i2c = bsp_i2c_get_handle();
-  ESP_RETURN_ON_FALSE(i2c != NULL, ESP_ERR_INVALID_STATE, TAG, "bsp_i2c_get_handle returned NULL");
-
-  esp_video_init_csi_config_t csi_cfg = {
-    .sccb_config = {
-      .init_sccb = false,
-      .i2c_handle = i2c,
-      .freq = 100000,
-    },
-    .reset_pin = -1,
-    .pwdn_pin = -1,
-    .dont_init_ldo = true,
-  };
-
-  esp_video_init_config_t video_cfg = {
-    .csi = &csi_cfg,
+  const camera_source_config_t config = {
+    .width = CAMERA_SNAPSHOT_WIDTH,
+    .height = CAMERA_SNAPSHOT_HEIGHT,
+    .buffer_count = CAMERA_SNAPSHOT_BUFFER_COUNT,
   };
-
-  esp_err_t err = esp_video_init(&video_cfg);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "esp_video_init failed: %s", esp_err_to_name(err));
-    return err;
-  }
-
-  s_video_initialized = true;
+  camera_source_format_t format;
+  // A failed open may have claimed part of the hardware; close() releases
+  // whatever it got.
+  s_source_open = true;
+  ESP_RETURN_ON_ERROR(s_source->open(&config, &format), TAG, "%s frame source open failed", s_source->name);
+
+  s_camera_pixfmt = format.pixfmt;
+  s_camera_row_stride = format.stride;
+  s_camera_buffer_count = format.buffer_count;
+  s_camera_buffer_bytes = format.buffer_bytes;
+  s_sensor_flipped = format.upright;
+  s_zero_copy = format.zero_copy;
+  ESP_LOGI(TAG,
+           "Frame source %s (pixfmt=%s stride=%zu buffers=%zu zero_copy=%d)",
+           s_source->name,
+           pixfmt_name(s_camera_pixfmt),
+           s_camera_row_stride,
+           s_camera_buffer_count,
+           s_zero_copy ? 1 : 0);
   return ESP_OK;
 }
 
-static void deinit_video_framework(void)
+static void close_frame_source(void)
 {
-  if (!s_video_initialized) {
-    return;
-  }
-
-  esp_err_t err = esp_video_deinit();
-  if (err != ESP_OK) {
-    ESP_LOGW(TAG, "esp_video_deinit failed: %s", esp_err_to_name(err));
+  if (!s_source_open) {
     return;
   }
-
-  s_video_initialized = false;
-}
-
-static esp_err_t open_camera_device(void)
-{
-  if (s_camera_fd >= 0) {
-    return ESP_OK;
-  }
-
-  s_camera_fd = open(ESP_VIDEO_MIPI_CSI_DEVICE_NAME, O_RDWR);
-  if (s_camera_fd < 0) {
-    ESP_LOGE(TAG, "Failed to open %s: %s", ESP_VIDEO_MIPI_CSI_DEVICE_NAME, strerror(errno));
-    return ESP_FAIL;
-  }
-
-  ESP_RETURN_ON_ERROR(select_camera_format(), TAG, "camera format negotiation failed");
-  esp_err_t tuning_err = apply_camera_tuning_controls();
-  if (tuning_err != ESP_OK) {
-    ESP_LOGW(TAG, "Camera tuning controls incomplete: %s", esp_err_to_name(tuning_err));
-  }
-  ESP_RETURN_ON_ERROR(allocate_camera_buffers(), TAG, "camera buffer allocation failed");
-
-  return ESP_OK;
-}
-
-static void close_camera_device(void)
-{
-  stop_camera_stream();
-
-  for (size_t i = 0; i < s_camera_buffer_count; ++i) {
-    if (s_camera_buffers[i].start != NULL && s_camera_buffers[i].length > 0) {
-      munmap(s_camera_buffers[i].start, s_camera_buffers[i].length);
-      s_camera_buffers[i].start = NULL;
-      s_camera_buffers[i].length = 0;
-    }
-  }
+  stop_frame_source();
+  s_source->close();
+  s_source_open = false;
   s_camera_buffer_count = 0;
+  s_camera_buffer_bytes = 0;
+  s_sensor_flipped = false;
+  s_zero_copy = false;
   s_camera_row_stride = 0;
-  s_frame_size_bytes = 0;
   s_camera_pixfmt = 0;
-
-  if (s_camera_fd >= 0) {
-    close(s_camera_fd);
-    s_camera_fd = -1;
-  }
-}
-
-static esp_err_t select_camera_format(void)
-{
-  const uint32_t preferred_formats[] = {
-    V4L2_PIX_FMT_RGB565,
-    V4L2_PIX_FMT_RGB24,
-  };
-
-  uint32_t selected_format = 0;
-  for (size_t preferred = 0; preferred < sizeof(preferred_formats) / sizeof(preferred_formats[0]); ++preferred) {
-    for (uint32_t index = 0;; ++index) {
-      struct v4l2_fmtdesc fmt_desc = {
-        .index = index,
-        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-      };
-      if (ioctl(s_camera_fd, VIDIOC_ENUM_FMT, &fmt_desc) != 0) {
-        break;
-      }
-      if (fmt_desc.pixelformat == preferred_formats[preferred]) {
-        selected_format = fmt_desc.pixelformat;
-        break;
-      }
-    }
-    if (selected_format != 0) {
-      break;
-    }
-  }
-
-  ESP_RETURN_ON_FALSE(selected_format != 0,
-                      ESP_ERR_NOT_SUPPORTED,
-                      TAG,
-                      "No RGB capture format found");
-
-  struct v4l2_format fmt = {
-    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-  };
-  fmt.fmt.pix.width = CAMERA_SNAPSHOT_WIDTH;
-  fmt.fmt.pix.height = CAMERA_SNAPSHOT_HEIGHT;
-  fmt.fmt.pix.pixelformat = selected_format;
-  fmt.fmt.pix.field = V4L2_FIELD_NONE;
-
-  if (ioctl(s_camera_fd, VIDIOC_S_FMT, &fmt) != 0) {
-    ESP_LOGE(TAG, "VIDIOC_S_FMT failed: %s", strerror(errno));
-    return ESP_FAIL;
-  }
-
-  ESP_RETURN_ON_FALSE(fmt.fmt.pix.width == CAMERA_SNAPSHOT_WIDTH &&
-                          fmt.fmt.pix.height == CAMERA_SNAPSHOT_HEIGHT,
-                      ESP_ERR_INVALID_SIZE,
-                      TAG,
-                      "Camera format mismatch: got %ux%u",
-                      fmt.fmt.pix.width,
-                      fmt.fmt.pix.height);
-  ESP_RETURN_ON_FALSE(fmt.fmt.pix.pixelformat == selected_format,
-                      ESP_ERR_NOT_SUPPORTED,
-                      TAG,
-                      "Camera pixel format mismatch");
-
-  s_camera_pixfmt = fmt.fmt.pix.pixelformat;
-  s_camera_row_stride = fmt.fmt.pix.bytesperline;
-  s_frame_size_bytes = fmt.fmt.pix.sizeimage;
-  if (s_frame_size_bytes == 0) {
-    s_frame_size_bytes = packed_frame_bytes(s_camera_pixfmt);
-  }
-
-  ESP_LOGI(TAG,
-           "Camera ready (%ux%u pixfmt=%s stride=%zu frame_bytes=%zu)",
-           CAMERA_SNAPSHOT_WIDTH,
-           CAMERA_SNAPSHOT_HEIGHT,
-           pixfmt_name(s_camera_pixfmt),
-           s_camera_row_stride,
-           s_frame_size_bytes);
-  return ESP_OK;
-}
-
-static esp_err_t apply_camera_tuning_controls(void)
-{
-  esp_err_t err = set_video_control(s_camera_fd,
-                                    V4L2_CID_USER_CLASS,
-                                    V4L2_CID_EXPOSURE,
-                                    CAMERA_SNAPSHOT_AE_TARGET,
-                                    "AE target");
-
-  esp_err_t isp_err = apply_isp_balance_controls();
-  if (err != ESP_OK) {
-    return err;
-  }
-  if (isp_err != ESP_OK) {
-    return isp_err;
-  }
-
-  ESP_LOGI(TAG,
-           "Camera tuning applied (ae_target=%d red_balance=%d blue_balance=%d)",
-           CAMERA_SNAPSHOT_AE_TARGET,
-           CAMERA_SNAPSHOT_RED_BALANCE,
-           CAMERA_SNAPSHOT_BLUE_BALANCE);
-  return ESP_OK;
-}
-
-static esp_err_t apply_isp_balance_controls(void)
-{
-  int isp_fd = open(ESP_VIDEO_ISP1_DEVICE_NAME, O_RDWR);
-  if (isp_fd < 0) {
-    ESP_LOGW(TAG, "Failed to open %s for ISP tuning: %s", ESP_VIDEO_ISP1_DEVICE_NAME, strerror(errno));
-    return ESP_FAIL;
-  }
-
-  esp_err_t err = set_video_control(isp_fd,
-                                    V4L2_CID_USER_CLASS,
-                                    V4L2_CID_RED_BALANCE,
-                                    CAMERA_SNAPSHOT_RED_BALANCE,
-                                    "red balance");
-  esp_err_t blue_err = set_video_control(isp_fd,
-                                         V4L2_CID_USER_CLASS,
-                                         V4L2_CID_BLUE_BALANCE,
-                                         CAMERA_SNAPSHOT_BLUE_BALANCE,
-                                         "blue balance");
-
-  close(isp_fd);
-
-  if (err != ESP_OK) {
-    return err;
-  }
-  return blue_err;
-}
-
-static esp_err_t set_video_control(int fd, uint32_t ctrl_class, uint32_t id, int32_t value, const char *name)
-{
-  struct v4l2_ext_control control[1] = {
-    {
-      .id = id,
-      .value = value,
-    },
-  };
-  struct v4l2_ext_controls controls = {
-    .ctrl_class = ctrl_class,
-    .count = 1,
-    .controls = control,
-  };
-
-  if (ioctl(fd, VIDIOC_S_EXT_CTRLS, &controls) != 0) {
-    ESP_LOGW(TAG, "Failed to set %s=%ld: %s", name, (long)value, strerror(errno));
-    return ESP_FAIL;
-  }
-
-  return ESP_OK;
-}
-
-static esp_err_t allocate_camera_buffers(void)
-{
-  struct v4l2_requestbuffers req = {
-    .count = CAMERA_SNAPSHOT_BUFFER_COUNT,
-    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-    .memory = V4L2_MEMORY_MMAP,
-  };
-
-  if (ioctl(s_camera_fd, VIDIOC_REQBUFS, &req) != 0) {
-    ESP_LOGE(TAG, "VIDIOC_REQBUFS failed: %s", strerror(errno));
-    return ESP_FAIL;
-  }
-
-  ESP_RETURN_ON_FALSE(req.count >= CAMERA_SNAPSHOT_BUFFER_COUNT,
-                      ESP_ERR_NO_MEM,
-                      TAG,
-                      "Only %u camera buffers allocated",
-                      req.count);
-
-  s_camera_buffer_count = req.count;
-  for (size_t i = 0; i < s_camera_buffer_count; ++i) {
-    struct v4l2_buffer buf = {
-      .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-      .memory = V4L2_MEMORY_MMAP,
-      .index = i,
-    };
-
-    if (ioctl(s_camera_fd, VIDIOC_QUERYBUF, &buf) != 0) {
-      ESP_LOGE(TAG, "VIDIOC_QUERYBUF[%zu] failed: %s", i, strerror(errno));
-      return ESP_FAIL;
-    }
-
-    void *mapped = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, s_camera_fd, buf.m.offset);
-    if (mapped == MAP_FAILED) {
-      ESP_LOGE(TAG, "mmap[%zu] failed: %s", i, strerror(errno));
-      return ESP_ERR_NO_MEM;
-    }
-
-    s_camera_buffers[i].start = mapped;
-    s_camera_buffers[i].length = buf.length;
-
-    if (ioctl(s_camera_fd, VIDIOC_QBUF, &buf) != 0) {
-      ESP_LOGE(TAG, "VIDIOC_QBUF[%zu] failed: %s", i, strerror(errno));
-      return ESP_FAIL;
-    }
-  }
-
-  return ESP_OK;
 }
 
-static esp_err_t start_camera_stream(void)
+static esp_err_t start_frame_source(void)
 {
-  if (s_camera_streaming) {
+  if (s_source_streaming) {
     return ESP_OK;
   }
-
-  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  if (ioctl(s_camera_fd, VIDIOC_STREAMON, &type) != 0) {
-    ESP_LOGE(TAG, "VIDIOC_STREAMON failed: %s", strerror(errno));
-    return ESP_FAIL;
-  }
-
-  s_camera_streaming = true;
-  return skip_startup_frames();
+  ESP_RETURN_ON_ERROR(s_source->start(), TAG, "%s frame source start failed", s_source->name);
+  s_source_streaming = true;
+  return ESP_OK;
 }
 
-static void stop_camera_stream(void)
+static void stop_frame_source(void)
 {
-  if (s_camera_fd < 0 || !s_camera_streaming) {
+  if (!s_source_streaming) {
     return;
   }
-
-  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  if (ioctl(s_camera_fd, VIDIOC_STREAMOFF, &type) != 0 && errno != EINVAL) {
-    ESP_LOGW(TAG, "VIDIOC_STREAMOFF failed: %s", strerror(errno));
-  }
-
-  s_camera_streaming = false;
+  s_source->stop();
+  s_source_streaming = false;
 }
 
-static esp_err_t skip_startup_frames(void)
+static esp_err_t skip_frames(size_t count)
 {
-  for (int i = 0; i < CAMERA_SNAPSHOT_STARTUP_SKIP_FRAMES; ++i) {
-    struct v4l2_buffer buf = {
-      .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-      .memory = V4L2_MEMORY_MMAP,
-    };
-    if (ioctl(s_camera_fd, VIDIOC_DQBUF, &buf) != 0) {
-      ESP_LOGE(TAG, "Startup VIDIOC_DQBUF failed: %s", strerror(errno));
-      return ESP_FAIL;
-    }
-    if (ioctl(s_camera_fd, VIDIOC_QBUF, &buf) != 0) {
-      ESP_LOGE(TAG, "Startup VIDIOC_QBUF failed: %s", strerror(errno));
-      return ESP_FAIL;
-    }
+  for (size_t i = 0; i < count; ++i) {
+    camera_source_buffer_t buf;
+    ESP_RETURN_ON_ERROR(s_source->dequeue(&buf), TAG, "skip dequeue failed");
+    ESP_RETURN_ON_ERROR(s_source->requeue(&buf), TAG, "skip requeue failed");
   }
   return ESP_OK;
 }
@@ -919,34 +1710,40 @@ static void release_jpeg_encoder(void)
   }
 }
 
-static esp_err_t ensure_jpeg_buffer(void)
+static esp_err_t ensure_jpeg_slots(void)
 {
-  if (s_jpeg_buffer != NULL) {
-    return ESP_OK;
-  }
-
   jpeg_encode_memory_alloc_cfg_t mem_cfg = {
     .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
   };
 
-  s_jpeg_buffer = jpeg_alloc_encoder_mem(CAMERA_SNAPSHOT_JPEG_BUFFER_BYTES,
-                                         &mem_cfg,
-                                         &s_jpeg_buffer_size);
-  if (s_jpeg_buffer == NULL) {
-    s_jpeg_buffer_size = 0;
-    return ESP_ERR_NO_MEM;
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    jpeg_slot_t *slot = &s_jpeg_slots[i];
+    if (slot->jpeg != NULL) {
+      continue;
+    }
+    slot->jpeg = jpeg_alloc_encoder_mem(CAMERA_SNAPSHOT_JPEG_BUFFER_BYTES, &mem_cfg, &slot->jpeg_capacity);
+    if (slot->jpeg == NULL) {
+      slot->jpeg_capacity = 0;
+      return ESP_ERR_NO_MEM;
+    }
+    slot->state = JPEG_SLOT_FREE;
   }
 
   return ESP_OK;
 }
 
-static void release_jpeg_buffer(void)
+static void release_jpeg_slots(void)
 {
-  if (s_jpeg_buffer != NULL) {
-    free(s_jpeg_buffer);
-    s_jpeg_buffer = NULL;
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    jpeg_slot_t *slot = &s_jpeg_slots[i];
+    if (slot->jpeg != NULL) {
+      free(slot->jpeg);
+    }
+    if (slot->thumb != NULL) {
+      free(slot->thumb);
+    }
+    memset(slot, 0, sizeof(*slot));
   }
-  s_jpeg_buffer_size = 0;
 }
 
 static esp_err_t ensure_raw_buffer(void)
@@ -961,8 +1758,17 @@ static esp_err_t ensure_raw_buffer(void)
                       TAG,
                       "Unsupported raw buffer format: %s",
                       pixfmt_name(s_camera_pixfmt));
+  if (s_zero_copy) {
+#if CONFIG_THEO_CAMERA_ADAPTIVE_DOWNSCALE
+    // Full frames are encoded in place; only half-tier frames are staged.
+    s_raw_buffer_size /= 4U;
+#else
+    s_raw_buffer_size = 0;
+    return ESP_OK;
+#endif
+  }
 
-  s_raw_buffer = heap_caps_malloc(s_raw_buffer_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  s_raw_buffer = alloc_frame_buffer(s_raw_buffer_size);
   if (s_raw_buffer == NULL) {
     s_raw_buffer_size = 0;
     return ESP_ERR_NO_MEM;
@@ -980,6 +1786,86 @@ static void release_raw_buffer(void)
   s_raw_buffer_size = 0;
 }
 
+static esp_err_t ensure_thumbnail_buffers(void)
+{
+  const int divisor = CONFIG_THEO_CAMERA_THUMBNAIL_DIVISOR;
+  if (divisor == 0 || s_thumb_raw_buffer != NULL) {
+    return ESP_OK;
+  }
+  if (divisor != 2 && divisor != 4 && divisor != 8) {
+    ESP_LOGW(TAG, "Thumbnail disabled: divisor %d is not 2, 4 or 8", divisor);
+    return ESP_OK;
+  }
+
+  // Crop the center so the scaled sides land on 16-pixel JPEG MCU boundaries.
+  const uint16_t side = (uint16_t)((CAMERA_SNAPSHOT_WIDTH / divisor) & ~15U);
+  const uint16_t crop = (uint16_t)(side * divisor);
+  s_thumb_op = (frame_transform_op_t){
+    .crop_x = (uint16_t)((CAMERA_SNAPSHOT_WIDTH - crop) / 2U),
+    .crop_y = (uint16_t)((CAMERA_SNAPSHOT_HEIGHT - crop) / 2U),
+    .crop_w = crop,
+    .crop_h = crop,
+    .scale_16ths = (uint8_t)(FRAME_TRANSFORM_SCALE_ONE / divisor),
+    .rotation = s_sensor_flipped ? FRAME_ROTATE_0 : FRAME_ROTATE_180,
+  };
+  s_thumb_width = side;
+  s_thumb_height = side;
+
+  const size_t bytes_per_pixel = frame_pixfmt_bytes_per_pixel(frame_pixfmt_for_v4l2(s_camera_pixfmt));
+  s_thumb_raw_buffer_size = (size_t)side * side * bytes_per_pixel;
+  s_thumb_raw_buffer = alloc_frame_buffer(s_thumb_raw_buffer_size);
+  if (s_thumb_raw_buffer == NULL) {
+    s_thumb_raw_buffer_size = 0;
+    return ESP_ERR_NO_MEM;
+  }
+
+  jpeg_encode_memory_alloc_cfg_t mem_cfg = {
+    .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+  };
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    jpeg_slot_t *slot = &s_jpeg_slots[i];
+    slot->thumb = jpeg_alloc_encoder_mem(CAMERA_SNAPSHOT_THUMB_JPEG_BUFFER_BYTES, &mem_cfg, &slot->thumb_capacity);
+    if (slot->thumb == NULL) {
+      slot->thumb_capacity = 0;
+      release_thumbnail_buffers();
+      return ESP_ERR_NO_MEM;
+    }
+  }
+
+  ESP_LOGI(TAG,
+           "Thumbnail enabled (%ux%u from %ux%u crop, topic=%s)",
+           s_thumb_width,
+           s_thumb_height,
+           crop,
+           crop,
+           s_thumbnail_topic);
+  return ESP_OK;
+}
+
+static void release_thumbnail_buffers(void)
+{
+  if (s_thumb_raw_buffer != NULL) {
+    heap_caps_free(s_thumb_raw_buffer);
+    s_thumb_raw_buffer = NULL;
+  }
+  s_thumb_raw_buffer_size = 0;
+  for (size_t i = 0; i < CAMERA_SNAPSHOT_JPEG_SLOTS; ++i) {
+    jpeg_slot_t *slot = &s_jpeg_slots[i];
+    if (slot->thumb != NULL) {
+      free(slot->thumb);
+      slot->thumb = NULL;
+    }
+    slot->thumb_capacity = 0;
+  }
+}
+
+static uint8_t *alloc_frame_buffer(size_t size)
+{
+  // Cache-line aligned and sized so the PPA can write it directly.
+  const size_t rounded = (size + CAMERA_SNAPSHOT_BUFFER_ALIGN - 1U) & ~(size_t)(CAMERA_SNAPSHOT_BUFFER_ALIGN - 1U);
+  return heap_caps_aligned_alloc(CAMERA_SNAPSHOT_BUFFER_ALIGN, rounded, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
 static size_t packed_frame_bytes(uint32_t pixfmt)
 {
   if (pixfmt == V4L2_PIX_FMT_RGB565) {
@@ -991,6 +1877,11 @@ static size_t packed_frame_bytes(uint32_t pixfmt)
   return 0;
 }
 
+static frame_pixfmt_t frame_pixfmt_for_v4l2(uint32_t pixfmt)
+{
+  return (pixfmt == V4L2_PIX_FMT_RGB565) ? FRAME_PIXFMT_RGB565 : FRAME_PIXFMT_RGB888;
+}
+
 static jpeg_enc_input_format_t jpeg_src_type_for_pixfmt(uint32_t pixfmt)
 {
   if (pixfmt == V4L2_PIX_FMT_RGB565) {
@@ -1007,115 +1898,176 @@ static jpeg_down_sampling_type_t jpeg_subsample_for_pixfmt(uint32_t pixfmt)
   return JPEG_DOWN_SAMPLING_YUV422;
 }
 
-static void copy_frame_to_jpeg_input(const uint8_t *frame,
-                                     size_t source_stride,
-                                     size_t bytes_per_pixel)
+static esp_err_t stage_frame(const uint8_t *frame, size_t source_stride, uint8_t scale_16ths, snapshot_frame_t *out)
 {
-  const size_t packed_stride = (size_t)CAMERA_SNAPSHOT_WIDTH * bytes_per_pixel;
+  const frame_src_t src = {
+    .data = frame,
+    .stride = source_stride,
+    .width = CAMERA_SNAPSHOT_WIDTH,
+    .height = CAMERA_SNAPSHOT_HEIGHT,
+    .format = frame_pixfmt_for_v4l2(s_camera_pixfmt),
+  };
 
-  for (size_t y = 0; y < CAMERA_SNAPSHOT_HEIGHT; ++y) {
-    const uint8_t *src_row = frame + ((CAMERA_SNAPSHOT_HEIGHT - 1U - y) * source_stride);
-    uint8_t *dst_row = s_raw_buffer + (y * packed_stride);
+  if (!s_zero_copy || scale_16ths != FRAME_TRANSFORM_SCALE_ONE) {
+    // The sensor is mounted upside down; unless it flips the image itself, the
+    // JPEG input is the frame rotated 180°.
+    const frame_transform_op_t full_op = {
+      .scale_16ths = scale_16ths,
+      .rotation = s_sensor_flipped ? FRAME_ROTATE_0 : FRAME_ROTATE_180,
+    };
+    const frame_dst_t full_dst = {
+      .data = s_raw_buffer,
+      .size = s_raw_buffer_size,
+      .format = src.format,
+    };
+    frame_transform_backend_t backend = FRAME_TRANSFORM_BACKEND_SW;
+    ESP_RETURN_ON_ERROR(frame_transform_run(&src, &full_op, &full_dst, &backend), TAG, "frame transform failed");
+    out->stage_ppa = (backend == FRAME_TRANSFORM_BACKEND_PPA);
+  }
 
-    for (size_t x = 0; x < CAMERA_SNAPSHOT_WIDTH; ++x) {
-      memcpy(dst_row + (x * bytes_per_pixel),
-             src_row + ((CAMERA_SNAPSHOT_WIDTH - 1U - x) * bytes_per_pixel),
-             bytes_per_pixel);
-    }
+  if (s_thumb_raw_buffer != NULL) {
+    const frame_dst_t thumb_dst = {
+      .data = s_thumb_raw_buffer,
+      .size = s_thumb_raw_buffer_size,
+      .format = src.format,
+    };
+    ESP_RETURN_ON_ERROR(frame_transform_run(&src, &s_thumb_op, &thumb_dst, NULL), TAG, "thumbnail transform failed");
   }
+  return ESP_OK;
 }
 
-static esp_err_t encode_snapshot_frame(size_t *jpeg_size)
+static esp_err_t dequeue_camera_frame(captured_frame_t *cap)
 {
-  ESP_RETURN_ON_FALSE(jpeg_size != NULL,
-                      ESP_ERR_INVALID_ARG,
-                      TAG,
-                      "JPEG size pointer missing");
-  ESP_RETURN_ON_FALSE(s_jpeg_encoder != NULL && s_jpeg_buffer != NULL,
-                      ESP_ERR_INVALID_STATE,
-                      TAG,
-                      "JPEG encoder unavailable");
-  ESP_RETURN_ON_FALSE(s_raw_buffer != NULL && s_raw_buffer_size > 0,
-                      ESP_ERR_INVALID_STATE,
-                      TAG,
-                      "Raw buffer unavailable");
-
-  struct v4l2_buffer buf = {
-    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-    .memory = V4L2_MEMORY_MMAP,
-  };
-  if (ioctl(s_camera_fd, VIDIOC_DQBUF, &buf) != 0) {
-    ESP_LOGE(TAG, "VIDIOC_DQBUF failed: %s", strerror(errno));
-    return ESP_FAIL;
-  }
+  memset(cap, 0, sizeof(*cap));
 
-  ESP_RETURN_ON_FALSE(buf.index < s_camera_buffer_count,
-                      ESP_ERR_INVALID_RESPONSE,
-                      TAG,
-                      "Camera buffer index overflow: %u",
-                      buf.index);
+  const int64_t capture_start_us = esp_timer_get_time();
+  ESP_RETURN_ON_ERROR(s_source->dequeue(&cap->buf), TAG, "frame dequeue failed");
+  cap->captured_at_us = esp_timer_get_time();
+  cap->capture_us = (uint32_t)(cap->captured_at_us - capture_start_us);
 
-  const size_t bytes_per_pixel = (s_camera_pixfmt == V4L2_PIX_FMT_RGB565) ? 2U : 3U;
-  const size_t packed_stride = (size_t)CAMERA_SNAPSHOT_WIDTH * bytes_per_pixel;
-  const size_t source_stride = s_camera_row_stride >= packed_stride ? s_camera_row_stride : packed_stride;
-  const size_t required_bytes = source_stride * (size_t)CAMERA_SNAPSHOT_HEIGHT;
+  cap->stride = s_camera_row_stride;
+  const size_t required_bytes = cap->stride * (size_t)CAMERA_SNAPSHOT_HEIGHT;
 
-  if (buf.bytesused < required_bytes) {
+  if (cap->buf.bytesused < required_bytes) {
     ESP_LOGE(TAG,
-             "Frame too small for %s: bytesused=%u required=%zu stride=%zu",
+             "Frame too small for %s: bytesused=%zu required=%zu stride=%zu",
              pixfmt_name(s_camera_pixfmt),
-             buf.bytesused,
+             cap->buf.bytesused,
              required_bytes,
-             source_stride);
-    (void)ioctl(s_camera_fd, VIDIOC_QBUF, &buf);
+             cap->stride);
+    (void)s_source->requeue(&cap->buf);
     return ESP_ERR_INVALID_SIZE;
   }
 
-  const uint8_t *frame = (const uint8_t *)s_camera_buffers[buf.index].start;
-  copy_frame_to_jpeg_input(frame, source_stride, bytes_per_pixel);
+  cap->data = cap->buf.data;
+  return ESP_OK;
+}
+
+// Takes ownership of cap->buf: it is requeued on every path.
+static esp_err_t encode_snapshot_frame(captured_frame_t *cap, jpeg_slot_t *slot, uint8_t scale_16ths, uint8_t quality)
+{
+  // Full-size zero-copy frames are encoded straight from the capture buffer;
+  // everything else goes through the staging buffer.
+  const bool direct = s_zero_copy && scale_16ths == FRAME_TRANSFORM_SCALE_ONE;
+  if (s_jpeg_encoder == NULL || slot->jpeg == NULL) {
+    (void)requeue_camera_buffer(&cap->buf);
+    ESP_LOGE(TAG, "JPEG encoder unavailable");
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!direct && (s_raw_buffer == NULL || s_raw_buffer_size == 0)) {
+    (void)requeue_camera_buffer(&cap->buf);
+    ESP_LOGE(TAG, "Raw buffer unavailable");
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  snapshot_frame_t *out = &slot->frame;
+  memset(out, 0, sizeof(*out));
+  out->width = (uint16_t)((CAMERA_SNAPSHOT_WIDTH * scale_16ths) / FRAME_TRANSFORM_SCALE_ONE);
+  out->height = (uint16_t)((CAMERA_SNAPSHOT_HEIGHT * scale_16ths) / FRAME_TRANSFORM_SCALE_ONE);
+  out->quality = quality;
+  out->capture_us = cap->capture_us;
+  slot->captured_at_us = cap->captured_at_us;
+
+  const size_t bytes_per_pixel = (s_camera_pixfmt == V4L2_PIX_FMT_RGB565) ? 2U : 3U;
+  const camera_source_buffer_t *buf = &cap->buf;
+  const uint8_t *frame = cap->data;
+  const int64_t stage_start_us = esp_timer_get_time();
+  esp_err_t stage_err = stage_frame(frame, cap->stride, scale_16ths, out);
+  out->stage_us = (uint32_t)(esp_timer_get_time() - stage_start_us);
 
-  if (ioctl(s_camera_fd, VIDIOC_QBUF, &buf) != 0) {
-    ESP_LOGE(TAG, "VIDIOC_QBUF failed: %s", strerror(errno));
-    return ESP_FAIL;
+  // In zero-copy mode the encoder reads the capture buffer, so it stays
+  // dequeued until the full frame is encoded.
+  if (!direct || stage_err != ESP_OK) {
+    ESP_RETURN_ON_ERROR(requeue_camera_buffer(buf), TAG, "requeue failed");
+  }
+  if (stage_err != ESP_OK) {
+    return stage_err;
   }
 
   jpeg_encode_cfg_t cfg = {
-    .height = CAMERA_SNAPSHOT_HEIGHT,
-    .width = CAMERA_SNAPSHOT_WIDTH,
+    .height = out->height,
+    .width = out->width,
     .src_type = jpeg_src_type_for_pixfmt(s_camera_pixfmt),
     .sub_sample = jpeg_subsample_for_pixfmt(s_camera_pixfmt),
-    .image_quality = CAMERA_SNAPSHOT_JPEG_QUALITY,
+    .image_quality = out->quality,
   };
 
+  const uint8_t *jpeg_input = direct ? frame : s_raw_buffer;
+  const size_t jpeg_input_size = (size_t)out->width * out->height * bytes_per_pixel;
   uint32_t encoded_size = 0;
+  const int64_t encode_start_us = esp_timer_get_time();
   esp_err_t err = jpeg_encoder_process(s_jpeg_encoder,
                                        &cfg,
-                                       s_raw_buffer,
-                                       (uint32_t)s_raw_buffer_size,
-                                       s_jpeg_buffer,
-                                       (uint32_t)s_jpeg_buffer_size,
+                                       jpeg_input,
+                                       (uint32_t)jpeg_input_size,
+                                       slot->jpeg,
+                                       (uint32_t)slot->jpeg_capacity,
                                        &encoded_size);
+  if (direct) {
+    esp_err_t requeue_err = requeue_camera_buffer(buf);
+    if (err == ESP_OK) {
+      err = requeue_err;
+    }
+  }
   if (err != ESP_OK) {
     return err;
   }
-
-  *jpeg_size = encoded_size;
+  out->jpeg_size = encoded_size;
+
+  if (s_thumb_raw_buffer != NULL && slot->thumb != NULL) {
+    jpeg_encode_cfg_t thumb_cfg = cfg;
+    thumb_cfg.width = s_thumb_width;
+    thumb_cfg.height = s_thumb_height;
+    uint32_t thumb_size = 0;
+    err = jpeg_encoder_process(s_jpeg_encoder,
+                               &thumb_cfg,
+                               s_thumb_raw_buffer,
+                               (uint32_t)s_thumb_raw_buffer_size,
+                               slot->thumb,
+                               (uint32_t)slot->thumb_capacity,
+                               &thumb_size);
+    if (err != ESP_OK) {
+      // The full frame is still worth publishing without its thumbnail.
+      ESP_LOGW(TAG, "Thumbnail encode failed: %s", esp_err_to_name(err));
+      thumb_size = 0;
+    }
+    out->thumb_size = thumb_size;
+  }
+  out->encode_us = (uint32_t)(esp_timer_get_time() - encode_start_us);
   return ESP_OK;
 }
 
+static esp_err_t requeue_camera_buffer(const camera_source_buffer_t *buf)
+{
+  return s_source->requeue(buf);
+}
+
 static void release_resources(void)
 {
-  if (s_ir_led_enabled) {
-    thermostat_ir_led_set(false);
-    s_ir_led_enabled = false;
-  }
-  stop_camera_stream();
+  power_down_camera();
+  release_thumbnail_buffers();
   release_raw_buffer();
-  release_jpeg_buffer();
-  release_jpeg_encoder();
-  close_camera_device();
-  deinit_video_framework();
-  release_mipi_phy_ldo();
+  release_jpeg_slots();
 }
 
 static bool stop_requested(void)
@@ -1146,52 +2098,86 @@ static void set_camera_online(bool online)
   }
 }
 
-static bool discovery_published(void)
-{
-  taskENTER_CRITICAL(&s_state_lock);
-  bool published = s_discovery_published;
-  taskEXIT_CRITICAL(&s_state_lock);
-  return published;
-}
-
-static void set_discovery_published(bool published)
-{
-  taskENTER_CRITICAL(&s_state_lock);
-  s_discovery_published = published;
-  taskEXIT_CRITICAL(&s_state_lock);
-}
-
 static void set_started_state(bool started)
 {
   taskENTER_CRITICAL(&s_state_lock);
   s_started = started;
   s_stop_requested = false;
   s_camera_online = false;
-  s_discovery_published = false;
   taskEXIT_CRITICAL(&s_state_lock);
 }
 
-static void log_publish_metrics(uint32_t publish_count,
-                                uint32_t publish_failures,
-                                uint64_t total_publish_time_us,
-                                uint64_t max_publish_time_us,
-                                uint64_t total_publish_bytes)
+static void log_publish_metrics(const snapshot_metrics_t *metrics)
 {
-  if (publish_count == 0) {
+  if (metrics->publish_count == 0) {
     return;
   }
 
-  uint32_t avg_publish_us = (uint32_t)(total_publish_time_us / publish_count);
-  uint32_t max_publish_us = (uint32_t)max_publish_time_us;
-  uint32_t avg_publish_bytes = (uint32_t)(total_publish_bytes / publish_count);
+  uint32_t avg_publish_us = (uint32_t)(metrics->total_publish_time_us / metrics->publish_count);
+  uint32_t max_publish_us = (uint32_t)metrics->max_publish_time_us;
+  uint32_t avg_publish_bytes = (uint32_t)(metrics->total_publish_bytes / metrics->publish_count);
+  uint32_t avg_stage_us =
+      (metrics->frame_count > 0) ? (uint32_t)(metrics->total_stage_time_us / metrics->frame_count) : 0;
+  uint32_t max_stage_us = (uint32_t)metrics->max_stage_time_us;
+  uint32_t avg_capture_us =
+      (metrics->frame_count > 0) ? (uint32_t)(metrics->total_capture_time_us / metrics->frame_count) : 0;
+  uint32_t max_capture_us = (uint32_t)metrics->max_capture_time_us;
+  uint32_t avg_encode_us =
+      (metrics->frame_count > 0) ? (uint32_t)(metrics->total_encode_time_us / metrics->frame_count) : 0;
+  uint32_t max_encode_us = (uint32_t)metrics->max_encode_time_us;
+  uint32_t avg_age_us = (uint32_t)(metrics->total_frame_age_us / metrics->publish_count);
+  uint32_t max_age_us = (uint32_t)metrics->max_frame_age_us;
+  uint32_t avg_quality = (metrics->frame_count > 0) ? (uint32_t)(metrics->total_quality / metrics->frame_count) : 0;
+  uint32_t avg_thumb_bytes =
+      (metrics->thumb_count > 0) ? (uint32_t)(metrics->total_thumb_bytes / metrics->thumb_count) : 0;
 
   ESP_LOGI(TAG,
-           "snapshot_publish_metrics count=%u failures=%u avg_publish_us=%u max_publish_us=%u avg_bytes=%u interval_ms=%d",
-           publish_count,
-           publish_failures,
+           "snapshot_publish_metrics count=%u failures=%u avg_publish_us=%u max_publish_us=%u avg_bytes=%u "
+           "avg_capture_us=%u max_capture_us=%u avg_stage_us=%u max_stage_us=%u avg_encode_us=%u max_encode_us=%u "
+           "avg_age_us=%u max_age_us=%u encoded=%u dropped=%u "
+           "quality=%u avg_quality=%u size=%ux%u budget_bps=%u target_bytes=%u backoff_pct=%u "
+           "gate_motion=%u gate_heartbeat=%u gate_viewer=%u gate_suppressed=%u gate_last_permille=%u "
+           "chunks=%u max_chunk_us=%u chunk_bytes=%d power=%s wakes=%u last_wake_ms=%u max_wake_ms=%u "
+           "zero_copy=%d ppa_frames=%u/%u thumbs=%u avg_thumb_bytes=%u interval_ms=%d",
+           metrics->publish_count,
+           metrics->publish_failures,
            avg_publish_us,
            max_publish_us,
            avg_publish_bytes,
+           avg_capture_us,
+           max_capture_us,
+           avg_stage_us,
+           max_stage_us,
+           avg_encode_us,
+           max_encode_us,
+           avg_age_us,
+           max_age_us,
+           metrics->frame_count,
+           metrics->dropped_frames,
+           metrics->quality,
+           avg_quality,
+           metrics->frame_width,
+           metrics->frame_height,
+           (unsigned)CONFIG_THEO_CAMERA_JPEG_BUDGET_BPS,
+           (unsigned)metrics->target_bytes,
+           metrics->backoff_pct,
+           metrics->gate_motion,
+           metrics->gate_heartbeat,
+           metrics->gate_viewer,
+           metrics->gate_suppressed,
+           metrics->gate_last_permille,
+           metrics->chunk_count,
+           (uint32_t)metrics->max_chunk_time_us,
+           CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES,
+           camera_power_state_to_str(s_power_policy.state),
+           metrics->wake_count,
+           metrics->last_wake_ms,
+           metrics->max_wake_ms,
+           s_zero_copy ? 1 : 0,
+           metrics->ppa_frames,
+           metrics->frame_count,
+           metrics->thumb_count,
+           avg_thumb_bytes,
            CONFIG_THEO_CAMERA_SNAPSHOT_INTERVAL_MS);
 }
 
@@ -1228,4 +2214,9 @@ size_t camera_snapshot_publisher_get_task_stack_size_bytes(void)
   return 0;
 }
 
+esp_err_t camera_snapshot_publisher_request_benchmark(void)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
 #endif
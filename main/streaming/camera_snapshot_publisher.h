@@ -1,6 +1,8 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
@@ -15,6 +17,46 @@ esp_err_t camera_snapshot_publisher_stop(void);
 TaskHandle_t camera_snapshot_publisher_get_task_handle(void);
 size_t camera_snapshot_publisher_get_task_stack_size_bytes(void);
 
+/**
+ * A reference to an encoded snapshot held by the publisher. The JPEG is read
+ * in place from the publisher's slot and stays valid until released; every
+ * reader of the same frame shares the one encode.
+ */
+typedef struct {
+  const uint8_t *jpeg;
+  size_t jpeg_size;
+  uint32_t seq; // never 0; increases with every encoded frame
+  uint16_t width;
+  uint16_t height;
+  int64_t captured_at_us;
+  void *token;
+} camera_snapshot_ref_t;
+
+/**
+ * @brief References the latest encoded frame unless its seq equals after_seq.
+ *        Pass 0 to accept any frame.
+ * @return false if no frame is available (camera stopped, or nothing newer).
+ */
+bool camera_snapshot_publisher_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out);
+void camera_snapshot_publisher_release(camera_snapshot_ref_t *ref);
+
+/**
+ * @brief Live viewers bypass the motion gate so they get a frame every
+ *        interval. Calls must be balanced.
+ */
+void camera_snapshot_publisher_viewer_attach(void);
+void camera_snapshot_publisher_viewer_detach(void);
+
+/**
+ * @brief Asks the capture task to run the pipeline benchmark: a fixed grid of
+ *        resolutions and JPEG qualities, with per-stage latency, bytes per
+ *        frame and buffer memory published as JSON to
+ *        <root>/diagnostics/camera_benchmark. Normal snapshots pause while it
+ *        runs.
+ * @return ESP_ERR_INVALID_STATE if the publisher is not running.
+ */
+esp_err_t camera_snapshot_publisher_request_benchmark(void);
+
 #ifdef __cplusplus
 }
 #endif
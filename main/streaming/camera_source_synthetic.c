@@ -0,0 +1,251 @@
+#include "streaming/camera_frame_source.h"
+
+#include <linux/videodev2.h>
+#include <string.h>
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TAG "camera_synth"
+
+#define SYNTH_MAX_BUFFERS 4
+#define SYNTH_BUFFER_ALIGN 128
+#define SYNTH_FRAME_PERIOD_US 33333LL
+#define SYNTH_BAR_COUNT 8
+#define SYNTH_BOX_SIDE 96
+#define SYNTH_BOX_STEP 7
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  bool held;
+  // Where the moving box was last drawn into this buffer, so only that patch
+  // has to be restored on reuse.
+  int box_x;
+  int box_y;
+} synth_buffer_t;
+
+static camera_source_config_t s_config;
+static camera_source_format_t s_format;
+static synth_buffer_t s_buffers[SYNTH_MAX_BUFFERS];
+static size_t s_next_buffer;
+static bool s_running;
+static int64_t s_next_frame_us;
+static uint32_t s_frame_number;
+
+static esp_err_t synth_open(const camera_source_config_t *config, camera_source_format_t *out);
+static void synth_close(void);
+static esp_err_t synth_start(void);
+static void synth_stop(void);
+static esp_err_t synth_dequeue(camera_source_buffer_t *buf);
+static esp_err_t synth_requeue(const camera_source_buffer_t *buf);
+static void render_background(uint8_t *frame, int x0, int y0, int w, int h);
+static void render_box(uint8_t *frame, int x0, int y0);
+static void box_position(uint32_t frame_number, int *x, int *y);
+static void put_rgb565(uint8_t *px, uint32_t r, uint32_t g, uint32_t b);
+
+static const camera_frame_source_t s_source = {
+  .name = "synthetic",
+  .open = synth_open,
+  .close = synth_close,
+  .start = synth_start,
+  .stop = synth_stop,
+  .dequeue = synth_dequeue,
+  .requeue = synth_requeue,
+};
+
+// Colour bars in 75% amplitude, the usual SMPTE order.
+static const uint8_t s_bar_rgb[SYNTH_BAR_COUNT][3] = {
+  {191, 191, 191}, {191, 191, 0}, {0, 191, 191}, {0, 191, 0},
+  {191, 0, 191},   {191, 0, 0},   {0, 0, 191},   {16, 16, 16},
+};
+
+const camera_frame_source_t *camera_frame_source_synthetic(void)
+{
+  return &s_source;
+}
+
+static esp_err_t synth_open(const camera_source_config_t *config, camera_source_format_t *out)
+{
+  ESP_RETURN_ON_FALSE(config->buffer_count > 0 && config->buffer_count <= SYNTH_MAX_BUFFERS,
+                      ESP_ERR_INVALID_ARG,
+                      TAG,
+                      "Unsupported buffer count %zu",
+                      config->buffer_count);
+  ESP_RETURN_ON_FALSE(config->width >= SYNTH_BOX_SIDE * 2 && config->height >= SYNTH_BOX_SIDE * 2,
+                      ESP_ERR_INVALID_SIZE,
+                      TAG,
+                      "Frame too small: %ux%u",
+                      config->width,
+                      config->height);
+  if (s_format.buffer_count > 0) {
+    *out = s_format;
+    return ESP_OK;
+  }
+  s_config = *config;
+
+  const size_t stride = (size_t)config->width * 2U;
+  const size_t frame_bytes = stride * config->height;
+  const size_t rounded = (frame_bytes + SYNTH_BUFFER_ALIGN - 1U) & ~(size_t)(SYNTH_BUFFER_ALIGN - 1U);
+  for (size_t i = 0; i < config->buffer_count; ++i) {
+    synth_buffer_t *buf = &s_buffers[i];
+    buf->data = heap_caps_aligned_alloc(SYNTH_BUFFER_ALIGN, rounded, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (buf->data == NULL) {
+      synth_close();
+      return ESP_ERR_NO_MEM;
+    }
+    buf->length = rounded;
+    buf->held = false;
+    render_background(buf->data, 0, 0, config->width, config->height);
+    buf->box_x = -1;
+    buf->box_y = -1;
+  }
+
+  s_format = (camera_source_format_t){
+    .pixfmt = V4L2_PIX_FMT_RGB565,
+    .stride = stride,
+    .buffer_count = config->buffer_count,
+    .buffer_bytes = rounded * config->buffer_count,
+    .upright = true,
+    .zero_copy = true,
+  };
+  *out = s_format;
+  ESP_LOGI(TAG,
+           "Synthetic source ready (%ux%u pixfmt=RGB565 buffers=%zu frame_period_us=%lld)",
+           config->width,
+           config->height,
+           config->buffer_count,
+           SYNTH_FRAME_PERIOD_US);
+  return ESP_OK;
+}
+
+static void synth_close(void)
+{
+  synth_stop();
+  for (size_t i = 0; i < SYNTH_MAX_BUFFERS; ++i) {
+    if (s_buffers[i].data != NULL) {
+      heap_caps_free(s_buffers[i].data);
+    }
+    memset(&s_buffers[i], 0, sizeof(s_buffers[i]));
+  }
+  memset(&s_format, 0, sizeof(s_format));
+}
+
+static esp_err_t synth_start(void)
+{
+  ESP_RETURN_ON_FALSE(s_format.buffer_count > 0, ESP_ERR_INVALID_STATE, TAG, "Source not open");
+  s_running = true;
+  s_next_frame_us = esp_timer_get_time();
+  return ESP_OK;
+}
+
+static void synth_stop(void)
+{
+  s_running = false;
+}
+
+static esp_err_t synth_dequeue(camera_source_buffer_t *buf)
+{
+  ESP_RETURN_ON_FALSE(s_running, ESP_ERR_INVALID_STATE, TAG, "Source not streaming");
+
+  synth_buffer_t *slot = NULL;
+  for (size_t i = 0; i < s_format.buffer_count; ++i) {
+    const size_t index = (s_next_buffer + i) % s_format.buffer_count;
+    if (!s_buffers[index].held) {
+      slot = &s_buffers[index];
+      s_next_buffer = (index + 1U) % s_format.buffer_count;
+      break;
+    }
+  }
+  ESP_RETURN_ON_FALSE(slot != NULL, ESP_ERR_INVALID_STATE, TAG, "All buffers dequeued");
+
+  // Pace like a sensor: a frame is "exposed" once per period, and a consumer
+  // that falls behind gets the next one immediately rather than a backlog.
+  const int64_t now_us = esp_timer_get_time();
+  if (now_us < s_next_frame_us) {
+    const TickType_t ticks = pdMS_TO_TICKS((uint32_t)((s_next_frame_us - now_us + 999LL) / 1000LL));
+    vTaskDelay(ticks > 0 ? ticks : 1);
+    s_next_frame_us += SYNTH_FRAME_PERIOD_US;
+  } else {
+    s_next_frame_us = now_us + SYNTH_FRAME_PERIOD_US;
+  }
+
+  if (slot->box_x >= 0) {
+    render_background(slot->data, slot->box_x, slot->box_y, SYNTH_BOX_SIDE, SYNTH_BOX_SIDE);
+  }
+  box_position(s_frame_number++, &slot->box_x, &slot->box_y);
+  render_box(slot->data, slot->box_x, slot->box_y);
+
+  slot->held = true;
+  buf->data = slot->data;
+  buf->bytesused = s_format.stride * s_config.height;
+  buf->index = (uint32_t)(slot - s_buffers);
+  return ESP_OK;
+}
+
+static esp_err_t synth_requeue(const camera_source_buffer_t *buf)
+{
+  ESP_RETURN_ON_FALSE(buf->index < s_format.buffer_count, ESP_ERR_INVALID_ARG, TAG, "Bad buffer index");
+  s_buffers[buf->index].held = false;
+  return ESP_OK;
+}
+
+static void render_background(uint8_t *frame, int x0, int y0, int w, int h)
+{
+  const size_t stride = (size_t)s_config.width * 2U;
+  const int bar_width = s_config.width / SYNTH_BAR_COUNT;
+  for (int y = y0; y < y0 + h; ++y) {
+    uint8_t *row = frame + (size_t)y * stride;
+    // Vertical ramp plus a fixed hash dither, so the JPEG has texture to code
+    // instead of flat fields that compress far better than a real scene.
+    const uint32_t ramp = (uint32_t)(y * 48) / s_config.height;
+    for (int x = x0; x < x0 + w; ++x) {
+      int bar = x / bar_width;
+      bar = bar < SYNTH_BAR_COUNT ? bar : SYNTH_BAR_COUNT - 1;
+      const uint32_t noise = (((uint32_t)x * 73856093U) ^ ((uint32_t)y * 19349663U)) >> 27;
+      const uint32_t add = ramp + noise;
+      put_rgb565(row + (size_t)x * 2U,
+                 s_bar_rgb[bar][0] + add,
+                 s_bar_rgb[bar][1] + add,
+                 s_bar_rgb[bar][2] + add);
+    }
+  }
+}
+
+static void render_box(uint8_t *frame, int x0, int y0)
+{
+  const size_t stride = (size_t)s_config.width * 2U;
+  for (int y = y0; y < y0 + SYNTH_BOX_SIDE; ++y) {
+    uint8_t *row = frame + (size_t)y * stride;
+    for (int x = x0; x < x0 + SYNTH_BOX_SIDE; ++x) {
+      const bool edge = (x - x0) < 4 || (y - y0) < 4 || (x - x0) >= SYNTH_BOX_SIDE - 4 || (y - y0) >= SYNTH_BOX_SIDE - 4;
+      put_rgb565(row + (size_t)x * 2U, 255, edge ? 0 : 255, edge ? 0 : 255);
+    }
+  }
+}
+
+static void box_position(uint32_t frame_number, int *x, int *y)
+{
+  // Bounce along both axes at slightly different rates so the path covers
+  // the frame instead of retracing one diagonal.
+  const int span_x = s_config.width - SYNTH_BOX_SIDE;
+  const int span_y = s_config.height - SYNTH_BOX_SIDE;
+  const int tx = (int)((frame_number * SYNTH_BOX_STEP) % (uint32_t)(span_x * 2));
+  const int ty = (int)((frame_number * (SYNTH_BOX_STEP - 2)) % (uint32_t)(span_y * 2));
+  *x = tx < span_x ? tx : span_x * 2 - tx;
+  *y = ty < span_y ? ty : span_y * 2 - ty;
+}
+
+static void put_rgb565(uint8_t *px, uint32_t r, uint32_t g, uint32_t b)
+{
+  r = r > 255U ? 255U : r;
+  g = g > 255U ? 255U : g;
+  b = b > 255U ? 255U : b;
+  const uint16_t v = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+  px[0] = (uint8_t)(v & 0xFF);
+  px[1] = (uint8_t)(v >> 8);
+}
@@ -0,0 +1,565 @@
+#include "streaming/camera_frame_source.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "driver/i2c_master.h"
+#include "esp_check.h"
+#include "esp_ldo_regulator.h"
+#include "esp_log.h"
+#include "esp_video_device.h"
+#include "esp_video_init.h"
+#include "sdkconfig.h"
+
+#include "bsp/esp32_p4_nano.h"
+
+#define TAG "camera_v4l2"
+
+#define CAMERA_V4L2_MAX_BUFFERS 4
+#define CAMERA_V4L2_STARTUP_SKIP_FRAMES 3
+#define CAMERA_V4L2_BUFFER_ALIGN 128
+#define CAMERA_V4L2_AE_TARGET 64
+#define CAMERA_V4L2_RED_BALANCE 800
+#define CAMERA_V4L2_BLUE_BALANCE 1600
+
+typedef struct {
+  void *start;
+  size_t length;
+} camera_mmap_buffer_t;
+
+static esp_ldo_channel_handle_t s_ldo_mipi_phy;
+static bool s_video_initialized;
+static int s_camera_fd = -1;
+static bool s_camera_streaming;
+static camera_source_config_t s_config;
+static camera_source_format_t s_format;
+static camera_mmap_buffer_t s_camera_buffers[CAMERA_V4L2_MAX_BUFFERS];
+
+static esp_err_t v4l2_open(const camera_source_config_t *config, camera_source_format_t *out);
+static void v4l2_close(void);
+static esp_err_t v4l2_start(void);
+static void v4l2_stop(void);
+static esp_err_t v4l2_dequeue(camera_source_buffer_t *buf);
+static esp_err_t v4l2_requeue(const camera_source_buffer_t *buf);
+static esp_err_t acquire_mipi_phy_ldo(void);
+static void release_mipi_phy_ldo(void);
+static esp_err_t init_video_framework(void);
+static void deinit_video_framework(void);
+static esp_err_t open_camera_device(void);
+static void close_camera_device(void);
+static esp_err_t select_camera_format(void);
+static esp_err_t apply_camera_tuning_controls(void);
+static esp_err_t apply_isp_balance_controls(void);
+static void apply_sensor_orientation(void);
+static void select_frame_path(void);
+static esp_err_t set_video_control(int fd, uint32_t ctrl_class, uint32_t id, int32_t value, const char *name);
+static esp_err_t allocate_camera_buffers(void);
+static esp_err_t skip_frames(size_t count);
+static size_t packed_stride(uint32_t pixfmt);
+static const char *pixfmt_name(uint32_t pixfmt);
+
+static const camera_frame_source_t s_source = {
+  .name = "v4l2",
+  .open = v4l2_open,
+  .close = v4l2_close,
+  .start = v4l2_start,
+  .stop = v4l2_stop,
+  .dequeue = v4l2_dequeue,
+  .requeue = v4l2_requeue,
+};
+
+const camera_frame_source_t *camera_frame_source_v4l2(void)
+{
+  return &s_source;
+}
+
+static esp_err_t v4l2_open(const camera_source_config_t *config, camera_source_format_t *out)
+{
+  ESP_RETURN_ON_FALSE(config->buffer_count > 0 && config->buffer_count <= CAMERA_V4L2_MAX_BUFFERS,
+                      ESP_ERR_INVALID_ARG,
+                      TAG,
+                      "Unsupported buffer count %zu",
+                      config->buffer_count);
+  s_config = *config;
+
+  esp_err_t err = acquire_mipi_phy_ldo();
+  if (err == ESP_OK) {
+    err = init_video_framework();
+  }
+  if (err == ESP_OK) {
+    err = open_camera_device();
+  }
+  if (err != ESP_OK) {
+    return err;
+  }
+  *out = s_format;
+  return ESP_OK;
+}
+
+static void v4l2_close(void)
+{
+  close_camera_device();
+  deinit_video_framework();
+  release_mipi_phy_ldo();
+}
+
+static esp_err_t v4l2_start(void)
+{
+  if (s_camera_streaming) {
+    return ESP_OK;
+  }
+
+  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (ioctl(s_camera_fd, VIDIOC_STREAMON, &type) != 0) {
+    ESP_LOGE(TAG, "VIDIOC_STREAMON failed: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+
+  s_camera_streaming = true;
+  return skip_frames(CAMERA_V4L2_STARTUP_SKIP_FRAMES);
+}
+
+static void v4l2_stop(void)
+{
+  if (s_camera_fd < 0 || !s_camera_streaming) {
+    return;
+  }
+
+  enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (ioctl(s_camera_fd, VIDIOC_STREAMOFF, &type) != 0 && errno != EINVAL) {
+    ESP_LOGW(TAG, "VIDIOC_STREAMOFF failed: %s", strerror(errno));
+  }
+
+  s_camera_streaming = false;
+}
+
+static esp_err_t v4l2_dequeue(camera_source_buffer_t *buf)
+{
+  struct v4l2_buffer v4l2_buf = {
+    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+    .memory = V4L2_MEMORY_MMAP,
+  };
+  if (ioctl(s_camera_fd, VIDIOC_DQBUF, &v4l2_buf) != 0) {
+    ESP_LOGE(TAG, "VIDIOC_DQBUF failed: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+
+  ESP_RETURN_ON_FALSE(v4l2_buf.index < s_format.buffer_count,
+                      ESP_ERR_INVALID_RESPONSE,
+                      TAG,
+                      "Camera buffer index overflow: %u",
+                      v4l2_buf.index);
+
+  buf->data = (const uint8_t *)s_camera_buffers[v4l2_buf.index].start;
+  buf->bytesused = v4l2_buf.bytesused;
+  buf->index = v4l2_buf.index;
+  return ESP_OK;
+}
+
+static esp_err_t v4l2_requeue(const camera_source_buffer_t *buf)
+{
+  struct v4l2_buffer v4l2_buf = {
+    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+    .memory = V4L2_MEMORY_MMAP,
+    .index = buf->index,
+  };
+  if (ioctl(s_camera_fd, VIDIOC_QBUF, &v4l2_buf) != 0) {
+    ESP_LOGE(TAG, "VIDIOC_QBUF failed: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t acquire_mipi_phy_ldo(void)
+{
+  if (s_ldo_mipi_phy != NULL) {
+    return ESP_OK;
+  }
+
+  esp_ldo_channel_config_t cfg = {
+    .chan_id = 3,
+    .voltage_mv = 2500,
+  };
+  esp_err_t err = esp_ldo_acquire_channel(&cfg, &s_ldo_mipi_phy);
+  if (err == ESP_ERR_INVALID_STATE) {
+    s_ldo_mipi_phy = NULL;
+    return ESP_OK;
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to acquire MIPI LDO: %s", esp_err_to_name(err));
+  }
+  return err;
+}
+
+static void release_mipi_phy_ldo(void)
+{
+  if (s_ldo_mipi_phy != NULL) {
+    esp_ldo_release_channel(s_ldo_mipi_phy);
+    s_ldo_mipi_phy = NULL;
+  }
+}
+
+static esp_err_t init_video_framework(void)
+{
+  if (s_video_initialized) {
+    return ESP_OK;
+  }
+
+  i2c_master_bus_handle_t i2c = bsp_i2c_get_handle();
+  ESP_RETURN_ON_FALSE(i2c != NULL, ESP_ERR_INVALID_STATE, TAG, "bsp_i2c_get_handle returned NULL");
+
+  esp_video_init_csi_config_t csi_cfg = {
+    .sccb_config = {
+      .init_sccb = false,
+      .i2c_handle = i2c,
+      .freq = 100000,
+    },
+    .reset_pin = -1,
+    .pwdn_pin = -1,
+    .dont_init_ldo = true,
+  };
+
+  esp_video_init_config_t video_cfg = {
+    .csi = &csi_cfg,
+  };
+
+  esp_err_t err = esp_video_init(&video_cfg);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "esp_video_init failed: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  s_video_initialized = true;
+  return ESP_OK;
+}
+
+static void deinit_video_framework(void)
+{
+  if (!s_video_initialized) {
+    return;
+  }
+
+  esp_err_t err = esp_video_deinit();
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "esp_video_deinit failed: %s", esp_err_to_name(err));
+    return;
+  }
+
+  s_video_initialized = false;
+}
+
+static esp_err_t open_camera_device(void)
+{
+  if (s_camera_fd >= 0) {
+    return ESP_OK;
+  }
+
+  s_camera_fd = open(ESP_VIDEO_MIPI_CSI_DEVICE_NAME, O_RDWR);
+  if (s_camera_fd < 0) {
+    ESP_LOGE(TAG, "Failed to open %s: %s", ESP_VIDEO_MIPI_CSI_DEVICE_NAME, strerror(errno));
+    return ESP_FAIL;
+  }
+
+  ESP_RETURN_ON_ERROR(select_camera_format(), TAG, "camera format negotiation failed");
+  esp_err_t tuning_err = apply_camera_tuning_controls();
+  if (tuning_err != ESP_OK) {
+    ESP_LOGW(TAG, "Camera tuning controls incomplete: %s", esp_err_to_name(tuning_err));
+  }
+  apply_sensor_orientation();
+  ESP_RETURN_ON_ERROR(allocate_camera_buffers(), TAG, "camera buffer allocation failed");
+  select_frame_path();
+
+  return ESP_OK;
+}
+
+static void close_camera_device(void)
+{
+  v4l2_stop();
+
+  for (size_t i = 0; i < s_format.buffer_count; ++i) {
+    if (s_camera_buffers[i].start != NULL && s_camera_buffers[i].length > 0) {
+      munmap(s_camera_buffers[i].start, s_camera_buffers[i].length);
+      s_camera_buffers[i].start = NULL;
+      s_camera_buffers[i].length = 0;
+    }
+  }
+  memset(&s_format, 0, sizeof(s_format));
+
+  if (s_camera_fd >= 0) {
+    close(s_camera_fd);
+    s_camera_fd = -1;
+  }
+}
+
+static esp_err_t select_camera_format(void)
+{
+  const uint32_t preferred_formats[] = {
+    V4L2_PIX_FMT_RGB565,
+    V4L2_PIX_FMT_RGB24,
+  };
+
+  uint32_t selected_format = 0;
+  for (size_t preferred = 0; preferred < sizeof(preferred_formats) / sizeof(preferred_formats[0]); ++preferred) {
+    for (uint32_t index = 0;; ++index) {
+      struct v4l2_fmtdesc fmt_desc = {
+        .index = index,
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+      };
+      if (ioctl(s_camera_fd, VIDIOC_ENUM_FMT, &fmt_desc) != 0) {
+        break;
+      }
+      if (fmt_desc.pixelformat == preferred_formats[preferred]) {
+        selected_format = fmt_desc.pixelformat;
+        break;
+      }
+    }
+    if (selected_format != 0) {
+      break;
+    }
+  }
+
+  ESP_RETURN_ON_FALSE(selected_format != 0,
+                      ESP_ERR_NOT_SUPPORTED,
+                      TAG,
+                      "No RGB capture format found");
+
+  struct v4l2_format fmt = {
+    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+  };
+  fmt.fmt.pix.width = s_config.width;
+  fmt.fmt.pix.height = s_config.height;
+  fmt.fmt.pix.pixelformat = selected_format;
+  fmt.fmt.pix.field = V4L2_FIELD_NONE;
+
+  if (ioctl(s_camera_fd, VIDIOC_S_FMT, &fmt) != 0) {
+    ESP_LOGE(TAG, "VIDIOC_S_FMT failed: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+
+  ESP_RETURN_ON_FALSE(fmt.fmt.pix.width == s_config.width && fmt.fmt.pix.height == s_config.height,
+                      ESP_ERR_INVALID_SIZE,
+                      TAG,
+                      "Camera format mismatch: got %ux%u",
+                      fmt.fmt.pix.width,
+                      fmt.fmt.pix.height);
+  ESP_RETURN_ON_FALSE(fmt.fmt.pix.pixelformat == selected_format,
+                      ESP_ERR_NOT_SUPPORTED,
+                      TAG,
+                      "Camera pixel format mismatch");
+
+  s_format.pixfmt = fmt.fmt.pix.pixelformat;
+  s_format.stride = fmt.fmt.pix.bytesperline;
+  if (s_format.stride < packed_stride(s_format.pixfmt)) {
+    s_format.stride = packed_stride(s_format.pixfmt);
+  }
+
+  ESP_LOGI(TAG,
+           "Camera ready (%ux%u pixfmt=%s stride=%zu frame_bytes=%u)",
+           s_config.width,
+           s_config.height,
+           pixfmt_name(s_format.pixfmt),
+           s_format.stride,
+           fmt.fmt.pix.sizeimage);
+  return ESP_OK;
+}
+
+static esp_err_t apply_camera_tuning_controls(void)
+{
+  esp_err_t err = set_video_control(s_camera_fd,
+                                    V4L2_CID_USER_CLASS,
+                                    V4L2_CID_EXPOSURE,
+                                    CAMERA_V4L2_AE_TARGET,
+                                    "AE target");
+
+  esp_err_t isp_err = apply_isp_balance_controls();
+  if (err != ESP_OK) {
+    return err;
+  }
+  if (isp_err != ESP_OK) {
+    return isp_err;
+  }
+
+  ESP_LOGI(TAG,
+           "Camera tuning applied (ae_target=%d red_balance=%d blue_balance=%d)",
+           CAMERA_V4L2_AE_TARGET,
+           CAMERA_V4L2_RED_BALANCE,
+           CAMERA_V4L2_BLUE_BALANCE);
+  return ESP_OK;
+}
+
+static esp_err_t apply_isp_balance_controls(void)
+{
+  int isp_fd = open(ESP_VIDEO_ISP1_DEVICE_NAME, O_RDWR);
+  if (isp_fd < 0) {
+    ESP_LOGW(TAG, "Failed to open %s for ISP tuning: %s", ESP_VIDEO_ISP1_DEVICE_NAME, strerror(errno));
+    return ESP_FAIL;
+  }
+
+  esp_err_t err = set_video_control(isp_fd,
+                                    V4L2_CID_USER_CLASS,
+                                    V4L2_CID_RED_BALANCE,
+                                    CAMERA_V4L2_RED_BALANCE,
+                                    "red balance");
+  esp_err_t blue_err = set_video_control(isp_fd,
+                                         V4L2_CID_USER_CLASS,
+                                         V4L2_CID_BLUE_BALANCE,
+                                         CAMERA_V4L2_BLUE_BALANCE,
+                                         "blue balance");
+
+  close(isp_fd);
+
+  if (err != ESP_OK) {
+    return err;
+  }
+  return blue_err;
+}
+
+static void apply_sensor_orientation(void)
+{
+  s_format.upright = false;
+#if CONFIG_THEO_CAMERA_ZERO_COPY
+  // The sensor is mounted upside down. Flipping both axes in the sensor gives
+  // the same image as the 180° software rotation without touching the frame.
+  esp_err_t err = set_video_control(s_camera_fd, V4L2_CID_USER_CLASS, V4L2_CID_HFLIP, 1, "hflip");
+  if (err != ESP_OK) {
+    return;
+  }
+  err = set_video_control(s_camera_fd, V4L2_CID_USER_CLASS, V4L2_CID_VFLIP, 1, "vflip");
+  if (err != ESP_OK) {
+    (void)set_video_control(s_camera_fd, V4L2_CID_USER_CLASS, V4L2_CID_HFLIP, 0, "hflip");
+    return;
+  }
+  s_format.upright = true;
+#endif
+}
+
+static void select_frame_path(void)
+{
+  const size_t packed = packed_stride(s_format.pixfmt);
+  const char *reason = NULL;
+  if (!s_format.upright) {
+    reason = "no_sensor_flip";
+  } else if (s_format.stride != packed) {
+    reason = "padded_stride";
+  } else {
+    for (size_t i = 0; i < s_format.buffer_count; ++i) {
+      if (((uintptr_t)s_camera_buffers[i].start % CAMERA_V4L2_BUFFER_ALIGN) != 0 ||
+          s_camera_buffers[i].length < packed * s_config.height) {
+        reason = "buffer_layout";
+        break;
+      }
+    }
+  }
+
+  s_format.zero_copy = (reason == NULL);
+  if (s_format.zero_copy) {
+    ESP_LOGI(TAG, "Snapshot path: zero-copy (sensor flip, JPEG reads capture buffers)");
+  } else {
+    ESP_LOGI(TAG, "Snapshot path: copy (reason=%s stride=%zu)", reason, s_format.stride);
+  }
+}
+
+static esp_err_t set_video_control(int fd, uint32_t ctrl_class, uint32_t id, int32_t value, const char *name)
+{
+  struct v4l2_ext_control control[1] = {
+    {
+      .id = id,
+      .value = value,
+    },
+  };
+  struct v4l2_ext_controls controls = {
+    .ctrl_class = ctrl_class,
+    .count = 1,
+    .controls = control,
+  };
+
+  if (ioctl(fd, VIDIOC_S_EXT_CTRLS, &controls) != 0) {
+    ESP_LOGW(TAG, "Failed to set %s=%ld: %s", name, (long)value, strerror(errno));
+    return ESP_FAIL;
+  }
+
+  return ESP_OK;
+}
+
+static esp_err_t allocate_camera_buffers(void)
+{
+  struct v4l2_requestbuffers req = {
+    .count = s_config.buffer_count,
+    .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+    .memory = V4L2_MEMORY_MMAP,
+  };
+
+  if (ioctl(s_camera_fd, VIDIOC_REQBUFS, &req) != 0) {
+    ESP_LOGE(TAG, "VIDIOC_REQBUFS failed: %s", strerror(errno));
+    return ESP_FAIL;
+  }
+
+  ESP_RETURN_ON_FALSE(req.count >= s_config.buffer_count && req.count <= CAMERA_V4L2_MAX_BUFFERS,
+                      ESP_ERR_NO_MEM,
+                      TAG,
+                      "Unusable camera buffer count %u",
+                      req.count);
+
+  s_format.buffer_count = req.count;
+  s_format.buffer_bytes = 0;
+  for (size_t i = 0; i < s_format.buffer_count; ++i) {
+    struct v4l2_buffer buf = {
+      .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+      .memory = V4L2_MEMORY_MMAP,
+      .index = i,
+    };
+
+    if (ioctl(s_camera_fd, VIDIOC_QUERYBUF, &buf) != 0) {
+      ESP_LOGE(TAG, "VIDIOC_QUERYBUF[%zu] failed: %s", i, strerror(errno));
+      return ESP_FAIL;
+    }
+
+    void *mapped = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, s_camera_fd, buf.m.offset);
+    if (mapped == MAP_FAILED) {
+      ESP_LOGE(TAG, "mmap[%zu] failed: %s", i, strerror(errno));
+      return ESP_ERR_NO_MEM;
+    }
+
+    s_camera_buffers[i].start = mapped;
+    s_camera_buffers[i].length = buf.length;
+    s_format.buffer_bytes += buf.length;
+
+    if (ioctl(s_camera_fd, VIDIOC_QBUF, &buf) != 0) {
+      ESP_LOGE(TAG, "VIDIOC_QBUF[%zu] failed: %s", i, strerror(errno));
+      return ESP_FAIL;
+    }
+  }
+
+  return ESP_OK;
+}
+
+static esp_err_t skip_frames(size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    camera_source_buffer_t buf;
+    ESP_RETURN_ON_ERROR(v4l2_dequeue(&buf), TAG, "startup skip failed");
+    ESP_RETURN_ON_ERROR(v4l2_requeue(&buf), TAG, "startup skip failed");
+  }
+  return ESP_OK;
+}
+
+static size_t packed_stride(uint32_t pixfmt)
+{
+  return (size_t)s_config.width * ((pixfmt == V4L2_PIX_FMT_RGB565) ? 2U : 3U);
+}
+
+static const char *pixfmt_name(uint32_t pixfmt)
+{
+  static char name[5];
+  name[0] = pixfmt & 0xFF;
+  name[1] = (pixfmt >> 8) & 0xFF;
+  name[2] = (pixfmt >> 16) & 0xFF;
+  name[3] = (pixfmt >> 24) & 0xFF;
+  name[4] = '\0';
+  return name;
+}
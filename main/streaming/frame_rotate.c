@@ -0,0 +1,146 @@
+#include "streaming/frame_rotate.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "frame_rotate word kernels assume a little-endian target"
+#endif
+
+static bool rows_word_aligned(const uint8_t *src_row, const uint8_t *dst_row);
+static uint32_t load_word(const uint8_t *p);
+static void store_word(uint8_t *p, uint32_t w);
+static void reverse_row_pixels(const uint8_t *src_row, uint8_t *dst_row, size_t width, size_t bytes_per_pixel);
+static void reverse_row_rgb565(const uint8_t *src_row, uint8_t *dst_row, size_t width);
+static void reverse_row_rgb24(const uint8_t *src_row, uint8_t *dst_row, size_t width);
+
+void frame_rotate180_rgb565(const uint8_t *src,
+                            size_t src_stride,
+                            uint8_t *dst,
+                            size_t dst_stride,
+                            size_t width,
+                            size_t height)
+{
+  for (size_t y = 0; y < height; ++y) {
+    reverse_row_rgb565(src + ((height - 1U - y) * src_stride), dst + (y * dst_stride), width);
+  }
+}
+
+void frame_rotate180_rgb24(const uint8_t *src,
+                           size_t src_stride,
+                           uint8_t *dst,
+                           size_t dst_stride,
+                           size_t width,
+                           size_t height)
+{
+  for (size_t y = 0; y < height; ++y) {
+    reverse_row_rgb24(src + ((height - 1U - y) * src_stride), dst + (y * dst_stride), width);
+  }
+}
+
+void frame_rotate180(const uint8_t *src,
+                     size_t src_stride,
+                     uint8_t *dst,
+                     size_t dst_stride,
+                     size_t width,
+                     size_t height,
+                     size_t bytes_per_pixel)
+{
+  if (bytes_per_pixel == 2U) {
+    frame_rotate180_rgb565(src, src_stride, dst, dst_stride, width, height);
+    return;
+  }
+  if (bytes_per_pixel == 3U) {
+    frame_rotate180_rgb24(src, src_stride, dst, dst_stride, width, height);
+    return;
+  }
+  for (size_t y = 0; y < height; ++y) {
+    reverse_row_pixels(src + ((height - 1U - y) * src_stride), dst + (y * dst_stride), width, bytes_per_pixel);
+  }
+}
+
+static bool rows_word_aligned(const uint8_t *src_row, const uint8_t *dst_row)
+{
+  return ((((uintptr_t)src_row) | ((uintptr_t)dst_row)) & 3U) == 0;
+}
+
+// memcpy keeps the access aliasing-safe; the alignment hint lets the compiler
+// emit a single lw/sw instead of byte loads on strict-alignment targets.
+static uint32_t load_word(const uint8_t *p)
+{
+  uint32_t w;
+  memcpy(&w, __builtin_assume_aligned(p, 4), sizeof(w));
+  return w;
+}
+
+static void store_word(uint8_t *p, uint32_t w)
+{
+  memcpy(__builtin_assume_aligned(p, 4), &w, sizeof(w));
+}
+
+static void reverse_row_pixels(const uint8_t *src_row, uint8_t *dst_row, size_t width, size_t bytes_per_pixel)
+{
+  const uint8_t *src = src_row + (width * bytes_per_pixel);
+  for (size_t x = 0; x < width; ++x) {
+    src -= bytes_per_pixel;
+    for (size_t b = 0; b < bytes_per_pixel; ++b) {
+      dst_row[b] = src[b];
+    }
+    dst_row += bytes_per_pixel;
+  }
+}
+
+static void reverse_row_rgb565(const uint8_t *src_row, uint8_t *dst_row, size_t width)
+{
+  if ((width & 1U) != 0 || !rows_word_aligned(src_row, dst_row)) {
+    reverse_row_pixels(src_row, dst_row, width, 2U);
+    return;
+  }
+
+  // Each word holds two pixels; walking source words backwards and swapping
+  // the halves reverses the row.
+  const uint8_t *src = src_row + (width * 2U);
+  size_t words = width / 2U;
+  for (; words >= 4U; words -= 4U) {
+    src -= 16;
+    const uint32_t w0 = load_word(src + 12);
+    const uint32_t w1 = load_word(src + 8);
+    const uint32_t w2 = load_word(src + 4);
+    const uint32_t w3 = load_word(src);
+    store_word(dst_row, (w0 >> 16) | (w0 << 16));
+    store_word(dst_row + 4, (w1 >> 16) | (w1 << 16));
+    store_word(dst_row + 8, (w2 >> 16) | (w2 << 16));
+    store_word(dst_row + 12, (w3 >> 16) | (w3 << 16));
+    dst_row += 16;
+  }
+  for (; words > 0; --words) {
+    src -= 4;
+    const uint32_t w = load_word(src);
+    store_word(dst_row, (w >> 16) | (w << 16));
+    dst_row += 4;
+  }
+}
+
+static void reverse_row_rgb24(const uint8_t *src_row, uint8_t *dst_row, size_t width)
+{
+  // Groups of four pixels (a b c d) span exactly three words. The group
+  // offsets are only word aligned when the row width is a multiple of four.
+  if ((width & 3U) != 0 || !rows_word_aligned(src_row, dst_row)) {
+    reverse_row_pixels(src_row, dst_row, width, 3U);
+    return;
+  }
+
+  const uint8_t *src = src_row + (width * 3U);
+  for (size_t groups = width / 4U; groups > 0; --groups) {
+    src -= 12;
+    // Little-endian bytes: w0 = a0 a1 a2 b0, w1 = b1 b2 c0 c1, w2 = c2 d0 d1 d2.
+    const uint32_t w0 = load_word(src);
+    const uint32_t w1 = load_word(src + 4);
+    const uint32_t w2 = load_word(src + 8);
+    // Output d c b a: o0 = d0 d1 d2 c0, o1 = c1 c2 b0 b1, o2 = b2 a0 a1 a2.
+    store_word(dst_row, (w2 >> 8) | ((w1 & 0x00FF0000U) << 8));
+    store_word(dst_row + 4, (w1 >> 24) | ((w2 & 0xFFU) << 8) | ((w0 >> 24) << 16) | (w1 << 24));
+    store_word(dst_row + 8, ((w1 >> 8) & 0xFFU) | (w0 << 8));
+    dst_row += 12;
+  }
+}
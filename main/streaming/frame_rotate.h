@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 180° rotation kernels for packed RGB frames.
+ *
+ * Each destination row is the source row at the mirrored y, written in
+ * reverse pixel order. When both rows are word aligned the kernels move
+ * whole 32-bit words (two RGB565 pixels, or four RGB24 pixels per three
+ * words); other layouts fall back to a per-pixel copy with identical output.
+ * Source and destination must not overlap.
+ */
+
+void frame_rotate180_rgb565(const uint8_t *src,
+                            size_t src_stride,
+                            uint8_t *dst,
+                            size_t dst_stride,
+                            size_t width,
+                            size_t height);
+
+void frame_rotate180_rgb24(const uint8_t *src,
+                           size_t src_stride,
+                           uint8_t *dst,
+                           size_t dst_stride,
+                           size_t width,
+                           size_t height);
+
+/**
+ * @brief Dispatches to the RGB565 (bytes_per_pixel == 2) or RGB24
+ *        (bytes_per_pixel == 3) kernel; other sizes use the per-pixel path.
+ */
+void frame_rotate180(const uint8_t *src,
+                     size_t src_stride,
+                     uint8_t *dst,
+                     size_t dst_stride,
+                     size_t width,
+                     size_t height,
+                     size_t bytes_per_pixel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,329 @@
+#include "streaming/frame_transform.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "streaming/frame_rotate.h"
+
+#if CONFIG_THEO_CAMERA_PPA
+#include "driver/ppa.h"
+#include "esp_log.h"
+
+#define TAG "frame_transform"
+
+static ppa_client_handle_t s_ppa_client;
+static bool s_ppa_fallback_logged;
+#endif
+
+typedef struct {
+  uint16_t crop_x;
+  uint16_t crop_y;
+  uint16_t crop_w;
+  uint16_t crop_h;
+  uint16_t scaled_w;
+  uint16_t scaled_h;
+  uint16_t out_w;
+  uint16_t out_h;
+  frame_rotation_t rotation;
+  bool mirror_x;
+  bool mirror_y;
+} transform_plan_t;
+
+static esp_err_t plan_transform(const frame_src_t *src,
+                                const frame_transform_op_t *op,
+                                const frame_dst_t *dst,
+                                transform_plan_t *plan);
+static void copy_pixel(const uint8_t *src, frame_pixfmt_t src_format, uint8_t *dst, frame_pixfmt_t dst_format);
+#if CONFIG_THEO_CAMERA_PPA
+static esp_err_t run_ppa(const frame_src_t *src, const transform_plan_t *plan, const frame_dst_t *dst);
+#endif
+
+esp_err_t frame_transform_init(void)
+{
+#if CONFIG_THEO_CAMERA_PPA
+  if (s_ppa_client != NULL) {
+    return ESP_OK;
+  }
+  ppa_client_config_t cfg = {
+    .oper_type = PPA_OPERATION_SRM,
+    .max_pending_trans_num = 1,
+  };
+  esp_err_t err = ppa_register_client(&cfg, &s_ppa_client);
+  if (err != ESP_OK) {
+    s_ppa_client = NULL;
+    ESP_LOGW(TAG, "PPA client unavailable, using software transforms: %s", esp_err_to_name(err));
+  }
+#endif
+  return ESP_OK;
+}
+
+void frame_transform_deinit(void)
+{
+#if CONFIG_THEO_CAMERA_PPA
+  if (s_ppa_client != NULL) {
+    ppa_unregister_client(s_ppa_client);
+    s_ppa_client = NULL;
+  }
+#endif
+}
+
+size_t frame_pixfmt_bytes_per_pixel(frame_pixfmt_t format)
+{
+  return (format == FRAME_PIXFMT_RGB565) ? 2U : 3U;
+}
+
+esp_err_t frame_transform_output_size(const frame_src_t *src,
+                                      const frame_transform_op_t *op,
+                                      uint16_t *out_width,
+                                      uint16_t *out_height)
+{
+  if (out_width == NULL || out_height == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  transform_plan_t plan;
+  esp_err_t err = plan_transform(src, op, NULL, &plan);
+  if (err != ESP_OK) {
+    return err;
+  }
+  *out_width = plan.out_w;
+  *out_height = plan.out_h;
+  return ESP_OK;
+}
+
+esp_err_t frame_transform_run(const frame_src_t *src,
+                              const frame_transform_op_t *op,
+                              const frame_dst_t *dst,
+                              frame_transform_backend_t *used_backend)
+{
+  transform_plan_t plan;
+  esp_err_t err = plan_transform(src, op, dst, &plan);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+#if CONFIG_THEO_CAMERA_PPA
+  if (s_ppa_client != NULL) {
+    err = run_ppa(src, &plan, dst);
+    if (err == ESP_OK) {
+      if (used_backend != NULL) {
+        *used_backend = FRAME_TRANSFORM_BACKEND_PPA;
+      }
+      return ESP_OK;
+    }
+    if (err != ESP_ERR_NOT_SUPPORTED && !s_ppa_fallback_logged) {
+      s_ppa_fallback_logged = true;
+      ESP_LOGW(TAG, "PPA transform failed, falling back to software: %s", esp_err_to_name(err));
+    }
+  }
+#endif
+
+  if (used_backend != NULL) {
+    *used_backend = FRAME_TRANSFORM_BACKEND_SW;
+  }
+  return frame_transform_run_sw(src, op, dst);
+}
+
+esp_err_t frame_transform_run_sw(const frame_src_t *src, const frame_transform_op_t *op, const frame_dst_t *dst)
+{
+  transform_plan_t plan;
+  esp_err_t err = plan_transform(src, op, dst, &plan);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  const size_t src_bpp = frame_pixfmt_bytes_per_pixel(src->format);
+  const size_t dst_bpp = frame_pixfmt_bytes_per_pixel(dst->format);
+  const size_t dst_stride = (size_t)plan.out_w * dst_bpp;
+  const uint8_t *block = src->data + ((size_t)plan.crop_y * src->stride) + ((size_t)plan.crop_x * src_bpp);
+  const bool unscaled = (plan.scaled_w == plan.crop_w);
+
+  if (unscaled && src->format == dst->format && !plan.mirror_x && !plan.mirror_y) {
+    if (plan.rotation == FRAME_ROTATE_180) {
+      frame_rotate180(block, src->stride, dst->data, dst_stride, plan.out_w, plan.out_h, src_bpp);
+      return ESP_OK;
+    }
+    if (plan.rotation == FRAME_ROTATE_0) {
+      for (size_t y = 0; y < plan.out_h; ++y) {
+        memcpy(dst->data + (y * dst_stride), block + (y * src->stride), dst_stride);
+      }
+      return ESP_OK;
+    }
+  }
+
+  // Generic path: map every output pixel back through mirror, rotation and
+  // scale to its source pixel.
+  const uint32_t scale = (uint32_t)op->scale_16ths;
+  for (uint32_t y = 0; y < plan.out_h; ++y) {
+    uint8_t *dst_px = dst->data + ((size_t)y * dst_stride);
+    const uint32_t my = plan.mirror_y ? (uint32_t)plan.out_h - 1U - y : y;
+    for (uint32_t x = 0; x < plan.out_w; ++x) {
+      const uint32_t mx = plan.mirror_x ? (uint32_t)plan.out_w - 1U - x : x;
+      uint32_t sx;
+      uint32_t sy;
+      switch (plan.rotation) {
+      case FRAME_ROTATE_90:
+        sx = my;
+        sy = (uint32_t)plan.scaled_h - 1U - mx;
+        break;
+      case FRAME_ROTATE_180:
+        sx = (uint32_t)plan.scaled_w - 1U - mx;
+        sy = (uint32_t)plan.scaled_h - 1U - my;
+        break;
+      case FRAME_ROTATE_270:
+        sx = (uint32_t)plan.scaled_w - 1U - my;
+        sy = mx;
+        break;
+      case FRAME_ROTATE_0:
+      default:
+        sx = mx;
+        sy = my;
+        break;
+      }
+      sx = (sx * FRAME_TRANSFORM_SCALE_ONE) / scale;
+      sy = (sy * FRAME_TRANSFORM_SCALE_ONE) / scale;
+      copy_pixel(block + ((size_t)sy * src->stride) + ((size_t)sx * src_bpp), src->format, dst_px, dst->format);
+      dst_px += dst_bpp;
+    }
+  }
+  return ESP_OK;
+}
+
+static esp_err_t plan_transform(const frame_src_t *src,
+                                const frame_transform_op_t *op,
+                                const frame_dst_t *dst,
+                                transform_plan_t *plan)
+{
+  if (src == NULL || src->data == NULL || op == NULL || plan == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (src->width == 0 || src->height == 0 ||
+      src->stride < (size_t)src->width * frame_pixfmt_bytes_per_pixel(src->format)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (op->scale_16ths == 0 || op->scale_16ths > FRAME_TRANSFORM_SCALE_ONE) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  plan->crop_x = op->crop_x;
+  plan->crop_y = op->crop_y;
+  plan->crop_w = (op->crop_w != 0) ? op->crop_w : src->width;
+  plan->crop_h = (op->crop_h != 0) ? op->crop_h : src->height;
+  if ((uint32_t)plan->crop_x + plan->crop_w > src->width || (uint32_t)plan->crop_y + plan->crop_h > src->height) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  const uint32_t scaled_w = (uint32_t)plan->crop_w * op->scale_16ths;
+  const uint32_t scaled_h = (uint32_t)plan->crop_h * op->scale_16ths;
+  if ((scaled_w % FRAME_TRANSFORM_SCALE_ONE) != 0 || (scaled_h % FRAME_TRANSFORM_SCALE_ONE) != 0) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  plan->scaled_w = (uint16_t)(scaled_w / FRAME_TRANSFORM_SCALE_ONE);
+  plan->scaled_h = (uint16_t)(scaled_h / FRAME_TRANSFORM_SCALE_ONE);
+
+  const bool quarter_turn = (op->rotation == FRAME_ROTATE_90 || op->rotation == FRAME_ROTATE_270);
+  plan->out_w = quarter_turn ? plan->scaled_h : plan->scaled_w;
+  plan->out_h = quarter_turn ? plan->scaled_w : plan->scaled_h;
+
+  // Mirroring both axes is a half turn, so fold it into the rotation; this
+  // keeps 180° and 0° on the fast paths.
+  plan->rotation = op->rotation;
+  plan->mirror_x = op->mirror_x;
+  plan->mirror_y = op->mirror_y;
+  if (plan->mirror_x && plan->mirror_y) {
+    plan->rotation = (frame_rotation_t)(((int)plan->rotation + 2) % 4);
+    plan->mirror_x = false;
+    plan->mirror_y = false;
+  }
+
+  if (dst != NULL) {
+    if (dst->data == NULL) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    const size_t needed = (size_t)plan->out_w * plan->out_h * frame_pixfmt_bytes_per_pixel(dst->format);
+    if (dst->size < needed) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+  }
+  return ESP_OK;
+}
+
+static void copy_pixel(const uint8_t *src, frame_pixfmt_t src_format, uint8_t *dst, frame_pixfmt_t dst_format)
+{
+  if (src_format == dst_format) {
+    dst[0] = src[0];
+    dst[1] = src[1];
+    if (src_format == FRAME_PIXFMT_RGB888) {
+      dst[2] = src[2];
+    }
+    return;
+  }
+
+  if (src_format == FRAME_PIXFMT_RGB565) {
+    // Replicate the high bits so full-scale 565 maps to 255.
+    const uint16_t px = (uint16_t)(src[0] | (src[1] << 8));
+    const uint8_t r = (uint8_t)((px >> 11) & 0x1F);
+    const uint8_t g = (uint8_t)((px >> 5) & 0x3F);
+    const uint8_t b = (uint8_t)(px & 0x1F);
+    dst[0] = (uint8_t)((r << 3) | (r >> 2));
+    dst[1] = (uint8_t)((g << 2) | (g >> 4));
+    dst[2] = (uint8_t)((b << 3) | (b >> 2));
+    return;
+  }
+
+  const uint16_t px = (uint16_t)(((src[0] & 0xF8U) << 8) | ((src[1] & 0xFCU) << 3) | (src[2] >> 3));
+  dst[0] = (uint8_t)(px & 0xFF);
+  dst[1] = (uint8_t)(px >> 8);
+}
+
+#if CONFIG_THEO_CAMERA_PPA
+static esp_err_t run_ppa(const frame_src_t *src, const transform_plan_t *plan, const frame_dst_t *dst)
+{
+  // Only offload what the SRM engine reproduces exactly. The PPA reads whole
+  // pictures, so padded source rows also stay in software.
+  const size_t bpp = frame_pixfmt_bytes_per_pixel(src->format);
+  const bool quarter_turn = (plan->rotation == FRAME_ROTATE_90 || plan->rotation == FRAME_ROTATE_270);
+  if (src->format != dst->format || plan->scaled_w != plan->crop_w || src->stride != (size_t)src->width * bpp ||
+      (quarter_turn && (plan->mirror_x || plan->mirror_y))) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  // PPA angles are counter-clockwise.
+  static const ppa_srm_rotation_angle_t angles[] = {
+    [FRAME_ROTATE_0] = PPA_SRM_ROTATION_ANGLE_0,
+    [FRAME_ROTATE_90] = PPA_SRM_ROTATION_ANGLE_270,
+    [FRAME_ROTATE_180] = PPA_SRM_ROTATION_ANGLE_180,
+    [FRAME_ROTATE_270] = PPA_SRM_ROTATION_ANGLE_90,
+  };
+  const ppa_srm_color_mode_t color_mode =
+      (src->format == FRAME_PIXFMT_RGB565) ? PPA_SRM_COLOR_MODE_RGB565 : PPA_SRM_COLOR_MODE_RGB888;
+
+  ppa_srm_oper_config_t cfg = {
+    .in = {
+      .buffer = src->data,
+      .pic_w = src->width,
+      .pic_h = src->height,
+      .block_w = plan->crop_w,
+      .block_h = plan->crop_h,
+      .block_offset_x = plan->crop_x,
+      .block_offset_y = plan->crop_y,
+      .srm_cm = color_mode,
+    },
+    .out = {
+      .buffer = dst->data,
+      .buffer_size = dst->size,
+      .pic_w = plan->out_w,
+      .pic_h = plan->out_h,
+      .block_offset_x = 0,
+      .block_offset_y = 0,
+      .srm_cm = color_mode,
+    },
+    .rotation_angle = angles[plan->rotation],
+    .scale_x = 1.0f,
+    .scale_y = 1.0f,
+    .mirror_x = plan->mirror_x,
+    .mirror_y = plan->mirror_y,
+    .mode = PPA_TRANS_MODE_BLOCKING,
+  };
+  return ppa_do_scale_rotate_mirror(s_ppa_client, &cfg);
+}
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Crop/scale/rotate/mirror/colour-convert stage for camera frames.
+ *
+ * The software path is the reference implementation and builds anywhere.
+ * With CONFIG_THEO_CAMERA_PPA the stage offloads what the P4 Pixel
+ * Processing Accelerator does bit-identically (same-format 1:1 crop, rotate
+ * and mirror) and runs everything else in software, so callers get the same
+ * pixels from either backend. Scaled ops stay in software because the PPA
+ * scaler's filter is not specified as nearest-neighbour.
+ *
+ * Operation order: crop the source block, scale it, rotate it clockwise,
+ * then mirror the rotated image. Scaling is nearest-neighbour downscale only.
+ */
+
+typedef enum {
+  FRAME_PIXFMT_RGB565 = 0, // little-endian 16-bit words, as V4L2_PIX_FMT_RGB565
+  FRAME_PIXFMT_RGB888,     // bytes R, G, B, as V4L2_PIX_FMT_RGB24
+} frame_pixfmt_t;
+
+typedef enum {
+  FRAME_ROTATE_0 = 0,
+  FRAME_ROTATE_90, // clockwise
+  FRAME_ROTATE_180,
+  FRAME_ROTATE_270,
+} frame_rotation_t;
+
+#define FRAME_TRANSFORM_SCALE_ONE (16) // scale_16ths value for 1:1
+
+typedef struct {
+  const uint8_t *data;
+  size_t stride; // bytes per row
+  uint16_t width;
+  uint16_t height;
+  frame_pixfmt_t format;
+} frame_src_t;
+
+typedef struct {
+  uint8_t *data; // rows are packed: stride = width * bytes per pixel
+  size_t size;   // capacity in bytes
+  frame_pixfmt_t format;
+} frame_dst_t;
+
+typedef struct {
+  uint16_t crop_x;
+  uint16_t crop_y;
+  uint16_t crop_w; // 0 = full source width
+  uint16_t crop_h; // 0 = full source height
+  uint8_t scale_16ths; // 1..16; crop_w/crop_h times this must divide by 16
+  frame_rotation_t rotation;
+  bool mirror_x;
+  bool mirror_y;
+} frame_transform_op_t;
+
+typedef enum {
+  FRAME_TRANSFORM_BACKEND_SW = 0,
+  FRAME_TRANSFORM_BACKEND_PPA,
+} frame_transform_backend_t;
+
+/**
+ * @brief Prepares the stage (registers the PPA client when enabled). Safe to
+ *        call again; the software path needs no setup.
+ */
+esp_err_t frame_transform_init(void);
+void frame_transform_deinit(void);
+
+/**
+ * @brief Computes the output size of op applied to src.
+ *
+ * @return ESP_ERR_INVALID_ARG if the crop leaves the source or the scale is
+ *         out of range, ESP_ERR_INVALID_SIZE if the scaled size is fractional.
+ */
+esp_err_t frame_transform_output_size(const frame_src_t *src,
+                                      const frame_transform_op_t *op,
+                                      uint16_t *out_width,
+                                      uint16_t *out_height);
+
+size_t frame_pixfmt_bytes_per_pixel(frame_pixfmt_t format);
+
+/**
+ * @brief Runs op on the best available backend.
+ *
+ * @param used_backend Optional; reports which backend produced dst.
+ */
+esp_err_t frame_transform_run(const frame_src_t *src,
+                              const frame_transform_op_t *op,
+                              const frame_dst_t *dst,
+                              frame_transform_backend_t *used_backend);
+
+/**
+ * @brief Runs op with the software reference path only.
+ */
+esp_err_t frame_transform_run_sw(const frame_src_t *src, const frame_transform_op_t *op, const frame_dst_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
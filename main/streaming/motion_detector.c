@@ -0,0 +1,106 @@
+#include "streaming/motion_detector.h"
+
+#include <string.h>
+
+static void sample_grid(const frame_src_t *src, uint8_t *grid);
+static uint8_t pixel_luma(const uint8_t *px, frame_pixfmt_t format);
+static uint16_t changed_permille(const uint8_t *current, const uint8_t *reference, uint8_t threshold);
+
+void motion_detector_init(motion_detector_t *det, const motion_detector_config_t *config)
+{
+  memset(det, 0, sizeof(*det));
+  det->config = *config;
+}
+
+bool motion_detector_update(motion_detector_t *det, const frame_src_t *src, uint16_t *out_changed_permille)
+{
+  sample_grid(src, det->current);
+  det->has_current = true;
+
+  uint16_t permille = 1000;
+  if (det->has_reference) {
+    permille = changed_permille(det->current, det->reference, det->config.cell_threshold);
+  }
+  if (out_changed_permille != NULL) {
+    *out_changed_permille = permille;
+  }
+  return permille >= det->config.area_permille;
+}
+
+void motion_detector_accept(motion_detector_t *det)
+{
+  if (!det->has_current) {
+    return;
+  }
+  memcpy(det->reference, det->current, sizeof(det->reference));
+  det->has_reference = true;
+}
+
+void motion_detector_reset(motion_detector_t *det)
+{
+  det->has_reference = false;
+  det->has_current = false;
+}
+
+static void sample_grid(const frame_src_t *src, uint8_t *grid)
+{
+  const size_t bytes_per_pixel = frame_pixfmt_bytes_per_pixel(src->format);
+  const uint32_t cell_w = src->width / MOTION_GRID_W;
+  const uint32_t cell_h = src->height / MOTION_GRID_H;
+  // Four samples per cell at the quarter points; enough to catch a person
+  // crossing the cell without reading every pixel.
+  const uint32_t dx0 = cell_w / 4U;
+  const uint32_t dx1 = (cell_w * 3U) / 4U;
+  const uint32_t dy0 = cell_h / 4U;
+  const uint32_t dy1 = (cell_h * 3U) / 4U;
+
+  for (uint32_t gy = 0; gy < MOTION_GRID_H; ++gy) {
+    const uint8_t *row0 = src->data + ((gy * cell_h + dy0) * src->stride);
+    const uint8_t *row1 = src->data + ((gy * cell_h + dy1) * src->stride);
+    for (uint32_t gx = 0; gx < MOTION_GRID_W; ++gx) {
+      const size_t x0 = (gx * cell_w + dx0) * bytes_per_pixel;
+      const size_t x1 = (gx * cell_w + dx1) * bytes_per_pixel;
+      const uint32_t sum = pixel_luma(row0 + x0, src->format) + pixel_luma(row0 + x1, src->format) +
+                           pixel_luma(row1 + x0, src->format) + pixel_luma(row1 + x1, src->format);
+      grid[gy * MOTION_GRID_W + gx] = (uint8_t)(sum >> 2);
+    }
+  }
+}
+
+static uint8_t pixel_luma(const uint8_t *px, frame_pixfmt_t format)
+{
+  uint32_t r;
+  uint32_t g;
+  uint32_t b;
+  if (format == FRAME_PIXFMT_RGB565) {
+    const uint32_t v = (uint32_t)px[0] | ((uint32_t)px[1] << 8);
+    r = ((v >> 11) & 0x1FU) << 3;
+    g = ((v >> 5) & 0x3FU) << 2;
+    b = (v & 0x1FU) << 3;
+  } else {
+    r = px[0];
+    g = px[1];
+    b = px[2];
+  }
+  // BT.601 weights in 1/256ths.
+  return (uint8_t)((r * 77U + g * 150U + b * 29U) >> 8);
+}
+
+static uint16_t changed_permille(const uint8_t *current, const uint8_t *reference, uint8_t threshold)
+{
+  int32_t sum_current = 0;
+  int32_t sum_reference = 0;
+  for (size_t i = 0; i < MOTION_GRID_CELLS; ++i) {
+    sum_current += current[i];
+    sum_reference += reference[i];
+  }
+  const int32_t offset = (sum_current - sum_reference) / MOTION_GRID_CELLS;
+
+  uint32_t changed = 0;
+  for (size_t i = 0; i < MOTION_GRID_CELLS; ++i) {
+    int32_t delta = (int32_t)current[i] - (int32_t)reference[i] - offset;
+    delta = delta < 0 ? -delta : delta;
+    changed += (delta > threshold) ? 1U : 0U;
+  }
+  return (uint16_t)((changed * 1000U) / MOTION_GRID_CELLS);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "streaming/frame_transform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Cheap scene-change detector for gating snapshot encodes.
+ *
+ * Each frame is reduced to a MOTION_GRID_W x MOTION_GRID_H luma grid (four
+ * samples averaged per cell, so a frame costs a few thousand pixel reads) and
+ * compared against the grid of the last accepted frame. The mean luma offset
+ * between the two grids is removed first, so exposure steps and the IR LED
+ * switching do not read as motion. A cell counts as changed when its
+ * remaining delta exceeds cell_threshold; the frame counts as motion when the
+ * changed share of cells reaches area_permille.
+ *
+ * Grids are flat uint8_t arrays so the compare loop is a straight byte-wise
+ * abs-diff/threshold/count that the compiler (or esp-dsp) can vectorise.
+ * The detector has no IDF dependencies and runs unchanged on a host.
+ */
+
+#define MOTION_GRID_W 32
+#define MOTION_GRID_H 32
+#define MOTION_GRID_CELLS (MOTION_GRID_W * MOTION_GRID_H)
+
+typedef struct {
+  uint8_t cell_threshold; // luma delta (0..255) a cell must exceed
+  uint16_t area_permille; // share of cells that must change, 1..1000
+} motion_detector_config_t;
+
+typedef struct {
+  motion_detector_config_t config;
+  uint8_t reference[MOTION_GRID_CELLS];
+  uint8_t current[MOTION_GRID_CELLS];
+  bool has_reference;
+  bool has_current;
+} motion_detector_t;
+
+void motion_detector_init(motion_detector_t *det, const motion_detector_config_t *config);
+
+/**
+ * @brief Samples src and compares it against the reference grid.
+ *
+ * Without a reference (first frame, or after motion_detector_reset) every
+ * frame reports motion.
+ *
+ * @param out_changed_permille Optional; share of changed cells in 1/1000.
+ * @return true if the frame differs enough from the reference.
+ */
+bool motion_detector_update(motion_detector_t *det, const frame_src_t *src, uint16_t *out_changed_permille);
+
+/**
+ * @brief Makes the last sampled frame the new reference. Call when that frame
+ *        is actually used, so slow changes accumulate until they trigger.
+ */
+void motion_detector_accept(motion_detector_t *det);
+
+void motion_detector_reset(motion_detector_t *det);
+
+#ifdef __cplusplus
+}
+#endif
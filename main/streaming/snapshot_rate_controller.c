@@ -0,0 +1,170 @@
+#include "streaming/snapshot_rate_controller.h"
+
+#include <string.h>
+
+#define SNAPSHOT_RATE_BACKOFF_MIN_PCT 25
+#define SNAPSHOT_RATE_BACKOFF_HOLD_US (2LL * 1000LL * 1000LL)
+#define SNAPSHOT_RATE_RECOVER_STEP_US (3LL * 1000LL * 1000LL)
+#define SNAPSHOT_RATE_RECOVER_STEP_PCT 10
+#define SNAPSHOT_RATE_OVER_PCT 110
+#define SNAPSHOT_RATE_UNDER_PCT 90
+#define SNAPSHOT_RATE_DOWNSCALE_FRAMES 3
+#define SNAPSHOT_RATE_UPSCALE_FRAMES 10
+#define SNAPSHOT_RATE_TIER_SWITCH_QUALITY 60
+// A half-resolution frame has a quarter of the pixels; JPEG size tracks that
+// (and, over the mid range, quality) closely enough to predict whether the
+// full tier would fit at the switch quality.
+#define SNAPSHOT_RATE_HALF_TO_FULL_BYTES 4U
+
+static bool is_congested(const snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in);
+static void update_backoff(snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in);
+static void update_quality(snapshot_rate_controller_t *ctl, uint32_t ratio_pct);
+static void update_tier(snapshot_rate_controller_t *ctl, size_t frame_bytes, size_t target_bytes, uint32_t ratio_pct);
+static uint8_t clamp_quality(int quality);
+
+void snapshot_rate_controller_init(snapshot_rate_controller_t *ctl,
+                                   uint32_t budget_bps,
+                                   uint32_t interval_ms,
+                                   bool allow_downscale)
+{
+  memset(ctl, 0, sizeof(*ctl));
+  ctl->enabled = budget_bps > 0 && interval_ms > 0;
+  ctl->allow_downscale = allow_downscale;
+  ctl->budget_bps = budget_bps;
+  ctl->interval_ms = interval_ms;
+  ctl->quality = SNAPSHOT_RATE_QUALITY_DEFAULT;
+  ctl->tier = SNAPSHOT_RATE_TIER_FULL;
+  ctl->backoff_pct = 100;
+}
+
+void snapshot_rate_controller_update(snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in)
+{
+  if (!ctl->enabled || in->frame_bytes == 0) {
+    return;
+  }
+
+  update_backoff(ctl, in);
+
+  const size_t target_bytes = snapshot_rate_controller_target_bytes(ctl);
+  if (target_bytes == 0) {
+    return;
+  }
+  uint64_t ratio = ((uint64_t)in->frame_bytes * 100U) / target_bytes;
+  const uint32_t ratio_pct = ratio > UINT32_MAX ? UINT32_MAX : (uint32_t)ratio;
+
+  update_quality(ctl, ratio_pct);
+  update_tier(ctl, in->frame_bytes, target_bytes, ratio_pct);
+}
+
+size_t snapshot_rate_controller_target_bytes(const snapshot_rate_controller_t *ctl)
+{
+  const uint64_t per_frame = ((uint64_t)ctl->budget_bps * ctl->interval_ms) / 1000U;
+  return (size_t)((per_frame * ctl->backoff_pct) / 100U);
+}
+
+uint8_t snapshot_rate_controller_scale_16ths(const snapshot_rate_controller_t *ctl)
+{
+  return ctl->tier == SNAPSHOT_RATE_TIER_HALF ? 8U : 16U;
+}
+
+static bool is_congested(const snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in)
+{
+  // A publish that takes most of the interval leaves no headroom for the next
+  // frame; treat it like a link-level drop.
+  const uint32_t slow_publish_us = (ctl->interval_ms * 1000U * 3U) / 4U;
+  return in->transport_congested || in->publish_failed || in->frame_dropped || in->publish_us > slow_publish_us;
+}
+
+static void update_backoff(snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in)
+{
+  if (is_congested(ctl, in)) {
+    ctl->recover_at_us = in->now_us + SNAPSHOT_RATE_RECOVER_STEP_US;
+    // One congestion episode usually shows up in several consecutive frames
+    // (and transport samples are coarser than frames); cut once per window.
+    if (in->now_us < ctl->hold_until_us) {
+      return;
+    }
+    int backoff = (ctl->backoff_pct * 3) / 4;
+    ctl->backoff_pct = (uint8_t)(backoff < SNAPSHOT_RATE_BACKOFF_MIN_PCT ? SNAPSHOT_RATE_BACKOFF_MIN_PCT : backoff);
+    ctl->hold_until_us = in->now_us + SNAPSHOT_RATE_BACKOFF_HOLD_US;
+    return;
+  }
+
+  if (ctl->backoff_pct >= 100) {
+    return;
+  }
+  if (ctl->recover_at_us == 0) {
+    ctl->recover_at_us = in->now_us + SNAPSHOT_RATE_RECOVER_STEP_US;
+    return;
+  }
+  if (in->now_us >= ctl->recover_at_us) {
+    int backoff = ctl->backoff_pct + SNAPSHOT_RATE_RECOVER_STEP_PCT;
+    ctl->backoff_pct = (uint8_t)(backoff > 100 ? 100 : backoff);
+    ctl->recover_at_us = in->now_us + SNAPSHOT_RATE_RECOVER_STEP_US;
+  }
+}
+
+static void update_quality(snapshot_rate_controller_t *ctl, uint32_t ratio_pct)
+{
+  // Overshoot is corrected faster than undershoot is reclaimed: a frame that
+  // is too big costs airtime now, one that is too small only costs detail.
+  if (ratio_pct > SNAPSHOT_RATE_OVER_PCT) {
+    uint32_t step = (ratio_pct - 100U) / 8U;
+    step = step < 1U ? 1U : (step > 10U ? 10U : step);
+    ctl->quality = clamp_quality((int)ctl->quality - (int)step);
+  } else if (ratio_pct < SNAPSHOT_RATE_UNDER_PCT) {
+    uint32_t step = (100U - ratio_pct) / 16U;
+    step = step < 1U ? 1U : (step > 4U ? 4U : step);
+    ctl->quality = clamp_quality((int)ctl->quality + (int)step);
+  }
+}
+
+static void update_tier(snapshot_rate_controller_t *ctl, size_t frame_bytes, size_t target_bytes, uint32_t ratio_pct)
+{
+  if (!ctl->allow_downscale) {
+    return;
+  }
+
+  if (ctl->tier == SNAPSHOT_RATE_TIER_FULL) {
+    if (ctl->quality > SNAPSHOT_RATE_QUALITY_MIN || ratio_pct <= SNAPSHOT_RATE_OVER_PCT) {
+      ctl->over_at_min_frames = 0;
+      return;
+    }
+    if (++ctl->over_at_min_frames < SNAPSHOT_RATE_DOWNSCALE_FRAMES) {
+      return;
+    }
+    ctl->tier = SNAPSHOT_RATE_TIER_HALF;
+    ctl->quality = SNAPSHOT_RATE_TIER_SWITCH_QUALITY;
+    ctl->over_at_min_frames = 0;
+    ctl->fits_full_frames = 0;
+    return;
+  }
+
+  if (ctl->quality < SNAPSHOT_RATE_TIER_SWITCH_QUALITY) {
+    ctl->fits_full_frames = 0;
+    return;
+  }
+  const uint64_t predicted_full =
+      ((uint64_t)frame_bytes * SNAPSHOT_RATE_HALF_TO_FULL_BYTES * SNAPSHOT_RATE_TIER_SWITCH_QUALITY) / ctl->quality;
+  if (predicted_full * 100U > (uint64_t)target_bytes * SNAPSHOT_RATE_UNDER_PCT) {
+    ctl->fits_full_frames = 0;
+    return;
+  }
+  if (++ctl->fits_full_frames < SNAPSHOT_RATE_UPSCALE_FRAMES) {
+    return;
+  }
+  ctl->tier = SNAPSHOT_RATE_TIER_FULL;
+  ctl->quality = SNAPSHOT_RATE_TIER_SWITCH_QUALITY;
+  ctl->fits_full_frames = 0;
+}
+
+static uint8_t clamp_quality(int quality)
+{
+  if (quality < SNAPSHOT_RATE_QUALITY_MIN) {
+    return SNAPSHOT_RATE_QUALITY_MIN;
+  }
+  if (quality > SNAPSHOT_RATE_QUALITY_MAX) {
+    return SNAPSHOT_RATE_QUALITY_MAX;
+  }
+  return (uint8_t)quality;
+}
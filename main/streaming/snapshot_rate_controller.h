@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Closed-loop JPEG quality / resolution controller for camera snapshots.
+ *
+ * Every encoded frame is compared against a per-frame byte target derived
+ * from the bytes-per-second budget and the snapshot interval. Quality steps
+ * down when frames overshoot and creeps back up when they undershoot, with a
+ * deadband so it settles instead of hunting. When quality bottoms out the
+ * controller drops to a half-resolution tier (if allowed) and returns to full
+ * resolution once the predicted full-size frame fits again.
+ *
+ * Congestion (transport drops or flow control, slow or failed publishes,
+ * stale frames dropped by the pipeline) shrinks the effective budget
+ * multiplicatively, at most once per hold window; clean periods grow it back
+ * additively.
+ */
+
+#define SNAPSHOT_RATE_QUALITY_MIN 30
+#define SNAPSHOT_RATE_QUALITY_MAX 90
+#define SNAPSHOT_RATE_QUALITY_DEFAULT 80
+
+typedef enum {
+  SNAPSHOT_RATE_TIER_FULL = 0,
+  SNAPSHOT_RATE_TIER_HALF,
+} snapshot_rate_tier_t;
+
+typedef struct {
+  size_t frame_bytes;       // JPEG size encoded at the current quality/tier
+  uint32_t publish_us;      // latest publish duration, 0 if none since last update
+  bool publish_failed;      // a publish failed since last update
+  bool frame_dropped;       // the pipeline overwrote a stale frame since last update
+  bool transport_congested; // link drops, flow control or TX throttling
+  int64_t now_us;
+} snapshot_rate_input_t;
+
+typedef struct {
+  bool enabled;
+  bool allow_downscale;
+  uint32_t budget_bps;
+  uint32_t interval_ms;
+  uint8_t quality;
+  snapshot_rate_tier_t tier;
+  uint8_t backoff_pct; // share of the budget currently allowed, 25..100
+  uint8_t over_at_min_frames;
+  uint8_t fits_full_frames;
+  int64_t hold_until_us;
+  int64_t recover_at_us;
+} snapshot_rate_controller_t;
+
+/**
+ * @brief Resets ctl. A budget of 0 disables the controller: quality stays at
+ *        SNAPSHOT_RATE_QUALITY_DEFAULT and the tier at full resolution.
+ */
+void snapshot_rate_controller_init(snapshot_rate_controller_t *ctl,
+                                   uint32_t budget_bps,
+                                   uint32_t interval_ms,
+                                   bool allow_downscale);
+
+/**
+ * @brief Feeds back one encoded frame and picks quality/tier for the next.
+ */
+void snapshot_rate_controller_update(snapshot_rate_controller_t *ctl, const snapshot_rate_input_t *in);
+
+/**
+ * @brief Per-frame byte target after congestion backoff.
+ */
+size_t snapshot_rate_controller_target_bytes(const snapshot_rate_controller_t *ctl);
+
+/**
+ * @brief Scale for the current tier in frame_transform 16ths.
+ */
+uint8_t snapshot_rate_controller_scale_16ths(const snapshot_rate_controller_t *ctl);
+
+#ifdef __cplusplus
+}
+#endif
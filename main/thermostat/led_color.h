@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 8-bit colour helpers shared by the LED engine (thermostat_leds.c), the
+ * effect program interpreter (led_program.c) and the hearth glow
+ * (led_hearth.c), so a built-in effect ported to a program keeps its exact
+ * colours. No IDF dependencies.
+ */
+
+// value * scale / 256, truncating (FastLED's scale8).
+static inline uint8_t led_scale8(uint8_t value, uint8_t scale)
+{
+  return (uint8_t)(((uint16_t)value * (uint16_t)scale) >> 8);
+}
+
+// Six-region HSV to RGB with hue 0..255 for a full turn; writes r, g, b.
+static inline void led_hsv_to_rgb(uint8_t hue, uint8_t saturation, uint8_t value, uint8_t *rgb)
+{
+  if (saturation == 0)
+  {
+    rgb[0] = value;
+    rgb[1] = value;
+    rgb[2] = value;
+    return;
+  }
+
+  uint8_t region = hue / 43;
+  uint8_t remainder = (hue - (region * 43)) * 6;
+  uint8_t p = led_scale8(value, (uint8_t)(255 - saturation));
+  uint8_t q = led_scale8(value, (uint8_t)(255 - led_scale8(saturation, remainder)));
+  uint8_t t = led_scale8(value, (uint8_t)(255 - led_scale8(saturation, (uint8_t)(255 - remainder))));
+
+  switch (region)
+  {
+    case 0:
+      rgb[0] = value;
+      rgb[1] = t;
+      rgb[2] = p;
+      break;
+    case 1:
+      rgb[0] = q;
+      rgb[1] = value;
+      rgb[2] = p;
+      break;
+    case 2:
+      rgb[0] = p;
+      rgb[1] = value;
+      rgb[2] = t;
+      break;
+    case 3:
+      rgb[0] = p;
+      rgb[1] = q;
+      rgb[2] = value;
+      break;
+    case 4:
+      rgb[0] = t;
+      rgb[1] = p;
+      rgb[2] = value;
+      break;
+    default:
+      rgb[0] = value;
+      rgb[1] = p;
+      rgb[2] = q;
+      break;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,193 @@
+#include "thermostat/led_hearth.h"
+
+#include <stdbool.h>
+
+#include "thermostat/led_color.h"
+
+// Parameters from scratch/hearth_glow/hearth_glow.ino. Coordinates are 8.8
+// lattice units, as in inoise8().
+#define LH_NOISE_SCALE      (60)
+#define LH_NOISE_SPEED      (3)     // per sketch frame
+#define LH_FRAME_US         (30000)
+#define LH_PHASE_SCALE      (10)
+#define LH_MIN_BRIGHTNESS   (40)
+#define LH_MAX_BRIGHTNESS   (255)
+#define LH_FLICKER_SCALE    (120)
+#define LH_FLICKER_OFFSET   (1000)
+#define LH_FLICKER_SPEED    (7)
+#define LH_FLICKER_PHASE    (50)
+#define LH_FLICKER_AMOUNT   (50)
+#define LH_HUE_OFFSET       (500)
+#define LH_HUE_MIN          (0)
+#define LH_HUE_MAX          (28)
+#define LH_SAT_OFFSET       (2000)
+#define LH_SAT_MIN          (200)
+#define LH_SAT_MAX          (255)
+#define LH_PERM_SEED        (0x68656172u)
+
+// Lattice values; lattice(x, y) = s_perm[s_perm[x] + y], both wrapping at 256.
+static uint8_t s_perm[256];
+// Quintic fade 6t^5 - 15t^4 + 10t^3 of frac / 256, scaled to 0..256.
+static uint16_t s_fade[256];
+// The sketch's map() calls, indexed by noise value.
+static uint8_t s_level[256];
+static uint8_t s_flicker_cut[256];
+static uint8_t s_saturation[256];
+// Fully saturated colour for each hue noise value.
+static uint8_t s_hue_rgb[256][3];
+// Fields whose x does not depend on the pixel's phase.
+static led_hearth_column_t s_flicker_cols[LED_HEARTH_MAX_PIXELS];
+static led_hearth_column_t s_hue_cols[LED_HEARTH_MAX_PIXELS];
+static led_hearth_column_t s_sat_cols[LED_HEARTH_MAX_PIXELS];
+static bool s_tables_built;
+
+static led_hearth_column_t make_column(uint16_t x);
+static uint8_t sample(const led_hearth_column_t *column, uint16_t y);
+static uint8_t lerp8(uint8_t a, uint8_t b, uint16_t weight);
+static uint8_t arduino_map(uint8_t value, uint8_t out_min, uint8_t out_max);
+static uint32_t xorshift32(uint32_t *state);
+
+void led_hearth_build_tables(void)
+{
+  if (s_tables_built)
+  {
+    return;
+  }
+
+  // A fixed seed keeps the field identical across boots and on the host.
+  uint32_t state = LH_PERM_SEED;
+  for (int i = 0; i < 256; ++i)
+  {
+    s_perm[i] = (uint8_t)i;
+  }
+  for (int i = 255; i > 0; --i)
+  {
+    int j = (int)(xorshift32(&state) % (uint32_t)(i + 1));
+    uint8_t tmp = s_perm[i];
+    s_perm[i] = s_perm[j];
+    s_perm[j] = tmp;
+  }
+
+  for (int i = 0; i < 256; ++i)
+  {
+    // t = i / 256 in Q8; 6t^5 - 15t^4 + 10t^3 = t^3 (t (6t - 15) + 10).
+    int64_t t = i;
+    int64_t inner = (t * (6 * t - 15 * 256)) / 256 + 10 * 256;
+    int64_t fade = (t * t * t * inner + (1 << 23)) >> 24;
+    s_fade[i] = (uint16_t)((fade > 256) ? 256 : fade);
+
+    s_level[i] = arduino_map((uint8_t)i, LH_MIN_BRIGHTNESS, LH_MAX_BRIGHTNESS);
+    s_flicker_cut[i] = arduino_map((uint8_t)i, 0, LH_FLICKER_AMOUNT);
+    s_saturation[i] = arduino_map((uint8_t)i, LH_SAT_MIN, LH_SAT_MAX);
+
+    // FastLED's rainbow hue wheel, red-to-orange section (hues 0-31).
+    uint8_t hue = arduino_map((uint8_t)i, LH_HUE_MIN, LH_HUE_MAX);
+    uint8_t third = led_scale8((uint8_t)((hue & 0x1F) << 3), 85);
+    s_hue_rgb[i][0] = (uint8_t)(255 - third);
+    s_hue_rgb[i][1] = third;
+    s_hue_rgb[i][2] = 0;
+  }
+
+  for (int px = 0; px < LED_HEARTH_MAX_PIXELS; ++px)
+  {
+    s_flicker_cols[px] = make_column((uint16_t)(px * LH_FLICKER_SCALE + LH_FLICKER_OFFSET));
+    s_hue_cols[px] = make_column((uint16_t)(px * LH_NOISE_SCALE / 2 + LH_HUE_OFFSET));
+    s_sat_cols[px] = make_column((uint16_t)(px * LH_NOISE_SCALE / 3 + LH_SAT_OFFSET));
+  }
+  s_tables_built = true;
+}
+
+void led_hearth_init(led_hearth_t *hearth, size_t count, uint32_t seed)
+{
+  led_hearth_build_tables();
+  if (count > LED_HEARTH_MAX_PIXELS)
+  {
+    count = LED_HEARTH_MAX_PIXELS;
+  }
+  hearth->count = count;
+
+  uint32_t state = seed ? seed : LH_PERM_SEED;
+  for (size_t px = 0; px < count; ++px)
+  {
+    hearth->phase[px] = (uint8_t)xorshift32(&state);
+    hearth->glow[px] = make_column((uint16_t)(px * LH_NOISE_SCALE + hearth->phase[px] * LH_PHASE_SCALE));
+  }
+}
+
+void led_hearth_render(const led_hearth_t *hearth, int64_t elapsed_us, uint8_t *rgb)
+{
+  if (elapsed_us < 0)
+  {
+    elapsed_us = 0;
+  }
+  // The sketch's noiseTime and the field offsets derived from it. They wrap
+  // with the lattice at 65536.
+  const int64_t time = elapsed_us * LH_NOISE_SPEED / LH_FRAME_US;
+  const uint16_t glow_y = (uint16_t)time;
+  const uint16_t flicker_y = (uint16_t)(time * LH_FLICKER_SPEED / LH_NOISE_SPEED);
+  const uint16_t hue_y = (uint16_t)(time / 2);
+  const uint16_t sat_y = (uint16_t)(time / 3);
+
+  for (size_t px = 0; px < hearth->count; ++px)
+  {
+    uint8_t glow = sample(&hearth->glow[px], glow_y);
+    uint8_t flicker =
+        sample(&s_flicker_cols[px], (uint16_t)(flicker_y + hearth->phase[px] * LH_FLICKER_PHASE));
+    uint8_t level = s_level[glow];
+    uint8_t cut = s_flicker_cut[flicker];
+    // The sketch only falls back to the floor when the cut exceeds the level,
+    // which still lets a pixel drop to 1; the floor is applied to the result.
+    uint8_t value = (level > cut + LH_MIN_BRIGHTNESS) ? (uint8_t)(level - cut) : LH_MIN_BRIGHTNESS;
+
+    const uint8_t *hue = s_hue_rgb[sample(&s_hue_cols[px], hue_y)];
+    uint8_t saturation = s_saturation[sample(&s_sat_cols[px], sat_y)];
+    for (int c = 0; c < 3; ++c)
+    {
+      // Desaturating moves each channel toward white before scaling by value.
+      uint8_t white = led_scale8(saturation, (uint8_t)(255 - hue[c]));
+      rgb[px * 3 + c] = led_scale8(value, (uint8_t)(255 - white));
+    }
+  }
+}
+
+static led_hearth_column_t make_column(uint16_t x)
+{
+  uint8_t xi = (uint8_t)(x >> 8);
+  led_hearth_column_t column = {
+      .hash0 = s_perm[xi],
+      .hash1 = s_perm[(uint8_t)(xi + 1)],
+      .fade = s_fade[x & 0xFF],
+  };
+  return column;
+}
+
+static uint8_t sample(const led_hearth_column_t *column, uint16_t y)
+{
+  uint8_t yi = (uint8_t)(y >> 8);
+  uint16_t fade_y = s_fade[y & 0xFF];
+  uint8_t a = s_perm[(uint8_t)(column->hash0 + yi)];
+  uint8_t b = s_perm[(uint8_t)(column->hash1 + yi)];
+  uint8_t c = s_perm[(uint8_t)(column->hash0 + yi + 1)];
+  uint8_t d = s_perm[(uint8_t)(column->hash1 + yi + 1)];
+  return lerp8(lerp8(a, b, column->fade), lerp8(c, d, column->fade), fade_y);
+}
+
+static uint8_t lerp8(uint8_t a, uint8_t b, uint16_t weight)
+{
+  return (uint8_t)(a + (((int32_t)b - (int32_t)a) * (int32_t)weight >> 8));
+}
+
+static uint8_t arduino_map(uint8_t value, uint8_t out_min, uint8_t out_max)
+{
+  return (uint8_t)(value * (out_max - out_min) / 255 + out_min);
+}
+
+static uint32_t xorshift32(uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
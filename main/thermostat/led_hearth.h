@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hearth glow: firelight from layered 2D noise (scratch/hearth_glow).
+ *
+ * Each pixel samples four noise fields per tick: a slow glow that sets its
+ * brightness above a floor, a faster flicker that takes some of it away, and
+ * two slow fields for hue (deep red to orange) and saturation. A random
+ * per-pixel phase keeps neighbours from breathing in step.
+ *
+ * The sketch calls FastLED's inoise8() four times per pixel. Here the noise is
+ * value noise over a 256x256 lattice drawn from a fixed permutation table,
+ * smoothed with a tabulated quintic fade and interpolated in 8-bit fixed
+ * point. Coordinates keep the sketch's 8.8 units, so its scale and speed
+ * constants carry over. The map() calls and the hue-to-colour conversion are
+ * tables too, which leaves a handful of lookups and three lerps per sample.
+ *
+ * The module has no IDF dependencies; scripts/led_hearth_bench.c times it on
+ * a host.
+ */
+
+#define LED_HEARTH_MAX_PIXELS 64
+
+typedef struct
+{
+  // Lattice hashes of the columns either side of x and the fade weight
+  // between them; x never changes for a pixel, so these are set up once.
+  uint8_t hash0;
+  uint8_t hash1;
+  uint16_t fade;  // 0..256
+} led_hearth_column_t;
+
+typedef struct
+{
+  size_t count;
+  uint8_t phase[LED_HEARTH_MAX_PIXELS];
+  // The glow field is the only one whose x depends on the random phase.
+  led_hearth_column_t glow[LED_HEARTH_MAX_PIXELS];
+} led_hearth_t;
+
+/**
+ * @brief Builds the shared noise, fade and colour tables. Idempotent.
+ */
+void led_hearth_build_tables(void);
+
+/**
+ * @brief Draws per-pixel phases from seed.
+ *
+ * @param count Pixels to render, at most LED_HEARTH_MAX_PIXELS.
+ */
+void led_hearth_init(led_hearth_t *hearth, size_t count, uint32_t seed);
+
+/**
+ * @brief Renders the frame elapsed_us into the effect.
+ *
+ * @param rgb count x 3 bytes, written in R, G, B order, at full brightness.
+ */
+void led_hearth_render(const led_hearth_t *hearth, int64_t elapsed_us, uint8_t *rgb);
+
+#ifdef __cplusplus
+}
+#endif
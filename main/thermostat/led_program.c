@@ -0,0 +1,454 @@
+#include "thermostat/led_program.h"
+
+#include <string.h>
+
+#include "thermostat/led_color.h"
+
+#define LP_Q16_ONE (65536)
+#define LP_OP_TABLE_SIZE (LED_OP_HSV + 1)
+
+typedef struct
+{
+  uint8_t pops;
+  uint8_t pushes;
+  uint8_t cost;  // 0 marks an unused opcode
+  uint8_t imm_bytes;
+} lp_op_info_t;
+
+// Costs are relative per-pixel weights, calibrated on a host against ADD
+// (see docs/manual-test-plan.md, "LED Effect Programs").
+static const lp_op_info_t s_ops[LP_OP_TABLE_SIZE] = {
+    [LED_OP_PUSH] = {0, 1, 1, 2},
+    [LED_OP_POS] = {0, 1, 1, 0},
+    [LED_OP_INDEX] = {0, 1, 1, 0},
+    [LED_OP_TIME] = {0, 1, 1, 0},
+    [LED_OP_PHASE] = {0, 1, 1, 0},
+    [LED_OP_HASH] = {0, 1, 1, 0},
+    [LED_OP_TRACK] = {0, 1, 1, 1},
+    [LED_OP_ADD] = {2, 1, 1, 0},
+    [LED_OP_SUB] = {2, 1, 1, 0},
+    [LED_OP_MUL] = {2, 1, 1, 0},
+    [LED_OP_MIN] = {2, 1, 1, 0},
+    [LED_OP_MAX] = {2, 1, 1, 0},
+    [LED_OP_ABS] = {1, 1, 1, 0},
+    [LED_OP_FRAC] = {1, 1, 1, 0},
+    [LED_OP_CLAMP] = {1, 1, 1, 0},
+    [LED_OP_DUP] = {1, 2, 1, 0},
+    [LED_OP_SWAP] = {2, 2, 1, 0},
+    [LED_OP_MIX] = {3, 1, 3, 0},
+    [LED_OP_SMOOTH] = {1, 1, 2, 0},
+    [LED_OP_WAVE] = {1, 1, 2, 0},
+    [LED_OP_BUMP] = {1, 1, 2, 0},
+    [LED_OP_NOISE] = {2, 1, 6, 0},
+    [LED_OP_RGB] = {3, 0, 3, 0},
+    [LED_OP_HSV] = {3, 0, 4, 0},
+};
+
+static bool parse_tracks(led_program_t *out, const uint8_t *data, size_t len, size_t *offset,
+                         const char **error);
+static bool verify_code(led_program_t *out, uint16_t max_cost, const char **error);
+static int32_t sample_track(const led_program_t *program, uint8_t track, uint32_t loop_ms);
+static uint32_t hash32(uint32_t x);
+static int32_t wrap_add(int32_t a, int32_t b);
+static int32_t wrap_sub(int32_t a, int32_t b);
+static int32_t mul_q16(int32_t a, int32_t b);
+static int32_t abs_q16(int32_t a);
+static int32_t smooth_q16(int32_t t);
+static int32_t value_noise(int32_t x, int32_t y);
+static uint8_t unit_to_u8(int32_t q);
+
+static uint16_t read_u16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool led_program_load(led_program_t *out, const uint8_t *data, size_t len, uint16_t max_cost,
+                      const char **out_error)
+{
+  const char *error = NULL;
+  const char **err = out_error ? out_error : &error;
+  memset(out, 0, sizeof(*out));
+
+  if (data == NULL || len < LED_PROGRAM_HEADER_BYTES || data[0] != 'L' || data[1] != 'P')
+  {
+    *err = "bad header";
+    return false;
+  }
+  if (data[2] != LED_PROGRAM_VERSION)
+  {
+    *err = "unsupported version";
+    return false;
+  }
+  out->track_count = data[3];
+  out->period_ms = read_u16(&data[4]);
+  out->code_len = read_u16(&data[6]);
+  if (out->track_count > LED_PROGRAM_MAX_TRACKS)
+  {
+    *err = "too many tracks";
+    return false;
+  }
+  if (out->code_len == 0 || out->code_len > LED_PROGRAM_MAX_CODE)
+  {
+    *err = "bad code length";
+    return false;
+  }
+
+  size_t offset = LED_PROGRAM_HEADER_BYTES;
+  if (!parse_tracks(out, data, len, &offset, err))
+  {
+    return false;
+  }
+  if (len - offset != out->code_len)
+  {
+    *err = "length mismatch";
+    return false;
+  }
+  memcpy(out->code, &data[offset], out->code_len);
+  return verify_code(out, max_cost, err);
+}
+
+static bool parse_tracks(led_program_t *out, const uint8_t *data, size_t len, size_t *offset,
+                         const char **error)
+{
+  for (uint8_t t = 0; t < out->track_count; ++t)
+  {
+    if (*offset >= len)
+    {
+      *error = "truncated track";
+      return false;
+    }
+    uint8_t keys = data[(*offset)++];
+    if (keys == 0 || keys > LED_PROGRAM_MAX_KEYS || len - *offset < (size_t)keys * 4U)
+    {
+      *error = "bad key count";
+      return false;
+    }
+    for (uint8_t k = 0; k < keys; ++k)
+    {
+      led_program_key_t *key = &out->keys[t][k];
+      key->time_ms = read_u16(&data[*offset]);
+      key->value = (int16_t)read_u16(&data[*offset + 2]);
+      *offset += 4;
+      // Strictly increasing, so no segment has zero length.
+      if (k > 0 && key->time_ms <= out->keys[t][k - 1].time_ms)
+      {
+        *error = "key times not increasing";
+        return false;
+      }
+    }
+    out->key_count[t] = keys;
+  }
+  return true;
+}
+
+// Code is straight-line, so one pass gives the exact stack depth at every
+// instruction and the exact per-pixel cost.
+static bool verify_code(led_program_t *out, uint16_t max_cost, const char **error)
+{
+  uint32_t cost = 0;
+  int depth = 0;
+  bool writes = false;
+  for (uint16_t pc = 0; pc < out->code_len;)
+  {
+    uint8_t op = out->code[pc];
+    if (op >= LP_OP_TABLE_SIZE || s_ops[op].cost == 0)
+    {
+      *error = "unknown opcode";
+      return false;
+    }
+    const lp_op_info_t *info = &s_ops[op];
+    if (pc + 1U + info->imm_bytes > out->code_len)
+    {
+      *error = "truncated operand";
+      return false;
+    }
+    if (op == LED_OP_TRACK && out->code[pc + 1] >= out->track_count)
+    {
+      *error = "track out of range";
+      return false;
+    }
+    if (depth < info->pops)
+    {
+      *error = "stack underflow";
+      return false;
+    }
+    depth += info->pushes - info->pops;
+    if (depth > LED_PROGRAM_STACK_DEPTH)
+    {
+      *error = "stack overflow";
+      return false;
+    }
+    writes = writes || op == LED_OP_RGB || op == LED_OP_HSV;
+    cost += info->cost;
+    pc += 1U + info->imm_bytes;
+  }
+  if (depth != 0)
+  {
+    *error = "values left on stack";
+    return false;
+  }
+  if (!writes)
+  {
+    *error = "no output";
+    return false;
+  }
+  if (cost > max_cost)
+  {
+    *error = "over cost budget";
+    return false;
+  }
+  out->cost = (uint16_t)cost;
+  return true;
+}
+
+void led_program_render(const led_program_t *program, int64_t elapsed_us, const int32_t *positions,
+                        size_t count, uint8_t *rgb)
+{
+  if (elapsed_us < 0)
+  {
+    elapsed_us = 0;
+  }
+  int64_t elapsed_ms = elapsed_us / 1000;
+  uint32_t loop_ms;
+  int32_t phase = 0;
+  if (program->period_ms > 0)
+  {
+    loop_ms = (uint32_t)(elapsed_ms % program->period_ms);
+    phase = (int32_t)(((uint32_t)loop_ms << 16) / program->period_ms);
+  }
+  else
+  {
+    loop_ms = elapsed_ms > UINT16_MAX ? UINT16_MAX : (uint32_t)elapsed_ms;
+  }
+  const int32_t time = (int32_t)(uint32_t)(((uint64_t)elapsed_us << 16) / 1000000U);
+
+  int32_t tracks[LED_PROGRAM_MAX_TRACKS];
+  for (uint8_t t = 0; t < program->track_count; ++t)
+  {
+    tracks[t] = sample_track(program, t, loop_ms);
+  }
+  const uint32_t index_span = count > 1 ? (uint32_t)(count - 1) : 1U;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    int32_t stack[LED_PROGRAM_STACK_DEPTH];
+    int sp = 0;
+    uint8_t *px = &rgb[i * 3];
+    px[0] = 0;
+    px[1] = 0;
+    px[2] = 0;
+
+    for (uint16_t pc = 0; pc < program->code_len;)
+    {
+      const uint8_t op = program->code[pc++];
+      switch (op)
+      {
+        case LED_OP_PUSH:
+          stack[sp++] = (int32_t)(int16_t)read_u16(&program->code[pc]) * 256;
+          pc += 2;
+          break;
+        case LED_OP_POS:
+          stack[sp++] = positions[i];
+          break;
+        case LED_OP_INDEX:
+          stack[sp++] = (int32_t)(((uint32_t)i << 16) / index_span);
+          break;
+        case LED_OP_TIME:
+          stack[sp++] = time;
+          break;
+        case LED_OP_PHASE:
+          stack[sp++] = phase;
+          break;
+        case LED_OP_HASH:
+          stack[sp++] = (int32_t)(hash32((uint32_t)i + 0x9E3779B9U) & 0xFFFFU);
+          break;
+        case LED_OP_TRACK:
+          stack[sp++] = tracks[program->code[pc++]];
+          break;
+        case LED_OP_ADD:
+          sp--;
+          stack[sp - 1] = wrap_add(stack[sp - 1], stack[sp]);
+          break;
+        case LED_OP_SUB:
+          sp--;
+          stack[sp - 1] = wrap_sub(stack[sp - 1], stack[sp]);
+          break;
+        case LED_OP_MUL:
+          sp--;
+          stack[sp - 1] = mul_q16(stack[sp - 1], stack[sp]);
+          break;
+        case LED_OP_MIN:
+          sp--;
+          stack[sp - 1] = stack[sp] < stack[sp - 1] ? stack[sp] : stack[sp - 1];
+          break;
+        case LED_OP_MAX:
+          sp--;
+          stack[sp - 1] = stack[sp] > stack[sp - 1] ? stack[sp] : stack[sp - 1];
+          break;
+        case LED_OP_ABS:
+          stack[sp - 1] = abs_q16(stack[sp - 1]);
+          break;
+        case LED_OP_FRAC:
+          stack[sp - 1] = stack[sp - 1] & 0xFFFF;
+          break;
+        case LED_OP_CLAMP:
+          stack[sp - 1] = stack[sp - 1] < 0 ? 0 : (stack[sp - 1] > LP_Q16_ONE ? LP_Q16_ONE : stack[sp - 1]);
+          break;
+        case LED_OP_DUP:
+          stack[sp] = stack[sp - 1];
+          sp++;
+          break;
+        case LED_OP_SWAP:
+        {
+          int32_t top = stack[sp - 1];
+          stack[sp - 1] = stack[sp - 2];
+          stack[sp - 2] = top;
+          break;
+        }
+        case LED_OP_MIX:
+        {
+          sp -= 2;
+          int32_t a = stack[sp - 1];
+          stack[sp - 1] = wrap_add(a, mul_q16(wrap_sub(stack[sp], a), stack[sp + 1]));
+          break;
+        }
+        case LED_OP_SMOOTH:
+          stack[sp - 1] = smooth_q16(stack[sp - 1]);
+          break;
+        case LED_OP_WAVE:
+        {
+          int32_t p = stack[sp - 1] & 0xFFFF;
+          stack[sp - 1] = smooth_q16(p < LP_Q16_ONE / 2 ? p * 2 : (LP_Q16_ONE - p) * 2);
+          break;
+        }
+        case LED_OP_BUMP:
+        {
+          int32_t d = abs_q16(stack[sp - 1]);
+          stack[sp - 1] = (d < 0 || d >= LP_Q16_ONE) ? 0 : smooth_q16(LP_Q16_ONE - d);
+          break;
+        }
+        case LED_OP_NOISE:
+          sp--;
+          stack[sp - 1] = value_noise(stack[sp - 1], stack[sp]);
+          break;
+        case LED_OP_RGB:
+          sp -= 3;
+          px[0] = unit_to_u8(stack[sp]);
+          px[1] = unit_to_u8(stack[sp + 1]);
+          px[2] = unit_to_u8(stack[sp + 2]);
+          break;
+        case LED_OP_HSV:
+          sp -= 3;
+          led_hsv_to_rgb((uint8_t)((stack[sp] & 0xFFFF) >> 8), unit_to_u8(stack[sp + 1]), unit_to_u8(stack[sp + 2]),
+                         px);
+          break;
+        default:
+          // Unreachable for loaded programs.
+          return;
+      }
+    }
+  }
+}
+
+static int32_t sample_track(const led_program_t *program, uint8_t track, uint32_t loop_ms)
+{
+  const led_program_key_t *keys = program->keys[track];
+  const uint8_t n = program->key_count[track];
+  if (loop_ms <= keys[0].time_ms)
+  {
+    return (int32_t)keys[0].value * 256;
+  }
+  for (uint8_t k = 1; k < n; ++k)
+  {
+    if (loop_ms < keys[k].time_ms)
+    {
+      int32_t a = (int32_t)keys[k - 1].value * 256;
+      int32_t b = (int32_t)keys[k].value * 256;
+      int32_t span = (int32_t)(keys[k].time_ms - keys[k - 1].time_ms);
+      int32_t into = (int32_t)(loop_ms - keys[k - 1].time_ms);
+      return a + (int32_t)(((int64_t)(b - a) * into) / span);
+    }
+  }
+  return (int32_t)keys[n - 1].value * 256;
+}
+
+static uint32_t hash32(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7FEB352DU;
+  x ^= x >> 15;
+  x *= 0x846CA68BU;
+  x ^= x >> 16;
+  return x;
+}
+
+static int32_t wrap_add(int32_t a, int32_t b)
+{
+  return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+static int32_t wrap_sub(int32_t a, int32_t b)
+{
+  return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+static int32_t mul_q16(int32_t a, int32_t b)
+{
+  return (int32_t)(uint32_t)(((int64_t)a * b) >> 16);
+}
+
+static int32_t abs_q16(int32_t a)
+{
+  return a < 0 ? (int32_t)(0U - (uint32_t)a) : a;
+}
+
+static int32_t smooth_q16(int32_t t)
+{
+  if (t <= 0)
+  {
+    return 0;
+  }
+  if (t >= LP_Q16_ONE)
+  {
+    return LP_Q16_ONE;
+  }
+  int32_t t2 = (int32_t)(((int64_t)t * t) >> 16);
+  int32_t t3 = (int32_t)(((int64_t)t2 * t) >> 16);
+  return 3 * t2 - 2 * t3;
+}
+
+static int32_t lattice(int32_t ix, int32_t iy)
+{
+  uint32_t h = hash32(((uint32_t)ix * 0x8DA6B343U) ^ ((uint32_t)iy * 0xD8163841U));
+  return (int32_t)(h >> 24) * 257;
+}
+
+// Value noise on the unit lattice with smoothstep fades, in [0, 1].
+static int32_t value_noise(int32_t x, int32_t y)
+{
+  const int32_t ix = x >> 16;
+  const int32_t iy = y >> 16;
+  const int32_t u = smooth_q16(x & 0xFFFF);
+  const int32_t v = smooth_q16(y & 0xFFFF);
+  const int32_t a = lattice(ix, iy);
+  const int32_t b = lattice(ix + 1, iy);
+  const int32_t c = lattice(ix, iy + 1);
+  const int32_t d = lattice(ix + 1, iy + 1);
+  const int32_t top = a + (int32_t)(((int64_t)(b - a) * u) >> 16);
+  const int32_t bottom = c + (int32_t)(((int64_t)(d - c) * u) >> 16);
+  return top + (int32_t)(((int64_t)(bottom - top) * v) >> 16);
+}
+
+static uint8_t unit_to_u8(int32_t q)
+{
+  if (q <= 0)
+  {
+    return 0;
+  }
+  if (q >= LP_Q16_ONE)
+  {
+    return 255;
+  }
+  return (uint8_t)(((uint32_t)q * 255U + LP_Q16_ONE / 2) >> 16);
+}
+
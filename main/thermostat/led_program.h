@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Data-driven LED effects.
+ *
+ * A program is a handful of keyframe tracks plus a straight-line stack
+ * bytecode that runs once per pixel per tick and leaves one colour. All
+ * arithmetic is Q16 (65536 == 1.0) with integer-only primitives, so
+ * scripts/theoled.py renders the same frames bit for bit on a host.
+ *
+ * Wire format (little endian), version 1:
+ *   "LP" u8 version u8 track_count u16 period_ms u16 code_len
+ *   per track: u8 key_count, key_count x {u16 time_ms, i16 value Q8.8}
+ *   code_len bytes of code
+ *
+ * Tracks are sampled once per tick at the loop time (elapsed % period_ms,
+ * or elapsed clamped to the last key when period_ms is 0) and linearly
+ * interpolated between keys.
+ *
+ * led_program_load() checks everything the interpreter relies on: stack
+ * depth, track and opcode indices, and a static cost (sum of opcode weights)
+ * that must fit the caller's per-pixel budget. The interpreter does no
+ * checking of its own.
+ *
+ * The module has no IDF dependencies and runs unchanged on a host.
+ */
+
+#define LED_PROGRAM_VERSION 1
+#define LED_PROGRAM_MAX_TRACKS 4
+#define LED_PROGRAM_MAX_KEYS 8
+#define LED_PROGRAM_MAX_CODE 256
+#define LED_PROGRAM_STACK_DEPTH 8
+#define LED_PROGRAM_HEADER_BYTES 8
+#define LED_PROGRAM_MAX_BYTES \
+  (LED_PROGRAM_HEADER_BYTES + LED_PROGRAM_MAX_TRACKS * (1 + LED_PROGRAM_MAX_KEYS * 4) + LED_PROGRAM_MAX_CODE)
+
+typedef enum
+{
+  // Operands
+  LED_OP_PUSH = 0x01,   // i16 Q8.8 immediate
+  LED_OP_POS = 0x02,    // pixel height along the U: 0 at the bottoms, 1 at top centre
+  LED_OP_INDEX = 0x03,  // pixel index / (count - 1)
+  LED_OP_TIME = 0x04,   // seconds since the effect started (wraps after ~9 h)
+  LED_OP_PHASE = 0x05,  // loop time / period_ms, 0 when period_ms is 0
+  LED_OP_HASH = 0x06,   // fixed per-pixel random value in [0, 1)
+  LED_OP_TRACK = 0x07,  // u8 track index
+  // Arithmetic
+  LED_OP_ADD = 0x10,
+  LED_OP_SUB = 0x11,
+  LED_OP_MUL = 0x12,
+  LED_OP_MIN = 0x13,
+  LED_OP_MAX = 0x14,
+  LED_OP_ABS = 0x15,
+  LED_OP_FRAC = 0x16,   // x - floor(x)
+  LED_OP_CLAMP = 0x17,  // to [0, 1]
+  LED_OP_DUP = 0x18,
+  LED_OP_SWAP = 0x19,
+  LED_OP_MIX = 0x1A,    // a b t -> a + (b - a) * t
+  // Shaping
+  LED_OP_SMOOTH = 0x20, // 3t^2 - 2t^3 of clamp(t)
+  LED_OP_WAVE = 0x21,   // periodic 0..1..0 over one unit, raised-cosine shaped
+  LED_OP_BUMP = 0x22,   // smooth window: 1 at 0, falling to 0 at +-1
+  LED_OP_NOISE = 0x23,  // x y -> 2D value noise in [0, 1]
+  // Output; each pixel shows whatever was written last.
+  LED_OP_RGB = 0x30,    // r g b
+  LED_OP_HSV = 0x31,    // h s v; hue wraps every unit
+} led_program_op_t;
+
+typedef struct
+{
+  uint16_t time_ms;
+  int16_t value;  // Q8.8
+} led_program_key_t;
+
+typedef struct
+{
+  uint16_t period_ms;
+  uint8_t track_count;
+  uint8_t key_count[LED_PROGRAM_MAX_TRACKS];
+  led_program_key_t keys[LED_PROGRAM_MAX_TRACKS][LED_PROGRAM_MAX_KEYS];
+  uint16_t code_len;
+  uint16_t cost;  // per pixel, from led_program_load()
+  uint8_t code[LED_PROGRAM_MAX_CODE];
+} led_program_t;
+
+/**
+ * @brief Parses and validates a program.
+ *
+ * @param max_cost Per-pixel cost budget; programs above it are rejected.
+ * @param out_error Optional; set to a short reason when the program is
+ *        rejected.
+ * @return true if out holds a program the interpreter can run.
+ */
+bool led_program_load(led_program_t *out, const uint8_t *data, size_t len, uint16_t max_cost,
+                      const char **out_error);
+
+/**
+ * @brief Renders one frame.
+ *
+ * @param positions Q16 height of each pixel (LED_OP_POS).
+ * @param rgb count x 3 bytes, written in R, G, B order.
+ */
+void led_program_render(const led_program_t *program, int64_t elapsed_us, const int32_t *positions,
+                        size_t count, uint8_t *rgb);
+
+#ifdef __cplusplus
+}
+#endif
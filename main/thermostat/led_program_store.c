@@ -0,0 +1,230 @@
+#include "thermostat/led_program_store.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "connectivity/http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include "thermostat/thermostat_led_status.h"
+
+#define LED_PROGRAM_NVS_NAMESPACE "theo_led"
+#define LED_PROGRAM_NVS_KEY "program"
+
+static const char *TAG = "led_program";
+
+// The raw blob is kept next to the parsed program so an identical upload can
+// be recognised without touching flash.
+static struct {
+  uint8_t blob[LED_PROGRAM_MAX_BYTES];
+  size_t blob_len;
+  led_program_t program;
+  bool loaded;
+} s_store;
+static portMUX_TYPE s_store_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void ensure_loaded(void);
+static esp_err_t persist(const uint8_t *data, size_t len);
+static esp_err_t led_program_post_handler(httpd_req_t *req);
+
+esp_err_t led_program_store_install(const uint8_t *data, size_t len, bool *out_changed, const char **out_reason)
+{
+  const char *reason = NULL;
+  led_program_t program;
+  if (!led_program_load(&program, data, len, CONFIG_THEO_LED_PROGRAM_MAX_COST, &reason))
+  {
+    ESP_LOGW(TAG, "led_program_install rejected reason=\"%s\" bytes=%u", reason, (unsigned)len);
+    if (out_reason != NULL)
+    {
+      *out_reason = reason;
+    }
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  ensure_loaded();
+  taskENTER_CRITICAL(&s_store_lock);
+  const bool changed = s_store.blob_len != len || memcmp(s_store.blob, data, len) != 0;
+  taskEXIT_CRITICAL(&s_store_lock);
+
+  esp_err_t persist_err = changed ? persist(data, len) : ESP_OK;
+  if (persist_err != ESP_OK)
+  {
+    ESP_LOGW(TAG, "LED program not persisted (%s); kept until reboot", esp_err_to_name(persist_err));
+  }
+
+  taskENTER_CRITICAL(&s_store_lock);
+  memcpy(s_store.blob, data, len);
+  s_store.blob_len = len;
+  s_store.program = program;
+  s_store.loaded = true;
+  taskEXIT_CRITICAL(&s_store_lock);
+
+  ESP_LOGI(TAG,
+           "led_program_install bytes=%u tracks=%u code=%u cost=%u/%u changed=%d persisted=%d",
+           (unsigned)len,
+           (unsigned)program.track_count,
+           (unsigned)program.code_len,
+           (unsigned)program.cost,
+           (unsigned)CONFIG_THEO_LED_PROGRAM_MAX_COST,
+           changed,
+           changed && persist_err == ESP_OK);
+  if (out_changed != NULL)
+  {
+    *out_changed = changed;
+  }
+  return ESP_OK;
+}
+
+esp_err_t led_program_store_get(led_program_t *out)
+{
+  ensure_loaded();
+  esp_err_t err = ESP_ERR_NOT_FOUND;
+  taskENTER_CRITICAL(&s_store_lock);
+  if (s_store.blob_len > 0)
+  {
+    *out = s_store.program;
+    err = ESP_OK;
+  }
+  taskEXIT_CRITICAL(&s_store_lock);
+  return err;
+}
+
+// NVS comes up with Wi-Fi, after the LED status module, so the cache is read
+// on first use and retried until NVS is available.
+static void ensure_loaded(void)
+{
+  if (s_store.loaded)
+  {
+    return;
+  }
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(LED_PROGRAM_NVS_NAMESPACE, NVS_READONLY, &handle);
+  if (err == ESP_ERR_NVS_NOT_INITIALIZED)
+  {
+    return;
+  }
+
+  uint8_t blob[LED_PROGRAM_MAX_BYTES];
+  size_t len = sizeof(blob);
+  led_program_t program;
+  bool valid = false;
+  if (err == ESP_OK)
+  {
+    err = nvs_get_blob(handle, LED_PROGRAM_NVS_KEY, blob, &len);
+    nvs_close(handle);
+  }
+  if (err == ESP_OK)
+  {
+    const char *reason = NULL;
+    // The budget may have been lowered since the program was stored.
+    valid = led_program_load(&program, blob, len, CONFIG_THEO_LED_PROGRAM_MAX_COST, &reason);
+    if (!valid)
+    {
+      ESP_LOGW(TAG, "Cached LED program ignored: %s", reason);
+    }
+  }
+  else if (err != ESP_ERR_NVS_NOT_FOUND)
+  {
+    ESP_LOGW(TAG, "Cached LED program unreadable (%s)", esp_err_to_name(err));
+  }
+
+  // An install that raced this read wins.
+  taskENTER_CRITICAL(&s_store_lock);
+  if (!s_store.loaded)
+  {
+    if (valid)
+    {
+      memcpy(s_store.blob, blob, len);
+      s_store.blob_len = len;
+      s_store.program = program;
+    }
+    s_store.loaded = true;
+  }
+  taskEXIT_CRITICAL(&s_store_lock);
+  if (valid)
+  {
+    ESP_LOGI(TAG, "Cached LED program loaded (bytes=%u cost=%u)", (unsigned)len, (unsigned)program.cost);
+  }
+}
+
+static esp_err_t persist(const uint8_t *data, size_t len)
+{
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(LED_PROGRAM_NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  err = nvs_set_blob(handle, LED_PROGRAM_NVS_KEY, data, len);
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+esp_err_t led_program_store_register_http(void)
+{
+  httpd_uri_t uri = {
+      .uri = "/led/program",
+      .method = HTTP_POST,
+      .handler = led_program_post_handler,
+      .user_ctx = NULL,
+  };
+  esp_err_t err = http_server_register_uri_handler(&uri);
+  if (err != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Failed to register /led/program: %s", esp_err_to_name(err));
+    return err;
+  }
+  ESP_LOGI(TAG, "LED program endpoint ready (/led/program max_bytes=%u)", (unsigned)LED_PROGRAM_MAX_BYTES);
+  return ESP_OK;
+}
+
+static esp_err_t led_program_post_handler(httpd_req_t *req)
+{
+  if (req->content_len == 0 || req->content_len > LED_PROGRAM_MAX_BYTES)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Program size out of range");
+  }
+
+  uint8_t body[LED_PROGRAM_MAX_BYTES];
+  size_t filled = 0;
+  while (filled < req->content_len)
+  {
+    int received = httpd_req_recv(req, (char *)body + filled, req->content_len - filled);
+    if (received == HTTPD_SOCK_ERR_TIMEOUT)
+    {
+      continue;
+    }
+    if (received <= 0)
+    {
+      ESP_LOGW(TAG, "LED program receive failed: %d", received);
+      return ESP_FAIL;
+    }
+    filled += (size_t)received;
+  }
+
+  const char *reason = NULL;
+  esp_err_t err = led_program_store_install(body, filled, NULL, &reason);
+  if (err == ESP_ERR_INVALID_ARG)
+  {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, reason);
+  }
+  if (err != ESP_OK)
+  {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(err));
+  }
+  thermostat_led_status_trigger_program();
+
+  led_program_t program;
+  led_program_store_get(&program);
+  char reply[48];
+  snprintf(reply, sizeof(reply), "ok bytes=%u cost=%u\n", (unsigned)filled, (unsigned)program.cost);
+  httpd_resp_set_type(req, "text/plain");
+  return httpd_resp_send(req, reply, HTTPD_RESP_USE_STRLEN);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "thermostat/led_program.h"
+
+/**
+ * @brief Validates a program against CONFIG_THEO_LED_PROGRAM_MAX_COST and
+ *        makes it the cached program, persisting it to NVS.
+ *
+ * Re-installing the cached program does not rewrite flash.
+ *
+ * @param out_changed Optional; false when the program was already cached.
+ * @param out_reason Optional; why the program was rejected.
+ * @return ESP_ERR_INVALID_ARG if the program is rejected. A failed NVS write
+ *         is logged but still installs the program for this boot.
+ */
+esp_err_t led_program_store_install(const uint8_t *data, size_t len, bool *out_changed, const char **out_reason);
+
+/**
+ * @brief Copies the cached program, loading it from NVS on first use.
+ *
+ * @return ESP_ERR_NOT_FOUND if no program has been installed.
+ */
+esp_err_t led_program_store_get(led_program_t *out);
+
+/**
+ * @brief Registers POST /led/program, which installs the request body and
+ *        previews it on the cue layer.
+ */
+esp_err_t led_program_store_register_http(void);
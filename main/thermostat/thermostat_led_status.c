@@ -11,11 +11,16 @@
 #include "thermostat/ui_animation_timing.h"
 #include "thermostat/ui_splash.h"
 #include "thermostat/application_cues.h"
+#include "thermostat/led_program_store.h"
 #include "thermostat/thermostat_personal_presence.h"
 
 #define LED_STATUS_SPARKLE_POLL_MS  (20)
 #define LED_STATUS_RAINBOW_TIMEOUT_MS (10000)
 #define LED_STATUS_GREETING_DURATION_MS (1200)
+#define LED_STATUS_CUE_ATTACK_MS (250)
+#define LED_STATUS_CUE_RELEASE_MS (400)
+#define LED_STATUS_GREETING_ATTACK_MS (100)
+#define LED_STATUS_GREETING_RELEASE_MS (300)
 
 static const char *TAG = "led_status";
 
@@ -29,6 +34,17 @@ typedef enum {
   TIMER_STAGE_GREETING_COMPLETE,
 } timer_stage_t;
 
+// What the base layer was last asked to show, so repeated HVAC reports do not
+// restart a wave that is already running.
+typedef enum {
+  BASE_MODE_NONE = 0,
+  BASE_MODE_HEAT_WAVE,
+  BASE_MODE_HEARTH_GLOW,
+  BASE_MODE_COOL_WAVE,
+  BASE_MODE_BIAS,
+  BASE_MODE_OFF,
+} base_mode_t;
+
 static struct {
   bool leds_ready;
   bool booting;
@@ -38,7 +54,7 @@ static struct {
   bool heating;
   bool cooling;
   bool screen_on;
-  bool bias_lighting_active;
+  base_mode_t base_mode;
   esp_timer_handle_t timer;
   timer_stage_t timer_stage;
 } s_status = {
@@ -54,6 +70,13 @@ static void try_play_boot_chime(void);
 static void boot_chime_task(void *arg);
 static void start_bias_lighting(void);
 static void complete_greeting_effect(void);
+static void start_overlay(const char *name, esp_err_t (*start)(void));
+static esp_err_t overlay_rainbow(void);
+static esp_err_t overlay_heatwave(void);
+static esp_err_t overlay_coolwave(void);
+static esp_err_t overlay_sparkle(void);
+static esp_err_t overlay_program(void);
+static esp_err_t overlay_hearth(void);
 
 esp_err_t thermostat_led_status_init(void)
 {
@@ -91,6 +114,7 @@ void thermostat_led_status_booting(void)
   }
 
   s_status.booting = true;
+  s_status.base_mode = BASE_MODE_NONE;
   ESP_LOGI(TAG, "Boot sparkle engaged");
   log_if_error(thermostat_leds_start_sparkle(), "boot sparkle");
 }
@@ -159,10 +183,7 @@ void thermostat_led_status_trigger_rainbow(void)
   }
 
   ESP_LOGI(TAG, "Rainbow easter egg triggered");
-  s_status.timed_effect_active = true;
-  s_status.bias_lighting_active = false;
-  log_if_error(thermostat_leds_rainbow(), "rainbow trigger");
-  schedule_timer(TIMER_STAGE_TIMED_EFFECT_TIMEOUT, LED_STATUS_RAINBOW_TIMEOUT_MS);
+  start_overlay("rainbow trigger", overlay_rainbow);
 }
 
 void thermostat_led_status_trigger_heatwave(void)
@@ -173,10 +194,7 @@ void thermostat_led_status_trigger_heatwave(void)
   }
 
   ESP_LOGI(TAG, "Heatwave easter egg triggered");
-  s_status.timed_effect_active = true;
-  s_status.bias_lighting_active = false;
-  log_if_error(thermostat_leds_wave_rising(thermostat_led_color(0xA0, 0x38, 0x05)), "heatwave trigger");
-  schedule_timer(TIMER_STAGE_TIMED_EFFECT_TIMEOUT, LED_STATUS_RAINBOW_TIMEOUT_MS);
+  start_overlay("heatwave trigger", overlay_heatwave);
 }
 
 void thermostat_led_status_trigger_coolwave(void)
@@ -187,10 +205,7 @@ void thermostat_led_status_trigger_coolwave(void)
   }
 
   ESP_LOGI(TAG, "Coolwave easter egg triggered");
-  s_status.timed_effect_active = true;
-  s_status.bias_lighting_active = false;
-  log_if_error(thermostat_leds_wave_falling(thermostat_led_color(0x20, 0x65, 0xB0)), "coolwave trigger");
-  schedule_timer(TIMER_STAGE_TIMED_EFFECT_TIMEOUT, LED_STATUS_RAINBOW_TIMEOUT_MS);
+  start_overlay("coolwave trigger", overlay_coolwave);
 }
 
 void thermostat_led_status_trigger_sparkle(void)
@@ -201,10 +216,29 @@ void thermostat_led_status_trigger_sparkle(void)
   }
 
   ESP_LOGI(TAG, "Sparkle easter egg triggered");
-  s_status.timed_effect_active = true;
-  s_status.bias_lighting_active = false;
-  log_if_error(thermostat_leds_start_sparkle(), "sparkle trigger");
-  schedule_timer(TIMER_STAGE_TIMED_EFFECT_TIMEOUT, LED_STATUS_RAINBOW_TIMEOUT_MS);
+  start_overlay("sparkle trigger", overlay_sparkle);
+}
+
+void thermostat_led_status_trigger_program(void)
+{
+  if (!s_status.leds_ready)
+  {
+    return;
+  }
+
+  ESP_LOGI(TAG, "LED program triggered");
+  start_overlay("program trigger", overlay_program);
+}
+
+void thermostat_led_status_trigger_hearth(void)
+{
+  if (!s_status.leds_ready)
+  {
+    return;
+  }
+
+  ESP_LOGI(TAG, "Hearth glow easter egg triggered");
+  start_overlay("hearth trigger", overlay_hearth);
 }
 
 esp_err_t thermostat_led_status_trigger_greeting(void)
@@ -254,14 +288,14 @@ esp_err_t thermostat_led_status_trigger_greeting(void)
     return ESP_ERR_INVALID_STATE;
   }
 
-  if (s_status.heating || s_status.cooling)
-  {
-    ESP_LOGW(TAG, "Greeting LEDs rejected: HVAC wave active (heat=%d cool=%d)", s_status.heating, s_status.cooling);
-    thermostat_personal_presence_on_led_complete();
-    return ESP_ERR_INVALID_STATE;
-  }
-
-  esp_err_t err = thermostat_leds_start_greeting();
+  // The greeting plays over whatever the base layer shows (bias lighting or
+  // an HVAC wave); lighten keeps the base visible around the band.
+  log_if_error(thermostat_leds_layer_configure(THERMOSTAT_LED_LAYER_CUE,
+                                               THERMOSTAT_LED_BLEND_LIGHTEN,
+                                               LED_STATUS_GREETING_ATTACK_MS,
+                                               LED_STATUS_GREETING_RELEASE_MS),
+               "greeting layer");
+  esp_err_t err = thermostat_leds_start_greeting_on(THERMOSTAT_LED_LAYER_CUE);
   if (err != ESP_OK)
   {
     ESP_LOGW(TAG, "Greeting LEDs failed to start: %s", esp_err_to_name(err));
@@ -272,7 +306,7 @@ esp_err_t thermostat_led_status_trigger_greeting(void)
   if (!s_status.timer)
   {
     ESP_LOGW(TAG, "Greeting timer unavailable; stopping animation");
-    thermostat_leds_stop_animation();
+    log_if_error(thermostat_leds_layer_release(THERMOSTAT_LED_LAYER_CUE), "greeting release");
     s_status.greeting_active = false;
     s_status.timed_effect_active = false;
     thermostat_personal_presence_on_led_complete();
@@ -280,7 +314,6 @@ esp_err_t thermostat_led_status_trigger_greeting(void)
   }
 
   s_status.timed_effect_active = true;
-  s_status.bias_lighting_active = false;
   s_status.greeting_active = true;
   schedule_timer(TIMER_STAGE_GREETING_COMPLETE, LED_STATUS_GREETING_DURATION_MS);
   ESP_LOGI(TAG, "Scott greeting LED effect running");
@@ -289,34 +322,58 @@ esp_err_t thermostat_led_status_trigger_greeting(void)
 
 static void apply_hvac_effect(void)
 {
-  if (!s_status.leds_ready || s_status.booting || s_status.boot_sequence_active ||
-      s_status.timed_effect_active)
+  // Timed effects play on the cue layer, so the base keeps tracking HVAC
+  // state underneath them; only the boot sequence owns the base layer.
+  if (!s_status.leds_ready || s_status.booting || s_status.boot_sequence_active)
   {
     return;
   }
 
   if (s_status.heating)
   {
+#if CONFIG_THEO_LED_HEATING_HEARTH_GLOW
+    if (s_status.base_mode == BASE_MODE_HEARTH_GLOW)
+    {
+      return;
+    }
+    // Flickering red-orange firelight
+    s_status.base_mode = BASE_MODE_HEARTH_GLOW;
+    log_if_error(thermostat_leds_hearth_glow(), "heating hearth glow");
+#else
+    if (s_status.base_mode == BASE_MODE_HEAT_WAVE)
+    {
+      return;
+    }
     // Deep orange #A03805 base, rising wave (heat rises)
-    s_status.bias_lighting_active = false;
+    s_status.base_mode = BASE_MODE_HEAT_WAVE;
     log_if_error(thermostat_leds_wave_rising(thermostat_led_color(0xA0, 0x38, 0x05)),
                  "heating wave");
+#endif
   }
   else if (s_status.cooling)
   {
+    if (s_status.base_mode == BASE_MODE_COOL_WAVE)
+    {
+      return;
+    }
     // Saturated blue #2065B0 base, falling wave (cold sinks)
-    s_status.bias_lighting_active = false;
+    s_status.base_mode = BASE_MODE_COOL_WAVE;
     log_if_error(thermostat_leds_wave_falling(thermostat_led_color(0x20, 0x65, 0xB0)),
                  "cooling wave");
   }
   else if (s_status.screen_on)
   {
+    if (s_status.base_mode == BASE_MODE_BIAS)
+    {
+      return;
+    }
     // No HVAC demand, screen is on - restore bias lighting
     ESP_LOGD(TAG, "HVAC idle, screen on: restoring bias lighting");
     start_bias_lighting();
   }
-  else
+  else if (s_status.base_mode != BASE_MODE_OFF)
   {
+    s_status.base_mode = BASE_MODE_OFF;
     log_if_error(thermostat_leds_off_with_fade(100), "idle fade-off");
   }
 }
@@ -356,8 +413,8 @@ static void led_status_timer_cb(void *arg)
     case TIMER_STAGE_TIMED_EFFECT_TIMEOUT:
       s_status.timed_effect_active = false;
       s_status.timer_stage = TIMER_STAGE_NONE;
-      ESP_LOGI(TAG, "Timed effect timeout; restoring HVAC state");
-      apply_hvac_effect();
+      ESP_LOGI(TAG, "Timed effect timeout; fading back to HVAC state");
+      log_if_error(thermostat_leds_layer_release(THERMOSTAT_LED_LAYER_CUE), "timed effect release");
       break;
     case TIMER_STAGE_GREETING_COMPLETE:
       s_status.timer_stage = TIMER_STAGE_NONE;
@@ -379,6 +436,7 @@ static void log_if_error(esp_err_t err, const char *stage)
 static void start_boot_success_sequence(void)
 {
   s_status.boot_sequence_active = true;
+  s_status.base_mode = BASE_MODE_NONE;
   ESP_LOGI(TAG, "Boot sequence complete; running success fade");
   thermostat_leds_notify_boot_complete();
   log_if_error(
@@ -439,7 +497,7 @@ static void start_bias_lighting(void)
   log_if_error(
       thermostat_leds_solid_with_fade_brightness(thermostat_led_color(0xff, 0xff, 0xff), 100, 0.25f),
       "bias lighting");
-  s_status.bias_lighting_active = true;
+  s_status.base_mode = BASE_MODE_BIAS;
 }
 
 static void complete_greeting_effect(void)
@@ -452,11 +510,10 @@ static void complete_greeting_effect(void)
   {
     s_status.greeting_active = false;
     s_status.timed_effect_active = false;
-    thermostat_leds_stop_animation();
-    ESP_LOGI(TAG, "Greeting LEDs finished; restoring HVAC state");
+    log_if_error(thermostat_leds_layer_release(THERMOSTAT_LED_LAYER_CUE), "greeting release");
+    ESP_LOGI(TAG, "Greeting LEDs finished; fading back to HVAC state");
   }
   thermostat_personal_presence_on_led_complete();
-  apply_hvac_effect();
 }
 
 void thermostat_led_status_on_screen_wake(void)
@@ -476,15 +533,15 @@ void thermostat_led_status_on_screen_wake(void)
     return;
   }
 
-  // Don't start bias lighting if a higher-priority effect is active
-  if (s_status.booting || s_status.boot_sequence_active || s_status.timed_effect_active)
+  // Don't start bias lighting while the boot sequence owns the base layer
+  if (s_status.booting || s_status.boot_sequence_active)
   {
-    ESP_LOGD(TAG, "Screen wake: skipping bias lighting (effect active)");
+    ESP_LOGD(TAG, "Screen wake: skipping bias lighting (boot sequence active)");
     return;
   }
 
   ESP_LOGI(TAG, "Screen wake: starting bias lighting");
-  start_bias_lighting();
+  apply_hvac_effect();
 }
 
 void thermostat_led_status_on_screen_sleep(void)
@@ -495,8 +552,58 @@ void thermostat_led_status_on_screen_sleep(void)
   }
 
   s_status.screen_on = false;
-  s_status.bias_lighting_active = false;
+  s_status.base_mode = BASE_MODE_OFF;
 
   ESP_LOGI(TAG, "Screen sleep: fading LEDs off");
   log_if_error(thermostat_leds_off_with_fade(100), "screen sleep fade-off");
 }
+
+// Easter eggs cross-fade in on the cue layer over the running base state and
+// fade back out when their timeout expires.
+static void start_overlay(const char *name, esp_err_t (*start)(void))
+{
+  s_status.timed_effect_active = true;
+  log_if_error(thermostat_leds_layer_configure(THERMOSTAT_LED_LAYER_CUE,
+                                               THERMOSTAT_LED_BLEND_NORMAL,
+                                               LED_STATUS_CUE_ATTACK_MS,
+                                               LED_STATUS_CUE_RELEASE_MS),
+               name);
+  log_if_error(start(), name);
+  schedule_timer(TIMER_STAGE_TIMED_EFFECT_TIMEOUT, LED_STATUS_RAINBOW_TIMEOUT_MS);
+}
+
+static esp_err_t overlay_rainbow(void)
+{
+  return thermostat_leds_rainbow_on(THERMOSTAT_LED_LAYER_CUE);
+}
+
+static esp_err_t overlay_heatwave(void)
+{
+  return thermostat_leds_wave_rising_on(THERMOSTAT_LED_LAYER_CUE, thermostat_led_color(0xA0, 0x38, 0x05));
+}
+
+static esp_err_t overlay_coolwave(void)
+{
+  return thermostat_leds_wave_falling_on(THERMOSTAT_LED_LAYER_CUE, thermostat_led_color(0x20, 0x65, 0xB0));
+}
+
+static esp_err_t overlay_sparkle(void)
+{
+  return thermostat_leds_start_sparkle_on(THERMOSTAT_LED_LAYER_CUE);
+}
+
+static esp_err_t overlay_program(void)
+{
+  led_program_t program;
+  esp_err_t err = led_program_store_get(&program);
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+  return thermostat_leds_program_on(THERMOSTAT_LED_LAYER_CUE, &program);
+}
+
+static esp_err_t overlay_hearth(void)
+{
+  return thermostat_leds_hearth_glow_on(THERMOSTAT_LED_LAYER_CUE);
+}
@@ -12,6 +12,9 @@ void thermostat_led_status_trigger_rainbow(void);
 void thermostat_led_status_trigger_heatwave(void);
 void thermostat_led_status_trigger_coolwave(void);
 void thermostat_led_status_trigger_sparkle(void);
+// Plays the cached LED program (see led_program_store.h) as an easter egg.
+void thermostat_led_status_trigger_program(void);
+void thermostat_led_status_trigger_hearth(void);
 esp_err_t thermostat_led_status_trigger_greeting(void);
 
 void thermostat_led_status_on_screen_wake(void);
@@ -6,12 +6,19 @@
 
 #include "connectivity/time_sync.h"
 #include "esp_check.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "led_strip.h"
 #include "sdkconfig.h"
 #include "thermostat/application_cues.h"
+#include "thermostat/led_color.h"
+#include "thermostat/led_hearth.h"
+#include "thermostat/led_program.h"
 
 #ifndef LED_PI
 #define LED_PI 3.14159265f
@@ -20,6 +27,10 @@
 #define THERMOSTAT_LED_COUNT        (39)
 #define LED_TIMER_PERIOD_US         (10000)  // 10 ms tick
 #define LED_TIMER_PERIOD_MS         (LED_TIMER_PERIOD_US / 1000)
+// Frames are rendered and committed by a task below the application tasks;
+// the esp_timer callback only wakes it.
+#define LED_RENDER_TASK_STACK       (4096)
+#define LED_RENDER_TASK_PRIO        (2)
 #define LED_MIN_FADE_DURATION_MS    (100)
 #define LED_PULSE_INTENSITY_SCALE   (0.4f)
 #define LED_SPARKLE_TICKS_PER_FRAME (2)
@@ -36,16 +47,32 @@
 #define LED_GREETING_TAIL_DECAY     (0xC0)
 #define LED_GREETING_BRIGHTNESS     (0.7f)
 #define LED_QUIET_HOURS_BRIGHTNESS  (0.25f)
+#define LED_QUIET_RECHECK_US        (1000000)
+
+// Fixed-point helpers: greeting and program positions are Q16 (65536 == 1.0).
+#define LED_Q16_ONE                 (65536)
+// The raised-cosine curve behind the pulse and the wave is tabulated once at
+// init and linearly interpolated. LED_CURVE_MAX_ERROR bounds the distance to
+// the float curve (interpolation error is under 1e-5); an output level that
+// lands that close to a rounding edge is settled with cosf instead, so frames
+// match the float code exactly.
+#define LED_CURVE_SEGMENTS          (256)
+#define LED_CURVE_MAX_ERROR         (2.0e-5f)
+#define LED_STATS_LOG_TICKS         (3000)
 
 // Rainbow parameters (from scratch/rainbow_loop)
 #define LED_RAINBOW_HUE_SPEED       (2)
 #define LED_RAINBOW_HUE_DENSITY     (7)
 
+// Hearth glow output level (from scratch/hearth_glow, LED_BRIGHTNESS 180)
+#define LED_HEARTH_BRIGHTNESS       (0.7f)
+
 // Wave parameters (from scratch/rising_warmth)
 #define LED_WAVE_COUNT              (2)
 #define LED_WAVE_WIDTH              (0.45f)
 #define LED_WAVE_SPEED              (0.006f)
 #define LED_WAVE_PULSE_BRIGHTNESS   (70)
+#define LED_WAVE_NO_POSITION        (-1.0f)
 
 // U-shape layout constants
 #define LED_LEFT_START              (0)
@@ -63,6 +90,8 @@ typedef enum {
   LED_EFFECT_RAINBOW,
   LED_EFFECT_WAVE,
   LED_EFFECT_GREETING,
+  LED_EFFECT_PROGRAM,
+  LED_EFFECT_HEARTH,
 } led_effect_type_t;
 
 typedef struct {
@@ -86,69 +115,182 @@ typedef struct {
   led_easing_t easing;
 } fade_state_t;
 
+typedef struct {
+  uint8_t level[256];
+  float brightness;
+  bool valid;
+} led_lut_t;
+
+typedef struct {
+  led_effect_type_t effect;
+  union {
+    pulse_state_t pulse;
+    fade_state_t fade;
+    struct {
+      thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
+      uint8_t tick_accumulator;
+      bool stop_requested;
+    } sparkle;
+    struct {
+      uint8_t hue_offset;
+    } rainbow;
+    struct {
+      thermostat_led_color_t base_color;
+      float wave_positions[LED_WAVE_COUNT];
+      bool rising;  // true = rising (heat), false = falling (cool)
+    } wave;
+    struct {
+      thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
+      int32_t head_index;  // Q16
+      int32_t step;        // Q16
+      int direction;
+      uint8_t loops_remaining;
+    } greeting;
+    struct {
+      led_program_t code;
+      int64_t start_time_us;
+    } program;
+    struct {
+      led_hearth_t noise;
+      int64_t start_time_us;
+    } hearth;
+  };
+  // Output levels for the effect's brightness, so scaling a frame is three
+  // table lookups per pixel.
+  led_lut_t lut;
+  // What the layer currently shows, at the effect's brightness. It stays in
+  // the composite after the effect ends until the layer is cleared.
+  thermostat_led_color_t frame[THERMOSTAT_LED_COUNT];
+  bool visible;
+  thermostat_led_blend_t blend;
+  uint32_t attack_ms;
+  uint32_t release_ms;
+  struct {
+    uint8_t current;
+    uint8_t start;
+    uint8_t target;
+    int64_t start_time_us;
+    int64_t duration_us;  // 0 once the ramp is done
+    bool releasing;       // clear the layer when the ramp reaches 0
+  } opacity;
+  thermostat_led_color_t latched_color;
+  float latched_brightness;
+  // A pulse latches its phase instead; see layer_latched_brightness().
+  float latched_phase;
+  bool latched_pulse;
+} led_layer_t;
+
 typedef struct {
   led_strip_handle_t strip;
   esp_timer_handle_t timer;
-  led_effect_type_t effect;
-  pulse_state_t pulse;
-  fade_state_t fade;
+  led_layer_t layers[THERMOSTAT_LED_LAYER_COUNT];
+  // Quiet-hours dimming, applied once to the composited frame.
+  led_lut_t output_lut;
   struct {
+    // Last frame sent to the strip, already scaled and in strip order.
     thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
-    uint8_t tick_accumulator;
-    bool stop_requested;
-  } sparkle;
-  struct {
-    uint8_t hue_offset;
-  } rainbow;
+    bool valid;
+  } flushed;
   struct {
-    thermostat_led_color_t base_color;
-    float wave_positions[LED_WAVE_COUNT];
-    bool rising;  // true = rising (heat), false = falling (cool)
-  } wave;
+    TaskHandle_t task;
+    int64_t tick_us;  // latest timer tick, written under s_render_lock
+    // Composited frame for the next tick, rendered one period ahead.
+    thermostat_led_color_t next[THERMOSTAT_LED_COUNT];
+    bool next_ready;
+  } render;
   struct {
-    thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
-    float head_index;
-    float step;
-    int direction;
-    uint8_t loops_remaining;
-  } greeting;
-  thermostat_led_color_t latched_color;
-  float latched_brightness;
+    led_effect_type_t effect;
+    uint32_t ticks;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t commit_max_us;
+    uint64_t jitter_total_us;
+    uint32_t jitter_max_us;
+    uint32_t commits;
+    uint32_t overruns;
+    uint32_t skipped;
+    uint32_t refreshes;
+    uint32_t unchanged;
+    uint8_t max_layers;
+  } stats;
   bool initialized;
   bool available;
   bool quiet_gate_active;
+  bool quiet_dimming;
+  int64_t quiet_checked_us;
 } thermostat_led_runtime_t;
 
 static thermostat_led_runtime_t s_leds = {0};
+static portMUX_TYPE s_render_lock = portMUX_INITIALIZER_UNLOCKED;
+// Guards the layers and the timer's run state. The public calls run on
+// application tasks that preempt the render task, so they take it around
+// every layer change and the render task holds it while it renders.
+static SemaphoreHandle_t s_layers_mutex;
 static const char *TAG = "thermo_leds";
+// 0.5 - 0.5 * cos(pi * u) for u in [0, 1].
+static float s_raised_cosine[LED_CURVE_SEGMENTS + 1];
+// Wave position of each pixel along the U; the top bar sees both arms.
+static float s_wave_pixel_pos[THERMOSTAT_LED_COUNT][2];
+// Height of each pixel for programs (Q16): the nearer arm's wave position,
+// in integer maths so scripts/theoled.py reproduces it exactly.
+static int32_t s_program_pixel_pos[THERMOSTAT_LED_COUNT];
 
 static void led_effect_timer(void *arg);
-static esp_err_t write_fill(thermostat_led_color_t color, float brightness);
-static esp_err_t write_pixels(const thermostat_led_color_t *pixels, float brightness);
-static void cancel_current_effect(void);
+static void led_render_task(void *arg);
+static void service_tick(uint32_t ticks);
+static bool render_frame(int64_t frame_us, thermostat_led_color_t *frame);
+static void prepare_next_frame(int64_t tick_us);
+static void commit_frame(int64_t tick_us, uint32_t ticks);
+static bool any_layer_animating(void);
+static led_layer_t *base_layer(void);
+static bool layer_id_valid(thermostat_led_layer_t id);
+static led_layer_t *layer_begin(thermostat_led_layer_t id, led_effect_type_t effect);
+static void layer_cancel(led_layer_t *layer);
+static void layer_finish(led_layer_t *layer);
+static void layer_release(led_layer_t *layer);
+static void layer_set_opacity_ramp(led_layer_t *layer, uint8_t target, uint32_t ramp_ms);
+static void layer_update_opacity(led_layer_t *layer, int64_t now);
+static bool layer_animating(const led_layer_t *layer);
+static void layer_write_fill(led_layer_t *layer, thermostat_led_color_t color, float brightness);
+static void layer_write_pixels(led_layer_t *layer, const thermostat_led_color_t *pixels, float brightness);
+static void blend_layer(thermostat_led_color_t *dst, const led_layer_t *layer);
+static uint8_t blend_channel(uint8_t dst, uint8_t src, uint8_t alpha, thermostat_led_blend_t blend);
+static uint8_t mul_div255(uint8_t value, uint8_t alpha);
+static void compose_frame(thermostat_led_color_t *frame);
+static esp_err_t flush_frame(const thermostat_led_color_t *frame);
+static const uint8_t *brightness_lut(led_lut_t *lut, float brightness);
+static bool quiet_hours_dimming(void);
+static void build_curve_tables(void);
+static float raised_cosine(float u);
+static bool level_settled(uint8_t value, float estimate);
+static float pulse_brightness(float phase);
+static float layer_latched_brightness(const led_layer_t *layer);
+static led_effect_type_t top_effect(void);
+static void roll_effect_stats(led_effect_type_t effect);
+static void log_effect_stats(void);
 static bool cue_gate_required(void);
 static esp_err_t guard_output(const char *cue_name);
-static float apply_output_brightness_policy(float brightness);
-static void sparkle_reset(void);
-static void update_sparkle(void);
-static void sparkle_fade_pixels(void);
-static void sparkle_spawn_pixels(void);
-static bool sparkle_is_dark(void);
+static void sparkle_reset(led_layer_t *layer);
+static void update_sparkle(led_layer_t *layer);
+static void sparkle_fade_pixels(led_layer_t *layer);
+static void sparkle_spawn_pixels(led_layer_t *layer);
+static bool sparkle_is_dark(const led_layer_t *layer);
 static uint8_t random_u8(void);
 static uint8_t random_u8_range(uint8_t min_inclusive, uint8_t max_exclusive);
 static uint16_t random_pixel_index(void);
 static thermostat_led_color_t sparkle_random_color(void);
 static thermostat_led_color_t hsv_to_rgb(uint8_t hue, uint8_t saturation, uint8_t value);
-static uint8_t scale8(uint8_t value, uint8_t scale);
 static uint8_t scale8_video(uint8_t value, uint8_t scale);
 static uint8_t saturating_add(uint8_t a, uint8_t b);
-static void update_rainbow(void);
-static void update_wave(void);
-static void greeting_reset(void);
-static void update_greeting(void);
-static void greeting_fade_pixels(void);
-static void greeting_paint_band(void);
-static float greeting_step(void);
+static void update_rainbow(led_layer_t *layer);
+static void update_wave(led_layer_t *layer);
+static void greeting_reset(led_layer_t *layer);
+static void update_greeting(led_layer_t *layer);
+static void greeting_fade_pixels(led_layer_t *layer);
+static void greeting_paint_band(led_layer_t *layer);
+static int32_t greeting_step(void);
+static void update_program(led_layer_t *layer, int64_t now);
+static void update_hearth(led_layer_t *layer, int64_t now);
 
 static float clamp_unit(float value)
 {
@@ -182,6 +324,16 @@ static float apply_easing(float t, led_easing_t easing)
   }
 }
 
+static void layers_lock(void)
+{
+  xSemaphoreTake(s_layers_mutex, portMAX_DELAY);
+}
+
+static void layers_unlock(void)
+{
+  xSemaphoreGive(s_layers_mutex);
+}
+
 static void ensure_timer_created(void)
 {
   if (s_leds.timer)
@@ -221,17 +373,113 @@ static void start_timer(void)
   }
 }
 
-static void cancel_current_effect(void)
+static led_layer_t *base_layer(void)
+{
+  return &s_leds.layers[THERMOSTAT_LED_LAYER_BASE];
+}
+
+static bool layer_id_valid(thermostat_led_layer_t id)
+{
+  return (unsigned)id < THERMOSTAT_LED_LAYER_COUNT;
+}
+
+// Stops the layer's animation. Its frame stays in the composite until the
+// next effect renders over it or the layer is released.
+static void layer_cancel(led_layer_t *layer)
+{
+  if (layer->effect == LED_EFFECT_SPARKLE)
+  {
+    sparkle_reset(layer);
+  }
+  layer->effect = LED_EFFECT_IDLE;
+}
+
+static led_layer_t *layer_begin(thermostat_led_layer_t id, led_effect_type_t effect)
+{
+  led_layer_t *layer = &s_leds.layers[id];
+  layer_cancel(layer);
+  if (!layer->visible)
+  {
+    memset(layer->frame, 0, sizeof(layer->frame));
+    layer->visible = true;
+    layer->opacity.current = 0;
+  }
+  // A layer that was still fading out ramps back up from where it is.
+  layer->opacity.releasing = false;
+  layer_set_opacity_ramp(layer, 255, layer->attack_ms);
+  layer->effect = effect;
+  return layer;
+}
+
+// An effect ran to completion. The base layer holds its last frame, as the
+// strip always has; overlays fade out and uncover what is beneath.
+static void layer_finish(led_layer_t *layer)
 {
-  led_effect_type_t previous = s_leds.effect;
-  stop_timer();
-  s_leds.effect = LED_EFFECT_IDLE;
-  if (previous == LED_EFFECT_SPARKLE)
+  layer_cancel(layer);
+  if (layer != base_layer())
   {
-    sparkle_reset();
+    layer_release(layer);
   }
 }
 
+static void layer_release(led_layer_t *layer)
+{
+  if (!layer->visible || layer->opacity.releasing)
+  {
+    return;
+  }
+  layer->opacity.releasing = true;
+  layer_set_opacity_ramp(layer, 0, layer->release_ms);
+}
+
+static void layer_set_opacity_ramp(led_layer_t *layer, uint8_t target, uint32_t ramp_ms)
+{
+  layer->opacity.start = layer->opacity.current;
+  layer->opacity.target = target;
+  layer->opacity.start_time_us = esp_timer_get_time();
+  layer->opacity.duration_us = (int64_t)ramp_ms * 1000;
+  if (layer->opacity.duration_us == 0 || layer->opacity.current == target)
+  {
+    layer->opacity.current = target;
+    layer->opacity.duration_us = 0;
+  }
+}
+
+static void layer_update_opacity(led_layer_t *layer, int64_t now)
+{
+  if (layer->opacity.duration_us > 0)
+  {
+    int64_t elapsed = now - layer->opacity.start_time_us;
+    if (elapsed < 0)
+    {
+      elapsed = 0;
+    }
+    if (elapsed >= layer->opacity.duration_us)
+    {
+      layer->opacity.current = layer->opacity.target;
+      layer->opacity.duration_us = 0;
+    }
+    else
+    {
+      int32_t span = (int32_t)layer->opacity.target - (int32_t)layer->opacity.start;
+      layer->opacity.current =
+          (uint8_t)(layer->opacity.start + (span * elapsed) / layer->opacity.duration_us);
+    }
+  }
+
+  if (layer->opacity.releasing && layer->opacity.duration_us == 0)
+  {
+    layer_cancel(layer);
+    layer->visible = false;
+    layer->opacity.releasing = false;
+  }
+}
+
+static bool layer_animating(const led_layer_t *layer)
+{
+  return layer->effect != LED_EFFECT_IDLE || layer->opacity.duration_us > 0 || layer->opacity.releasing;
+}
+
 static bool cue_gate_required(void)
 {
   if (!s_leds.quiet_gate_active && time_sync_wait_for_sync(0))
@@ -285,23 +533,106 @@ static esp_err_t guard_output(const char *cue_name)
   return quiet_state;
 }
 
-static float apply_output_brightness_policy(float brightness)
+// The quiet-hours window only moves at minute granularity; re-reading the
+// clock on every 10 ms tick buys nothing.
+static bool quiet_hours_dimming(void)
 {
-  brightness = clamp_unit(brightness);
-
   if (!cue_gate_required())
   {
-    return brightness;
+    return false;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (s_leds.quiet_checked_us != 0 && now - s_leds.quiet_checked_us < LED_QUIET_RECHECK_US)
+  {
+    return s_leds.quiet_dimming;
   }
 
   bool quiet_hours_active = false;
   esp_err_t quiet_state = thermostat_application_cues_quiet_hours_active(&quiet_hours_active);
-  if (quiet_state != ESP_OK || !quiet_hours_active)
+  s_leds.quiet_dimming = (quiet_state == ESP_OK && quiet_hours_active);
+  s_leds.quiet_checked_us = now;
+  return s_leds.quiet_dimming;
+}
+
+static void build_curve_tables(void)
+{
+  for (int i = 0; i <= LED_CURVE_SEGMENTS; ++i)
   {
-    return brightness;
+    float u = (float)i / (float)LED_CURVE_SEGMENTS;
+    s_raised_cosine[i] = 0.5f - 0.5f * cosf(u * LED_PI);
   }
 
-  return clamp_unit(brightness * LED_QUIET_HOURS_BRIGHTNESS);
+  for (int px = 0; px < THERMOSTAT_LED_COUNT; ++px)
+  {
+    s_wave_pixel_pos[px][0] = LED_WAVE_NO_POSITION;
+    s_wave_pixel_pos[px][1] = LED_WAVE_NO_POSITION;
+  }
+  // Left side: pixels 0-14, position 0 (bottom) to 0.5 (top).
+  for (int px = LED_LEFT_START; px <= LED_LEFT_END; px++)
+  {
+    s_wave_pixel_pos[px][0] = (float)(px - LED_LEFT_START) / (LED_LEFT_END - LED_LEFT_START) * 0.5f;
+  }
+  // Right side: pixels 38 (bottom) to 23 (top), position 0 to 0.5.
+  for (int px = LED_RIGHT_START; px <= LED_RIGHT_END; px++)
+  {
+    s_wave_pixel_pos[px][0] = (float)(LED_RIGHT_END - px) / (LED_RIGHT_END - LED_RIGHT_START) * 0.5f;
+  }
+  // Top bar: pixels 15-22, position 0.5 at edges to 1.0 at center, reached
+  // from either arm.
+  float half_top = (float)(LED_TOP_END - LED_TOP_START + 1) / 2.0f;
+  for (int px = LED_TOP_START; px <= LED_TOP_END; px++)
+  {
+    s_wave_pixel_pos[px][0] = 0.5f + ((float)(px - LED_TOP_START) / half_top) * 0.5f;
+    s_wave_pixel_pos[px][1] = 0.5f + ((float)(LED_TOP_END - px) / half_top) * 0.5f;
+  }
+
+  const int32_t half = LED_Q16_ONE / 2;
+  const int32_t left_span = LED_LEFT_END - LED_LEFT_START;
+  const int32_t right_span = LED_RIGHT_END - LED_RIGHT_START;
+  const int32_t top_half = (LED_TOP_END - LED_TOP_START + 1) / 2;
+  for (int px = LED_LEFT_START; px <= LED_LEFT_END; px++)
+  {
+    s_program_pixel_pos[px] = ((px - LED_LEFT_START) * half + left_span / 2) / left_span;
+  }
+  for (int px = LED_RIGHT_START; px <= LED_RIGHT_END; px++)
+  {
+    s_program_pixel_pos[px] = ((LED_RIGHT_END - px) * half + right_span / 2) / right_span;
+  }
+  for (int px = LED_TOP_START; px <= LED_TOP_END; px++)
+  {
+    int32_t from_left = half + ((px - LED_TOP_START) * half + top_half / 2) / top_half;
+    int32_t from_right = half + ((LED_TOP_END - px) * half + top_half / 2) / top_half;
+    s_program_pixel_pos[px] = (from_left < from_right) ? from_left : from_right;
+  }
+
+  led_hearth_build_tables();
+}
+
+static float raised_cosine(float u)
+{
+  if (u <= 0.0f)
+  {
+    return s_raised_cosine[0];
+  }
+  if (u >= 1.0f)
+  {
+    return s_raised_cosine[LED_CURVE_SEGMENTS];
+  }
+  float x = u * (float)LED_CURVE_SEGMENTS;
+  int index = (int)x;
+  float lo = s_raised_cosine[index];
+  float hi = s_raised_cosine[index + 1];
+  return lo + (hi - lo) * (x - (float)index);
+}
+
+// True when value * estimate rounds to the same level wherever the exact
+// curve lies within LED_CURVE_MAX_ERROR of the estimate.
+static bool level_settled(uint8_t value, float estimate)
+{
+  float scaled = (float)value * estimate;
+  float margin = (float)value * LED_CURVE_MAX_ERROR;
+  return lroundf(scaled - margin) == lroundf(scaled + margin);
 }
 
 static uint8_t random_u8(void)
@@ -328,11 +659,6 @@ static uint16_t random_pixel_index(void)
   return (uint16_t)(esp_random() % THERMOSTAT_LED_COUNT);
 }
 
-static uint8_t scale8(uint8_t value, uint8_t scale)
-{
-  return (uint8_t)(((uint16_t)value * (uint16_t)scale) >> 8);
-}
-
 static uint8_t scale8_video(uint8_t value, uint8_t scale)
 {
   if (value == 0 || scale == 0)
@@ -360,56 +686,9 @@ static uint8_t saturating_add(uint8_t a, uint8_t b)
 
 static thermostat_led_color_t hsv_to_rgb(uint8_t hue, uint8_t saturation, uint8_t value)
 {
-  thermostat_led_color_t color = {0};
-  if (saturation == 0)
-  {
-    color.r = value;
-    color.g = value;
-    color.b = value;
-    return color;
-  }
-
-  uint8_t region = hue / 43;
-  uint8_t remainder = (hue - (region * 43)) * 6;
-
-  uint8_t p = scale8(value, (uint8_t)(255 - saturation));
-  uint8_t q = scale8(value, (uint8_t)(255 - scale8(saturation, remainder)));
-  uint8_t t = scale8(value, (uint8_t)(255 - scale8(saturation, (uint8_t)(255 - remainder))));
-
-  switch (region)
-  {
-    case 0:
-      color.r = value;
-      color.g = t;
-      color.b = p;
-      break;
-    case 1:
-      color.r = q;
-      color.g = value;
-      color.b = p;
-      break;
-    case 2:
-      color.r = p;
-      color.g = value;
-      color.b = t;
-      break;
-    case 3:
-      color.r = p;
-      color.g = q;
-      color.b = value;
-      break;
-    case 4:
-      color.r = t;
-      color.g = p;
-      color.b = value;
-      break;
-    default:
-      color.r = value;
-      color.g = p;
-      color.b = q;
-      break;
-  }
-  return color;
+  uint8_t rgb[3];
+  led_hsv_to_rgb(hue, saturation, value, rgb);
+  return thermostat_led_color(rgb[0], rgb[1], rgb[2]);
 }
 
 static thermostat_led_color_t sparkle_random_color(void)
@@ -423,25 +702,25 @@ static thermostat_led_color_t sparkle_random_color(void)
   return rgb;
 }
 
-static void sparkle_reset(void)
+static void sparkle_reset(led_layer_t *layer)
 {
-  memset(&s_leds.sparkle, 0, sizeof(s_leds.sparkle));
+  memset(&layer->sparkle, 0, sizeof(layer->sparkle));
 }
 
-static void sparkle_fade_pixels(void)
+static void sparkle_fade_pixels(led_layer_t *layer)
 {
   for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    thermostat_led_color_t *pixel = &s_leds.sparkle.pixels[i];
-    pixel->r = scale8(pixel->r, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
-    pixel->g = scale8(pixel->g, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
-    pixel->b = scale8(pixel->b, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+    thermostat_led_color_t *pixel = &layer->sparkle.pixels[i];
+    pixel->r = led_scale8(pixel->r, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+    pixel->g = led_scale8(pixel->g, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+    pixel->b = led_scale8(pixel->b, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
   }
 }
 
-static void sparkle_spawn_pixels(void)
+static void sparkle_spawn_pixels(led_layer_t *layer)
 {
-  if (s_leds.sparkle.stop_requested)
+  if (layer->sparkle.stop_requested)
   {
     return;
   }
@@ -452,7 +731,7 @@ static void sparkle_spawn_pixels(void)
       continue;
     }
     uint16_t pixel_index = random_pixel_index();
-    thermostat_led_color_t *pixel = &s_leds.sparkle.pixels[pixel_index];
+    thermostat_led_color_t *pixel = &layer->sparkle.pixels[pixel_index];
     thermostat_led_color_t sparkle = sparkle_random_color();
     pixel->r = saturating_add(pixel->r, sparkle.r);
     pixel->g = saturating_add(pixel->g, sparkle.g);
@@ -460,11 +739,11 @@ static void sparkle_spawn_pixels(void)
   }
 }
 
-static bool sparkle_is_dark(void)
+static bool sparkle_is_dark(const led_layer_t *layer)
 {
   for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    const thermostat_led_color_t *pixel = &s_leds.sparkle.pixels[i];
+    const thermostat_led_color_t *pixel = &layer->sparkle.pixels[i];
     if (pixel->r != 0 || pixel->g != 0 || pixel->b != 0)
     {
       return false;
@@ -473,67 +752,72 @@ static bool sparkle_is_dark(void)
   return true;
 }
 
-static void update_sparkle(void)
+static void update_sparkle(led_layer_t *layer)
 {
-  s_leds.sparkle.tick_accumulator++;
-  if (s_leds.sparkle.tick_accumulator < LED_SPARKLE_TICKS_PER_FRAME)
+  layer->sparkle.tick_accumulator++;
+  if (layer->sparkle.tick_accumulator < LED_SPARKLE_TICKS_PER_FRAME)
   {
     return;
   }
-  s_leds.sparkle.tick_accumulator = 0;
+  layer->sparkle.tick_accumulator = 0;
 
-  sparkle_fade_pixels();
-  sparkle_spawn_pixels();
+  sparkle_fade_pixels(layer);
+  sparkle_spawn_pixels(layer);
 
-  esp_err_t err = write_pixels(s_leds.sparkle.pixels, 1.0f);
-  if (err != ESP_OK)
-  {
-    ESP_LOGW(TAG, "Sparkle refresh failed: %s", esp_err_to_name(err));
-    return;
-  }
+  layer_write_pixels(layer, layer->sparkle.pixels, 1.0f);
 
-  if (s_leds.sparkle.stop_requested && sparkle_is_dark())
+  if (layer->sparkle.stop_requested && sparkle_is_dark(layer))
   {
     ESP_LOGD(TAG, "Sparkle drained; stopping animation");
-    cancel_current_effect();
+    layer_finish(layer);
   }
 }
 
-static void update_rainbow(void)
+static void update_rainbow(led_layer_t *layer)
 {
   thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
   for (int i = 0; i < THERMOSTAT_LED_COUNT; i++)
   {
-    uint8_t hue = s_leds.rainbow.hue_offset + (i * LED_RAINBOW_HUE_DENSITY);
+    uint8_t hue = layer->rainbow.hue_offset + (i * LED_RAINBOW_HUE_DENSITY);
     pixels[i] = hsv_to_rgb(hue, 255, 255);
   }
-  s_leds.rainbow.hue_offset += LED_RAINBOW_HUE_SPEED;
+  layer->rainbow.hue_offset += LED_RAINBOW_HUE_SPEED;
 
-  esp_err_t err = write_pixels(pixels, 1.0f);
-  if (err != ESP_OK)
-  {
-    ESP_LOGW(TAG, "Rainbow refresh failed: %s", esp_err_to_name(err));
-  }
+  layer_write_pixels(layer, pixels, 1.0f);
 }
 
-static float wave_pulse_intensity(float normalized_dist)
+// Sum of the wave intensities (1 + cos(pi * d)) / 2 at a pixel, for d its
+// distance to each wave over the wave width, added up in the same order as
+// the float code. The raised cosine at 1 - d is the same curve. The estimate
+// multiplies by the reciprocal width; its rounding is far inside the margin.
+static float wave_total_boost(const led_layer_t *layer, float pixel_pos, bool exact)
 {
-  if (normalized_dist >= 1.0f)
+  float total_boost = 0.0f;
+  for (int w = 0; w < LED_WAVE_COUNT; w++)
   {
-    return 0.0f;
+    float dist = fabsf(pixel_pos - layer->wave.wave_positions[w]);
+    if (dist >= LED_WAVE_WIDTH)
+    {
+      continue;
+    }
+    if (exact)
+    {
+      float norm_dist = dist / LED_WAVE_WIDTH;
+      total_boost += (1.0f + cosf(norm_dist * LED_PI)) * 0.5f;
+    }
+    else
+    {
+      total_boost += raised_cosine(1.0f - dist * (1.0f / LED_WAVE_WIDTH));
+    }
   }
-  return (1.0f + cosf(normalized_dist * LED_PI)) * 0.5f;
+  return total_boost;
 }
 
-static uint8_t wave_get_pixel_boost(float pixel_pos)
+static uint8_t wave_boost_level(float total_boost)
 {
-  float total_boost = 0.0f;
-  for (int w = 0; w < LED_WAVE_COUNT; w++)
+  if (total_boost < 0.0f)
   {
-    float wave_pos = s_leds.wave.wave_positions[w];
-    float dist = fabsf(pixel_pos - wave_pos);
-    float norm_dist = dist / LED_WAVE_WIDTH;
-    total_boost += wave_pulse_intensity(norm_dist);
+    total_boost = 0.0f;
   }
   if (total_boost > 1.0f)
   {
@@ -542,154 +826,112 @@ static uint8_t wave_get_pixel_boost(float pixel_pos)
   return (uint8_t)(total_boost * LED_WAVE_PULSE_BRIGHTNESS);
 }
 
-static void wave_update_positions(void)
+static uint8_t wave_get_pixel_boost(const led_layer_t *layer, float pixel_pos)
+{
+  float estimate = wave_total_boost(layer, pixel_pos, false);
+  float margin = LED_WAVE_COUNT * LED_CURVE_MAX_ERROR;
+  uint8_t boost = wave_boost_level(estimate - margin);
+  if (boost == wave_boost_level(estimate + margin))
+  {
+    return boost;
+  }
+  return wave_boost_level(wave_total_boost(layer, pixel_pos, true));
+}
+
+static void wave_update_positions(led_layer_t *layer)
 {
   for (int i = 0; i < LED_WAVE_COUNT; i++)
   {
-    if (s_leds.wave.rising)
+    if (layer->wave.rising)
     {
-      s_leds.wave.wave_positions[i] += LED_WAVE_SPEED;
-      if (s_leds.wave.wave_positions[i] > 1.0f + LED_WAVE_WIDTH)
+      layer->wave.wave_positions[i] += LED_WAVE_SPEED;
+      if (layer->wave.wave_positions[i] > 1.0f + LED_WAVE_WIDTH)
       {
-        s_leds.wave.wave_positions[i] = -LED_WAVE_WIDTH;
+        layer->wave.wave_positions[i] = -LED_WAVE_WIDTH;
       }
     }
     else
     {
-      s_leds.wave.wave_positions[i] -= LED_WAVE_SPEED;
-      if (s_leds.wave.wave_positions[i] < -LED_WAVE_WIDTH)
+      layer->wave.wave_positions[i] -= LED_WAVE_SPEED;
+      if (layer->wave.wave_positions[i] < -LED_WAVE_WIDTH)
       {
-        s_leds.wave.wave_positions[i] = 1.0f + LED_WAVE_WIDTH;
+        layer->wave.wave_positions[i] = 1.0f + LED_WAVE_WIDTH;
       }
     }
   }
 }
 
-static void update_wave(void)
+static void update_wave(led_layer_t *layer)
 {
   thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
-  thermostat_led_color_t base = s_leds.wave.base_color;
-
-  // Fill with base color
-  for (int i = 0; i < THERMOSTAT_LED_COUNT; i++)
-  {
-    pixels[i] = base;
-  }
+  thermostat_led_color_t base = layer->wave.base_color;
 
-  // Update wave positions
-  wave_update_positions();
+  wave_update_positions(layer);
 
-  // Render left side: pixels 0-14, position 0 (bottom) to 0.5 (top)
-  for (int px = LED_LEFT_START; px <= LED_LEFT_END; px++)
+  for (int px = 0; px < THERMOSTAT_LED_COUNT; px++)
   {
-    float pixel_pos = (float)(px - LED_LEFT_START) / (LED_LEFT_END - LED_LEFT_START) * 0.5f;
-    uint8_t boost = wave_get_pixel_boost(pixel_pos);
-    if (s_leds.wave.rising)
+    uint8_t boost = wave_get_pixel_boost(layer, s_wave_pixel_pos[px][0]);
+    if (s_wave_pixel_pos[px][1] != LED_WAVE_NO_POSITION)
     {
-      // Warm tint for heat
-      pixels[px].r = saturating_add(pixels[px].r, boost);
-      pixels[px].g = saturating_add(pixels[px].g, boost * 5 / 6);
-      pixels[px].b = saturating_add(pixels[px].b, boost * 2 / 3);
+      uint8_t other = wave_get_pixel_boost(layer, s_wave_pixel_pos[px][1]);
+      boost = (other > boost) ? other : boost;
     }
-    else
-    {
-      // Cool tint for cold
-      pixels[px].r = saturating_add(pixels[px].r, boost / 2);
-      pixels[px].g = saturating_add(pixels[px].g, boost * 3 / 4);
-      pixels[px].b = saturating_add(pixels[px].b, boost);
-    }
-  }
 
-  // Render right side: pixels 38 (bottom) to 23 (top), position 0 to 0.5
-  for (int px = LED_RIGHT_START; px <= LED_RIGHT_END; px++)
-  {
-    float pixel_pos = (float)(LED_RIGHT_END - px) / (LED_RIGHT_END - LED_RIGHT_START) * 0.5f;
-    uint8_t boost = wave_get_pixel_boost(pixel_pos);
-    if (s_leds.wave.rising)
-    {
-      pixels[px].r = saturating_add(pixels[px].r, boost);
-      pixels[px].g = saturating_add(pixels[px].g, boost * 5 / 6);
-      pixels[px].b = saturating_add(pixels[px].b, boost * 2 / 3);
-    }
-    else
-    {
-      pixels[px].r = saturating_add(pixels[px].r, boost / 2);
-      pixels[px].g = saturating_add(pixels[px].g, boost * 3 / 4);
-      pixels[px].b = saturating_add(pixels[px].b, boost);
-    }
-  }
-
-  // Render top bar: pixels 15-22, position 0.5 at edges to 1.0 at center
-  float top_length = (float)(LED_TOP_END - LED_TOP_START + 1);
-  float half_top = top_length / 2.0f;
-  for (int px = LED_TOP_START; px <= LED_TOP_END; px++)
-  {
-    float px_from_left = (float)(px - LED_TOP_START);
-    float px_from_right = (float)(LED_TOP_END - px);
-
-    float left_wave_pos = 0.5f + (px_from_left / half_top) * 0.5f;
-    float right_wave_pos = 0.5f + (px_from_right / half_top) * 0.5f;
-
-    uint8_t left_boost = wave_get_pixel_boost(left_wave_pos);
-    uint8_t right_boost = wave_get_pixel_boost(right_wave_pos);
-    uint8_t boost = (left_boost > right_boost) ? left_boost : right_boost;
-
-    if (s_leds.wave.rising)
+    pixels[px] = base;
+    if (layer->wave.rising)
     {
+      // Warm tint for heat
       pixels[px].r = saturating_add(pixels[px].r, boost);
       pixels[px].g = saturating_add(pixels[px].g, boost * 5 / 6);
       pixels[px].b = saturating_add(pixels[px].b, boost * 2 / 3);
     }
     else
     {
+      // Cool tint for cold
       pixels[px].r = saturating_add(pixels[px].r, boost / 2);
       pixels[px].g = saturating_add(pixels[px].g, boost * 3 / 4);
       pixels[px].b = saturating_add(pixels[px].b, boost);
     }
   }
 
-  esp_err_t err = write_pixels(pixels, 1.0f);
-  if (err != ESP_OK)
-  {
-    ESP_LOGW(TAG, "Wave refresh failed: %s", esp_err_to_name(err));
-  }
+  layer_write_pixels(layer, pixels, 1.0f);
 }
 
-static float greeting_step(void)
+static int32_t greeting_step(void)
 {
-  float span = (float)(THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH);
-  float steps = (float)LED_GREETING_SWEEP_MS / (float)LED_TIMER_PERIOD_MS;
-  if (steps <= 0.0f)
+  int32_t span = THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH;
+  int32_t steps = LED_GREETING_SWEEP_MS / LED_TIMER_PERIOD_MS;
+  if (steps <= 0)
   {
-    steps = 1.0f;
+    steps = 1;
   }
-  if (span <= 0.0f)
+  if (span <= 0)
   {
-    span = 1.0f;
+    span = 1;
   }
-  return span / steps;
+  return (int32_t)(((int64_t)span * LED_Q16_ONE) / steps);
 }
 
-static void greeting_reset(void)
+static void greeting_reset(led_layer_t *layer)
 {
-  memset(&s_leds.greeting, 0, sizeof(s_leds.greeting));
-  s_leds.greeting.direction = 1;
-  s_leds.greeting.loops_remaining = LED_GREETING_PASSES;
-  s_leds.greeting.step = greeting_step();
+  memset(&layer->greeting, 0, sizeof(layer->greeting));
+  layer->greeting.direction = 1;
+  layer->greeting.loops_remaining = LED_GREETING_PASSES;
+  layer->greeting.step = greeting_step();
 }
 
-static void greeting_fade_pixels(void)
+static void greeting_fade_pixels(led_layer_t *layer)
 {
   for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    thermostat_led_color_t *pixel = &s_leds.greeting.pixels[i];
-    pixel->r = scale8(pixel->r, (uint8_t)LED_GREETING_TAIL_DECAY);
-    pixel->g = scale8(pixel->g, (uint8_t)LED_GREETING_TAIL_DECAY);
-    pixel->b = scale8(pixel->b, (uint8_t)LED_GREETING_TAIL_DECAY);
+    thermostat_led_color_t *pixel = &layer->greeting.pixels[i];
+    pixel->r = led_scale8(pixel->r, (uint8_t)LED_GREETING_TAIL_DECAY);
+    pixel->g = led_scale8(pixel->g, (uint8_t)LED_GREETING_TAIL_DECAY);
+    pixel->b = led_scale8(pixel->b, (uint8_t)LED_GREETING_TAIL_DECAY);
   }
 }
 
-static void greeting_paint_band(void)
+static void greeting_paint_band(led_layer_t *layer)
 {
   thermostat_led_color_t band_color = thermostat_led_color(0x8C, 0x50, 0xFF);
   int max_head = THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH;
@@ -697,7 +939,7 @@ static void greeting_paint_band(void)
   {
     max_head = 0;
   }
-  int head_index = (int)lroundf(s_leds.greeting.head_index);
+  int head_index = (layer->greeting.head_index + LED_Q16_ONE / 2) >> 16;
   if (head_index < 0)
   {
     head_index = 0;
@@ -714,104 +956,221 @@ static void greeting_paint_band(void)
     {
       break;
     }
-    s_leds.greeting.pixels[pixel_index] = band_color;
+    layer->greeting.pixels[pixel_index] = band_color;
   }
 }
 
-static void update_greeting(void)
+static void update_greeting(led_layer_t *layer)
 {
-  greeting_fade_pixels();
-  greeting_paint_band();
+  greeting_fade_pixels(layer);
+  greeting_paint_band(layer);
 
-  esp_err_t err = write_pixels(s_leds.greeting.pixels, LED_GREETING_BRIGHTNESS);
-  if (err != ESP_OK)
-  {
-    ESP_LOGW(TAG, "Greeting refresh failed: %s", esp_err_to_name(err));
-  }
+  layer_write_pixels(layer, layer->greeting.pixels, LED_GREETING_BRIGHTNESS);
 
-  float max_index = (float)(THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH);
-  if (max_index < 0.0f)
+  int32_t max_index = (THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH) * LED_Q16_ONE;
+  if (max_index < 0)
   {
-    max_index = 0.0f;
+    max_index = 0;
   }
 
-  s_leds.greeting.head_index += (float)s_leds.greeting.direction * s_leds.greeting.step;
+  layer->greeting.head_index += layer->greeting.direction * layer->greeting.step;
   bool flipped = false;
-  if (s_leds.greeting.head_index >= max_index)
+  if (layer->greeting.head_index >= max_index)
   {
-    s_leds.greeting.head_index = max_index;
-    s_leds.greeting.direction = -1;
+    layer->greeting.head_index = max_index;
+    layer->greeting.direction = -1;
     flipped = true;
   }
-  else if (s_leds.greeting.head_index <= 0.0f)
+  else if (layer->greeting.head_index <= 0)
   {
-    s_leds.greeting.head_index = 0.0f;
-    s_leds.greeting.direction = 1;
+    layer->greeting.head_index = 0;
+    layer->greeting.direction = 1;
     flipped = true;
   }
 
-  if (flipped && s_leds.greeting.loops_remaining > 0)
+  if (flipped && layer->greeting.loops_remaining > 0)
   {
-    s_leds.greeting.loops_remaining--;
+    layer->greeting.loops_remaining--;
   }
 
-  if (s_leds.greeting.loops_remaining == 0)
+  if (layer->greeting.loops_remaining == 0)
   {
-    cancel_current_effect();
+    layer_finish(layer);
   }
 }
 
-static esp_err_t write_fill(thermostat_led_color_t color, float brightness)
+// The render is not timed here: this task runs below the application tasks,
+// so wall-clock time would charge their preemption to the program. The cost
+// bound checked by led_program_load() is what keeps it inside the tick.
+static void update_program(led_layer_t *layer, int64_t now)
 {
-  if (!s_leds.available)
+  uint8_t rgb[THERMOSTAT_LED_COUNT * 3];
+  led_program_render(&layer->program.code, now - layer->program.start_time_us, s_program_pixel_pos,
+                     THERMOSTAT_LED_COUNT, rgb);
+
+  thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    return ESP_ERR_INVALID_STATE;
+    pixels[i] = thermostat_led_color(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
   }
+  layer_write_pixels(layer, pixels, 1.0f);
+}
 
-  float requested_brightness = clamp_unit(brightness);
-  float applied_brightness = apply_output_brightness_policy(requested_brightness);
-  uint32_t r = (uint32_t)lroundf((float)color.r * applied_brightness);
-  uint32_t g = (uint32_t)lroundf((float)color.g * applied_brightness);
-  uint32_t b = (uint32_t)lroundf((float)color.b * applied_brightness);
+static void update_hearth(led_layer_t *layer, int64_t now)
+{
+  uint8_t rgb[THERMOSTAT_LED_COUNT * 3];
+  led_hearth_render(&layer->hearth.noise, now - layer->hearth.start_time_us, rgb);
 
+  thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
   for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    // Strip uses GRB native ordering.
-    esp_err_t pixel_err = led_strip_set_pixel(s_leds.strip, i, g, r, b);
-    if (pixel_err != ESP_OK)
+    pixels[i] = thermostat_led_color(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+  }
+  layer_write_pixels(layer, pixels, LED_HEARTH_BRIGHTNESS);
+}
+
+static void layer_write_fill(led_layer_t *layer, thermostat_led_color_t color, float brightness)
+{
+  float applied_brightness = clamp_unit(brightness);
+  thermostat_led_color_t level = {
+      (uint8_t)lroundf((float)color.r * applied_brightness),
+      (uint8_t)lroundf((float)color.g * applied_brightness),
+      (uint8_t)lroundf((float)color.b * applied_brightness),
+  };
+
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    layer->frame[i] = level;
+  }
+  layer->latched_color = color;
+  layer->latched_brightness = applied_brightness;
+  layer->latched_pulse = false;
+}
+
+static void layer_write_pixels(led_layer_t *layer, const thermostat_led_color_t *pixels, float brightness)
+{
+  const uint8_t *lut = brightness_lut(&layer->lut, clamp_unit(brightness));
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    layer->frame[i].r = lut[pixels[i].r];
+    layer->frame[i].g = lut[pixels[i].g];
+    layer->frame[i].b = lut[pixels[i].b];
+  }
+}
+
+// value * alpha / 255, rounded; exact at both ends so an opaque layer passes
+// through unchanged.
+static uint8_t mul_div255(uint8_t value, uint8_t alpha)
+{
+  uint32_t product = (uint32_t)value * alpha + 128;
+  return (uint8_t)((product + (product >> 8)) >> 8);
+}
+
+static uint8_t blend_channel(uint8_t dst, uint8_t src, uint8_t alpha, thermostat_led_blend_t blend)
+{
+  switch (blend)
+  {
+    case THERMOSTAT_LED_BLEND_ADD:
+      return saturating_add(dst, mul_div255(src, alpha));
+    case THERMOSTAT_LED_BLEND_LIGHTEN:
     {
-      return pixel_err;
+      uint8_t weighted = mul_div255(src, alpha);
+      return (weighted > dst) ? weighted : dst;
     }
+    default:
+      return (uint8_t)(mul_div255(dst, (uint8_t)(255 - alpha)) + mul_div255(src, alpha));
   }
-  esp_err_t err = led_strip_refresh(s_leds.strip);
-  if (err == ESP_OK)
+}
+
+static void blend_layer(thermostat_led_color_t *dst, const led_layer_t *layer)
+{
+  uint8_t alpha = layer->opacity.current;
+  if (layer->blend == THERMOSTAT_LED_BLEND_NORMAL && alpha == 255)
+  {
+    memcpy(dst, layer->frame, sizeof(layer->frame));
+    return;
+  }
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    s_leds.latched_color = color;
-    s_leds.latched_brightness = requested_brightness;
+    dst[i].r = blend_channel(dst[i].r, layer->frame[i].r, alpha, layer->blend);
+    dst[i].g = blend_channel(dst[i].g, layer->frame[i].g, alpha, layer->blend);
+    dst[i].b = blend_channel(dst[i].b, layer->frame[i].b, alpha, layer->blend);
   }
-  else
+}
+
+// Blends the visible layers bottom to top and applies quiet-hours dimming to
+// the result.
+static void compose_frame(thermostat_led_color_t *frame)
+{
+  memset(frame, 0, sizeof(thermostat_led_color_t) * THERMOSTAT_LED_COUNT);
+  uint8_t layers = 0;
+  for (int i = 0; i < THERMOSTAT_LED_LAYER_COUNT; ++i)
   {
-    ESP_LOGW(TAG, "LED refresh failed (%s)", esp_err_to_name(err));
+    const led_layer_t *layer = &s_leds.layers[i];
+    if (!layer->visible || layer->opacity.current == 0)
+    {
+      continue;
+    }
+    blend_layer(frame, layer);
+    layers++;
+  }
+  if (layers > s_leds.stats.max_layers)
+  {
+    s_leds.stats.max_layers = layers;
+  }
+
+  if (quiet_hours_dimming())
+  {
+    const uint8_t *lut = brightness_lut(&s_leds.output_lut, LED_QUIET_HOURS_BRIGHTNESS);
+    for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+    {
+      frame[i].r = lut[frame[i].r];
+      frame[i].g = lut[frame[i].g];
+      frame[i].b = lut[frame[i].b];
+    }
   }
-  return err;
 }
 
-static esp_err_t write_pixels(const thermostat_led_color_t *pixels, float brightness)
+// Entries are computed exactly as the per-pixel float scaling they replace;
+// a layer's table only changes with its effect's brightness.
+static const uint8_t *brightness_lut(led_lut_t *lut, float brightness)
 {
-  if (!s_leds.available)
+  if (!lut->valid || lut->brightness != brightness)
   {
-    return ESP_ERR_INVALID_STATE;
+    for (int i = 0; i < 256; ++i)
+    {
+      lut->level[i] = (uint8_t)lroundf((float)i * brightness);
+    }
+    lut->brightness = brightness;
+    lut->valid = true;
+  }
+  return lut->level;
+}
+
+// Sends a scaled frame. Pixels that match the last flushed frame are not
+// re-staged, and an identical frame skips the RMT transfer entirely (pulse
+// troughs, drained sparkles, finished fades).
+static esp_err_t flush_frame(const thermostat_led_color_t *frame)
+{
+  if (s_leds.flushed.valid && memcmp(frame, s_leds.flushed.pixels, sizeof(s_leds.flushed.pixels)) == 0)
+  {
+    s_leds.stats.unchanged++;
+    return ESP_OK;
   }
 
-  float applied_brightness = apply_output_brightness_policy(brightness);
   for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
   {
-    uint32_t r = (uint32_t)lroundf((float)pixels[i].r * applied_brightness);
-    uint32_t g = (uint32_t)lroundf((float)pixels[i].g * applied_brightness);
-    uint32_t b = (uint32_t)lroundf((float)pixels[i].b * applied_brightness);
-    esp_err_t pixel_err = led_strip_set_pixel(s_leds.strip, i, g, r, b);
+    const thermostat_led_color_t *px = &frame[i];
+    const thermostat_led_color_t *prev = &s_leds.flushed.pixels[i];
+    if (s_leds.flushed.valid && px->r == prev->r && px->g == prev->g && px->b == prev->b)
+    {
+      continue;
+    }
+    // Strip uses GRB native ordering.
+    esp_err_t pixel_err = led_strip_set_pixel(s_leds.strip, i, px->g, px->r, px->b);
     if (pixel_err != ESP_OK)
     {
+      s_leds.flushed.valid = false;
       return pixel_err;
     }
   }
@@ -819,9 +1178,14 @@ static esp_err_t write_pixels(const thermostat_led_color_t *pixels, float bright
   esp_err_t err = led_strip_refresh(s_leds.strip);
   if (err != ESP_OK)
   {
+    s_leds.flushed.valid = false;
     ESP_LOGW(TAG, "LED refresh failed (%s)", esp_err_to_name(err));
+    return err;
   }
-  return err;
+  memcpy(s_leds.flushed.pixels, frame, sizeof(s_leds.flushed.pixels));
+  s_leds.flushed.valid = true;
+  s_leds.stats.refreshes++;
+  return ESP_OK;
 }
 
 esp_err_t thermostat_leds_init(void)
@@ -879,12 +1243,51 @@ esp_err_t thermostat_leds_init(void)
     err = ESP_FAIL;
     goto cleanup;
   }
+  if (!s_layers_mutex)
+  {
+    s_layers_mutex = xSemaphoreCreateMutex();
+    if (!s_layers_mutex)
+    {
+      ESP_LOGE(TAG, "Failed to create LED layer mutex");
+      err = ESP_ERR_NO_MEM;
+      goto cleanup;
+    }
+  }
+  if (!s_leds.render.task)
+  {
+    BaseType_t task_ok = xTaskCreatePinnedToCoreWithCaps(led_render_task,
+                                                         "led_render",
+                                                         LED_RENDER_TASK_STACK,
+                                                         NULL,
+                                                         LED_RENDER_TASK_PRIO,
+                                                         &s_leds.render.task,
+                                                         tskNO_AFFINITY,
+                                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (task_ok != pdPASS)
+    {
+      ESP_LOGE(TAG, "Failed to create LED render task");
+      s_leds.render.task = NULL;
+      err = ESP_ERR_NO_MEM;
+      goto cleanup;
+    }
+  }
+
+  build_curve_tables();
+  memset(&s_leds.flushed, 0, sizeof(s_leds.flushed));
+  s_leds.flushed.valid = true;  // led_strip_clear() above
+
+  // The base layer is always present (black after the clear above) and
+  // opaque; overlays appear only while something plays on them.
+  memset(s_leds.layers, 0, sizeof(s_leds.layers));
+  for (int i = 0; i < THERMOSTAT_LED_LAYER_COUNT; ++i)
+  {
+    s_leds.layers[i].blend = THERMOSTAT_LED_BLEND_NORMAL;
+  }
+  base_layer()->visible = true;
+  base_layer()->opacity.current = 255;
 
   s_leds.initialized = true;
   s_leds.available = true;
-  s_leds.effect = LED_EFFECT_IDLE;
-  s_leds.latched_color = thermostat_led_color(0, 0, 0);
-  s_leds.latched_brightness = 0.0f;
   s_leds.quiet_gate_active = false;
 
   ESP_LOGI(TAG, "LED strip ready on GPIO %d", CONFIG_THEO_LED_STRIP_GPIO);
@@ -914,28 +1317,23 @@ void thermostat_leds_notify_boot_complete(void)
   }
 }
 
+// Called with the layer mutex held.
 static esp_err_t start_fade(thermostat_led_color_t color, float start_brightness, float target_brightness, uint32_t fade_ms, led_easing_t easing)
 {
-  if (!s_leds.available)
-  {
-    return ESP_ERR_INVALID_STATE;
-  }
-
   if (fade_ms < LED_MIN_FADE_DURATION_MS)
   {
     fade_ms = LED_MIN_FADE_DURATION_MS;
   }
 
-  cancel_current_effect();
-  s_leds.effect = LED_EFFECT_FADE;
-  s_leds.fade.color = color;
-  s_leds.fade.start_brightness = clamp_unit(start_brightness);
-  s_leds.fade.target_brightness = clamp_unit(target_brightness);
-  s_leds.fade.start_time_us = esp_timer_get_time();
-  s_leds.fade.duration_us = (int64_t)fade_ms * 1000;
-  s_leds.fade.easing = easing;
+  led_layer_t *layer = layer_begin(THERMOSTAT_LED_LAYER_BASE, LED_EFFECT_FADE);
+  layer->fade.color = color;
+  layer->fade.start_brightness = clamp_unit(start_brightness);
+  layer->fade.target_brightness = clamp_unit(target_brightness);
+  layer->fade.start_time_us = esp_timer_get_time();
+  layer->fade.duration_us = (int64_t)fade_ms * 1000;
+  layer->fade.easing = easing;
 
-  write_fill(color, s_leds.fade.start_brightness);
+  layer_write_fill(layer, color, layer->fade.start_brightness);
   start_timer();
   return ESP_OK;
 }
@@ -956,7 +1354,10 @@ esp_err_t thermostat_leds_solid_with_fade(thermostat_led_color_t color, uint32_t
   }
 
   ESP_LOGD(TAG, "LED fade to #%02x%02x%02x over %ums", color.r, color.g, color.b, (unsigned)fade_ms);
-  return start_fade(color, 0.0f, 1.0f, fade_ms, LED_EASING_LINEAR);
+  layers_lock();
+  err = start_fade(color, 0.0f, 1.0f, fade_ms, LED_EASING_LINEAR);
+  layers_unlock();
+  return err;
 }
 
 esp_err_t thermostat_leds_solid_with_fade_brightness(thermostat_led_color_t color, uint32_t fade_ms,
@@ -977,7 +1378,10 @@ esp_err_t thermostat_leds_solid_with_fade_brightness(thermostat_led_color_t colo
 
   ESP_LOGD(TAG, "LED fade to #%02x%02x%02x @ %.0f%% over %ums", color.r, color.g, color.b,
            brightness * 100.0f, (unsigned)fade_ms);
-  return start_fade(color, 0.0f, brightness, fade_ms, LED_EASING_LINEAR);
+  layers_lock();
+  err = start_fade(color, 0.0f, brightness, fade_ms, LED_EASING_LINEAR);
+  layers_unlock();
+  return err;
 }
 
 esp_err_t thermostat_leds_off_with_fade(uint32_t fade_ms)
@@ -988,7 +1392,12 @@ esp_err_t thermostat_leds_off_with_fade(uint32_t fade_ms)
   }
 
   ESP_LOGD(TAG, "LED fade to black (ease-in) over %ums", (unsigned)fade_ms);
-  return start_fade(s_leds.latched_color, s_leds.latched_brightness, 0.0f, fade_ms, LED_EASING_EASE_IN);
+  layers_lock();
+  led_layer_t *base = base_layer();
+  esp_err_t err = start_fade(base->latched_color, layer_latched_brightness(base), 0.0f, fade_ms,
+                             LED_EASING_EASE_IN);
+  layers_unlock();
+  return err;
 }
 
 esp_err_t thermostat_leds_off_with_fade_eased(uint32_t fade_ms)
@@ -999,16 +1408,26 @@ esp_err_t thermostat_leds_off_with_fade_eased(uint32_t fade_ms)
   }
 
   ESP_LOGD(TAG, "LED fade to black (ease-out) over %ums", (unsigned)fade_ms);
-  return start_fade(s_leds.latched_color, s_leds.latched_brightness, 0.0f, fade_ms, LED_EASING_EASE_OUT);
+  layers_lock();
+  led_layer_t *base = base_layer();
+  esp_err_t err = start_fade(base->latched_color, layer_latched_brightness(base), 0.0f, fade_ms,
+                             LED_EASING_EASE_OUT);
+  layers_unlock();
+  return err;
 }
 
 esp_err_t thermostat_leds_pulse(thermostat_led_color_t color, float hz)
+{
+  return thermostat_leds_pulse_on(THERMOSTAT_LED_LAYER_BASE, color, hz);
+}
+
+esp_err_t thermostat_leds_pulse_on(thermostat_led_layer_t layer_id, thermostat_led_color_t color, float hz)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
-  if (hz <= 0.0f)
+  if (!layer_id_valid(layer_id) || hz <= 0.0f)
   {
     return ESP_ERR_INVALID_ARG;
   }
@@ -1021,22 +1440,32 @@ esp_err_t thermostat_leds_pulse(thermostat_led_color_t color, float hz)
     return err;
   }
 
-  ESP_LOGD(TAG, "LED pulse #%02x%02x%02x @ %.2f Hz", color.r, color.g, color.b, hz);
-  cancel_current_effect();
-  s_leds.effect = LED_EFFECT_PULSE;
-  s_leds.pulse.color = color;
-  s_leds.pulse.hz = hz;
-  s_leds.pulse.start_time_us = esp_timer_get_time();
+  ESP_LOGD(TAG, "LED pulse #%02x%02x%02x @ %.2f Hz (layer %d)", color.r, color.g, color.b, hz, (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_PULSE);
+  layer->pulse.color = color;
+  layer->pulse.hz = hz;
+  layer->pulse.start_time_us = esp_timer_get_time();
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
 esp_err_t thermostat_leds_start_sparkle(void)
+{
+  return thermostat_leds_start_sparkle_on(THERMOSTAT_LED_LAYER_BASE);
+}
+
+esp_err_t thermostat_leds_start_sparkle_on(thermostat_led_layer_t layer_id)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
 
   esp_err_t err = guard_output("LED sparkle");
   if (err != ESP_OK)
@@ -1044,20 +1473,30 @@ esp_err_t thermostat_leds_start_sparkle(void)
     return err;
   }
 
-  ESP_LOGD(TAG, "LED sparkle start");
-  cancel_current_effect();
-  sparkle_reset();
-  s_leds.effect = LED_EFFECT_SPARKLE;
+  ESP_LOGD(TAG, "LED sparkle start (layer %d)", (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_SPARKLE);
+  sparkle_reset(layer);
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
 esp_err_t thermostat_leds_rainbow(void)
+{
+  return thermostat_leds_rainbow_on(THERMOSTAT_LED_LAYER_BASE);
+}
+
+esp_err_t thermostat_leds_rainbow_on(thermostat_led_layer_t layer_id)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
 
   esp_err_t err = guard_output("LED rainbow");
   if (err != ESP_OK)
@@ -1065,29 +1504,39 @@ esp_err_t thermostat_leds_rainbow(void)
     return err;
   }
 
-  ESP_LOGD(TAG, "LED rainbow start");
-  cancel_current_effect();
-  s_leds.rainbow.hue_offset = 0;
-  s_leds.effect = LED_EFFECT_RAINBOW;
+  ESP_LOGD(TAG, "LED rainbow start (layer %d)", (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_RAINBOW);
+  layer->rainbow.hue_offset = 0;
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
-static void wave_init_positions(void)
+static void wave_init_positions(led_layer_t *layer)
 {
   float spacing = (1.0f + 2 * LED_WAVE_WIDTH) / LED_WAVE_COUNT;
   for (int i = 0; i < LED_WAVE_COUNT; i++)
   {
-    s_leds.wave.wave_positions[i] = -LED_WAVE_WIDTH + i * spacing;
+    layer->wave.wave_positions[i] = -LED_WAVE_WIDTH + i * spacing;
   }
 }
 
 esp_err_t thermostat_leds_wave_rising(thermostat_led_color_t color)
+{
+  return thermostat_leds_wave_rising_on(THERMOSTAT_LED_LAYER_BASE, color);
+}
+
+esp_err_t thermostat_leds_wave_rising_on(thermostat_led_layer_t layer_id, thermostat_led_color_t color)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
 
   char cue[32];
   format_cue_desc(cue, sizeof(cue), "LED wave rise", color);
@@ -1097,22 +1546,32 @@ esp_err_t thermostat_leds_wave_rising(thermostat_led_color_t color)
     return err;
   }
 
-  ESP_LOGD(TAG, "LED wave rising #%02x%02x%02x", color.r, color.g, color.b);
-  cancel_current_effect();
-  s_leds.wave.base_color = color;
-  s_leds.wave.rising = true;
-  wave_init_positions();
-  s_leds.effect = LED_EFFECT_WAVE;
+  ESP_LOGD(TAG, "LED wave rising #%02x%02x%02x (layer %d)", color.r, color.g, color.b, (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_WAVE);
+  layer->wave.base_color = color;
+  layer->wave.rising = true;
+  wave_init_positions(layer);
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
 esp_err_t thermostat_leds_wave_falling(thermostat_led_color_t color)
+{
+  return thermostat_leds_wave_falling_on(THERMOSTAT_LED_LAYER_BASE, color);
+}
+
+esp_err_t thermostat_leds_wave_falling_on(thermostat_led_layer_t layer_id, thermostat_led_color_t color)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
 
   char cue[32];
   format_cue_desc(cue, sizeof(cue), "LED wave fall", color);
@@ -1122,28 +1581,98 @@ esp_err_t thermostat_leds_wave_falling(thermostat_led_color_t color)
     return err;
   }
 
-  ESP_LOGD(TAG, "LED wave falling #%02x%02x%02x", color.r, color.g, color.b);
-  cancel_current_effect();
-  s_leds.wave.base_color = color;
-  s_leds.wave.rising = false;
-  wave_init_positions();
-  s_leds.effect = LED_EFFECT_WAVE;
+  ESP_LOGD(TAG, "LED wave falling #%02x%02x%02x (layer %d)", color.r, color.g, color.b, (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_WAVE);
+  layer->wave.base_color = color;
+  layer->wave.rising = false;
+  wave_init_positions(layer);
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
 esp_err_t thermostat_leds_start_greeting(void)
+{
+  return thermostat_leds_start_greeting_on(THERMOSTAT_LED_LAYER_BASE);
+}
+
+esp_err_t thermostat_leds_start_greeting_on(thermostat_led_layer_t layer_id)
+{
+  if (!s_leds.available)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  ESP_LOGD(TAG, "LED greeting triggered (layer %d)", (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_GREETING);
+  greeting_reset(layer);
+  start_timer();
+  layers_unlock();
+  return ESP_OK;
+}
+
+esp_err_t thermostat_leds_program_on(thermostat_led_layer_t layer_id, const led_program_t *program)
+{
+  if (!s_leds.available)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!layer_id_valid(layer_id) || program == NULL || program->code_len == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = guard_output("LED program");
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  ESP_LOGD(TAG, "LED program start cost=%u (layer %d)", (unsigned)program->cost, (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_PROGRAM);
+  layer->program.code = *program;
+  layer->program.start_time_us = esp_timer_get_time();
+  start_timer();
+  layers_unlock();
+  return ESP_OK;
+}
+
+esp_err_t thermostat_leds_hearth_glow(void)
+{
+  return thermostat_leds_hearth_glow_on(THERMOSTAT_LED_LAYER_BASE);
+}
+
+esp_err_t thermostat_leds_hearth_glow_on(thermostat_led_layer_t layer_id)
 {
   if (!s_leds.available)
   {
     return ESP_ERR_INVALID_STATE;
   }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
 
-  ESP_LOGD(TAG, "LED greeting triggered");
-  cancel_current_effect();
-  greeting_reset();
-  s_leds.effect = LED_EFFECT_GREETING;
+  esp_err_t err = guard_output("LED hearth glow");
+  if (err != ESP_OK)
+  {
+    return err;
+  }
+
+  ESP_LOGD(TAG, "LED hearth glow start (layer %d)", (int)layer_id);
+  layers_lock();
+  led_layer_t *layer = layer_begin(layer_id, LED_EFFECT_HEARTH);
+  led_hearth_init(&layer->hearth.noise, THERMOSTAT_LED_COUNT, esp_random());
+  layer->hearth.start_time_us = esp_timer_get_time();
   start_timer();
+  layers_unlock();
   return ESP_OK;
 }
 
@@ -1153,106 +1682,363 @@ void thermostat_leds_stop_animation(void)
   {
     return;
   }
-  if (s_leds.effect == LED_EFFECT_SPARKLE)
+  layers_lock();
+  led_layer_t *base = base_layer();
+  if (base->effect == LED_EFFECT_SPARKLE)
   {
-    if (!s_leds.sparkle.stop_requested)
+    if (!base->sparkle.stop_requested)
     {
-      s_leds.sparkle.stop_requested = true;
+      base->sparkle.stop_requested = true;
       ESP_LOGD(TAG, "Sparkle drain requested");
     }
-    return;
   }
-  cancel_current_effect();
+  else
+  {
+    layer_cancel(base);
+  }
+  layers_unlock();
 }
 
 bool thermostat_leds_is_animating(void)
 {
-  return s_leds.available && s_leds.effect != LED_EFFECT_IDLE;
+  return s_leds.available && base_layer()->effect != LED_EFFECT_IDLE;
 }
 
-static void complete_fade_if_done(int64_t now)
+esp_err_t thermostat_leds_layer_configure(thermostat_led_layer_t layer_id, thermostat_led_blend_t blend,
+                                          uint32_t attack_ms, uint32_t release_ms)
 {
-  if (s_leds.effect != LED_EFFECT_FADE)
+  if (!s_leds.available)
   {
-    return;
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!layer_id_valid(layer_id) || (unsigned)blend > THERMOSTAT_LED_BLEND_LIGHTEN)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  layers_lock();
+  led_layer_t *layer = &s_leds.layers[layer_id];
+  layer->blend = blend;
+  layer->attack_ms = attack_ms;
+  layer->release_ms = release_ms;
+  layers_unlock();
+  return ESP_OK;
+}
+
+esp_err_t thermostat_leds_layer_release(thermostat_led_layer_t layer_id)
+{
+  if (!s_leds.available)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!layer_id_valid(layer_id))
+  {
+    return ESP_ERR_INVALID_ARG;
   }
 
-  int64_t elapsed = now - s_leds.fade.start_time_us;
+  layers_lock();
+  led_layer_t *layer = &s_leds.layers[layer_id];
+  if (layer->visible)
+  {
+    ESP_LOGD(TAG, "LED layer %d release over %ums", (int)layer_id, (unsigned)layer->release_ms);
+    layer_release(layer);
+    start_timer();
+  }
+  layers_unlock();
+  return ESP_OK;
+}
+
+bool thermostat_leds_layer_active(thermostat_led_layer_t layer_id)
+{
+  return s_leds.available && layer_id_valid(layer_id) && s_leds.layers[layer_id].visible;
+}
+
+static void complete_fade_if_done(led_layer_t *layer, int64_t now)
+{
+  int64_t elapsed = now - layer->fade.start_time_us;
   if (elapsed < 0)
   {
     elapsed = 0;
   }
 
-  float progress = (float)elapsed / (float)s_leds.fade.duration_us;
+  float progress = (float)elapsed / (float)layer->fade.duration_us;
   if (progress > 1.0f)
   {
     progress = 1.0f;
   }
 
-  float eased_progress = apply_easing(progress, s_leds.fade.easing);
-  float brightness = s_leds.fade.start_brightness + (s_leds.fade.target_brightness - s_leds.fade.start_brightness) * eased_progress;
-  write_fill(s_leds.fade.color, brightness);
+  float eased_progress = apply_easing(progress, layer->fade.easing);
+  float brightness = layer->fade.start_brightness + (layer->fade.target_brightness - layer->fade.start_brightness) * eased_progress;
+  layer_write_fill(layer, layer->fade.color, brightness);
 
   if (progress >= 1.0f)
   {
-    if (s_leds.fade.target_brightness == 0.0f)
+    if (layer->fade.target_brightness == 0.0f)
     {
-      s_leds.latched_color = thermostat_led_color(0, 0, 0);
+      layer->latched_color = thermostat_led_color(0, 0, 0);
     }
-    cancel_current_effect();
+    layer_finish(layer);
   }
 }
 
-static void update_pulse(int64_t now)
+// 0.5 - 0.5 * cos(2 * pi * phase), as the float code computed it.
+static float pulse_brightness(float phase)
 {
-  if (s_leds.effect != LED_EFFECT_PULSE)
-  {
-    return;
-  }
+  return clamp_unit(0.5f - 0.5f * cosf(phase * 2.0f * LED_PI));
+}
 
-  float elapsed_s = (float)(now - s_leds.pulse.start_time_us) / 1000000.0f;
+static void update_pulse(led_layer_t *layer, int64_t now)
+{
+  float elapsed_s = (float)(now - layer->pulse.start_time_us) / 1000000.0f;
   if (elapsed_s < 0.0f)
   {
     elapsed_s = 0.0f;
   }
 
-  float period = 1.0f / s_leds.pulse.hz;
+  float period = 1.0f / layer->pulse.hz;
   if (period <= 0.0f)
   {
     period = 1.0f;
   }
 
+  // The pulse curve is the raised cosine rising over the first half-period
+  // and mirrored over the second.
   float phase = fmodf(elapsed_s, period) / period;
-  float brightness = 0.5f - 0.5f * cosf(phase * 2.0f * LED_PI);
-  write_fill(s_leds.pulse.color, brightness);
+  float brightness = raised_cosine((phase <= 0.5f) ? phase * 2.0f : (1.0f - phase) * 2.0f);
+  thermostat_led_color_t color = layer->pulse.color;
+  if (!level_settled(color.r, brightness) || !level_settled(color.g, brightness) ||
+      !level_settled(color.b, brightness))
+  {
+    brightness = pulse_brightness(phase);
+  }
+  layer_write_fill(layer, color, brightness);
+  layer->latched_phase = phase;
+  layer->latched_pulse = true;
 }
 
+// The level a fade to black starts from. A pulse's tabulated brightness only
+// has to round right, so its exact value is worked out here, once.
+static float layer_latched_brightness(const led_layer_t *layer)
+{
+  if (layer->latched_pulse)
+  {
+    return pulse_brightness(layer->latched_phase);
+  }
+  return layer->latched_brightness;
+}
+
+// Runs in the shared esp_timer task, so it only hands the tick to the render
+// task; rendering and the RMT transfer never delay other timers.
 static void led_effect_timer(void *arg)
 {
   int64_t now = esp_timer_get_time();
-  if (s_leds.effect == LED_EFFECT_FADE)
+  taskENTER_CRITICAL(&s_render_lock);
+  s_leds.render.tick_us = now;
+  taskEXIT_CRITICAL(&s_render_lock);
+  xTaskNotifyGive(s_leds.render.task);
+}
+
+static void led_render_task(void *arg)
+{
+  for (;;)
   {
-    complete_fade_if_done(now);
+    uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (ticks > 0)
+    {
+      service_tick(ticks);
+    }
   }
-  else if (s_leds.effect == LED_EFFECT_PULSE)
+}
+
+// Vsync-style pacing: the frame prepared during the previous period goes out
+// as soon as the tick arrives, then the next one is rendered for the
+// following tick. What reaches the strip is therefore one period behind the
+// effect state, but its timing no longer depends on how long rendering took.
+//
+// The RMT transfer runs outside the layer mutex. The idle check and the timer
+// stop share one hold of it, so a start_timer() from an effect that began in
+// between cannot be undone.
+static void service_tick(uint32_t ticks)
+{
+  taskENTER_CRITICAL(&s_render_lock);
+  int64_t tick_us = s_leds.render.tick_us;
+  taskEXIT_CRITICAL(&s_render_lock);
+
+  if (!s_leds.render.next_ready)
   {
-    update_pulse(now);
+    // First tick after the timer started; nothing was rendered ahead.
+    layers_lock();
+    render_frame(tick_us, s_leds.render.next);
+    layers_unlock();
   }
-  else if (s_leds.effect == LED_EFFECT_SPARKLE)
+  commit_frame(tick_us, ticks);
+
+  layers_lock();
+  if (any_layer_animating())
   {
-    update_sparkle();
+    prepare_next_frame(tick_us);
   }
-  else if (s_leds.effect == LED_EFFECT_RAINBOW)
+  else
   {
-    update_rainbow();
+    stop_timer();
   }
-  else if (s_leds.effect == LED_EFFECT_WAVE)
+  layers_unlock();
+}
+
+// Advances every layer to frame_us and composites the result. Returns true
+// while any layer still needs further frames.
+static bool render_frame(int64_t frame_us, thermostat_led_color_t *frame)
+{
+  roll_effect_stats(top_effect());
+
+  bool animating = false;
+  for (int i = 0; i < THERMOSTAT_LED_LAYER_COUNT; ++i)
   {
-    update_wave();
+    led_layer_t *layer = &s_leds.layers[i];
+    switch (layer->effect)
+    {
+      case LED_EFFECT_FADE:
+        complete_fade_if_done(layer, frame_us);
+        break;
+      case LED_EFFECT_PULSE:
+        update_pulse(layer, frame_us);
+        break;
+      case LED_EFFECT_SPARKLE:
+        update_sparkle(layer);
+        break;
+      case LED_EFFECT_RAINBOW:
+        update_rainbow(layer);
+        break;
+      case LED_EFFECT_WAVE:
+        update_wave(layer);
+        break;
+      case LED_EFFECT_GREETING:
+        update_greeting(layer);
+        break;
+      case LED_EFFECT_PROGRAM:
+        update_program(layer, frame_us);
+        break;
+      case LED_EFFECT_HEARTH:
+        update_hearth(layer, frame_us);
+        break;
+      default:
+        break;
+    }
+    layer_update_opacity(layer, frame_us);
+    animating = animating || layer_animating(layer);
   }
 
-  if (s_leds.effect == LED_EFFECT_IDLE)
+  compose_frame(frame);
+  return animating;
+}
+
+static void prepare_next_frame(int64_t tick_us)
+{
+  const int64_t deadline_us = tick_us + LED_TIMER_PERIOD_US;
+  int64_t started_us = esp_timer_get_time();
+  render_frame(deadline_us, s_leds.render.next);
+  s_leds.render.next_ready = true;
+
+  int64_t finished_us = esp_timer_get_time();
+  uint32_t render_us = (uint32_t)(finished_us - started_us);
+  s_leds.stats.ticks++;
+  s_leds.stats.total_us += render_us;
+  if (render_us > s_leds.stats.max_us)
   {
-    stop_timer();
+    s_leds.stats.max_us = render_us;
+  }
+  // The frame was not ready when its tick fired; it goes out late.
+  if (finished_us > deadline_us)
+  {
+    s_leds.stats.overruns++;
+  }
+}
+
+// Jitter is how late the frame left relative to its tick: scheduling delay of
+// this task plus any overrun of the previous render.
+static void commit_frame(int64_t tick_us, uint32_t ticks)
+{
+  int64_t started_us = esp_timer_get_time();
+  flush_frame(s_leds.render.next);
+  s_leds.render.next_ready = false;
+  uint32_t commit_us = (uint32_t)(esp_timer_get_time() - started_us);
+
+  uint32_t jitter_us = (started_us > tick_us) ? (uint32_t)(started_us - tick_us) : 0;
+  s_leds.stats.commits++;
+  s_leds.stats.jitter_total_us += jitter_us;
+  if (jitter_us > s_leds.stats.jitter_max_us)
+  {
+    s_leds.stats.jitter_max_us = jitter_us;
+  }
+  if (commit_us > s_leds.stats.commit_max_us)
+  {
+    s_leds.stats.commit_max_us = commit_us;
+  }
+  // Ticks that arrived while this task was busy or starved had no frame of
+  // their own.
+  s_leds.stats.skipped += ticks - 1;
+}
+
+static bool any_layer_animating(void)
+{
+  for (int i = 0; i < THERMOSTAT_LED_LAYER_COUNT; ++i)
+  {
+    if (layer_animating(&s_leds.layers[i]))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Stats are attributed to the topmost running effect, which is the one a
+// stall would be noticed on.
+static led_effect_type_t top_effect(void)
+{
+  for (int i = THERMOSTAT_LED_LAYER_COUNT - 1; i >= 0; --i)
+  {
+    if (s_leds.layers[i].effect != LED_EFFECT_IDLE)
+    {
+      return s_leds.layers[i].effect;
+    }
+  }
+  return LED_EFFECT_IDLE;
+}
+
+static void roll_effect_stats(led_effect_type_t effect)
+{
+  if (s_leds.stats.effect == effect && s_leds.stats.ticks < LED_STATS_LOG_TICKS)
+  {
+    return;
+  }
+  log_effect_stats();
+  memset(&s_leds.stats, 0, sizeof(s_leds.stats));
+  s_leds.stats.effect = effect;
+}
+
+static void log_effect_stats(void)
+{
+  static const char *const names[] = {
+      "idle", "pulse", "fade", "sparkle", "rainbow", "wave", "greeting", "program", "hearth"};
+  if (s_leds.stats.ticks == 0)
+  {
+    return;
   }
+  // avg_us/max_us cover rendering only; the RMT transfer is in commit_max_us.
+  uint32_t commits = s_leds.stats.commits ? s_leds.stats.commits : 1;
+  ESP_LOGI(TAG,
+           "led_effect_stats effect=%s ticks=%u avg_us=%u max_us=%u commit_max_us=%u jitter_avg_us=%u "
+           "jitter_max_us=%u overruns=%u skipped=%u refreshes=%u unchanged=%u layers=%u",
+           names[s_leds.stats.effect],
+           (unsigned)s_leds.stats.ticks,
+           (unsigned)(s_leds.stats.total_us / s_leds.stats.ticks),
+           (unsigned)s_leds.stats.max_us,
+           (unsigned)s_leds.stats.commit_max_us,
+           (unsigned)(s_leds.stats.jitter_total_us / commits),
+           (unsigned)s_leds.stats.jitter_max_us,
+           (unsigned)s_leds.stats.overruns,
+           (unsigned)s_leds.stats.skipped,
+           (unsigned)s_leds.stats.refreshes,
+           (unsigned)s_leds.stats.unchanged,
+           (unsigned)s_leds.stats.max_layers);
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "esp_err.h"
+#include "thermostat/led_program.h"
 
 typedef struct
 {
@@ -18,10 +19,29 @@ static inline thermostat_led_color_t thermostat_led_color(uint8_t r, uint8_t g,
   return color;
 }
 
+// Effects run on layers that are composited bottom to top into one frame per
+// tick. The base layer carries the long-lived state (boot sequence, HVAC
+// waves, bias lighting); cues and alerts play over it without stopping it.
+typedef enum
+{
+  THERMOSTAT_LED_LAYER_BASE = 0,
+  THERMOSTAT_LED_LAYER_CUE,
+  THERMOSTAT_LED_LAYER_ALERT,
+  THERMOSTAT_LED_LAYER_COUNT,
+} thermostat_led_layer_t;
+
+typedef enum
+{
+  THERMOSTAT_LED_BLEND_NORMAL = 0,  // cross-fade to the layer by its opacity
+  THERMOSTAT_LED_BLEND_ADD,         // saturating add; black is transparent
+  THERMOSTAT_LED_BLEND_LIGHTEN,     // per-channel max; black is transparent
+} thermostat_led_blend_t;
+
 esp_err_t thermostat_leds_init(void);
 bool thermostat_leds_available(void);
 void thermostat_leds_notify_boot_complete(void);
 
+// Base-layer effects.
 esp_err_t thermostat_leds_pulse(thermostat_led_color_t color, float hz);
 esp_err_t thermostat_leds_solid_with_fade(thermostat_led_color_t color, uint32_t fade_ms);
 esp_err_t thermostat_leds_solid_with_fade_brightness(thermostat_led_color_t color, uint32_t fade_ms,
@@ -33,5 +53,38 @@ esp_err_t thermostat_leds_rainbow(void);
 esp_err_t thermostat_leds_wave_rising(thermostat_led_color_t color);
 esp_err_t thermostat_leds_wave_falling(thermostat_led_color_t color);
 esp_err_t thermostat_leds_start_greeting(void);
+esp_err_t thermostat_leds_hearth_glow(void);
 void thermostat_leds_stop_animation(void);
 bool thermostat_leds_is_animating(void);
+
+/**
+ * @brief Sets how a layer is blended and how fast its opacity ramps.
+ *
+ * Takes effect for the next effect started on the layer. Starting an effect
+ * ramps the layer's opacity up over attack_ms; releasing it (or an overlay
+ * effect finishing on its own) ramps it down over release_ms and then clears
+ * the layer. The base layer defaults to NORMAL with no ramps, which is the
+ * single-effect behaviour of the base-layer functions above.
+ */
+esp_err_t thermostat_leds_layer_configure(thermostat_led_layer_t layer, thermostat_led_blend_t blend,
+                                          uint32_t attack_ms, uint32_t release_ms);
+esp_err_t thermostat_leds_layer_release(thermostat_led_layer_t layer);
+bool thermostat_leds_layer_active(thermostat_led_layer_t layer);
+
+// The same effects on a chosen layer.
+esp_err_t thermostat_leds_pulse_on(thermostat_led_layer_t layer, thermostat_led_color_t color, float hz);
+esp_err_t thermostat_leds_start_sparkle_on(thermostat_led_layer_t layer);
+esp_err_t thermostat_leds_rainbow_on(thermostat_led_layer_t layer);
+esp_err_t thermostat_leds_wave_rising_on(thermostat_led_layer_t layer, thermostat_led_color_t color);
+esp_err_t thermostat_leds_wave_falling_on(thermostat_led_layer_t layer, thermostat_led_color_t color);
+esp_err_t thermostat_leds_start_greeting_on(thermostat_led_layer_t layer);
+esp_err_t thermostat_leds_hearth_glow_on(thermostat_led_layer_t layer);
+
+/**
+ * @brief Plays a loaded LED program on a layer until it is replaced or
+ *        released.
+ *
+ * The program is copied, so the caller's copy may go away. It is not timed
+ * while it plays; the cost bound checked by led_program_load() is the limit.
+ */
+esp_err_t thermostat_leds_program_on(thermostat_led_layer_t layer, const led_program_t *program);
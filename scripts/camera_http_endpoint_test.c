@@ -0,0 +1,919 @@
+/*
+ * Host tests for the camera HTTP endpoint (main/streaming/camera_http_endpoint.c).
+ *
+ * The endpoint's URI handlers run against a stand-in for esp_http_server that
+ * records each response (status, headers, body), can stall sends like a slow
+ * viewer and can fail them like a closed one. Frames come from a synthetic
+ * source whose slots follow the snapshot publisher's rules, and streams run
+ * on tasks from the scripts/host shims. Covered:
+ *
+ * - a snapshot of the latest frame, served to several clients from the slot
+ *   itself rather than a copy
+ * - 503 with Retry-After when no frame shows up within the wait
+ * - stream framing, with every new frame sent once and in order
+ * - the concurrent stream cap, and a closed viewer ending its stream
+ * - the idle timeout ending a stream once the camera stops
+ * - slow viewers: readers pin at most MAX_STREAMS + 1 slots, so the
+ *   publisher's 2 + MAX_STREAMS + 1 slots keep the encoder going, where the
+ *   old count of 3 starved it
+ *
+ * Every test also checks that each reference taken was released.
+ *
+ *   cc -O1 -g -fsanitize=address,undefined -Iscripts/host/include -Imain scripts/camera_http_endpoint_test.c \
+ *     scripts/host/idf_shim.c main/streaming/camera_http_endpoint.c -lpthread -o /tmp/camera_http_endpoint_test
+ *   /tmp/camera_http_endpoint_test
+ *
+ * Takes about 12 s, mostly the snapshot wait and the stream idle timeout.
+ * Exits non-zero on any failure.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "connectivity/http_server.h"
+#include "streaming/camera_http_endpoint.h"
+
+#define TEST_MAX_STREAMS        (CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS)
+// CAMERA_SNAPSHOT_JPEG_SLOTS with the HTTP endpoint enabled, and before.
+#define TEST_PUBLISHER_SLOTS    (2 + TEST_MAX_STREAMS + 1)
+#define TEST_OLD_SLOTS          (3)
+#define TEST_MAX_SLOTS          (8)
+#define TEST_MAX_HANDLERS       (4)
+#define TEST_FRAME_MAX_BYTES    (4096)
+#define TEST_FRAME_MIN_BYTES    (600)
+#define TEST_FRAME_SIDE         (800)
+#define TEST_PRODUCER_PERIOD_MS (20)
+#define TEST_STREAM_PARTS       (10)
+#define TEST_SETTLE_TIMEOUT_MS  (3000)
+#define TEST_IDLE_TIMEOUT_MS    (12000)
+#define TEST_SLOW_FRAMES        (20)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+// What one request got back, as a client would see it.
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  char status[40];
+  char type[80];
+  char cache_control[32];
+  char retry_after[8];
+  uint8_t *body;
+  size_t body_len;
+  size_t body_cap;
+  const void *last_data; // buffer of the last non-empty send
+  bool chunked;
+  bool finished; // whole response or terminating chunk sent
+  bool async;
+  bool completed; // httpd_req_async_handler_complete() called
+  bool hold;      // sends block while set: a slow viewer
+  bool closed;    // sends fail: the viewer went away
+  uint32_t blocked;
+} test_response_t;
+
+struct httpd_req {
+  test_response_t *resp; // NULL once the handler has returned
+};
+
+typedef struct {
+  uint8_t data[TEST_FRAME_MAX_BYTES];
+  size_t size;
+  uint32_t seq;
+  uint32_t readers;
+} test_slot_t;
+
+static bool test_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out);
+static void test_release(camera_snapshot_ref_t *ref);
+static void test_viewer_attach(void);
+static void test_viewer_detach(void);
+
+static const camera_http_frame_source_t s_test_source = {
+  .acquire_latest = test_acquire_latest,
+  .release = test_release,
+  .viewer_attach = test_viewer_attach,
+  .viewer_detach = test_viewer_detach,
+};
+
+static int s_failures;
+static bool s_server_running;
+static httpd_uri_t s_handlers[TEST_MAX_HANDLERS];
+static size_t s_handler_count;
+
+static portMUX_TYPE s_source_lock = portMUX_INITIALIZER_UNLOCKED;
+static test_slot_t s_slots[TEST_MAX_SLOTS];
+static size_t s_slot_count;
+static test_slot_t *s_latest;
+static test_slot_t *s_publishing;
+static uint32_t s_seq;
+static uint32_t s_acquired;
+static uint32_t s_released;
+static uint32_t s_attached;
+static uint32_t s_detached;
+static uint32_t s_publish_skipped;
+static uint32_t s_max_pinned;
+static volatile bool s_producer_run;
+static volatile bool s_producer_done;
+
+/* ---------------------------------------------------------------------------
+ * esp_http_server stand-in
+ * ------------------------------------------------------------------------- */
+
+// Stands in for connectivity/http_server.c.
+esp_err_t http_server_register_uri_handler(const httpd_uri_t *uri)
+{
+  if (!s_server_running || uri == NULL || s_handler_count == TEST_MAX_HANDLERS) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  s_handlers[s_handler_count++] = *uri;
+  return ESP_OK;
+}
+
+static test_response_t *req_response(httpd_req_t *r)
+{
+  if (r == NULL || r->resp == NULL) {
+    fprintf(stderr, "request used after its handler returned\n");
+    s_failures++;
+    return NULL;
+  }
+  return r->resp;
+}
+
+static void response_init(test_response_t *resp)
+{
+  memset(resp, 0, sizeof(*resp));
+  pthread_mutex_init(&resp->mutex, NULL);
+  pthread_cond_init(&resp->changed, NULL);
+  snprintf(resp->status, sizeof(resp->status), "200 OK");
+}
+
+static void response_destroy(test_response_t *resp)
+{
+  free(resp->body);
+  pthread_mutex_destroy(&resp->mutex);
+  pthread_cond_destroy(&resp->changed);
+}
+
+// Appends under resp->mutex, first waiting out a hold.
+static esp_err_t response_write(test_response_t *resp, const char *buf, size_t len)
+{
+  pthread_mutex_lock(&resp->mutex);
+  resp->blocked++;
+  pthread_cond_broadcast(&resp->changed);
+  while (resp->hold && !resp->closed) {
+    pthread_cond_wait(&resp->changed, &resp->mutex);
+  }
+  resp->blocked--;
+  esp_err_t err = ESP_OK;
+  if (resp->closed) {
+    err = ESP_FAIL;
+  } else {
+    if (resp->body_len + len > resp->body_cap) {
+      resp->body_cap = (resp->body_len + len) * 2;
+      resp->body = realloc(resp->body, resp->body_cap);
+    }
+    memcpy(resp->body + resp->body_len, buf, len);
+    resp->body_len += len;
+    resp->last_data = buf;
+  }
+  pthread_cond_broadcast(&resp->changed);
+  pthread_mutex_unlock(&resp->mutex);
+  return err;
+}
+
+static void response_set(test_response_t *resp, char *field, size_t field_len, const char *value)
+{
+  pthread_mutex_lock(&resp->mutex);
+  snprintf(field, field_len, "%s", value);
+  pthread_mutex_unlock(&resp->mutex);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  response_set(resp, resp->status, sizeof(resp->status), status);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  response_set(resp, resp->type, sizeof(resp->type), type);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (strcmp(field, "Cache-Control") == 0) {
+    response_set(resp, resp->cache_control, sizeof(resp->cache_control), value);
+  } else if (strcmp(field, "Retry-After") == 0) {
+    response_set(resp, resp->retry_after, sizeof(resp->retry_after), value);
+  } else {
+    fprintf(stderr, "unexpected header %s\n", field);
+    s_failures++;
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const size_t len = buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+  esp_err_t err = response_write(resp, buf, len);
+  pthread_mutex_lock(&resp->mutex);
+  CHECK(!resp->finished && !resp->chunked);
+  resp->finished = true;
+  pthread_cond_broadcast(&resp->changed);
+  pthread_mutex_unlock(&resp->mutex);
+  return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pthread_mutex_lock(&resp->mutex);
+  CHECK(!resp->finished);
+  resp->chunked = true;
+  if (buf == NULL || buf_len == 0) {
+    resp->finished = true;
+    pthread_cond_broadcast(&resp->changed);
+    pthread_mutex_unlock(&resp->mutex);
+    return ESP_OK;
+  }
+  pthread_mutex_unlock(&resp->mutex);
+  const size_t len = buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+  return response_write(resp, buf, len);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+  CHECK(error == HTTPD_500_INTERNAL_SERVER_ERROR);
+  httpd_resp_set_status(req, "500 Internal Server Error");
+  return httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  httpd_req_t *copy = malloc(sizeof(*copy));
+  copy->resp = resp;
+  pthread_mutex_lock(&resp->mutex);
+  resp->async = true;
+  pthread_mutex_unlock(&resp->mutex);
+  *out = copy;
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+  test_response_t *resp = req_response(r);
+  if (resp == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pthread_mutex_lock(&resp->mutex);
+  CHECK(resp->async && !resp->completed);
+  resp->completed = true;
+  pthread_cond_broadcast(&resp->changed);
+  pthread_mutex_unlock(&resp->mutex);
+  free(r);
+  return ESP_OK;
+}
+
+// Runs the handler for uri as the httpd task would; the request is invalid
+// once the handler returns.
+static esp_err_t test_request(const char *uri, test_response_t *resp)
+{
+  for (size_t i = 0; i < s_handler_count; ++i) {
+    if (strcmp(s_handlers[i].uri, uri) == 0) {
+      CHECK(s_handlers[i].method == HTTP_GET);
+      httpd_req_t req = {.resp = resp};
+      esp_err_t err = s_handlers[i].handler(&req);
+      req.resp = NULL;
+      return err;
+    }
+  }
+  fprintf(stderr, "no handler for %s\n", uri);
+  s_failures++;
+  return ESP_ERR_NOT_FOUND;
+}
+
+static void response_set_flags(test_response_t *resp, bool hold, bool closed)
+{
+  pthread_mutex_lock(&resp->mutex);
+  resp->hold = hold;
+  resp->closed = closed;
+  pthread_cond_broadcast(&resp->changed);
+  pthread_mutex_unlock(&resp->mutex);
+}
+
+// Waits until check(resp) holds, up to timeout_ms. Returns the final result.
+static bool response_wait(test_response_t *resp, bool (*check)(const test_response_t *), int64_t timeout_ms)
+{
+  const int64_t deadline_us = esp_timer_get_time() + timeout_ms * 1000LL;
+  pthread_mutex_lock(&resp->mutex);
+  bool ok = check(resp);
+  while (!ok && esp_timer_get_time() < deadline_us) {
+    pthread_mutex_unlock(&resp->mutex);
+    vTaskDelay(pdMS_TO_TICKS(5));
+    pthread_mutex_lock(&resp->mutex);
+    ok = check(resp);
+  }
+  pthread_mutex_unlock(&resp->mutex);
+  return ok;
+}
+
+static bool is_blocked(const test_response_t *resp)
+{
+  return resp->blocked > 0;
+}
+
+static bool is_finished(const test_response_t *resp)
+{
+  return resp->finished;
+}
+
+static bool is_completed(const test_response_t *resp)
+{
+  return resp->completed;
+}
+
+/* ---------------------------------------------------------------------------
+ * Synthetic frame source
+ * ------------------------------------------------------------------------- */
+
+// Frame contents are a function of seq, so a client can check what it got:
+// SOI, the seq in four bytes, a seq-seeded pattern, EOI.
+static size_t test_frame_size(uint32_t seq)
+{
+  return TEST_FRAME_MIN_BYTES + ((seq * 733U) % (TEST_FRAME_MAX_BYTES - TEST_FRAME_MIN_BYTES));
+}
+
+static void test_frame_fill(uint32_t seq, uint8_t *data, size_t size)
+{
+  data[0] = 0xFF;
+  data[1] = 0xD8;
+  data[2] = (uint8_t)(seq >> 24);
+  data[3] = (uint8_t)(seq >> 16);
+  data[4] = (uint8_t)(seq >> 8);
+  data[5] = (uint8_t)seq;
+  for (size_t i = 6; i < size - 2U; ++i) {
+    data[i] = (uint8_t)(seq * 31U + i * 7U);
+  }
+  data[size - 2U] = 0xFF;
+  data[size - 1U] = 0xD9;
+}
+
+static bool test_frame_valid(const uint8_t *data, size_t size, uint32_t *seq_out)
+{
+  if (size < TEST_FRAME_MIN_BYTES || size > TEST_FRAME_MAX_BYTES) {
+    return false;
+  }
+  const uint32_t seq = ((uint32_t)data[2] << 24) | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
+  if (seq == 0 || size != test_frame_size(seq)) {
+    return false;
+  }
+  uint8_t want[TEST_FRAME_MAX_BYTES];
+  test_frame_fill(seq, want, size);
+  *seq_out = seq;
+  return memcmp(want, data, size) == 0;
+}
+
+static void source_reset(size_t slot_count)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  memset(s_slots, 0, sizeof(s_slots));
+  s_slot_count = slot_count;
+  s_latest = NULL;
+  s_publishing = NULL;
+  s_seq = 0;
+  s_acquired = 0;
+  s_released = 0;
+  s_attached = 0;
+  s_detached = 0;
+  s_publish_skipped = 0;
+  s_max_pinned = 0;
+  taskEXIT_CRITICAL(&s_source_lock);
+}
+
+// Encodes and commits the next frame the way the publisher does: never into
+// a slot with readers or the one MQTT is still sending, and the latest frame
+// only when nothing else is free. MQTT is modelled as always busy with the
+// previous frame, so the producer holds two slots whenever it encodes.
+static bool test_publish_frame(void)
+{
+  test_slot_t *slot = NULL;
+  taskENTER_CRITICAL(&s_source_lock);
+  for (int pass = 0; pass < 2 && slot == NULL; ++pass) {
+    for (size_t i = 0; i < s_slot_count && slot == NULL; ++i) {
+      test_slot_t *candidate = &s_slots[i];
+      if (candidate->readers == 0 && candidate != s_publishing && (pass == 1 || candidate != s_latest)) {
+        slot = candidate;
+      }
+    }
+  }
+  if (slot == NULL) {
+    s_publish_skipped++;
+  } else if (slot == s_latest) {
+    s_latest = NULL;
+  }
+  const uint32_t seq = s_seq + 1U;
+  taskEXIT_CRITICAL(&s_source_lock);
+  if (slot == NULL) {
+    return false;
+  }
+
+  slot->size = test_frame_size(seq);
+  slot->seq = seq;
+  test_frame_fill(seq, slot->data, slot->size);
+
+  taskENTER_CRITICAL(&s_source_lock);
+  s_latest = slot;
+  s_publishing = slot;
+  s_seq = seq;
+  taskEXIT_CRITICAL(&s_source_lock);
+  return true;
+}
+
+static bool test_acquire_latest(uint32_t after_seq, camera_snapshot_ref_t *out)
+{
+  bool ok = false;
+  taskENTER_CRITICAL(&s_source_lock);
+  if (s_latest != NULL && s_latest->seq != after_seq) {
+    s_latest->readers++;
+    s_acquired++;
+    *out = (camera_snapshot_ref_t){
+      .jpeg = s_latest->data,
+      .jpeg_size = s_latest->size,
+      .seq = s_latest->seq,
+      .width = TEST_FRAME_SIDE,
+      .height = TEST_FRAME_SIDE,
+      .captured_at_us = esp_timer_get_time(),
+      .token = s_latest,
+    };
+    uint32_t pinned = 0;
+    for (size_t i = 0; i < s_slot_count; ++i) {
+      pinned += s_slots[i].readers > 0 ? 1U : 0U;
+    }
+    s_max_pinned = pinned > s_max_pinned ? pinned : s_max_pinned;
+    ok = true;
+  }
+  taskEXIT_CRITICAL(&s_source_lock);
+  return ok;
+}
+
+static void test_release(camera_snapshot_ref_t *ref)
+{
+  test_slot_t *slot = ref->token;
+  taskENTER_CRITICAL(&s_source_lock);
+  CHECK(slot != NULL && slot->readers > 0);
+  if (slot != NULL && slot->readers > 0) {
+    slot->readers--;
+  }
+  s_released++;
+  taskEXIT_CRITICAL(&s_source_lock);
+  ref->token = NULL;
+}
+
+static void test_viewer_attach(void)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  s_attached++;
+  taskEXIT_CRITICAL(&s_source_lock);
+}
+
+static void test_viewer_detach(void)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  s_detached++;
+  taskEXIT_CRITICAL(&s_source_lock);
+}
+
+static uint32_t source_read(const uint32_t *counter)
+{
+  taskENTER_CRITICAL(&s_source_lock);
+  const uint32_t value = *counter;
+  taskEXIT_CRITICAL(&s_source_lock);
+  return value;
+}
+
+static uint32_t source_readers(void)
+{
+  uint32_t readers = 0;
+  taskENTER_CRITICAL(&s_source_lock);
+  for (size_t i = 0; i < s_slot_count; ++i) {
+    readers += s_slots[i].readers;
+  }
+  taskEXIT_CRITICAL(&s_source_lock);
+  return readers;
+}
+
+static void test_producer_task(void *arg)
+{
+  (void)arg;
+  while (s_producer_run) {
+    (void)test_publish_frame();
+    vTaskDelay(pdMS_TO_TICKS(TEST_PRODUCER_PERIOD_MS));
+  }
+  s_producer_done = true;
+  vTaskDelete(NULL);
+}
+
+static void test_producer_start(void)
+{
+  s_producer_run = true;
+  s_producer_done = false;
+  CHECK(xTaskCreatePinnedToCoreWithCaps(test_producer_task, "cam_test_src", 4096, NULL, 4, NULL, tskNO_AFFINITY,
+                                        0) == pdPASS);
+}
+
+static void test_producer_stop(void)
+{
+  s_producer_run = false;
+  while (!s_producer_done) {
+    vTaskDelay(pdMS_TO_TICKS(TEST_PRODUCER_PERIOD_MS));
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Setup and response checks
+ * ------------------------------------------------------------------------- */
+
+static void test_setup(size_t slot_count)
+{
+  source_reset(slot_count);
+  s_handler_count = 0;
+  s_server_running = true;
+  CHECK(camera_http_endpoint_register(&s_test_source) == ESP_OK);
+  CHECK(s_handler_count == 2);
+}
+
+static void test_teardown(void)
+{
+  // Every stream task must be gone and every reference back.
+  const int64_t deadline_us = esp_timer_get_time() + TEST_SETTLE_TIMEOUT_MS * 1000LL;
+  while (source_read(&s_detached) < source_read(&s_attached) && esp_timer_get_time() < deadline_us) {
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  CHECK(source_read(&s_attached) == source_read(&s_detached));
+  CHECK(source_read(&s_acquired) == source_read(&s_released));
+  CHECK(source_readers() == 0);
+  s_server_running = false;
+}
+
+// Parses the complete multipart parts recorded so far into seqs (in order)
+// and returns their count. A part still being sent is left for later.
+static size_t parse_stream(test_response_t *resp, uint32_t *seqs, size_t max)
+{
+  static const char prefix[] = "--theoframe\r\nContent-Type: image/jpeg\r\nContent-Length: ";
+  size_t parts = 0;
+  pthread_mutex_lock(&resp->mutex);
+  const char *body = (const char *)resp->body;
+  size_t pos = 0;
+  while (parts < max) {
+    const size_t left = resp->body_len - pos;
+    if (left < sizeof(prefix) - 1U + 4U) {
+      break;
+    }
+    if (memcmp(body + pos, prefix, sizeof(prefix) - 1U) != 0) {
+      fprintf(stderr, "bad part header at byte %zu\n", pos);
+      s_failures++;
+      break;
+    }
+    const char *length_at = body + pos + sizeof(prefix) - 1U;
+    const char *end = memchr(length_at, '\n', resp->body_len - (size_t)(length_at - body));
+    if (end == NULL || end + 2 >= body + resp->body_len) {
+      break;
+    }
+    const size_t length = strtoul(length_at, NULL, 10);
+    const size_t data_at = (size_t)(end - body) + 3U; // "\n\r\n"
+    if (end[1] != '\r' || end[2] != '\n') {
+      fprintf(stderr, "bad part header end at byte %zu\n", pos);
+      s_failures++;
+      break;
+    }
+    if (data_at + length + 2U > resp->body_len) {
+      break;
+    }
+    uint32_t seq = 0;
+    CHECK(test_frame_valid((const uint8_t *)body + data_at, length, &seq));
+    CHECK(memcmp(body + data_at + length, "\r\n", 2) == 0);
+    seqs[parts++] = seq;
+    pos = data_at + length + 2U;
+  }
+  pthread_mutex_unlock(&resp->mutex);
+  return parts;
+}
+
+static size_t wait_stream_parts(test_response_t *resp, uint32_t *seqs, size_t want)
+{
+  const int64_t deadline_us = esp_timer_get_time() + TEST_SETTLE_TIMEOUT_MS * 1000LL;
+  size_t parts = parse_stream(resp, seqs, want);
+  while (parts < want && esp_timer_get_time() < deadline_us) {
+    vTaskDelay(pdMS_TO_TICKS(5));
+    parts = parse_stream(resp, seqs, want);
+  }
+  return parts;
+}
+
+static void open_stream(test_response_t *resp)
+{
+  response_init(resp);
+  CHECK(test_request("/camera/stream.mjpeg", resp) == ESP_OK);
+  CHECK(resp->async);
+}
+
+static void close_stream(test_response_t *resp)
+{
+  response_set_flags(resp, false, true);
+  CHECK(response_wait(resp, is_completed, TEST_SETTLE_TIMEOUT_MS));
+}
+
+static void check_stream_headers(test_response_t *resp)
+{
+  pthread_mutex_lock(&resp->mutex);
+  CHECK(strcmp(resp->status, "200 OK") == 0);
+  CHECK(strcmp(resp->type, "multipart/x-mixed-replace;boundary=theoframe") == 0);
+  CHECK(strcmp(resp->cache_control, "no-store") == 0);
+  CHECK(resp->chunked);
+  pthread_mutex_unlock(&resp->mutex);
+}
+
+typedef struct {
+  test_response_t resp;
+  pthread_t thread;
+} snapshot_call_t;
+
+static void *snapshot_thread(void *arg)
+{
+  snapshot_call_t *call = arg;
+  CHECK(test_request("/camera/snapshot.jpg", &call->resp) == ESP_OK);
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+static void test_register_rejects(void)
+{
+  const camera_http_frame_source_t no_release = {.acquire_latest = test_acquire_latest};
+  CHECK(camera_http_endpoint_register(NULL) == ESP_ERR_INVALID_ARG);
+  CHECK(camera_http_endpoint_register(&no_release) == ESP_ERR_INVALID_ARG);
+  // Without a running service, registering the URIs fails.
+  s_server_running = false;
+  CHECK(camera_http_endpoint_register(&s_test_source) == ESP_ERR_INVALID_STATE);
+}
+
+static void test_snapshot_latest(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+  CHECK(test_publish_frame());
+  CHECK(test_publish_frame());
+
+  test_response_t resp;
+  response_init(&resp);
+  CHECK(test_request("/camera/snapshot.jpg", &resp) == ESP_OK);
+  CHECK(resp.finished && !resp.chunked && !resp.async);
+  CHECK(strcmp(resp.status, "200 OK") == 0);
+  CHECK(strcmp(resp.type, "image/jpeg") == 0);
+  CHECK(strcmp(resp.cache_control, "no-store") == 0);
+  uint32_t seq = 0;
+  CHECK(test_frame_valid(resp.body, resp.body_len, &seq) && seq == 2);
+  CHECK(s_acquired == 1);
+  response_destroy(&resp);
+  test_teardown();
+}
+
+static void test_snapshot_shared(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+  CHECK(test_publish_frame());
+
+  // Three clients, one encode: each is sent the slot's own buffer.
+  for (int i = 0; i < 3; ++i) {
+    test_response_t resp;
+    response_init(&resp);
+    CHECK(test_request("/camera/snapshot.jpg", &resp) == ESP_OK);
+    uint32_t seq = 0;
+    CHECK(test_frame_valid(resp.body, resp.body_len, &seq) && seq == 1);
+    CHECK(resp.last_data == s_latest->data);
+    response_destroy(&resp);
+  }
+  CHECK(s_seq == 1);
+  CHECK(s_acquired == 3);
+  test_teardown();
+}
+
+static void test_snapshot_no_frame(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+
+  test_response_t resp;
+  response_init(&resp);
+  const int64_t start_us = esp_timer_get_time();
+  CHECK(test_request("/camera/snapshot.jpg", &resp) == ESP_OK);
+  const int64_t waited_ms = (esp_timer_get_time() - start_us) / 1000;
+  CHECK(strcmp(resp.status, "503 Service Unavailable") == 0);
+  CHECK(strcmp(resp.retry_after, "1") == 0);
+  CHECK(resp.body_len == strlen("camera unavailable\n") &&
+        memcmp(resp.body, "camera unavailable\n", resp.body_len) == 0);
+  // The handler waits about two seconds for a first frame before giving up.
+  CHECK(waited_ms >= 1900 && waited_ms < TEST_SETTLE_TIMEOUT_MS);
+  CHECK(s_acquired == 0);
+  response_destroy(&resp);
+  test_teardown();
+}
+
+static void test_stream_each_frame_once(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+  test_producer_start();
+
+  test_response_t resp;
+  open_stream(&resp);
+  uint32_t seqs[TEST_STREAM_PARTS];
+  CHECK(wait_stream_parts(&resp, seqs, TEST_STREAM_PARTS) == TEST_STREAM_PARTS);
+  check_stream_headers(&resp);
+  for (size_t i = 1; i < TEST_STREAM_PARTS; ++i) {
+    CHECK(seqs[i] > seqs[i - 1]);
+  }
+  CHECK(source_read(&s_attached) == 1);
+
+  // A viewer that goes away ends the stream on the next send, without the
+  // terminating chunk.
+  close_stream(&resp);
+  CHECK(!resp.finished);
+  test_producer_stop();
+  CHECK(s_publish_skipped == 0);
+  test_teardown();
+  response_destroy(&resp);
+}
+
+static void test_stream_cap(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+  test_producer_start();
+
+  test_response_t streams[TEST_MAX_STREAMS];
+  uint32_t seqs[2];
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    open_stream(&streams[i]);
+    CHECK(wait_stream_parts(&streams[i], seqs, 1) == 1);
+  }
+
+  test_response_t extra;
+  response_init(&extra);
+  CHECK(test_request("/camera/stream.mjpeg", &extra) == ESP_OK);
+  CHECK(!extra.async && extra.finished);
+  CHECK(strcmp(extra.status, "503 Service Unavailable") == 0);
+  CHECK(extra.body_len == strlen("too many camera streams\n") &&
+        memcmp(extra.body, "too many camera streams\n", extra.body_len) == 0);
+  response_destroy(&extra);
+
+  // The rejected request leaves the others running.
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    CHECK(wait_stream_parts(&streams[i], seqs, 2) == 2);
+    close_stream(&streams[i]);
+  }
+
+  // A closed stream frees its place.
+  test_response_t again;
+  open_stream(&again);
+  CHECK(wait_stream_parts(&again, seqs, 1) == 1);
+  close_stream(&again);
+
+  test_producer_stop();
+  test_teardown();
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    response_destroy(&streams[i]);
+  }
+  response_destroy(&again);
+}
+
+static void test_stream_idle_end(void)
+{
+  test_setup(TEST_PUBLISHER_SLOTS);
+  test_producer_start();
+
+  test_response_t resp;
+  open_stream(&resp);
+  uint32_t seqs[1];
+  CHECK(wait_stream_parts(&resp, seqs, 1) == 1);
+  test_producer_stop();
+
+  // The terminating chunk follows once the idle timeout (10 s) passes with no
+  // new frame.
+  const int64_t stop_us = esp_timer_get_time();
+  CHECK(response_wait(&resp, is_finished, TEST_IDLE_TIMEOUT_MS));
+  const int64_t ended_ms = (esp_timer_get_time() - stop_us) / 1000;
+  CHECK(ended_ms >= 9000);
+  CHECK(response_wait(&resp, is_completed, TEST_SETTLE_TIMEOUT_MS));
+  test_teardown();
+  response_destroy(&resp);
+}
+
+// Stalls every reader the endpoint allows on a different frame, then keeps
+// encoding. Returns how many of TEST_SLOW_FRAMES the producer had to skip.
+static uint32_t run_slow_viewers(size_t slot_count)
+{
+  test_setup(slot_count);
+  test_response_t streams[TEST_MAX_STREAMS];
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    CHECK(test_publish_frame());
+    response_init(&streams[i]);
+    streams[i].hold = true;
+    CHECK(test_request("/camera/stream.mjpeg", &streams[i]) == ESP_OK);
+    CHECK(response_wait(&streams[i], is_blocked, TEST_SETTLE_TIMEOUT_MS));
+  }
+  // The snapshot handler runs on the httpd task, so at most one at a time.
+  CHECK(test_publish_frame());
+  snapshot_call_t snapshot;
+  response_init(&snapshot.resp);
+  snapshot.resp.hold = true;
+  pthread_create(&snapshot.thread, NULL, snapshot_thread, &snapshot);
+  CHECK(response_wait(&snapshot.resp, is_blocked, TEST_SETTLE_TIMEOUT_MS));
+  CHECK(source_read(&s_max_pinned) == TEST_MAX_STREAMS + 1);
+
+  for (int i = 0; i < TEST_SLOW_FRAMES; ++i) {
+    (void)test_publish_frame();
+  }
+  const uint32_t skipped = source_read(&s_publish_skipped);
+
+  response_set_flags(&snapshot.resp, false, false);
+  pthread_join(snapshot.thread, NULL);
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    close_stream(&streams[i]);
+  }
+  // Readers never pinned more than the endpoint's bound.
+  CHECK(source_read(&s_max_pinned) <= TEST_MAX_STREAMS + 1);
+  test_teardown();
+  response_destroy(&snapshot.resp);
+  for (int i = 0; i < TEST_MAX_STREAMS; ++i) {
+    response_destroy(&streams[i]);
+  }
+  return skipped;
+}
+
+static void test_slow_viewers(void)
+{
+  CHECK(run_slow_viewers(TEST_PUBLISHER_SLOTS) == 0);
+  // With the old fixed count the same viewers leave the encoder nothing.
+  CHECK(run_slow_viewers(TEST_OLD_SLOTS) == TEST_SLOW_FRAMES);
+}
+
+int main(void)
+{
+  // The rejected registrations and 503s log errors by design.
+  esp_log_level_set("*", ESP_LOG_NONE);
+  _Static_assert(TEST_PUBLISHER_SLOTS <= TEST_MAX_SLOTS, "grow TEST_MAX_SLOTS");
+
+  test_register_rejects();
+  test_snapshot_latest();
+  test_snapshot_shared();
+  test_snapshot_no_frame();
+  test_stream_each_frame_once();
+  test_stream_cap();
+  test_stream_idle_end();
+  test_slow_viewers();
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
@@ -0,0 +1,664 @@
+/*
+ * Host build of the snapshot capture -> stage -> encode -> publish path.
+ *
+ * Links the unchanged synthetic frame source
+ * (main/streaming/camera_source_synthetic.c) and the software transform stage
+ * (frame_transform.c, frame_rotate.c) with the scripts/host shims. JPEG
+ * encoding goes through the driver/jpeg_encode.h API the publisher uses,
+ * implemented in software by scripts/host/jpeg_encode_soft.c, so encode_us
+ * and the byte counts are real but are a CPU baseline rather than the P4's
+ * hardware engine. Publishing goes through esp_mqtt_client_publish() as
+ * publish_slot() does, whole or in TCH1 chunks, to a mock transport that
+ * copies each message out, optionally at --link-kbps, and reassembles the
+ * JPEG on the far side to check it.
+ *
+ * The stage cases follow what encode_snapshot_frame() stages for an RGB565
+ * frame:
+ *
+ * - direct: zero-copy, the encoder reads the capture buffer and nothing is
+ *   staged
+ * - rotate180: full size, rotated into the staging buffer, as for a sensor
+ *   mounted upside down that does not flip the image itself
+ * - half: the adaptive downscale to half size
+ * - thumb: a direct frame plus the centre-cropped thumbnail at --divisor,
+ *   both encoded
+ *
+ * Every case runs at each source size in --sides and each quality in
+ * --qualities. It reports capture, stage, encode and publish time (avg and
+ * max), JPEG bytes and the staging memory it needs, like the device's
+ * camera_benchmark report. The source paces frames at about 30 fps, so
+ * capture_us includes the wait for the next frame, as it does on the device.
+ * Staged frames are spot-checked against the capture and every JPEG must
+ * arrive intact; the program exits non-zero otherwise. --json prints one
+ * JSON document, shaped like the device report, instead of the text lines.
+ *
+ *   cc -O2 -g -Iscripts/host/include -Imain scripts/camera_pipeline_bench.c scripts/host/idf_shim.c \
+ *     scripts/host/jpeg_encode_soft.c main/streaming/camera_source_synthetic.c main/streaming/frame_transform.c \
+ *     main/streaming/frame_rotate.c -lpthread -lm -o /tmp/camera_pipeline_bench
+ *   /tmp/camera_pipeline_bench [--frames N] [--divisor 2|4|8] [--sides 400,800] [--qualities 50,70,90]
+ *     [--chunk-bytes N] [--link-kbps N] [--json]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "driver/jpeg_encode.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_shim.h"
+#include "streaming/camera_frame_source.h"
+#include "streaming/frame_transform.h"
+
+#define BENCH_BUFFERS          (2)
+#define BENCH_DEFAULT_FRAMES   (10)
+#define BENCH_DEFAULT_DIVISOR  (4)
+#define BENCH_MAX_SWEEP        (8)
+#define BENCH_MIN_SIDE         (192) // the synthetic source's smallest frame
+#define BENCH_MAX_SIDE         (1280)
+#define BENCH_BUFFER_ALIGN     (128)
+// CAMERA_SNAPSHOT_JPEG_BUFFER_BYTES and CAMERA_SNAPSHOT_THUMB_JPEG_BUFFER_BYTES.
+#define BENCH_JPEG_BYTES       (512 * 1024)
+#define BENCH_THUMB_JPEG_BYTES (64 * 1024)
+// The chunk header from publish_chunked(): "TCH1", frame id (u32), chunk
+// index (u16), chunk count (u16), total length (u32), little-endian.
+#define BENCH_CHUNK_MAGIC        "TCH1"
+#define BENCH_CHUNK_HEADER_BYTES (16)
+#define BENCH_CHUNK_MAX_BYTES    (65536)
+#define BENCH_SNAPSHOT_TOPIC     "theo/bench/camera/snapshot"
+#define BENCH_CHUNK_TOPIC        "theo/bench/camera/snapshot/chunk"
+#define BENCH_THUMB_TOPIC        "theo/bench/camera/thumbnail"
+
+typedef enum {
+  CASE_DIRECT = 0,
+  CASE_ROTATE180,
+  CASE_HALF,
+  CASE_THUMB,
+  CASE_COUNT,
+} bench_case_t;
+
+typedef struct {
+  uint64_t total_us;
+  uint32_t max_us;
+} stage_time_t;
+
+typedef struct {
+  uint32_t frames;
+  int divisor;
+  size_t chunk_bytes;
+  uint32_t link_kbps;
+  bool json;
+} bench_options_t;
+
+typedef struct {
+  bench_case_t kind;
+  uint16_t side;
+  uint8_t quality;
+  uint16_t width;
+  uint16_t height;
+  stage_time_t capture;
+  stage_time_t stage;
+  stage_time_t encode;
+  stage_time_t publish;
+  uint64_t total_bytes;
+  size_t max_bytes;
+  uint64_t total_thumb_bytes;
+  size_t staging_b;
+  uint32_t frames;
+  uint32_t chunks;
+  uint32_t failures; // frames whose JPEG did not fit its slot
+  uint32_t mismatches;
+} case_result_t;
+
+// The far side of the mock transport.
+typedef struct {
+  uint8_t *frame;
+  size_t frame_cap;
+  size_t received;
+  size_t total;
+  uint32_t messages;
+  bool bad;
+} mock_link_t;
+
+static const char *const s_case_names[CASE_COUNT] = {"direct", "rotate180", "half", "thumb"};
+
+static bench_options_t s_options;
+static mock_link_t s_link;
+static uint8_t s_chunk_buffer[BENCH_CHUNK_HEADER_BYTES + BENCH_CHUNK_MAX_BYTES];
+static uint32_t s_chunk_frame_id;
+static esp_mqtt_client_handle_t s_client;
+
+static bool run_case(const camera_frame_source_t *source, const camera_source_format_t *format,
+                     jpeg_encoder_handle_t encoder, esp_mqtt_client_handle_t client, uint8_t *jpeg, size_t jpeg_cap,
+                     uint8_t *thumb, size_t thumb_cap, case_result_t *result);
+static bool publish_frame(esp_mqtt_client_handle_t client, const uint8_t *jpeg, size_t len, uint32_t *chunks);
+static void mock_transport(const char *topic, const char *data, size_t len, int qos, bool enqueued);
+static bool spot_check(const frame_src_t *src, const frame_transform_op_t *op, const uint8_t *out, uint16_t out_w,
+                       uint16_t out_h);
+static bool jpeg_looks_valid(const uint8_t *jpeg, size_t len, uint16_t width, uint16_t height);
+static size_t parse_list(const char *arg, uint32_t *out, size_t max);
+static void print_text(const case_result_t *result);
+static void print_json_case(const case_result_t *result, bool first);
+static void add_time(stage_time_t *time, int64_t us);
+static uint32_t avg_us(const stage_time_t *time, uint32_t frames);
+static void put_le16(uint8_t *p, uint16_t v);
+static void put_le32(uint8_t *p, uint32_t v);
+static uint32_t get_le32(const uint8_t *p);
+
+static void usage(void)
+{
+  fprintf(stderr,
+          "usage: camera_pipeline_bench [--frames N] [--divisor 2|4|8] [--sides 400,800] [--qualities 50,70,90]\n"
+          "                             [--chunk-bytes N] [--link-kbps N] [--json]\n");
+}
+
+int main(int argc, char **argv)
+{
+  s_options = (bench_options_t){
+    .frames = BENCH_DEFAULT_FRAMES,
+    .divisor = BENCH_DEFAULT_DIVISOR,
+  };
+  uint32_t sides[BENCH_MAX_SWEEP] = {400, 800};
+  size_t side_count = 2;
+  uint32_t qualities[BENCH_MAX_SWEEP] = {50, 70, 90};
+  size_t quality_count = 3;
+  esp_log_level_set("*", ESP_LOG_WARN);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      s_options.frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--divisor") == 0 && i + 1 < argc) {
+      s_options.divisor = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--sides") == 0 && i + 1 < argc) {
+      side_count = parse_list(argv[++i], sides, BENCH_MAX_SWEEP);
+    } else if (strcmp(argv[i], "--qualities") == 0 && i + 1 < argc) {
+      quality_count = parse_list(argv[++i], qualities, BENCH_MAX_SWEEP);
+    } else if (strcmp(argv[i], "--chunk-bytes") == 0 && i + 1 < argc) {
+      s_options.chunk_bytes = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--link-kbps") == 0 && i + 1 < argc) {
+      s_options.link_kbps = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      s_options.json = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  bool valid = s_options.frames > 0 && side_count > 0 && quality_count > 0 &&
+               (s_options.divisor == 2 || s_options.divisor == 4 || s_options.divisor == 8) &&
+               s_options.chunk_bytes <= BENCH_CHUNK_MAX_BYTES;
+  for (size_t i = 0; i < side_count; ++i) {
+    // Sides on the 16-pixel MCU grid, like the sensor modes.
+    valid = valid && sides[i] >= BENCH_MIN_SIDE && sides[i] <= BENCH_MAX_SIDE && sides[i] % 16U == 0;
+  }
+  for (size_t i = 0; i < quality_count; ++i) {
+    valid = valid && qualities[i] >= 1 && qualities[i] <= 100;
+  }
+  if (!valid) {
+    usage();
+    return 2;
+  }
+
+  const camera_frame_source_t *source = camera_frame_source_synthetic();
+  jpeg_encoder_handle_t encoder = NULL;
+  const jpeg_encode_engine_cfg_t engine_cfg = {.timeout_ms = 1000};
+  const jpeg_encode_memory_alloc_cfg_t mem_cfg = {.buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER};
+  size_t jpeg_cap = 0;
+  size_t thumb_cap = 0;
+  uint8_t *jpeg = jpeg_alloc_encoder_mem(BENCH_JPEG_BYTES, &mem_cfg, &jpeg_cap);
+  uint8_t *thumb = jpeg_alloc_encoder_mem(BENCH_THUMB_JPEG_BYTES, &mem_cfg, &thumb_cap);
+  s_link.frame_cap = BENCH_JPEG_BYTES;
+  s_link.frame = malloc(s_link.frame_cap);
+  s_client = host_mqtt_client_create();
+  if (jpeg == NULL || thumb == NULL || s_link.frame == NULL || s_client == NULL ||
+      jpeg_new_encoder_engine(&engine_cfg, &encoder) != ESP_OK || frame_transform_init() != ESP_OK) {
+    fprintf(stderr, "camera_pipeline_bench: setup failed\n");
+    return 1;
+  }
+  host_mqtt_set_publish_hook(mock_transport);
+
+  if (s_options.json) {
+    printf("{\"source\":\"%s\",\"pixfmt\":\"RGB565\",\"encoder\":\"software\",\"frames_per_case\":%u,"
+           "\"chunk_bytes\":%zu,\"link_kbps\":%u,\"cases\":[",
+           source->name, s_options.frames, s_options.chunk_bytes, s_options.link_kbps);
+  } else {
+    printf("bench: source=%s pixfmt=RGB565 encoder=software frames_per_case=%u chunk_bytes=%zu link_kbps=%u\n",
+           source->name, s_options.frames, s_options.chunk_bytes, s_options.link_kbps);
+  }
+
+  const int64_t started_us = esp_timer_get_time();
+  uint32_t mismatches = 0;
+  bool first = true;
+  bool ok = true;
+  for (size_t si = 0; si < side_count && ok; ++si) {
+    const camera_source_config_t config = {
+      .width = (uint16_t)sides[si],
+      .height = (uint16_t)sides[si],
+      .buffer_count = BENCH_BUFFERS,
+    };
+    camera_source_format_t format;
+    if (source->open(&config, &format) != ESP_OK || source->start() != ESP_OK) {
+      fprintf(stderr, "camera_pipeline_bench: source setup failed at %ux%u\n", sides[si], sides[si]);
+      ok = false;
+      break;
+    }
+    if (!s_options.json) {
+      printf("source: frame=%ux%u stride=%zu capture_b=%zu\n", sides[si], sides[si], format.stride,
+             format.buffer_bytes);
+    }
+    for (int kind = 0; kind < CASE_COUNT && ok; ++kind) {
+      for (size_t qi = 0; qi < quality_count && ok; ++qi) {
+        case_result_t result = {
+          .kind = (bench_case_t)kind,
+          .side = (uint16_t)sides[si],
+          .quality = (uint8_t)qualities[qi],
+        };
+        if (!run_case(source, &format, encoder, s_client, jpeg, jpeg_cap, thumb, thumb_cap, &result)) {
+          fprintf(stderr, "camera_pipeline_bench: case %s %u q%u failed\n", s_case_names[kind], sides[si],
+                  qualities[qi]);
+          ok = false;
+          break;
+        }
+        mismatches += result.mismatches;
+        if (s_options.json) {
+          print_json_case(&result, first);
+        } else {
+          print_text(&result);
+        }
+        first = false;
+      }
+    }
+    source->close();
+  }
+
+  if (s_options.json) {
+    printf("],\"mismatches\":%u,\"duration_ms\":%lld}\n", mismatches,
+           (long long)((esp_timer_get_time() - started_us) / 1000LL));
+  }
+  frame_transform_deinit();
+  jpeg_del_encoder_engine(encoder);
+  heap_caps_free(jpeg);
+  heap_caps_free(thumb);
+  free(s_link.frame);
+  if (!ok) {
+    return 1;
+  }
+  if (mismatches != 0) {
+    // Keep stdout parseable in JSON mode.
+    fprintf(s_options.json ? stderr : stdout, "FAIL: %u frames were staged, encoded or delivered wrong\n",
+            mismatches);
+    return 1;
+  }
+  if (!s_options.json) {
+    printf("PASS\n");
+  }
+  return 0;
+}
+
+// One case: dequeue, stage and encode as encode_snapshot_frame() would,
+// requeue, then publish as publish_slot() would. Times are avg/max per frame.
+static bool run_case(const camera_frame_source_t *source, const camera_source_format_t *format,
+                     jpeg_encoder_handle_t encoder, esp_mqtt_client_handle_t client, uint8_t *jpeg, size_t jpeg_cap,
+                     uint8_t *thumb, size_t thumb_cap, case_result_t *result)
+{
+  const uint16_t side = result->side;
+  const frame_src_t src_template = {
+    .stride = format->stride,
+    .width = side,
+    .height = side,
+    .format = FRAME_PIXFMT_RGB565,
+  };
+  frame_transform_op_t op = {.scale_16ths = FRAME_TRANSFORM_SCALE_ONE};
+  bool staged = true;
+  switch (result->kind) {
+  case CASE_DIRECT:
+    staged = false;
+    break;
+  case CASE_ROTATE180:
+    op.rotation = FRAME_ROTATE_180;
+    break;
+  case CASE_HALF:
+    op.scale_16ths = FRAME_TRANSFORM_SCALE_ONE / 2;
+    break;
+  case CASE_THUMB: {
+    // The centre crop from ensure_thumbnail_buffers(): scaled sides land on
+    // 16-pixel MCU boundaries.
+    const int divisor = s_options.divisor;
+    const uint16_t thumb_side = (uint16_t)((side / divisor) & ~15U);
+    const uint16_t crop = (uint16_t)(thumb_side * divisor);
+    op = (frame_transform_op_t){
+      .crop_x = (uint16_t)((side - crop) / 2U),
+      .crop_y = (uint16_t)((side - crop) / 2U),
+      .crop_w = crop,
+      .crop_h = crop,
+      .scale_16ths = (uint8_t)(FRAME_TRANSFORM_SCALE_ONE / divisor),
+    };
+    break;
+  }
+  default:
+    return false;
+  }
+  // Full-size frames are encoded from the capture buffer in the direct and
+  // thumbnail cases, which hold it dequeued until then.
+  const bool encode_capture = result->kind == CASE_DIRECT || result->kind == CASE_THUMB;
+  const bool has_thumb = result->kind == CASE_THUMB;
+  jpeg_encode_cfg_t cfg = {
+    .width = side,
+    .height = side,
+    .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+    .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+    .image_quality = result->quality,
+  };
+
+  uint16_t out_w = side;
+  uint16_t out_h = side;
+  uint8_t *staging = NULL;
+
+  bool ok = true;
+  for (uint32_t i = 0; i < s_options.frames && ok; ++i) {
+    camera_source_buffer_t buf;
+    const int64_t capture_start_us = esp_timer_get_time();
+    if (source->dequeue(&buf) != ESP_OK) {
+      ok = false;
+      break;
+    }
+    const int64_t capture_us = esp_timer_get_time() - capture_start_us;
+
+    frame_src_t src = src_template;
+    src.data = buf.data;
+    if (staged && staging == NULL) {
+      // Sized like ensure_raw_buffer() and ensure_thumbnail_buffers() do.
+      ok = frame_transform_output_size(&src, &op, &out_w, &out_h) == ESP_OK;
+      result->staging_b = (size_t)out_w * out_h * 2U;
+      const size_t rounded = (result->staging_b + BENCH_BUFFER_ALIGN - 1U) & ~(size_t)(BENCH_BUFFER_ALIGN - 1U);
+      staging = ok ? heap_caps_aligned_alloc(BENCH_BUFFER_ALIGN, rounded, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : NULL;
+      if (staging == NULL) {
+        (void)source->requeue(&buf);
+        ok = false;
+        break;
+      }
+    }
+    const int64_t stage_start_us = esp_timer_get_time();
+    if (staged) {
+      const frame_dst_t dst = {.data = staging, .size = result->staging_b, .format = FRAME_PIXFMT_RGB565};
+      ok = frame_transform_run(&src, &op, &dst, NULL) == ESP_OK;
+    }
+    const int64_t encode_start_us = esp_timer_get_time();
+    const int64_t stage_us = encode_start_us - stage_start_us;
+    bool frame_ok = !staged || (ok && spot_check(&src, &op, staging, out_w, out_h));
+
+    uint32_t jpeg_size = 0;
+    uint32_t thumb_size = 0;
+    bool encoded = true;
+    if (ok && encode_capture) {
+      encoded = jpeg_encoder_process(encoder, &cfg, buf.data, (uint32_t)(format->stride * side), jpeg,
+                                     (uint32_t)jpeg_cap, &jpeg_size) == ESP_OK;
+    }
+    if (source->requeue(&buf) != ESP_OK) {
+      ok = false;
+    }
+    if (ok && encoded && staged) {
+      jpeg_encode_cfg_t staged_cfg = cfg;
+      staged_cfg.width = out_w;
+      staged_cfg.height = out_h;
+      encoded = has_thumb ? jpeg_encoder_process(encoder, &staged_cfg, staging, (uint32_t)result->staging_b, thumb,
+                                                 (uint32_t)thumb_cap, &thumb_size) == ESP_OK
+                          : jpeg_encoder_process(encoder, &staged_cfg, staging, (uint32_t)result->staging_b, jpeg,
+                                                 (uint32_t)jpeg_cap, &jpeg_size) == ESP_OK;
+    }
+    const int64_t publish_start_us = esp_timer_get_time();
+    if (!ok) {
+      break;
+    }
+    if (!encoded) {
+      // As in run_benchmark_frame(), a JPEG that does not fit its slot
+      // fails the frame: nothing is published or timed.
+      result->failures++;
+      continue;
+    }
+    add_time(&result->capture, capture_us);
+    add_time(&result->stage, stage_us);
+    add_time(&result->encode, publish_start_us - encode_start_us);
+    result->width = encode_capture ? side : out_w;
+    result->height = encode_capture ? side : out_h;
+    frame_ok = frame_ok && jpeg_looks_valid(jpeg, jpeg_size, result->width, result->height);
+    frame_ok = frame_ok && (!has_thumb || jpeg_looks_valid(thumb, thumb_size, out_w, out_h));
+
+    uint32_t chunks = 0;
+    frame_ok = publish_frame(client, jpeg, jpeg_size, &chunks) && frame_ok;
+    if (has_thumb) {
+      frame_ok = esp_mqtt_client_publish(client, BENCH_THUMB_TOPIC, (const char *)thumb, (int)thumb_size, 0, 1) >= 0 &&
+                 frame_ok;
+    }
+    add_time(&result->publish, esp_timer_get_time() - publish_start_us);
+
+    result->total_bytes += jpeg_size;
+    result->max_bytes = jpeg_size > result->max_bytes ? jpeg_size : result->max_bytes;
+    result->total_thumb_bytes += thumb_size;
+    result->chunks += chunks;
+    result->mismatches += frame_ok ? 0U : 1U;
+    result->frames++;
+  }
+  heap_caps_free(staging);
+  return ok;
+}
+
+// publish_slot(): one retained message, or publish_chunked()'s run of
+// bounded messages with a one-tick yield between them. Returns whether the
+// far side got the JPEG back intact.
+static bool publish_frame(esp_mqtt_client_handle_t client, const uint8_t *jpeg, size_t len, uint32_t *chunks)
+{
+  s_link.received = 0;
+  s_link.total = 0;
+  s_link.messages = 0;
+  s_link.bad = false;
+  const size_t chunk_bytes = s_options.chunk_bytes;
+  if (chunk_bytes == 0) {
+    if (esp_mqtt_client_publish(client, BENCH_SNAPSHOT_TOPIC, (const char *)jpeg, (int)len, 0, 1) < 0) {
+      return false;
+    }
+    *chunks = 1;
+  } else {
+    const size_t count = (len + chunk_bytes - 1U) / chunk_bytes;
+    if (count == 0 || count > UINT16_MAX) {
+      return false;
+    }
+    const uint32_t frame_id = ++s_chunk_frame_id;
+    memcpy(s_chunk_buffer, BENCH_CHUNK_MAGIC, 4);
+    put_le32(s_chunk_buffer + 4, frame_id);
+    put_le16(s_chunk_buffer + 10, (uint16_t)count);
+    put_le32(s_chunk_buffer + 12, (uint32_t)len);
+    for (size_t seq = 0; seq < count; ++seq) {
+      if (seq > 0) {
+        vTaskDelay(1);
+      }
+      const size_t offset = seq * chunk_bytes;
+      const size_t part = (len - offset) < chunk_bytes ? (len - offset) : chunk_bytes;
+      put_le16(s_chunk_buffer + 8, (uint16_t)seq);
+      memcpy(s_chunk_buffer + BENCH_CHUNK_HEADER_BYTES, jpeg + offset, part);
+      if (esp_mqtt_client_publish(client, BENCH_CHUNK_TOPIC, (const char *)s_chunk_buffer,
+                                  (int)(BENCH_CHUNK_HEADER_BYTES + part), 0, 0) < 0) {
+        return false;
+      }
+      (*chunks)++;
+    }
+  }
+  return !s_link.bad && s_link.received == len && s_link.total == len && memcmp(s_link.frame, jpeg, len) == 0;
+}
+
+// The publish hook: copies each message out as the client's socket write
+// would, taking len / --link-kbps when a link rate is set, and reassembles
+// snapshot messages for publish_frame() to compare.
+static void mock_transport(const char *topic, const char *data, size_t len, int qos, bool enqueued)
+{
+  (void)qos;
+  (void)enqueued;
+  static uint8_t wire[BENCH_CHUNK_HEADER_BYTES + BENCH_JPEG_BYTES];
+  const int64_t start_us = esp_timer_get_time();
+  const size_t copied = len < sizeof(wire) ? len : sizeof(wire);
+  memcpy(wire, data, copied);
+
+  if (strcmp(topic, BENCH_SNAPSHOT_TOPIC) == 0) {
+    s_link.bad |= copied != len || len > s_link.frame_cap;
+    if (!s_link.bad) {
+      memcpy(s_link.frame, wire, len);
+      s_link.received = len;
+      s_link.total = len;
+    }
+  } else if (strcmp(topic, BENCH_CHUNK_TOPIC) == 0) {
+    const size_t chunk_bytes = s_options.chunk_bytes;
+    const uint16_t index = (uint16_t)(wire[8] | (wire[9] << 8));
+    const uint32_t total = get_le32(wire + 12);
+    const size_t part = len - BENCH_CHUNK_HEADER_BYTES;
+    const size_t offset = (size_t)index * chunk_bytes;
+    s_link.bad |= len < BENCH_CHUNK_HEADER_BYTES || memcmp(wire, BENCH_CHUNK_MAGIC, 4) != 0 ||
+                  get_le32(wire + 4) != s_chunk_frame_id || index != s_link.messages || total > s_link.frame_cap ||
+                  offset + part > total;
+    if (!s_link.bad) {
+      memcpy(s_link.frame + offset, wire + BENCH_CHUNK_HEADER_BYTES, part);
+      s_link.received += part;
+      s_link.total = total;
+    }
+  }
+  s_link.messages++;
+
+  if (s_options.link_kbps > 0) {
+    const int64_t wire_us = (int64_t)len * 8000LL / s_options.link_kbps;
+    const int64_t left_us = wire_us - (esp_timer_get_time() - start_us);
+    if (left_us > 0) {
+      const struct timespec ts = {.tv_sec = left_us / 1000000LL, .tv_nsec = (left_us % 1000000LL) * 1000L};
+      nanosleep(&ts, NULL);
+    }
+  }
+}
+
+// Checks the four corners and the centre of the staged frame against the
+// capture pixels the op maps them from (nearest-neighbour, then rotation).
+static bool spot_check(const frame_src_t *src, const frame_transform_op_t *op, const uint8_t *out, uint16_t out_w,
+                       uint16_t out_h)
+{
+  const uint16_t crop_w = op->crop_w ? op->crop_w : src->width;
+  const uint16_t crop_h = op->crop_h ? op->crop_h : src->height;
+  const uint16_t xs[] = {0, (uint16_t)(out_w - 1U), 0, (uint16_t)(out_w - 1U), (uint16_t)(out_w / 2U)};
+  const uint16_t ys[] = {0, 0, (uint16_t)(out_h - 1U), (uint16_t)(out_h - 1U), (uint16_t)(out_h / 2U)};
+  for (size_t i = 0; i < sizeof(xs) / sizeof(xs[0]); ++i) {
+    uint32_t sx = xs[i];
+    uint32_t sy = ys[i];
+    if (op->rotation == FRAME_ROTATE_180) {
+      sx = out_w - 1U - sx;
+      sy = out_h - 1U - sy;
+    }
+    sx = op->crop_x + sx * crop_w / out_w;
+    sy = op->crop_y + sy * crop_h / out_h;
+    const uint8_t *want = src->data + sy * src->stride + sx * 2U;
+    const uint8_t *got = out + ((size_t)ys[i] * out_w + xs[i]) * 2U;
+    if (memcmp(want, got, 2) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// SOI first, EOI last, and a baseline SOF0 with the expected size.
+static bool jpeg_looks_valid(const uint8_t *jpeg, size_t len, uint16_t width, uint16_t height)
+{
+  if (len < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8 || jpeg[len - 2] != 0xFF || jpeg[len - 1] != 0xD9) {
+    return false;
+  }
+  size_t pos = 2;
+  while (pos + 4 <= len && jpeg[pos] == 0xFF) {
+    const uint8_t marker = jpeg[pos + 1];
+    const size_t seg_len = ((size_t)jpeg[pos + 2] << 8) | jpeg[pos + 3];
+    if (marker == 0xC0) {
+      return pos + 9 <= len && (((uint16_t)jpeg[pos + 5] << 8) | jpeg[pos + 6]) == height &&
+             (((uint16_t)jpeg[pos + 7] << 8) | jpeg[pos + 8]) == width;
+    }
+    pos += 2U + seg_len;
+  }
+  return false;
+}
+
+static size_t parse_list(const char *arg, uint32_t *out, size_t max)
+{
+  size_t count = 0;
+  const char *p = arg;
+  while (*p != '\0') {
+    char *end = NULL;
+    const unsigned long v = strtoul(p, &end, 10);
+    if (end == p || count == max || (*end != ',' && *end != '\0')) {
+      return 0;
+    }
+    out[count++] = (uint32_t)v;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return count;
+}
+
+static void print_text(const case_result_t *r)
+{
+  const uint32_t n = r->frames > 0 ? r->frames : 1U;
+  printf("case=%s side=%u quality=%u out=%ux%u frames=%u capture_us=%u/%u stage_us=%u/%u encode_us=%u/%u "
+         "publish_us=%u/%u bytes=%u/%zu",
+         s_case_names[r->kind], r->side, r->quality, r->width, r->height, r->frames, avg_us(&r->capture, r->frames),
+         r->capture.max_us, avg_us(&r->stage, r->frames), r->stage.max_us, avg_us(&r->encode, r->frames),
+         r->encode.max_us, avg_us(&r->publish, r->frames), r->publish.max_us, (unsigned)(r->total_bytes / n),
+         r->max_bytes);
+  if (r->kind == CASE_THUMB) {
+    printf(" thumb_bytes=%u", (unsigned)(r->total_thumb_bytes / n));
+  }
+  printf(" chunks=%u staging_b=%zu failures=%u mismatches=%u\n", r->chunks / n, r->staging_b, r->failures,
+         r->mismatches);
+}
+
+// The device's append_benchmark_case() fields, plus the case name, the
+// source side, mismatches and the staging size.
+static void print_json_case(const case_result_t *r, bool first)
+{
+  const uint32_t n = r->frames > 0 ? r->frames : 1U;
+  printf("%s{\"case\":\"%s\",\"side\":%u,\"width\":%u,\"height\":%u,\"quality\":%u,\"frames\":%u,\"failures\":%u,\"mismatches\":%u,"
+         "\"capture_us\":{\"avg\":%u,\"max\":%u},\"stage_us\":{\"avg\":%u,\"max\":%u},"
+         "\"encode_us\":{\"avg\":%u,\"max\":%u},\"publish_us\":{\"avg\":%u,\"max\":%u},"
+         "\"bytes\":{\"avg\":%u,\"max\":%zu},\"thumb_bytes\":%u,\"chunks\":%u,\"staging_b\":%zu}",
+         first ? "" : ",", s_case_names[r->kind], r->side, r->width, r->height, r->quality, r->frames, r->failures,
+         r->mismatches,
+         avg_us(&r->capture, r->frames), r->capture.max_us, avg_us(&r->stage, r->frames), r->stage.max_us,
+         avg_us(&r->encode, r->frames), r->encode.max_us, avg_us(&r->publish, r->frames), r->publish.max_us,
+         (unsigned)(r->total_bytes / n), r->max_bytes, (unsigned)(r->total_thumb_bytes / n), r->chunks / n,
+         r->staging_b);
+}
+
+static void add_time(stage_time_t *time, int64_t us)
+{
+  time->total_us += (uint64_t)us;
+  if ((uint32_t)us > time->max_us) {
+    time->max_us = (uint32_t)us;
+  }
+}
+
+static uint32_t avg_us(const stage_time_t *time, uint32_t frames)
+{
+  return frames > 0 ? (uint32_t)(time->total_us / frames) : 0U;
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,231 @@
+/*
+ * Host tests for the presence-driven camera power policy
+ * (main/streaming/camera_power_policy.c).
+ *
+ * Walks the ACTIVE -> IDLE -> OFF -> ACTIVE state machine through scripted
+ * presence timelines, using the Kconfig defaults (idle after 60 s, off after
+ * 900 s). Each step checks both the state and the "changed" return value the
+ * snapshot task logs and acts on. Also covered:
+ *
+ * - the off_after < idle_after clamp
+ * - the UINT32_MAX config used when presence power is disabled
+ * - a clock that steps backwards
+ * - a randomised run checking the invariants the snapshot task relies on
+ *
+ *   cc -O1 -g -fsanitize=address,undefined -Imain scripts/camera_power_policy_test.c \
+ *     main/streaming/camera_power_policy.c -o /tmp/camera_power_policy_test
+ *   /tmp/camera_power_policy_test
+ *
+ * Exits non-zero on any failure.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "streaming/camera_power_policy.h"
+
+#define TEST_IDLE_AFTER_MS   (60U * 1000U)  // CONFIG_THEO_CAMERA_VACANT_IDLE_AFTER_S default
+#define TEST_OFF_AFTER_MS    (900U * 1000U) // CONFIG_THEO_CAMERA_VACANT_OFF_AFTER_S default
+#define TEST_RANDOM_STEPS    (200000)
+#define TEST_MS              (1000LL)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+typedef struct {
+  int64_t at_ms;
+  bool present;
+  camera_power_state_t state;
+  bool changed;
+} test_step_t;
+
+static int s_failures;
+
+static void run_steps(const char *name, const camera_power_policy_config_t *config, const test_step_t *steps,
+                      size_t count)
+{
+  camera_power_policy_t policy;
+  camera_power_policy_init(&policy, config, 0);
+  CHECK(policy.state == CAMERA_POWER_ACTIVE);
+  for (size_t i = 0; i < count; ++i) {
+    const bool changed = camera_power_policy_update(&policy, steps[i].present, steps[i].at_ms * TEST_MS);
+    if (policy.state != steps[i].state || changed != steps[i].changed) {
+      fprintf(stderr, "%s step %zu at_ms=%lld: state=%s changed=%d, want state=%s changed=%d\n", name, i,
+              (long long)steps[i].at_ms, camera_power_state_to_str(policy.state), changed,
+              camera_power_state_to_str(steps[i].state), steps[i].changed);
+      s_failures++;
+    }
+  }
+}
+
+static void test_defaults_timeline(void)
+{
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, TEST_OFF_AFTER_MS};
+  const test_step_t steps[] = {
+    // Present at boot; stays ACTIVE and reports no change.
+    {0, true, CAMERA_POWER_ACTIVE, false},
+    {1000, true, CAMERA_POWER_ACTIVE, false},
+    // The room empties at 1 s. IDLE exactly idle_after later, not before.
+    {30000, false, CAMERA_POWER_ACTIVE, false},
+    {60999, false, CAMERA_POWER_ACTIVE, false},
+    {61000, false, CAMERA_POWER_IDLE, true},
+    {61500, false, CAMERA_POWER_IDLE, false},
+    // OFF exactly off_after after the last presence.
+    {900999, false, CAMERA_POWER_IDLE, false},
+    {901000, false, CAMERA_POWER_OFF, true},
+    {2000000, false, CAMERA_POWER_OFF, false},
+    // Any presence wakes straight to ACTIVE, from OFF...
+    {2000100, true, CAMERA_POWER_ACTIVE, true},
+    // ...and from IDLE.
+    {2060100, false, CAMERA_POWER_IDLE, true},
+    {2060200, true, CAMERA_POWER_ACTIVE, true},
+    // Brief presence restarts the vacancy clock.
+    {2100000, false, CAMERA_POWER_ACTIVE, false},
+    {2110000, true, CAMERA_POWER_ACTIVE, false},
+    {2169999, false, CAMERA_POWER_ACTIVE, false},
+    {2170000, false, CAMERA_POWER_IDLE, true},
+  };
+  run_steps("defaults", &config, steps, sizeof(steps) / sizeof(steps[0]));
+}
+
+static void test_sparse_samples(void)
+{
+  // The snapshot task can sleep through a whole stage; a late sample jumps
+  // straight from ACTIVE to OFF.
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, TEST_OFF_AFTER_MS};
+  const test_step_t steps[] = {
+    {0, false, CAMERA_POWER_ACTIVE, false},
+    {950000, false, CAMERA_POWER_OFF, true},
+    {950001, true, CAMERA_POWER_ACTIVE, true},
+  };
+  run_steps("sparse", &config, steps, sizeof(steps) / sizeof(steps[0]));
+}
+
+static void test_off_clamped_to_idle(void)
+{
+  // Kconfig allows off_after below idle_after; it is raised to idle_after, so
+  // vacancy goes straight to OFF.
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, 10U * 1000U};
+  camera_power_policy_t policy;
+  camera_power_policy_init(&policy, &config, 0);
+  CHECK(policy.config.off_after_ms == TEST_IDLE_AFTER_MS);
+  const test_step_t steps[] = {
+    {10000, false, CAMERA_POWER_ACTIVE, false},
+    {59999, false, CAMERA_POWER_ACTIVE, false},
+    {60000, false, CAMERA_POWER_OFF, true},
+  };
+  run_steps("clamped", &config, steps, sizeof(steps) / sizeof(steps[0]));
+}
+
+static void test_disabled_config(void)
+{
+  // Without presence power the snapshot task uses UINT32_MAX for both. Even
+  // a month of reported vacancy must not leave ACTIVE or overflow.
+  const camera_power_policy_config_t config = {UINT32_MAX, UINT32_MAX};
+  const test_step_t steps[] = {
+    {0, false, CAMERA_POWER_ACTIVE, false},
+    {30LL * 24 * 3600 * 1000, false, CAMERA_POWER_ACTIVE, false},
+  };
+  run_steps("disabled", &config, steps, sizeof(steps) / sizeof(steps[0]));
+}
+
+static void test_clock_backwards(void)
+{
+  // A timestamp before the last presence counts as no vacancy.
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, TEST_OFF_AFTER_MS};
+  const test_step_t steps[] = {
+    {100000, true, CAMERA_POWER_ACTIVE, false},
+    {50000, false, CAMERA_POWER_ACTIVE, false},
+    {160000, false, CAMERA_POWER_IDLE, true},
+  };
+  run_steps("backwards", &config, steps, sizeof(steps) / sizeof(steps[0]));
+}
+
+static void test_init_time(void)
+{
+  // init() counts as presence at now_us, not at time zero.
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, TEST_OFF_AFTER_MS};
+  camera_power_policy_t policy;
+  camera_power_policy_init(&policy, &config, 500000 * TEST_MS);
+  CHECK(!camera_power_policy_update(&policy, false, 559999 * TEST_MS));
+  CHECK(policy.state == CAMERA_POWER_ACTIVE);
+  CHECK(camera_power_policy_update(&policy, false, 560000 * TEST_MS));
+  CHECK(policy.state == CAMERA_POWER_IDLE);
+}
+
+static void test_random_invariants(void)
+{
+  // Presence flickers at random with random gaps between samples. The state
+  // must always match the time since the last present sample, and "changed"
+  // must be true exactly when the state moved.
+  const camera_power_policy_config_t config = {TEST_IDLE_AFTER_MS, TEST_OFF_AFTER_MS};
+  camera_power_policy_t policy;
+  camera_power_policy_init(&policy, &config, 0);
+  uint32_t rng = 0x12345678U;
+  int64_t now_ms = 0;
+  int64_t last_present_ms = 0;
+  int transitions[3][3] = {{0}};
+  for (int i = 0; i < TEST_RANDOM_STEPS; ++i) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    // Mostly short gaps, sometimes long ones; presence about 1 in 50.
+    now_ms += (rng & 0x700U) == 0 ? (int64_t)(rng % 1000000U) : (int64_t)(rng % 5000U);
+    const bool present = (rng >> 20) % 50U == 0;
+    if (present) {
+      last_present_ms = now_ms;
+    }
+    const camera_power_state_t before = policy.state;
+    const bool changed = camera_power_policy_update(&policy, present, now_ms * TEST_MS);
+    const int64_t vacant_ms = now_ms - last_present_ms;
+    const camera_power_state_t want = vacant_ms >= TEST_OFF_AFTER_MS    ? CAMERA_POWER_OFF
+                                      : vacant_ms >= TEST_IDLE_AFTER_MS ? CAMERA_POWER_IDLE
+                                                                        : CAMERA_POWER_ACTIVE;
+    CHECK(policy.state == want);
+    CHECK(changed == (policy.state != before));
+    CHECK(!present || policy.state == CAMERA_POWER_ACTIVE);
+    transitions[before][policy.state]++;
+  }
+  // Every transition the snapshot task handles actually happened.
+  CHECK(transitions[CAMERA_POWER_ACTIVE][CAMERA_POWER_IDLE] > 0);
+  CHECK(transitions[CAMERA_POWER_ACTIVE][CAMERA_POWER_OFF] > 0);
+  CHECK(transitions[CAMERA_POWER_IDLE][CAMERA_POWER_OFF] > 0);
+  CHECK(transitions[CAMERA_POWER_IDLE][CAMERA_POWER_ACTIVE] > 0);
+  CHECK(transitions[CAMERA_POWER_OFF][CAMERA_POWER_ACTIVE] > 0);
+  // OFF never steps back to IDLE; only presence leaves OFF.
+  CHECK(transitions[CAMERA_POWER_OFF][CAMERA_POWER_IDLE] == 0);
+}
+
+static void test_state_names(void)
+{
+  CHECK(strcmp(camera_power_state_to_str(CAMERA_POWER_ACTIVE), "active") == 0);
+  CHECK(strcmp(camera_power_state_to_str(CAMERA_POWER_IDLE), "idle") == 0);
+  CHECK(strcmp(camera_power_state_to_str(CAMERA_POWER_OFF), "off") == 0);
+  CHECK(strcmp(camera_power_state_to_str((camera_power_state_t)7), "unknown") == 0);
+}
+
+int main(void)
+{
+  test_defaults_timeline();
+  test_sparse_samples();
+  test_off_clamped_to_idle();
+  test_disabled_config();
+  test_clock_backwards();
+  test_init_time();
+  test_random_invariants();
+  test_state_names();
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
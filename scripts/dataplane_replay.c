@@ -0,0 +1,830 @@
+/*
+ * Host replay harness for the MQTT dataplane ingress path.
+ *
+ * Links the unchanged main/connectivity/mqtt_dataplane.c with json_scan,
+ * topic_router and fragment_reassembly. The FreeRTOS, esp-mqtt, esp_timer,
+ * esp_log and LVGL-lock shims and the stubs for UI, LED, presence, radar and
+ * camera calls come from scripts/host. The dataplane task runs on its own
+ * thread, as on the device.
+ *
+ * The harness reads a capture written by `scripts/theoreplay.py record`. It
+ * acts as the esp-mqtt task: each message is split into MQTT_EVENT_DATA events
+ * sized to esp-mqtt's receive buffer and handed to the registered handler,
+ * either at the recorded pace (--speed) or back to back (--fast). Like
+ * theoreplay, it brackets the run with dataplane_digest commands. It then
+ * prints the same host: and device: summary, taken from the dataplane's own
+ * digest log lines and diagnostics JSON:
+ *
+ * - throughput
+ * - drops by reason
+ * - slab and lane high-water marks
+ * - per-class latency
+ *
+ * It also reports the handler (ingress) time per topic.
+ *
+ * Host scheduling is not the device's. Compare latency between builds on one
+ * machine, not against device figures; drop and lane behaviour under --fast
+ * is the interesting part.
+ *
+ *   cc -O2 -g -Iscripts/host/include -Imain scripts/dataplane_replay.c scripts/host/idf_shim.c \
+ *     scripts/host/firmware_stubs.c main/connectivity/mqtt_dataplane.c main/connectivity/json_scan.c \
+ *     main/connectivity/topic_router.c main/connectivity/fragment_reassembly.c \
+ *     -lm -lpthread -o /tmp/dataplane_replay
+ *   /tmp/dataplane_replay [--fast | --speed X] [--buffer BYTES] [--widget-us US] [-v] capture.jsonl
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "connectivity/json_scan.h"
+#include "connectivity/mqtt_dataplane.h"
+#include "host_shim.h"
+#include "sdkconfig.h"
+
+#define REPLAY_CAPTURE_FORMAT   (1)
+#define REPLAY_DEFAULT_BUFFER   (1024)  // esp-mqtt's default buffer.size
+#define REPLAY_MAX_TOPIC_LEN    (256)
+#define REPLAY_MAX_TOPICS       (128)
+#define REPLAY_MAX_DROP_REASONS (16)
+#define REPLAY_MAX_CLASSES      (8)
+#define REPLAY_MAX_STAGES       (4)
+#define REPLAY_NAME_LEN         (32)
+#define REPLAY_FIELD_LEN        (32)
+#define REPLAY_DIGEST_COMMAND   "dataplane_digest"
+
+typedef struct {
+  double t;
+  char *topic;
+  int qos;
+  bool retain;
+  uint8_t *payload;
+  size_t payload_len;
+} replay_record_t;
+
+typedef struct {
+  char topic[REPLAY_MAX_TOPIC_LEN];
+  size_t sent;
+  int64_t *ingress_ns;
+} topic_stats_t;
+
+typedef struct {
+  char name[REPLAY_NAME_LEN];
+  long value;
+} named_count_t;
+
+typedef struct {
+  char name[REPLAY_NAME_LEN];
+  size_t stage_count;
+  char stage[REPLAY_MAX_STAGES][REPLAY_NAME_LEN];
+  long values[REPLAY_MAX_STAGES][4]; // samples, p50, p95, p99
+} latency_class_t;
+
+// One closed digest window, as theoreplay collects it from the device.
+typedef struct {
+  bool have_digest;
+  char slab_hwm[REPLAY_FIELD_LEN];
+  size_t lane_count;
+  char lane_line[2][1024];
+  char *diag;
+  size_t diag_len;
+} device_window_t;
+
+static pthread_mutex_t s_window_mutex = PTHREAD_MUTEX_INITIALIZER;
+static device_window_t s_window;
+static esp_mqtt_client_handle_t s_client;
+static char s_device_root[REPLAY_MAX_TOPIC_LEN];
+static char s_diag_topic[REPLAY_MAX_TOPIC_LEN + 32];
+
+static bool load_capture(const char *path, replay_record_t **out_records, size_t *out_count);
+static bool parse_header(const char *line, size_t len, char *ha_base, char *device_root);
+static bool parse_record(const char *line, size_t len, replay_record_t *record);
+static bool decode_string(const json_tok_t *tok, uint8_t *dst, size_t *dst_len);
+static bool decode_base64(const char *src, size_t len, uint8_t *dst, size_t *dst_len);
+static int64_t deliver_message(const char *topic, const uint8_t *payload, size_t len, int qos, bool retain,
+                               size_t buffer_size, int *next_msg_id);
+static bool close_window(TaskHandle_t task, size_t buffer_size, int *next_msg_id);
+static void on_log_line(esp_log_level_t level, const char *tag, const char *line);
+static void on_publish(const char *topic, const char *data, size_t len, int qos, bool enqueued);
+static bool log_field(const char *line, const char *key, char *out, size_t out_len);
+static bool parse_diag(const char *json, size_t len, double *window_s, long *complete, named_count_t *drops,
+                       size_t *drop_count, latency_class_t *classes, size_t *class_count);
+static void print_host_summary(size_t count, size_t bytes, double send_s, double drain_s, topic_stats_t *topics,
+                               size_t topic_count);
+static void print_device_summary(const device_window_t *window);
+static int compare_i64(const void *a, const void *b);
+static int compare_named(const void *a, const void *b);
+static int compare_topic(const void *a, const void *b);
+static int compare_class(const void *a, const void *b);
+static int64_t now_ns(void);
+
+
+static void usage(void)
+{
+  fprintf(stderr,
+          "usage: dataplane_replay [--fast | --speed X] [--buffer BYTES] [--widget-us US] [-v] capture.jsonl\n");
+}
+
+int main(int argc, char **argv)
+{
+  double speed = 1.0;
+  bool fast = false;
+  size_t buffer_size = REPLAY_DEFAULT_BUFFER;
+  const char *path = NULL;
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--fast") == 0) {
+      fast = true;
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--buffer") == 0 && i + 1 < argc) {
+      buffer_size = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--widget-us") == 0 && i + 1 < argc) {
+      host_stubs_set_widget_us((unsigned)strtoul(argv[++i], NULL, 10));
+    } else if (strcmp(argv[i], "-v") == 0) {
+      esp_log_level_set("*", ESP_LOG_INFO);
+    } else if (argv[i][0] != '-' && path == NULL) {
+      path = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (path == NULL || speed <= 0.0 || buffer_size < 64) {
+    usage();
+    return 2;
+  }
+
+  replay_record_t *records = NULL;
+  size_t count = 0;
+  if (!load_capture(path, &records, &count)) {
+    return 1;
+  }
+  if (count == 0) {
+    fprintf(stderr, "dataplane_replay: %s has no messages\n", path);
+    return 1;
+  }
+
+  host_log_set_hook(on_log_line);
+  host_mqtt_set_publish_hook(on_publish);
+  snprintf(s_diag_topic, sizeof(s_diag_topic), "%s/diagnostics/mqtt_dataplane", s_device_root);
+  s_client = host_mqtt_client_create();
+  host_stubs_init(s_client, s_device_root);
+  // With the manager reporting connected, start() queues the subscriptions
+  // itself, as after a late dataplane start on the device.
+  if (mqtt_dataplane_start(NULL, NULL) != ESP_OK) {
+    fprintf(stderr, "dataplane_replay: mqtt_dataplane_start failed\n");
+    return 1;
+  }
+  TaskHandle_t task = mqtt_dataplane_get_task_handle();
+  int next_msg_id = 0;
+  fprintf(stderr, "dataplane_replay: closing the dataplane's current digest window\n");
+  if (!close_window(task, buffer_size, &next_msg_id)) {
+    fprintf(stderr, "dataplane_replay: no digest from the dataplane\n");
+    return 1;
+  }
+
+  if (fast) {
+    fprintf(stderr, "dataplane_replay: replaying %zu messages at max speed\n", count);
+  } else {
+    fprintf(stderr, "dataplane_replay: replaying %zu messages at %gx\n", count, speed);
+  }
+  topic_stats_t *topics = calloc(REPLAY_MAX_TOPICS, sizeof(*topics));
+  size_t topic_count = 0;
+  size_t sent_bytes = 0;
+  const double base_t = records[0].t;
+  const int64_t start_ns = now_ns();
+  for (size_t i = 0; i < count; ++i) {
+    const replay_record_t *record = &records[i];
+    if (!fast) {
+      const int64_t due_ns = start_ns + (int64_t)((record->t - base_t) / speed * 1e9);
+      const int64_t delay_ns = due_ns - now_ns();
+      if (delay_ns > 0) {
+        const struct timespec ts = {.tv_sec = delay_ns / 1000000000, .tv_nsec = delay_ns % 1000000000};
+        nanosleep(&ts, NULL);
+      }
+    }
+    const int64_t ingress_ns = deliver_message(record->topic, record->payload, record->payload_len, record->qos,
+                                               record->retain, buffer_size, &next_msg_id);
+    sent_bytes += record->payload_len;
+
+    size_t t = 0;
+    while (t < topic_count && strcmp(topics[t].topic, record->topic) != 0) {
+      t++;
+    }
+    if (t == topic_count && topic_count < REPLAY_MAX_TOPICS) {
+      snprintf(topics[t].topic, sizeof(topics[t].topic), "%s", record->topic);
+      topics[t].ingress_ns = calloc(count, sizeof(int64_t));
+      topic_count++;
+    }
+    if (t < topic_count) {
+      topics[t].ingress_ns[topics[t].sent++] = ingress_ns;
+    }
+  }
+  const int64_t sent_ns = now_ns();
+  host_task_wait_idle(task);
+  const int64_t drained_ns = now_ns();
+
+  print_host_summary(count, sent_bytes, (double)(sent_ns - start_ns) / 1e9, (double)(drained_ns - start_ns) / 1e9,
+                     topics, topic_count);
+  if (!close_window(task, buffer_size, &next_msg_id)) {
+    fprintf(stderr, "dataplane_replay: no digest from the dataplane\n");
+    return 1;
+  }
+  print_device_summary(&s_window);
+  printf("host: widget_updates=%zu\n", host_stubs_widget_updates());
+
+  for (size_t i = 0; i < topic_count; ++i) {
+    free(topics[i].ingress_ns);
+  }
+  free(topics);
+  for (size_t i = 0; i < count; ++i) {
+    free(records[i].topic);
+    free(records[i].payload);
+  }
+  free(records);
+  free(s_window.diag);
+  return 0;
+}
+
+// Sends dataplane_digest through the command topic and closes the window on
+// the following tick, as theoreplay does against a device.
+static bool close_window(TaskHandle_t task, size_t buffer_size, int *next_msg_id)
+{
+  char command_topic[REPLAY_MAX_TOPIC_LEN + 16];
+  snprintf(command_topic, sizeof(command_topic), "%s/command", s_device_root);
+  host_task_wait_idle(task);
+  pthread_mutex_lock(&s_window_mutex);
+  free(s_window.diag);
+  memset(&s_window, 0, sizeof(s_window));
+  pthread_mutex_unlock(&s_window_mutex);
+
+  deliver_message(command_topic, (const uint8_t *)REPLAY_DIGEST_COMMAND, strlen(REPLAY_DIGEST_COMMAND), 1, false,
+                  buffer_size, next_msg_id);
+  host_task_wait_idle(task);
+  mqtt_dataplane_periodic_tick(0);
+
+  pthread_mutex_lock(&s_window_mutex);
+  const bool complete = s_window.have_digest && s_window.lane_count == 2 && s_window.diag != NULL;
+  pthread_mutex_unlock(&s_window_mutex);
+  return complete;
+}
+
+// Splits one message into DATA events the way esp-mqtt fills its receive
+// buffer: the first event carries the topic and whatever payload fits behind
+// the PUBLISH header, later events a full buffer each. QoS 0 messages have
+// msg_id 0. Returns the time spent in the handler.
+static int64_t deliver_message(const char *topic, const uint8_t *payload, size_t len, int qos, bool retain,
+                               size_t buffer_size, int *next_msg_id)
+{
+  const size_t topic_len = strlen(topic);
+  const size_t variable_len = 2 + topic_len + (qos > 0 ? 2 : 0);
+  const size_t remaining = variable_len + len;
+  size_t fixed_len = 2;
+  for (size_t r = remaining; r >= 128; r >>= 7) {
+    fixed_len++;
+  }
+  const size_t header_len = fixed_len + variable_len;
+  const size_t head_room = (buffer_size > header_len) ? buffer_size - header_len : 0;
+  const int msg_id = (qos > 0) ? ++*next_msg_id : 0;
+
+  int64_t elapsed_ns = 0;
+  size_t offset = 0;
+  do {
+    const size_t room = (offset == 0) ? head_room : buffer_size;
+    const size_t chunk = (len - offset < room) ? len - offset : room;
+    esp_mqtt_event_t event = {
+        .event_id = MQTT_EVENT_DATA,
+        .data = (char *)payload + offset,
+        .data_len = (int)chunk,
+        .total_data_len = (int)len,
+        .current_data_offset = (int)offset,
+        .topic = (offset == 0) ? (char *)topic : NULL,
+        .topic_len = (offset == 0) ? (int)topic_len : 0,
+        .msg_id = msg_id,
+        .retain = retain,
+        .qos = qos,
+    };
+    const int64_t start_ns = now_ns();
+    host_mqtt_client_deliver(s_client, &event);
+    elapsed_ns += now_ns() - start_ns;
+    offset += chunk;
+  } while (offset < len);
+  return elapsed_ns;
+}
+
+static void on_log_line(esp_log_level_t level, const char *tag, const char *line)
+{
+  (void)level;
+  (void)tag;
+  pthread_mutex_lock(&s_window_mutex);
+  if (strstr(line, "mqtt_digest ") != NULL) {
+    s_window.have_digest = log_field(line, "slab_hwm", s_window.slab_hwm, sizeof(s_window.slab_hwm));
+  } else if (strstr(line, "mqtt_lane_digest ") != NULL && s_window.lane_count < 2) {
+    snprintf(s_window.lane_line[s_window.lane_count++], sizeof(s_window.lane_line[0]), "%s", line);
+  }
+  pthread_mutex_unlock(&s_window_mutex);
+}
+
+static void on_publish(const char *topic, const char *data, size_t len, int qos, bool enqueued)
+{
+  (void)qos;
+  (void)enqueued;
+  if (strcmp(topic, s_diag_topic) != 0) {
+    return;
+  }
+  pthread_mutex_lock(&s_window_mutex);
+  free(s_window.diag);
+  s_window.diag = malloc(len + 1);
+  memcpy(s_window.diag, data, len);
+  s_window.diag[len] = '\0';
+  s_window.diag_len = len;
+  pthread_mutex_unlock(&s_window_mutex);
+}
+
+static bool log_field(const char *line, const char *key, char *out, size_t out_len)
+{
+  const size_t key_len = strlen(key);
+  for (const char *p = strstr(line, key); p != NULL; p = strstr(p + 1, key)) {
+    if ((p == line || p[-1] == ' ') && p[key_len] == '=') {
+      const char *value = p + key_len + 1;
+      const size_t value_len = strcspn(value, " ");
+      snprintf(out, out_len, "%.*s", (int)value_len, value);
+      return true;
+    }
+  }
+  snprintf(out, out_len, "?");
+  return false;
+}
+
+static void print_host_summary(size_t count, size_t bytes, double send_s, double drain_s, topic_stats_t *topics,
+                               size_t topic_count)
+{
+  printf("host: sent=%zu bytes=%zu elapsed_s=%.3f msgs_per_s=%.1f drained_s=%.3f\n", count, bytes, send_s,
+         send_s > 0 ? (double)count / send_s : 0.0, drain_s);
+  qsort(topics, topic_count, sizeof(topics[0]), compare_topic);
+  for (size_t i = 0; i < topic_count; ++i) {
+    topic_stats_t *topic = &topics[i];
+    qsort(topic->ingress_ns, topic->sent, sizeof(int64_t), compare_i64);
+    printf("host: topic=%s sent=%zu ingress_p50_ns=%lld ingress_p99_ns=%lld\n", topic->topic, topic->sent,
+           (long long)topic->ingress_ns[(topic->sent - 1) / 2],
+           (long long)topic->ingress_ns[(topic->sent - 1) * 99 / 100]);
+  }
+}
+
+static void print_device_summary(const device_window_t *window)
+{
+  double window_s = 0.0;
+  long complete = 0;
+  named_count_t drops[REPLAY_MAX_DROP_REASONS];
+  size_t drop_count = 0;
+  latency_class_t classes[REPLAY_MAX_CLASSES];
+  size_t class_count = 0;
+  if (!parse_diag(window->diag, window->diag_len, &window_s, &complete, drops, &drop_count, classes,
+                  &class_count)) {
+    printf("device: diagnostics unreadable: %s\n", window->diag);
+    return;
+  }
+  printf("device: window_s=%.1f complete=%ld complete_per_s=%.1f slab_hwm=%s\n", window_s, complete,
+         window_s > 0 ? (double)complete / window_s : 0.0, window->slab_hwm);
+
+  qsort(drops, drop_count, sizeof(drops[0]), compare_named);
+  printf("device: drops");
+  for (size_t i = 0; i < drop_count; ++i) {
+    printf(" %s=%ld", drops[i].name, drops[i].value);
+  }
+  printf("%s\n", drop_count == 0 ? " none" : "");
+
+  for (size_t i = 0; i < window->lane_count; ++i) {
+    char lane[REPLAY_FIELD_LEN], hwm[REPLAY_FIELD_LEN], enqueued[REPLAY_FIELD_LEN], drop[REPLAY_FIELD_LEN];
+    char coalesced[REPLAY_FIELD_LEN], shed[REPLAY_FIELD_LEN];
+    const char *line = window->lane_line[i];
+    log_field(line, "lane", lane, sizeof(lane));
+    log_field(line, "hwm", hwm, sizeof(hwm));
+    log_field(line, "enqueued_delta", enqueued, sizeof(enqueued));
+    log_field(line, "drop_delta", drop, sizeof(drop));
+    log_field(line, "coalesced_delta", coalesced, sizeof(coalesced));
+    log_field(line, "shed_delta", shed, sizeof(shed));
+    printf("device: lane=%s hwm=%s enqueued=%s drop=%s coalesced=%s shed=%s\n", lane, hwm, enqueued, drop,
+           coalesced, shed);
+  }
+
+  qsort(classes, class_count, sizeof(classes[0]), compare_class);
+  for (size_t i = 0; i < class_count; ++i) {
+    const latency_class_t *cls = &classes[i];
+    bool any = false;
+    for (size_t s = 0; s < cls->stage_count; ++s) {
+      if (cls->values[s][0] == 0) {
+        continue;
+      }
+      if (!any) {
+        printf("device: latency_us class=%s", cls->name);
+        any = true;
+      }
+      printf(" %s=n%ld/p50:%ld/p95:%ld/p99:%ld", cls->stage[s], cls->values[s][0], cls->values[s][1],
+             cls->values[s][2], cls->values[s][3]);
+    }
+    if (any) {
+      printf("\n");
+    }
+  }
+}
+
+// Reads the diagnostics JSON publish_diag_digest() builds:
+// {"window_us":N,"complete":N,"drops":{reason:N,...},
+//  "latency_us":{class:{stage:[n,p50,p95,p99],...},...}}
+static bool parse_diag(const char *json, size_t len, double *window_s, long *complete, named_count_t *drops,
+                       size_t *drop_count, latency_class_t *classes, size_t *class_count)
+{
+  if (json == NULL) {
+    return false;
+  }
+  json_scanner_t scanner;
+  json_tok_t tok;
+  json_scanner_init(&scanner, json, len);
+  if (!json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_OBJECT_BEGIN) {
+    return false;
+  }
+  char key[REPLAY_NAME_LEN];
+  int32_t number = 0;
+  while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+    if (!json_tok_copy_string(&tok, key, sizeof(key)) || !json_scanner_next(&scanner, &tok)) {
+      return false;
+    }
+    if (strcmp(key, "window_us") == 0 && tok.type == JSON_TOK_NUMBER) {
+      *window_s = strtod(tok.start, NULL) / 1e6;
+    } else if (strcmp(key, "complete") == 0 && json_tok_to_int32(&tok, &number)) {
+      *complete = number;
+    } else if (strcmp(key, "drops") == 0 && tok.type == JSON_TOK_OBJECT_BEGIN) {
+      while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+        named_count_t *drop = &drops[*drop_count];
+        if (!json_tok_copy_string(&tok, drop->name, sizeof(drop->name)) || !json_scanner_next(&scanner, &tok) ||
+            !json_tok_to_int32(&tok, &number)) {
+          return false;
+        }
+        drop->value = number;
+        if (*drop_count + 1 < REPLAY_MAX_DROP_REASONS) {
+          (*drop_count)++;
+        }
+      }
+      if (tok.type != JSON_TOK_OBJECT_END) {
+        return false;
+      }
+    } else if (strcmp(key, "latency_us") == 0 && tok.type == JSON_TOK_OBJECT_BEGIN) {
+      while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+        latency_class_t *cls = &classes[*class_count];
+        memset(cls, 0, sizeof(*cls));
+        if (!json_tok_copy_string(&tok, cls->name, sizeof(cls->name)) || !json_scanner_next(&scanner, &tok) ||
+            tok.type != JSON_TOK_OBJECT_BEGIN) {
+          return false;
+        }
+        while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+          const size_t s = cls->stage_count;
+          if (s >= REPLAY_MAX_STAGES || !json_tok_copy_string(&tok, cls->stage[s], sizeof(cls->stage[s])) ||
+              !json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_ARRAY_BEGIN) {
+            return false;
+          }
+          for (size_t v = 0; v < 4; ++v) {
+            if (!json_scanner_next(&scanner, &tok) || !json_tok_to_int32(&tok, &number)) {
+              return false;
+            }
+            cls->values[s][v] = number;
+          }
+          if (!json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_ARRAY_END) {
+            return false;
+          }
+          cls->stage_count++;
+        }
+        if (tok.type != JSON_TOK_OBJECT_END) {
+          return false;
+        }
+        if (*class_count + 1 < REPLAY_MAX_CLASSES) {
+          (*class_count)++;
+        }
+      }
+      if (tok.type != JSON_TOK_OBJECT_END) {
+        return false;
+      }
+    } else if (!json_scanner_skip(&scanner, &tok)) {
+      return false;
+    }
+  }
+  return tok.type == JSON_TOK_OBJECT_END;
+}
+
+// ---------------------------------------------------------------------------
+// Capture loading. The first line is the header; each following line is one
+// message: {"t":s,"topic":"...","qos":n,"retain":b,"payload":"..."} with
+// "payload_b64" instead of "payload" for non-UTF-8 bytes.
+
+static bool load_capture(const char *path, replay_record_t **out_records, size_t *out_count)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "dataplane_replay: %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  char ha_base[REPLAY_MAX_TOPIC_LEN] = "";
+  size_t capacity = 256;
+  size_t count = 0;
+  replay_record_t *records = calloc(capacity, sizeof(*records));
+  char *line = NULL;
+  size_t line_cap = 0;
+  ssize_t line_len;
+  size_t line_no = 0;
+  bool ok = true;
+  while (ok && (line_len = getline(&line, &line_cap, file)) >= 0) {
+    line_no++;
+    while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+      line[--line_len] = '\0';
+    }
+    if (line_len == 0) {
+      continue;
+    }
+    if (line_no == 1) {
+      ok = parse_header(line, (size_t)line_len, ha_base, s_device_root);
+      if (!ok) {
+        fprintf(stderr, "dataplane_replay: %s has an unsupported header\n", path);
+      }
+      continue;
+    }
+    if (count == capacity) {
+      capacity *= 2;
+      records = realloc(records, capacity * sizeof(*records));
+    }
+    replay_record_t *record = &records[count];
+    if (!parse_record(line, (size_t)line_len, record)) {
+      fprintf(stderr, "dataplane_replay: %s:%zu: malformed record\n", path, line_no);
+      ok = false;
+      break;
+    }
+    // Remap the recorded HA base onto the one this build subscribes to; the
+    // device root is served as recorded.
+    const size_t base_len = strlen(ha_base);
+    if (strncmp(record->topic, ha_base, base_len) == 0 && record->topic[base_len] == '/' &&
+        strcmp(ha_base, CONFIG_THEO_HA_BASE_TOPIC) != 0) {
+      char *topic = malloc(strlen(CONFIG_THEO_HA_BASE_TOPIC) + strlen(record->topic + base_len) + 1);
+      sprintf(topic, "%s%s", CONFIG_THEO_HA_BASE_TOPIC, record->topic + base_len);
+      free(record->topic);
+      record->topic = topic;
+    }
+    count++;
+  }
+  free(line);
+  fclose(file);
+  if (ok && line_no == 0) {
+    fprintf(stderr, "dataplane_replay: %s is empty\n", path);
+    ok = false;
+  }
+  *out_records = records;
+  *out_count = count;
+  return ok;
+}
+
+static bool parse_header(const char *line, size_t len, char *ha_base, char *device_root)
+{
+  json_scanner_t scanner;
+  json_tok_t tok;
+  int32_t format = 0;
+  json_scanner_init(&scanner, line, len);
+  if (!json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_OBJECT_BEGIN) {
+    return false;
+  }
+  while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+    json_tok_t key = tok;
+    if (!json_scanner_next(&scanner, &tok)) {
+      return false;
+    }
+    if (json_tok_equals(&key, "format")) {
+      json_tok_to_int32(&tok, &format);
+    } else if (json_tok_equals(&key, "ha_base") && tok.type == JSON_TOK_STRING) {
+      json_tok_copy_string(&tok, ha_base, REPLAY_MAX_TOPIC_LEN);
+    } else if (json_tok_equals(&key, "device_root") && tok.type == JSON_TOK_STRING) {
+      json_tok_copy_string(&tok, device_root, REPLAY_MAX_TOPIC_LEN);
+    } else if (!json_scanner_skip(&scanner, &tok)) {
+      return false;
+    }
+  }
+  return format == REPLAY_CAPTURE_FORMAT && ha_base[0] != '\0' && device_root[0] != '\0';
+}
+
+static bool parse_record(const char *line, size_t len, replay_record_t *record)
+{
+  json_scanner_t scanner;
+  json_tok_t tok;
+  memset(record, 0, sizeof(*record));
+  json_scanner_init(&scanner, line, len);
+  if (!json_scanner_next(&scanner, &tok) || tok.type != JSON_TOK_OBJECT_BEGIN) {
+    return false;
+  }
+  bool have_payload = false;
+  while (json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_KEY) {
+    json_tok_t key = tok;
+    if (!json_scanner_next(&scanner, &tok)) {
+      return false;
+    }
+    if (json_tok_equals(&key, "t") && tok.type == JSON_TOK_NUMBER) {
+      record->t = strtod(tok.start, NULL);
+    } else if (json_tok_equals(&key, "topic") && tok.type == JSON_TOK_STRING) {
+      size_t topic_len = 0;
+      record->topic = malloc(tok.len + 1);
+      if (!decode_string(&tok, (uint8_t *)record->topic, &topic_len)) {
+        return false;
+      }
+      record->topic[topic_len] = '\0';
+    } else if (json_tok_equals(&key, "qos")) {
+      int32_t qos = 0;
+      json_tok_to_int32(&tok, &qos);
+      record->qos = qos;
+    } else if (json_tok_equals(&key, "retain")) {
+      record->retain = tok.type == JSON_TOK_TRUE;
+    } else if (json_tok_equals(&key, "payload") && tok.type == JSON_TOK_STRING) {
+      // Decoded UTF-8 is never longer than its escaped form.
+      record->payload = malloc(tok.len + 1);
+      have_payload = decode_string(&tok, record->payload, &record->payload_len);
+    } else if (json_tok_equals(&key, "payload_b64") && tok.type == JSON_TOK_STRING) {
+      record->payload = malloc(tok.len + 1);
+      have_payload = decode_base64(tok.start, tok.len, record->payload, &record->payload_len);
+    } else if (!json_scanner_skip(&scanner, &tok)) {
+      return false;
+    }
+  }
+  return tok.type == JSON_TOK_OBJECT_END && record->topic != NULL && have_payload;
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool read_hex4(const char *p, const char *end, uint32_t *out)
+{
+  if (end - p < 4) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    const int digit = hex_value(p[i]);
+    if (digit < 0) {
+      return false;
+    }
+    value = (value << 4) | (uint32_t)digit;
+  }
+  *out = value;
+  return true;
+}
+
+// json_tok_copy_string() folds non-ASCII \u escapes to '?', and Python's
+// json.dumps() escapes every non-ASCII character, so payloads are decoded
+// here to the exact UTF-8 bytes that were recorded.
+static bool decode_string(const json_tok_t *tok, uint8_t *dst, size_t *dst_len)
+{
+  const char *p = tok->start;
+  const char *end = tok->start + tok->len;
+  size_t n = 0;
+  while (p < end) {
+    if (*p != '\\') {
+      dst[n++] = (uint8_t)*p++;
+      continue;
+    }
+    if (++p == end) {
+      return false;
+    }
+    const char esc = *p++;
+    switch (esc) {
+    case '"':
+    case '\\':
+    case '/':
+      dst[n++] = (uint8_t)esc;
+      break;
+    case 'b':
+      dst[n++] = '\b';
+      break;
+    case 'f':
+      dst[n++] = '\f';
+      break;
+    case 'n':
+      dst[n++] = '\n';
+      break;
+    case 'r':
+      dst[n++] = '\r';
+      break;
+    case 't':
+      dst[n++] = '\t';
+      break;
+    case 'u': {
+      uint32_t cp = 0;
+      if (!read_hex4(p, end, &cp)) {
+        return false;
+      }
+      p += 4;
+      if (cp >= 0xd800 && cp < 0xdc00) {
+        uint32_t low = 0;
+        if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !read_hex4(p + 2, end, &low) || low < 0xdc00 ||
+            low >= 0xe000) {
+          return false;
+        }
+        p += 6;
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+      }
+      if (cp < 0x80) {
+        dst[n++] = (uint8_t)cp;
+      } else if (cp < 0x800) {
+        dst[n++] = (uint8_t)(0xc0 | (cp >> 6));
+        dst[n++] = (uint8_t)(0x80 | (cp & 0x3f));
+      } else if (cp < 0x10000) {
+        dst[n++] = (uint8_t)(0xe0 | (cp >> 12));
+        dst[n++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+        dst[n++] = (uint8_t)(0x80 | (cp & 0x3f));
+      } else {
+        dst[n++] = (uint8_t)(0xf0 | (cp >> 18));
+        dst[n++] = (uint8_t)(0x80 | ((cp >> 12) & 0x3f));
+        dst[n++] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+        dst[n++] = (uint8_t)(0x80 | (cp & 0x3f));
+      }
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  *dst_len = n;
+  return true;
+}
+
+static bool decode_base64(const char *src, size_t len, uint8_t *dst, size_t *dst_len)
+{
+  uint32_t bits = 0;
+  int bit_count = 0;
+  size_t n = 0;
+  for (size_t i = 0; i < len; ++i) {
+    const char c = src[i];
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '+') {
+      value = 62;
+    } else if (c == '/') {
+      value = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    bits = (bits << 6) | (uint32_t)value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      dst[n++] = (uint8_t)(bits >> bit_count);
+    }
+  }
+  *dst_len = n;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+
+static int compare_i64(const void *a, const void *b)
+{
+  const int64_t x = *(const int64_t *)a;
+  const int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_named(const void *a, const void *b)
+{
+  return strcmp(((const named_count_t *)a)->name, ((const named_count_t *)b)->name);
+}
+
+static int compare_topic(const void *a, const void *b)
+{
+  return strcmp(((const topic_stats_t *)a)->topic, ((const topic_stats_t *)b)->topic);
+}
+
+static int compare_class(const void *a, const void *b)
+{
+  return strcmp(((const latency_class_t *)a)->name, ((const latency_class_t *)b)->name);
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
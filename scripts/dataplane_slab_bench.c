@@ -0,0 +1,549 @@
+/*
+ * Host microbenchmark for the MQTT dataplane slab pool: payload copies and
+ * RAM per message, for the by-value queue that ingress used before the slab
+ * pool and for the slab path in main/connectivity/mqtt_dataplane.c.
+ *
+ * The new path is the unchanged mqtt_dataplane.c linked with the scripts/host
+ * shims and stubs, as in dataplane_replay.c. Its figures come from the
+ * dataplane's own `dataplane lanes created` and `mqtt_digest` log lines,
+ * less the dataplane_digest command that closes the window.
+ *
+ * The old path is rebuilt below from the ingress code before the slab pool.
+ * The handler copies each fragment into a stack dp_queue_msg_t that carries
+ * the topic and up to 1 KB of data, and sends it by value. The task receives
+ * it into a second stack copy. Multi-fragment messages are then copied into
+ * a single PSRAM reassembly buffer. Payload copies are counted the same way
+ * the dataplane counts them: handler copy, queue send, queue receive and
+ * reassembly append each count once. Only ingress is rebuilt; completed
+ * payloads go to a checksum, not the UI.
+ *
+ * Both paths are driven with the same synthetic bursts. Messages are split
+ * into DATA events by --buffer as esp-mqtt would, and each burst holds as
+ * many whole messages as fit in --burst events (at least one). A burst is
+ * sent back to back through the esp-mqtt handler, and the bench waits for
+ * the task to drain before the next one. The default burst is the old queue
+ * depth, so neither path should drop and copies_per_msg is exact. Larger
+ * bursts show how each path sheds load. Workloads:
+ *
+ * - state: small single-fragment payloads on the 11 Home Assistant topics
+ * - fragmented: 900-byte payloads on the face topic
+ * - mixed: every fourth message fragmented
+ *
+ * RAM is what each path allocates for ingress:
+ *
+ * - queue_b: queue item storage, counted by the queue shim
+ * - stack_b: by-value message copies on the handler and task stacks
+ * - psram_b: the reassembly buffer or slab pool
+ *
+ * The peak in use is the queue or slab high-water mark times its item size.
+ * mqtt_dataplane_start() runs once per process, so run one workload per
+ * invocation.
+ *
+ *   cc -O2 -g -Iscripts/host/include -Imain scripts/dataplane_slab_bench.c scripts/host/idf_shim.c \
+ *     scripts/host/firmware_stubs.c main/connectivity/mqtt_dataplane.c main/connectivity/json_scan.c \
+ *     main/connectivity/topic_router.c main/connectivity/fragment_reassembly.c \
+ *     -lm -lpthread -o /tmp/dataplane_slab_bench
+ *   /tmp/dataplane_slab_bench [--workload state|fragmented|mixed] [--messages N] [--burst EVENTS] [--buffer BYTES]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "connectivity/mqtt_dataplane.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "host_shim.h"
+#include "sdkconfig.h"
+
+#define BENCH_DEFAULT_MESSAGES (3000)
+#define BENCH_DEFAULT_BUFFER   (256)
+#define BENCH_FRAGMENTED_LEN   (900)
+#define BENCH_MAX_TOPIC_LEN    (256)
+#define BENCH_DIGEST_COMMAND   "dataplane_digest"
+
+// Layout of the ingress queue before the slab pool.
+#if CONFIG_THEO_RAM_WAVE2_MQTT_QUEUE_TUNING
+#define OLD_QUEUE_DEPTH        (6)
+#else
+#define OLD_QUEUE_DEPTH        (20)
+#endif
+#define OLD_MAX_TOPIC_LEN      (120)
+#define OLD_PAYLOAD_CAP        (1024)
+
+#define BENCH_DEFAULT_BURST    (OLD_QUEUE_DEPTH)
+
+typedef enum {
+  WORKLOAD_STATE = 0,
+  WORKLOAD_FRAGMENTED,
+  WORKLOAD_MIXED,
+} workload_t;
+
+typedef struct {
+  int type;
+  union {
+    struct {
+      int msg_id;
+      size_t total_len;
+      size_t fragment_len;
+      size_t offset;
+      int64_t timestamp_us;
+      char topic[OLD_MAX_TOPIC_LEN + 1];
+      size_t topic_len;
+      uint8_t data[OLD_PAYLOAD_CAP];
+      bool retained;
+      bool has_topic;
+    } fragment;
+  } payload;
+} old_queue_msg_t;
+
+typedef struct {
+  const char *suffix;
+  const char *payload;
+} bench_topic_t;
+
+typedef struct {
+  size_t sent;
+  size_t fragments;
+  uint64_t complete;
+  uint64_t copies;
+  uint64_t drops;
+  size_t queue_copied_b;
+  int64_t ingress_ns;
+  size_t queue_b;
+  size_t stack_b;
+  size_t psram_b;
+  size_t peak_b;
+  const char *peak_what;
+} path_result_t;
+
+typedef void (*deliver_fn_t)(esp_mqtt_event_t *event);
+
+static const bench_topic_t s_topics[] = {
+    {"sensor/pirateweather_temperature/state", "21.4"},
+    {"sensor/pirateweather_icon/state", "partly-cloudy-day"},
+    {"sensor/theoretical_thermostat_target_room_temperature/state", "20.9"},
+    {"climate/theoretical_thermostat_climate_control/target_temp_low", "19.5"},
+    {"climate/theoretical_thermostat_climate_control/target_temp_high", "24.0"},
+    {"sensor/theoretical_thermostat_target_room_name/state", "Office"},
+    {"binary_sensor/theoretical_thermostat_computed_fan/state", "off"},
+    {"binary_sensor/theoretical_thermostat_computed_heat/state", "on"},
+    {"binary_sensor/theoretical_thermostat_computed_a_c/state", "off"},
+    {"sensor/hallway_camera_last_recognized_face/state", "Scott"},
+    {"sensor/hallway_camera_person_count/state", "1"},
+};
+#define BENCH_TOPIC_COUNT (sizeof(s_topics) / sizeof(s_topics[0]))
+#define BENCH_FACE_TOPIC  (9)
+
+static const char *const s_device_root = "theostat/bench";
+
+static esp_mqtt_client_handle_t s_client;
+static pthread_mutex_t s_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char s_lanes_line[512];
+static char s_digest_line[2048];
+
+static QueueHandle_t s_old_queue;
+static TaskHandle_t s_old_task;
+static UBaseType_t s_old_queue_hwm;
+static uint64_t s_old_copies;
+static uint64_t s_old_complete;
+static uint64_t s_old_drops;
+static uint64_t s_old_enqueued;
+static uint64_t s_old_handled;
+static uint32_t s_old_checksum;
+static bool s_old_active;
+static int s_old_msg_id;
+static size_t s_old_total_len;
+static size_t s_old_filled;
+static uint8_t s_old_reassembly[OLD_PAYLOAD_CAP + 1];
+
+static void run_workload(workload_t workload, size_t messages, size_t burst, size_t buffer_size,
+                         deliver_fn_t deliver, void (*wait_idle)(void), path_result_t *result);
+static size_t message_events(const char *topic, size_t len, size_t buffer_size, size_t *head_room);
+static size_t deliver_message(const char *topic, const uint8_t *payload, size_t len, size_t buffer_size,
+                              int *next_msg_id, deliver_fn_t deliver, int64_t *ingress_ns);
+static void old_path_start(void);
+static void old_handler(esp_mqtt_event_t *event);
+static void old_task(void *arg);
+static void old_handle_fragment(const old_queue_msg_t *msg);
+static void old_sink(const uint8_t *data, size_t len);
+static void old_wait_idle(void);
+static void new_deliver(esp_mqtt_event_t *event);
+static void new_wait_idle(void);
+static void close_window(int *next_msg_id);
+static void on_log_line(esp_log_level_t level, const char *tag, const char *line);
+static long log_long(const char *line, const char *key);
+static void print_result(const char *path, const path_result_t *result);
+static int64_t now_ns(void);
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: dataplane_slab_bench [--workload state|fragmented|mixed] [--messages N] "
+                  "[--burst EVENTS] [--buffer BYTES]\n");
+}
+
+int main(int argc, char **argv)
+{
+  workload_t workload = WORKLOAD_MIXED;
+  const char *workload_name = "mixed";
+  size_t messages = BENCH_DEFAULT_MESSAGES;
+  size_t burst = BENCH_DEFAULT_BURST;
+  size_t buffer_size = BENCH_DEFAULT_BUFFER;
+  esp_log_level_set("*", ESP_LOG_ERROR);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+      workload_name = argv[++i];
+      if (strcmp(workload_name, "state") == 0) {
+        workload = WORKLOAD_STATE;
+      } else if (strcmp(workload_name, "fragmented") == 0) {
+        workload = WORKLOAD_FRAGMENTED;
+      } else if (strcmp(workload_name, "mixed") == 0) {
+        workload = WORKLOAD_MIXED;
+      } else {
+        usage();
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+      messages = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+      burst = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--buffer") == 0 && i + 1 < argc) {
+      buffer_size = strtoul(argv[++i], NULL, 10);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (messages == 0 || burst == 0 || buffer_size < 160) {
+    usage();
+    return 2;
+  }
+  printf("bench: workload=%s messages=%zu burst_events=%zu buffer=%zu\n", workload_name, messages, burst, buffer_size);
+
+  host_queue_stats_t before;
+  host_queue_stats_t after;
+  path_result_t old_result = {0};
+  host_queue_get_stats(&before);
+  old_path_start();
+  host_queue_get_stats(&after);
+  old_result.queue_b = after.storage_bytes - before.storage_bytes;
+  run_workload(workload, messages, burst, buffer_size, old_handler, old_wait_idle, &old_result);
+  old_result.complete = s_old_complete;
+  old_result.copies = s_old_copies;
+  old_result.drops = s_old_drops;
+  // One message on the handler stack, one on the task stack.
+  old_result.stack_b = 2 * sizeof(old_queue_msg_t);
+  old_result.psram_b = sizeof(s_old_reassembly);
+  old_result.peak_b = s_old_queue_hwm * sizeof(old_queue_msg_t);
+  old_result.peak_what = "queue";
+  print_result("old", &old_result);
+
+  path_result_t new_result = {0};
+  host_log_set_hook(on_log_line);
+  s_client = host_mqtt_client_create();
+  host_stubs_init(s_client, s_device_root);
+  host_queue_get_stats(&before);
+  if (mqtt_dataplane_start(NULL, NULL) != ESP_OK) {
+    fprintf(stderr, "dataplane_slab_bench: mqtt_dataplane_start failed\n");
+    return 1;
+  }
+  host_queue_get_stats(&after);
+  new_result.queue_b = after.storage_bytes - before.storage_bytes;
+  int next_msg_id = 0;
+  close_window(&next_msg_id);
+  run_workload(workload, messages, burst, buffer_size, new_deliver, new_wait_idle, &new_result);
+  close_window(&next_msg_id);
+
+  pthread_mutex_lock(&s_log_mutex);
+  const long complete = log_long(s_digest_line, "complete_delta");
+  const long copies = log_long(s_digest_line, "copies_delta");
+  if (complete < 1 || copies < 1) {
+    pthread_mutex_unlock(&s_log_mutex);
+    fprintf(stderr, "dataplane_slab_bench: no digest from the dataplane\n");
+    return 1;
+  }
+  // The dataplane_digest command that closed the window is one single-fragment
+  // message, copied once.
+  new_result.complete = (uint64_t)(complete - 1);
+  new_result.copies = (uint64_t)(copies - 1);
+  new_result.drops = (uint64_t)(log_long(s_digest_line, "drop_queue_full_delta") +
+                                log_long(s_digest_line, "drop_no_slab_delta") +
+                                log_long(s_digest_line, "drop_oversize_delta"));
+  new_result.psram_b = (size_t)log_long(s_lanes_line, "pool_b");
+  new_result.peak_b = (size_t)(log_long(s_digest_line, "slab_hwm") * log_long(s_lanes_line, "slab_size"));
+  new_result.peak_what = "slab";
+  printf("new: item_size=%ld slabs=%ld slab_size=%ld\n", log_long(s_lanes_line, "item_size"),
+         log_long(s_lanes_line, "slabs"), log_long(s_lanes_line, "slab_size"));
+  pthread_mutex_unlock(&s_log_mutex);
+  print_result("new", &new_result);
+  return 0;
+}
+
+static void run_workload(workload_t workload, size_t messages, size_t burst, size_t buffer_size,
+                         deliver_fn_t deliver, void (*wait_idle)(void), path_result_t *result)
+{
+  char topics[BENCH_TOPIC_COUNT][BENCH_MAX_TOPIC_LEN];
+  for (size_t i = 0; i < BENCH_TOPIC_COUNT; ++i) {
+    snprintf(topics[i], sizeof(topics[i]), "%s/%s", CONFIG_THEO_HA_BASE_TOPIC, s_topics[i].suffix);
+  }
+  uint8_t large[BENCH_FRAGMENTED_LEN];
+  for (size_t i = 0; i < sizeof(large); ++i) {
+    large[i] = (uint8_t)('a' + i % 26);
+  }
+
+  host_queue_stats_t before;
+  host_queue_stats_t after;
+  host_queue_get_stats(&before);
+  int next_msg_id = 1000;
+  for (size_t sent = 0; sent < messages;) {
+    size_t events = 0;
+    while (sent < messages) {
+      const bool fragmented =
+          (workload == WORKLOAD_FRAGMENTED) || (workload == WORKLOAD_MIXED && sent % 4 == 3);
+      const size_t t = fragmented ? BENCH_FACE_TOPIC : sent % BENCH_TOPIC_COUNT;
+      const uint8_t *payload = fragmented ? large : (const uint8_t *)s_topics[t].payload;
+      const size_t len = fragmented ? sizeof(large) : strlen(s_topics[t].payload);
+      size_t head_room;
+      const size_t needed = message_events(topics[t], len, buffer_size, &head_room);
+      if (events > 0 && events + needed > burst) {
+        break;
+      }
+      events += deliver_message(topics[t], payload, len, buffer_size, &next_msg_id, deliver, &result->ingress_ns);
+      sent++;
+    }
+    result->fragments += events;
+    wait_idle();
+  }
+  host_queue_get_stats(&after);
+  result->sent = messages;
+  result->queue_copied_b = after.copied_bytes - before.copied_bytes;
+}
+
+// Counts the DATA events esp-mqtt makes of one QoS 1 message: the first
+// carries the topic and whatever payload fits behind the PUBLISH header,
+// later ones a full buffer each. See dataplane_replay.c.
+static size_t message_events(const char *topic, size_t len, size_t buffer_size, size_t *head_room)
+{
+  const size_t variable_len = 2 + strlen(topic) + 2;
+  const size_t remaining = variable_len + len;
+  size_t fixed_len = 2;
+  for (size_t r = remaining; r >= 128; r >>= 7) {
+    fixed_len++;
+  }
+  const size_t header_len = fixed_len + variable_len;
+  *head_room = (buffer_size > header_len) ? buffer_size - header_len : 0;
+  if (len <= *head_room) {
+    return 1;
+  }
+  return 1 + (len - *head_room + buffer_size - 1) / buffer_size;
+}
+
+// Delivers one QoS 1 message as DATA events and returns how many it took.
+static size_t deliver_message(const char *topic, const uint8_t *payload, size_t len, size_t buffer_size,
+                              int *next_msg_id, deliver_fn_t deliver, int64_t *ingress_ns)
+{
+  const size_t topic_len = strlen(topic);
+  size_t head_room;
+  message_events(topic, len, buffer_size, &head_room);
+  const int msg_id = ++*next_msg_id;
+
+  size_t events = 0;
+  size_t offset = 0;
+  do {
+    const size_t room = (offset == 0) ? head_room : buffer_size;
+    const size_t chunk = (len - offset < room) ? len - offset : room;
+    esp_mqtt_event_t event = {
+        .event_id = MQTT_EVENT_DATA,
+        .data = (char *)payload + offset,
+        .data_len = (int)chunk,
+        .total_data_len = (int)len,
+        .current_data_offset = (int)offset,
+        .topic = (offset == 0) ? (char *)topic : NULL,
+        .topic_len = (offset == 0) ? (int)topic_len : 0,
+        .msg_id = msg_id,
+        .retain = true,
+        .qos = 1,
+    };
+    const int64_t start_ns = now_ns();
+    deliver(&event);
+    *ingress_ns += now_ns() - start_ns;
+    offset += chunk;
+    events++;
+  } while (offset < len);
+  return events;
+}
+
+static void old_path_start(void)
+{
+  s_old_queue = xQueueCreate(OLD_QUEUE_DEPTH, sizeof(old_queue_msg_t));
+  xTaskCreatePinnedToCoreWithCaps(old_task, "old_dp", 8192, NULL, 5, &s_old_task, tskNO_AFFINITY, 0);
+}
+
+static void old_handler(esp_mqtt_event_t *event)
+{
+  old_queue_msg_t msg = {0};
+  msg.payload.fragment.msg_id = event->msg_id;
+  msg.payload.fragment.total_len = (event->total_data_len > 0) ? event->total_data_len : event->data_len;
+  msg.payload.fragment.fragment_len = event->data_len;
+  msg.payload.fragment.offset = event->current_data_offset;
+  msg.payload.fragment.timestamp_us = esp_timer_get_time();
+  msg.payload.fragment.retained = event->retain;
+  if (msg.payload.fragment.total_len > OLD_PAYLOAD_CAP) {
+    __atomic_add_fetch(&s_old_drops, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if (event->topic != NULL && event->topic_len > 0 && event->current_data_offset == 0) {
+    memcpy(msg.payload.fragment.topic, event->topic, event->topic_len);
+    msg.payload.fragment.topic_len = (size_t)event->topic_len;
+    msg.payload.fragment.has_topic = true;
+  }
+  memcpy(msg.payload.fragment.data, event->data, event->data_len);
+  __atomic_add_fetch(&s_old_copies, 1, __ATOMIC_RELAXED);
+  if (xQueueSend(s_old_queue, &msg, 0) != pdTRUE) {
+    __atomic_add_fetch(&s_old_drops, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  __atomic_add_fetch(&s_old_copies, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&s_old_enqueued, 1, __ATOMIC_RELAXED);
+  const UBaseType_t waiting = uxQueueMessagesWaiting(s_old_queue);
+  if (waiting > s_old_queue_hwm) {
+    s_old_queue_hwm = waiting;
+  }
+}
+
+static void old_task(void *arg)
+{
+  (void)arg;
+  old_queue_msg_t msg = {0};
+  while (true) {
+    if (xQueueReceive(s_old_queue, &msg, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    __atomic_add_fetch(&s_old_copies, 1, __ATOMIC_RELAXED);
+    old_handle_fragment(&msg);
+    __atomic_add_fetch(&s_old_handled, 1, __ATOMIC_RELEASE);
+  }
+}
+
+// Single-flow reassembly as it was before the slab pool, less the drop
+// bookkeeping this bench never triggers.
+static void old_handle_fragment(const old_queue_msg_t *msg)
+{
+  if (msg->payload.fragment.total_len <= msg->payload.fragment.fragment_len) {
+    old_sink(msg->payload.fragment.data, msg->payload.fragment.fragment_len);
+    __atomic_add_fetch(&s_old_complete, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if (msg->payload.fragment.offset == 0 && msg->payload.fragment.has_topic) {
+    s_old_active = true;
+    s_old_msg_id = msg->payload.fragment.msg_id;
+    s_old_total_len = msg->payload.fragment.total_len;
+    s_old_filled = 0;
+  }
+  if (!s_old_active || msg->payload.fragment.msg_id != s_old_msg_id ||
+      msg->payload.fragment.offset != s_old_filled) {
+    s_old_active = false;
+    __atomic_add_fetch(&s_old_drops, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  memcpy(s_old_reassembly + msg->payload.fragment.offset, msg->payload.fragment.data,
+         msg->payload.fragment.fragment_len);
+  __atomic_add_fetch(&s_old_copies, 1, __ATOMIC_RELAXED);
+  s_old_filled += msg->payload.fragment.fragment_len;
+  if (s_old_filled >= s_old_total_len) {
+    s_old_reassembly[s_old_total_len] = '\0';
+    old_sink(s_old_reassembly, s_old_total_len);
+    __atomic_add_fetch(&s_old_complete, 1, __ATOMIC_RELAXED);
+    s_old_active = false;
+  }
+}
+
+static void old_sink(const uint8_t *data, size_t len)
+{
+  uint32_t sum = s_old_checksum;
+  for (size_t i = 0; i < len; ++i) {
+    sum = sum * 31u + data[i];
+  }
+  s_old_checksum = sum;
+}
+
+static void old_wait_idle(void)
+{
+  while (__atomic_load_n(&s_old_handled, __ATOMIC_ACQUIRE) != __atomic_load_n(&s_old_enqueued, __ATOMIC_RELAXED)) {
+    const struct timespec ts = {.tv_sec = 0, .tv_nsec = 50000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+static void new_deliver(esp_mqtt_event_t *event)
+{
+  host_mqtt_client_deliver(s_client, event);
+}
+
+static void new_wait_idle(void)
+{
+  host_task_wait_idle(mqtt_dataplane_get_task_handle());
+}
+
+// Sends dataplane_digest through the command topic and closes the window on
+// the following tick, as dataplane_replay.c does.
+static void close_window(int *next_msg_id)
+{
+  char command_topic[BENCH_MAX_TOPIC_LEN];
+  snprintf(command_topic, sizeof(command_topic), "%s/command", s_device_root);
+  int64_t unused_ns = 0;
+  new_wait_idle();
+  deliver_message(command_topic, (const uint8_t *)BENCH_DIGEST_COMMAND, strlen(BENCH_DIGEST_COMMAND),
+                  BENCH_DEFAULT_BUFFER, next_msg_id, new_deliver, &unused_ns);
+  new_wait_idle();
+  mqtt_dataplane_periodic_tick(0);
+}
+
+static void on_log_line(esp_log_level_t level, const char *tag, const char *line)
+{
+  (void)level;
+  (void)tag;
+  pthread_mutex_lock(&s_log_mutex);
+  if (strstr(line, "dataplane lanes created ") != NULL) {
+    snprintf(s_lanes_line, sizeof(s_lanes_line), "%s", line);
+  } else if (strstr(line, "mqtt_digest ") != NULL) {
+    snprintf(s_digest_line, sizeof(s_digest_line), "%s", line);
+  }
+  pthread_mutex_unlock(&s_log_mutex);
+}
+
+// Reads key=<integer> from a log line; slab_hwm=<n>/<slabs> reads as n.
+static long log_long(const char *line, const char *key)
+{
+  const size_t key_len = strlen(key);
+  for (const char *p = strstr(line, key); p != NULL; p = strstr(p + 1, key)) {
+    if ((p == line || p[-1] == ' ') && p[key_len] == '=') {
+      return strtol(p + key_len + 1, NULL, 10);
+    }
+  }
+  return -1;
+}
+
+static void print_result(const char *path, const path_result_t *result)
+{
+  const double complete = (result->complete > 0) ? (double)result->complete : 1.0;
+  printf("%s: sent=%zu fragments=%zu complete=%llu drops=%llu copies_per_msg=%.2f queue_copied_b_per_msg=%.0f "
+         "ingress_ns_per_fragment=%.0f\n",
+         path, result->sent, result->fragments, (unsigned long long)result->complete,
+         (unsigned long long)result->drops, (double)result->copies / complete,
+         (double)result->queue_copied_b / complete,
+         (result->fragments > 0) ? (double)result->ingress_ns / (double)result->fragments : 0.0);
+  printf("%s: internal_b=%zu queue_b=%zu stack_b=%zu psram_b=%zu peak_%s_b=%zu\n", path,
+         result->queue_b + result->stack_b, result->queue_b, result->stack_b, result->psram_b, result->peak_what,
+         result->peak_b);
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,459 @@
+/*
+ * Fuzz test for MQTT fragment reassembly (main/connectivity/fragment_reassembly.c).
+ *
+ * Each round splits random messages into random fragments and pushes them
+ * into a three-slot reassembly, as the dataplane configures it.
+ *
+ * Clean rounds interleave at most as many concurrent messages as there are
+ * slots, each in order. Every message must complete exactly once with its
+ * exact bytes, and nothing may drop.
+ *
+ * Chaotic rounds add faults:
+ *
+ * - more flows than slots
+ * - duplicated, lost and swapped fragments
+ * - reused msg_ids and changed totals
+ * - oversize fragments
+ * - idle gaps past the timeout
+ *
+ * Whatever happens, every completed payload must equal its message's bytes.
+ * The module must also keep its slot invariants, and the caller's buffers
+ * must be adopted and returned exactly once. Every input sits in an
+ * exact-size heap buffer for sanitizer builds. Exits non-zero on any
+ * failure.
+ *
+ *   cc -O1 -g -fsanitize=address,undefined -Imain scripts/fragment_reassembly_fuzz.c \
+ *     main/connectivity/fragment_reassembly.c -o /tmp/fragment_reassembly_fuzz
+ *   /tmp/fragment_reassembly_fuzz [rounds] [seed]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "connectivity/fragment_reassembly.h"
+
+#define FUZZ_DEFAULT_ROUNDS (20000)
+#define FUZZ_SLOTS          (3)     // MQTT_DP_REASSEMBLY_SLOTS
+#define FUZZ_CAPACITY       (1024)  // MQTT_DP_REASSEMBLY_PAYLOAD_CAP
+#define FUZZ_TIMEOUT_US     (2000000)
+#define FUZZ_BUFFERS        (32)
+#define FUZZ_MAX_MESSAGES   (8)
+#define FUZZ_MAX_FRAGMENTS  (FUZZ_MAX_MESSAGES * 40)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+typedef struct {
+  int msg_id;
+  size_t total_len;
+  size_t offset;
+  size_t len;
+} planned_fragment_t;
+
+typedef struct {
+  int msg_id;
+  size_t total_len;
+  uint32_t completions;
+} message_t;
+
+static int s_failures;
+static uint64_t s_rng;
+static bool s_buffer_busy[FUZZ_BUFFERS];
+static uint8_t s_buffers[FUZZ_BUFFERS][FUZZ_CAPACITY + 1];
+static message_t s_messages[FUZZ_MAX_MESSAGES];
+static size_t s_message_count;
+static uint32_t s_results[FRAGMENT_RESULT_OVERSIZE + 1];
+static uint32_t s_ends[FRAGMENT_END_RESET + 1];
+static fragment_slot_t *s_slots;
+
+static uint32_t rng_next(void)
+{
+  s_rng ^= s_rng >> 12;
+  s_rng ^= s_rng << 25;
+  s_rng ^= s_rng >> 27;
+  return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t rng_below(uint32_t n)
+{
+  return rng_next() % n;
+}
+
+// Payload bytes depend only on msg_id, total and offset, so a flow that
+// picks up a stale fragment of an earlier message with the same msg_id and
+// total still assembles the right bytes; anything else shows up as a
+// mismatch.
+static uint8_t payload_byte(int msg_id, size_t total_len, size_t offset)
+{
+  uint32_t x = (uint32_t)msg_id * 0x9E3779B1u ^ (uint32_t)total_len * 0x85EBCA77u ^ (uint32_t)offset * 0xC2B2AE3Du;
+  x ^= x >> 15;
+  x *= 0x2C1B3C6Du;
+  x ^= x >> 12;
+  return (uint8_t)x;
+}
+
+static void on_end(void *ctx, size_t idx, const fragment_slot_t *slot, fragment_end_reason_t reason)
+{
+  (void)ctx;
+  CHECK(idx < FUZZ_SLOTS && slot == &s_slots[idx]);
+  CHECK(slot->active);
+  CHECK(reason <= FRAGMENT_END_RESET);
+  s_ends[reason]++;
+  CHECK(slot->buffer < FUZZ_BUFFERS && s_buffer_busy[slot->buffer]);
+  CHECK(slot->data == s_buffers[slot->buffer]);
+
+  if (reason == FRAGMENT_END_COMPLETE) {
+    CHECK(slot->filled == slot->total_len);
+    CHECK(slot->data[slot->total_len] == '\0');
+    for (size_t i = 0; i < slot->total_len; ++i) {
+      if (slot->data[i] != payload_byte(slot->msg_id, slot->total_len, i)) {
+        fprintf(stderr, "msg_id=%d total=%zu corrupt at offset %zu\n", slot->msg_id, slot->total_len, i);
+        s_failures++;
+        break;
+      }
+    }
+    for (size_t m = 0; m < s_message_count; ++m) {
+      if (s_messages[m].msg_id == slot->msg_id && s_messages[m].total_len == slot->total_len) {
+        s_messages[m].completions++;
+        break;
+      }
+    }
+  } else {
+    CHECK(slot->filled < slot->total_len);
+  }
+  s_buffer_busy[slot->buffer] = false;
+}
+
+static void check_slots(const fragment_reassembly_t *reassembly)
+{
+  for (size_t i = 0; i < reassembly->slot_count; ++i) {
+    const fragment_slot_t *slot = &reassembly->slots[i];
+    if (!slot->active) {
+      CHECK(slot->buffer == FRAGMENT_BUFFER_NONE);
+      continue;
+    }
+    CHECK(slot->filled > 0 && slot->filled < slot->total_len && slot->total_len <= FUZZ_CAPACITY);
+    CHECK(slot->buffer < FUZZ_BUFFERS && s_buffer_busy[slot->buffer]);
+    for (size_t j = i + 1; j < reassembly->slot_count; ++j) {
+      if (reassembly->slots[j].active) {
+        CHECK(reassembly->slots[j].msg_id != slot->msg_id);
+        CHECK(reassembly->slots[j].buffer != slot->buffer);
+      }
+    }
+  }
+}
+
+static uint8_t take_buffer(void)
+{
+  for (uint8_t i = 0; i < FUZZ_BUFFERS; ++i) {
+    if (!s_buffer_busy[i]) {
+      s_buffer_busy[i] = true;
+      return i;
+    }
+  }
+  // Three slots can hold at most three buffers; one more is in flight.
+  fprintf(stderr, "buffer leak\n");
+  abort();
+}
+
+static fragment_result_t push(fragment_reassembly_t *reassembly, const planned_fragment_t *plan, int64_t now_us)
+{
+  // The fragment's bytes, in an exact-size allocation.
+  const size_t len = plan->len;
+  uint8_t *bytes = malloc(len > 0 ? len : 1);
+  for (size_t i = 0; i < len; ++i) {
+    bytes[i] = payload_byte(plan->msg_id, plan->total_len, plan->offset + i);
+  }
+
+  fragment_t fragment = {
+      .msg_id = plan->msg_id,
+      .offset = plan->offset,
+      .len = len,
+      .total_len = plan->total_len,
+      .now_us = now_us,
+      .head = plan->offset == 0,
+      .data = bytes,
+      .buffer = FRAGMENT_BUFFER_NONE,
+      .buffer_data = NULL,
+  };
+  if (fragment.head) {
+    // The dataplane receives a head straight into its slab.
+    fragment.buffer = take_buffer();
+    fragment.buffer_data = s_buffers[fragment.buffer];
+    memset(fragment.buffer_data, 0xEE, FUZZ_CAPACITY + 1);
+    if (len <= FUZZ_CAPACITY) {
+      memcpy(fragment.buffer_data, bytes, len);
+    }
+  }
+
+  size_t idx = 0;
+  const fragment_result_t result = fragment_reassembly_push(reassembly, &fragment, &idx);
+  CHECK(result <= FRAGMENT_RESULT_OVERSIZE);
+  s_results[result]++;
+  switch (result) {
+  case FRAGMENT_RESULT_STARTED:
+    CHECK(fragment.head && idx < FUZZ_SLOTS && reassembly->slots[idx].buffer == fragment.buffer);
+    break;
+  case FRAGMENT_RESULT_APPENDED:
+    CHECK(!fragment.head && idx < FUZZ_SLOTS && reassembly->slots[idx].active);
+    break;
+  case FRAGMENT_RESULT_COMPLETE:
+    CHECK(idx < FUZZ_SLOTS && !reassembly->slots[idx].active);
+    break;
+  case FRAGMENT_RESULT_OVERLAP:
+  case FRAGMENT_RESULT_OUT_OF_ORDER:
+    CHECK(!fragment.head && idx < FUZZ_SLOTS && !reassembly->slots[idx].active);
+    break;
+  case FRAGMENT_RESULT_NONZERO_FIRST:
+  case FRAGMENT_RESULT_OVERSIZE:
+    CHECK(idx == FUZZ_SLOTS);
+    break;
+  }
+  // A head not adopted stays with the caller.
+  if (fragment.head && result != FRAGMENT_RESULT_STARTED && result != FRAGMENT_RESULT_COMPLETE) {
+    CHECK(s_buffer_busy[fragment.buffer]);
+    s_buffer_busy[fragment.buffer] = false;
+  }
+  check_slots(reassembly);
+  free(bytes);
+  return result;
+}
+
+// Splits a message into in-order fragments of random sizes.
+static size_t split(int msg_id, size_t total_len, planned_fragment_t *out, size_t max)
+{
+  size_t count = 0;
+  size_t offset = 0;
+  while (offset < total_len && count < max) {
+    size_t remaining = total_len - offset;
+    size_t len = 1 + rng_below((uint32_t)(remaining < 300 ? remaining : 300));
+    if (count == 0 && len == total_len) {
+      // The dataplane never hands a single-fragment message to reassembly.
+      len = total_len - 1;
+    }
+    out[count++] = (planned_fragment_t){msg_id, total_len, offset, len};
+    offset += len;
+  }
+  return count;
+}
+
+static size_t random_total(void)
+{
+  return 2 + rng_below(rng_below(4) == 0 ? FUZZ_CAPACITY - 1 : 200);
+}
+
+// Interleaves per-message fragment lists, keeping each list in order.
+static size_t interleave(planned_fragment_t lists[][40], const size_t *counts, size_t messages, planned_fragment_t *out)
+{
+  size_t next[FUZZ_MAX_MESSAGES] = {0};
+  size_t total = 0;
+  size_t left = 0;
+  for (size_t m = 0; m < messages; ++m) {
+    left += counts[m];
+  }
+  while (left > 0) {
+    size_t m = rng_below((uint32_t)messages);
+    while (next[m] >= counts[m]) {
+      m = (m + 1) % messages;
+    }
+    out[total++] = lists[m][next[m]++];
+    left--;
+  }
+  return total;
+}
+
+static void clean_round(fragment_reassembly_t *reassembly, int64_t *now_us, int *next_msg_id)
+{
+  static planned_fragment_t lists[FUZZ_MAX_MESSAGES][40];
+  static planned_fragment_t order[FUZZ_MAX_FRAGMENTS];
+  size_t counts[FUZZ_MAX_MESSAGES];
+  // Start from an empty table; leftovers of a chaotic round would be evicted.
+  fragment_reassembly_reset(reassembly);
+  s_message_count = 1 + rng_below(FUZZ_SLOTS);
+  for (size_t m = 0; m < s_message_count; ++m) {
+    s_messages[m] = (message_t){(*next_msg_id)++, random_total(), 0};
+    counts[m] = split(s_messages[m].msg_id, s_messages[m].total_len, lists[m], 40);
+  }
+  size_t n = interleave(lists, counts, s_message_count, order);
+  for (size_t i = 0; i < n; ++i) {
+    *now_us += rng_below(FUZZ_TIMEOUT_US / 100);
+    fragment_result_t result = push(reassembly, &order[i], *now_us);
+    if (result != FRAGMENT_RESULT_STARTED && result != FRAGMENT_RESULT_APPENDED &&
+        result != FRAGMENT_RESULT_COMPLETE) {
+      fprintf(stderr, "clean round: result %d for msg_id=%d offset=%zu\n", result, order[i].msg_id,
+              order[i].offset);
+      s_failures++;
+    }
+  }
+  for (size_t m = 0; m < s_message_count; ++m) {
+    if (s_messages[m].completions != 1) {
+      fprintf(stderr, "clean round: msg_id=%d completed %u times\n", s_messages[m].msg_id,
+              s_messages[m].completions);
+      s_failures++;
+    }
+  }
+  for (size_t i = 0; i < FUZZ_SLOTS; ++i) {
+    CHECK(!reassembly->slots[i].active);
+  }
+}
+
+static void chaotic_round(fragment_reassembly_t *reassembly, int64_t *now_us, int *next_msg_id)
+{
+  static planned_fragment_t lists[FUZZ_MAX_MESSAGES][40];
+  static planned_fragment_t order[FUZZ_MAX_FRAGMENTS];
+  size_t counts[FUZZ_MAX_MESSAGES];
+  s_message_count = 1 + rng_below(FUZZ_MAX_MESSAGES);
+  for (size_t m = 0; m < s_message_count; ++m) {
+    // A small msg_id space makes reuse, preemption and stale fragments common.
+    int msg_id = (rng_below(3) == 0) ? (int)rng_below(4) : (*next_msg_id)++;
+    size_t total = random_total();
+    s_messages[m] = (message_t){msg_id, total, 0};
+    counts[m] = split(msg_id, total, lists[m], 40);
+  }
+  size_t n = interleave(lists, counts, s_message_count, order);
+
+  for (size_t i = 0; i < n; ++i) {
+    planned_fragment_t plan = order[i];
+    switch (rng_below(24)) {
+    case 0:
+      continue; // lost
+    case 1:
+      if (i + 1 < n) {
+        order[i] = order[i + 1];
+        order[i + 1] = plan;
+        plan = order[i];
+      }
+      break;
+    case 2:
+      push(reassembly, &plan, *now_us); // duplicated
+      break;
+    case 3:
+      plan.total_len += 1 + rng_below(8); // total changes mid-flow
+      break;
+    case 4:
+      plan.len = FUZZ_CAPACITY + 1 - plan.offset + rng_below(4); // oversize
+      plan.total_len = plan.offset + plan.len;
+      break;
+    case 5:
+      *now_us += FUZZ_TIMEOUT_US + rng_below(FUZZ_TIMEOUT_US); // idle gap
+      break;
+    default:
+      break;
+    }
+    *now_us += rng_below(FUZZ_TIMEOUT_US / 50);
+    push(reassembly, &plan, *now_us);
+  }
+  if (rng_below(4) == 0) {
+    fragment_reassembly_reset(reassembly);
+    check_slots(reassembly);
+  }
+  for (size_t m = 0; m < s_message_count; ++m) {
+    // Reused msg_ids with the same total may legitimately complete twice.
+    CHECK(s_messages[m].completions <= s_message_count);
+  }
+}
+
+static void test_edges(fragment_reassembly_t *reassembly)
+{
+  int64_t now_us = 0;
+  // A continuation of nothing, a fragment running past its total, and one
+  // past the capacity.
+  CHECK(push(reassembly, &(planned_fragment_t){900, 10, 4, 3}, now_us) == FRAGMENT_RESULT_NONZERO_FIRST);
+  CHECK(push(reassembly, &(planned_fragment_t){901, 10, 8, 3}, now_us) == FRAGMENT_RESULT_OVERSIZE);
+  CHECK(push(reassembly, &(planned_fragment_t){902, FUZZ_CAPACITY + 1, 0, 5}, now_us) == FRAGMENT_RESULT_OVERSIZE);
+  CHECK(push(reassembly, &(planned_fragment_t){903, FUZZ_CAPACITY, 0, FUZZ_CAPACITY - 1}, now_us) ==
+        FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){903, FUZZ_CAPACITY, FUZZ_CAPACITY - 1, 1}, now_us) ==
+        FRAGMENT_RESULT_COMPLETE);
+
+  // Behind the fill point, then past it.
+  CHECK(push(reassembly, &(planned_fragment_t){904, 10, 0, 4}, now_us) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){904, 10, 2, 2}, now_us) == FRAGMENT_RESULT_OVERLAP);
+  CHECK(push(reassembly, &(planned_fragment_t){905, 10, 0, 4}, now_us) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){905, 10, 5, 2}, now_us) == FRAGMENT_RESULT_OUT_OF_ORDER);
+
+  // Preemption by the same msg_id, then LRU eviction of the oldest flow.
+  uint32_t preempted = s_ends[FRAGMENT_END_PREEMPTED];
+  CHECK(push(reassembly, &(planned_fragment_t){906, 10, 0, 4}, now_us) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){906, 12, 0, 4}, now_us + 1) == FRAGMENT_RESULT_STARTED);
+  CHECK(s_ends[FRAGMENT_END_PREEMPTED] == preempted + 1);
+  uint32_t evicted = s_ends[FRAGMENT_END_EVICTED];
+  CHECK(push(reassembly, &(planned_fragment_t){907, 10, 0, 4}, now_us + 2) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){908, 10, 0, 4}, now_us + 3) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){909, 10, 0, 4}, now_us + 4) == FRAGMENT_RESULT_STARTED);
+  CHECK(s_ends[FRAGMENT_END_EVICTED] == evicted + 1);
+  CHECK(push(reassembly, &(planned_fragment_t){906, 12, 4, 8}, now_us + 5) == FRAGMENT_RESULT_NONZERO_FIRST);
+
+  // Expiry happens on the next push after the timeout.
+  uint32_t expired = s_ends[FRAGMENT_END_EXPIRED];
+  CHECK(push(reassembly, &(planned_fragment_t){907, 10, 4, 2}, now_us + 4 + FUZZ_TIMEOUT_US) ==
+        FRAGMENT_RESULT_NONZERO_FIRST);
+  CHECK(s_ends[FRAGMENT_END_EXPIRED] == expired + 3);
+
+  // QoS 0 PUBLISHes all carry msg_id 0, so a second QoS 0 head preempts the
+  // first; a QoS 1 flow beside it is kept apart and completes.
+  now_us += 4 + FUZZ_TIMEOUT_US;
+  preempted = s_ends[FRAGMENT_END_PREEMPTED];
+  CHECK(push(reassembly, &(planned_fragment_t){0, 10, 0, 4}, now_us) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){910, 10, 0, 4}, now_us) == FRAGMENT_RESULT_STARTED);
+  CHECK(push(reassembly, &(planned_fragment_t){0, 10, 0, 4}, now_us + 1) == FRAGMENT_RESULT_STARTED);
+  CHECK(s_ends[FRAGMENT_END_PREEMPTED] == preempted + 1);
+  CHECK(push(reassembly, &(planned_fragment_t){910, 10, 4, 6}, now_us + 2) == FRAGMENT_RESULT_COMPLETE);
+  CHECK(push(reassembly, &(planned_fragment_t){0, 10, 4, 6}, now_us + 3) == FRAGMENT_RESULT_COMPLETE);
+
+  fragment_reassembly_reset(reassembly);
+  for (size_t i = 0; i < FUZZ_BUFFERS; ++i) {
+    CHECK(!s_buffer_busy[i]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t rounds = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : FUZZ_DEFAULT_ROUNDS;
+  s_rng = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+  if (s_rng == 0) {
+    s_rng = 1;
+  }
+
+  static fragment_slot_t slots[FUZZ_SLOTS];
+  fragment_reassembly_t reassembly;
+  s_slots = slots;
+  fragment_reassembly_init(&reassembly, slots, FUZZ_SLOTS, FUZZ_CAPACITY, FUZZ_TIMEOUT_US, on_end, NULL);
+  s_message_count = 0;
+  test_edges(&reassembly);
+
+  int64_t now_us = 0;
+  int next_msg_id = 1000;
+  for (uint32_t round = 0; round < rounds; ++round) {
+    if (rng_below(2) == 0) {
+      clean_round(&reassembly, &now_us, &next_msg_id);
+    } else {
+      chaotic_round(&reassembly, &now_us, &next_msg_id);
+    }
+  }
+  fragment_reassembly_reset(&reassembly);
+  for (size_t i = 0; i < FUZZ_BUFFERS; ++i) {
+    CHECK(!s_buffer_busy[i]);
+  }
+
+  printf("results started=%u appended=%u complete=%u nonzero_first=%u overlap=%u out_of_order=%u oversize=%u\n",
+         s_results[FRAGMENT_RESULT_STARTED], s_results[FRAGMENT_RESULT_APPENDED], s_results[FRAGMENT_RESULT_COMPLETE],
+         s_results[FRAGMENT_RESULT_NONZERO_FIRST], s_results[FRAGMENT_RESULT_OVERLAP],
+         s_results[FRAGMENT_RESULT_OUT_OF_ORDER], s_results[FRAGMENT_RESULT_OVERSIZE]);
+  printf("ends complete=%u dropped=%u preempted=%u evicted=%u expired=%u reset=%u\n", s_ends[FRAGMENT_END_COMPLETE],
+         s_ends[FRAGMENT_END_DROPPED], s_ends[FRAGMENT_END_PREEMPTED], s_ends[FRAGMENT_END_EVICTED],
+         s_ends[FRAGMENT_END_EXPIRED], s_ends[FRAGMENT_END_RESET]);
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS rounds=%u\n", rounds);
+  return 0;
+}
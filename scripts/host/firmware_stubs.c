@@ -0,0 +1,187 @@
+/*
+ * Stand-ins for the firmware modules the dataplane calls into (UI, LEDs,
+ * presence, radar, camera, MQTT manager and device identity), for host
+ * programs under scripts/ that link main/connectivity/mqtt_dataplane.c.
+ * Widget updates are counted and can be made to take a fixed time; everything
+ * else does nothing. See host_stubs_init() in host_shim.h.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "connectivity/device_identity.h"
+#include "connectivity/mqtt_manager.h"
+#include "host_shim.h"
+#include "sensors/radar_presence.h"
+#include "streaming/camera_snapshot_publisher.h"
+#include "thermostat/led_program_store.h"
+#include "thermostat/remote_setpoint_controller.h"
+#include "thermostat/thermostat_led_status.h"
+#include "thermostat/thermostat_personal_presence.h"
+#include "thermostat/ui_actions.h"
+#include "thermostat/ui_setpoint_view.h"
+#include "thermostat/ui_state.h"
+#include "thermostat/ui_top_bar.h"
+
+#define HOST_STUB_ROOT_LEN (256)
+
+// The dataplane's weather and room icons; it only compares their addresses.
+#define HOST_STUB_IMAGES(X)                                                                      \
+  X(breezy) X(clear_day) X(clear_night) X(cloudy) X(dangerous_wind) X(drizzle) X(flurries)      \
+  X(fog) X(haze) X(heavy_rain) X(heavy_sleet) X(heavy_snow) X(light_rain) X(light_sleet)        \
+  X(light_snow) X(mist) X(mostly_clear_day) X(mostly_clear_night) X(mostly_cloudy_day)          \
+  X(mostly_cloudy_night) X(partly_cloudy_day) X(partly_cloudy_night)                            \
+  X(possible_precipitation_day) X(possible_precipitation_night) X(possible_rain_day)            \
+  X(possible_rain_night) X(possible_sleet_day) X(possible_sleet_night) X(possible_snow_day)     \
+  X(possible_snow_night) X(possible_thunderstorm_day) X(possible_thunderstorm_night)            \
+  X(precipitation) X(rain) X(sleet) X(smoke) X(snow) X(thunderstorm) X(very_light_sleet)        \
+  X(wind) X(snowflake) X(room_living) X(room_bedroom) X(room_office) X(room_hallway)            \
+  X(room_default)
+
+#define HOST_STUB_DEFINE_IMAGE(name) const lv_img_dsc_t name = {1, 1};
+HOST_STUB_IMAGES(HOST_STUB_DEFINE_IMAGE)
+
+thermostat_view_model_t g_view_model;
+bool g_ui_initialized = true;
+
+static esp_mqtt_client_handle_t s_client;
+static char s_device_root[HOST_STUB_ROOT_LEN];
+static unsigned s_widget_us;
+static size_t s_widget_updates;
+
+static void busy_wait_us(unsigned us);
+
+void host_stubs_init(esp_mqtt_client_handle_t client, const char *device_root)
+{
+  s_client = client;
+  snprintf(s_device_root, sizeof(s_device_root), "%s", device_root);
+}
+
+void host_stubs_set_widget_us(unsigned us)
+{
+  s_widget_us = us;
+}
+
+size_t host_stubs_widget_updates(void)
+{
+  return s_widget_updates;
+}
+
+
+esp_mqtt_client_handle_t mqtt_manager_get_client(void)
+{
+  return s_client;
+}
+
+bool mqtt_manager_is_ready(void)
+{
+  return s_client != NULL;
+}
+
+const char *device_identity_get_theo_device_topic_root(void)
+{
+  return s_device_root;
+}
+
+void thermostat_update_weather_group(void)
+{
+  s_widget_updates++;
+  busy_wait_us(s_widget_us);
+}
+
+void thermostat_update_room_group(void)
+{
+  s_widget_updates++;
+  busy_wait_us(s_widget_us);
+}
+
+void thermostat_update_hvac_status_group(void)
+{
+  s_widget_updates++;
+  busy_wait_us(s_widget_us);
+}
+
+void thermostat_update_action_bar_visuals(void)
+{
+  s_widget_updates++;
+  busy_wait_us(s_widget_us);
+}
+
+void thermostat_update_setpoint_labels(void)
+{
+  s_widget_updates++;
+  busy_wait_us(s_widget_us);
+}
+
+void thermostat_remote_setpoint_controller_submit(thermostat_target_t target, float value_c)
+{
+  (void)target;
+  (void)value_c;
+}
+
+void thermostat_led_status_set_hvac(bool heating, bool cooling)
+{
+  (void)heating;
+  (void)cooling;
+}
+
+void thermostat_led_status_trigger_rainbow(void) {}
+void thermostat_led_status_trigger_heatwave(void) {}
+void thermostat_led_status_trigger_coolwave(void) {}
+void thermostat_led_status_trigger_sparkle(void) {}
+void thermostat_led_status_trigger_program(void) {}
+void thermostat_led_status_trigger_hearth(void) {}
+void thermostat_personal_presence_init(void) {}
+
+void thermostat_personal_presence_process_face(const char *payload, bool retained)
+{
+  (void)payload;
+  (void)retained;
+}
+
+void thermostat_personal_presence_process_person_count(const char *payload)
+{
+  (void)payload;
+}
+
+esp_err_t led_program_store_install(const uint8_t *data, size_t len, bool *out_changed, const char **out_reason)
+{
+  (void)data;
+  (void)len;
+  if (out_changed != NULL) {
+    *out_changed = false;
+  }
+  if (out_reason != NULL) {
+    *out_reason = NULL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t radar_presence_dump_thresholds(void)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t radar_presence_start_calibration(void)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t camera_snapshot_publisher_request_benchmark(void)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+
+static void busy_wait_us(unsigned us)
+{
+  if (us == 0) {
+    return;
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  const int64_t until = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec + (int64_t)us * 1000;
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+  } while ((int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec < until);
+}
@@ -0,0 +1,655 @@
+/*
+ * Host implementations of the FreeRTOS, esp_timer, esp_random, esp_log,
+ * heap_caps, LVGL lock, led_strip and esp-mqtt calls declared in
+ * scripts/host/include, so sources from main/ link and run unchanged on a
+ * development machine. See host_shim.h for
+ * the extra hooks programs use to drive them.
+ *
+ * Behaviour follows IDF where the dataplane depends on it: queues copy items
+ * and never block with a zero timeout, task notifications count, and
+ * ulTaskNotifyTake(pdTRUE, ...) consumes them all. Scheduling does not:
+ * tasks are preemptive pthreads with no priorities or core affinity.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_heap_caps.h"
+#include "esp_lv_adapter.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "host_shim.h"
+#include "led_strip.h"
+
+#define HOST_LOG_LINE_MAX (2048)
+#define HOST_MQTT_HANDLERS (4)
+
+struct host_queue {
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  uint8_t *items;
+  size_t item_size;
+  size_t length;
+  size_t head;
+  size_t count;
+};
+
+struct host_task {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t changed;
+  TaskFunction_t fn;
+  void *arg;
+  uint32_t notify_count;
+  bool waiting;
+};
+
+typedef struct {
+  esp_mqtt_event_id_t event;
+  esp_event_handler_t handler;
+  void *arg;
+} host_mqtt_handler_t;
+
+struct host_timer {
+  esp_timer_create_args_t args;
+  bool armed;
+};
+
+struct host_semaphore {
+  pthread_mutex_t mutex;
+};
+
+struct led_strip_t {
+  uint8_t *pixels;
+  uint32_t count;
+};
+
+struct esp_mqtt_client {
+  pthread_mutex_t mutex;
+  host_mqtt_handler_t handlers[HOST_MQTT_HANDLERS];
+  int next_msg_id;
+};
+
+static bool deadline_for(TickType_t ticks, struct timespec *deadline);
+static void *task_entry(void *arg);
+
+static pthread_mutex_t s_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static host_log_hook_t s_log_hook;
+static pthread_mutex_t s_lvgl_mutex = PTHREAD_MUTEX_INITIALIZER;
+static host_publish_hook_t s_publish_hook;
+static __thread struct host_task *s_current_task;
+static size_t s_queue_storage_bytes;
+static size_t s_queue_copied_bytes;
+static uint32_t s_random_state = 1;
+
+int64_t esp_timer_get_time(void)
+{
+  static int64_t origin_ns;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  const int64_t now_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  int64_t expected = 0;
+  __atomic_compare_exchange_n(&origin_ns, &expected, now_ns - 1000, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  return (now_ns - __atomic_load_n(&origin_ns, __ATOMIC_RELAXED)) / 1000;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+  struct host_timer *timer = calloc(1, sizeof(*timer));
+  if (timer == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  timer->args = *args;
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+  (void)period_us;
+  if (timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  if (!timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  free(timer);
+  return ESP_OK;
+}
+
+uint32_t esp_random(void)
+{
+  uint32_t x = __atomic_load_n(&s_random_state, __ATOMIC_RELAXED);
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  __atomic_store_n(&s_random_state, x, __ATOMIC_RELAXED);
+  return x;
+}
+
+void host_random_seed(uint32_t seed)
+{
+  __atomic_store_n(&s_random_state, seed != 0 ? seed : 1, __ATOMIC_RELAXED);
+}
+
+void esp_restart(void)
+{
+  fprintf(stderr, "esp_restart() called\n");
+  exit(3);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+  (void)caps;
+  void *ptr = NULL;
+  return posix_memalign(&ptr, alignment, size) == 0 ? ptr : NULL;
+}
+
+void heap_caps_free(void *ptr)
+{
+  free(ptr);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+  (void)tag;
+  s_log_level = level;
+}
+
+void host_log_set_hook(host_log_hook_t hook)
+{
+  s_log_hook = hook;
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+  static const char letters[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+  char line[HOST_LOG_LINE_MAX];
+  int len = snprintf(line, sizeof(line), "%c (%lld) %s: ", letters[level],
+                     (long long)(esp_timer_get_time() / 1000), tag);
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line + len, sizeof(line) - (size_t)len, format, args);
+  va_end(args);
+
+  pthread_mutex_lock(&s_log_mutex);
+  if (s_log_hook != NULL) {
+    s_log_hook(level, tag, line);
+  }
+  if (level <= s_log_level) {
+    fprintf(stderr, "%s\n", line);
+  }
+  pthread_mutex_unlock(&s_log_mutex);
+}
+
+esp_err_t esp_lv_adapter_lock(int32_t timeout_ms)
+{
+  (void)timeout_ms;
+  pthread_mutex_lock(&s_lvgl_mutex);
+  return ESP_OK;
+}
+
+void esp_lv_adapter_unlock(void)
+{
+  pthread_mutex_unlock(&s_lvgl_mutex);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+  struct host_queue *queue = calloc(1, sizeof(*queue));
+  if (queue == NULL) {
+    return NULL;
+  }
+  queue->items = calloc(length, item_size);
+  if (queue->items == NULL) {
+    free(queue);
+    return NULL;
+  }
+  queue->item_size = item_size;
+  queue->length = length;
+  __atomic_add_fetch(&s_queue_storage_bytes, (size_t)length * item_size, __ATOMIC_RELAXED);
+  pthread_mutex_init(&queue->mutex, NULL);
+  pthread_cond_init(&queue->changed, NULL);
+  return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+  struct host_semaphore *semaphore = calloc(1, sizeof(*semaphore));
+  if (semaphore != NULL) {
+    pthread_mutex_init(&semaphore->mutex, NULL);
+  }
+  return semaphore;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+  pthread_mutex_destroy(&semaphore->mutex);
+  free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+  if (ticks_to_wait == portMAX_DELAY) {
+    pthread_mutex_lock(&semaphore->mutex);
+    return pdTRUE;
+  }
+  struct timespec deadline;
+  if (!deadline_for(ticks_to_wait, &deadline)) {
+    return pthread_mutex_trylock(&semaphore->mutex) == 0 ? pdTRUE : pdFALSE;
+  }
+  return pthread_mutex_timedlock(&semaphore->mutex, &deadline) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  pthread_mutex_unlock(&semaphore->mutex);
+  return pdTRUE;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+  if (queue == NULL) {
+    return;
+  }
+  __atomic_sub_fetch(&s_queue_storage_bytes, queue->length * queue->item_size, __ATOMIC_RELAXED);
+  pthread_cond_destroy(&queue->changed);
+  pthread_mutex_destroy(&queue->mutex);
+  free(queue->items);
+  free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+  struct timespec deadline;
+  const bool bounded = deadline_for(ticks_to_wait, &deadline);
+  pthread_mutex_lock(&queue->mutex);
+  while (queue->count == queue->length) {
+    if (ticks_to_wait == 0 ||
+        (bounded && pthread_cond_timedwait(&queue->changed, &queue->mutex, &deadline) == ETIMEDOUT)) {
+      pthread_mutex_unlock(&queue->mutex);
+      return pdFALSE;
+    }
+    if (!bounded) {
+      pthread_cond_wait(&queue->changed, &queue->mutex);
+    }
+  }
+  const size_t tail = (queue->head + queue->count) % queue->length;
+  memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+  __atomic_add_fetch(&s_queue_copied_bytes, queue->item_size, __ATOMIC_RELAXED);
+  queue->count++;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->mutex);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait)
+{
+  struct timespec deadline;
+  const bool bounded = deadline_for(ticks_to_wait, &deadline);
+  pthread_mutex_lock(&queue->mutex);
+  while (queue->count == 0) {
+    if (ticks_to_wait == 0 ||
+        (bounded && pthread_cond_timedwait(&queue->changed, &queue->mutex, &deadline) == ETIMEDOUT)) {
+      pthread_mutex_unlock(&queue->mutex);
+      return pdFALSE;
+    }
+    if (!bounded) {
+      pthread_cond_wait(&queue->changed, &queue->mutex);
+    }
+  }
+  memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+  __atomic_add_fetch(&s_queue_copied_bytes, queue->item_size, __ATOMIC_RELAXED);
+  queue->head = (queue->head + 1) % queue->length;
+  queue->count--;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->mutex);
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  pthread_mutex_lock(&queue->mutex);
+  const UBaseType_t count = (UBaseType_t)queue->count;
+  pthread_mutex_unlock(&queue->mutex);
+  return count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  pthread_mutex_lock(&queue->mutex);
+  queue->head = 0;
+  queue->count = 0;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->mutex);
+  return pdPASS;
+}
+
+void host_queue_get_stats(host_queue_stats_t *out)
+{
+  out->storage_bytes = __atomic_load_n(&s_queue_storage_bytes, __ATOMIC_RELAXED);
+  out->copied_bytes = __atomic_load_n(&s_queue_copied_bytes, __ATOMIC_RELAXED);
+}
+
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t fn,
+                                           const char *name,
+                                           uint32_t stack_depth,
+                                           void *arg,
+                                           UBaseType_t priority,
+                                           TaskHandle_t *out_handle,
+                                           BaseType_t core_id,
+                                           uint32_t caps)
+{
+  (void)name;
+  (void)stack_depth;
+  (void)priority;
+  (void)core_id;
+  (void)caps;
+  struct host_task *task = calloc(1, sizeof(*task));
+  if (task == NULL) {
+    return pdFAIL;
+  }
+  task->fn = fn;
+  task->arg = arg;
+  pthread_mutex_init(&task->mutex, NULL);
+  pthread_cond_init(&task->changed, NULL);
+  // Publish the handle before the task runs, as FreeRTOS does for a task
+  // created at a lower priority than its creator.
+  if (out_handle != NULL) {
+    *out_handle = task;
+  }
+  if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+    if (out_handle != NULL) {
+      *out_handle = NULL;
+    }
+    free(task);
+    return pdFAIL;
+  }
+  pthread_detach(task->thread);
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  struct host_task *self = s_current_task;
+  if (task != NULL && task != self) {
+    fprintf(stderr, "vTaskDelete: only self-deletion is supported\n");
+    abort();
+  }
+  if (self != NULL) {
+    s_current_task = NULL;
+    pthread_mutex_destroy(&self->mutex);
+    pthread_cond_destroy(&self->changed);
+    free(self);
+  }
+  pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  const struct timespec ts = {
+      .tv_sec = ticks / 1000,
+      .tv_nsec = (long)(ticks % 1000) * 1000000L,
+  };
+  nanosleep(&ts, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+  struct host_task *task = s_current_task;
+  if (task == NULL) {
+    return 0;
+  }
+  struct timespec deadline;
+  const bool bounded = deadline_for(ticks_to_wait, &deadline);
+  pthread_mutex_lock(&task->mutex);
+  task->waiting = true;
+  pthread_cond_broadcast(&task->changed);
+  while (task->notify_count == 0 && ticks_to_wait != 0) {
+    if (bounded) {
+      if (pthread_cond_timedwait(&task->changed, &task->mutex, &deadline) == ETIMEDOUT) {
+        break;
+      }
+    } else {
+      pthread_cond_wait(&task->changed, &task->mutex);
+    }
+  }
+  const uint32_t count = task->notify_count;
+  if (count > 0) {
+    task->notify_count = clear_on_exit ? 0 : count - 1;
+  }
+  task->waiting = false;
+  pthread_mutex_unlock(&task->mutex);
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  pthread_mutex_lock(&task->mutex);
+  task->notify_count++;
+  pthread_cond_broadcast(&task->changed);
+  pthread_mutex_unlock(&task->mutex);
+  return pdPASS;
+}
+
+void host_task_wait_idle(TaskHandle_t task)
+{
+  pthread_mutex_lock(&task->mutex);
+  while (!task->waiting || task->notify_count != 0) {
+    pthread_cond_wait(&task->changed, &task->mutex);
+  }
+  pthread_mutex_unlock(&task->mutex);
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config,
+                                   const led_strip_rmt_config_t *rmt_config,
+                                   led_strip_handle_t *ret_strip)
+{
+  (void)rmt_config;
+  struct led_strip_t *strip = calloc(1, sizeof(*strip));
+  if (strip == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  strip->pixels = calloc(led_config->max_leds, 3);
+  if (strip->pixels == NULL) {
+    free(strip);
+    return ESP_ERR_NO_MEM;
+  }
+  strip->count = led_config->max_leds;
+  *ret_strip = strip;
+  return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+  if (index >= strip->count) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  strip->pixels[index * 3] = (uint8_t)red;
+  strip->pixels[index * 3 + 1] = (uint8_t)green;
+  strip->pixels[index * 3 + 2] = (uint8_t)blue;
+  return ESP_OK;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+  (void)strip;
+  return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+  memset(strip->pixels, 0, (size_t)strip->count * 3);
+  return ESP_OK;
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+  free(strip->pixels);
+  free(strip);
+  return ESP_OK;
+}
+
+esp_mqtt_client_handle_t host_mqtt_client_create(void)
+{
+  struct esp_mqtt_client *client = calloc(1, sizeof(*client));
+  if (client != NULL) {
+    pthread_mutex_init(&client->mutex, NULL);
+  }
+  return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+                                         esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler,
+                                         void *event_handler_arg)
+{
+  if (client == NULL || event_handler == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pthread_mutex_lock(&client->mutex);
+  for (size_t i = 0; i < HOST_MQTT_HANDLERS; ++i) {
+    if (client->handlers[i].handler == NULL) {
+      client->handlers[i] = (host_mqtt_handler_t){event, event_handler, event_handler_arg};
+      pthread_mutex_unlock(&client->mutex);
+      return ESP_OK;
+    }
+  }
+  pthread_mutex_unlock(&client->mutex);
+  return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_mqtt_client_unregister_event(esp_mqtt_client_handle_t client,
+                                           esp_mqtt_event_id_t event,
+                                           esp_event_handler_t event_handler)
+{
+  if (client == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pthread_mutex_lock(&client->mutex);
+  for (size_t i = 0; i < HOST_MQTT_HANDLERS; ++i) {
+    if (client->handlers[i].event == event && client->handlers[i].handler == event_handler) {
+      client->handlers[i] = (host_mqtt_handler_t){0};
+    }
+  }
+  pthread_mutex_unlock(&client->mutex);
+  return ESP_OK;
+}
+
+bool host_mqtt_client_deliver(esp_mqtt_client_handle_t client, esp_mqtt_event_t *event)
+{
+  bool delivered = false;
+  event->client = client;
+  for (size_t i = 0; i < HOST_MQTT_HANDLERS; ++i) {
+    const host_mqtt_handler_t entry = client->handlers[i];
+    if (entry.handler != NULL && (entry.event == MQTT_EVENT_ANY || entry.event == event->event_id)) {
+      entry.handler(entry.arg, "MQTT_EVENTS", event->event_id, event);
+      delivered = true;
+    }
+  }
+  return delivered;
+}
+
+void host_mqtt_set_publish_hook(host_publish_hook_t hook)
+{
+  s_publish_hook = hook;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+  (void)topic;
+  (void)qos;
+  pthread_mutex_lock(&client->mutex);
+  const int msg_id = ++client->next_msg_id;
+  pthread_mutex_unlock(&client->mutex);
+  return msg_id;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client,
+                            const char *topic,
+                            const char *data,
+                            int len,
+                            int qos,
+                            int retain)
+{
+  (void)retain;
+  if (len <= 0 && data != NULL) {
+    len = (int)strlen(data);
+  }
+  if (s_publish_hook != NULL) {
+    s_publish_hook(topic, data, (size_t)len, qos, false);
+  }
+  pthread_mutex_lock(&client->mutex);
+  const int msg_id = (qos > 0) ? ++client->next_msg_id : 0;
+  pthread_mutex_unlock(&client->mutex);
+  return msg_id;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client,
+                            const char *topic,
+                            const char *data,
+                            int len,
+                            int qos,
+                            int retain,
+                            bool store)
+{
+  (void)retain;
+  (void)store;
+  if (len <= 0 && data != NULL) {
+    len = (int)strlen(data);
+  }
+  if (s_publish_hook != NULL) {
+    s_publish_hook(topic, data, (size_t)len, qos, true);
+  }
+  pthread_mutex_lock(&client->mutex);
+  const int msg_id = (qos > 0) ? ++client->next_msg_id : 0;
+  pthread_mutex_unlock(&client->mutex);
+  return msg_id;
+}
+
+static bool deadline_for(TickType_t ticks, struct timespec *deadline)
+{
+  if (ticks == 0 || ticks == portMAX_DELAY) {
+    return false;
+  }
+  clock_gettime(CLOCK_REALTIME, deadline);
+  deadline->tv_sec += ticks / 1000;
+  deadline->tv_nsec += (long)(ticks % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+  return true;
+}
+
+static void *task_entry(void *arg)
+{
+  struct host_task *task = arg;
+  s_current_task = task;
+  task->fn(task->arg);
+  return NULL;
+}
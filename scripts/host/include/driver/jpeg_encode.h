@@ -0,0 +1,64 @@
+/*
+ * Host shim for the esp_driver_jpeg encoder API the snapshot publisher uses.
+ * scripts/host/jpeg_encode_soft.c implements it with a software baseline
+ * encoder (standard tables, float AAN DCT), so encode times are a CPU
+ * baseline rather than the P4's hardware engine.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct jpeg_encoder_t *jpeg_encoder_handle_t;
+
+typedef enum {
+  JPEG_ENCODE_IN_FORMAT_RGB888 = 0,
+  JPEG_ENCODE_IN_FORMAT_RGB565,
+  JPEG_ENCODE_IN_FORMAT_GRAY,
+} jpeg_enc_input_format_t;
+
+typedef enum {
+  JPEG_DOWN_SAMPLING_YUV444 = 0,
+  JPEG_DOWN_SAMPLING_YUV422,
+  JPEG_DOWN_SAMPLING_YUV420,
+  JPEG_DOWN_SAMPLING_GRAY,
+} jpeg_down_sampling_type_t;
+
+typedef enum {
+  JPEG_ENC_ALLOC_INPUT_BUFFER = 0,
+  JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+} jpeg_enc_buffer_alloc_direction_t;
+
+typedef struct {
+  int intr_priority;
+  int timeout_ms;
+} jpeg_encode_engine_cfg_t;
+
+typedef struct {
+  uint32_t height;
+  uint32_t width;
+  jpeg_enc_input_format_t src_type;
+  jpeg_down_sampling_type_t sub_sample;
+  uint32_t image_quality; // 1-100
+} jpeg_encode_cfg_t;
+
+typedef struct {
+  jpeg_enc_buffer_alloc_direction_t buffer_direction;
+} jpeg_encode_memory_alloc_cfg_t;
+
+esp_err_t jpeg_new_encoder_engine(const jpeg_encode_engine_cfg_t *enc_eng_cfg, jpeg_encoder_handle_t *ret_encoder);
+esp_err_t jpeg_del_encoder_engine(jpeg_encoder_handle_t encoder_engine);
+
+// RGB565 input is little-endian, as the camera and the synthetic source
+// write it. Returns ESP_ERR_INVALID_SIZE when the output does not fit.
+esp_err_t jpeg_encoder_process(jpeg_encoder_handle_t encoder_engine,
+                               const jpeg_encode_cfg_t *encode_cfg,
+                               const uint8_t *encode_inbuf,
+                               uint32_t inbuf_size,
+                               uint8_t *encode_outbuf,
+                               uint32_t outbuf_size,
+                               uint32_t *out_size);
+
+void *jpeg_alloc_encoder_mem(size_t size, const jpeg_encode_memory_alloc_cfg_t *mem_cfg, size_t *allocated_size);
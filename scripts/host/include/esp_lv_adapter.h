@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "lvgl.h"
+
+// One process-wide mutex stands in for the LVGL lock; the timeout is ignored.
+esp_err_t esp_lv_adapter_lock(int32_t timeout_ms);
+void esp_lv_adapter_unlock(void);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// A seeded xorshift generator, so host runs repeat; see host_random_seed().
+uint32_t esp_random(void);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct host_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// Microseconds of CLOCK_MONOTONIC since the first call.
+int64_t esp_timer_get_time(void);
+
+// Timers keep their armed state but never fire on the host; programs call
+// the callback themselves. Starting an armed timer returns
+// ESP_ERR_INVALID_STATE, as on IDF.
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
@@ -0,0 +1,36 @@
+/*
+ * Host shim for FreeRTOS, for the programs under scripts/ that run dataplane
+ * code on a development machine. Tasks are pthreads, ticks are milliseconds
+ * and critical sections are plain mutexes; only what main/ calls is here.
+ */
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY      ((TickType_t)0xffffffffu)
+#define configTICK_RATE_HZ (1000)
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define tskNO_AFFINITY     (0x7fffffff)
+
+typedef struct {
+  pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {PTHREAD_MUTEX_INITIALIZER}
+#define portENTER_CRITICAL(mux)      pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux)       pthread_mutex_unlock(&(mux)->mutex)
+#define taskENTER_CRITICAL(mux)      portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux)       portEXIT_CRITICAL(mux)
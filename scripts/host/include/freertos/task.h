@@ -0,0 +1,23 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+// Stack size, priority, core and caps are ignored; every task gets a default
+// pthread stack.
+BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t fn,
+                                           const char *name,
+                                           uint32_t stack_depth,
+                                           void *arg,
+                                           UBaseType_t priority,
+                                           TaskHandle_t *out_handle,
+                                           BaseType_t core_id,
+                                           uint32_t caps);
+// Only a task deleting itself (NULL) is supported.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
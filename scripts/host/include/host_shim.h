@@ -0,0 +1,77 @@
+/*
+ * Host-only hooks into the IDF shims in scripts/host/idf_shim.c and the
+ * firmware stubs in scripts/host/firmware_stubs.c, for the programs under
+ * scripts/ that drive dataplane code on a development machine.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  size_t storage_bytes; // item storage of all live queues
+  size_t copied_bytes;  // item bytes copied in and out since start
+} host_queue_stats_t;
+
+typedef void (*host_log_hook_t)(esp_log_level_t level, const char *tag, const char *line);
+typedef void (*host_publish_hook_t)(const char *topic, const char *data, size_t len, int qos, bool enqueued);
+
+/**
+ * @brief Receives every formatted log line, whatever the print level.
+ */
+void host_log_set_hook(host_log_hook_t hook);
+
+/**
+ * @brief Makes a client for the code under test to register its handler on.
+ */
+esp_mqtt_client_handle_t host_mqtt_client_create(void);
+
+/**
+ * @brief Calls the handler registered for the event's id, on the calling
+ *        thread, as the esp-mqtt task would.
+ *
+ * @return false when no handler is registered.
+ */
+bool host_mqtt_client_deliver(esp_mqtt_client_handle_t client, esp_mqtt_event_t *event);
+
+void host_mqtt_set_publish_hook(host_publish_hook_t hook);
+
+/**
+ * @brief Waits until the task is blocked in ulTaskNotifyTake() with no
+ *        notification pending, i.e. has finished all the work it was given.
+ */
+void host_task_wait_idle(TaskHandle_t task);
+
+void host_queue_get_stats(host_queue_stats_t *out);
+
+/**
+ * @brief Restarts the esp_random() sequence; the same seed gives the same
+ *        numbers. The sequence starts seeded with 1.
+ */
+void host_random_seed(uint32_t seed);
+
+/**
+ * @brief Sets what mqtt_manager_get_client() and
+ *        device_identity_get_theo_device_topic_root() return.
+ */
+void host_stubs_init(esp_mqtt_client_handle_t client, const char *device_root);
+
+/**
+ * @brief Makes every thermostat_update_*() call spin for the given time,
+ *        standing in for LVGL rendering.
+ */
+void host_stubs_set_widget_us(unsigned us);
+size_t host_stubs_widget_updates(void);
+
+#ifdef __cplusplus
+}
+#endif
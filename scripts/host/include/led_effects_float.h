@@ -0,0 +1,56 @@
+/*
+ * The pulse, wave, sparkle and greeting renderers as the float LED engine
+ * ran them before main/thermostat/thermostat_leds.c moved to tables and
+ * fixed point, kept in scripts/host/led_effects_float.c as the reference the
+ * host LED programs compare against. Each render call is one 10 ms tick and
+ * writes the output levels at full brightness, before quiet-hours dimming.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "thermostat/thermostat_leds.h"
+
+#define LED_FLOAT_PIXELS (39)
+
+typedef struct {
+  thermostat_led_color_t color;
+  float hz;
+  int64_t start_time_us;
+} led_float_pulse_t;
+
+typedef struct {
+  thermostat_led_color_t base_color;
+  float wave_positions[2];
+  bool rising;
+} led_float_wave_t;
+
+typedef struct {
+  thermostat_led_color_t pixels[LED_FLOAT_PIXELS];
+  uint8_t tick_accumulator;
+  bool stop_requested;
+} led_float_sparkle_t;
+
+typedef struct {
+  thermostat_led_color_t pixels[LED_FLOAT_PIXELS];
+  float head_index;
+  float step;
+  int direction;
+  uint8_t loops_remaining;
+} led_float_greeting_t;
+
+// Returns the brightness the float engine latched for a later fade.
+float led_float_pulse_render(const led_float_pulse_t *pulse, int64_t now, thermostat_led_color_t *out);
+
+void led_float_wave_start(led_float_wave_t *wave, thermostat_led_color_t color, bool rising);
+void led_float_wave_render(led_float_wave_t *wave, thermostat_led_color_t *out);
+
+// Draws from esp_random(). Returns false on the ticks between sparkle
+// frames, when nothing is written.
+bool led_float_sparkle_render(led_float_sparkle_t *sparkle, thermostat_led_color_t *out);
+bool led_float_sparkle_is_dark(const led_float_sparkle_t *sparkle);
+
+void led_float_greeting_start(led_float_greeting_t *greeting);
+// Returns false once the last pass has finished.
+bool led_float_greeting_render(led_float_greeting_t *greeting, thermostat_led_color_t *out);
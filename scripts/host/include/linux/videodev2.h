@@ -0,0 +1,13 @@
+/*
+ * Host shim for the V4L2 pixel format codes the camera sources use, so they
+ * build on hosts without Linux UAPI headers.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define v4l2_fourcc(a, b, c, d) \
+  ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define V4L2_PIX_FMT_RGB565 v4l2_fourcc('R', 'G', 'B', 'P')
+#define V4L2_PIX_FMT_RGB24  v4l2_fourcc('R', 'G', 'B', '3')
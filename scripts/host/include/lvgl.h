@@ -0,0 +1,30 @@
+/*
+ * Host shim for the few LVGL types the dataplane and UI headers name. The
+ * dataplane only passes image descriptors around by address.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _lv_obj_t lv_obj_t;
+typedef struct _lv_event_t lv_event_t;
+
+typedef struct {
+  uint32_t w;
+  uint32_t h;
+} lv_img_dsc_t;
+
+typedef struct {
+  int32_t line_height;
+} lv_font_t;
+
+typedef struct {
+  int32_t x1;
+  int32_t y1;
+  int32_t x2;
+  int32_t y2;
+} lv_area_t;
+
+#define LV_IMG_DECLARE(name) extern const lv_img_dsc_t name
+#define LV_OPA_COVER         (255)
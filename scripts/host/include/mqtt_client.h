@@ -0,0 +1,70 @@
+/*
+ * Host shim for the esp-mqtt client API the dataplane uses. There is no
+ * network: host_mqtt_client_create() (host_shim.h) makes a client whose
+ * registered handler the program drives with host_mqtt_client_deliver(), and
+ * publishes go to a hook.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+  MQTT_EVENT_ANY = -1,
+  MQTT_EVENT_ERROR = 0,
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_DISCONNECTED,
+  MQTT_EVENT_SUBSCRIBED,
+  MQTT_EVENT_UNSUBSCRIBED,
+  MQTT_EVENT_PUBLISHED,
+  MQTT_EVENT_DATA,
+  MQTT_EVENT_BEFORE_CONNECT,
+  MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+  esp_mqtt_event_id_t event_id;
+  esp_mqtt_client_handle_t client;
+  char *data;
+  int data_len;
+  int total_data_len;
+  int current_data_offset;
+  char *topic;
+  int topic_len;
+  int msg_id;
+  int session_present;
+  bool retain;
+  int qos;
+  bool dup;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+                                         esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler,
+                                         void *event_handler_arg);
+esp_err_t esp_mqtt_client_unregister_event(esp_mqtt_client_handle_t client,
+                                           esp_mqtt_event_id_t event,
+                                           esp_event_handler_t event_handler);
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos);
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client,
+                            const char *topic,
+                            const char *data,
+                            int len,
+                            int qos,
+                            int retain);
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client,
+                            const char *topic,
+                            const char *data,
+                            int len,
+                            int qos,
+                            int retain,
+                            bool store);
@@ -0,0 +1,13 @@
+/*
+ * Host shim for sdkconfig.h. Values follow sdkconfig.defaults for the options
+ * the host-compiled dataplane sources read.
+ */
+#pragma once
+
+#define CONFIG_THEO_HA_BASE_TOPIC               "homeassistant"
+#define CONFIG_THEO_RAM_WAVE2_MQTT_QUEUE_TUNING 1
+#define CONFIG_THEO_RAM_WAVE3_STACK_RIGHTSIZE   1
+#define CONFIG_THEO_LED_PROGRAM_MAX_COST        96
+#define CONFIG_THEO_CAMERA_HTTP_MAX_STREAMS     2
+#define CONFIG_THEO_LED_ENABLE                  1
+#define CONFIG_THEO_LED_STRIP_GPIO              49
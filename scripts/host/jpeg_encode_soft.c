@@ -0,0 +1,518 @@
+/*
+ * Software stand-in for the esp_driver_jpeg encoder (driver/jpeg_encode.h),
+ * so host programs can run the snapshot encode step for real. It writes
+ * baseline JFIF: the ITU-T T.81 Annex K quantisation tables scaled by
+ * quality the way libjpeg does, the Annex K Huffman tables, a float AAN DCT
+ * and 4:4:4, 4:2:2, 4:2:0 or grey sampling. Partial MCUs repeat the edge
+ * pixels.
+ *
+ * The output decodes with any JPEG decoder and its size tracks quality and
+ * content like the hardware's, but the bytes differ. Encode times are a
+ * single-core CPU baseline, not the P4's engine.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/jpeg_encode.h"
+#include "esp_heap_caps.h"
+
+#define JPEG_SOFT_BUFFER_ALIGN (64)
+
+enum {
+  TABLE_LUMA = 0,
+  TABLE_CHROMA,
+  TABLE_COUNT,
+};
+
+typedef struct {
+  uint16_t code[256];
+  uint8_t size[256];
+} huffman_table_t;
+
+struct jpeg_encoder_t {
+  uint32_t quality; // the tables below are for this quality; 0 = none yet
+  uint8_t dqt[TABLE_COUNT][64]; // zigzag order, as written to the stream
+  float divisors[TABLE_COUNT][64];
+  huffman_table_t dc[TABLE_COUNT];
+  huffman_table_t ac[TABLE_COUNT];
+};
+
+typedef struct {
+  uint8_t *out;
+  size_t cap;
+  size_t len;
+  uint32_t bits;
+  int count;
+  bool overflow;
+} bit_writer_t;
+
+typedef struct {
+  const uint8_t *in;
+  uint32_t width;
+  uint32_t height;
+  jpeg_enc_input_format_t format;
+} image_t;
+
+// Zigzag index -> natural (row-major) position.
+static const uint8_t s_zigzag[64] = {
+  0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+  41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+  30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Annex K.1, natural order.
+static const uint8_t s_base_quant[TABLE_COUNT][64] = {
+  {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+  },
+  {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+  },
+};
+
+// Annex K.3: code counts per length 1-16, then the symbols.
+static const uint8_t s_dc_bits[TABLE_COUNT][16] = {
+  {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+  {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0},
+};
+static const uint8_t s_dc_vals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t s_ac_bits[TABLE_COUNT][16] = {
+  {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d},
+  {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77},
+};
+static const uint8_t s_ac_vals[TABLE_COUNT][162] = {
+  {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+  },
+  {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+  },
+};
+
+static void build_huffman(const uint8_t *bits, const uint8_t *vals, huffman_table_t *out);
+static void build_quant(struct jpeg_encoder_t *enc, uint32_t quality);
+static void write_headers(bit_writer_t *w, const struct jpeg_encoder_t *enc, const jpeg_encode_cfg_t *cfg, int h_samp,
+                          int v_samp, int components);
+static void load_mcu(const image_t *img, uint32_t x0, uint32_t y0, int mcu_w, int mcu_h, bool color, float y[16][16],
+                     float cb[16][16], float cr[16][16]);
+static void encode_block(bit_writer_t *w, float block[64], const float *divisors, int *prev_dc,
+                         const huffman_table_t *dc, const huffman_table_t *ac);
+static void put_byte(bit_writer_t *w, uint8_t b);
+static void put_u16(bit_writer_t *w, uint16_t v);
+static void put_bits(bit_writer_t *w, uint32_t code, int size);
+
+esp_err_t jpeg_new_encoder_engine(const jpeg_encode_engine_cfg_t *enc_eng_cfg, jpeg_encoder_handle_t *ret_encoder)
+{
+  if (enc_eng_cfg == NULL || ret_encoder == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  struct jpeg_encoder_t *enc = calloc(1, sizeof(*enc));
+  if (enc == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  for (int t = 0; t < TABLE_COUNT; ++t) {
+    build_huffman(s_dc_bits[t], s_dc_vals, &enc->dc[t]);
+    build_huffman(s_ac_bits[t], s_ac_vals[t], &enc->ac[t]);
+  }
+  *ret_encoder = enc;
+  return ESP_OK;
+}
+
+esp_err_t jpeg_del_encoder_engine(jpeg_encoder_handle_t encoder_engine)
+{
+  free(encoder_engine);
+  return ESP_OK;
+}
+
+void *jpeg_alloc_encoder_mem(size_t size, const jpeg_encode_memory_alloc_cfg_t *mem_cfg, size_t *allocated_size)
+{
+  (void)mem_cfg;
+  const size_t rounded = (size + JPEG_SOFT_BUFFER_ALIGN - 1U) & ~(size_t)(JPEG_SOFT_BUFFER_ALIGN - 1U);
+  void *buf = heap_caps_aligned_alloc(JPEG_SOFT_BUFFER_ALIGN, rounded, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (allocated_size != NULL) {
+    *allocated_size = buf != NULL ? rounded : 0U;
+  }
+  return buf;
+}
+
+esp_err_t jpeg_encoder_process(jpeg_encoder_handle_t encoder_engine,
+                               const jpeg_encode_cfg_t *encode_cfg,
+                               const uint8_t *encode_inbuf,
+                               uint32_t inbuf_size,
+                               uint8_t *encode_outbuf,
+                               uint32_t outbuf_size,
+                               uint32_t *out_size)
+{
+  if (encoder_engine == NULL || encode_cfg == NULL || encode_inbuf == NULL || encode_outbuf == NULL ||
+      out_size == NULL || encode_cfg->width == 0 || encode_cfg->height == 0 || encode_cfg->width > UINT16_MAX ||
+      encode_cfg->height > UINT16_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const size_t bpp = encode_cfg->src_type == JPEG_ENCODE_IN_FORMAT_RGB888   ? 3U
+                     : encode_cfg->src_type == JPEG_ENCODE_IN_FORMAT_RGB565 ? 2U
+                                                                            : 1U;
+  if ((size_t)encode_cfg->width * encode_cfg->height * bpp > inbuf_size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  struct jpeg_encoder_t *enc = encoder_engine;
+  const uint32_t quality = encode_cfg->image_quality < 1U     ? 1U
+                           : encode_cfg->image_quality > 100U ? 100U
+                                                              : encode_cfg->image_quality;
+  if (enc->quality != quality) {
+    build_quant(enc, quality);
+  }
+
+  const bool color =
+      encode_cfg->src_type != JPEG_ENCODE_IN_FORMAT_GRAY && encode_cfg->sub_sample != JPEG_DOWN_SAMPLING_GRAY;
+  const int h_samp = color && encode_cfg->sub_sample != JPEG_DOWN_SAMPLING_YUV444 ? 2 : 1;
+  const int v_samp = color && encode_cfg->sub_sample == JPEG_DOWN_SAMPLING_YUV420 ? 2 : 1;
+  const int mcu_w = 8 * h_samp;
+  const int mcu_h = 8 * v_samp;
+
+  bit_writer_t w = {.out = encode_outbuf, .cap = outbuf_size};
+  write_headers(&w, enc, encode_cfg, h_samp, v_samp, color ? 3 : 1);
+
+  const image_t img = {
+    .in = encode_inbuf,
+    .width = encode_cfg->width,
+    .height = encode_cfg->height,
+    .format = encode_cfg->src_type,
+  };
+  int prev_dc[3] = {0};
+  float y[16][16];
+  float cb[16][16];
+  float cr[16][16];
+  float block[64];
+  for (uint32_t y0 = 0; y0 < img.height && !w.overflow; y0 += (uint32_t)mcu_h) {
+    for (uint32_t x0 = 0; x0 < img.width && !w.overflow; x0 += (uint32_t)mcu_w) {
+      load_mcu(&img, x0, y0, mcu_w, mcu_h, color, y, cb, cr);
+      for (int by = 0; by < v_samp; ++by) {
+        for (int bx = 0; bx < h_samp; ++bx) {
+          for (int i = 0; i < 64; ++i) {
+            block[i] = y[by * 8 + i / 8][bx * 8 + i % 8];
+          }
+          encode_block(&w, block, enc->divisors[TABLE_LUMA], &prev_dc[0], &enc->dc[TABLE_LUMA],
+                       &enc->ac[TABLE_LUMA]);
+        }
+      }
+      if (!color) {
+        continue;
+      }
+      // Chroma is averaged over each h_samp x v_samp group.
+      const float scale = 1.0f / (float)(h_samp * v_samp);
+      float(*planes[2])[16] = {cb, cr};
+      for (int c = 0; c < 2; ++c) {
+        for (int i = 0; i < 64; ++i) {
+          const int r = (i / 8) * v_samp;
+          const int col = (i % 8) * h_samp;
+          float sum = 0.0f;
+          for (int dy = 0; dy < v_samp; ++dy) {
+            for (int dx = 0; dx < h_samp; ++dx) {
+              sum += planes[c][r + dy][col + dx];
+            }
+          }
+          block[i] = sum * scale;
+        }
+        encode_block(&w, block, enc->divisors[TABLE_CHROMA], &prev_dc[1 + c], &enc->dc[TABLE_CHROMA],
+                     &enc->ac[TABLE_CHROMA]);
+      }
+    }
+  }
+  // Pad the last byte with ones, then EOI.
+  if (w.count > 0) {
+    put_bits(&w, (1U << (8 - w.count)) - 1U, 8 - w.count);
+  }
+  put_u16(&w, 0xFFD9);
+  if (w.overflow) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  *out_size = (uint32_t)w.len;
+  return ESP_OK;
+}
+
+static void build_huffman(const uint8_t *bits, const uint8_t *vals, huffman_table_t *out)
+{
+  uint32_t code = 0;
+  size_t k = 0;
+  for (int len = 1; len <= 16; ++len) {
+    for (int i = 0; i < bits[len - 1]; ++i) {
+      out->code[vals[k]] = (uint16_t)code;
+      out->size[vals[k]] = (uint8_t)len;
+      code++;
+      k++;
+    }
+    code <<= 1;
+  }
+}
+
+// libjpeg's quality scaling, with divisors folded in with the AAN DCT's
+// output scale factors.
+static void build_quant(struct jpeg_encoder_t *enc, uint32_t quality)
+{
+  static const float aan[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                               1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+  const uint32_t scale = quality < 50U ? 5000U / quality : 200U - quality * 2U;
+  for (int t = 0; t < TABLE_COUNT; ++t) {
+    for (int z = 0; z < 64; ++z) {
+      const int n = s_zigzag[z];
+      uint32_t q = (s_base_quant[t][n] * scale + 50U) / 100U;
+      q = q < 1U ? 1U : q > 255U ? 255U : q;
+      enc->dqt[t][z] = (uint8_t)q;
+      enc->divisors[t][n] = (float)q * aan[n / 8] * aan[n % 8] * 8.0f;
+    }
+  }
+  enc->quality = quality;
+}
+
+static void write_headers(bit_writer_t *w, const struct jpeg_encoder_t *enc, const jpeg_encode_cfg_t *cfg, int h_samp,
+                          int v_samp, int components)
+{
+  static const uint8_t jfif[] = {0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+                                 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+  const int tables = components > 1 ? TABLE_COUNT : 1;
+
+  put_u16(w, 0xFFD8);
+  for (size_t i = 0; i < sizeof(jfif); ++i) {
+    put_byte(w, jfif[i]);
+  }
+
+  put_u16(w, 0xFFDB);
+  put_u16(w, (uint16_t)(2 + tables * 65));
+  for (int t = 0; t < tables; ++t) {
+    put_byte(w, (uint8_t)t);
+    for (int z = 0; z < 64; ++z) {
+      put_byte(w, enc->dqt[t][z]);
+    }
+  }
+
+  put_u16(w, 0xFFC0);
+  put_u16(w, (uint16_t)(8 + 3 * components));
+  put_byte(w, 8);
+  put_u16(w, (uint16_t)cfg->height);
+  put_u16(w, (uint16_t)cfg->width);
+  put_byte(w, (uint8_t)components);
+  for (int c = 0; c < components; ++c) {
+    put_byte(w, (uint8_t)(c + 1));
+    put_byte(w, c == 0 ? (uint8_t)((h_samp << 4) | v_samp) : 0x11);
+    put_byte(w, c == 0 ? 0 : 1);
+  }
+
+  put_u16(w, 0xFFC4);
+  size_t dht_len = 2;
+  for (int t = 0; t < tables; ++t) {
+    dht_len += 17U + sizeof(s_dc_vals) + 17U + sizeof(s_ac_vals[t]);
+  }
+  put_u16(w, (uint16_t)dht_len);
+  for (int t = 0; t < tables; ++t) {
+    put_byte(w, (uint8_t)t);
+    for (int i = 0; i < 16; ++i) {
+      put_byte(w, s_dc_bits[t][i]);
+    }
+    for (size_t i = 0; i < sizeof(s_dc_vals); ++i) {
+      put_byte(w, s_dc_vals[i]);
+    }
+    put_byte(w, (uint8_t)(0x10 | t));
+    for (int i = 0; i < 16; ++i) {
+      put_byte(w, s_ac_bits[t][i]);
+    }
+    for (size_t i = 0; i < sizeof(s_ac_vals[t]); ++i) {
+      put_byte(w, s_ac_vals[t][i]);
+    }
+  }
+
+  put_u16(w, 0xFFDA);
+  put_u16(w, (uint16_t)(6 + 2 * components));
+  put_byte(w, (uint8_t)components);
+  for (int c = 0; c < components; ++c) {
+    put_byte(w, (uint8_t)(c + 1));
+    put_byte(w, c == 0 ? 0x00 : 0x11);
+  }
+  put_byte(w, 0);
+  put_byte(w, 63);
+  put_byte(w, 0);
+}
+
+// Converts one MCU to level-shifted Y, Cb and Cr (JFIF full range), clamping
+// coordinates at the right and bottom edges.
+static void load_mcu(const image_t *img, uint32_t x0, uint32_t y0, int mcu_w, int mcu_h, bool color, float y[16][16],
+                     float cb[16][16], float cr[16][16])
+{
+  for (int r = 0; r < mcu_h; ++r) {
+    const uint32_t sy = y0 + (uint32_t)r < img->height ? y0 + (uint32_t)r : img->height - 1U;
+    for (int c = 0; c < mcu_w; ++c) {
+      const uint32_t sx = x0 + (uint32_t)c < img->width ? x0 + (uint32_t)c : img->width - 1U;
+      const size_t at = (size_t)sy * img->width + sx;
+      float red;
+      float green;
+      float blue;
+      if (img->format == JPEG_ENCODE_IN_FORMAT_RGB565) {
+        const uint16_t v = (uint16_t)(img->in[at * 2U] | (img->in[at * 2U + 1U] << 8));
+        const uint32_t r5 = v >> 11;
+        const uint32_t g6 = (v >> 5) & 0x3FU;
+        const uint32_t b5 = v & 0x1FU;
+        red = (float)((r5 << 3) | (r5 >> 2));
+        green = (float)((g6 << 2) | (g6 >> 4));
+        blue = (float)((b5 << 3) | (b5 >> 2));
+      } else if (img->format == JPEG_ENCODE_IN_FORMAT_RGB888) {
+        red = img->in[at * 3U];
+        green = img->in[at * 3U + 1U];
+        blue = img->in[at * 3U + 2U];
+      } else {
+        red = green = blue = img->in[at];
+      }
+      y[r][c] = 0.299f * red + 0.587f * green + 0.114f * blue - 128.0f;
+      if (color) {
+        cb[r][c] = -0.168736f * red - 0.331264f * green + 0.5f * blue;
+        cr[r][c] = 0.5f * red - 0.418688f * green - 0.081312f * blue;
+      }
+    }
+  }
+}
+
+// Float AAN forward DCT (as libjpeg's jfdctflt.c), quantisation, then
+// Huffman coding in zigzag order.
+static void encode_block(bit_writer_t *w, float block[64], const float *divisors, int *prev_dc,
+                         const huffman_table_t *dc, const huffman_table_t *ac)
+{
+  for (int pass = 0; pass < 2; ++pass) {
+    const int step = pass == 0 ? 1 : 8;
+    const int next = pass == 0 ? 8 : 1;
+    for (int k = 0; k < 8; ++k) {
+      float *d = block + k * next;
+      const float tmp0 = d[0] + d[7 * step];
+      const float tmp7 = d[0] - d[7 * step];
+      const float tmp1 = d[step] + d[6 * step];
+      const float tmp6 = d[step] - d[6 * step];
+      const float tmp2 = d[2 * step] + d[5 * step];
+      const float tmp5 = d[2 * step] - d[5 * step];
+      const float tmp3 = d[3 * step] + d[4 * step];
+      const float tmp4 = d[3 * step] - d[4 * step];
+
+      float tmp10 = tmp0 + tmp3;
+      const float tmp13 = tmp0 - tmp3;
+      float tmp11 = tmp1 + tmp2;
+      float tmp12 = tmp1 - tmp2;
+      d[0] = tmp10 + tmp11;
+      d[4 * step] = tmp10 - tmp11;
+      const float z1 = (tmp12 + tmp13) * 0.707106781f;
+      d[2 * step] = tmp13 + z1;
+      d[6 * step] = tmp13 - z1;
+
+      tmp10 = tmp4 + tmp5;
+      tmp11 = tmp5 + tmp6;
+      tmp12 = tmp6 + tmp7;
+      const float z5 = (tmp10 - tmp12) * 0.382683433f;
+      const float z2 = 0.541196100f * tmp10 + z5;
+      const float z4 = 1.306562965f * tmp12 + z5;
+      const float z3 = tmp11 * 0.707106781f;
+      const float z11 = tmp7 + z3;
+      const float z13 = tmp7 - z3;
+      d[5 * step] = z13 + z2;
+      d[3 * step] = z13 - z2;
+      d[step] = z11 + z4;
+      d[7 * step] = z11 - z4;
+    }
+  }
+
+  int coef[64];
+  for (int z = 0; z < 64; ++z) {
+    const int n = s_zigzag[z];
+    coef[z] = (int)lrintf(block[n] / divisors[n]);
+  }
+
+  const int diff = coef[0] - *prev_dc;
+  *prev_dc = coef[0];
+  int magnitude = diff < 0 ? -diff : diff;
+  int nbits = 0;
+  while (magnitude > 0) {
+    nbits++;
+    magnitude >>= 1;
+  }
+  put_bits(w, dc->code[nbits], dc->size[nbits]);
+  if (nbits > 0) {
+    put_bits(w, (uint32_t)(diff < 0 ? diff - 1 : diff) & ((1U << nbits) - 1U), nbits);
+  }
+
+  int run = 0;
+  for (int z = 1; z < 64; ++z) {
+    if (coef[z] == 0) {
+      run++;
+      continue;
+    }
+    while (run > 15) {
+      put_bits(w, ac->code[0xF0], ac->size[0xF0]);
+      run -= 16;
+    }
+    const int v = coef[z];
+    magnitude = v < 0 ? -v : v;
+    nbits = 0;
+    while (magnitude > 0) {
+      nbits++;
+      magnitude >>= 1;
+    }
+    const int symbol = (run << 4) | nbits;
+    put_bits(w, ac->code[symbol], ac->size[symbol]);
+    put_bits(w, (uint32_t)(v < 0 ? v - 1 : v) & ((1U << nbits) - 1U), nbits);
+    run = 0;
+  }
+  if (run > 0) {
+    put_bits(w, ac->code[0x00], ac->size[0x00]);
+  }
+}
+
+static void put_byte(bit_writer_t *w, uint8_t b)
+{
+  if (w->len < w->cap) {
+    w->out[w->len++] = b;
+  } else {
+    w->overflow = true;
+  }
+}
+
+static void put_u16(bit_writer_t *w, uint16_t v)
+{
+  put_byte(w, (uint8_t)(v >> 8));
+  put_byte(w, (uint8_t)v);
+}
+
+// Entropy-coded bits, with a zero stuffed after every 0xFF byte.
+static void put_bits(bit_writer_t *w, uint32_t code, int size)
+{
+  w->bits = (w->bits << size) | code;
+  w->count += size;
+  while (w->count >= 8) {
+    const uint8_t b = (uint8_t)(w->bits >> (w->count - 8));
+    put_byte(w, b);
+    if (b == 0xFF) {
+      put_byte(w, 0);
+    }
+    w->count -= 8;
+  }
+  w->bits &= (1U << w->count) - 1U;
+}
@@ -0,0 +1,425 @@
+/*
+ * Reference float renderers for the host LED programs; see
+ * led_effects_float.h. The maths is copied unchanged from the float engine,
+ * including its per-pixel lroundf() output scaling, so host timings compare
+ * like for like. Only the strip writes are left out.
+ */
+#include "led_effects_float.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "esp_random.h"
+
+#define LED_PI 3.14159265f
+
+#define THERMOSTAT_LED_COUNT        LED_FLOAT_PIXELS
+#define LED_TIMER_PERIOD_MS         (10)
+#define LED_SPARKLE_TICKS_PER_FRAME (2)
+#define LED_SPARKLE_FADE_BY         (9)
+#define LED_SPARKLE_MAX_SPARKLES    (4)
+#define LED_SPARKLE_SPAWN_PROB      (15)
+#define LED_SPARKLE_SAT_MIN         (90)
+#define LED_SPARKLE_SAT_MAX         (160)
+#define LED_SPARKLE_INTENSITY_SCALE (100)
+
+#define LED_GREETING_SWEEP_MS       (400)
+#define LED_GREETING_PASSES         (6)
+#define LED_GREETING_BAND_WIDTH     (4)
+#define LED_GREETING_TAIL_DECAY     (0xC0)
+#define LED_GREETING_BRIGHTNESS     (0.7f)
+
+#define LED_WAVE_COUNT              (2)
+#define LED_WAVE_WIDTH              (0.45f)
+#define LED_WAVE_SPEED              (0.006f)
+#define LED_WAVE_PULSE_BRIGHTNESS   (70)
+
+#define LED_LEFT_START              (0)
+#define LED_LEFT_END                (14)
+#define LED_TOP_START               (15)
+#define LED_TOP_END                 (22)
+#define LED_RIGHT_START             (23)
+#define LED_RIGHT_END               (38)
+
+static float clamp_unit(float value)
+{
+  if (value < 0.0f)
+  {
+    return 0.0f;
+  }
+  if (value > 1.0f)
+  {
+    return 1.0f;
+  }
+  return value;
+}
+
+static uint8_t scale8(uint8_t value, uint8_t scale)
+{
+  return (uint8_t)(((uint16_t)value * (uint16_t)scale) >> 8);
+}
+
+static uint8_t scale8_video(uint8_t value, uint8_t scale)
+{
+  if (value == 0 || scale == 0)
+  {
+    return 0;
+  }
+  uint16_t product = ((uint16_t)value * (uint16_t)scale) >> 8;
+  product += 1;  // video scaling keeps low values visible
+  if (product > 255)
+  {
+    product = 255;
+  }
+  return (uint8_t)product;
+}
+
+static uint8_t saturating_add(uint8_t a, uint8_t b)
+{
+  uint16_t sum = (uint16_t)a + (uint16_t)b;
+  if (sum > 255)
+  {
+    sum = 255;
+  }
+  return (uint8_t)sum;
+}
+
+static thermostat_led_color_t hsv_to_rgb(uint8_t hue, uint8_t saturation, uint8_t value)
+{
+  thermostat_led_color_t color = {0};
+  if (saturation == 0)
+  {
+    color.r = value;
+    color.g = value;
+    color.b = value;
+    return color;
+  }
+
+  uint8_t region = hue / 43;
+  uint8_t remainder = (hue - (region * 43)) * 6;
+
+  uint8_t p = scale8(value, (uint8_t)(255 - saturation));
+  uint8_t q = scale8(value, (uint8_t)(255 - scale8(saturation, remainder)));
+  uint8_t t = scale8(value, (uint8_t)(255 - scale8(saturation, (uint8_t)(255 - remainder))));
+
+  switch (region)
+  {
+    case 0:
+      color.r = value;
+      color.g = t;
+      color.b = p;
+      break;
+    case 1:
+      color.r = q;
+      color.g = value;
+      color.b = p;
+      break;
+    case 2:
+      color.r = p;
+      color.g = value;
+      color.b = t;
+      break;
+    case 3:
+      color.r = p;
+      color.g = q;
+      color.b = value;
+      break;
+    case 4:
+      color.r = t;
+      color.g = p;
+      color.b = value;
+      break;
+    default:
+      color.r = value;
+      color.g = p;
+      color.b = q;
+      break;
+  }
+  return color;
+}
+
+static float write_fill(thermostat_led_color_t color, float brightness, thermostat_led_color_t *out)
+{
+  float applied_brightness = clamp_unit(brightness);
+  uint32_t r = (uint32_t)lroundf((float)color.r * applied_brightness);
+  uint32_t g = (uint32_t)lroundf((float)color.g * applied_brightness);
+  uint32_t b = (uint32_t)lroundf((float)color.b * applied_brightness);
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    out[i] = thermostat_led_color((uint8_t)r, (uint8_t)g, (uint8_t)b);
+  }
+  return applied_brightness;
+}
+
+static void write_pixels(const thermostat_led_color_t *pixels, float brightness, thermostat_led_color_t *out)
+{
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    uint32_t r = (uint32_t)lroundf((float)pixels[i].r * brightness);
+    uint32_t g = (uint32_t)lroundf((float)pixels[i].g * brightness);
+    uint32_t b = (uint32_t)lroundf((float)pixels[i].b * brightness);
+    out[i] = thermostat_led_color((uint8_t)r, (uint8_t)g, (uint8_t)b);
+  }
+}
+
+float led_float_pulse_render(const led_float_pulse_t *pulse, int64_t now, thermostat_led_color_t *out)
+{
+  float elapsed_s = (float)(now - pulse->start_time_us) / 1000000.0f;
+  if (elapsed_s < 0.0f)
+  {
+    elapsed_s = 0.0f;
+  }
+
+  float period = 1.0f / pulse->hz;
+  if (period <= 0.0f)
+  {
+    period = 1.0f;
+  }
+
+  float phase = fmodf(elapsed_s, period) / period;
+  float brightness = 0.5f - 0.5f * cosf(phase * 2.0f * LED_PI);
+  return write_fill(pulse->color, brightness, out);
+}
+
+static float wave_pulse_intensity(float normalized_dist)
+{
+  if (normalized_dist >= 1.0f)
+  {
+    return 0.0f;
+  }
+  return (1.0f + cosf(normalized_dist * LED_PI)) * 0.5f;
+}
+
+static uint8_t wave_get_pixel_boost(const led_float_wave_t *wave, float pixel_pos)
+{
+  float total_boost = 0.0f;
+  for (int w = 0; w < LED_WAVE_COUNT; w++)
+  {
+    float wave_pos = wave->wave_positions[w];
+    float dist = fabsf(pixel_pos - wave_pos);
+    float norm_dist = dist / LED_WAVE_WIDTH;
+    total_boost += wave_pulse_intensity(norm_dist);
+  }
+  if (total_boost > 1.0f)
+  {
+    total_boost = 1.0f;
+  }
+  return (uint8_t)(total_boost * LED_WAVE_PULSE_BRIGHTNESS);
+}
+
+static void wave_update_positions(led_float_wave_t *wave)
+{
+  for (int i = 0; i < LED_WAVE_COUNT; i++)
+  {
+    if (wave->rising)
+    {
+      wave->wave_positions[i] += LED_WAVE_SPEED;
+      if (wave->wave_positions[i] > 1.0f + LED_WAVE_WIDTH)
+      {
+        wave->wave_positions[i] = -LED_WAVE_WIDTH;
+      }
+    }
+    else
+    {
+      wave->wave_positions[i] -= LED_WAVE_SPEED;
+      if (wave->wave_positions[i] < -LED_WAVE_WIDTH)
+      {
+        wave->wave_positions[i] = 1.0f + LED_WAVE_WIDTH;
+      }
+    }
+  }
+}
+
+static void wave_tint(thermostat_led_color_t *pixel, uint8_t boost, bool rising)
+{
+  if (rising)
+  {
+    // Warm tint for heat
+    pixel->r = saturating_add(pixel->r, boost);
+    pixel->g = saturating_add(pixel->g, boost * 5 / 6);
+    pixel->b = saturating_add(pixel->b, boost * 2 / 3);
+  }
+  else
+  {
+    // Cool tint for cold
+    pixel->r = saturating_add(pixel->r, boost / 2);
+    pixel->g = saturating_add(pixel->g, boost * 3 / 4);
+    pixel->b = saturating_add(pixel->b, boost);
+  }
+}
+
+void led_float_wave_start(led_float_wave_t *wave, thermostat_led_color_t color, bool rising)
+{
+  wave->base_color = color;
+  wave->rising = rising;
+  float spacing = (1.0f + 2 * LED_WAVE_WIDTH) / LED_WAVE_COUNT;
+  for (int i = 0; i < LED_WAVE_COUNT; i++)
+  {
+    wave->wave_positions[i] = -LED_WAVE_WIDTH + i * spacing;
+  }
+}
+
+void led_float_wave_render(led_float_wave_t *wave, thermostat_led_color_t *out)
+{
+  thermostat_led_color_t pixels[THERMOSTAT_LED_COUNT];
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; i++)
+  {
+    pixels[i] = wave->base_color;
+  }
+
+  wave_update_positions(wave);
+
+  // Left side: pixels 0-14, position 0 (bottom) to 0.5 (top)
+  for (int px = LED_LEFT_START; px <= LED_LEFT_END; px++)
+  {
+    float pixel_pos = (float)(px - LED_LEFT_START) / (LED_LEFT_END - LED_LEFT_START) * 0.5f;
+    wave_tint(&pixels[px], wave_get_pixel_boost(wave, pixel_pos), wave->rising);
+  }
+
+  // Right side: pixels 38 (bottom) to 23 (top), position 0 to 0.5
+  for (int px = LED_RIGHT_START; px <= LED_RIGHT_END; px++)
+  {
+    float pixel_pos = (float)(LED_RIGHT_END - px) / (LED_RIGHT_END - LED_RIGHT_START) * 0.5f;
+    wave_tint(&pixels[px], wave_get_pixel_boost(wave, pixel_pos), wave->rising);
+  }
+
+  // Top bar: pixels 15-22, position 0.5 at edges to 1.0 at center
+  float top_length = (float)(LED_TOP_END - LED_TOP_START + 1);
+  float half_top = top_length / 2.0f;
+  for (int px = LED_TOP_START; px <= LED_TOP_END; px++)
+  {
+    float px_from_left = (float)(px - LED_TOP_START);
+    float px_from_right = (float)(LED_TOP_END - px);
+
+    float left_wave_pos = 0.5f + (px_from_left / half_top) * 0.5f;
+    float right_wave_pos = 0.5f + (px_from_right / half_top) * 0.5f;
+
+    uint8_t left_boost = wave_get_pixel_boost(wave, left_wave_pos);
+    uint8_t right_boost = wave_get_pixel_boost(wave, right_wave_pos);
+    wave_tint(&pixels[px], (left_boost > right_boost) ? left_boost : right_boost, wave->rising);
+  }
+
+  write_pixels(pixels, 1.0f, out);
+}
+
+static thermostat_led_color_t sparkle_random_color(void)
+{
+  uint8_t hue = (uint8_t)(esp_random() & 0xFF);
+  uint8_t saturation = (uint8_t)(LED_SPARKLE_SAT_MIN + (esp_random() % (LED_SPARKLE_SAT_MAX - LED_SPARKLE_SAT_MIN)));
+  thermostat_led_color_t rgb = hsv_to_rgb(hue, saturation, 255);
+  rgb.r = scale8_video(rgb.r, LED_SPARKLE_INTENSITY_SCALE);
+  rgb.g = scale8_video(rgb.g, LED_SPARKLE_INTENSITY_SCALE);
+  rgb.b = scale8_video(rgb.b, LED_SPARKLE_INTENSITY_SCALE);
+  return rgb;
+}
+
+bool led_float_sparkle_render(led_float_sparkle_t *sparkle, thermostat_led_color_t *out)
+{
+  sparkle->tick_accumulator++;
+  if (sparkle->tick_accumulator < LED_SPARKLE_TICKS_PER_FRAME)
+  {
+    return false;
+  }
+  sparkle->tick_accumulator = 0;
+
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    thermostat_led_color_t *pixel = &sparkle->pixels[i];
+    pixel->r = scale8(pixel->r, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+    pixel->g = scale8(pixel->g, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+    pixel->b = scale8(pixel->b, (uint8_t)(255 - LED_SPARKLE_FADE_BY));
+  }
+
+  if (!sparkle->stop_requested)
+  {
+    for (uint8_t attempt = 0; attempt < LED_SPARKLE_MAX_SPARKLES; ++attempt)
+    {
+      if ((uint8_t)(esp_random() & 0xFF) > LED_SPARKLE_SPAWN_PROB)
+      {
+        continue;
+      }
+      uint16_t pixel_index = (uint16_t)(esp_random() % THERMOSTAT_LED_COUNT);
+      thermostat_led_color_t *pixel = &sparkle->pixels[pixel_index];
+      thermostat_led_color_t color = sparkle_random_color();
+      pixel->r = saturating_add(pixel->r, color.r);
+      pixel->g = saturating_add(pixel->g, color.g);
+      pixel->b = saturating_add(pixel->b, color.b);
+    }
+  }
+
+  write_pixels(sparkle->pixels, 1.0f, out);
+  return true;
+}
+
+bool led_float_sparkle_is_dark(const led_float_sparkle_t *sparkle)
+{
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    const thermostat_led_color_t *pixel = &sparkle->pixels[i];
+    if (pixel->r != 0 || pixel->g != 0 || pixel->b != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void led_float_greeting_start(led_float_greeting_t *greeting)
+{
+  memset(greeting, 0, sizeof(*greeting));
+  greeting->direction = 1;
+  greeting->loops_remaining = LED_GREETING_PASSES;
+  greeting->step = (float)(THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH) /
+                   ((float)LED_GREETING_SWEEP_MS / (float)LED_TIMER_PERIOD_MS);
+}
+
+bool led_float_greeting_render(led_float_greeting_t *greeting, thermostat_led_color_t *out)
+{
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i)
+  {
+    thermostat_led_color_t *pixel = &greeting->pixels[i];
+    pixel->r = scale8(pixel->r, (uint8_t)LED_GREETING_TAIL_DECAY);
+    pixel->g = scale8(pixel->g, (uint8_t)LED_GREETING_TAIL_DECAY);
+    pixel->b = scale8(pixel->b, (uint8_t)LED_GREETING_TAIL_DECAY);
+  }
+
+  thermostat_led_color_t band_color = thermostat_led_color(0x8C, 0x50, 0xFF);
+  int max_head = THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH;
+  int head_index = (int)lroundf(greeting->head_index);
+  if (head_index < 0)
+  {
+    head_index = 0;
+  }
+  if (head_index > max_head)
+  {
+    head_index = max_head;
+  }
+  for (int i = 0; i < LED_GREETING_BAND_WIDTH; ++i)
+  {
+    greeting->pixels[head_index + i] = band_color;
+  }
+
+  write_pixels(greeting->pixels, LED_GREETING_BRIGHTNESS, out);
+
+  float max_index = (float)(THERMOSTAT_LED_COUNT - LED_GREETING_BAND_WIDTH);
+  greeting->head_index += (float)greeting->direction * greeting->step;
+  bool flipped = false;
+  if (greeting->head_index >= max_index)
+  {
+    greeting->head_index = max_index;
+    greeting->direction = -1;
+    flipped = true;
+  }
+  else if (greeting->head_index <= 0.0f)
+  {
+    greeting->head_index = 0.0f;
+    greeting->direction = 1;
+    flipped = true;
+  }
+
+  if (flipped && greeting->loops_remaining > 0)
+  {
+    greeting->loops_remaining--;
+  }
+  return greeting->loops_remaining != 0;
+}
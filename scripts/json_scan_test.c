@@ -0,0 +1,1073 @@
+/*
+ * Host tests and benchmark for the JSON tokenizer (main/connectivity/json_scan.c).
+ *
+ * Runs a unit suite and then a fuzz pass with two parts. First, random
+ * documents whose token stream is known in advance are scanned and compared
+ * token by token. Second, mutations of those documents and of a corpus of
+ * Home Assistant payloads are checked against a reference validator written
+ * straight from RFC 8259. Every input sits in an exact-size heap buffer
+ * with no terminator, so a sanitizer build catches any read past the
+ * payload. Finally the program times json_scan_fields() on representative
+ * payloads and reports its peak stack.
+ *
+ *   cc -O1 -g -fsanitize=address,undefined -Iscripts/host/include -Imain scripts/json_scan_test.c \
+ *     main/connectivity/json_scan.c -lm -lpthread -o /tmp/json_scan_test
+ *   /tmp/json_scan_test [fuzz_cases] [seed]
+ *
+ * Add -DJSON_SCAN_WITH_CJSON, -I$IDF_PATH/components/json/cJSON and
+ * $IDF_PATH/components/json/cJSON/cJSON.c to time cJSON on the same payloads
+ * and report its peak stack and heap. Timings and stack figures come from
+ * a -O2 build without sanitizers. Exits non-zero on any failure.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "connectivity/json_scan.h"
+
+#if JSON_SCAN_WITH_CJSON
+#include "cJSON.h"
+#endif
+
+#define TEST_DEFAULT_FUZZ_CASES (20000)
+#define TEST_MAX_TOKENS         (4096)
+#define TEST_GEN_MAX_LEN        (8192)
+#define TEST_BENCH_ITERATIONS   (200000)
+#define TEST_STACK_BYTES        (64 * 1024)
+#define TEST_STACK_FILL         (0xA5)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+static int s_failures;
+static uint64_t s_rng;
+
+typedef struct {
+  json_tok_type_t type;
+  uint8_t depth;
+  size_t offset; // into the document; strings and keys exclude the quotes
+  size_t len;
+} expected_tok_t;
+
+typedef struct {
+  char text[TEST_GEN_MAX_LEN];
+  size_t len;
+  expected_tok_t toks[TEST_MAX_TOKENS];
+  size_t count;
+  bool overflow;
+} gen_doc_t;
+
+static uint32_t rng_next(void)
+{
+  // xorshift64*
+  s_rng ^= s_rng >> 12;
+  s_rng ^= s_rng << 25;
+  s_rng ^= s_rng >> 27;
+  return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t rng_below(uint32_t n)
+{
+  return rng_next() % n;
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// The scanner must never see a terminator it could lean on.
+static char *dup_exact(const char *data, size_t len)
+{
+  char *copy = malloc(len > 0 ? len : 1);
+  if (copy == NULL) {
+    abort();
+  }
+  memcpy(copy, data, len);
+  return copy;
+}
+
+// Scans the whole buffer; returns the final token type (END or ERROR) and
+// checks that every token lies inside the buffer.
+static json_tok_type_t scan_all(const char *json, size_t len, json_tok_t *toks, size_t max, size_t *count)
+{
+  json_scanner_t scanner;
+  json_tok_t tok;
+  size_t n = 0;
+  json_scanner_init(&scanner, json, len);
+  while (json_scanner_next(&scanner, &tok)) {
+    CHECK(tok.start >= json && tok.start + tok.len <= json + len);
+    CHECK(tok.depth <= JSON_SCAN_MAX_DEPTH);
+    if (toks != NULL && n < max) {
+      toks[n] = tok;
+    }
+    n++;
+    if (n > len + 1) {
+      // Every token consumes at least one byte.
+      CHECK(!"scanner does not advance");
+      break;
+    }
+  }
+  CHECK(tok.type == JSON_TOK_END || tok.type == JSON_TOK_ERROR);
+  // A finished scanner stays finished.
+  json_tok_t again;
+  CHECK(!json_scanner_next(&scanner, &again) && again.type == tok.type);
+  if (count != NULL) {
+    *count = n;
+  }
+  return tok.type;
+}
+
+static bool accepts(const char *text)
+{
+  char *json = dup_exact(text, strlen(text));
+  json_tok_type_t last = scan_all(json, strlen(text), NULL, 0, NULL);
+  free(json);
+  return last == JSON_TOK_END;
+}
+
+// --- Reference validator (RFC 8259, same depth limit and byte handling) ---
+
+typedef struct {
+  const unsigned char *p;
+  const unsigned char *end;
+} ref_t;
+
+static bool ref_value(ref_t *r, int open);
+
+static void ref_ws(ref_t *r)
+{
+  while (r->p < r->end && (*r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r')) {
+    r->p++;
+  }
+}
+
+static bool ref_hex(unsigned char c)
+{
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool ref_string(ref_t *r)
+{
+  r->p++; // opening quote
+  while (r->p < r->end) {
+    unsigned char c = *r->p++;
+    if (c == '"') {
+      return true;
+    }
+    if (c < 0x20) {
+      return false;
+    }
+    if (c == '\\') {
+      if (r->p >= r->end) {
+        return false;
+      }
+      c = *r->p++;
+      if (c == 'u') {
+        for (int i = 0; i < 4; ++i) {
+          if (r->p >= r->end || !ref_hex(*r->p)) {
+            return false;
+          }
+          r->p++;
+        }
+      } else if (strchr("\"\\/bfnrt", c) == NULL || c == '\0') {
+        return false;
+      }
+    }
+  }
+  return false;
+}
+
+static bool ref_digits(ref_t *r)
+{
+  const unsigned char *start = r->p;
+  while (r->p < r->end && *r->p >= '0' && *r->p <= '9') {
+    r->p++;
+  }
+  return r->p > start;
+}
+
+static bool ref_number(ref_t *r)
+{
+  if (r->p < r->end && *r->p == '-') {
+    r->p++;
+  }
+  if (r->p >= r->end) {
+    return false;
+  }
+  if (*r->p == '0') {
+    r->p++;
+  } else if (!ref_digits(r)) {
+    return false;
+  }
+  if (r->p < r->end && *r->p == '.') {
+    r->p++;
+    if (!ref_digits(r)) {
+      return false;
+    }
+  }
+  if (r->p < r->end && (*r->p == 'e' || *r->p == 'E')) {
+    r->p++;
+    if (r->p < r->end && (*r->p == '+' || *r->p == '-')) {
+      r->p++;
+    }
+    if (!ref_digits(r)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool ref_literal(ref_t *r, const char *literal)
+{
+  size_t len = strlen(literal);
+  if ((size_t)(r->end - r->p) < len || memcmp(r->p, literal, len) != 0) {
+    return false;
+  }
+  r->p += len;
+  return true;
+}
+
+static bool ref_container(ref_t *r, int open, bool array)
+{
+  if (open >= JSON_SCAN_MAX_DEPTH) {
+    return false;
+  }
+  const unsigned char close = array ? ']' : '}';
+  r->p++;
+  ref_ws(r);
+  if (r->p < r->end && *r->p == close) {
+    r->p++;
+    return true;
+  }
+  while (true) {
+    if (!array) {
+      if (r->p >= r->end || *r->p != '"' || !ref_string(r)) {
+        return false;
+      }
+      ref_ws(r);
+      if (r->p >= r->end || *r->p != ':') {
+        return false;
+      }
+      r->p++;
+      ref_ws(r);
+    }
+    if (!ref_value(r, open + 1)) {
+      return false;
+    }
+    ref_ws(r);
+    if (r->p >= r->end) {
+      return false;
+    }
+    if (*r->p == close) {
+      r->p++;
+      return true;
+    }
+    if (*r->p != ',') {
+      return false;
+    }
+    r->p++;
+    ref_ws(r);
+  }
+}
+
+static bool ref_value(ref_t *r, int open)
+{
+  if (r->p >= r->end) {
+    return false;
+  }
+  switch (*r->p) {
+  case '{':
+    return ref_container(r, open, false);
+  case '[':
+    return ref_container(r, open, true);
+  case '"':
+    return ref_string(r);
+  case 't':
+    return ref_literal(r, "true");
+  case 'f':
+    return ref_literal(r, "false");
+  case 'n':
+    return ref_literal(r, "null");
+  default:
+    return ref_number(r);
+  }
+}
+
+static bool ref_validate(const char *json, size_t len)
+{
+  ref_t r = {(const unsigned char *)json, (const unsigned char *)json + len};
+  ref_ws(&r);
+  if (!ref_value(&r, 0)) {
+    return false;
+  }
+  ref_ws(&r);
+  return r.p == r.end;
+}
+
+// --- Generator of documents with a known token stream ---
+
+static void gen_put(gen_doc_t *doc, const char *text, size_t len)
+{
+  if (doc->len + len > sizeof(doc->text)) {
+    doc->overflow = true;
+    return;
+  }
+  memcpy(doc->text + doc->len, text, len);
+  doc->len += len;
+}
+
+static void gen_ws(gen_doc_t *doc)
+{
+  static const char ws[] = " \t\n\r";
+  uint32_t n = rng_below(4) == 0 ? rng_below(3) : 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    gen_put(doc, &ws[rng_below(4)], 1);
+  }
+}
+
+static void gen_expect(gen_doc_t *doc, json_tok_type_t type, uint8_t depth, size_t offset, size_t len)
+{
+  if (doc->count >= TEST_MAX_TOKENS) {
+    doc->overflow = true;
+    return;
+  }
+  doc->toks[doc->count++] = (expected_tok_t){type, depth, offset, len};
+}
+
+static void gen_string(gen_doc_t *doc, json_tok_type_t type, uint8_t depth)
+{
+  static const char *const escapes[] = {"\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u00e9", "\\u0041"};
+  gen_put(doc, "\"", 1);
+  const size_t start = doc->len;
+  uint32_t n = rng_below(12);
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t pick = rng_below(10);
+    if (pick == 0) {
+      const char *esc = escapes[rng_below(sizeof(escapes) / sizeof(escapes[0]))];
+      gen_put(doc, esc, strlen(esc));
+    } else if (pick == 1) {
+      char high = (char)(0x80 + rng_below(0x80)); // raw UTF-8 bytes pass through
+      gen_put(doc, &high, 1);
+    } else {
+      char c = (char)(0x20 + rng_below(0x5F));
+      if (c == '"' || c == '\\') {
+        c = 'x';
+      }
+      gen_put(doc, &c, 1);
+    }
+  }
+  gen_expect(doc, type, depth, start, doc->len - start);
+  gen_put(doc, "\"", 1);
+}
+
+static void gen_number(gen_doc_t *doc, uint8_t depth)
+{
+  char number[40];
+  size_t n = 0;
+  if (rng_below(3) == 0) {
+    number[n++] = '-';
+  }
+  if (rng_below(4) == 0) {
+    number[n++] = '0';
+  } else {
+    number[n++] = (char)('1' + rng_below(9));
+    for (uint32_t i = rng_below(6); i > 0; --i) {
+      number[n++] = (char)('0' + rng_below(10));
+    }
+  }
+  if (rng_below(2) == 0) {
+    number[n++] = '.';
+    for (uint32_t i = 1 + rng_below(4); i > 0; --i) {
+      number[n++] = (char)('0' + rng_below(10));
+    }
+  }
+  if (rng_below(4) == 0) {
+    number[n++] = rng_below(2) ? 'e' : 'E';
+    uint32_t sign = rng_below(3);
+    if (sign == 1) {
+      number[n++] = '+';
+    } else if (sign == 2) {
+      number[n++] = '-';
+    }
+    for (uint32_t i = 1 + rng_below(2); i > 0; --i) {
+      number[n++] = (char)('0' + rng_below(10));
+    }
+  }
+  gen_expect(doc, JSON_TOK_NUMBER, depth, doc->len, n);
+  gen_put(doc, number, n);
+}
+
+static void gen_value(gen_doc_t *doc, uint8_t depth)
+{
+  uint32_t kind = rng_below(depth < JSON_SCAN_MAX_DEPTH ? 8 : 6);
+  switch (kind) {
+  case 0:
+    gen_string(doc, JSON_TOK_STRING, depth);
+    break;
+  case 1:
+  case 2:
+    gen_number(doc, depth);
+    break;
+  case 3:
+    gen_expect(doc, JSON_TOK_TRUE, depth, doc->len, 4);
+    gen_put(doc, "true", 4);
+    break;
+  case 4:
+    gen_expect(doc, JSON_TOK_FALSE, depth, doc->len, 5);
+    gen_put(doc, "false", 5);
+    break;
+  case 5:
+    gen_expect(doc, JSON_TOK_NULL, depth, doc->len, 4);
+    gen_put(doc, "null", 4);
+    break;
+  default: {
+    const bool array = (kind == 6);
+    gen_expect(doc, array ? JSON_TOK_ARRAY_BEGIN : JSON_TOK_OBJECT_BEGIN, depth, doc->len, 1);
+    gen_put(doc, array ? "[" : "{", 1);
+    uint32_t members = rng_below(depth < 3 ? 6 : 3);
+    for (uint32_t i = 0; i < members && !doc->overflow; ++i) {
+      gen_ws(doc);
+      if (i > 0) {
+        gen_put(doc, ",", 1);
+        gen_ws(doc);
+      }
+      if (!array) {
+        gen_string(doc, JSON_TOK_KEY, (uint8_t)(depth + 1));
+        gen_ws(doc);
+        gen_put(doc, ":", 1);
+        gen_ws(doc);
+      }
+      gen_value(doc, (uint8_t)(depth + 1));
+    }
+    gen_ws(doc);
+    gen_expect(doc, array ? JSON_TOK_ARRAY_END : JSON_TOK_OBJECT_END, depth, doc->len, 1);
+    gen_put(doc, array ? "]" : "}", 1);
+    break;
+  }
+  }
+}
+
+static void gen_document(gen_doc_t *doc)
+{
+  doc->len = 0;
+  doc->count = 0;
+  doc->overflow = false;
+  gen_ws(doc);
+  gen_value(doc, 0);
+  gen_ws(doc);
+}
+
+// --- Unit suite ---
+
+static void test_token_stream(void)
+{
+  const char *text = "{\"a\":[1,-2.5e3,\"x\\\"y\"],\"b\":{\"c\":null},\"d\":true,\"e\":false}";
+  static const struct {
+    json_tok_type_t type;
+    uint8_t depth;
+    const char *raw;
+  } expected[] = {
+      {JSON_TOK_OBJECT_BEGIN, 0, "{"}, {JSON_TOK_KEY, 1, "a"},        {JSON_TOK_ARRAY_BEGIN, 1, "["},
+      {JSON_TOK_NUMBER, 2, "1"},       {JSON_TOK_NUMBER, 2, "-2.5e3"}, {JSON_TOK_STRING, 2, "x\\\"y"},
+      {JSON_TOK_ARRAY_END, 1, "]"},    {JSON_TOK_KEY, 1, "b"},        {JSON_TOK_OBJECT_BEGIN, 1, "{"},
+      {JSON_TOK_KEY, 2, "c"},          {JSON_TOK_NULL, 2, "null"},    {JSON_TOK_OBJECT_END, 1, "}"},
+      {JSON_TOK_KEY, 1, "d"},          {JSON_TOK_TRUE, 1, "true"},    {JSON_TOK_KEY, 1, "e"},
+      {JSON_TOK_FALSE, 1, "false"},    {JSON_TOK_OBJECT_END, 0, "}"},
+  };
+  char *json = dup_exact(text, strlen(text));
+  json_tok_t toks[32];
+  size_t count = 0;
+  CHECK(scan_all(json, strlen(text), toks, 32, &count) == JSON_TOK_END);
+  CHECK(count == sizeof(expected) / sizeof(expected[0]));
+  for (size_t i = 0; i < count && i < sizeof(expected) / sizeof(expected[0]); ++i) {
+    CHECK(toks[i].type == expected[i].type);
+    CHECK(toks[i].depth == expected[i].depth);
+    CHECK(toks[i].len == strlen(expected[i].raw) && memcmp(toks[i].start, expected[i].raw, toks[i].len) == 0);
+  }
+  free(json);
+}
+
+static void test_accept_reject(void)
+{
+  static const char *const valid[] = {
+      "0", "-0", "1e5", "1E+5", "2.5e-3", "\"\"", "true", " null ", "[]", "{}", "[[]]",
+      "{\"a\":{}}", "\"\\u00e9\\/\"", "[1,2,3]", "\t{\r\n\"k\" : [ ] }\n", "[[[[[[[[1]]]]]]]]",
+  };
+  static const char *const invalid[] = {
+      "", " ", "{", "}", "[1,]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[01]", "1.", "-", "1e", "1e+",
+      "\"abc", "\"\\x\"", "\"\\u12g4\"", "\"\\u12\"", "tru", "nul", "[1 2]", "{1:2}", "\"a\nb\"", "[]]",
+      "{\"a\":1}}", "[{]}", "[[[[[[[[[1]]]]]]]]]", "1 2", "+1", ".5", "[1,,2]", "{,}", "truex",
+      "{\"a\" 1}", "[\"a\":1]", "\"\\", "nan", "-Infinity",
+  };
+  for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+    if (!accepts(valid[i])) {
+      fprintf(stderr, "rejected valid: %s\n", valid[i]);
+      s_failures++;
+    }
+    CHECK(ref_validate(valid[i], strlen(valid[i])));
+  }
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+    if (accepts(invalid[i])) {
+      fprintf(stderr, "accepted invalid: %s\n", invalid[i]);
+      s_failures++;
+    }
+    CHECK(!ref_validate(invalid[i], strlen(invalid[i])));
+  }
+}
+
+static void test_numbers(void)
+{
+  float value = 0.0f;
+  char *json = dup_exact(" 21.5\n", 6);
+  CHECK(json_parse_number(json, 6, &value) && value == 21.5f);
+  free(json);
+
+  // Not JSON, but strtof() took them before the scanner and HA may publish
+  // them, so they still parse.
+  static const struct {
+    const char *text;
+    float value;
+  } lenient[] = {
+      {"+21", 21.0f}, {".5", 0.5f}, {"21.", 21.0f}, {"0x15", 21.0f}, {"\t-3e2 \r\n", -300.0f}, {"007", 7.0f},
+  };
+  for (size_t i = 0; i < sizeof(lenient) / sizeof(lenient[0]); ++i) {
+    json = dup_exact(lenient[i].text, strlen(lenient[i].text));
+    CHECK(json_parse_number(json, strlen(lenient[i].text), &value) && value == lenient[i].value);
+    free(json);
+  }
+
+  static const char *const bad[] = {"21.5 x", "\"21.5\"", "unavailable", "", "1e39", "[1]", "on",
+                                    "nan",    "inf",      "0x",          "+", ".",    " ",   "1 2"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    json = dup_exact(bad[i], strlen(bad[i]));
+    value = -1.0f;
+    CHECK(!json_parse_number(json, strlen(bad[i]), &value));
+    CHECK(value == -1.0f);
+    free(json);
+  }
+  CHECK(!json_parse_number(NULL, 0, &value));
+
+  static const struct {
+    const char *text;
+    bool ok;
+    int32_t value;
+  } ints[] = {
+      {"2147483647", true, INT32_MAX}, {"-2147483648", true, INT32_MIN}, {"2147483648", false, 0},
+      {"-2147483649", false, 0},       {"1.0", false, 0},                {"1e3", false, 0},
+      {"0", true, 0},                  {"-17", true, -17},
+  };
+  for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); ++i) {
+    json = dup_exact(ints[i].text, strlen(ints[i].text));
+    json_scanner_t scanner;
+    json_tok_t tok;
+    json_scanner_init(&scanner, json, strlen(ints[i].text));
+    CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_NUMBER);
+    int32_t out = 12345;
+    CHECK(json_tok_to_int32(&tok, &out) == ints[i].ok);
+    CHECK(out == (ints[i].ok ? ints[i].value : 12345));
+    free(json);
+  }
+
+  // A number longer than the conversion buffer is a valid token but not a value.
+  char longnum[64];
+  memset(longnum, '1', sizeof(longnum));
+  json_scanner_t scanner;
+  json_tok_t tok;
+  json_scanner_init(&scanner, longnum, sizeof(longnum));
+  CHECK(json_scanner_next(&scanner, &tok) && tok.len == sizeof(longnum));
+  CHECK(!json_tok_to_float(&tok, &value));
+}
+
+static void test_strings(void)
+{
+  const char *text = "\"a\\nb\\u0041\\u00e9\\/\\\"\"";
+  char *json = dup_exact(text, strlen(text));
+  json_scanner_t scanner;
+  json_tok_t tok;
+  json_scanner_init(&scanner, json, strlen(text));
+  CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_STRING);
+
+  char out[16];
+  CHECK(json_tok_copy_string(&tok, out, sizeof(out)));
+  CHECK(strcmp(out, "a\nbA?/\"") == 0);
+  // Seven characters fit in eight bytes exactly, not in seven.
+  CHECK(json_tok_copy_string(&tok, out, 8) && strcmp(out, "a\nbA?/\"") == 0);
+  memset(out, 'z', sizeof(out));
+  CHECK(!json_tok_copy_string(&tok, out, 7));
+  CHECK(memchr(out, '\0', 7) != NULL);
+  CHECK(!json_tok_copy_string(&tok, out, 0));
+  CHECK(!json_tok_copy_string(&tok, NULL, 4));
+
+  json_tok_t number = {.type = JSON_TOK_NUMBER, .start = json, .len = 1};
+  CHECK(!json_tok_copy_string(&number, out, sizeof(out)));
+  CHECK(json_tok_equals(&tok, "a\\nb\\u0041\\u00e9\\/\\\""));
+  CHECK(!json_tok_equals(&tok, "a\nbA?/\""));
+  free(json);
+}
+
+typedef struct {
+  char name[8];
+  float temp;
+  int32_t count;
+  bool on;
+} fields_out_t;
+
+static const json_field_t s_test_fields[] = {
+    JSON_FIELD(fields_out_t, "name", JSON_FIELD_STRING, name),
+    JSON_FIELD(fields_out_t, "temp", JSON_FIELD_FLOAT, temp),
+    JSON_FIELD(fields_out_t, "count", JSON_FIELD_INT, count),
+    JSON_FIELD(fields_out_t, "on", JSON_FIELD_BOOL, on),
+};
+#define TEST_FIELD_COUNT (sizeof(s_test_fields) / sizeof(s_test_fields[0]))
+
+static esp_err_t scan_fields_text(const char *text, fields_out_t *out, uint32_t *found)
+{
+  char *json = dup_exact(text, strlen(text));
+  esp_err_t err = json_scan_fields(json, strlen(text), s_test_fields, TEST_FIELD_COUNT, out, found);
+  free(json);
+  return err;
+}
+
+static void test_fields(void)
+{
+  fields_out_t out = {0};
+  uint32_t found = 0;
+  CHECK(scan_fields_text("{\"x\":{\"name\":\"nested\",\"a\":[1,{\"b\":2}]},\"name\":\"hall\",\"temp\":21.5,"
+                         "\"count\":3,\"on\":true,\"tail\":[[],{}]}",
+                         &out, &found) == ESP_OK);
+  CHECK(found == 0xF);
+  CHECK(strcmp(out.name, "hall") == 0 && out.temp == 21.5f && out.count == 3 && out.on);
+
+  // Wrong types and nulls leave the member alone and its bit clear.
+  fields_out_t keep = {"keep", 1.0f, 7, true};
+  CHECK(scan_fields_text("{\"name\":5,\"temp\":\"hot\",\"count\":2.5,\"on\":null}", &keep, &found) == ESP_OK);
+  CHECK(found == 0);
+  CHECK(strcmp(keep.name, "keep") == 0 && keep.temp == 1.0f && keep.count == 7 && keep.on);
+
+  // The last duplicate wins; an escaped key never matches.
+  CHECK(scan_fields_text("{\"count\":1,\"count\":2,\"n\\u0061me\":\"esc\"}", &out, &found) == ESP_OK);
+  CHECK(found == 0x4 && out.count == 2 && strcmp(out.name, "hall") == 0);
+
+  CHECK(scan_fields_text("{\"name\":\"too-long\"}", &out, &found) == ESP_ERR_INVALID_SIZE);
+  CHECK(scan_fields_text("{\"name\":\"sevench\"}", &out, &found) == ESP_OK && strcmp(out.name, "sevench") == 0);
+  CHECK(scan_fields_text("[1]", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("\"name\"", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("{\"on\":true} x", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("{\"on\":true", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("{\"on\":tru}", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("{\"x\":[1,}", &out, &found) == ESP_ERR_INVALID_RESPONSE);
+  CHECK(scan_fields_text("{}", &out, &found) == ESP_OK && found == 0);
+
+  CHECK(json_scan_fields(NULL, 0, s_test_fields, TEST_FIELD_COUNT, &out, NULL) == ESP_ERR_INVALID_ARG);
+  CHECK(json_scan_fields("{}", 2, NULL, 1, &out, NULL) == ESP_ERR_INVALID_ARG);
+  CHECK(json_scan_fields("{}", 2, s_test_fields, JSON_SCAN_MAX_FIELDS + 1, &out, NULL) == ESP_ERR_INVALID_ARG);
+  CHECK(json_scan_fields("{}", 2, NULL, 0, &out, NULL) == ESP_OK);
+}
+
+static void test_skip(void)
+{
+  const char *text = "[{\"a\":[1,[2,{\"b\":[]}]]},3]";
+  char *json = dup_exact(text, strlen(text));
+  json_scanner_t scanner;
+  json_tok_t tok;
+  json_scanner_init(&scanner, json, strlen(text));
+  CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_ARRAY_BEGIN);
+  CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_OBJECT_BEGIN);
+  CHECK(json_scanner_skip(&scanner, &tok));
+  CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_NUMBER && tok.len == 1 && tok.start[0] == '3');
+  CHECK(json_scanner_skip(&scanner, &tok));
+  CHECK(json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_ARRAY_END && tok.depth == 0);
+  CHECK(!json_scanner_next(&scanner, &tok) && tok.type == JSON_TOK_END);
+  free(json);
+}
+
+// --- Fuzz ---
+
+static const char *const s_corpus[] = {
+    "{\"command\":\"rainbow\"}",
+    "21.5",
+    "unavailable",
+    "{\"hvac_modes\":[\"off\",\"heat\",\"cool\",\"heat_cool\"],\"min_temp\":7,\"max_temp\":35,"
+    "\"current_temperature\":21.4,\"target_temp_high\":24.5,\"target_temp_low\":19.0,"
+    "\"fan_mode\":\"auto\",\"hvac_action\":\"heating\",\"friendly_name\":\"Hallway \\u00e9\"}",
+    "{\"temperature\":-3.5e0,\"forecast\":[{\"t\":1,\"c\":\"snow\"},{\"t\":2,\"c\":null}],\"ok\":false}",
+};
+
+static void mutate(char *buf, size_t *len, size_t cap)
+{
+  static const char interesting[] = "{}[]\",:\\0123456789eE.+-tfnu \t\n\x01\x7f\x80";
+  uint32_t ops = 1 + rng_below(4);
+  for (uint32_t op = 0; op < ops; ++op) {
+    switch (rng_below(6)) {
+    case 0:
+      if (*len > 0) {
+        buf[rng_below((uint32_t)*len)] ^= (char)(1u << rng_below(8));
+      }
+      break;
+    case 1:
+      if (*len > 0) {
+        buf[rng_below((uint32_t)*len)] = interesting[rng_below(sizeof(interesting) - 1)];
+      }
+      break;
+    case 2:
+      if (*len < cap) {
+        size_t at = rng_below((uint32_t)*len + 1);
+        memmove(buf + at + 1, buf + at, *len - at);
+        buf[at] = interesting[rng_below(sizeof(interesting) - 1)];
+        (*len)++;
+      }
+      break;
+    case 3:
+      if (*len > 0) {
+        size_t at = rng_below((uint32_t)*len);
+        memmove(buf + at, buf + at + 1, *len - at - 1);
+        (*len)--;
+      }
+      break;
+    case 4:
+      *len = rng_below((uint32_t)*len + 1);
+      break;
+    default: {
+      // Duplicate a slice, which nests or repeats structure.
+      if (*len == 0) {
+        break;
+      }
+      size_t from = rng_below((uint32_t)*len);
+      size_t n = 1 + rng_below((uint32_t)(*len - from));
+      if (*len + n <= cap) {
+        size_t at = rng_below((uint32_t)*len + 1);
+        char slice[TEST_GEN_MAX_LEN];
+        memcpy(slice, buf + from, n);
+        memmove(buf + at + n, buf + at, *len - at);
+        memcpy(buf + at, slice, n);
+        *len += n;
+      }
+      break;
+    }
+    }
+  }
+}
+
+static void fuzz(uint32_t cases)
+{
+  static gen_doc_t doc;
+  static json_tok_t toks[TEST_MAX_TOKENS];
+  static char buf[TEST_GEN_MAX_LEN];
+  uint32_t generated = 0;
+  uint32_t mutated_valid = 0;
+  uint32_t mutated_invalid = 0;
+
+  for (uint32_t i = 0; i < cases; ++i) {
+    // Known token streams.
+    gen_document(&doc);
+    if (!doc.overflow) {
+      generated++;
+      char *json = dup_exact(doc.text, doc.len);
+      size_t count = 0;
+      json_tok_type_t last = scan_all(json, doc.len, toks, TEST_MAX_TOKENS, &count);
+      CHECK(last == JSON_TOK_END);
+      CHECK(count == doc.count);
+      for (size_t t = 0; t < count && t < doc.count; ++t) {
+        const expected_tok_t *e = &doc.toks[t];
+        if (toks[t].type != e->type || toks[t].depth != e->depth || toks[t].start != json + e->offset ||
+            toks[t].len != e->len) {
+          fprintf(stderr, "token %zu differs in generated document: %.*s\n", t, (int)doc.len, doc.text);
+          s_failures++;
+          break;
+        }
+      }
+      const bool object = doc.toks[0].type == JSON_TOK_OBJECT_BEGIN;
+      CHECK((json_scan_fields(json, doc.len, NULL, 0, buf, NULL) == ESP_OK) == object);
+      free(json);
+    }
+
+    // Mutations against the reference validator.
+    size_t len;
+    if (!doc.overflow && rng_below(2) == 0) {
+      len = doc.len;
+      memcpy(buf, doc.text, len);
+    } else {
+      const char *seed = s_corpus[rng_below(sizeof(s_corpus) / sizeof(s_corpus[0]))];
+      len = strlen(seed);
+      memcpy(buf, seed, len);
+    }
+    mutate(buf, &len, sizeof(buf));
+    char *json = dup_exact(buf, len);
+    const bool expected = ref_validate(json, len);
+    const bool got = scan_all(json, len, NULL, 0, NULL) == JSON_TOK_END;
+    if (got != expected) {
+      fprintf(stderr, "validator mismatch (scanner=%d reference=%d): %.*s\n", got, expected, (int)len, json);
+      s_failures++;
+    }
+    expected ? mutated_valid++ : mutated_invalid++;
+
+    fields_out_t out;
+    uint32_t found = 0;
+    esp_err_t err = json_scan_fields(json, len, s_test_fields, TEST_FIELD_COUNT, &out, &found);
+    CHECK(err == ESP_OK || err == ESP_ERR_INVALID_RESPONSE || err == ESP_ERR_INVALID_SIZE);
+    if (err != ESP_ERR_INVALID_RESPONSE) {
+      CHECK(expected);
+    }
+    free(json);
+  }
+  printf("fuzz cases=%u generated=%u mutated_valid=%u mutated_invalid=%u\n", cases, generated, mutated_valid,
+         mutated_invalid);
+}
+
+// --- Benchmark ---
+
+typedef struct {
+  float current;
+  float low;
+  float high;
+  int32_t min_temp;
+  char action[16];
+  char fan[16];
+} climate_t;
+
+static const json_field_t s_climate_fields[] = {
+    JSON_FIELD(climate_t, "current_temperature", JSON_FIELD_FLOAT, current),
+    JSON_FIELD(climate_t, "target_temp_low", JSON_FIELD_FLOAT, low),
+    JSON_FIELD(climate_t, "target_temp_high", JSON_FIELD_FLOAT, high),
+    JSON_FIELD(climate_t, "min_temp", JSON_FIELD_INT, min_temp),
+    JSON_FIELD(climate_t, "hvac_action", JSON_FIELD_STRING, action),
+    JSON_FIELD(climate_t, "fan_mode", JSON_FIELD_STRING, fan),
+};
+
+typedef struct {
+  char name[32];
+} command_t;
+
+static const json_field_t s_bench_command_fields[] = {
+    JSON_FIELD(command_t, "command", JSON_FIELD_STRING, name),
+};
+
+typedef struct {
+  const char *name;
+  const char *payload;
+} bench_payload_t;
+
+static const bench_payload_t s_payloads[] = {
+    {"number", "21.5"},
+    {"command", "{\"command\":\"rainbow\"}"},
+    {"climate",
+     "{\"hvac_modes\":[\"off\",\"heat\",\"cool\",\"heat_cool\",\"fan_only\"],\"min_temp\":7,\"max_temp\":35,"
+     "\"target_temp_step\":0.5,\"fan_modes\":[\"auto\",\"low\",\"medium\",\"high\"],\"preset_modes\":[\"none\","
+     "\"away\",\"eco\",\"sleep\"],\"current_temperature\":21.4,\"temperature\":null,\"target_temp_high\":24.5,"
+     "\"target_temp_low\":19.0,\"current_humidity\":41,\"fan_mode\":\"auto\",\"hvac_action\":\"heating\","
+     "\"preset_mode\":\"none\",\"friendly_name\":\"Theoretical Thermostat Climate Control\","
+     "\"supported_features\":411}"},
+};
+
+typedef struct {
+  const bench_payload_t *payload;
+  size_t len;
+  bool use_cjson;
+  bool ok;
+} bench_job_t;
+
+static bool run_scan(const bench_job_t *job)
+{
+  const char *text = job->payload->payload;
+  if (strcmp(job->payload->name, "number") == 0) {
+    float value;
+    return json_parse_number(text, job->len, &value);
+  }
+  if (strcmp(job->payload->name, "command") == 0) {
+    command_t command;
+    uint32_t found = 0;
+    return json_scan_fields(text, job->len, s_bench_command_fields, 1, &command, &found) == ESP_OK && found == 1;
+  }
+  climate_t climate;
+  uint32_t found = 0;
+  return json_scan_fields(text, job->len, s_climate_fields, sizeof(s_climate_fields) / sizeof(s_climate_fields[0]),
+                          &climate, &found) == ESP_OK &&
+         found == 0x3F;
+}
+
+#if JSON_SCAN_WITH_CJSON
+static size_t s_heap_now;
+static size_t s_heap_peak;
+
+static void *counting_malloc(size_t size)
+{
+  size_t *block = malloc(sizeof(size_t) + size);
+  if (block == NULL) {
+    return NULL;
+  }
+  *block = size;
+  s_heap_now += size;
+  if (s_heap_now > s_heap_peak) {
+    s_heap_peak = s_heap_now;
+  }
+  return block + 1;
+}
+
+static void counting_free(void *ptr)
+{
+  if (ptr != NULL) {
+    size_t *block = (size_t *)ptr - 1;
+    s_heap_now -= *block;
+    free(block);
+  }
+}
+
+static bool copy_cjson_string(const cJSON *item, char *dst, size_t dst_len)
+{
+  if (!cJSON_IsString(item) || strlen(item->valuestring) >= dst_len) {
+    return false;
+  }
+  strcpy(dst, item->valuestring);
+  return true;
+}
+
+static bool run_cjson(const bench_job_t *job)
+{
+  cJSON *root = cJSON_ParseWithLength(job->payload->payload, job->len);
+  if (root == NULL) {
+    return false;
+  }
+  bool ok = false;
+  if (strcmp(job->payload->name, "number") == 0) {
+    ok = cJSON_IsNumber(root);
+  } else if (strcmp(job->payload->name, "command") == 0) {
+    command_t command;
+    ok = copy_cjson_string(cJSON_GetObjectItemCaseSensitive(root, "command"), command.name, sizeof(command.name));
+  } else {
+    climate_t climate;
+    const cJSON *current = cJSON_GetObjectItemCaseSensitive(root, "current_temperature");
+    const cJSON *low = cJSON_GetObjectItemCaseSensitive(root, "target_temp_low");
+    const cJSON *high = cJSON_GetObjectItemCaseSensitive(root, "target_temp_high");
+    const cJSON *min_temp = cJSON_GetObjectItemCaseSensitive(root, "min_temp");
+    ok = cJSON_IsNumber(current) && cJSON_IsNumber(low) && cJSON_IsNumber(high) && cJSON_IsNumber(min_temp) &&
+         copy_cjson_string(cJSON_GetObjectItemCaseSensitive(root, "hvac_action"), climate.action,
+                           sizeof(climate.action)) &&
+         copy_cjson_string(cJSON_GetObjectItemCaseSensitive(root, "fan_mode"), climate.fan, sizeof(climate.fan));
+    climate.current = (float)current->valuedouble;
+    climate.low = (float)low->valuedouble;
+    climate.high = (float)high->valuedouble;
+    climate.min_temp = min_temp->valueint;
+    (void)climate;
+  }
+  cJSON_Delete(root);
+  return ok;
+}
+#endif
+
+static void *stack_job(void *arg)
+{
+  bench_job_t *job = arg;
+  if (job == NULL) {
+    return NULL;
+  }
+#if JSON_SCAN_WITH_CJSON
+  job->ok = job->use_cjson ? run_cjson(job) : run_scan(job);
+#else
+  job->ok = run_scan(job);
+#endif
+  return NULL;
+}
+
+// Runs one parse on a thread whose stack was painted beforehand and returns
+// how deep the paint was disturbed. A run with no job measures the thread
+// start-up overhead, which is subtracted. Sanitizer builds move locals off
+// this stack, so only an unsanitized build gives meaningful figures.
+static size_t painted_stack_use(bench_job_t *job)
+{
+  static uint8_t stack[TEST_STACK_BYTES] __attribute__((aligned(64)));
+  memset(stack, TEST_STACK_FILL, sizeof(stack));
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, stack, sizeof(stack));
+  if (pthread_create(&thread, &attr, stack_job, job) != 0) {
+    abort();
+  }
+  pthread_join(thread, NULL);
+  pthread_attr_destroy(&attr);
+  size_t untouched = 0;
+  while (untouched < sizeof(stack) && stack[untouched] == TEST_STACK_FILL) {
+    untouched++;
+  }
+  return sizeof(stack) - untouched;
+}
+
+static size_t job_stack_use(bench_job_t *job, size_t baseline)
+{
+  size_t used = painted_stack_use(job);
+  return used > baseline ? used - baseline : 0;
+}
+
+static void bench(void)
+{
+  const size_t baseline = painted_stack_use(NULL);
+  for (size_t i = 0; i < sizeof(s_payloads) / sizeof(s_payloads[0]); ++i) {
+    bench_job_t job = {&s_payloads[i], strlen(s_payloads[i].payload), false, false};
+    int64_t started = now_ns();
+    bool ok = true;
+    for (int n = 0; n < TEST_BENCH_ITERATIONS; ++n) {
+      ok = run_scan(&job) && ok;
+    }
+    double scan_ns = (double)(now_ns() - started) / TEST_BENCH_ITERATIONS;
+    size_t scan_stack = job_stack_use(&job, baseline);
+    CHECK(ok && job.ok);
+    printf("bench payload=%s bytes=%zu json_scan_ns=%.0f json_scan_stack_b=%zu json_scan_heap_b=0\n",
+           s_payloads[i].name, job.len, scan_ns, scan_stack);
+
+#if JSON_SCAN_WITH_CJSON
+    cJSON_Hooks hooks = {counting_malloc, counting_free};
+    cJSON_InitHooks(&hooks);
+    job.use_cjson = true;
+    started = now_ns();
+    ok = true;
+    for (int n = 0; n < TEST_BENCH_ITERATIONS; ++n) {
+      ok = run_cjson(&job) && ok;
+    }
+    double cjson_ns = (double)(now_ns() - started) / TEST_BENCH_ITERATIONS;
+    s_heap_peak = 0;
+    size_t cjson_stack = job_stack_use(&job, baseline);
+    CHECK(ok && job.ok);
+    printf("bench payload=%s bytes=%zu cjson_ns=%.0f cjson_stack_b=%zu cjson_heap_peak_b=%zu speedup=%.1fx\n",
+           s_payloads[i].name, job.len, cjson_ns, cjson_stack, s_heap_peak, cjson_ns / scan_ns);
+#endif
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t cases = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : TEST_DEFAULT_FUZZ_CASES;
+  s_rng = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9E3779B97F4A7C15ULL;
+  if (s_rng == 0) {
+    s_rng = 1;
+  }
+
+  test_token_stream();
+  test_accept_reject();
+  test_numbers();
+  test_strings();
+  test_fields();
+  test_skip();
+  printf("unit failures=%d\n", s_failures);
+
+  fuzz(cases);
+  bench();
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
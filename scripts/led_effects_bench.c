@@ -0,0 +1,215 @@
+/*
+ * Host benchmark for the LED engine's pulse, wave, sparkle and greeting
+ * (main/thermostat/thermostat_leds.c).
+ *
+ * Times one 39-pixel tick of each effect as the render task runs it, layer
+ * write included, and the same tick of the float engine they replaced
+ * (scripts/host/led_effects_float.c) for comparison. The engine source is
+ * included so its renderers can be driven directly; the greeting restarts
+ * whenever its passes finish. scripts/led_effects_equiv_test.c checks that
+ * both produce the same frames. Exits non-zero if any effect's average tick
+ * exceeds the budget.
+ *
+ *   cc -O2 -g -Iscripts/host/include -Imain scripts/led_effects_bench.c scripts/host/led_effects_float.c \
+ *     scripts/host/idf_shim.c main/thermostat/led_hearth.c main/thermostat/led_program.c -lpthread -lm \
+ *     -o /tmp/led_effects_bench
+ *   /tmp/led_effects_bench [ticks] [budget_us]
+ *
+ * Host timings only bound the device cost from below. On the device, read
+ * the per-tick render time from `led_effect_stats`.
+ */
+#include "thermostat/thermostat_leds.c"
+
+#include <stdlib.h>
+
+#include "host_shim.h"
+#include "led_effects_float.h"
+
+#define BENCH_TICK_US           (10000)
+#define BENCH_DEFAULT_TICKS     (200000)
+#define BENCH_DEFAULT_BUDGET_US (20.0)
+
+typedef enum {
+  BENCH_PULSE = 0,
+  BENCH_WAVE,
+  BENCH_SPARKLE,
+  BENCH_GREETING,
+  BENCH_EFFECT_COUNT,
+} bench_effect_t;
+
+static const char *const s_effect_names[BENCH_EFFECT_COUNT] = {"pulse", "wave", "sparkle", "greeting"};
+static const thermostat_led_color_t s_heat = {0xe1, 0x75, 0x2e};
+
+// The engine's other dependencies; quiet hours stay off.
+bool time_sync_wait_for_sync(TickType_t timeout_ticks)
+{
+  (void)timeout_ticks;
+  return false;
+}
+
+esp_err_t thermostat_application_cues_quiet_hours_active(bool *active)
+{
+  *active = false;
+  return ESP_OK;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static led_layer_t *bench_layer(bench_effect_t effect)
+{
+  led_layer_t *layer = base_layer();
+  memset(layer, 0, sizeof(*layer));
+  switch (effect) {
+  case BENCH_PULSE:
+    layer->effect = LED_EFFECT_PULSE;
+    layer->pulse.color = s_heat;
+    layer->pulse.hz = 1.0f;
+    break;
+  case BENCH_WAVE:
+    layer->effect = LED_EFFECT_WAVE;
+    layer->wave.base_color = s_heat;
+    layer->wave.rising = true;
+    wave_init_positions(layer);
+    break;
+  case BENCH_SPARKLE:
+    layer->effect = LED_EFFECT_SPARKLE;
+    break;
+  default:
+    layer->effect = LED_EFFECT_GREETING;
+    greeting_reset(layer);
+    break;
+  }
+  return layer;
+}
+
+static void render_fixed(bench_effect_t effect, led_layer_t *layer, long t)
+{
+  switch (effect) {
+  case BENCH_PULSE:
+    update_pulse(layer, (int64_t)t * BENCH_TICK_US);
+    break;
+  case BENCH_WAVE:
+    update_wave(layer);
+    break;
+  case BENCH_SPARKLE:
+    update_sparkle(layer);
+    break;
+  default:
+    update_greeting(layer);
+    if (layer->effect != LED_EFFECT_GREETING) {
+      layer->effect = LED_EFFECT_GREETING;
+      greeting_reset(layer);
+    }
+    break;
+  }
+}
+
+// Average float-engine tick, in ns.
+static double time_float(bench_effect_t effect, long ticks, uint32_t *checksum)
+{
+  led_float_pulse_t pulse = {s_heat, 1.0f, 0};
+  led_float_wave_t wave;
+  led_float_wave_start(&wave, s_heat, true);
+  led_float_sparkle_t sparkle = {0};
+  led_float_greeting_t greeting;
+  led_float_greeting_start(&greeting);
+  thermostat_led_color_t out[LED_FLOAT_PIXELS] = {0};
+
+  int64_t started = now_ns();
+  for (long t = 0; t < ticks; ++t) {
+    switch (effect) {
+    case BENCH_PULSE:
+      led_float_pulse_render(&pulse, (int64_t)t * BENCH_TICK_US, out);
+      break;
+    case BENCH_WAVE:
+      led_float_wave_render(&wave, out);
+      break;
+    case BENCH_SPARKLE:
+      led_float_sparkle_render(&sparkle, out);
+      break;
+    default:
+      if (!led_float_greeting_render(&greeting, out)) {
+        led_float_greeting_start(&greeting);
+      }
+      break;
+    }
+    *checksum = *checksum * 31u + out[t % LED_FLOAT_PIXELS].g;
+  }
+  return (double)(now_ns() - started) / (double)ticks;
+}
+
+int main(int argc, char **argv)
+{
+  long ticks = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_TICKS;
+  double budget_us = argc > 2 ? atof(argv[2]) : BENCH_DEFAULT_BUDGET_US;
+  if (ticks <= 0) {
+    fprintf(stderr, "usage: %s [ticks] [budget_us]\n", argv[0]);
+    return 2;
+  }
+  int64_t *tick_ns = malloc(sizeof(int64_t) * (size_t)ticks);
+  if (tick_ns == NULL) {
+    return 2;
+  }
+
+  esp_log_level_set("*", ESP_LOG_NONE);
+  int64_t started = now_ns();
+  build_curve_tables();
+  int64_t init_ns = now_ns() - started;
+  printf("led_effects_bench pixels=%d ticks=%ld tables_ns=%lld\n", THERMOSTAT_LED_COUNT, ticks, (long long)init_ns);
+
+  uint32_t checksum = 0;
+  bool over_budget = false;
+  for (int e = 0; e < BENCH_EFFECT_COUNT; ++e) {
+    // The average comes from an untimed run, like the float engine's; a
+    // second run times each tick for the percentiles.
+    host_random_seed(0x1234u);
+    led_layer_t *layer = bench_layer((bench_effect_t)e);
+    started = now_ns();
+    for (long t = 0; t < ticks; ++t) {
+      render_fixed((bench_effect_t)e, layer, t);
+      checksum = checksum * 31u + layer->frame[t % THERMOSTAT_LED_COUNT].g;
+    }
+    double fixed_ns = (double)(now_ns() - started) / (double)ticks;
+
+    host_random_seed(0x1234u);
+    layer = bench_layer((bench_effect_t)e);
+    for (long t = 0; t < ticks; ++t) {
+      int64_t tick_started = now_ns();
+      render_fixed((bench_effect_t)e, layer, t);
+      tick_ns[t] = now_ns() - tick_started;
+    }
+    // The maximum mostly measures host preemption; the 99th percentile does not.
+    qsort(tick_ns, (size_t)ticks, sizeof(int64_t), compare_ns);
+    int64_t p50_ns = tick_ns[ticks / 2];
+    int64_t p99_ns = tick_ns[ticks - 1 - ticks / 100];
+
+    host_random_seed(0x1234u);
+    double float_ns = time_float((bench_effect_t)e, ticks, &checksum);
+
+    printf("%-8s avg_ns_per_tick=%.0f p50_ns=%lld p99_ns=%lld float_avg_ns=%.0f (%.1fx)\n", s_effect_names[e],
+           fixed_ns, (long long)p50_ns, (long long)p99_ns, float_ns, float_ns / fixed_ns);
+    if (fixed_ns / 1000.0 > budget_us) {
+      over_budget = true;
+    }
+  }
+  free(tick_ns);
+
+  printf("budget limit_us=%.2f checksum=%08x\n", budget_us, checksum);
+  if (over_budget) {
+    printf("FAIL: an effect's average tick exceeds the budget\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,265 @@
+/*
+ * Host check that the LED engine's pulse, wave, sparkle and greeting
+ * (main/thermostat/thermostat_leds.c) render the same frames, byte for byte,
+ * as the float engine they replaced (scripts/host/led_effects_float.c).
+ *
+ * The engine source is included so its effect renderers can be driven one
+ * tick at a time on a bare layer, without the timer or the render task.
+ * Frames are compared at full brightness, before quiet-hours dimming, and
+ * the pulse's latched brightness (where a fade to black starts) must match
+ * exactly too. Covered:
+ *
+ * - the tabulated curve stays within LED_CURVE_MAX_ERROR of the float curve
+ * - pulses at several colours and rates over an hour of jittered ticks,
+ *   including starts far into uptime
+ * - rising and falling waves over many wraps, on several base colours
+ * - the sparkle from the same random sequence, through its drain
+ * - the greeting over all its passes, ending on the same tick
+ *
+ *   cc -O2 -g -Iscripts/host/include -Imain scripts/led_effects_equiv_test.c scripts/host/led_effects_float.c \
+ *     scripts/host/idf_shim.c main/thermostat/led_hearth.c main/thermostat/led_program.c -lpthread -lm \
+ *     -o /tmp/led_effects_equiv_test
+ *   /tmp/led_effects_equiv_test
+ *
+ * It also reports how often the table was too close to a rounding edge and
+ * cosf settled the level. Exits non-zero on any mismatch.
+ */
+#include "thermostat/thermostat_leds.c"
+
+#include <stdlib.h>
+
+#include "host_shim.h"
+#include "led_effects_float.h"
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+#define TEST_TICK_US        (10000)
+#define TEST_PULSE_TICKS    (360000)
+#define TEST_WAVE_TICKS     (200000)
+#define TEST_SPARKLE_TICKS  (50000)
+#define TEST_CURVE_SAMPLES  (1000000)
+
+static int s_failures;
+
+static const thermostat_led_color_t s_colors[] = {
+    {0xe1, 0x75, 0x2e}, {0x27, 0x76, 0xcc}, {0x00, 0x00, 0xff}, {0xff, 0xff, 0xff},
+    {0x01, 0x02, 0x03}, {0x80, 0x40, 0xc8}, {0xfe, 0x7f, 0x00}, {0x00, 0x00, 0x00},
+};
+
+// The engine's other dependencies; quiet hours stay off.
+bool time_sync_wait_for_sync(TickType_t timeout_ticks)
+{
+  (void)timeout_ticks;
+  return false;
+}
+
+esp_err_t thermostat_application_cues_quiet_hours_active(bool *active)
+{
+  *active = false;
+  return ESP_OK;
+}
+
+static led_layer_t *test_layer(led_effect_type_t effect)
+{
+  led_layer_t *layer = base_layer();
+  memset(layer, 0, sizeof(*layer));
+  layer->effect = effect;
+  return layer;
+}
+
+static bool frames_match(const char *what, long tick, const thermostat_led_color_t *got,
+                         const thermostat_led_color_t *want)
+{
+  for (int i = 0; i < THERMOSTAT_LED_COUNT; ++i) {
+    if (got[i].r != want[i].r || got[i].g != want[i].g || got[i].b != want[i].b) {
+      fprintf(stderr, "%s: tick %ld pixel %d is #%02x%02x%02x, float engine #%02x%02x%02x\n", what, tick, i,
+              got[i].r, got[i].g, got[i].b, want[i].r, want[i].g, want[i].b);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void test_curve_error(void)
+{
+  float max_error = 0.0f;
+  for (long i = 0; i <= TEST_CURVE_SAMPLES; ++i) {
+    float u = (float)i / (float)TEST_CURVE_SAMPLES;
+    float error = fabsf(raised_cosine(u) - (0.5f - 0.5f * cosf(u * LED_PI)));
+    if (error > max_error) {
+      max_error = error;
+    }
+  }
+  printf("curve max_error=%.2e bound=%.2e\n", max_error, LED_CURVE_MAX_ERROR);
+  CHECK(max_error < LED_CURVE_MAX_ERROR);
+}
+
+static void test_pulse(void)
+{
+  static const float rates[] = {0.33f, 1.0f, 2.5f, 7.0f};
+  static const int64_t starts[] = {0, 123457, 86400LL * 1000000LL + 777};
+  long ticks = 0;
+  long settled_by_cosf = 0;
+  thermostat_led_color_t want[THERMOSTAT_LED_COUNT];
+  for (size_t c = 0; c < sizeof(s_colors) / sizeof(s_colors[0]); ++c) {
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+      for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); ++s) {
+        led_layer_t *layer = test_layer(LED_EFFECT_PULSE);
+        layer->pulse.color = s_colors[c];
+        layer->pulse.hz = rates[r];
+        layer->pulse.start_time_us = starts[s];
+        led_float_pulse_t ref = {s_colors[c], rates[r], starts[s]};
+        bool ok = true;
+        for (long t = 0; t < TEST_PULSE_TICKS && ok; ++t) {
+          // Ticks land a little late, as the render task's do.
+          int64_t now = starts[s] + t * TEST_TICK_US + (t * 7919) % 1500;
+          update_pulse(layer, now);
+          float latched = led_float_pulse_render(&ref, now, want);
+          ok = frames_match("pulse", t, layer->frame, want);
+          if (ok && layer_latched_brightness(layer) != latched) {
+            fprintf(stderr, "pulse: tick %ld latched %.9g, float engine %.9g\n", t,
+                    (double)layer_latched_brightness(layer), (double)latched);
+            ok = false;
+          }
+          float phase = layer->latched_phase;
+          float estimate = raised_cosine((phase <= 0.5f) ? phase * 2.0f : (1.0f - phase) * 2.0f);
+          if (!level_settled(s_colors[c].r, estimate) || !level_settled(s_colors[c].g, estimate) ||
+              !level_settled(s_colors[c].b, estimate)) {
+            settled_by_cosf++;
+          }
+          ticks++;
+        }
+        CHECK(ok);
+      }
+    }
+  }
+  printf("pulse ticks=%ld cosf_ticks=%ld (%.2f%%)\n", ticks, settled_by_cosf, 100.0 * settled_by_cosf / ticks);
+}
+
+static void test_wave(void)
+{
+  long ticks = 0;
+  long boosts = 0;
+  long settled_by_cosf = 0;
+  thermostat_led_color_t want[THERMOSTAT_LED_COUNT];
+  for (int rising = 0; rising <= 1; ++rising) {
+    for (size_t c = 0; c < sizeof(s_colors) / sizeof(s_colors[0]); ++c) {
+      led_layer_t *layer = test_layer(LED_EFFECT_WAVE);
+      layer->wave.base_color = s_colors[c];
+      layer->wave.rising = rising;
+      wave_init_positions(layer);
+      led_float_wave_t ref;
+      led_float_wave_start(&ref, s_colors[c], rising);
+      bool ok = true;
+      for (long t = 0; t < TEST_WAVE_TICKS && ok; ++t) {
+        update_wave(layer);
+        led_float_wave_render(&ref, want);
+        ok = frames_match(rising ? "wave rising" : "wave falling", t, layer->frame, want);
+        for (int px = 0; px < THERMOSTAT_LED_COUNT; ++px) {
+          for (int arm = 0; arm < 2 && s_wave_pixel_pos[px][arm] != LED_WAVE_NO_POSITION; ++arm) {
+            float estimate = wave_total_boost(layer, s_wave_pixel_pos[px][arm], false);
+            float margin = LED_WAVE_COUNT * LED_CURVE_MAX_ERROR;
+            if (wave_boost_level(estimate - margin) != wave_boost_level(estimate + margin)) {
+              settled_by_cosf++;
+            }
+            boosts++;
+          }
+        }
+        ticks++;
+      }
+      CHECK(ok);
+    }
+  }
+  printf("wave ticks=%ld boosts=%ld cosf_boosts=%ld (%.3f%%)\n", ticks, boosts, settled_by_cosf,
+         100.0 * settled_by_cosf / boosts);
+}
+
+static void test_sparkle(void)
+{
+  static thermostat_led_color_t frames[TEST_SPARKLE_TICKS * 2][THERMOSTAT_LED_COUNT];
+  const uint32_t seed = 0x5eed1234u;
+
+  host_random_seed(seed);
+  led_layer_t *layer = test_layer(LED_EFFECT_SPARKLE);
+  long drained_at = -1;
+  long t = 0;
+  for (; t < TEST_SPARKLE_TICKS * 2; ++t) {
+    if (t == TEST_SPARKLE_TICKS) {
+      layer->sparkle.stop_requested = true;
+    }
+    update_sparkle(layer);
+    memcpy(frames[t], layer->frame, sizeof(layer->frame));
+    if (layer->effect != LED_EFFECT_SPARKLE) {
+      drained_at = t;
+      break;
+    }
+  }
+  CHECK(drained_at > TEST_SPARKLE_TICKS);
+
+  host_random_seed(seed);
+  led_float_sparkle_t ref = {0};
+  thermostat_led_color_t want[THERMOSTAT_LED_COUNT] = {0};
+  long ref_drained_at = -1;
+  bool ok = true;
+  for (long i = 0; i <= drained_at && ok; ++i) {
+    if (i == TEST_SPARKLE_TICKS) {
+      ref.stop_requested = true;
+    }
+    bool wrote = led_float_sparkle_render(&ref, want);
+    ok = frames_match("sparkle", i, frames[i], want);
+    if (wrote && ref.stop_requested && led_float_sparkle_is_dark(&ref)) {
+      ref_drained_at = i;
+      break;
+    }
+  }
+  CHECK(ok);
+  CHECK(ref_drained_at == drained_at);
+  printf("sparkle ticks=%ld drained_after=%ld\n", drained_at + 1, drained_at - TEST_SPARKLE_TICKS);
+}
+
+static void test_greeting(void)
+{
+  led_layer_t *layer = test_layer(LED_EFFECT_GREETING);
+  greeting_reset(layer);
+  led_float_greeting_t ref;
+  led_float_greeting_start(&ref);
+  thermostat_led_color_t want[THERMOSTAT_LED_COUNT];
+  bool ok = true;
+  long t = 0;
+  for (;; ++t) {
+    update_greeting(layer);
+    bool running = led_float_greeting_render(&ref, want);
+    ok = frames_match("greeting", t, layer->frame, want);
+    if (!ok || !running || layer->effect != LED_EFFECT_GREETING) {
+      CHECK(!running && layer->effect != LED_EFFECT_GREETING);
+      break;
+    }
+  }
+  CHECK(ok);
+  printf("greeting ticks=%ld\n", t + 1);
+}
+
+int main(void)
+{
+  esp_log_level_set("*", ESP_LOG_NONE);
+  build_curve_tables();
+
+  test_curve_error();
+  test_pulse();
+  test_wave();
+  test_sparkle();
+  test_greeting();
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
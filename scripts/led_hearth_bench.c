@@ -0,0 +1,200 @@
+/*
+ * Host benchmark for the hearth-glow LED effect (main/thermostat/led_hearth.c).
+ *
+ * Times one 39-pixel frame of the fixed-point renderer. For comparison, it
+ * also times the sketch's algorithm in float: four 2D gradient-noise samples
+ * per pixel (scratch/hearth_glow). Exits non-zero if the fixed-point
+ * renderer's average tick exceeds the budget.
+ *
+ *   cc -O2 -Imain scripts/led_hearth_bench.c main/thermostat/led_hearth.c -lm -o /tmp/led_hearth_bench
+ *   /tmp/led_hearth_bench [ticks] [budget_us]
+ *
+ * Host timings only bound the device cost from below. On the device, read
+ * the per-tick render time from `led_effect_stats effect=hearth`.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "thermostat/led_hearth.h"
+
+#define BENCH_PIXELS       (39)
+#define BENCH_TICK_US      (10000)
+#define BENCH_DEFAULT_TICKS (200000)
+#define BENCH_DEFAULT_BUDGET_US (20.0)
+
+static uint8_t s_perm[512];
+
+static int compare_ns(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static float fade(float t)
+{
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static float grad(int hash, float x, float y)
+{
+  switch (hash & 3)
+  {
+    case 0:
+      return x + y;
+    case 1:
+      return -x + y;
+    case 2:
+      return x - y;
+    default:
+      return -x - y;
+  }
+}
+
+// inoise8() in float: 2D Perlin noise on 8.8 coordinates, scaled to 0..255.
+static uint8_t noise_float(uint16_t x, uint16_t y)
+{
+  int xi = x >> 8;
+  int yi = y >> 8;
+  float xf = (float)(x & 0xFF) / 256.0f;
+  float yf = (float)(y & 0xFF) / 256.0f;
+  float u = fade(xf);
+  float v = fade(yf);
+  int aa = s_perm[s_perm[xi] + yi];
+  int ab = s_perm[s_perm[xi] + yi + 1];
+  int ba = s_perm[s_perm[xi + 1] + yi];
+  int bb = s_perm[s_perm[xi + 1] + yi + 1];
+  float x1 = grad(aa, xf, yf) + u * (grad(ba, xf - 1.0f, yf) - grad(aa, xf, yf));
+  float x2 = grad(ab, xf, yf - 1.0f) + u * (grad(bb, xf - 1.0f, yf - 1.0f) - grad(ab, xf, yf - 1.0f));
+  float n = x1 + v * (x2 - x1);
+  float scaled = (n + 1.0f) * 127.5f;
+  return (uint8_t)(scaled < 0.0f ? 0.0f : (scaled > 255.0f ? 255.0f : scaled));
+}
+
+static void hsv_float(float h, float s, float v, uint8_t *rgb)
+{
+  float c = v * s;
+  float hp = h * 6.0f;
+  float x = c * (1.0f - fabsf(fmodf(hp, 2.0f) - 1.0f));
+  float m = v - c;
+  float r = c;
+  float g = x;
+  if (hp >= 1.0f)
+  {
+    r = x;
+    g = c;
+  }
+  rgb[0] = (uint8_t)lroundf((r + m) * 255.0f);
+  rgb[1] = (uint8_t)lroundf((g + m) * 255.0f);
+  rgb[2] = (uint8_t)lroundf(m * 255.0f);
+}
+
+static void render_float(const uint8_t *phase, uint32_t time, uint8_t *rgb)
+{
+  for (int i = 0; i < BENCH_PIXELS; ++i)
+  {
+    float glow = noise_float((uint16_t)(i * 60 + phase[i] * 10), (uint16_t)time) / 255.0f;
+    float flicker = noise_float((uint16_t)(i * 120 + 1000), (uint16_t)(time * 7 / 3 + phase[i] * 50)) / 255.0f;
+    float hue = noise_float((uint16_t)(i * 30 + 500), (uint16_t)(time / 2)) / 255.0f;
+    float sat = noise_float((uint16_t)(i * 20 + 2000), (uint16_t)(time / 3)) / 255.0f;
+    float level = (40.0f + glow * 215.0f - flicker * 50.0f) / 255.0f;
+    hsv_float(hue * 28.0f / 256.0f, (200.0f + sat * 55.0f) / 255.0f, level < 40.0f / 255.0f ? 40.0f / 255.0f : level,
+              &rgb[i * 3]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  long ticks = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_TICKS;
+  double budget_us = argc > 2 ? atof(argv[2]) : BENCH_DEFAULT_BUDGET_US;
+  if (ticks <= 0)
+  {
+    fprintf(stderr, "usage: %s [ticks] [budget_us]\n", argv[0]);
+    return 2;
+  }
+
+  uint32_t state = 0x2545F491u;
+  uint8_t phase[BENCH_PIXELS];
+  for (int i = 0; i < 256; ++i)
+  {
+    s_perm[i] = (uint8_t)i;
+  }
+  for (int i = 255; i > 0; --i)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    int j = (int)(state % (uint32_t)(i + 1));
+    uint8_t tmp = s_perm[i];
+    s_perm[i] = s_perm[j];
+    s_perm[j] = tmp;
+  }
+  for (int i = 0; i < 256; ++i)
+  {
+    s_perm[256 + i] = s_perm[i];
+  }
+
+  led_hearth_t hearth;
+  int64_t started = now_ns();
+  led_hearth_init(&hearth, BENCH_PIXELS, 0x1234u);
+  int64_t init_ns = now_ns() - started;
+  for (int i = 0; i < BENCH_PIXELS; ++i)
+  {
+    phase[i] = hearth.phase[i];
+  }
+
+  int64_t *tick_ns = malloc(sizeof(int64_t) * (size_t)ticks);
+  if (tick_ns == NULL)
+  {
+    return 2;
+  }
+  uint8_t rgb[BENCH_PIXELS * 3];
+  uint32_t checksum = 0;
+  started = now_ns();
+  for (long t = 0; t < ticks; ++t)
+  {
+    int64_t tick_started = now_ns();
+    led_hearth_render(&hearth, (int64_t)t * BENCH_TICK_US, rgb);
+    tick_ns[t] = now_ns() - tick_started;
+    checksum = checksum * 31u + rgb[t % (BENCH_PIXELS * 3)];
+  }
+  double fixed_ns = (double)(now_ns() - started) / (double)ticks;
+  // The maximum mostly measures host preemption; the 99th percentile does not.
+  qsort(tick_ns, (size_t)ticks, sizeof(int64_t), compare_ns);
+  int64_t p50_ns = tick_ns[ticks / 2];
+  int64_t p99_ns = tick_ns[ticks - 1 - ticks / 100];
+  free(tick_ns);
+
+  started = now_ns();
+  for (long t = 0; t < ticks; ++t)
+  {
+    // The sketch advances its noise time by 1 per 10 ms.
+    render_float(phase, (uint32_t)t, rgb);
+    checksum = checksum * 31u + rgb[t % (BENCH_PIXELS * 3)];
+  }
+  double float_ns = (double)(now_ns() - started) / (double)ticks;
+
+  printf("hearth_bench pixels=%d ticks=%ld tables_ns=%lld\n", BENCH_PIXELS, ticks, (long long)init_ns);
+  printf("fixed  avg_ns_per_tick=%.0f p50_ns=%lld p99_ns=%lld ns_per_pixel=%.1f\n", fixed_ns, (long long)p50_ns,
+         (long long)p99_ns, fixed_ns / BENCH_PIXELS);
+  printf("float  avg_ns_per_tick=%.0f ns_per_pixel=%.1f (%.1fx fixed)\n", float_ns, float_ns / BENCH_PIXELS,
+         float_ns / fixed_ns);
+  printf("budget avg_us=%.2f limit_us=%.2f tick_share=%.3f%% checksum=%08x\n", fixed_ns / 1000.0, budget_us,
+         fixed_ns / (BENCH_TICK_US * 10.0), checksum);
+  if (fixed_ns / 1000.0 > budget_us)
+  {
+    printf("FAIL: fixed-point render exceeds budget\n");
+    return 1;
+  }
+  return 0;
+}
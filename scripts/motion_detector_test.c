@@ -0,0 +1,339 @@
+/*
+ * Host tests for the snapshot motion gate (main/streaming/motion_detector.c).
+ *
+ * Renders synthetic 800x800 scenes the size of a snapshot frame: colour bars
+ * on a luma ramp, like the synthetic camera source. The test then changes
+ * them the ways the gate has to tell apart:
+ *
+ * - sensor noise
+ * - whole-frame brightness steps (room lights, the IR LED)
+ * - a person-sized object entering
+ * - a small object
+ * - a slow fade that only adds up against a fixed reference
+ *
+ * The detector runs with the Kconfig defaults: cell threshold 24, area
+ * 20 permille. Scenes are rendered in RGB565 and in padded RGB24.
+ *
+ *   cc -O1 -g -fsanitize=address,undefined -Iscripts/host/include -Imain scripts/motion_detector_test.c \
+ *     main/streaming/motion_detector.c main/streaming/frame_transform.c main/streaming/frame_rotate.c \
+ *     -o /tmp/motion_detector_test
+ *   /tmp/motion_detector_test
+ *
+ * Exits non-zero on any failure.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "streaming/motion_detector.h"
+
+#define TEST_SIDE              (800)
+#define TEST_RGB24_PAD         (64)
+#define TEST_CELL_THRESHOLD    (24)  // CONFIG_THEO_CAMERA_MOTION_CELL_THRESHOLD default
+#define TEST_AREA_PERMILLE     (20)  // CONFIG_THEO_CAMERA_MOTION_AREA_PERMILLE default
+#define TEST_BAR_COUNT         (8)
+#define TEST_SLOW_FRAMES       (20)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+typedef struct {
+  int x;
+  int y;
+  int w;
+  int h;
+  uint8_t rgb[3];
+  bool add; // lighten the area by rgb[0] instead of painting it
+} test_rect_t;
+
+typedef struct {
+  int brightness;   // added to every channel
+  int noise;        // +/- per channel
+  uint32_t seed;
+  const test_rect_t *rects;
+  size_t rect_count;
+} test_scene_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t stride;
+  frame_pixfmt_t format;
+} test_frame_t;
+
+static int s_failures;
+
+// Kept inside 40..190 so a +/-40 brightness step never clips.
+static const uint8_t s_bar_rgb[TEST_BAR_COUNT][3] = {
+  {150, 150, 150}, {150, 150, 60}, {60, 150, 150}, {60, 150, 60},
+  {150, 60, 150},  {150, 60, 60},  {60, 60, 150},  {70, 70, 70},
+};
+
+static uint32_t rng_next(uint32_t *state)
+{
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static uint8_t clamp_channel(int v)
+{
+  return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static void frame_alloc(test_frame_t *frame, frame_pixfmt_t format)
+{
+  frame->format = format;
+  frame->stride = (format == FRAME_PIXFMT_RGB565) ? TEST_SIDE * 2U : TEST_SIDE * 3U + TEST_RGB24_PAD;
+  frame->data = malloc(frame->stride * TEST_SIDE);
+}
+
+static void render(test_frame_t *frame, const test_scene_t *scene)
+{
+  uint32_t rng = scene->seed ? scene->seed : 1U;
+  for (int y = 0; y < TEST_SIDE; ++y) {
+    uint8_t *row = frame->data + (size_t)y * frame->stride;
+    const int ramp = (y * 40) / TEST_SIDE;
+    for (int x = 0; x < TEST_SIDE; ++x) {
+      const uint8_t *bar = s_bar_rgb[x / (TEST_SIDE / TEST_BAR_COUNT)];
+      int rgb[3] = {bar[0] + ramp, bar[1] + ramp, bar[2] + ramp};
+      for (size_t r = 0; r < scene->rect_count; ++r) {
+        const test_rect_t *rect = &scene->rects[r];
+        if (x >= rect->x && x < rect->x + rect->w && y >= rect->y && y < rect->y + rect->h) {
+          for (int c = 0; c < 3; ++c) {
+            rgb[c] = rect->add ? rgb[c] + rect->rgb[0] : rect->rgb[c];
+          }
+        }
+      }
+      for (int c = 0; c < 3; ++c) {
+        int v = rgb[c] + scene->brightness;
+        if (scene->noise > 0) {
+          v += (int)(rng_next(&rng) % (uint32_t)(2 * scene->noise + 1)) - scene->noise;
+        }
+        rgb[c] = clamp_channel(v);
+      }
+      if (frame->format == FRAME_PIXFMT_RGB565) {
+        const uint16_t v = (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+        row[x * 2] = (uint8_t)(v & 0xFF);
+        row[x * 2 + 1] = (uint8_t)(v >> 8);
+      } else {
+        row[x * 3] = (uint8_t)rgb[0];
+        row[x * 3 + 1] = (uint8_t)rgb[1];
+        row[x * 3 + 2] = (uint8_t)rgb[2];
+      }
+    }
+  }
+}
+
+static bool update(motion_detector_t *det, const test_frame_t *frame, const test_scene_t *scene,
+                   uint16_t *permille)
+{
+  render((test_frame_t *)frame, scene);
+  const frame_src_t src = {
+    .data = frame->data,
+    .stride = frame->stride,
+    .width = TEST_SIDE,
+    .height = TEST_SIDE,
+    .format = frame->format,
+  };
+  return motion_detector_update(det, &src, permille);
+}
+
+static void init_detector(motion_detector_t *det, uint16_t area_permille)
+{
+  const motion_detector_config_t config = {
+    .cell_threshold = TEST_CELL_THRESHOLD,
+    .area_permille = area_permille,
+  };
+  motion_detector_init(det, &config);
+}
+
+static void test_reference_lifecycle(frame_pixfmt_t format)
+{
+  test_frame_t frame;
+  frame_alloc(&frame, format);
+  motion_detector_t det;
+  init_detector(&det, TEST_AREA_PERMILLE);
+  const test_scene_t empty = {0};
+  uint16_t permille = 0;
+
+  // Accepting before any update must not invent a reference.
+  motion_detector_accept(&det);
+  CHECK(update(&det, &frame, &empty, &permille));
+  CHECK(permille == 1000);
+  // Without accept the reference is still missing.
+  CHECK(update(&det, &frame, &empty, &permille));
+  CHECK(permille == 1000);
+
+  motion_detector_accept(&det);
+  CHECK(!update(&det, &frame, &empty, &permille));
+  CHECK(permille == 0);
+  CHECK(!update(&det, &frame, &empty, NULL));
+
+  motion_detector_reset(&det);
+  CHECK(update(&det, &frame, &empty, &permille));
+  CHECK(permille == 1000);
+  // After a reset, accept takes the frame sampled since.
+  motion_detector_accept(&det);
+  CHECK(!update(&det, &frame, &empty, &permille));
+  free(frame.data);
+}
+
+static void test_noise_and_brightness(frame_pixfmt_t format)
+{
+  test_frame_t frame;
+  frame_alloc(&frame, format);
+  motion_detector_t det;
+  init_detector(&det, TEST_AREA_PERMILLE);
+  uint16_t permille = 0;
+
+  const test_scene_t base = {.noise = 8, .seed = 1};
+  update(&det, &frame, &base, NULL);
+  motion_detector_accept(&det);
+  for (uint32_t seed = 2; seed < 12; ++seed) {
+    const test_scene_t noisy = {.noise = 8, .seed = seed};
+    CHECK(!update(&det, &frame, &noisy, &permille));
+    CHECK(permille < TEST_AREA_PERMILLE);
+  }
+
+  const int steps[] = {40, -40, 25, -25};
+  for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+    const test_scene_t lit = {.brightness = steps[i], .noise = 8, .seed = 100U + (uint32_t)i};
+    CHECK(!update(&det, &frame, &lit, &permille));
+    CHECK(permille == 0);
+  }
+  free(frame.data);
+}
+
+static void test_objects(frame_pixfmt_t format)
+{
+  test_frame_t frame;
+  frame_alloc(&frame, format);
+  motion_detector_t det;
+  init_detector(&det, TEST_AREA_PERMILLE);
+  uint16_t permille = 0;
+
+  const test_scene_t empty = {.noise = 4, .seed = 7};
+  update(&det, &frame, &empty, NULL);
+  motion_detector_accept(&det);
+
+  // A person: dark, 120x320 pixels, about 60 cells.
+  const test_rect_t person = {.x = 300, .y = 300, .w = 120, .h = 320, .rgb = {15, 15, 20}};
+  const test_scene_t entered = {.noise = 4, .seed = 8, .rects = &person, .rect_count = 1};
+  CHECK(update(&det, &frame, &entered, &permille));
+  CHECK(permille >= 40 && permille <= 80);
+
+  // The same frame again after it was published: no motion. Then the person
+  // leaves: motion again.
+  motion_detector_accept(&det);
+  CHECK(!update(&det, &frame, &entered, &permille));
+  CHECK(update(&det, &frame, &empty, &permille));
+  motion_detector_accept(&det);
+
+  // A 50x50 object on a table covers a few cells, below the default area but
+  // above an area of 1.
+  const test_rect_t cup = {.x = 500, .y = 600, .w = 50, .h = 50, .rgb = {230, 230, 230}};
+  const test_scene_t small = {.noise = 4, .seed = 9, .rects = &cup, .rect_count = 1};
+  CHECK(!update(&det, &frame, &small, &permille));
+  CHECK(permille > 0 && permille < TEST_AREA_PERMILLE);
+  init_detector(&det, 1);
+  update(&det, &frame, &empty, NULL);
+  motion_detector_accept(&det);
+  CHECK(update(&det, &frame, &small, &permille));
+
+  // A person entering while the lights come on still reads as motion.
+  init_detector(&det, TEST_AREA_PERMILLE);
+  update(&det, &frame, &empty, NULL);
+  motion_detector_accept(&det);
+  const test_scene_t lit_entered = {.brightness = 30, .noise = 4, .seed = 10, .rects = &person, .rect_count = 1};
+  CHECK(update(&det, &frame, &lit_entered, &permille));
+  free(frame.data);
+}
+
+static void test_slow_change(frame_pixfmt_t format)
+{
+  test_frame_t frame;
+  frame_alloc(&frame, format);
+  motion_detector_t det;
+  uint16_t permille = 0;
+  // A 200x200 patch (64 cells) brightening by 4 per frame.
+  test_rect_t patch = {.x = 100, .y = 100, .w = 200, .h = 200, .add = true};
+  const test_scene_t start = {.rects = &patch, .rect_count = 1};
+
+  // Compared against the last published frame, the change adds up and
+  // triggers once the patch is more than the cell threshold brighter.
+  init_detector(&det, TEST_AREA_PERMILLE);
+  update(&det, &frame, &start, NULL);
+  motion_detector_accept(&det);
+  int triggered_at = -1;
+  for (int i = 1; i <= TEST_SLOW_FRAMES && triggered_at < 0; ++i) {
+    patch.rgb[0] = (uint8_t)(i * 4);
+    if (update(&det, &frame, &start, &permille)) {
+      triggered_at = i;
+    }
+  }
+  CHECK(triggered_at >= 6 && triggered_at <= 9);
+
+  // Accepting every frame instead keeps each step below the threshold.
+  init_detector(&det, TEST_AREA_PERMILLE);
+  patch.rgb[0] = 0;
+  update(&det, &frame, &start, NULL);
+  motion_detector_accept(&det);
+  for (int i = 1; i <= TEST_SLOW_FRAMES; ++i) {
+    patch.rgb[0] = (uint8_t)(i * 4);
+    CHECK(!update(&det, &frame, &start, &permille));
+    motion_detector_accept(&det);
+  }
+  free(frame.data);
+}
+
+static void test_formats_agree(void)
+{
+  // The same scene change scores about the same in both formats; RGB565
+  // only loses low bits.
+  const test_rect_t person = {.x = 420, .y = 200, .w = 120, .h = 320, .rgb = {15, 15, 20}};
+  const test_scene_t empty = {0};
+  const test_scene_t entered = {.rects = &person, .rect_count = 1};
+  uint16_t permille[2] = {0, 0};
+  const frame_pixfmt_t formats[2] = {FRAME_PIXFMT_RGB565, FRAME_PIXFMT_RGB888};
+  for (int i = 0; i < 2; ++i) {
+    test_frame_t frame;
+    frame_alloc(&frame, formats[i]);
+    motion_detector_t det;
+    init_detector(&det, TEST_AREA_PERMILLE);
+    update(&det, &frame, &empty, NULL);
+    motion_detector_accept(&det);
+    CHECK(update(&det, &frame, &entered, &permille[i]));
+    free(frame.data);
+  }
+  CHECK(abs((int)permille[0] - (int)permille[1]) <= 2);
+}
+
+int main(void)
+{
+  static const frame_pixfmt_t formats[] = {FRAME_PIXFMT_RGB565, FRAME_PIXFMT_RGB888};
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+    test_reference_lifecycle(formats[i]);
+    test_noise_and_brightness(formats[i]);
+    test_objects(formats[i]);
+    test_slow_change(formats[i]);
+  }
+  test_formats_agree();
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
@@ -12,6 +12,7 @@ from __future__ import annotations
 import argparse
 import re
 import shutil
+import struct
 import subprocess
 import sys
 import time
@@ -23,6 +24,9 @@ import paho.mqtt.client as mqtt
 
 CONFIG_LINE_RE = re.compile(r"^(CONFIG_[A-Z0-9_]+)=(.*)$")
 JPEG_MAGIC = b"\xff\xd8"
+CHUNK_MAGIC = b"TCH1"
+# magic, frame id u32, chunk index u16, chunk count u16, total JPEG length u32
+CHUNK_HEADER = struct.Struct("<4sIHHI")
 
 DEFAULT_MQTT_PORT = 80
 DEFAULT_MQTT_PATH = "/"
@@ -37,6 +41,7 @@ class CamConfig:
     port: int
     path: str
     topic: str
+    chunked: bool
     timeout_seconds: float
 
 
@@ -48,6 +53,36 @@ class SnapshotError(Exception):
     pass
 
 
+class ChunkAssembler:
+    """Reassembles one JPEG from CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES chunks."""
+
+    def __init__(self) -> None:
+        self.frame_id: int | None = None
+        self.parts: dict[int, bytes] = {}
+        self.count = 0
+        self.total_len = 0
+
+    def add(self, payload: bytes) -> bytes | None:
+        if len(payload) < CHUNK_HEADER.size:
+            raise SnapshotError(f"short chunk ({len(payload)} bytes)")
+        magic, frame_id, seq, count, total_len = CHUNK_HEADER.unpack_from(payload)
+        if magic != CHUNK_MAGIC or count == 0 or seq >= count:
+            raise SnapshotError("malformed chunk header")
+        if frame_id != self.frame_id:
+            # Chunks of an older frame were lost or we joined mid-frame; start over.
+            self.frame_id = frame_id
+            self.parts = {}
+            self.count = count
+            self.total_len = total_len
+        self.parts[seq] = payload[CHUNK_HEADER.size :]
+        if len(self.parts) < self.count:
+            return None
+        jpeg = b"".join(self.parts[i] for i in range(self.count))
+        if len(jpeg) != self.total_len:
+            raise SnapshotError(f"reassembled {len(jpeg)} bytes, header says {self.total_len}")
+        return jpeg
+
+
 def parse_args() -> argparse.Namespace:
     parser = argparse.ArgumentParser(
         description="Subscribe to the configured thermostat camera snapshot topic and display one JPEG with Kitty icat.",
@@ -58,6 +93,12 @@ def parse_args() -> argparse.Namespace:
     parser.add_argument("--topic", help="Explicit MQTT topic to subscribe to")
     parser.add_argument("--theo-base", help="Theo base topic override for derived snapshot topic")
     parser.add_argument("--slug", help="Device slug override for derived snapshot topic")
+    parser.add_argument(
+        "--chunked",
+        action=argparse.BooleanOptionalAction,
+        default=None,
+        help="Reassemble chunked snapshots (default: CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES > 0)",
+    )
     parser.add_argument(
         "--timeout",
         type=float,
@@ -126,10 +167,11 @@ def normalize_ws_path(path: str | None) -> str:
     return value
 
 
-def derive_topic(theo_base: str | None, slug: str | None) -> str:
+def derive_topic(theo_base: str | None, slug: str | None, chunked: bool) -> str:
     normalized_base = normalize_topic_base(theo_base) or DEFAULT_THEO_BASE_TOPIC
     normalized_slug = normalize_slug(slug) or DEFAULT_DEVICE_SLUG
-    return f"{normalized_base}/{normalized_slug}/camera/snapshot"
+    suffix = "camera/snapshot/chunk" if chunked else "camera/snapshot"
+    return f"{normalized_base}/{normalized_slug}/{suffix}"
 
 
 def resolve_config(args: argparse.Namespace, values: Mapping[str, str]) -> CamConfig:
@@ -142,9 +184,13 @@ def resolve_config(args: argparse.Namespace, values: Mapping[str, str]) -> CamCo
         port = int(values.get("CONFIG_THEO_MQTT_PORT", str(DEFAULT_MQTT_PORT)))
 
     path = normalize_ws_path(args.path or values.get("CONFIG_THEO_MQTT_PATH") or DEFAULT_MQTT_PATH)
+    chunked = args.chunked
+    if chunked is None:
+        chunked = int(values.get("CONFIG_THEO_CAMERA_SNAPSHOT_CHUNK_BYTES", "0") or "0") > 0
     topic = args.topic or derive_topic(
         args.theo_base or values.get("CONFIG_THEO_THEOSTAT_BASE_TOPIC"),
         args.slug or values.get("CONFIG_THEO_DEVICE_SLUG"),
+        chunked,
     )
 
     if args.timeout <= 0:
@@ -155,6 +201,7 @@ def resolve_config(args: argparse.Namespace, values: Mapping[str, str]) -> CamCo
         port=port,
         path=path,
         topic=topic,
+        chunked=chunked,
         timeout_seconds=args.timeout,
     )
 
@@ -163,6 +210,7 @@ def receive_snapshot(config: CamConfig) -> bytes:
     client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, transport="websockets")
     client.ws_set_options(path=config.path)
     snapshot: bytes | None = None
+    assembler = ChunkAssembler()
     connected = False
     failed_reason: str | None = None
 
@@ -201,11 +249,20 @@ def receive_snapshot(config: CamConfig) -> bytes:
         message: mqtt.MQTTMessage,
     ) -> None:
         nonlocal failed_reason, snapshot
-        if not message.payload.startswith(JPEG_MAGIC):
-            failed_reason = f"received non-JPEG payload on {message.topic} ({len(message.payload)} bytes)"
+        payload = bytes(message.payload)
+        if config.chunked:
+            try:
+                payload = assembler.add(payload)
+            except SnapshotError as exc:
+                print(f"theocam: dropping chunk on {message.topic}: {exc}", file=sys.stderr)
+                return
+            if payload is None:
+                return
+        if not payload.startswith(JPEG_MAGIC):
+            failed_reason = f"received non-JPEG payload on {message.topic} ({len(payload)} bytes)"
             print(f"theocam: {failed_reason}", file=sys.stderr)
             return
-        snapshot = bytes(message.payload)
+        snapshot = payload
         client.disconnect()
 
     client.on_connect = on_connect
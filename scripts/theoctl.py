@@ -25,8 +25,13 @@ DEFAULT_MQTT_PORT = 80
 DEFAULT_MQTT_PATH = "/"
 DEFAULT_THEO_BASE_TOPIC = "theostat"
 SUPPORTED_COMMANDS: tuple[str, ...] = (
+    "camera_benchmark",
+    "command_probe",
     "coolwave",
+    "dataplane_digest",
+    "hearth",
     "heatwave",
+    "led_program",
     "radar_calibrate",
     "radar_dump_thresholds",
     "rainbow",
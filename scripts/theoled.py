@@ -0,0 +1,641 @@
+#!/usr/bin/env -S uv run --script
+# /// script
+# requires-python = ">=3.11"
+# dependencies = [
+#   "paho-mqtt>=2.1.0",
+# ]
+# ///
+"""Assemble, preview and push LED effect programs.
+
+Programs are written as one instruction per line (see scripts/led_programs/)
+and assembled into the binary format read by main/thermostat/led_program.c.
+The renderer here mirrors that interpreter in integer arithmetic, so preview
+frames match the strip bit for bit before quiet-hours dimming and layer
+blending.
+"""
+
+from __future__ import annotations
+
+import argparse
+import re
+import struct
+import sys
+import time
+import urllib.error
+import urllib.request
+from collections.abc import Mapping, Sequence
+from dataclasses import dataclass, field
+from pathlib import Path
+
+CONFIG_LINE_RE = re.compile(r"^(CONFIG_[A-Z0-9_]+)=(.*)$")
+
+DEFAULT_MQTT_PORT = 80
+DEFAULT_MQTT_PATH = "/"
+DEFAULT_HTTP_PORT = 8080
+DEFAULT_THEO_BASE_TOPIC = "theostat"
+DEFAULT_DEVICE_SLUG = "hallway"
+DEFAULT_MAX_COST = 96
+
+PROGRAM_VERSION = 1
+MAX_TRACKS = 4
+MAX_KEYS = 8
+MAX_CODE = 256
+STACK_DEPTH = 8
+HEADER = struct.Struct("<2sBBHH")
+
+Q16_ONE = 65536
+LED_COUNT = 39
+TICK_MS = 10
+
+# Physical layout, as in thermostat_leds.c: left 0-14 (bottom to top), top
+# 15-22 (left to right), right 23-38 (top to bottom).
+LEFT_START, LEFT_END = 0, 14
+TOP_START, TOP_END = 15, 22
+RIGHT_START, RIGHT_END = 23, 38
+
+
+@dataclass(frozen=True)
+class Op:
+    code: int
+    pops: int
+    pushes: int
+    cost: int
+    imm: str = ""  # "" none, "q8" i16 Q8.8, "u8" track index
+
+
+OPS: dict[str, Op] = {
+    "push": Op(0x01, 0, 1, 1, "q8"),
+    "pos": Op(0x02, 0, 1, 1),
+    "index": Op(0x03, 0, 1, 1),
+    "time": Op(0x04, 0, 1, 1),
+    "phase": Op(0x05, 0, 1, 1),
+    "hash": Op(0x06, 0, 1, 1),
+    "track": Op(0x07, 0, 1, 1, "u8"),
+    "add": Op(0x10, 2, 1, 1),
+    "sub": Op(0x11, 2, 1, 1),
+    "mul": Op(0x12, 2, 1, 1),
+    "min": Op(0x13, 2, 1, 1),
+    "max": Op(0x14, 2, 1, 1),
+    "abs": Op(0x15, 1, 1, 1),
+    "frac": Op(0x16, 1, 1, 1),
+    "clamp": Op(0x17, 1, 1, 1),
+    "dup": Op(0x18, 1, 2, 1),
+    "swap": Op(0x19, 2, 2, 1),
+    "mix": Op(0x1A, 3, 1, 3),
+    "smooth": Op(0x20, 1, 1, 2),
+    "wave": Op(0x21, 1, 1, 2),
+    "bump": Op(0x22, 1, 1, 2),
+    "noise": Op(0x23, 2, 1, 6),
+    "rgb": Op(0x30, 3, 0, 3),
+    "hsv": Op(0x31, 3, 0, 4),
+}
+OPS_BY_CODE = {op.code: (name, op) for name, op in OPS.items()}
+
+
+class ProgramError(ValueError):
+    pass
+
+
+@dataclass
+class Program:
+    period_ms: int = 0
+    tracks: list[list[tuple[int, int]]] = field(default_factory=list)
+    code: list[tuple[str, int | None]] = field(default_factory=list)
+
+    @property
+    def cost(self) -> int:
+        return sum(OPS[name].cost for name, _ in self.code)
+
+
+# --- Assembly ---------------------------------------------------------------
+
+
+def to_q8(text: str, line_no: int) -> int:
+    try:
+        value = round(float(text) * 256)
+    except ValueError as exc:
+        raise ProgramError(f"line {line_no}: bad number {text!r}") from exc
+    if not -32768 <= value <= 32767:
+        raise ProgramError(f"line {line_no}: {text} is outside Q8.8 range")
+    return value
+
+
+def assemble_text(source: str) -> Program:
+    program = Program()
+    for line_no, raw_line in enumerate(source.splitlines(), start=1):
+        line = raw_line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        words = line.split()
+        name = words[0].lower()
+        args = words[1:]
+        if name == "period":
+            if len(args) != 1 or not args[0].isdigit() or int(args[0]) > 0xFFFF:
+                raise ProgramError(f"line {line_no}: period takes milliseconds 0-65535")
+            program.period_ms = int(args[0])
+        elif name == "keys":
+            if not args or int(args[0]) != len(program.tracks):
+                raise ProgramError(f"line {line_no}: tracks must be defined in order from 0")
+            keys: list[tuple[int, int]] = []
+            for item in args[1:]:
+                at, _, value = item.partition(":")
+                if not at.isdigit() or not value:
+                    raise ProgramError(f"line {line_no}: key must be <ms>:<value>, got {item!r}")
+                keys.append((int(at), to_q8(value, line_no)))
+            program.tracks.append(keys)
+        elif name in OPS:
+            op = OPS[name]
+            if op.imm == "q8":
+                if len(args) != 1:
+                    raise ProgramError(f"line {line_no}: {name} takes one value")
+                program.code.append((name, to_q8(args[0], line_no)))
+            elif op.imm == "u8":
+                if len(args) != 1 or not args[0].isdigit():
+                    raise ProgramError(f"line {line_no}: {name} takes a track index")
+                program.code.append((name, int(args[0])))
+            else:
+                if args:
+                    raise ProgramError(f"line {line_no}: {name} takes no operand")
+                program.code.append((name, None))
+        else:
+            raise ProgramError(f"line {line_no}: unknown instruction {name!r}")
+    return program
+
+
+def encode(program: Program) -> bytes:
+    code = bytearray()
+    for name, operand in program.code:
+        op = OPS[name]
+        code.append(op.code)
+        if op.imm == "q8":
+            code += struct.pack("<h", operand)
+        elif op.imm == "u8":
+            code.append(operand)
+    out = bytearray(HEADER.pack(b"LP", PROGRAM_VERSION, len(program.tracks), program.period_ms, len(code)))
+    for keys in program.tracks:
+        out.append(len(keys))
+        for at, value in keys:
+            out += struct.pack("<Hh", at, value)
+    return bytes(out + code)
+
+
+def decode(data: bytes, max_cost: int) -> Program:
+    """Parses and validates exactly as led_program_load() does."""
+    if len(data) < HEADER.size:
+        raise ProgramError("bad header")
+    magic, version, track_count, period_ms, code_len = HEADER.unpack_from(data)
+    if magic != b"LP":
+        raise ProgramError("bad header")
+    if version != PROGRAM_VERSION:
+        raise ProgramError("unsupported version")
+    if track_count > MAX_TRACKS:
+        raise ProgramError("too many tracks")
+    if code_len == 0 or code_len > MAX_CODE:
+        raise ProgramError("bad code length")
+    program = Program(period_ms=period_ms)
+    offset = HEADER.size
+    for _ in range(track_count):
+        if offset >= len(data):
+            raise ProgramError("truncated track")
+        count = data[offset]
+        offset += 1
+        if count == 0 or count > MAX_KEYS or len(data) - offset < count * 4:
+            raise ProgramError("bad key count")
+        keys = [struct.unpack_from("<Hh", data, offset + 4 * k) for k in range(count)]
+        offset += 4 * count
+        if any(b[0] <= a[0] for a, b in zip(keys, keys[1:])):
+            raise ProgramError("key times not increasing")
+        program.tracks.append(keys)
+    if len(data) - offset != code_len:
+        raise ProgramError("length mismatch")
+
+    code = data[offset:]
+    pc = 0
+    depth = 0
+    writes = False
+    while pc < len(code):
+        if code[pc] not in OPS_BY_CODE:
+            raise ProgramError("unknown opcode")
+        name, op = OPS_BY_CODE[code[pc]]
+        width = {"": 0, "q8": 2, "u8": 1}[op.imm]
+        if pc + 1 + width > len(code):
+            raise ProgramError("truncated operand")
+        operand = None
+        if op.imm == "q8":
+            operand = struct.unpack_from("<h", code, pc + 1)[0]
+        elif op.imm == "u8":
+            operand = code[pc + 1]
+            if operand >= track_count:
+                raise ProgramError("track out of range")
+        if depth < op.pops:
+            raise ProgramError("stack underflow")
+        depth += op.pushes - op.pops
+        if depth > STACK_DEPTH:
+            raise ProgramError("stack overflow")
+        writes = writes or name in ("rgb", "hsv")
+        program.code.append((name, operand))
+        pc += 1 + width
+    if depth != 0:
+        raise ProgramError("values left on stack")
+    if not writes:
+        raise ProgramError("no output")
+    if program.cost > max_cost:
+        raise ProgramError(f"over cost budget ({program.cost} > {max_cost})")
+    return program
+
+
+# --- Rendering (integer mirror of led_program.c) ----------------------------
+
+
+def wrap32(value: int) -> int:
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def tdiv(a: int, b: int) -> int:
+    """C integer division, truncating toward zero."""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def hash32(x: int) -> int:
+    x &= 0xFFFFFFFF
+    x ^= x >> 16
+    x = (x * 0x7FEB352D) & 0xFFFFFFFF
+    x ^= x >> 15
+    x = (x * 0x846CA68B) & 0xFFFFFFFF
+    x ^= x >> 16
+    return x
+
+
+def mul_q16(a: int, b: int) -> int:
+    return wrap32((a * b) >> 16)
+
+
+def smooth_q16(t: int) -> int:
+    if t <= 0:
+        return 0
+    if t >= Q16_ONE:
+        return Q16_ONE
+    t2 = (t * t) >> 16
+    t3 = (t2 * t) >> 16
+    return 3 * t2 - 2 * t3
+
+
+def lattice(ix: int, iy: int) -> int:
+    h = hash32(((ix * 0x8DA6B343) ^ (iy * 0xD8163841)) & 0xFFFFFFFF)
+    return (h >> 24) * 257
+
+
+def value_noise(x: int, y: int) -> int:
+    ix, iy = x >> 16, y >> 16
+    u, v = smooth_q16(x & 0xFFFF), smooth_q16(y & 0xFFFF)
+    a, b = lattice(ix, iy), lattice(ix + 1, iy)
+    c, d = lattice(ix, iy + 1), lattice(ix + 1, iy + 1)
+    top = a + (((b - a) * u) >> 16)
+    bottom = c + (((d - c) * u) >> 16)
+    return top + (((bottom - top) * v) >> 16)
+
+
+def unit_to_u8(q: int) -> int:
+    if q <= 0:
+        return 0
+    if q >= Q16_ONE:
+        return 255
+    return (q * 255 + Q16_ONE // 2) >> 16
+
+
+def scale8(value: int, scale: int) -> int:
+    return (value * scale) >> 8
+
+
+def hsv_to_rgb(hue: int, sat: int, val: int) -> tuple[int, int, int]:
+    if sat == 0:
+        return val, val, val
+    region = hue // 43
+    remainder = ((hue - region * 43) * 6) & 0xFF
+    p = scale8(val, 255 - sat)
+    q = scale8(val, 255 - scale8(sat, remainder))
+    t = scale8(val, 255 - scale8(sat, 255 - remainder))
+    return [(val, t, p), (q, val, p), (p, val, t), (p, q, val), (t, p, val)][region] if region < 5 else (val, p, q)
+
+
+def pixel_heights() -> list[int]:
+    """Q16 height of each pixel along the U, as the engine passes to LED_OP_POS."""
+    half = Q16_ONE // 2
+    heights = [0] * LED_COUNT
+    span = LEFT_END - LEFT_START
+    for px in range(LEFT_START, LEFT_END + 1):
+        heights[px] = ((px - LEFT_START) * half + span // 2) // span
+    span = RIGHT_END - RIGHT_START
+    for px in range(RIGHT_START, RIGHT_END + 1):
+        heights[px] = ((RIGHT_END - px) * half + span // 2) // span
+    half_top = (TOP_END - TOP_START + 1) // 2
+    for px in range(TOP_START, TOP_END + 1):
+        from_left = half + ((px - TOP_START) * half + half_top // 2) // half_top
+        from_right = half + ((TOP_END - px) * half + half_top // 2) // half_top
+        heights[px] = min(from_left, from_right)
+    return heights
+
+
+def sample_track(keys: list[tuple[int, int]], loop_ms: int) -> int:
+    if loop_ms <= keys[0][0]:
+        return keys[0][1] * 256
+    for (t0, v0), (t1, v1) in zip(keys, keys[1:]):
+        if loop_ms < t1:
+            a, b = v0 * 256, v1 * 256
+            return a + tdiv((b - a) * (loop_ms - t0), t1 - t0)
+    return keys[-1][1] * 256
+
+
+def render_frame(program: Program, elapsed_us: int, heights: Sequence[int]) -> list[tuple[int, int, int]]:
+    elapsed_us = max(elapsed_us, 0)
+    elapsed_ms = elapsed_us // 1000
+    if program.period_ms > 0:
+        loop_ms = elapsed_ms % program.period_ms
+        phase = (loop_ms << 16) // program.period_ms
+    else:
+        loop_ms = min(elapsed_ms, 0xFFFF)
+        phase = 0
+    now = wrap32(((elapsed_us << 16) & 0xFFFFFFFFFFFFFFFF) // 1000000)
+    tracks = [sample_track(keys, loop_ms) for keys in program.tracks]
+    count = len(heights)
+    index_span = count - 1 if count > 1 else 1
+
+    frame = []
+    for i in range(count):
+        stack: list[int] = []
+        px = (0, 0, 0)
+        for name, operand in program.code:
+            if name == "push":
+                stack.append(operand * 256)
+            elif name == "pos":
+                stack.append(heights[i])
+            elif name == "index":
+                stack.append((i << 16) // index_span)
+            elif name == "time":
+                stack.append(now)
+            elif name == "phase":
+                stack.append(phase)
+            elif name == "hash":
+                stack.append(hash32(i + 0x9E3779B9) & 0xFFFF)
+            elif name == "track":
+                stack.append(tracks[operand])
+            elif name == "dup":
+                stack.append(stack[-1])
+            elif name == "swap":
+                stack[-1], stack[-2] = stack[-2], stack[-1]
+            elif name in ("abs", "frac", "clamp", "smooth", "wave", "bump"):
+                x = stack.pop()
+                if name == "abs":
+                    x = wrap32(-x) if x < 0 else x
+                elif name == "frac":
+                    x &= 0xFFFF
+                elif name == "clamp":
+                    x = min(max(x, 0), Q16_ONE)
+                elif name == "smooth":
+                    x = smooth_q16(x)
+                elif name == "wave":
+                    p = x & 0xFFFF
+                    x = smooth_q16(p * 2 if p < Q16_ONE // 2 else (Q16_ONE - p) * 2)
+                else:
+                    d = wrap32(-x) if x < 0 else x
+                    x = 0 if d < 0 or d >= Q16_ONE else smooth_q16(Q16_ONE - d)
+                stack.append(x)
+            elif name == "mix":
+                t, b, a = stack.pop(), stack.pop(), stack.pop()
+                stack.append(wrap32(a + mul_q16(wrap32(b - a), t)))
+            elif name in ("rgb", "hsv"):
+                c, b, a = stack.pop(), stack.pop(), stack.pop()
+                if name == "rgb":
+                    px = (unit_to_u8(a), unit_to_u8(b), unit_to_u8(c))
+                else:
+                    px = hsv_to_rgb((a & 0xFFFF) >> 8, unit_to_u8(b), unit_to_u8(c))
+            else:
+                b, a = stack.pop(), stack.pop()
+                if name == "add":
+                    stack.append(wrap32(a + b))
+                elif name == "sub":
+                    stack.append(wrap32(a - b))
+                elif name == "mul":
+                    stack.append(mul_q16(a, b))
+                elif name == "min":
+                    stack.append(min(a, b))
+                elif name == "max":
+                    stack.append(max(a, b))
+                elif name == "noise":
+                    stack.append(value_noise(a, b))
+        frame.append(px)
+    return frame
+
+
+def render(program: Program, seconds: float) -> list[list[tuple[int, int, int]]]:
+    heights = pixel_heights()
+    ticks = int(seconds * 1000 / TICK_MS)
+    return [render_frame(program, tick * TICK_MS * 1000, heights) for tick in range(ticks)]
+
+
+def write_ppm(path: Path, frames: list[list[tuple[int, int, int]]], scale: int) -> None:
+    """One row per tick, one column per pixel, so time runs down the image."""
+    width = LED_COUNT * scale
+    rows = bytearray()
+    for frame in frames:
+        row = b"".join(bytes(px) * scale for px in frame)
+        rows += row * scale
+    path.write_bytes(f"P6 {width} {len(frames) * scale} 255\n".encode() + bytes(rows))
+
+
+def ansi_row(frame: list[tuple[int, int, int]]) -> str:
+    cells = "".join(f"\x1b[48;2;{r};{g};{b}m " for r, g, b in frame)
+    return f"{cells}\x1b[0m"
+
+
+# --- Delivery ---------------------------------------------------------------
+
+
+def load_kconfig_values(files: list[Path]) -> dict[str, str]:
+    values: dict[str, str] = {}
+    for path in files:
+        if not path.exists():
+            continue
+        for raw_line in path.read_text(encoding="utf-8").splitlines():
+            line = raw_line.strip()
+            if not line or line.startswith("#"):
+                continue
+            match = CONFIG_LINE_RE.match(line)
+            if not match:
+                continue
+            key, raw_value = match.groups()
+            value = raw_value.strip()
+            if len(value) >= 2 and value.startswith('"') and value.endswith('"'):
+                value = value[1:-1]
+            values[key] = value
+    return values
+
+
+def normalize_slug(slug: str | None) -> str:
+    if not slug:
+        return ""
+    normalized: list[str] = []
+    prev_was_dash = True
+    for char in slug.lower():
+        if char.isalnum():
+            normalized.append(char)
+            prev_was_dash = False
+        elif not prev_was_dash:
+            normalized.append("-")
+            prev_was_dash = True
+    while normalized and normalized[-1] == "-":
+        normalized.pop()
+    return "".join(normalized)
+
+
+def normalize_ws_path(path: str | None) -> str:
+    value = (path or "").strip()
+    if not value or value == "/":
+        return "/"
+    if not value.startswith("/"):
+        return f"/{value}"
+    return value
+
+
+def push_mqtt(payload: bytes, values: Mapping[str, str], topic: str | None) -> None:
+    import paho.mqtt.client as mqtt
+
+    host = values.get("CONFIG_THEO_MQTT_HOST", "").strip()
+    if not host:
+        raise SystemExit("theoled: MQTT host is required; set CONFIG_THEO_MQTT_HOST in repo config")
+    port = int(values.get("CONFIG_THEO_MQTT_PORT", str(DEFAULT_MQTT_PORT)))
+    path = normalize_ws_path(values.get("CONFIG_THEO_MQTT_PATH") or DEFAULT_MQTT_PATH)
+    if topic is None:
+        base = (values.get("CONFIG_THEO_THEOSTAT_BASE_TOPIC") or "").strip().strip("/") or DEFAULT_THEO_BASE_TOPIC
+        slug = normalize_slug(values.get("CONFIG_THEO_DEVICE_SLUG")) or DEFAULT_DEVICE_SLUG
+        topic = f"{base}/{slug}/led_program"
+
+    client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, transport="websockets")
+    client.ws_set_options(path=path)
+    print(f"Connecting to ws://{host}:{port}{path}...", file=sys.stderr)
+    client.connect(host, port, keepalive=60)
+    client.loop_start()
+    try:
+        print(f"Publishing {len(payload)} bytes to {topic}...", file=sys.stderr)
+        info = client.publish(topic, payload, qos=1)
+        deadline = time.time() + 5
+        while not info.is_published() and time.time() < deadline:
+            time.sleep(0.1)
+        if not info.is_published():
+            raise SystemExit("theoled: timed out waiting for the program to be published")
+    finally:
+        client.loop_stop()
+        client.disconnect()
+    print("Program sent; watch the log for led_program_install.", file=sys.stderr)
+
+
+def push_http(payload: bytes, host: str, values: Mapping[str, str]) -> None:
+    port = int(values.get("CONFIG_THEO_OTA_PORT", str(DEFAULT_HTTP_PORT)))
+    url = f"http://{host}:{port}/led/program"
+    request = urllib.request.Request(
+        url, data=payload, method="POST", headers={"Content-Type": "application/octet-stream"}
+    )
+    try:
+        with urllib.request.urlopen(request, timeout=10) as response:
+            print(response.read().decode("utf-8", "replace").strip())
+    except urllib.error.HTTPError as exc:
+        raise SystemExit(f"theoled: {url} rejected the program: {exc.read().decode('utf-8', 'replace').strip()}")
+
+
+# --- CLI ----------------------------------------------------------------------
+
+
+def load_program(path: Path, max_cost: int) -> tuple[Program, bytes]:
+    if path.suffix == ".bin":
+        data = path.read_bytes()
+    else:
+        data = encode(assemble_text(path.read_text(encoding="utf-8")))
+    # Round-trip through the device's checks, so anything accepted here is
+    # accepted on the thermostat.
+    return decode(data, max_cost), data
+
+
+def parse_args(argv: Sequence[str] | None = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Assemble, preview and push thermostat LED programs.")
+    parser.add_argument(
+        "--max-cost",
+        type=int,
+        help="Per-pixel cost budget (default: CONFIG_THEO_LED_PROGRAM_MAX_COST)",
+    )
+    sub = parser.add_subparsers(dest="action", required=True)
+
+    build = sub.add_parser("build", help="Assemble a program to its binary form")
+    build.add_argument("source", type=Path)
+    build.add_argument("-o", "--output", type=Path, help="Output path (default: source with .bin)")
+
+    preview = sub.add_parser("render", help="Render frames on the host")
+    preview.add_argument("source", type=Path, help=".ledp source or assembled .bin")
+    preview.add_argument("--seconds", type=float, default=4.0, help="How much time to render")
+    preview.add_argument("--ppm", type=Path, help="Write frames as a PPM strip image (time runs down)")
+    preview.add_argument("--scale", type=int, default=4, help="PPM pixel size")
+    preview.add_argument("--dump", action="store_true", help="Print frames as hex, one line per tick")
+    preview.add_argument("--play", action="store_true", help="Animate in the terminal in real time")
+
+    push = sub.add_parser("push", help="Send a program to the thermostat")
+    push.add_argument("source", type=Path, help=".ledp source or assembled .bin")
+    push.add_argument("--http", metavar="HOST", help="POST to http://HOST/led/program instead of MQTT")
+    push.add_argument("--topic", help="Explicit MQTT topic")
+    return parser.parse_args(argv)
+
+
+def main() -> int:
+    args = parse_args()
+    repo_root = Path(__file__).resolve().parent.parent
+    values = load_kconfig_values(
+        [
+            repo_root / "sdkconfig.defaults",
+            repo_root / "sdkconfig.defaults.local",
+            repo_root / "sdkconfig",
+        ]
+    )
+    max_cost = args.max_cost or int(values.get("CONFIG_THEO_LED_PROGRAM_MAX_COST", str(DEFAULT_MAX_COST)))
+
+    try:
+        program, data = load_program(args.source, max_cost)
+    except (ProgramError, OSError) as exc:
+        print(f"theoled: {args.source}: {exc}", file=sys.stderr)
+        return 1
+    print(
+        f"{args.source}: {len(data)} bytes, {len(program.tracks)} tracks, cost {program.cost}/{max_cost} per pixel",
+        file=sys.stderr,
+    )
+
+    if args.action == "build":
+        output = args.output or args.source.with_suffix(".bin")
+        output.write_bytes(data)
+        print(f"wrote {output}", file=sys.stderr)
+    elif args.action == "render":
+        frames = render(program, args.seconds)
+        if args.ppm:
+            write_ppm(args.ppm, frames, max(args.scale, 1))
+            print(f"wrote {args.ppm} ({len(frames)} frames)", file=sys.stderr)
+        if args.dump:
+            for frame in frames:
+                print("".join(f"{r:02x}{g:02x}{b:02x}" for r, g, b in frame))
+        if args.play:
+            for frame in frames:
+                sys.stdout.write(f"\r{ansi_row(frame)}")
+                sys.stdout.flush()
+                time.sleep(TICK_MS / 1000)
+            sys.stdout.write("\n")
+        elif not args.ppm and not args.dump:
+            # A still summary: every 100 ms down the screen.
+            for frame in frames[:: 100 // TICK_MS]:
+                print(ansi_row(frame))
+    else:
+        if args.http:
+            push_http(data, args.http, values)
+        else:
+            push_mqtt(data, values, args.topic)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,521 @@
+#!/usr/bin/env -S uv run --script
+# /// script
+# requires-python = ">=3.11"
+# dependencies = [
+#   "paho-mqtt>=2.1.0",
+# ]
+# ///
+"""Record Home Assistant traffic the thermostat consumes and replay it for dataplane benchmarks."""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import json
+import re
+import sys
+import threading
+import time
+from collections.abc import Mapping, Sequence
+from dataclasses import dataclass, field
+from pathlib import Path
+
+import paho.mqtt.client as mqtt
+
+CONFIG_LINE_RE = re.compile(r"^(CONFIG_[A-Z0-9_]+)=(.*)$")
+LOG_FIELD_RE = re.compile(r"([a-z0-9_]+)=(\S+)")
+ANSI_ESCAPE_RE = re.compile(r"\x1b\[[0-9;]*m")
+
+DEFAULT_MQTT_PORT = 80
+DEFAULT_MQTT_PATH = "/"
+DEFAULT_HA_BASE_TOPIC = "homeassistant"
+DEFAULT_THEO_BASE_TOPIC = "theostat"
+DEFAULT_DEVICE_SLUG = "hallway"
+DEFAULT_DIGEST_TIMEOUT_SECONDS = 45.0
+CAPTURE_FORMAT = 1
+
+# Mirrors s_topics in main/connectivity/mqtt_dataplane.c (relative to the HA base).
+DATAPLANE_HA_SUFFIXES: tuple[str, ...] = (
+    "sensor/pirateweather_temperature/state",
+    "sensor/pirateweather_icon/state",
+    "sensor/theoretical_thermostat_target_room_temperature/state",
+    "climate/theoretical_thermostat_climate_control/target_temp_low",
+    "climate/theoretical_thermostat_climate_control/target_temp_high",
+    "sensor/theoretical_thermostat_target_room_name/state",
+    "binary_sensor/theoretical_thermostat_computed_fan/state",
+    "binary_sensor/theoretical_thermostat_computed_heat/state",
+    "binary_sensor/theoretical_thermostat_computed_a_c/state",
+    "sensor/hallway_camera_last_recognized_face/state",
+    "sensor/hallway_camera_person_count/state",
+)
+DIGEST_COMMAND = "dataplane_digest"
+LANE_NAMES: tuple[str, ...] = ("high", "low")
+
+
+@dataclass(frozen=True)
+class ReplayConfig:
+    host: str
+    port: int
+    path: str
+    ha_base: str
+    device_root: str
+
+    @property
+    def command_topic(self) -> str:
+        return f"{self.device_root}/command"
+
+    @property
+    def log_topic(self) -> str:
+        return f"{self.device_root}/logs"
+
+    @property
+    def diag_topic(self) -> str:
+        return f"{self.device_root}/diagnostics/mqtt_dataplane"
+
+
+@dataclass(frozen=True)
+class CaptureRecord:
+    t: float
+    topic: str
+    payload: bytes
+    qos: int
+    retain: bool
+
+
+@dataclass
+class DeviceWindow:
+    digest: dict[str, str] | None = None
+    lanes: dict[str, dict[str, str]] = field(default_factory=dict)
+    diag: dict[str, object] | None = None
+
+
+def parse_args(argv: Sequence[str] | None = None) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Record dataplane MQTT traffic from the broker, or replay a capture and report device-side stats.",
+    )
+    parser.add_argument("--host", help="MQTT broker host")
+    parser.add_argument("--port", type=int, help="MQTT broker port")
+    parser.add_argument("--path", help="MQTT WebSocket path")
+    parser.add_argument("--ha-base", help="Home Assistant base topic override")
+    parser.add_argument("--theo-base", help="Theo base topic override for device topics")
+    parser.add_argument("--slug", help="Device slug override for device topics")
+    subparsers = parser.add_subparsers(dest="mode", required=True)
+
+    record = subparsers.add_parser("record", help="Record dataplane topics to a JSONL capture")
+    record.add_argument("--out", type=Path, required=True, help="Capture file to write")
+    record.add_argument("--duration", type=float, help="Stop after this many seconds (default: until Ctrl-C)")
+    record.add_argument(
+        "--topic",
+        action="append",
+        default=[],
+        help="Extra topic filter to record; may be repeated",
+    )
+    record.add_argument(
+        "--no-retained",
+        action="store_true",
+        help="Skip the retained snapshot the broker sends on subscribe",
+    )
+
+    replay = subparsers.add_parser("replay", help="Replay a capture and collect the device digest for the window")
+    replay.add_argument("capture", type=Path, help="Capture file written by 'record'")
+    pacing = replay.add_mutually_exclusive_group()
+    pacing.add_argument("--speed", type=float, default=1.0, help="Replay speed multiplier (default: 1.0)")
+    pacing.add_argument("--fast", action="store_true", help="Publish back-to-back without timing gaps")
+    replay.add_argument(
+        "--retain",
+        action="store_true",
+        help="Keep recorded retain flags (overwrites retained HA state on the broker)",
+    )
+    replay.add_argument(
+        "--no-digest",
+        action="store_true",
+        help="Only publish; do not bracket the run with dataplane_digest commands",
+    )
+    replay.add_argument(
+        "--digest-timeout",
+        type=float,
+        default=DEFAULT_DIGEST_TIMEOUT_SECONDS,
+        help="Seconds to wait for each device digest",
+    )
+    return parser.parse_args(argv)
+
+
+def load_kconfig_values(files: list[Path]) -> dict[str, str]:
+    values: dict[str, str] = {}
+    for path in files:
+        if not path.exists():
+            continue
+        for raw_line in path.read_text(encoding="utf-8").splitlines():
+            line = raw_line.strip()
+            if not line or line.startswith("#"):
+                continue
+            match = CONFIG_LINE_RE.match(line)
+            if not match:
+                continue
+            key, raw_value = match.groups()
+            values[key] = parse_kconfig_value(raw_value)
+    return values
+
+
+def parse_kconfig_value(raw_value: str) -> str:
+    value = raw_value.strip()
+    if len(value) >= 2 and value.startswith('"') and value.endswith('"'):
+        value = value[1:-1]
+    return value
+
+
+def normalize_topic_base(topic: str | None) -> str:
+    if topic is None:
+        return ""
+    return topic.strip().strip("/")
+
+
+def normalize_slug(slug: str | None) -> str:
+    if not slug:
+        return ""
+
+    normalized: list[str] = []
+    prev_was_dash = True
+    for char in slug.lower():
+        if char.isalnum():
+            normalized.append(char)
+            prev_was_dash = False
+        elif not prev_was_dash:
+            normalized.append("-")
+            prev_was_dash = True
+
+    while normalized and normalized[-1] == "-":
+        normalized.pop()
+
+    return "".join(normalized)
+
+
+def normalize_ws_path(path: str | None) -> str:
+    value = (path or "").strip()
+    if not value or value == "/":
+        return "/"
+    if not value.startswith("/"):
+        return f"/{value}"
+    return value
+
+
+def resolve_config(args: argparse.Namespace, config_values: Mapping[str, str]) -> ReplayConfig:
+    host = args.host or config_values.get("CONFIG_THEO_MQTT_HOST", "").strip()
+    if not host:
+        raise SystemExit("theoreplay: MQTT host is required; set CONFIG_THEO_MQTT_HOST or pass --host")
+
+    port = args.port
+    if port is None:
+        port = int(config_values.get("CONFIG_THEO_MQTT_PORT", str(DEFAULT_MQTT_PORT)))
+
+    path = normalize_ws_path(args.path or config_values.get("CONFIG_THEO_MQTT_PATH") or DEFAULT_MQTT_PATH)
+    ha_base = (
+        normalize_topic_base(args.ha_base or config_values.get("CONFIG_THEO_HA_BASE_TOPIC"))
+        or DEFAULT_HA_BASE_TOPIC
+    )
+    theo_base = (
+        normalize_topic_base(args.theo_base or config_values.get("CONFIG_THEO_THEOSTAT_BASE_TOPIC"))
+        or DEFAULT_THEO_BASE_TOPIC
+    )
+    slug = normalize_slug(args.slug or config_values.get("CONFIG_THEO_DEVICE_SLUG")) or DEFAULT_DEVICE_SLUG
+
+    return ReplayConfig(host=host, port=port, path=path, ha_base=ha_base, device_root=f"{theo_base}/{slug}")
+
+
+def build_client(config: ReplayConfig, on_message) -> tuple[mqtt.Client, threading.Event]:
+    client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, transport="websockets")
+    client.ws_set_options(path=config.path)
+    connected = threading.Event()
+
+    def on_connect(
+        _client: mqtt.Client,
+        _userdata: object,
+        _connect_flags: mqtt.ConnectFlags,
+        reason_code: mqtt.ReasonCode,
+        _properties: mqtt.Properties | None,
+    ) -> None:
+        if reason_code.is_failure:
+            print(f"theoreplay: connect failed ({reason_code})", file=sys.stderr)
+            return
+        connected.set()
+
+    client.on_connect = on_connect
+    client.on_message = on_message
+    return client, connected
+
+
+def connect(client: mqtt.Client, connected: threading.Event, config: ReplayConfig) -> None:
+    print(f"theoreplay: connecting to ws://{config.host}:{config.port}{config.path}", file=sys.stderr)
+    client.connect(config.host, config.port, keepalive=60)
+    client.loop_start()
+    if not connected.wait(10.0):
+        raise SystemExit("theoreplay: timed out connecting to broker")
+
+
+def encode_record(t: float, message: mqtt.MQTTMessage) -> dict[str, object]:
+    record: dict[str, object] = {
+        "t": round(t, 6),
+        "topic": message.topic,
+        "qos": message.qos,
+        "retain": bool(message.retain),
+    }
+    try:
+        record["payload"] = message.payload.decode("utf-8")
+    except UnicodeDecodeError:
+        record["payload_b64"] = base64.b64encode(message.payload).decode("ascii")
+    return record
+
+
+def record_capture(config: ReplayConfig, args: argparse.Namespace) -> int:
+    topics = [f"{config.ha_base}/{suffix}" for suffix in DATAPLANE_HA_SUFFIXES]
+    topics.append(config.command_topic)
+    topics.extend(args.topic)
+
+    lock = threading.Lock()
+    start = time.monotonic()
+    count = 0
+    out = args.out.open("w", encoding="utf-8")
+    # The header carries the topic roots so replay can remap to another device.
+    header = {
+        "format": CAPTURE_FORMAT,
+        "ha_base": config.ha_base,
+        "device_root": config.device_root,
+        "recorded_at": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+    }
+    out.write(json.dumps(header) + "\n")
+
+    def on_message(_client: mqtt.Client, _userdata: object, message: mqtt.MQTTMessage) -> None:
+        nonlocal count
+        if args.no_retained and message.retain:
+            return
+        with lock:
+            out.write(json.dumps(encode_record(time.monotonic() - start, message)) + "\n")
+            count += 1
+
+    client, connected = build_client(config, on_message)
+    try:
+        connect(client, connected, config)
+        client.subscribe([(topic, 0) for topic in topics])
+        print(f"theoreplay: recording {len(topics)} topics to {args.out}", file=sys.stderr)
+        deadline = None if args.duration is None else time.monotonic() + args.duration
+        while deadline is None or time.monotonic() < deadline:
+            time.sleep(0.2)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        client.loop_stop()
+        client.disconnect()
+        with lock:
+            out.close()
+
+    print(f"theoreplay: recorded {count} messages in {time.monotonic() - start:.1f}s", file=sys.stderr)
+    return 0
+
+
+def load_capture(path: Path, config: ReplayConfig) -> list[CaptureRecord]:
+    lines = path.read_text(encoding="utf-8").splitlines()
+    if not lines:
+        raise SystemExit(f"theoreplay: {path} is empty")
+    header = json.loads(lines[0])
+    if header.get("format") != CAPTURE_FORMAT:
+        raise SystemExit(f"theoreplay: {path} has unsupported format {header.get('format')!r}")
+
+    remaps = (
+        (f"{header['ha_base']}/", f"{config.ha_base}/"),
+        (f"{header['device_root']}/", f"{config.device_root}/"),
+    )
+    records: list[CaptureRecord] = []
+    for raw in lines[1:]:
+        if not raw.strip():
+            continue
+        entry = json.loads(raw)
+        topic = entry["topic"]
+        for old, new in remaps:
+            if topic.startswith(old):
+                topic = new + topic[len(old):]
+                break
+        if "payload_b64" in entry:
+            payload = base64.b64decode(entry["payload_b64"])
+        else:
+            payload = entry["payload"].encode("utf-8")
+        records.append(
+            CaptureRecord(
+                t=float(entry["t"]),
+                topic=topic,
+                payload=payload,
+                qos=int(entry.get("qos", 0)),
+                retain=bool(entry.get("retain", False)),
+            )
+        )
+    records.sort(key=lambda record: record.t)
+    return records
+
+
+def parse_log_fields(line: str) -> dict[str, str]:
+    return dict(LOG_FIELD_RE.findall(ANSI_ESCAPE_RE.sub("", line)))
+
+
+def wait_for_window(
+    client: mqtt.Client,
+    config: ReplayConfig,
+    windows: list[DeviceWindow],
+    cond: threading.Condition,
+    timeout: float,
+) -> DeviceWindow | None:
+    with cond:
+        windows.append(DeviceWindow())
+        index = len(windows) - 1
+    client.publish(config.command_topic, DIGEST_COMMAND, qos=1).wait_for_publish(5.0)
+    deadline = time.monotonic() + timeout
+    with cond:
+        # The device closes the window on its next periodic tick, so allow for
+        # up to one tick plus log mirror delay.
+        while windows[index].diag is None or len(windows[index].lanes) < len(LANE_NAMES):
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            cond.wait(remaining)
+        return windows[index]
+
+
+def replay_capture(config: ReplayConfig, args: argparse.Namespace) -> int:
+    records = load_capture(args.capture, config)
+    if not records:
+        raise SystemExit(f"theoreplay: {args.capture} has no messages")
+    if args.speed <= 0:
+        raise SystemExit("theoreplay: --speed must be positive")
+
+    windows: list[DeviceWindow] = []
+    cond = threading.Condition()
+
+    def on_message(_client: mqtt.Client, _userdata: object, message: mqtt.MQTTMessage) -> None:
+        if message.retain:
+            return
+        with cond:
+            if not windows:
+                return
+            window = windows[-1]
+            if message.topic == config.diag_topic:
+                try:
+                    window.diag = json.loads(message.payload)
+                except ValueError:
+                    return
+            else:
+                line = message.payload.decode("utf-8", errors="replace")
+                if "mqtt_digest " in line:
+                    window.digest = parse_log_fields(line)
+                elif "mqtt_lane_digest " in line:
+                    fields = parse_log_fields(line)
+                    window.lanes[fields.get("lane", "?")] = fields
+                else:
+                    return
+            cond.notify_all()
+
+    client, connected = build_client(config, on_message)
+    try:
+        connect(client, connected, config)
+        if not args.no_digest:
+            client.subscribe([(config.log_topic, 0), (config.diag_topic, 0)])
+            print("theoreplay: closing the device's current digest window", file=sys.stderr)
+            if wait_for_window(client, config, windows, cond, args.digest_timeout) is None:
+                raise SystemExit("theoreplay: no digest from device; is it online and running this firmware?")
+
+        pacing = "max speed" if args.fast else f"{args.speed:g}x"
+        print(f"theoreplay: replaying {len(records)} messages at {pacing}", file=sys.stderr)
+        sent_bytes = 0
+        topic_counts: dict[str, int] = {}
+        base_t = records[0].t
+        start = time.monotonic()
+        for record in records:
+            if not args.fast:
+                delay = start + (record.t - base_t) / args.speed - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+            info = client.publish(record.topic, record.payload, qos=record.qos, retain=record.retain and args.retain)
+            if info.rc != mqtt.MQTT_ERR_SUCCESS:
+                print(f"theoreplay: publish failed on {record.topic} ({info.rc})", file=sys.stderr)
+                continue
+            sent_bytes += len(record.payload)
+            topic_counts[record.topic] = topic_counts.get(record.topic, 0) + 1
+        send_s = time.monotonic() - start
+
+        print_host_summary(len(records), sent_bytes, send_s, topic_counts)
+        if args.no_digest:
+            return 0
+
+        window = wait_for_window(client, config, windows, cond, args.digest_timeout)
+        if window is None:
+            print("theoreplay: timed out waiting for the replay digest", file=sys.stderr)
+            return 1
+        print_device_summary(window)
+    except KeyboardInterrupt:
+        return 130
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+    return 0
+
+
+def print_host_summary(count: int, sent_bytes: int, send_s: float, topic_counts: Mapping[str, int]) -> None:
+    rate = count / send_s if send_s > 0 else float("inf")
+    print(f"host: sent={count} bytes={sent_bytes} elapsed_s={send_s:.3f} msgs_per_s={rate:.1f}")
+    for topic, topic_count in sorted(topic_counts.items()):
+        print(f"host: topic={topic} sent={topic_count}")
+
+
+def print_device_summary(window: DeviceWindow) -> None:
+    diag = window.diag or {}
+    window_s = float(diag.get("window_us", 0)) / 1_000_000.0
+    complete = int(diag.get("complete", 0))
+    rate = complete / window_s if window_s > 0 else 0.0
+    slab_hwm = (window.digest or {}).get("slab_hwm", "?")
+    print(f"device: window_s={window_s:.1f} complete={complete} complete_per_s={rate:.1f} slab_hwm={slab_hwm}")
+
+    drops = diag.get("drops") or {}
+    drop_text = " ".join(f"{reason}={count}" for reason, count in sorted(drops.items())) or "none"
+    print(f"device: drops {drop_text}")
+
+    for lane in LANE_NAMES:
+        fields = window.lanes.get(lane, {})
+        print(
+            f"device: lane={lane} hwm={fields.get('hwm', '?')} "
+            f"enqueued={fields.get('enqueued_delta', '?')} drop={fields.get('drop_delta', '?')} "
+            f"coalesced={fields.get('coalesced_delta', '?')} shed={fields.get('shed_delta', '?')}"
+        )
+
+    latency = diag.get("latency_us") or {}
+    for cls, stages in sorted(latency.items()):
+        parts = []
+        for stage, values in stages.items():
+            if not isinstance(values, list) or len(values) != 4 or values[0] == 0:
+                continue
+            n, p50, p95, p99 = values
+            parts.append(f"{stage}=n{n}/p50:{p50}/p95:{p95}/p99:{p99}")
+        if parts:
+            print(f"device: latency_us class={cls} " + " ".join(parts))
+
+
+def main() -> int:
+    args = parse_args()
+    repo_root = Path(__file__).resolve().parent.parent
+    config_values = load_kconfig_values(
+        [
+            repo_root / "sdkconfig.defaults",
+            repo_root / "sdkconfig.defaults.local",
+            repo_root / "sdkconfig",
+        ]
+    )
+    config = resolve_config(args, config_values)
+
+    try:
+        if args.mode == "record":
+            return record_capture(config, args)
+        return replay_capture(config, args)
+    except OSError as exc:
+        print(f"theoreplay: {exc}", file=sys.stderr)
+        return 1
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
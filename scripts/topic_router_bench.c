@@ -0,0 +1,355 @@
+/*
+ * Host test and benchmark for the MQTT topic router (main/connectivity/topic_router.c).
+ *
+ * Builds routers over the dataplane's 11 Home Assistant topics plus its two
+ * Theo command topics, then over 32, 50 and 200 topics padded with synthetic
+ * entities. Each router must route every topic to its own index and reject
+ * a set of near-misses:
+ *
+ * - every single-character substitution
+ * - the topic truncated or extended by one character
+ * - a suffix under the other namespace's prefix
+ * - the bare prefixes
+ *
+ * The same topics are then forced into a crowded table with one seed, so
+ * the linear-probing fallback gets the same checks. Finally it times
+ * lookups against the dataplane's full-topic scan. The dataplane routes with
+ * that scan up to MQTT_DP_SCAN_MAX_ROUTES (24) and with the router above it;
+ * the 13 and 32 rows should bracket the crossover. Exits non-zero on any
+ * failure.
+ *
+ *   cc -O2 -Iscripts/host/include -Imain scripts/topic_router_bench.c main/connectivity/topic_router.c \
+ *     -o /tmp/topic_router_bench
+ *   /tmp/topic_router_bench [lookups]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "connectivity/topic_router.h"
+
+#define BENCH_DEFAULT_LOOKUPS (2000000)
+#define BENCH_MAX_TOPICS      (200)
+#define BENCH_MAX_TOPIC_LEN   (128)
+#define BENCH_SEED_ATTEMPTS   (256)
+#define BENCH_RUNS            (5)
+#define BENCH_NS_HA           (0)
+#define BENCH_NS_THEO         (1)
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      s_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+static const char *const s_ha_prefix = "homeassistant/";
+static const char *const s_theo_prefix = "theostat/hallway/";
+
+// mqtt_dataplane.c's s_topics suffixes, then its two Theo-owned suffixes.
+static const char *const s_dataplane_suffixes[] = {
+    "sensor/pirateweather_temperature/state",
+    "sensor/pirateweather_icon/state",
+    "sensor/theoretical_thermostat_target_room_temperature/state",
+    "climate/theoretical_thermostat_climate_control/target_temp_low",
+    "climate/theoretical_thermostat_climate_control/target_temp_high",
+    "sensor/theoretical_thermostat_target_room_name/state",
+    "binary_sensor/theoretical_thermostat_computed_fan/state",
+    "binary_sensor/theoretical_thermostat_computed_heat/state",
+    "binary_sensor/theoretical_thermostat_computed_a_c/state",
+    "sensor/hallway_camera_last_recognized_face/state",
+    "sensor/hallway_camera_person_count/state",
+};
+#define BENCH_HA_DATAPLANE (sizeof(s_dataplane_suffixes) / sizeof(s_dataplane_suffixes[0]))
+
+typedef struct {
+  size_t count;
+  char suffix[BENCH_MAX_TOPICS][BENCH_MAX_TOPIC_LEN];
+  topic_router_key_t keys[BENCH_MAX_TOPICS];
+  char topic[BENCH_MAX_TOPICS][BENCH_MAX_TOPIC_LEN];
+  size_t topic_len[BENCH_MAX_TOPICS];
+} topic_set_t;
+
+static int s_failures;
+static uint32_t s_rng = 0x2545F491u;
+
+static uint32_t rng_next(void)
+{
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// The last two topics are always the Theo command topics, as in the
+// dataplane; the rest are HA topics, real ones first.
+static void make_topic_set(topic_set_t *set, size_t count)
+{
+  static const char *const domains[] = {"sensor", "binary_sensor", "climate", "number", "switch"};
+  memset(set, 0, sizeof(*set));
+  set->count = count;
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t ns = BENCH_NS_HA;
+    if (i == count - 2) {
+      snprintf(set->suffix[i], BENCH_MAX_TOPIC_LEN, "command");
+      ns = BENCH_NS_THEO;
+    } else if (i == count - 1) {
+      snprintf(set->suffix[i], BENCH_MAX_TOPIC_LEN, "led_program");
+      ns = BENCH_NS_THEO;
+    } else if (i < BENCH_HA_DATAPLANE) {
+      snprintf(set->suffix[i], BENCH_MAX_TOPIC_LEN, "%s", s_dataplane_suffixes[i]);
+    } else {
+      // Shared prefixes and suffixes, like real HA entity topics.
+      snprintf(set->suffix[i], BENCH_MAX_TOPIC_LEN, "%s/theoretical_thermostat_entity_%03zu/state",
+               domains[i % (sizeof(domains) / sizeof(domains[0]))], i);
+    }
+    set->keys[i] = (topic_router_key_t){.suffix = set->suffix[i], .ns = ns};
+    snprintf(set->topic[i], BENCH_MAX_TOPIC_LEN, "%s%s", ns == BENCH_NS_HA ? s_ha_prefix : s_theo_prefix,
+             set->suffix[i]);
+    set->topic_len[i] = strlen(set->topic[i]);
+  }
+}
+
+static size_t slots_for(size_t count)
+{
+  size_t slots = 1;
+  while (slots < 2 * count) {
+    slots <<= 1;
+  }
+  return slots;
+}
+
+static void setup_router(topic_router_t *router, topic_router_slot_t *slots, size_t slot_count)
+{
+  topic_router_init(router, slots, slot_count);
+  topic_router_set_prefix(router, BENCH_NS_HA, s_ha_prefix, strlen(s_ha_prefix));
+  topic_router_set_prefix(router, BENCH_NS_THEO, s_theo_prefix, strlen(s_theo_prefix));
+}
+
+// The dataplane's route_topic() scan: every full topic, HA ones first, with
+// the length checked before the bytes. Returns the same indices as the
+// router. Kept out of line so it pays the same call the router does.
+__attribute__((noinline)) static uint8_t linear_route(const topic_set_t *set, const char *topic, size_t topic_len)
+{
+  for (size_t i = 0; i < set->count; ++i) {
+    if (topic_len == set->topic_len[i] && memcmp(topic, set->topic[i], topic_len) == 0) {
+      return (uint8_t)i;
+    }
+  }
+  return TOPIC_ROUTER_NONE;
+}
+
+static void expect_miss(const topic_router_t *router, const topic_set_t *set, const char *topic, size_t len)
+{
+  // The copy is exact-size, so a sanitizer build catches reads past the topic.
+  char *copy = malloc(len > 0 ? len : 1);
+  memcpy(copy, topic, len);
+  uint8_t got = topic_router_route(router, copy, len);
+  if (got != TOPIC_ROUTER_NONE || linear_route(set, copy, len) != TOPIC_ROUTER_NONE) {
+    fprintf(stderr, "near-miss routed to %u: %.*s\n", got, (int)len, topic);
+    s_failures++;
+  }
+  free(copy);
+}
+
+static bool is_routed(const topic_set_t *set, const char *topic, size_t len)
+{
+  return linear_route(set, topic, len) != TOPIC_ROUTER_NONE;
+}
+
+static void verify_router(const topic_router_t *router, const topic_set_t *set)
+{
+  char near[BENCH_MAX_TOPIC_LEN + 2];
+  for (size_t i = 0; i < set->count; ++i) {
+    const char *topic = set->topic[i];
+    const size_t len = set->topic_len[i];
+    char *copy = malloc(len);
+    memcpy(copy, topic, len);
+    if (topic_router_route(router, copy, len) != i) {
+      fprintf(stderr, "topic %zu misrouted: %s\n", i, topic);
+      s_failures++;
+    }
+    CHECK(linear_route(set, copy, len) == i);
+    free(copy);
+
+    for (size_t pos = 0; pos < len; ++pos) {
+      memcpy(near, topic, len);
+      near[pos] = (char)(topic[pos] == 'x' ? 'y' : 'x');
+      if (!is_routed(set, near, len)) {
+        expect_miss(router, set, near, len);
+      }
+    }
+    expect_miss(router, set, topic, len - 1);
+    memcpy(near, topic, len);
+    near[len] = 's';
+    expect_miss(router, set, near, len + 1);
+    near[len] = '/';
+    expect_miss(router, set, near, len + 1);
+
+    // The suffix under the other namespace's prefix.
+    const bool ha = set->keys[i].ns == BENCH_NS_HA;
+    int n = snprintf(near, sizeof(near), "%s%s", ha ? s_theo_prefix : s_ha_prefix, set->suffix[i]);
+    expect_miss(router, set, near, (size_t)n);
+    // The suffix without any prefix.
+    expect_miss(router, set, set->suffix[i], strlen(set->suffix[i]));
+  }
+  expect_miss(router, set, s_ha_prefix, strlen(s_ha_prefix));
+  expect_miss(router, set, s_theo_prefix, strlen(s_theo_prefix));
+  expect_miss(router, set, "homeassistant/command", strlen("homeassistant/command"));
+  expect_miss(router, set, "", 0);
+  CHECK(topic_router_route(router, NULL, 0) == TOPIC_ROUTER_NONE);
+}
+
+static void test_arguments(void)
+{
+  topic_router_slot_t slots[8];
+  topic_router_t router;
+  topic_router_key_t keys[8];
+  for (size_t i = 0; i < 8; ++i) {
+    keys[i] = (topic_router_key_t){.suffix = "x", .ns = 0};
+  }
+  topic_router_init(&router, slots, 6);
+  CHECK(topic_router_build(&router, keys, 2, 1) == ESP_ERR_INVALID_ARG);
+  topic_router_init(&router, slots, 8);
+  CHECK(topic_router_build(&router, keys, 8, 1) == ESP_ERR_INVALID_ARG);
+  CHECK(topic_router_build(&router, NULL, 1, 1) == ESP_ERR_INVALID_ARG);
+  CHECK(topic_router_build(&router, keys, 1, 0) == ESP_ERR_INVALID_ARG);
+  keys[0].ns = TOPIC_ROUTER_MAX_NAMESPACES;
+  CHECK(topic_router_build(&router, keys, 1, 1) == ESP_ERR_INVALID_ARG);
+
+  // An empty router and a namespace without a prefix route nothing.
+  CHECK(topic_router_build(&router, keys, 0, 1) == ESP_OK);
+  CHECK(topic_router_route(&router, "x", 1) == TOPIC_ROUTER_NONE);
+  keys[0].ns = 0;
+  CHECK(topic_router_build(&router, keys, 1, 1) == ESP_OK);
+  CHECK(topic_router_lookup(&router, 0, "x", 1) == 0);
+  CHECK(topic_router_route(&router, "x", 1) == TOPIC_ROUTER_NONE);
+  topic_router_set_prefix(&router, 0, "a/", 2);
+  CHECK(topic_router_route(&router, "a/x", 3) == 0);
+  CHECK(topic_router_route(&router, "a/", 2) == TOPIC_ROUTER_NONE);
+}
+
+// Each timing is the best of BENCH_RUNS passes, which keeps scheduler noise
+// on a shared host out of the comparison.
+static double time_router(const topic_router_t *router, const char *const *topics, const size_t *lens, size_t n,
+                          long lookups, uint32_t *sink)
+{
+  double best = 0.0;
+  for (int run = 0; run < BENCH_RUNS; ++run) {
+    int64_t started = now_ns();
+    for (long i = 0; i < lookups; ++i) {
+      size_t k = (size_t)i % n;
+      *sink += topic_router_route(router, topics[k], lens[k]);
+    }
+    double ns = (double)(now_ns() - started) / (double)lookups;
+    best = (run == 0 || ns < best) ? ns : best;
+  }
+  return best;
+}
+
+static double time_linear(const topic_set_t *set, const char *const *topics, const size_t *lens, size_t n,
+                          long lookups, uint32_t *sink)
+{
+  double best = 0.0;
+  for (int run = 0; run < BENCH_RUNS; ++run) {
+    int64_t started = now_ns();
+    for (long i = 0; i < lookups; ++i) {
+      size_t k = (size_t)i % n;
+      *sink += linear_route(set, topics[k], lens[k]);
+    }
+    double ns = (double)(now_ns() - started) / (double)lookups;
+    best = (run == 0 || ns < best) ? ns : best;
+  }
+  return best;
+}
+
+static void run_size(size_t count, long lookups)
+{
+  static topic_set_t set;
+  static topic_router_slot_t slots[BENCH_MAX_TOPICS * 4];
+  static char misses[BENCH_MAX_TOPICS][BENCH_MAX_TOPIC_LEN];
+  topic_router_t router;
+
+  make_topic_set(&set, count);
+  const size_t slot_count = slots_for(count);
+  setup_router(&router, slots, slot_count);
+  CHECK(topic_router_build(&router, set.keys, count, BENCH_SEED_ATTEMPTS) == ESP_OK);
+  verify_router(&router, &set);
+  const uint32_t seed = router.seed;
+  const uint8_t max_probe = router.max_probe;
+
+  // The crowded table: one seed, barely more slots than keys.
+  topic_router_t crowded;
+  static topic_router_slot_t crowded_slots[BENCH_MAX_TOPICS * 2];
+  size_t crowded_count = slots_for(count) / 2;
+  if (crowded_count <= count) {
+    crowded_count *= 2;
+  }
+  setup_router(&crowded, crowded_slots, crowded_count);
+  CHECK(topic_router_build(&crowded, set.keys, count, 1) == ESP_OK);
+  verify_router(&crowded, &set);
+
+  // Lookups cycle through every routed topic, plus as many misses: state
+  // topics for entities the device does not subscribe to.
+  const char *mix[2 * BENCH_MAX_TOPICS];
+  size_t mix_len[2 * BENCH_MAX_TOPICS];
+  for (size_t i = 0; i < count; ++i) {
+    mix[2 * i] = set.topic[i];
+    mix_len[2 * i] = set.topic_len[i];
+    snprintf(misses[i], BENCH_MAX_TOPIC_LEN, "%ssensor/unrelated_entity_%03u/state", s_ha_prefix,
+             (unsigned)(rng_next() % 1000));
+    mix[2 * i + 1] = misses[i];
+    mix_len[2 * i + 1] = strlen(misses[i]);
+  }
+
+  const char *hits[BENCH_MAX_TOPICS];
+  for (size_t i = 0; i < count; ++i) {
+    hits[i] = set.topic[i];
+  }
+  uint32_t sink = 0;
+  double router_hit_ns = time_router(&router, hits, set.topic_len, count, lookups, &sink);
+  double linear_hit_ns = time_linear(&set, hits, set.topic_len, count, lookups, &sink);
+  double router_mix_ns = time_router(&router, mix, mix_len, 2 * count, lookups, &sink);
+  double linear_mix_ns = time_linear(&set, mix, mix_len, 2 * count, lookups, &sink);
+
+  printf("router topics=%zu slots=%zu seed=%u max_probe=%u crowded_slots=%zu crowded_max_probe=%u\n", count,
+         slot_count, (unsigned)seed, max_probe, crowded_count, crowded.max_probe);
+  printf("bench  topics=%zu hit_ns router=%.1f linear=%.1f (%.1fx) mixed_ns router=%.1f linear=%.1f (%.1fx) "
+         "sink=%08x\n",
+         count, router_hit_ns, linear_hit_ns, linear_hit_ns / router_hit_ns, router_mix_ns, linear_mix_ns,
+         linear_mix_ns / router_mix_ns, sink);
+}
+
+int main(int argc, char **argv)
+{
+  long lookups = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_LOOKUPS;
+  if (lookups <= 0) {
+    fprintf(stderr, "usage: %s [lookups]\n", argv[0]);
+    return 2;
+  }
+
+  test_arguments();
+  // 11 HA topics plus the two command topics, as the dataplane routes them.
+  run_size(BENCH_HA_DATAPLANE + 2, lookups);
+  run_size(32, lookups);
+  run_size(50, lookups);
+  run_size(BENCH_MAX_TOPICS, lookups);
+
+  if (s_failures != 0) {
+    printf("FAIL: %d checks failed\n", s_failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}